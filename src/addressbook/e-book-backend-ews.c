@@ -50,6 +50,7 @@
 #include "e-book-backend-ews.h"
 #include "ews-oab-decoder.h"
 #include "ews-oab-decompress.h"
+#include "ews-oab-index.h"
 
 #ifdef G_OS_WIN32
 #ifdef gmtime_r
@@ -75,6 +76,42 @@
 
 #define EWS_MAX_FETCH_COUNT 500
 
+/* The keys set by e_cache_set_key() are stored with this prefix */
+#ifndef E_CACHE_USER_KEY_PREFIX
+#define E_CACHE_USER_KEY_PREFIX "user::"
+#endif
+
+/* Nested distribution lists are expanded level by level, with at most
+   this many ExpandDL requests at once; their members are memoised in
+   the cache keys for the given number of seconds */
+#define EBB_EWS_DL_MAX_PARALLEL 8
+#define EBB_EWS_DL_CACHE_TTL (4 * 60 * 60)
+#define EBB_EWS_DL_CACHE_KEY_PREFIX "dl-members::"
+
+/* Contact photos are downloaded with this many attachments per GetAttachment
+   request and stored by their content checksum; the cache key maps an item
+   to the photo stamp and the checksum, to not download unchanged photos */
+#define EBB_EWS_CONTACT_PHOTOS_BATCH 50
+#define EBB_EWS_CONTACT_PHOTO_KEY_PREFIX "contact-photo::"
+
+/* GAL photos are fetched in the background, with at most this many
+   requests running at once and throttled by a token bucket */
+#define EBB_EWS_PHOTOS_MAX_THREADS 3
+#define EBB_EWS_PHOTOS_PER_SECOND 4.0
+#define EBB_EWS_PHOTOS_BURST 8.0
+#define EBB_EWS_PHOTOS_FLUSH_COUNT 50
+
+/* The queue file is rewritten after this many finished requests, or when
+   this many seconds passed since it had been written the last time */
+#define EBB_EWS_PHOTOS_SAVE_COUNT 100
+#define EBB_EWS_PHOTOS_SAVE_INTERVAL 30
+#define EBB_EWS_PHOTOS_QUEUE_FILENAME "gal-photos-queue"
+
+/* In the thin GAL mode the contacts are not stored in the cache; they are
+   looked up in an index of the OAB file and decoded from it on demand */
+#define EBB_EWS_THIN_GAL_KEY "gal-thin"
+#define EBB_EWS_THIN_GAL_MAX_RESULTS 100
+
 #define ELEMENT_TYPE_SIMPLE 0x01 /* simple string fields */
 #define ELEMENT_TYPE_COMPLEX 0x02 /* complex fields while require different get/set functions */
 
@@ -94,6 +131,26 @@ struct _EBookBackendEwsPrivate {
 
 	/* used for storing attachments */
 	gchar *attachments_dir;
+	gchar *photos_dir; /* contact photos, named by their checksum */
+
+	/* background GAL photo fetching */
+	GMutex photos_lock;
+	GCond photos_cond;
+	GThreadPool *photos_pool;
+	GCancellable *photos_cancellable;
+	GHashTable *photos_pending; /* gchar *uid ~> NULL; scheduled, not fetched yet */
+	GSList *photos_deferred; /* gchar *uid; waiting for the cache to be updated */
+	GSList *photos_results; /* EBookMetaBackendInfo *; waiting to be stored */
+	guint photos_serial;
+	guint photos_unsaved; /* finished requests not reflected in the queue file yet */
+	gint64 photos_saved_stamp;
+	gdouble photos_tokens;
+	gint64 photos_tokens_stamp;
+
+	/* thin GAL mode */
+	GMutex thin_gal_lock;
+	EwsOabIndex *thin_gal_index;
+	EwsOabDecoder *thin_gal_decoder;
 };
 
 G_DEFINE_TYPE (EBookBackendEws, e_book_backend_ews, E_TYPE_BOOK_META_BACKEND)
@@ -267,6 +324,56 @@ ebb_ews_get_collection_settings (EBookBackendEws *bbews)
 	return CAMEL_EWS_SETTINGS (settings);
 }
 
+/* The cnc_lock guards only the connection swap; the operations work
+   with their own reference, thus they can run in parallel, even when
+   the connection is replaced or unset meanwhile */
+static EEwsConnection *
+ebb_ews_ref_connection (EBookBackendEws *bbews)
+{
+	EEwsConnection *cnc = NULL;
+
+	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (bbews), NULL);
+
+	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+
+	if (bbews->priv->cnc)
+		cnc = g_object_ref (bbews->priv->cnc);
+
+	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+
+	return cnc;
+}
+
+/* Like ebb_ews_ref_connection(), only sets the 'error' when not connected */
+static EEwsConnection *
+ebb_ews_ref_connection_sync (EBookBackendEws *bbews,
+			     GError **error)
+{
+	EEwsConnection *cnc;
+
+	cnc = ebb_ews_ref_connection (bbews);
+
+	if (!cnc)
+		g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_REPOSITORY_OFFLINE, NULL));
+
+	return cnc;
+}
+
+/* The folder id is replaced on connect, thus the operations use a copy */
+static gchar *
+ebb_ews_dup_folder_id (EBookBackendEws *bbews)
+{
+	gchar *folder_id;
+
+	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (bbews), NULL);
+
+	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+	folder_id = g_strdup (bbews->priv->folder_id);
+	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+
+	return folder_id;
+}
+
 static void
 ebb_ews_convert_error_to_client_error (GError **perror)
 {
@@ -464,107 +571,6 @@ ebews_populate_anniversary (EBookBackendEws *bbews,
 	}
 }
 
-static EContactPhoto *
-get_photo (EBookBackendEws *bbews,
-	   EEwsItem *item,
-	   GCancellable *cancellable,
-	   GError **error)
-{
-	EContactPhoto *photo = NULL;
-	EEwsAdditionalProps *add_props = NULL;
-	EEwsAttachmentInfo *info;
-	GSList *contact_item_ids = NULL, *new_items = NULL;
-	GSList *attachments = NULL,  *attachments_ids = NULL;
-	const guchar *content;
-	const gchar *contact_photo_id;
-	const EwsId *id;
-	gsize len;
-
-	id = e_ews_item_get_id (item);
-	if (!id)
-		return NULL;
-
-	add_props = e_ews_additional_props_new ();
-	add_props->field_uri = g_strdup ("item:Attachments");
-
-	contact_item_ids = g_slist_prepend (contact_item_ids, g_strdup (id->id));
-	if (!e_ews_connection_get_items_sync (
-			bbews->priv->cnc,
-			EWS_PRIORITY_MEDIUM,
-			contact_item_ids,
-			"IdOnly",
-			add_props,
-			FALSE,
-			NULL,
-			E_EWS_BODY_TYPE_TEXT,
-			&new_items,
-			NULL,
-			NULL,
-			cancellable,
-			error))
-		goto exit;
-
-	contact_photo_id = e_ews_item_get_contact_photo_id (new_items->data);
-	if (!contact_photo_id)
-		goto exit;
-
-	attachments_ids = g_slist_prepend (attachments_ids, g_strdup (contact_photo_id));
-	if (!e_ews_connection_get_attachments_sync (
-		bbews->priv->cnc,
-		EWS_PRIORITY_MEDIUM,
-		NULL,
-		attachments_ids,
-		NULL,
-		FALSE,
-		&attachments,
-		NULL,
-		NULL,
-		cancellable,
-		error))
-		goto exit;
-
-	info = attachments->data;
-	content = (guchar *) e_ews_attachment_info_get_inlined_data (info, &len);
-
-	photo = e_contact_photo_new ();
-	photo->type = E_CONTACT_PHOTO_TYPE_INLINED;
-	e_contact_photo_set_inlined (photo, content, len);
-
-exit:
-	e_ews_additional_props_free (add_props);
-	g_slist_free_full (contact_item_ids, g_free);
-	g_slist_free_full (new_items, g_object_unref);
-	g_slist_free_full (attachments_ids, g_free);
-	g_slist_free_full (attachments, (GDestroyNotify) e_ews_attachment_info_free);
-
-	return photo;
-}
-
-static void
-ebews_populate_photo (EBookBackendEws *bbews,
-		      EContact *contact,
-		      EEwsItem *item,
-		      GCancellable *cancellable,
-		      GError **error)
-{
-	EContactPhoto *photo;
-
-	/*
-	 * Support for ContactPhoto was added in Exchange 2010 SP2.
-	 * We don't want to try to set/get this property if we are running in older version of the server.
-	 */
-	if (!e_ews_connection_satisfies_server_version (bbews->priv->cnc, E_EWS_EXCHANGE_2010_SP2))
-		return;
-
-	photo = get_photo (bbews, item, cancellable, error);
-	if (!photo) {
-		return;
-	}
-
-	e_contact_set (contact, E_CONTACT_PHOTO, photo);
-	e_contact_photo_free (photo);
-}
-
 static void
 set_phone_number (EContact *contact,
                   EContactField field,
@@ -1044,12 +1050,17 @@ set_photo (EBookBackendEws *bbews,
 	   GCancellable *cancellable,
 	   GError **error)
 {
+	EEwsConnection *cnc;
 	EEwsAttachmentInfo *info;
 	EwsId *id = NULL;
 	GSList *files = NULL;
 	const guchar *data;
 	gsize len;
 
+	cnc = ebb_ews_ref_connection_sync (bbews, error);
+	if (!cnc)
+		return;
+
 	if (!item_id) {
 		id = g_new0 (EwsId, 1);
 		id->id = e_contact_get (contact, E_CONTACT_UID);
@@ -1070,7 +1081,7 @@ set_photo (EBookBackendEws *bbews,
 	files = g_slist_append (files, info);
 
 	e_ews_connection_create_attachments_sync (
-			bbews->priv->cnc,
+			cnc,
 			EWS_PRIORITY_MEDIUM,
 			item_id,
 			files,
@@ -1087,6 +1098,7 @@ set_photo (EBookBackendEws *bbews,
 	}
 
 	g_slist_free_full (files, (GDestroyNotify) e_ews_attachment_info_free);
+	g_object_unref (cnc);
 }
 
 static gboolean
@@ -1158,6 +1170,7 @@ ebews_set_photo_changes (EBookBackendEws *bbews,
 			 GCancellable *cancellable,
 			 GError **error)
 {
+	EEwsConnection *cnc;
 	EContactPhoto *new_photo = NULL;
 	EEwsAdditionalProps *add_props = NULL;
 	GSList *contact_item_ids = NULL, *new_items = NULL, *attachments_ids = NULL;
@@ -1169,18 +1182,23 @@ ebews_set_photo_changes (EBookBackendEws *bbews,
 	 * Support for ContactPhoto was added in Exchange 2010 SP2.
 	 * We don't want to try to set/get this property if we are running in older version of the server.
 	 */
-	if (!e_ews_connection_satisfies_server_version (bbews->priv->cnc, E_EWS_EXCHANGE_2010_SP2)) {
+	cnc = ebb_ews_ref_connection (bbews);
+	if (!cnc || !e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010_SP2)) {
+		g_clear_object (&cnc);
 		return;
 	}
 
 	if (message) {
 		/* Photo changes can be done only in pre-flight stage,
 		   because it modifies ChangeKey */
+		g_object_unref (cnc);
 		return;
 	}
 
-	if (!ebb_ews_photo_changed (E_BOOK_META_BACKEND (bbews), old, new, cancellable))
+	if (!ebb_ews_photo_changed (E_BOOK_META_BACKEND (bbews), old, new, cancellable)) {
+		g_object_unref (cnc);
 		return;
+	}
 
 	new_photo = e_contact_get (new, E_CONTACT_PHOTO);
 	id = e_contact_get (old, E_CONTACT_UID);
@@ -1190,7 +1208,7 @@ ebews_set_photo_changes (EBookBackendEws *bbews,
 
 	contact_item_ids = g_slist_append (contact_item_ids, id);
 	if (!e_ews_connection_get_items_sync (
-			bbews->priv->cnc,
+			cnc,
 			EWS_PRIORITY_MEDIUM,
 			contact_item_ids,
 			"IdOnly",
@@ -1209,7 +1227,7 @@ ebews_set_photo_changes (EBookBackendEws *bbews,
 	if (contact_photo_id) {
 		attachments_ids = g_slist_prepend (attachments_ids, g_strdup (contact_photo_id));
 		if (!e_ews_connection_delete_attachments_sync (
-					bbews->priv->cnc,
+					cnc,
 					EWS_PRIORITY_MEDIUM,
 					attachments_ids,
 					&new_change_key,
@@ -1249,6 +1267,7 @@ ebews_set_photo_changes (EBookBackendEws *bbews,
 	g_slist_free_full (contact_item_ids, g_free);
 	g_slist_free_full (new_items, g_object_unref);
 	g_slist_free_full (attachments_ids, g_free);
+	g_object_unref (cnc);
 
 	if (new_change_key && out_new_change_key)
 		*out_new_change_key = new_change_key;
@@ -1529,7 +1548,8 @@ static const struct field_element_mapping {
 	{ E_CONTACT_FAMILY_NAME, ELEMENT_TYPE_SIMPLE, "Surname", e_ews_item_get_surname},
 	{ E_CONTACT_GIVEN_NAME, ELEMENT_TYPE_COMPLEX, "GivenName", NULL, ebews_populate_givenname, ebews_set_givenname, ebews_set_givenname_changes},
 	{ E_CONTACT_BIRTH_DATE, ELEMENT_TYPE_COMPLEX, "WeddingAnniversary", NULL,  ebews_populate_anniversary, ebews_set_anniversary, ebews_set_anniversary_changes },
-	{ E_CONTACT_PHOTO, ELEMENT_TYPE_COMPLEX, "Photo", NULL,  ebews_populate_photo, ebews_set_photo, ebews_set_photo_changes },
+	/* Photos are downloaded in batches by ebb_ews_fetch_contact_photos_sync() */
+	{ E_CONTACT_PHOTO, ELEMENT_TYPE_COMPLEX, "Photo", NULL,  NULL, ebews_set_photo, ebews_set_photo_changes },
 
 	/* Should take of uid and changekey (REV) */
 	{ E_CONTACT_UID, ELEMENT_TYPE_COMPLEX, "ItemId", NULL,  ebews_populate_uid, ebews_set_item_id},
@@ -1769,7 +1789,7 @@ ebb_ews_item_to_contact (EBookBackendEws *bbews,
 
 			if (val != NULL)
 				e_contact_set (contact, mappings[ii].field_id, val);
-		} else {
+		} else if (mappings[ii].populate_contact_func) {
 			mappings[ii].populate_contact_func (bbews, contact, item, cancellable, error);
 		}
 	}
@@ -1777,213 +1797,998 @@ ebb_ews_item_to_contact (EBookBackendEws *bbews,
 	return contact;
 }
 
+typedef struct _ContactPhotoData {
+	EContact *contact; /* not referenced */
+	gchar *item_id;
+	gchar *attachment_id;
+	gchar *stamp;
+} ContactPhotoData;
+
 static void
-ebb_ews_items_to_contacts (EBookBackendEws *bbews,
-			   const GSList *new_items,
-			   GSList **contacts,
-			   GCancellable *cancellable,
-			   GError **error)
+contact_photo_data_free (gpointer ptr)
 {
-	GSList *link;
-
-	for (link = (GSList *) new_items; link; link = g_slist_next (link)) {
-		EContact *contact;
-		EEwsItem *item = link->data;
-		EVCardAttribute *attr;
-
-		if (e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR)
-			continue;
-
-		contact = ebb_ews_item_to_contact (bbews, item, FALSE, cancellable, error);
-
-		attr = e_vcard_attribute_new (NULL, "X-EWS-KIND");
-		e_vcard_add_attribute_with_value (E_VCARD (contact), attr, "DT_MAILUSER");
+	ContactPhotoData *cpd = ptr;
 
-		*contacts = g_slist_prepend (*contacts, contact);
+	if (cpd) {
+		g_free (cpd->item_id);
+		g_free (cpd->attachment_id);
+		g_free (cpd->stamp);
+		g_free (cpd);
 	}
 }
 
 static void
-ebb_ews_mailbox_to_contact (EBookBackendEws *bbews,
-			    EContact **contact,
-			    GHashTable *values,
-			    const EwsMailbox *mb)
+ebb_ews_set_contact_photo_file (EContact *contact,
+				const gchar *filename)
 {
-	CamelInternetAddress *addr;
-	gchar *value;
+	EContactPhoto *photo;
+	gchar *uri;
 
-	if (!mb->name && !mb->email)
+	uri = g_filename_to_uri (filename, NULL, NULL);
+	if (!uri)
 		return;
 
-	addr = camel_internet_address_new ();
-
-	camel_internet_address_add (addr, mb->name, mb->email ? mb->email : "");
-	value = camel_address_encode (CAMEL_ADDRESS (addr));
-
-	if (value && (!values || g_hash_table_lookup (values, value) == NULL)) {
-		EVCardAttribute *attr;
+	photo = e_contact_photo_new ();
+	photo->type = E_CONTACT_PHOTO_TYPE_URI;
+	e_contact_photo_set_uri (photo, uri);
 
-		attr = e_vcard_attribute_new (NULL, EVC_EMAIL);
-		e_vcard_attribute_add_value (attr, value);
-		e_vcard_append_attribute (E_VCARD (*contact), attr);
+	e_contact_set (contact, E_CONTACT_PHOTO, photo);
 
-		if (values)
-			g_hash_table_insert (values, g_strdup (value), GINT_TO_POINTER (1));
-	} else {
-		g_free (value);
-	}
+	e_contact_photo_free (photo);
+	g_free (uri);
+}
 
-	g_object_unref (addr);
+static gchar *
+ebb_ews_dup_contact_photo_key (const ContactPhotoData *cpd)
+{
+	return g_strconcat (EBB_EWS_CONTACT_PHOTO_KEY_PREFIX, cpd->item_id, NULL);
 }
 
+/* Uses the already stored photo, when its stamp did not change */
 static gboolean
-ebb_ews_traverse_dl (EBookBackendEws *bbews,
-		     EContact **contact,
-		     GHashTable *items,
-		     GHashTable *values,
-		     EwsMailbox *mb,
-		     GCancellable *cancellable,
-		     GError **error)
+ebb_ews_contact_photo_from_store (EBookBackendEws *bbews,
+				  EBookCache *book_cache,
+				  ContactPhotoData *cpd)
 {
-	if (g_strcmp0 (mb->mailbox_type, "PrivateDL") == 0 ||
-	    g_strcmp0 (mb->mailbox_type, "PublicDL") == 0) {
-		GSList *members = NULL, *l;
-		gboolean includes_last;
-		gboolean ret = FALSE;
-		const gchar *ident;
-		GError *local_error = NULL;
-
-		if (mb->item_id && mb->item_id->id)
-			ident = mb->item_id->id;
-		else if (mb->email)
-			ident = mb->email;
-		else
-			return FALSE;
+	gchar *key, *value, *tab;
+	gboolean found = FALSE;
 
-		if (g_hash_table_lookup (items, ident) != NULL)
-			return TRUE;
+	if (!cpd->stamp || !book_cache)
+		return FALSE;
 
-		g_hash_table_insert (items, g_strdup (ident), GINT_TO_POINTER (1));
+	key = ebb_ews_dup_contact_photo_key (cpd);
+	value = e_cache_dup_key (E_CACHE (book_cache), key, NULL);
+	tab = value ? strchr (value, '\t') : NULL;
 
-		ret = e_ews_connection_expand_dl_sync (
-			bbews->priv->cnc,
-			EWS_PRIORITY_MEDIUM,
-			mb,
-			&members,
-			&includes_last,
-			cancellable,
-			&local_error);
+	if (tab) {
+		*tab = '\0';
 
-		if (!ret) {
-			if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_NAMERESOLUTIONNORESULTS)) {
-				g_clear_error (&local_error);
-				if (mb->email && *mb->email)
-					ebb_ews_mailbox_to_contact (bbews, contact, values, mb);
+		if (g_strcmp0 (value, cpd->stamp) == 0) {
+			gchar *filename;
 
-				ret = TRUE;
-				members = NULL;
-			} else {
-				if (local_error)
-					g_propagate_error (error, local_error);
+			filename = g_build_filename (bbews->priv->photos_dir, tab + 1, NULL);
 
-				return FALSE;
+			if (g_file_test (filename, G_FILE_TEST_IS_REGULAR)) {
+				ebb_ews_set_contact_photo_file (cpd->contact, filename);
+				found = TRUE;
 			}
-		}
 
-		for (l = members; l; l = l->next) {
-			ret = ebb_ews_traverse_dl (bbews, contact, items, values, l->data, cancellable, error);
-			if (!ret)
-				break;
+			g_free (filename);
 		}
+	}
 
-		g_slist_free_full (members, (GDestroyNotify) e_ews_mailbox_free);
-		return ret;
-	} else {
-		ebb_ews_mailbox_to_contact (bbews, contact, values, mb);
+	g_free (value);
+	g_free (key);
 
-		return TRUE;
-	}
+	return found;
 }
 
-static EContact *
-ebb_ews_get_dl_info (EBookBackendEws *bbews,
-		     EEwsItem *item,
-		     const EwsId *id,
-		     const gchar *d_name,
-		     GSList *members,
-		     GCancellable *cancellable,
-		     GError **error)
+static void
+ebb_ews_contact_photo_store (EBookBackendEws *bbews,
+			     EBookCache *book_cache,
+			     ContactPhotoData *cpd,
+			     const guchar *data,
+			     gsize len)
 {
-	GHashTable *items, *values;
-	GSList *l;
-	EContact *contact;
+	gchar *checksum, *filename;
+	GError *local_error = NULL;
 
-	contact = e_contact_new ();
-	e_contact_set (contact, E_CONTACT_UID, id->id);
-	e_vcard_util_set_x_attribute (E_VCARD (contact), X_EWS_CHANGEKEY, id->change_key);
-	ebews_populate_rev (contact, item);
+	if (!data || !len)
+		return;
 
-	e_contact_set (contact, E_CONTACT_IS_LIST, GINT_TO_POINTER (TRUE));
-	e_contact_set (contact, E_CONTACT_LIST_SHOW_ADDRESSES, GINT_TO_POINTER (TRUE));
-	e_contact_set (contact, E_CONTACT_FULL_NAME, d_name);
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, data, len);
+	filename = g_build_filename (bbews->priv->photos_dir, checksum, NULL);
 
-	items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	/* The same photo is stored only once */
+	if (g_file_test (filename, G_FILE_TEST_IS_REGULAR) ||
+	    g_file_set_contents (filename, (const gchar *) data, len, &local_error)) {
+		ebb_ews_set_contact_photo_file (cpd->contact, filename);
 
-	for (l = members; l != NULL; l = l->next) {
-		if (!ebb_ews_traverse_dl (bbews, &contact, items, values, l->data, cancellable, error)) {
-			g_object_unref (contact);
-			contact = NULL;
-			goto exit;
+		if (cpd->stamp && book_cache) {
+			gchar *key, *value;
+
+			key = ebb_ews_dup_contact_photo_key (cpd);
+			value = g_strconcat (cpd->stamp, "\t", checksum, NULL);
+
+			e_cache_set_key (E_CACHE (book_cache), key, value, NULL);
+
+			g_free (value);
+			g_free (key);
 		}
+	} else {
+		g_warning ("%s: Failed to store '%s': %s", G_STRFUNC, filename, local_error ? local_error->message : "Unknown error");
+		g_clear_error (&local_error);
 	}
 
- exit:
-	g_hash_table_destroy (items);
-	g_hash_table_destroy (values);
+	g_free (checksum);
+	g_free (filename);
+}
 
-	return contact;
+static void
+ebb_ews_forget_contact_photo (EBookCache *book_cache,
+			      const gchar *item_id)
+{
+	gchar *key;
+
+	key = g_strconcat (EBB_EWS_CONTACT_PHOTO_KEY_PREFIX, item_id, NULL);
+	e_cache_set_key (E_CACHE (book_cache), key, NULL, NULL);
+	g_free (key);
 }
 
+typedef struct _CollectPhotosData {
+	GHashTable *checksums; /* gchar * ~> NULL; the photos in use */
+	GSList *orphan_keys; /* gchar *; keys of contacts no longer in the cache */
+} CollectPhotosData;
+
 static gboolean
-ebb_ews_get_dl_info_gal (EBookBackendEws *bbews,
-			 EContact *contact,
-			 EwsMailbox *mb,
-			 GCancellable *cancellable,
-			 GError **error)
+ebb_ews_collect_photos_cb (ECache *cache,
+			   gint ncols,
+			   const gchar *column_names[],
+			   const gchar *column_values[],
+			   gpointer user_data)
 {
-	GHashTable *items, *values;
-	gboolean success;
+	CollectPhotosData *cpdata = user_data;
+	const gchar *tab;
 
-	items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	if (ncols != 3 || !column_values[0])
+		return TRUE;
 
-	success = ebb_ews_traverse_dl (bbews, &contact, items, values, mb, cancellable, error);
+	if (!column_values[2]) {
+		cpdata->orphan_keys = g_slist_prepend (cpdata->orphan_keys, g_strdup (column_values[0]));
+	} else {
+		tab = column_values[1] ? strchr (column_values[1], '\t') : NULL;
 
-	if (success) {
-		e_contact_set (contact, E_CONTACT_IS_LIST, GINT_TO_POINTER (TRUE));
-		e_contact_set (contact, E_CONTACT_LIST_SHOW_ADDRESSES, GINT_TO_POINTER (TRUE));
+		if (tab && tab[1])
+			g_hash_table_add (cpdata->checksums, g_strdup (tab + 1));
 	}
 
-	g_hash_table_destroy (items);
-	g_hash_table_destroy (values);
-
-	return success;
+	return TRUE;
 }
 
-static gboolean
-ebb_ews_contacts_append_dl (EBookBackendEws *bbews,
-			    EEwsItem *item,
-			    const EwsId *id,
-			    const gchar *d_name,
-			    GSList *members,
-			    GSList **contacts,
-			    GCancellable *cancellable,
-			    GError **error)
+/* The photos are shared between the contacts, thus they are not removed
+   together with the contacts. Instead, the photo keys of the contacts, which
+   are no longer in the cache, are removed, and then the stored photos, which
+   are not referenced by any key. */
+static void
+ebb_ews_collect_contact_photos (EBookBackendEws *bbews,
+				EBookCache *book_cache,
+				GCancellable *cancellable)
 {
-	EContact *contact;
-	EVCardAttribute *attr;
-
+	CollectPhotosData cpdata;
+	GDir *dir;
+	GSList *link;
+	gchar *stmt;
+	gint64 recent;
+	GError *local_error = NULL;
+
+	cpdata.checksums = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	cpdata.orphan_keys = NULL;
+
+	/* The first column is the key as used by e_cache_set_key() */
+	stmt = e_cache_sqlite_stmt_printf (
+		"SELECT substr(k.key,%d), k.value, o." E_CACHE_COLUMN_UID
+		" FROM " E_CACHE_TABLE_KEYS " AS k"
+		" LEFT JOIN " E_CACHE_TABLE_OBJECTS " AS o ON o." E_CACHE_COLUMN_UID "=substr(k.key,%d)"
+		" WHERE k.key LIKE '" E_CACHE_USER_KEY_PREFIX EBB_EWS_CONTACT_PHOTO_KEY_PREFIX "%%'",
+		(gint) strlen (E_CACHE_USER_KEY_PREFIX) + 1,
+		(gint) strlen (E_CACHE_USER_KEY_PREFIX EBB_EWS_CONTACT_PHOTO_KEY_PREFIX) + 1);
+
+	if (!e_cache_sqlite_select (E_CACHE (book_cache), stmt, ebb_ews_collect_photos_cb, &cpdata, cancellable, &local_error)) {
+		if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+			g_warning ("%s: Failed to read photo keys: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+
+		e_cache_sqlite_stmt_free (stmt);
+		g_hash_table_destroy (cpdata.checksums);
+		g_slist_free_full (cpdata.orphan_keys, g_free);
+		g_clear_error (&local_error);
+
+		return;
+	}
+
+	e_cache_sqlite_stmt_free (stmt);
+
+	for (link = cpdata.orphan_keys; link; link = g_slist_next (link)) {
+		e_cache_set_key (E_CACHE (book_cache), link->data, NULL, NULL);
+	}
+
+	/* Photos stored meanwhile by load_contact_sync() can be
+	   without the contact in the cache yet, thus skip them */
+	recent = (g_get_real_time () / G_USEC_PER_SEC) - 60 * 60;
+
+	dir = g_dir_open (bbews->priv->photos_dir, 0, NULL);
+
+	if (dir) {
+		const gchar *name;
+
+		while (name = g_dir_read_name (dir), name && !g_cancellable_is_cancelled (cancellable)) {
+			gchar *filename;
+			GStatBuf st;
+
+			if (g_hash_table_contains (cpdata.checksums, name))
+				continue;
+
+			filename = g_build_filename (bbews->priv->photos_dir, name, NULL);
+
+			if (g_stat (filename, &st) == 0 && st.st_mtime < recent)
+				g_unlink (filename);
+
+			g_free (filename);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_hash_table_destroy (cpdata.checksums);
+	g_slist_free_full (cpdata.orphan_keys, g_free);
+}
+
+static void
+ebb_ews_download_contact_photos (EBookBackendEws *bbews,
+				 EBookCache *book_cache,
+				 GSList *chunk, /* ContactPhotoData * */
+				 GCancellable *cancellable)
+{
+	EEwsConnection *cnc;
+	GSList *ids = NULL, *attachments = NULL, *link, *alink;
+	gboolean success;
+
+	cnc = ebb_ews_ref_connection (bbews);
+	if (!cnc)
+		return;
+
+	for (link = chunk; link; link = g_slist_next (link)) {
+		ContactPhotoData *cpd = link->data;
+
+		ids = g_slist_prepend (ids, g_strdup (cpd->attachment_id));
+	}
+
+	ids = g_slist_reverse (ids);
+
+	success = e_ews_connection_get_attachments_sync (cnc, EWS_PRIORITY_MEDIUM, NULL, ids, NULL, FALSE,
+		&attachments, NULL, NULL, cancellable, NULL);
+
+	/* The attachments are returned in the order of the requested IDs */
+	if (success && g_slist_length (attachments) == g_slist_length (chunk)) {
+		for (link = chunk, alink = attachments; link && alink; link = g_slist_next (link), alink = g_slist_next (alink)) {
+			const gchar *content;
+			gsize len = 0;
+
+			content = e_ews_attachment_info_get_inlined_data (alink->data, &len);
+
+			ebb_ews_contact_photo_store (bbews, book_cache, link->data, (const guchar *) content, len);
+		}
+	} else if (chunk->next && !g_cancellable_is_cancelled (cancellable)) {
+		/* One broken attachment fails the whole request, thus try one by one */
+		for (link = chunk; link && !g_cancellable_is_cancelled (cancellable); link = g_slist_next (link)) {
+			GSList *single;
+
+			single = g_slist_prepend (NULL, link->data);
+
+			ebb_ews_download_contact_photos (bbews, book_cache, single, cancellable);
+
+			g_slist_free (single);
+		}
+	}
+
+	g_slist_free_full (attachments, (GDestroyNotify) e_ews_attachment_info_free);
+	g_slist_free_full (ids, g_free);
+	g_object_unref (cnc);
+}
+
+/* Photos are not essential, thus any errors, except of the cancellation, are ignored */
+static gboolean
+ebb_ews_fetch_contact_photos_sync (EBookBackendEws *bbews,
+				   GSList *photos, /* ContactPhotoData * */
+				   GCancellable *cancellable,
+				   GError **error)
+{
+	EBookCache *book_cache;
+	GSList *chunk = NULL, *link;
+	gint count = 0;
+
+	if (!photos)
+		return TRUE;
+
+	g_mkdir_with_parents (bbews->priv->photos_dir, 0700);
+
+	book_cache = e_book_meta_backend_ref_cache (E_BOOK_META_BACKEND (bbews));
+
+	for (link = photos; link && !g_cancellable_is_cancelled (cancellable); link = g_slist_next (link)) {
+		ContactPhotoData *cpd = link->data;
+
+		if (ebb_ews_contact_photo_from_store (bbews, book_cache, cpd))
+			continue;
+
+		chunk = g_slist_prepend (chunk, cpd);
+		count++;
+
+		if (count >= EBB_EWS_CONTACT_PHOTOS_BATCH) {
+			chunk = g_slist_reverse (chunk);
+
+			ebb_ews_download_contact_photos (bbews, book_cache, chunk, cancellable);
+
+			g_slist_free (chunk);
+			chunk = NULL;
+			count = 0;
+		}
+	}
+
+	if (chunk && !g_cancellable_is_cancelled (cancellable)) {
+		chunk = g_slist_reverse (chunk);
+
+		ebb_ews_download_contact_photos (bbews, book_cache, chunk, cancellable);
+	}
+
+	g_slist_free (chunk);
+	g_clear_object (&book_cache);
+
+	return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+static gboolean
+ebb_ews_items_to_contacts (EBookBackendEws *bbews,
+			   const GSList *new_items,
+			   GSList **contacts,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	EEwsConnection *cnc;
+	EBookCache *book_cache;
+	GSList *link, *photos = NULL;
+	gboolean with_photos;
+	gboolean success;
+
+	/*
+	 * Support for ContactPhoto was added in Exchange 2010 SP2.
+	 * We don't want to try to set/get this property if we are running in older version of the server.
+	 */
+	cnc = ebb_ews_ref_connection (bbews);
+	with_photos = cnc && e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010_SP2);
+	g_clear_object (&cnc);
+
+	book_cache = with_photos ? e_book_meta_backend_ref_cache (E_BOOK_META_BACKEND (bbews)) : NULL;
+
+	for (link = (GSList *) new_items; link; link = g_slist_next (link)) {
+		EContact *contact;
+		EEwsItem *item = link->data;
+		EVCardAttribute *attr;
+		const gchar *photo_id;
+
+		if (e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR)
+			continue;
+
+		contact = ebb_ews_item_to_contact (bbews, item, FALSE, cancellable, error);
+
+		attr = e_vcard_attribute_new (NULL, "X-EWS-KIND");
+		e_vcard_add_attribute_with_value (E_VCARD (contact), attr, "DT_MAILUSER");
+
+		photo_id = with_photos ? e_ews_item_get_contact_photo_id (item) : NULL;
+		if (photo_id && e_ews_item_get_id (item)) {
+			ContactPhotoData *cpd;
+
+			cpd = g_new0 (ContactPhotoData, 1);
+			cpd->contact = contact;
+			cpd->item_id = g_strdup (e_ews_item_get_id (item)->id);
+			cpd->attachment_id = g_strdup (photo_id);
+			cpd->stamp = g_strdup (e_ews_item_get_contact_photo_stamp (item));
+
+			photos = g_slist_prepend (photos, cpd);
+		} else if (book_cache && e_ews_item_get_id (item)) {
+			/* The photo had been removed, thus do not keep it */
+			ebb_ews_forget_contact_photo (book_cache, e_ews_item_get_id (item)->id);
+		}
+
+		*contacts = g_slist_prepend (*contacts, contact);
+	}
+
+	g_clear_object (&book_cache);
+
+	photos = g_slist_reverse (photos);
+
+	success = ebb_ews_fetch_contact_photos_sync (bbews, photos, cancellable, error);
+
+	g_slist_free_full (photos, contact_photo_data_free);
+
+	return success;
+}
+
+static void
+ebb_ews_mailbox_to_contact (EBookBackendEws *bbews,
+			    EContact **contact,
+			    GHashTable *values,
+			    const EwsMailbox *mb)
+{
+	CamelInternetAddress *addr;
+	gchar *value;
+
+	if (!mb->name && !mb->email)
+		return;
+
+	addr = camel_internet_address_new ();
+
+	camel_internet_address_add (addr, mb->name, mb->email ? mb->email : "");
+	value = camel_address_encode (CAMEL_ADDRESS (addr));
+
+	if (value && (!values || g_hash_table_lookup (values, value) == NULL)) {
+		EVCardAttribute *attr;
+
+		attr = e_vcard_attribute_new (NULL, EVC_EMAIL);
+		e_vcard_attribute_add_value (attr, value);
+		e_vcard_append_attribute (E_VCARD (*contact), attr);
+
+		if (values)
+			g_hash_table_insert (values, g_strdup (value), GINT_TO_POINTER (1));
+	} else {
+		g_free (value);
+	}
+
+	g_object_unref (addr);
+}
+
+typedef struct _EwsDLExpansion {
+	EBookBackendEws *bbews;
+	EEwsConnection *cnc;
+	EBookCache *book_cache;
+	GHashTable *members; /* gchar *ident ~> GSList *members (EwsMailbox *) */
+	guint n_pending;
+	GError *error;
+} EwsDLExpansion;
+
+typedef struct _EwsDLExpandRequest {
+	EwsDLExpansion *expansion;
+	gchar *ident;
+	gchar *change_key;
+} EwsDLExpandRequest;
+
+static gboolean
+ebb_ews_mailbox_is_dl (const EwsMailbox *mb)
+{
+	return g_strcmp0 (mb->mailbox_type, "PrivateDL") == 0 ||
+	       g_strcmp0 (mb->mailbox_type, "PublicDL") == 0;
+}
+
+static const gchar *
+ebb_ews_dl_get_ident (const EwsMailbox *mb)
+{
+	if (mb->item_id && mb->item_id->id)
+		return mb->item_id->id;
+
+	return mb->email;
+}
+
+static const gchar *
+ebb_ews_dl_get_change_key (const EwsMailbox *mb)
+{
+	return mb->item_id ? mb->item_id->change_key : NULL;
+}
+
+static void
+ebb_ews_free_mailbox_list (gpointer ptr)
+{
+	GSList *mailboxes = ptr;
+
+	g_slist_free_full (mailboxes, (GDestroyNotify) e_ews_mailbox_free);
+}
+
+static void
+ebb_ews_dl_append_field (GString *str,
+			 const gchar *value)
+{
+	if (value) {
+		gchar *escaped;
+
+		escaped = g_strescape (value, NULL);
+		g_string_append_c (str, '+');
+		g_string_append (str, escaped);
+		g_free (escaped);
+	} else {
+		g_string_append_c (str, '-');
+	}
+}
+
+static gchar *
+ebb_ews_dl_read_field (const gchar *field)
+{
+	if (!field || *field != '+')
+		return NULL;
+
+	return g_strcompress (field + 1);
+}
+
+/* The first line is the time of the expansion and the change key of the list,
+   then one line per member with tab-separated escaped fields, where '-' stands
+   for NULL */
+static gchar *
+ebb_ews_dl_members_to_string (const gchar *change_key,
+			      const GSList *members)
+{
+	GString *str;
+	const GSList *link;
+
+	str = g_string_new (NULL);
+
+	g_string_append_printf (str, "%" G_GINT64_FORMAT "\t", g_get_real_time () / G_USEC_PER_SEC);
+	ebb_ews_dl_append_field (str, change_key);
+
+	for (link = members; link; link = g_slist_next (link)) {
+		const EwsMailbox *mb = link->data;
+
+		g_string_append_c (str, '\n');
+		ebb_ews_dl_append_field (str, mb->name);
+		g_string_append_c (str, '\t');
+		ebb_ews_dl_append_field (str, mb->email);
+		g_string_append_c (str, '\t');
+		ebb_ews_dl_append_field (str, mb->routing_type);
+		g_string_append_c (str, '\t');
+		ebb_ews_dl_append_field (str, mb->mailbox_type);
+		g_string_append_c (str, '\t');
+		ebb_ews_dl_append_field (str, mb->item_id ? mb->item_id->id : NULL);
+		g_string_append_c (str, '\t');
+		ebb_ews_dl_append_field (str, mb->item_id ? mb->item_id->change_key : NULL);
+	}
+
+	return g_string_free (str, FALSE);
+}
+
+/* Returns FALSE when the @str is expired, cannot be parsed or the list
+   changed since, as told by its @change_key */
+static gboolean
+ebb_ews_dl_members_from_string (const gchar *str,
+				const gchar *change_key,
+				GSList **out_members)
+{
+	gchar **lines, **header;
+	gchar *stored_change_key;
+	gint64 stamp, now;
+	gboolean success = TRUE;
+	gint ii;
+
+	*out_members = NULL;
+
+	lines = g_strsplit (str, "\n", -1);
+	if (!lines || !lines[0]) {
+		g_strfreev (lines);
+		return FALSE;
+	}
+
+	header = g_strsplit (lines[0], "\t", 2);
+	stamp = g_ascii_strtoll (header[0], NULL, 10);
+	stored_change_key = ebb_ews_dl_read_field (header[0] ? header[1] : NULL);
+	now = g_get_real_time () / G_USEC_PER_SEC;
+
+	if (stamp <= 0 || stamp > now || now - stamp > EBB_EWS_DL_CACHE_TTL) {
+		success = FALSE;
+	} else if (change_key && g_strcmp0 (change_key, stored_change_key) != 0) {
+		success = FALSE;
+	}
+
+	g_strfreev (header);
+	g_free (stored_change_key);
+
+	if (!success) {
+		g_strfreev (lines);
+		return FALSE;
+	}
+
+	for (ii = 1; lines[ii] && success; ii++) {
+		gchar **fields;
+
+		fields = g_strsplit (lines[ii], "\t", -1);
+
+		if (g_strv_length (fields) == 6) {
+			EwsMailbox *mb;
+
+			mb = g_new0 (EwsMailbox, 1);
+			mb->name = ebb_ews_dl_read_field (fields[0]);
+			mb->email = ebb_ews_dl_read_field (fields[1]);
+			mb->routing_type = ebb_ews_dl_read_field (fields[2]);
+			mb->mailbox_type = ebb_ews_dl_read_field (fields[3]);
+
+			if (*fields[4] == '+' || *fields[5] == '+') {
+				mb->item_id = g_new0 (EwsId, 1);
+				mb->item_id->id = ebb_ews_dl_read_field (fields[4]);
+				mb->item_id->change_key = ebb_ews_dl_read_field (fields[5]);
+			}
+
+			*out_members = g_slist_prepend (*out_members, mb);
+		} else {
+			success = FALSE;
+		}
+
+		g_strfreev (fields);
+	}
+
+	g_strfreev (lines);
+
+	if (success) {
+		*out_members = g_slist_reverse (*out_members);
+	} else {
+		ebb_ews_free_mailbox_list (*out_members);
+		*out_members = NULL;
+	}
+
+	return success;
+}
+
+static void
+ebb_ews_dl_forget_cached (EBookCache *book_cache,
+			  const gchar *ident)
+{
+	gchar *key;
+
+	key = g_strconcat (EBB_EWS_DL_CACHE_KEY_PREFIX, ident, NULL);
+	e_cache_set_key (E_CACHE (book_cache), key, NULL, NULL);
+	g_free (key);
+}
+
+/* The full refresh reads the lists again, thus forget the members of all
+   of them, including the nested lists, which are not in the cache */
+static void
+ebb_ews_dl_forget_all_cached (EBookCache *book_cache,
+			      GCancellable *cancellable)
+{
+	e_cache_sqlite_exec (E_CACHE (book_cache),
+		"DELETE FROM " E_CACHE_TABLE_KEYS " WHERE key LIKE '" E_CACHE_USER_KEY_PREFIX EBB_EWS_DL_CACHE_KEY_PREFIX "%'",
+		cancellable, NULL);
+}
+
+static EwsDLExpansion *
+ebb_ews_dl_expansion_new (EBookBackendEws *bbews)
+{
+	EwsDLExpansion *expansion;
+
+	expansion = g_new0 (EwsDLExpansion, 1);
+	expansion->bbews = bbews;
+	expansion->cnc = ebb_ews_ref_connection (bbews);
+	expansion->book_cache = e_book_meta_backend_ref_cache (E_BOOK_META_BACKEND (bbews));
+	expansion->members = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ebb_ews_free_mailbox_list);
+
+	return expansion;
+}
+
+static void
+ebb_ews_dl_expansion_free (EwsDLExpansion *expansion)
+{
+	if (!expansion)
+		return;
+
+	g_clear_object (&expansion->cnc);
+	g_clear_object (&expansion->book_cache);
+	g_hash_table_destroy (expansion->members);
+	g_clear_error (&expansion->error);
+	g_free (expansion);
+}
+
+static gboolean
+ebb_ews_dl_expansion_lookup_cached (EwsDLExpansion *expansion,
+				    const gchar *ident,
+				    const gchar *change_key)
+{
+	GSList *members = NULL;
+	gchar *key, *value;
+	gboolean found = FALSE;
+
+	if (!expansion->book_cache)
+		return FALSE;
+
+	key = g_strconcat (EBB_EWS_DL_CACHE_KEY_PREFIX, ident, NULL);
+	value = e_cache_dup_key (E_CACHE (expansion->book_cache), key, NULL);
+
+	if (value && *value) {
+		found = ebb_ews_dl_members_from_string (value, change_key, &members);
+
+		if (found)
+			g_hash_table_insert (expansion->members, g_strdup (ident), members);
+		else
+			e_cache_set_key (E_CACHE (expansion->book_cache), key, NULL, NULL);
+	}
+
+	g_free (value);
+	g_free (key);
+
+	return found;
+}
+
+static void
+ebb_ews_dl_expand_done_cb (GObject *source_object,
+			   GAsyncResult *result,
+			   gpointer user_data)
+{
+	EwsDLExpandRequest *request = user_data;
+	EwsDLExpansion *expansion = request->expansion;
+	GSList *members = NULL;
+	gboolean includes_last = TRUE;
+	GError *local_error = NULL;
+
+	if (e_ews_connection_expand_dl_finish (E_EWS_CONNECTION (source_object), result, &members, &includes_last, &local_error)) {
+		if (expansion->book_cache) {
+			gchar *key, *value;
+
+			key = g_strconcat (EBB_EWS_DL_CACHE_KEY_PREFIX, request->ident, NULL);
+			value = ebb_ews_dl_members_to_string (request->change_key, members);
+
+			e_cache_set_key (E_CACHE (expansion->book_cache), key, value, NULL);
+
+			g_free (value);
+			g_free (key);
+		}
+
+		g_hash_table_insert (expansion->members, request->ident, members);
+		request->ident = NULL;
+	} else if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_NAMERESOLUTIONNORESULTS)) {
+		/* Not expandable, the list address itself is used instead */
+		g_clear_error (&local_error);
+	} else if (!expansion->error) {
+		expansion->error = local_error;
+		local_error = NULL;
+	}
+
+	g_clear_error (&local_error);
+
+	expansion->n_pending--;
+
+	g_free (request->ident);
+	g_free (request->change_key);
+	g_free (request);
+}
+
+/* Expands all distribution lists reachable from the @mailboxes. Lists at
+   the same nesting level are expanded concurrently; every expanded list
+   is memoised immediately, thus an interrupted expansion continues where
+   it stopped the next time. */
+static gboolean
+ebb_ews_dl_expansion_prefetch (EwsDLExpansion *expansion,
+			       const GSList *mailboxes,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	GMainContext *main_context;
+	GHashTable *requested;
+	GSList *level, *link;
+
+	main_context = g_main_context_new ();
+	g_main_context_push_thread_default (main_context);
+
+	requested = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	level = g_slist_copy ((GSList *) mailboxes);
+
+	while (level && !expansion->error) {
+		GSList *level_idents = NULL, *next_level = NULL;
+
+		for (link = level; link && !expansion->error; link = g_slist_next (link)) {
+			const EwsMailbox *mb = link->data;
+			EwsDLExpandRequest *request;
+			const gchar *ident;
+			gchar *dup_ident;
+
+			if (!ebb_ews_mailbox_is_dl (mb))
+				continue;
+
+			ident = ebb_ews_dl_get_ident (mb);
+			if (!ident || g_hash_table_contains (requested, ident))
+				continue;
+
+			dup_ident = g_strdup (ident);
+			g_hash_table_add (requested, dup_ident);
+			level_idents = g_slist_prepend (level_idents, dup_ident);
+
+			if (ebb_ews_dl_expansion_lookup_cached (expansion, ident, ebb_ews_dl_get_change_key (mb)))
+				continue;
+
+			if (!expansion->cnc) {
+				expansion->error = EC_ERROR_EX (E_CLIENT_ERROR_REPOSITORY_OFFLINE, NULL);
+				break;
+			}
+
+			while (expansion->n_pending >= EBB_EWS_DL_MAX_PARALLEL)
+				g_main_context_iteration (main_context, TRUE);
+
+			request = g_new0 (EwsDLExpandRequest, 1);
+			request->expansion = expansion;
+			request->ident = g_strdup (ident);
+			request->change_key = g_strdup (ebb_ews_dl_get_change_key (mb));
+
+			expansion->n_pending++;
+
+			e_ews_connection_expand_dl (expansion->cnc, EWS_PRIORITY_MEDIUM, mb,
+				cancellable, ebb_ews_dl_expand_done_cb, request);
+		}
+
+		while (expansion->n_pending > 0)
+			g_main_context_iteration (main_context, TRUE);
+
+		/* Nested lists of this level form the next level */
+		for (link = level_idents; link; link = g_slist_next (link)) {
+			GSList *members, *mlink;
+
+			members = g_hash_table_lookup (expansion->members, link->data);
+
+			for (mlink = members; mlink; mlink = g_slist_next (mlink)) {
+				if (ebb_ews_mailbox_is_dl (mlink->data))
+					next_level = g_slist_prepend (next_level, mlink->data);
+			}
+		}
+
+		g_slist_free (level_idents);
+		g_slist_free (level);
+
+		level = g_slist_reverse (next_level);
+	}
+
+	g_slist_free (level);
+	g_hash_table_destroy (requested);
+
+	g_main_context_pop_thread_default (main_context);
+	g_main_context_unref (main_context);
+
+	if (expansion->error) {
+		g_propagate_error (error, expansion->error);
+		expansion->error = NULL;
+
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Walks the already expanded lists depth-first, to keep the order of the members */
+static gboolean
+ebb_ews_traverse_dl (EwsDLExpansion *expansion,
+		     EContact **contact,
+		     GHashTable *items,
+		     GHashTable *values,
+		     EwsMailbox *mb)
+{
+	if (ebb_ews_mailbox_is_dl (mb)) {
+		gpointer members = NULL;
+		const gchar *ident;
+		GSList *l;
+
+		ident = ebb_ews_dl_get_ident (mb);
+		if (!ident)
+			return FALSE;
+
+		if (g_hash_table_lookup (items, ident) != NULL)
+			return TRUE;
+
+		g_hash_table_insert (items, g_strdup (ident), GINT_TO_POINTER (1));
+
+		if (!g_hash_table_lookup_extended (expansion->members, ident, NULL, &members)) {
+			if (mb->email && *mb->email)
+				ebb_ews_mailbox_to_contact (expansion->bbews, contact, values, mb);
+
+			return TRUE;
+		}
+
+		for (l = members; l; l = l->next) {
+			if (!ebb_ews_traverse_dl (expansion, contact, items, values, l->data))
+				return FALSE;
+		}
+
+		return TRUE;
+	} else {
+		ebb_ews_mailbox_to_contact (expansion->bbews, contact, values, mb);
+
+		return TRUE;
+	}
+}
+
+static EContact *
+ebb_ews_get_dl_info (EBookBackendEws *bbews,
+		     EEwsItem *item,
+		     const EwsId *id,
+		     const gchar *d_name,
+		     GSList *members,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	EwsDLExpansion *expansion;
+	GHashTable *items, *values;
+	GSList *l;
+	EContact *contact;
+
+	contact = e_contact_new ();
+	e_contact_set (contact, E_CONTACT_UID, id->id);
+	e_vcard_util_set_x_attribute (E_VCARD (contact), X_EWS_CHANGEKEY, id->change_key);
+	ebews_populate_rev (contact, item);
+
+	e_contact_set (contact, E_CONTACT_IS_LIST, GINT_TO_POINTER (TRUE));
+	e_contact_set (contact, E_CONTACT_LIST_SHOW_ADDRESSES, GINT_TO_POINTER (TRUE));
+	e_contact_set (contact, E_CONTACT_FULL_NAME, d_name);
+
+	expansion = ebb_ews_dl_expansion_new (bbews);
+	items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	if (!ebb_ews_dl_expansion_prefetch (expansion, members, cancellable, error)) {
+		g_object_unref (contact);
+		contact = NULL;
+		goto exit;
+	}
+
+	for (l = members; l != NULL; l = l->next) {
+		if (!ebb_ews_traverse_dl (expansion, &contact, items, values, l->data)) {
+			g_object_unref (contact);
+			contact = NULL;
+			goto exit;
+		}
+	}
+
+ exit:
+	g_hash_table_destroy (items);
+	g_hash_table_destroy (values);
+	ebb_ews_dl_expansion_free (expansion);
+
+	return contact;
+}
+
+static gboolean
+ebb_ews_get_dl_info_gal (EBookBackendEws *bbews,
+			 EContact *contact,
+			 EwsMailbox *mb,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	EwsDLExpansion *expansion;
+	GHashTable *items, *values;
+	GSList *roots;
+	gboolean success;
+
+	expansion = ebb_ews_dl_expansion_new (bbews);
+	items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	roots = g_slist_prepend (NULL, mb);
+
+	success = ebb_ews_dl_expansion_prefetch (expansion, roots, cancellable, error) &&
+		ebb_ews_traverse_dl (expansion, &contact, items, values, mb);
+
+	g_slist_free (roots);
+
+	if (success) {
+		e_contact_set (contact, E_CONTACT_IS_LIST, GINT_TO_POINTER (TRUE));
+		e_contact_set (contact, E_CONTACT_LIST_SHOW_ADDRESSES, GINT_TO_POINTER (TRUE));
+	}
+
+	g_hash_table_destroy (items);
+	g_hash_table_destroy (values);
+	ebb_ews_dl_expansion_free (expansion);
+
+	return success;
+}
+
+static gboolean
+ebb_ews_contacts_append_dl (EBookBackendEws *bbews,
+			    EEwsItem *item,
+			    const EwsId *id,
+			    const gchar *d_name,
+			    GSList *members,
+			    GSList **contacts,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	EContact *contact;
+	EVCardAttribute *attr;
+
 	contact = ebb_ews_get_dl_info (bbews, item, id, d_name, members, cancellable, error);
 	if (contact == NULL)
 		return FALSE;
@@ -2003,10 +2808,15 @@ ebb_ews_fetch_items_sync (EBookBackendEws *bbews,
 			  GCancellable *cancellable,
 			  GError **error)
 {
+	EEwsConnection *cnc;
 	GSList *contact_item_ids = NULL, *dl_ids = NULL, *link;
 	GSList *new_items = NULL;
 	gboolean ret = FALSE;
 
+	cnc = ebb_ews_ref_connection_sync (bbews, error);
+	if (!cnc)
+		return FALSE;
+
 	for (link = (GSList *) items; link; link = g_slist_next (link)) {
 		EEwsItem *item = link->data;
 		const EwsId *id = e_ews_item_get_id (item);
@@ -2020,14 +2830,13 @@ ebb_ews_fetch_items_sync (EBookBackendEws *bbews,
 		}
 	}
 
-	/* TODO fetch attachments */
 	if (contact_item_ids) {
 		EEwsAdditionalProps *add_props;
 		add_props = e_ews_additional_props_new ();
 		add_props->field_uri = g_strdup (CONTACT_ITEM_PROPS);
 
 		ret = e_ews_connection_get_items_sync (
-			bbews->priv->cnc, EWS_PRIORITY_MEDIUM,
+			cnc, EWS_PRIORITY_MEDIUM,
 			contact_item_ids, "Default", add_props,
 			FALSE, NULL, E_EWS_BODY_TYPE_TEXT, &new_items, NULL, NULL,
 			cancellable, error);
@@ -2039,15 +2848,18 @@ ebb_ews_fetch_items_sync (EBookBackendEws *bbews,
 	}
 
 	if (new_items) {
-		ebb_ews_items_to_contacts (bbews, new_items, contacts, cancellable, error);
+		ret = ebb_ews_items_to_contacts (bbews, new_items, contacts, cancellable, error);
 
 		g_slist_free_full (new_items, g_object_unref);
 		new_items = NULL;
+
+		if (!ret)
+			goto cleanup;
 	}
 
 	/* Get the display names of the distribution lists */
 	if (dl_ids) {
-		if (!e_ews_connection_get_items_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM, dl_ids, "Default", NULL,
+		if (!e_ews_connection_get_items_sync (cnc, EWS_PRIORITY_MEDIUM, dl_ids, "Default", NULL,
 			FALSE, NULL, E_EWS_BODY_TYPE_TEXT, &new_items, NULL, NULL, cancellable, error))
 			goto cleanup;
 	}
@@ -2070,7 +2882,7 @@ ebb_ews_fetch_items_sync (EBookBackendEws *bbews,
 
 		d_name = e_ews_item_get_subject (item);
 		if (e_ews_connection_expand_dl_sync (
-			bbews->priv->cnc, EWS_PRIORITY_MEDIUM, mb, &members,
+			cnc, EWS_PRIORITY_MEDIUM, mb, &members,
 			&includes_last, cancellable, &local_error)) {
 			ret = ebb_ews_contacts_append_dl (bbews, item, id, d_name, members, contacts, cancellable, error);
 			g_slist_free_full (members, (GDestroyNotify) e_ews_mailbox_free);
@@ -2093,6 +2905,7 @@ ebb_ews_fetch_items_sync (EBookBackendEws *bbews,
 	g_slist_free_full (new_items, g_object_unref);
 	g_slist_free_full (contact_item_ids, g_free);
 	g_slist_free_full (dl_ids, g_free);
+	g_object_unref (cnc);
 
 	return ret;
 }
@@ -2140,29 +2953,42 @@ ebb_ews_server_notification_cb (EBookBackendEws *bbews,
 		e_book_meta_backend_schedule_refresh (E_BOOK_META_BACKEND (bbews));
 }
 
+/* Stops listening on a connection, which had been swapped out of the priv->cnc */
+static void
+ebb_ews_release_connection (EBookBackendEws *bbews,
+			    EEwsConnection *cnc,
+			    guint subscription_key)
+{
+	g_signal_handlers_disconnect_by_func (cnc, ebb_ews_server_notification_cb, bbews);
+
+	if (subscription_key != 0)
+		e_ews_connection_disable_notifications_sync (cnc, subscription_key);
+
+	g_object_unref (cnc);
+}
+
 static void
 ebb_ews_unset_connection (EBookBackendEws *bbews)
 {
+	EEwsConnection *cnc;
+	guint subscription_key;
+
 	g_return_if_fail (E_IS_BOOK_BACKEND_EWS (bbews));
 
 	g_rec_mutex_lock (&bbews->priv->cnc_lock);
 
-	if (bbews->priv->cnc) {
-		e_ews_connection_set_disconnected_flag (bbews->priv->cnc, TRUE);
-
-		g_signal_handlers_disconnect_by_func (bbews->priv->cnc, ebb_ews_server_notification_cb, bbews);
-
-		if (bbews->priv->subscription_key != 0) {
-			e_ews_connection_disable_notifications_sync (
-				bbews->priv->cnc,
-				bbews->priv->subscription_key);
-			bbews->priv->subscription_key = 0;
-		}
-	}
+	cnc = bbews->priv->cnc;
+	bbews->priv->cnc = NULL;
 
-	g_clear_object (&bbews->priv->cnc);
+	subscription_key = bbews->priv->subscription_key;
+	bbews->priv->subscription_key = 0;
 
 	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+
+	if (cnc) {
+		e_ews_connection_set_disconnected_flag (cnc, TRUE);
+		ebb_ews_release_connection (bbews, cnc, subscription_key);
+	}
 }
 
 static gint
@@ -2174,25 +3000,38 @@ det_sort_func (gconstpointer _a,
 	return a->seq - b->seq;
 }
 
+/* The new OAB file is written aside and moved over the current one only
+   when it is complete, because the thin GAL has the current one mapped */
+static gchar *
+ebb_ews_dup_gal_temp_filename (const gchar *oab_filename)
+{
+	return g_strconcat (oab_filename, ".tmp", NULL);
+}
+
 static gchar *
 ebb_ews_download_gal_file (EBookBackendEws *bbews,
 			   EwsOALDetails *full,
 			   GCancellable *cancellable,
 			   GError **error)
 {
-	EEwsConnection *oab_cnc;
+	EEwsConnection *cnc, *oab_cnc;
 	gchar *full_url, *oab_url;
 	gchar *download_path = NULL;
 	gchar *password;
 	CamelEwsSettings *ews_settings;
 	const gchar *cache_dir;
 
+	cnc = ebb_ews_ref_connection_sync (bbews, error);
+	if (!cnc)
+		return NULL;
+
 	ews_settings = ebb_ews_get_collection_settings (bbews);
 
 	/* oab url with oab.xml removed from the suffix */
 	oab_url = camel_ews_settings_dup_oaburl (ews_settings);
 	if (!oab_url || !*oab_url) {
 		g_free (oab_url);
+		g_object_unref (cnc);
 		return NULL;
 	}
 
@@ -2210,7 +3049,7 @@ ebb_ews_download_gal_file (EBookBackendEws *bbews,
 		oab_cnc, "proxy-resolver",
 		G_BINDING_SYNC_CREATE);
 
-	password = e_ews_connection_dup_password (bbews->priv->cnc);
+	password = e_ews_connection_dup_password (cnc);
 	e_ews_connection_set_password (oab_cnc, password);
 	g_free (password);
 
@@ -2222,6 +3061,7 @@ ebb_ews_download_gal_file (EBookBackendEws *bbews,
 	}
 
 	g_object_unref (oab_cnc);
+	g_object_unref (cnc);
 	g_free (oab_url);
 	g_free (full_url);
 
@@ -2236,7 +3076,7 @@ ebb_ews_download_full_gal (EBookBackendEws *bbews,
 {
 	ESource *source;
 	const gchar *cache_dir;
-	gchar *lzx_path, *oab_file, *oab_path;
+	gchar *lzx_path, *oab_file, *oab_path, *temp_path;
 
 	lzx_path = ebb_ews_download_gal_file (bbews, full, cancellable, error);
 	if (!lzx_path)
@@ -2247,13 +3087,18 @@ ebb_ews_download_full_gal (EBookBackendEws *bbews,
 	cache_dir = e_book_backend_get_cache_dir (E_BOOK_BACKEND (bbews));
 	oab_path = g_build_filename (cache_dir, oab_file, NULL);
 
-	if (!ews_oab_decompress_full (lzx_path, oab_path, error)) {
+	temp_path = ebb_ews_dup_gal_temp_filename (oab_path);
+
+	if (!ews_oab_decompress_full (lzx_path, temp_path, error)) {
+		g_unlink (temp_path);
 		g_free (oab_path);
 		oab_path = NULL;
 	} else {
-		d (printf ("OAL file decompressed %s\n", oab_path));
+		d (printf ("OAL file decompressed %s\n", temp_path));
 	}
 
+	g_free (temp_path);
+
 	if (lzx_path) {
 		g_unlink (lzx_path);
 		g_free (lzx_path);
@@ -2264,147 +3109,564 @@ ebb_ews_download_full_gal (EBookBackendEws *bbews,
 	return oab_path;
 }
 
+/* Returns the name, under which the OAB file is stored, once it is checked;
+   its content is in the ebb_ews_dup_gal_temp_filename() file meanwhile */
 static gchar *
 ebb_ews_download_gal (EBookBackendEws *bbews,
 		      EBookCache *book_cache,
 		      EwsOALDetails *full,
 		      GSList *deltas,
 		      guint32 seq,
+		      gboolean *out_is_delta,
 		      GCancellable *cancellable,
 		      GError **error)
 {
 #ifdef WITH_MSPACK
-	GSList *link;
+	GSList *link, *lzx_paths = NULL;
 	gchar *thisoab;
+	gboolean complete = FALSE;
+
+	*out_is_delta = FALSE;
 
 	thisoab = e_cache_dup_key (E_CACHE (book_cache), "oab-filename", NULL);
-	if (!thisoab)
+	if (!thisoab || !g_file_test (thisoab, G_FILE_TEST_IS_REGULAR))
 		goto full;
 
-	for (link = deltas; link; link = g_slist_next (link)) {
-		EwsOALDetails *det = link->data;
-		ESource *source;
-		gchar *oab_file, *lzx_path, *nextoab;
-		const gchar *cache_dir;
-		GError *local_error = NULL;
+	/* Download the whole chain first; there is no point to apply any
+	   of the patches when the chain does not lead to the full->seq */
+	for (link = deltas; link && !complete; link = g_slist_next (link)) {
+		EwsOALDetails *det = link->data;
+		gchar *lzx_path;
+
+		seq++;
+		if (det->seq != seq)
+			break;
+
+		lzx_path = ebb_ews_download_gal_file (bbews, det, cancellable, NULL);
+		if (!lzx_path)
+			break;
+
+		lzx_paths = g_slist_prepend (lzx_paths, lzx_path);
+		complete = seq == full->seq;
+	}
+
+	lzx_paths = g_slist_reverse (lzx_paths);
+
+	if (complete) {
+		ESource *source;
+		gchar *oab_file, *nextoab, *temp_path;
+		const gchar *cache_dir;
+		GError *local_error = NULL;
+
+		source = e_backend_get_source (E_BACKEND (bbews));
+		oab_file = g_strdup_printf ("%s-%d.oab", e_source_get_display_name (source), seq);
+		cache_dir = e_book_backend_get_cache_dir (E_BOOK_BACKEND (bbews));
+		nextoab = g_build_filename (cache_dir, oab_file, NULL);
+		temp_path = ebb_ews_dup_gal_temp_filename (nextoab);
+		g_free (oab_file);
+
+		/* The previous OAB file is kept, it's used to find changed records */
+		if (ews_oab_decompress_patch_chain (thisoab, lzx_paths, temp_path, &local_error)) {
+			d (printf ("Created %s from %d deltas\n", temp_path, g_slist_length (lzx_paths)));
+
+			*out_is_delta = TRUE;
+		} else {
+			d (printf ("Failed to apply incremental patches: %s\n", local_error ? local_error->message : "Unknown error"));
+
+			g_clear_error (&local_error);
+			g_unlink (temp_path);
+			g_free (nextoab);
+			nextoab = NULL;
+		}
+
+		g_free (temp_path);
+
+		for (link = lzx_paths; link; link = g_slist_next (link)) {
+			g_unlink (link->data);
+		}
+
+		g_slist_free_full (lzx_paths, g_free);
+		g_free (thisoab);
+
+		if (nextoab)
+			return nextoab;
+	} else {
+		for (link = lzx_paths; link; link = g_slist_next (link)) {
+			g_unlink (link->data);
+		}
+
+		g_slist_free_full (lzx_paths, g_free);
+		g_free (thisoab);
+	}
+
+	thisoab = NULL;
+ full:
+	g_free (thisoab);
+#else
+	*out_is_delta = FALSE;
+#endif /* WITH_MSPACK */
+	d (printf ("Ewsgal: Downloading full gal \n"));
+	return ebb_ews_download_full_gal (bbews, full, cancellable, error);
+}
+
+static gchar *
+ebb_ews_dup_gal_index_filename (const gchar *oab_filename)
+{
+	return g_strconcat (oab_filename, ".idx", NULL);
+}
+
+static void
+ebb_ews_unlink_gal_file (const gchar *filename)
+{
+	gchar *index_filename;
+
+	index_filename = ebb_ews_dup_gal_index_filename (filename);
+
+	g_unlink (filename);
+	g_unlink (index_filename);
+
+	g_free (index_filename);
+}
+
+static gboolean
+ebb_ews_fetch_gal_photo_sync (EEwsConnection *cnc,
+			      EContact *contact,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	const gchar *email;
+	gchar *photo_base64 = NULL;
+	gboolean success = FALSE;
+
+	g_return_val_if_fail (E_IS_EWS_CONNECTION (cnc), FALSE);
+	g_return_val_if_fail (E_IS_CONTACT (contact), FALSE);
+
+	email = e_contact_get_const (contact, E_CONTACT_EMAIL_1);
+	if (!email || !*email)
+		return FALSE;
+
+	if (e_ews_connection_get_user_photo_sync (cnc, EWS_PRIORITY_LOW, email,
+	    E_EWS_SIZE_REQUESTED_96X96, &photo_base64, cancellable, error) && photo_base64) {
+		guchar *bytes;
+		gsize nbytes;
+
+		bytes = g_base64_decode (photo_base64, &nbytes);
+		if (bytes && nbytes > 0) {
+			EContactPhoto *photo;
+
+			photo = e_contact_photo_new ();
+			photo->type = E_CONTACT_PHOTO_TYPE_INLINED;
+			e_contact_photo_set_inlined (photo, bytes, nbytes);
+			e_contact_set (contact, E_CONTACT_PHOTO, photo);
+			e_contact_photo_free (photo);
+
+			success = TRUE;
+		}
+
+		g_free (photo_base64);
+		g_free (bytes);
+	}
+
+	return success;
+}
+
+typedef struct _PhotoRequest {
+	gchar *uid;
+	gboolean viewed;
+	guint serial;
+} PhotoRequest;
+
+static void
+photo_request_free (gpointer ptr)
+{
+	PhotoRequest *pr = ptr;
+
+	if (pr) {
+		g_free (pr->uid);
+		g_free (pr);
+	}
+}
+
+/* Contacts the user actually looked at go first, then in the order of scheduling */
+static gint
+ebb_ews_photos_compare_requests (gconstpointer aa,
+				 gconstpointer bb,
+				 gpointer user_data)
+{
+	const PhotoRequest *pra = aa, *prb = bb;
+
+	if (pra->viewed != prb->viewed)
+		return pra->viewed ? -1 : 1;
+
+	if (pra->serial == prb->serial)
+		return 0;
+
+	return pra->serial < prb->serial ? -1 : 1;
+}
+
+static gchar *
+ebb_ews_photos_dup_queue_filename (EBookBackendEws *bbews)
+{
+	return g_build_filename (e_book_backend_get_cache_dir (E_BOOK_BACKEND (bbews)), EBB_EWS_PHOTOS_QUEUE_FILENAME, NULL);
+}
+
+/* Stores pending UID-s, including those fetched, but not stored in the cache
+   yet, thus the fetching can continue after restart; expects the photos_lock
+   being locked */
+static void
+ebb_ews_photos_save_queue_locked (EBookBackendEws *bbews)
+{
+	GString *content;
+	GHashTableIter iter;
+	GSList *link;
+	gpointer key;
+	gchar *filename;
+
+	content = g_string_new ("");
+
+	if (bbews->priv->photos_pending) {
+		g_hash_table_iter_init (&iter, bbews->priv->photos_pending);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			g_string_append (content, key);
+			g_string_append_c (content, '\n');
+		}
+	}
+
+	for (link = bbews->priv->photos_deferred; link; link = g_slist_next (link)) {
+		g_string_append (content, link->data);
+		g_string_append_c (content, '\n');
+	}
+
+	for (link = bbews->priv->photos_results; link; link = g_slist_next (link)) {
+		const EBookMetaBackendInfo *nfo = link->data;
+
+		g_string_append (content, nfo->uid);
+		g_string_append_c (content, '\n');
+	}
+
+	filename = ebb_ews_photos_dup_queue_filename (bbews);
+
+	if (content->len)
+		g_file_set_contents (filename, content->str, content->len, NULL);
+	else
+		g_unlink (filename);
+
+	bbews->priv->photos_unsaved = 0;
+	bbews->priv->photos_saved_stamp = g_get_monotonic_time ();
+
+	g_string_free (content, TRUE);
+	g_free (filename);
+}
+
+/* Finished requests are written to the queue file in batches, because it is
+   rewritten as a whole; a request finished, but not saved before a crash,
+   is only fetched again. Expects the photos_lock being locked. */
+static void
+ebb_ews_photos_queue_changed_locked (EBookBackendEws *bbews)
+{
+	bbews->priv->photos_unsaved++;
+
+	if (bbews->priv->photos_unsaved >= EBB_EWS_PHOTOS_SAVE_COUNT ||
+	    g_get_monotonic_time () - bbews->priv->photos_saved_stamp >= EBB_EWS_PHOTOS_SAVE_INTERVAL * G_USEC_PER_SEC ||
+	    (!g_hash_table_size (bbews->priv->photos_pending) && !bbews->priv->photos_deferred && !bbews->priv->photos_results))
+		ebb_ews_photos_save_queue_locked (bbews);
+}
+
+/* Waits for a token from the bucket; returns FALSE when cancelled */
+static gboolean
+ebb_ews_photos_take_token (EBookBackendEws *bbews,
+			   GCancellable *cancellable)
+{
+	gboolean have_token = FALSE;
+
+	g_mutex_lock (&bbews->priv->photos_lock);
+
+	while (!g_cancellable_is_cancelled (cancellable)) {
+		gint64 now = g_get_monotonic_time ();
+		gdouble tokens;
+
+		tokens = bbews->priv->photos_tokens +
+			EBB_EWS_PHOTOS_PER_SECOND * (now - bbews->priv->photos_tokens_stamp) / G_USEC_PER_SEC;
+
+		bbews->priv->photos_tokens = MIN (tokens, EBB_EWS_PHOTOS_BURST);
+		bbews->priv->photos_tokens_stamp = now;
+
+		if (bbews->priv->photos_tokens >= 1.0) {
+			bbews->priv->photos_tokens -= 1.0;
+			have_token = TRUE;
+			break;
+		}
+
+		g_cond_wait_until (&bbews->priv->photos_cond, &bbews->priv->photos_lock,
+			now + (gint64) ((1.0 - bbews->priv->photos_tokens) * G_USEC_PER_SEC / EBB_EWS_PHOTOS_PER_SECOND));
+	}
+
+	g_mutex_unlock (&bbews->priv->photos_lock);
+
+	return have_token;
+}
+
+static void
+ebb_ews_photos_flush (EBookBackendEws *bbews,
+		      gboolean force,
+		      GCancellable *cancellable)
+{
+	GSList *results = NULL;
+
+	g_mutex_lock (&bbews->priv->photos_lock);
+
+	if (force || !bbews->priv->photos_pool ||
+	    g_thread_pool_unprocessed (bbews->priv->photos_pool) == 0 ||
+	    g_slist_length (bbews->priv->photos_results) >= EBB_EWS_PHOTOS_FLUSH_COUNT) {
+		results = bbews->priv->photos_results;
+		bbews->priv->photos_results = NULL;
+	}
+
+	g_mutex_unlock (&bbews->priv->photos_lock);
+
+	if (results) {
+		e_book_meta_backend_process_changes_sync (E_BOOK_META_BACKEND (bbews), NULL, results, NULL, cancellable, NULL);
+		g_slist_free_full (results, e_book_meta_backend_info_free);
+
+		g_mutex_lock (&bbews->priv->photos_lock);
+		ebb_ews_photos_queue_changed_locked (bbews);
+		g_mutex_unlock (&bbews->priv->photos_lock);
+	}
+}
+
+static void
+ebb_ews_photos_thread_func (gpointer data,
+			    gpointer user_data)
+{
+	EBookBackendEws *bbews = user_data;
+	PhotoRequest *pr = data;
+	EEwsConnection *cnc = NULL;
+	EBookCache *book_cache;
+	EContact *contact = NULL;
+	GCancellable *cancellable;
+	gboolean requeue = FALSE;
+	GError *local_error = NULL;
+
+	g_mutex_lock (&bbews->priv->photos_lock);
 
-		seq++;
-		if (det->seq != seq)
-			break;
+	cancellable = bbews->priv->photos_cancellable ? g_object_ref (bbews->priv->photos_cancellable) : NULL;
 
-		lzx_path = ebb_ews_download_gal_file (bbews, det, cancellable, NULL);
-		if (!lzx_path)
-			break;
+	/* Already fetched, from a duplicate request, or the backend is going away */
+	if (g_cancellable_is_cancelled (cancellable) ||
+	    !g_hash_table_contains (bbews->priv->photos_pending, pr->uid)) {
+		g_mutex_unlock (&bbews->priv->photos_lock);
+		g_clear_object (&cancellable);
+		photo_request_free (pr);
+		return;
+	}
 
-		source = e_backend_get_source (E_BACKEND (bbews));
-		oab_file = g_strdup_printf ("%s-%d.oab", e_source_get_display_name (source), seq);
-		cache_dir = e_book_backend_get_cache_dir (E_BOOK_BACKEND (bbews));
-		nextoab = g_build_filename (cache_dir, oab_file, NULL);
-		g_free (oab_file);
+	g_mutex_unlock (&bbews->priv->photos_lock);
 
-		ews_oab_decompress_patch (lzx_path, thisoab, nextoab, &local_error);
+	book_cache = e_book_meta_backend_ref_cache (E_BOOK_META_BACKEND (bbews));
 
-		/* Free the LZX file */
-		g_unlink (lzx_path);
-		g_free (lzx_path);
+	if (!book_cache ||
+	    !e_book_cache_get_contact (book_cache, pr->uid, FALSE, &contact, cancellable, NULL) ||
+	    !contact ||
+	    e_vcard_get_attribute (E_VCARD (contact), EVC_PHOTO) ||
+	    !ebb_ews_can_check_user_photo (contact)) {
+		/* Nothing to do */
+	} else if (ebb_ews_photos_take_token (bbews, cancellable)) {
+		cnc = ebb_ews_ref_connection (bbews);
+
+		if (!cnc) {
+			requeue = TRUE;
+		} else if (!e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2013)) {
+			/* The server cannot provide user photos */
+		} else if (!ebb_ews_fetch_gal_photo_sync (cnc, contact, cancellable, &local_error) &&
+			   (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_SERVERBUSY) ||
+			    g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))) {
+			requeue = TRUE;
+
+			/* Let the server breathe; drain the bucket */
+			g_mutex_lock (&bbews->priv->photos_lock);
+			bbews->priv->photos_tokens = -EBB_EWS_PHOTOS_BURST;
+			g_mutex_unlock (&bbews->priv->photos_lock);
+		} else {
+			EBookMetaBackendInfo *nfo;
 
-		/* Free the previous OAB file */
-		g_unlink (thisoab);
-		g_free (thisoab);
+			/* Do not ask for the photo again today, when there is none */
+			if (!e_vcard_get_attribute (E_VCARD (contact), EVC_PHOTO))
+				ebb_ews_store_photo_check_date (contact, NULL);
 
-		thisoab = nextoab;
+			nfo = e_book_meta_backend_info_new (pr->uid, e_contact_get_const (contact, E_CONTACT_REV), NULL, NULL);
+			nfo->object = e_vcard_to_string (E_VCARD (contact), EVC_FORMAT_VCARD_30);
 
-		/* For once we are *allowed* to use the error instead of having to
-		 * check the return value of the function. It's our *own* error. */
-		if (local_error) {
-			d (printf ("Failed to apply incremental patch: %s\n", local_error->message));
-			g_error_free (local_error);
-			break;
+			g_mutex_lock (&bbews->priv->photos_lock);
+			bbews->priv->photos_results = g_slist_prepend (bbews->priv->photos_results, nfo);
+			g_mutex_unlock (&bbews->priv->photos_lock);
 		}
 
-		d (printf ("Created %s from delta\n", thisoab));
-
-		if (seq == full->seq)
-			return thisoab;
+		g_clear_error (&local_error);
+	} else {
+		requeue = TRUE;
 	}
 
-	if (thisoab) {
-		g_unlink (thisoab);
-		g_free (thisoab);
+	g_mutex_lock (&bbews->priv->photos_lock);
+
+	if (!requeue) {
+		g_hash_table_remove (bbews->priv->photos_pending, pr->uid);
+
+		/* Do not fetch it again after restart */
+		ebb_ews_photos_queue_changed_locked (bbews);
+	} else if (!g_cancellable_is_cancelled (cancellable) && bbews->priv->photos_pool) {
+		pr->serial = ++bbews->priv->photos_serial;
+		g_thread_pool_push (bbews->priv->photos_pool, pr, NULL);
+		pr = NULL;
 	}
- full:
-#endif /* WITH_MSPACK */
-	d (printf ("Ewsgal: Downloading full gal \n"));
-	return ebb_ews_download_full_gal (bbews, full, cancellable, error);
+
+	g_mutex_unlock (&bbews->priv->photos_lock);
+
+	if (!g_cancellable_is_cancelled (cancellable))
+		ebb_ews_photos_flush (bbews, pr && pr->viewed, cancellable);
+
+	g_clear_object (&contact);
+	g_clear_object (&book_cache);
+	g_clear_object (&cancellable);
+	photo_request_free (pr);
 }
 
+/* Adds the UID-s to the background photo fetching queue; the 'viewed'
+   contacts are fetched before anything else */
 static void
-ebb_ews_remove_old_gal_file (EBookCache *book_cache)
+ebb_ews_photos_schedule (EBookBackendEws *bbews,
+			 const GSList *uids, /* gchar * */
+			 gboolean viewed)
 {
-	gchar *filename;
+	const GSList *link;
+
+	g_return_if_fail (E_IS_BOOK_BACKEND_EWS (bbews));
 
-	g_return_if_fail (E_IS_BOOK_CACHE (book_cache));
+	if (!uids)
+		return;
 
-	filename = e_cache_dup_key (E_CACHE (book_cache), "oab-filename", NULL);
+	g_mutex_lock (&bbews->priv->photos_lock);
 
-	if (filename)
-		g_unlink (filename);
-	g_free (filename);
+	if (!bbews->priv->photos_pool) {
+		bbews->priv->photos_pool = g_thread_pool_new (ebb_ews_photos_thread_func, bbews,
+			EBB_EWS_PHOTOS_MAX_THREADS, FALSE, NULL);
+		g_thread_pool_set_sort_function (bbews->priv->photos_pool, ebb_ews_photos_compare_requests, NULL);
+
+		bbews->priv->photos_tokens = EBB_EWS_PHOTOS_BURST;
+		bbews->priv->photos_tokens_stamp = g_get_monotonic_time ();
+	}
+
+	for (link = uids; link; link = g_slist_next (link)) {
+		const gchar *uid = link->data;
+		PhotoRequest *pr;
+
+		if (!uid || !*uid)
+			continue;
+
+		/* A queued request can be only re-prioritized by a new one */
+		if (g_hash_table_contains (bbews->priv->photos_pending, uid) && !viewed)
+			continue;
+
+		g_hash_table_add (bbews->priv->photos_pending, g_strdup (uid));
+
+		pr = g_new0 (PhotoRequest, 1);
+		pr->uid = g_strdup (uid);
+		pr->viewed = viewed;
+		pr->serial = ++bbews->priv->photos_serial;
+
+		g_thread_pool_push (bbews->priv->photos_pool, pr, NULL);
+	}
+
+	if (!viewed)
+		ebb_ews_photos_save_queue_locked (bbews);
+
+	g_mutex_unlock (&bbews->priv->photos_lock);
 }
 
-static gboolean
-ebb_ews_fetch_gal_photo_sync (EBookBackendEws *bbews,
-			      EContact *contact,
-			      GCancellable *cancellable,
-			      GError **error)
+/* Continues with photo fetching interrupted by the previous run */
+static void
+ebb_ews_photos_resume (EBookBackendEws *bbews)
 {
-	const gchar *email;
-	gboolean success = FALSE;
+	gchar *filename, *content = NULL;
 
-	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (bbews), FALSE);
-	g_return_val_if_fail (E_IS_CONTACT (contact), FALSE);
+	filename = ebb_ews_photos_dup_queue_filename (bbews);
 
-	email = e_contact_get_const (contact, E_CONTACT_EMAIL_1);
-	if (!email || !*email)
-		return FALSE;
+	if (g_file_get_contents (filename, &content, NULL, NULL) && content) {
+		gchar **strv;
+		GSList *uids = NULL;
+		gint ii;
 
-	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+		strv = g_strsplit (content, "\n", -1);
 
-	if (bbews->priv->cnc) {
-		gchar *photo_base64 = NULL;
-		gboolean backoff_enabled;
+		for (ii = 0; strv && strv[ii]; ii++) {
+			if (*strv[ii])
+				uids = g_slist_prepend (uids, strv[ii]);
+		}
 
-		backoff_enabled = e_ews_connection_get_backoff_enabled (bbews->priv->cnc);
-		e_ews_connection_set_backoff_enabled (bbews->priv->cnc, FALSE);
+		uids = g_slist_reverse (uids);
 
-		if (e_ews_connection_get_user_photo_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM, email,
-		    E_EWS_SIZE_REQUESTED_96X96, &photo_base64, cancellable, error) && photo_base64) {
-			guchar *bytes;
-			gsize nbytes;
+		ebb_ews_photos_schedule (bbews, uids, FALSE);
 
-			bytes = g_base64_decode (photo_base64, &nbytes);
-			if (bytes && nbytes > 0) {
-				EContactPhoto *photo;
+		g_slist_free (uids);
+		g_strfreev (strv);
+	}
 
-				photo = e_contact_photo_new ();
-				photo->type = E_CONTACT_PHOTO_TYPE_INLINED;
-				e_contact_photo_set_inlined (photo, bytes, nbytes);
-				e_contact_set (contact, E_CONTACT_PHOTO, photo);
-				e_contact_photo_free (photo);
+	g_free (content);
+	g_free (filename);
+}
 
-				success = TRUE;
-			}
+/* New GAL contacts are in the cache only after the refresh is completed */
+static void
+ebb_ews_photos_refresh_completed_cb (EBookBackendEws *bbews)
+{
+	GSList *deferred;
 
-			g_free (photo_base64);
-			g_free (bytes);
-		}
+	g_mutex_lock (&bbews->priv->photos_lock);
+	deferred = bbews->priv->photos_deferred;
+	bbews->priv->photos_deferred = NULL;
+	g_mutex_unlock (&bbews->priv->photos_lock);
 
-		e_ews_connection_set_backoff_enabled (bbews->priv->cnc, backoff_enabled);
+	if (deferred) {
+		deferred = g_slist_reverse (deferred);
+		ebb_ews_photos_schedule (bbews, deferred, FALSE);
+		g_slist_free_full (deferred, g_free);
 	}
+}
 
-	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+static void
+ebb_ews_photos_defer (EBookBackendEws *bbews,
+		      GSList *uids) /* gchar *, (transfer full) */
+{
+	if (!uids)
+		return;
 
-	return success;
+	g_mutex_lock (&bbews->priv->photos_lock);
+	bbews->priv->photos_deferred = g_slist_concat (uids, bbews->priv->photos_deferred);
+	ebb_ews_photos_save_queue_locked (bbews);
+	g_mutex_unlock (&bbews->priv->photos_lock);
+}
+
+static void
+ebb_ews_photos_stop (EBookBackendEws *bbews)
+{
+	GThreadPool *pool;
+
+	g_mutex_lock (&bbews->priv->photos_lock);
+	g_cancellable_cancel (bbews->priv->photos_cancellable);
+	g_cond_broadcast (&bbews->priv->photos_cond);
+	pool = bbews->priv->photos_pool;
+	bbews->priv->photos_pool = NULL;
+	g_mutex_unlock (&bbews->priv->photos_lock);
+
+	/* Cancelled requests return immediately, but keep their UID-s pending */
+	if (pool)
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+	/* Storing into the cache can block, thus the results not stored yet
+	   are left in the queue file and fetched again after restart */
+	g_mutex_lock (&bbews->priv->photos_lock);
+	if (pool || bbews->priv->photos_unsaved)
+		ebb_ews_photos_save_queue_locked (bbews);
+	g_mutex_unlock (&bbews->priv->photos_lock);
 }
 
 struct _db_data {
@@ -2412,6 +3674,8 @@ struct _db_data {
 	gboolean fetch_gal_photos;
 	GHashTable *uids;
 	GHashTable *sha1s;
+	GHashTable *old_sums; /* record sums of the previous OAB file, when applying differential patches */
+	GSList *photo_uids; /* gchar *; contacts to fetch photo for */
 	gint unchanged;
 	gint changed;
 	gint added;
@@ -2429,6 +3693,16 @@ ebb_ews_gal_filter_contact (goffset offset,
 	struct _db_data *data = (struct _db_data *) user_data;
 	gchar *uid;
 
+	/* The record did not change since the previous OAB file */
+	if (data->old_sums) {
+		if (!g_hash_table_contains (data->old_sums, sha1))
+			return TRUE;
+
+		data->unchanged++;
+
+		return FALSE;
+	}
+
 	/* Is there an existing identical record, with the same SHA1? */
 	uid = g_hash_table_lookup (data->sha1s, sha1);
 	if (!uid)
@@ -2461,18 +3735,9 @@ ebb_ews_gal_store_contact (EContact *contact,
 		ebews_populate_rev (contact, NULL);
 		e_vcard_util_set_x_attribute (E_VCARD (contact), X_EWS_GAL_SHA1, sha1);
 
-		if (data->fetch_gal_photos && !g_cancellable_is_cancelled (cancellable)) {
-			GError *local_error = NULL;
-
-			if (!ebb_ews_fetch_gal_photo_sync (data->bbews, contact, cancellable, &local_error))
-				ebb_ews_store_photo_check_date (contact, NULL);
-
-			/* The server can kick-off the flood of photo requests, then better stop it */
-			if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_SERVERBUSY))
-				data->fetch_gal_photos = FALSE;
-
-			g_clear_error (&local_error);
-		}
+		/* Photos are fetched in the background, after the contacts are stored */
+		if (data->fetch_gal_photos && !e_vcard_get_attribute (E_VCARD (contact), EVC_PHOTO))
+			data->photo_uids = g_slist_prepend (data->photo_uids, g_strdup (uid));
 
 		nfo = e_book_meta_backend_info_new (uid, e_contact_get_const (contact, E_CONTACT_REV), NULL, NULL);
 		nfo->object = e_vcard_to_string (E_VCARD (contact), EVC_FORMAT_VCARD_30);
@@ -2530,20 +3795,251 @@ ebb_ews_gather_existing_uids_cb (EBookCache *book_cache,
 	return TRUE;
 }
 
-static gboolean
-ebb_ews_check_gal_changes (EBookBackendEws *bbews,
-			   EBookCache *book_cache,
-			   const gchar *filename,
-			   GSList **out_created_objects, /*EBookMetaBackendInfo * */
-			   GSList **out_modified_objects, /*EBookMetaBackendInfo * */
-			   GSList **out_removed_objects, /*EBookMetaBackendInfo * */
+static gboolean
+ebb_ews_check_gal_changes (EBookBackendEws *bbews,
+			   EBookCache *book_cache,
+			   const gchar *filename,
+			   GSList **out_created_objects, /*EBookMetaBackendInfo * */
+			   GSList **out_modified_objects, /*EBookMetaBackendInfo * */
+			   GSList **out_removed_objects, /*EBookMetaBackendInfo * */
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	ESourceEwsFolder *ews_folder;
+	EwsOabDecoder *eod;
+	gboolean success = TRUE;
+	struct _db_data data;
+#if d(1) + 0
+	gint64 t1, t2;
+#endif
+	GError *local_error = NULL;
+
+	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (bbews), FALSE);
+	g_return_val_if_fail (E_IS_BOOK_CACHE (book_cache), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (out_created_objects != NULL, FALSE);
+	g_return_val_if_fail (out_modified_objects != NULL, FALSE);
+	g_return_val_if_fail (out_removed_objects != NULL, FALSE);
+
+	ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (bbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
+
+	data.bbews = bbews;
+	data.fetch_gal_photos = e_source_ews_folder_get_fetch_gal_photos (ews_folder);
+	data.photo_uids = NULL;
+	data.old_sums = NULL;
+	data.created_objects = NULL;
+	data.modified_objects = NULL;
+	data.unchanged = data.changed = data.added = 0;
+	data.percent = 0;
+	data.uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	data.sha1s = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	d (t1 = g_get_monotonic_time ());
+
+	e_book_cache_search_with_callback (book_cache, NULL, ebb_ews_gather_existing_uids_cb, &data, cancellable, NULL);
+
+	eod = ews_oab_decoder_new (filename, bbews->priv->attachments_dir, &local_error);
+	if (!local_error) {
+		GHashTableIter iter;
+		gpointer key;
+
+		success = ews_oab_decoder_decode (eod, ebb_ews_gal_filter_contact, ebb_ews_gal_store_contact, &data, cancellable, &local_error);
+
+		if (success) {
+			*out_created_objects = data.created_objects;
+			*out_modified_objects = data.modified_objects;
+			*out_removed_objects = NULL;
+
+			ebb_ews_photos_defer (bbews, data.photo_uids);
+			data.photo_uids = NULL;
+
+			g_hash_table_iter_init (&iter, data.uids);
+			while (g_hash_table_iter_next (&iter, &key, NULL)) {
+				const gchar *uid = key;
+
+				*out_removed_objects = g_slist_prepend (*out_removed_objects,
+					e_book_meta_backend_info_new (uid, NULL, NULL, NULL));
+			}
+		} else {
+			g_slist_free_full (data.created_objects, e_book_meta_backend_info_free);
+			g_slist_free_full (data.modified_objects, e_book_meta_backend_info_free);
+		}
+	} else {
+		success = FALSE;
+	}
+
+	d (t2 = g_get_monotonic_time ());
+	d (printf ("GAL update completed %ssuccessfully in %" G_GINT64_FORMAT " µs. Added: %d, Changed: %d, Unchanged %d, Removed: %d (%s)\n",
+		   success ? "" : "un", (gint64) (t2 - t1), data.added, data.changed, data.unchanged, g_hash_table_size (data.uids),
+		   local_error ? local_error->message : "no error"));
+
+	g_hash_table_destroy (data.sha1s);
+	g_hash_table_destroy (data.uids);
+	g_slist_free_full (data.photo_uids, g_free);
+
+	if (local_error)
+		g_propagate_error (error, local_error);
+
+	return success;
+}
+
+/* Compares the previous and the new OAB file record by record, thus only
+   the records which changed are decoded and the cache content is not read. */
+static gboolean
+ebb_ews_check_gal_delta_changes (EBookBackendEws *bbews,
+				 const gchar *old_filename,
+				 const gchar *filename,
+				 GSList **out_created_objects, /*EBookMetaBackendInfo * */
+				 GSList **out_modified_objects, /*EBookMetaBackendInfo * */
+				 GSList **out_removed_objects, /*EBookMetaBackendInfo * */
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	ESourceEwsFolder *ews_folder;
+	EwsOabDecoder *old_eod, *eod;
+	GHashTable *old_sums, *new_sums = NULL;
+	GHashTableIter iter;
+	gpointer key, value;
+	gboolean success = FALSE;
+	struct _db_data data;
+#if d(1) + 0
+	gint64 t1, t2;
+#endif
+	GError *local_error = NULL;
+
+	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (bbews), FALSE);
+	g_return_val_if_fail (old_filename != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (out_created_objects != NULL, FALSE);
+	g_return_val_if_fail (out_modified_objects != NULL, FALSE);
+	g_return_val_if_fail (out_removed_objects != NULL, FALSE);
+
+	d (t1 = g_get_monotonic_time ());
+
+	ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (bbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
+
+	data.bbews = bbews;
+	data.fetch_gal_photos = e_source_ews_folder_get_fetch_gal_photos (ews_folder);
+	data.photo_uids = NULL;
+	data.old_sums = NULL;
+	data.sha1s = NULL;
+	data.created_objects = NULL;
+	data.modified_objects = NULL;
+	data.unchanged = data.changed = data.added = 0;
+	data.percent = 0;
+	data.uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	/* No cache directory for the old file, its photos are not needed */
+	old_eod = ews_oab_decoder_new (old_filename, NULL, &local_error);
+	eod = old_eod ? ews_oab_decoder_new (filename, bbews->priv->attachments_dir, &local_error) : NULL;
+
+	old_sums = eod ? ews_oab_decoder_dup_record_sums (old_eod, cancellable, &local_error) : NULL;
+	if (old_sums)
+		new_sums = ews_oab_decoder_dup_record_sums (eod, cancellable, &local_error);
+
+	if (new_sums) {
+		success = TRUE;
+
+		/* Records only in the old file had been changed or removed;
+		   their UID-s are the base to distinguish modified and removed
+		   contacts, the same as the cache content in the full update. */
+		g_hash_table_iter_init (&iter, old_sums);
+		while (success && g_hash_table_iter_next (&iter, &key, &value)) {
+			const goffset *poffset = value;
+			EContact *contact;
+
+			if (g_hash_table_contains (new_sums, key))
+				continue;
+
+			contact = ews_oab_decoder_get_contact_from_offset (old_eod, *poffset, NULL, cancellable, &local_error);
+			if (contact) {
+				const gchar *uid = e_contact_get_const (contact, E_CONTACT_UID);
+
+				if (uid && *uid)
+					g_hash_table_insert (data.uids, g_strdup (uid), NULL);
+
+				g_object_unref (contact);
+			}
+
+			success = !local_error;
+		}
+	}
+
+	if (success) {
+		data.old_sums = old_sums;
+
+		success = ews_oab_decoder_decode (eod, ebb_ews_gal_filter_contact, ebb_ews_gal_store_contact, &data, cancellable, &local_error);
+	}
+
+	if (success) {
+		*out_created_objects = data.created_objects;
+		*out_modified_objects = data.modified_objects;
+		*out_removed_objects = NULL;
+
+		ebb_ews_photos_defer (bbews, data.photo_uids);
+		data.photo_uids = NULL;
+
+		g_hash_table_iter_init (&iter, data.uids);
+		while (g_hash_table_iter_next (&iter, &key, NULL)) {
+			const gchar *uid = key;
+
+			*out_removed_objects = g_slist_prepend (*out_removed_objects,
+				e_book_meta_backend_info_new (uid, NULL, NULL, NULL));
+		}
+	} else {
+		g_slist_free_full (data.created_objects, e_book_meta_backend_info_free);
+		g_slist_free_full (data.modified_objects, e_book_meta_backend_info_free);
+	}
+
+	d (t2 = g_get_monotonic_time ());
+	d (printf ("GAL delta update completed %ssuccessfully in %" G_GINT64_FORMAT " µs. Added: %d, Changed: %d, Unchanged %d, Removed: %d (%s)\n",
+		   success ? "" : "un", (gint64) (t2 - t1), data.added, data.changed, data.unchanged, g_hash_table_size (data.uids),
+		   local_error ? local_error->message : "no error"));
+
+	if (old_sums)
+		g_hash_table_destroy (old_sums);
+	if (new_sums)
+		g_hash_table_destroy (new_sums);
+	g_hash_table_destroy (data.uids);
+	g_slist_free_full (data.photo_uids, g_free);
+	g_clear_object (&old_eod);
+	g_clear_object (&eod);
+
+	if (local_error)
+		g_propagate_error (error, local_error);
+
+	return success;
+}
+
+static void
+ebb_ews_gal_index_contact (EContact *contact,
+			   goffset offset,
+			   const gchar *sha1,
+			   guint percent,
+			   gpointer user_data,
 			   GCancellable *cancellable,
 			   GError **error)
 {
-	ESourceEwsFolder *ews_folder;
+	EwsOabIndex *index = user_data;
+
+	if (contact)
+		ews_oab_index_add_contact (index, contact, offset);
+}
+
+/* Builds an index for the thin GAL; the contacts are not stored in the cache,
+   thus any previously stored are removed */
+static gboolean
+ebb_ews_check_gal_thin_changes (EBookBackendEws *bbews,
+				EBookCache *book_cache,
+				const gchar *filename,
+				GSList **out_removed_objects, /*EBookMetaBackendInfo * */
+				GCancellable *cancellable,
+				GError **error)
+{
 	EwsOabDecoder *eod;
-	gboolean success = TRUE;
-	struct _db_data data;
+	EwsOabIndex *index = NULL;
+	gchar *prop_str = NULL;
+	gboolean success;
 #if d(1) + 0
 	gint64 t1, t2;
 #endif
@@ -2552,59 +4048,56 @@ ebb_ews_check_gal_changes (EBookBackendEws *bbews,
 	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (bbews), FALSE);
 	g_return_val_if_fail (E_IS_BOOK_CACHE (book_cache), FALSE);
 	g_return_val_if_fail (filename != NULL, FALSE);
-	g_return_val_if_fail (out_created_objects != NULL, FALSE);
-	g_return_val_if_fail (out_modified_objects != NULL, FALSE);
 	g_return_val_if_fail (out_removed_objects != NULL, FALSE);
 
-	ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (bbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
+	d (t1 = g_get_monotonic_time ());
 
-	data.bbews = bbews;
-	data.fetch_gal_photos = e_source_ews_folder_get_fetch_gal_photos (ews_folder);
-	data.created_objects = NULL;
-	data.modified_objects = NULL;
-	data.unchanged = data.changed = data.added = 0;
-	data.percent = 0;
-	data.uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
-	data.sha1s = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	/* Photos are extracted when the contact is decoded for a search */
+	eod = ews_oab_decoder_new (filename, NULL, &local_error);
+	success = eod != NULL;
 
-	d (t1 = g_get_monotonic_time ());
+	if (success) {
+		index = ews_oab_index_new_for_write ();
+		success = ews_oab_decoder_decode (eod, NULL, ebb_ews_gal_index_contact, index, cancellable, &local_error);
+	}
 
-	e_book_cache_search_with_callback (book_cache, NULL, ebb_ews_gather_existing_uids_cb, &data, cancellable, NULL);
+	if (success) {
+		prop_str = ews_oab_decoder_get_oab_prop_string (eod, &local_error);
+		success = prop_str != NULL;
+	}
 
-	eod = ews_oab_decoder_new (filename, bbews->priv->attachments_dir, &local_error);
-	if (!local_error) {
-		GHashTableIter iter;
-		gpointer key;
+	if (success) {
+		gchar *index_filename;
 
-		success = ews_oab_decoder_decode (eod, ebb_ews_gal_filter_contact, ebb_ews_gal_store_contact, &data, cancellable, &local_error);
+		index_filename = ebb_ews_dup_gal_index_filename (filename);
+		success = ews_oab_index_write (index, index_filename, prop_str, &local_error);
+		g_free (index_filename);
+	}
 
-		if (success) {
-			*out_created_objects = data.created_objects;
-			*out_modified_objects = data.modified_objects;
-			*out_removed_objects = NULL;
+	if (success) {
+		GSList *uids = NULL, *link;
 
-			g_hash_table_iter_init (&iter, data.uids);
-			while (g_hash_table_iter_next (&iter, &key, NULL)) {
-				const gchar *uid = key;
+		*out_removed_objects = NULL;
+
+		if (e_book_cache_search_uids (book_cache, NULL, &uids, cancellable, NULL)) {
+			for (link = uids; link; link = g_slist_next (link)) {
+				const gchar *uid = link->data;
 
 				*out_removed_objects = g_slist_prepend (*out_removed_objects,
 					e_book_meta_backend_info_new (uid, NULL, NULL, NULL));
 			}
-		} else {
-			g_slist_free_full (data.created_objects, e_book_meta_backend_info_free);
-			g_slist_free_full (data.modified_objects, e_book_meta_backend_info_free);
 		}
-	} else {
-		success = FALSE;
+
+		g_slist_free_full (uids, g_free);
 	}
 
 	d (t2 = g_get_monotonic_time ());
-	d (printf ("GAL update completed %ssuccessfully in %" G_GINT64_FORMAT " µs. Added: %d, Changed: %d, Unchanged %d, Removed: %d (%s)\n",
-		   success ? "" : "un", (gint64) (t2 - t1), data.added, data.changed, data.unchanged, g_hash_table_size (data.uids),
-		   local_error ? local_error->message : "no error"));
+	d (printf ("GAL index build completed %ssuccessfully in %" G_GINT64_FORMAT " µs (%s)\n",
+		   success ? "" : "un", (gint64) (t2 - t1), local_error ? local_error->message : "no error"));
 
-	g_hash_table_destroy (data.sha1s);
-	g_hash_table_destroy (data.uids);
+	ews_oab_index_free (index);
+	g_clear_object (&eod);
+	g_free (prop_str);
 
 	if (local_error)
 		g_propagate_error (error, local_error);
@@ -2798,53 +4291,475 @@ static struct {
 	{ "exists", ebb_ews_func_exists, 0}
 };
 
-/* FIXME  build a complete filter from the query that can be used by find_items */
-static gboolean
-ebb_ews_build_restriction (const gchar *query,
-			   gchar **auto_comp_str)
+/* FIXME  build a complete filter from the query that can be used by find_items */
+static gboolean
+ebb_ews_build_restriction (const gchar *query,
+			   gchar **auto_comp_str)
+{
+	ESExp *sexp;
+	EBookBackendEwsSExpData *sdata;
+	gboolean autocompletion = FALSE;
+	gint i;
+
+	*auto_comp_str = NULL;
+
+	sexp = e_sexp_new ();
+	sdata = g_new0 (EBookBackendEwsSExpData, 1);
+	sdata->is_autocompletion = FALSE;
+
+	for (i = 0; i < G_N_ELEMENTS (symbols); i++) {
+		e_sexp_add_function (
+			sexp, 0, (gchar *) symbols[i].name,
+			symbols[i].func,
+			sdata);
+	}
+
+	e_sexp_input_text (sexp, query, strlen (query));
+	if (e_sexp_parse (sexp) == -1) {
+		const gchar *errstr = e_sexp_get_error (sexp);
+
+		g_printerr ("%s: Failed to parse query '%s': %s\n", G_STRFUNC, query, errstr ? errstr : "Unknown error");
+	} else {
+		ESExpResult *r;
+
+		r = e_sexp_eval (sexp);
+		if (r) {
+			autocompletion = sdata->is_autocompletion;
+			if (autocompletion)
+				*auto_comp_str = sdata->auto_comp_str;
+			else
+				g_free (sdata->auto_comp_str);
+		}
+
+		e_sexp_result_free (sexp, r);
+	}
+
+	g_object_unref (sexp);
+	g_free (sdata);
+
+	return autocompletion && *auto_comp_str;
+}
+
+static gboolean
+ebb_ews_thin_gal_is_enabled (EBookBackendEws *bbews)
+{
+	ESourceEwsFolder *ews_folder;
+
+	if (!bbews->priv->is_gal ||
+	    !camel_ews_settings_get_oab_offline (ebb_ews_get_collection_settings (bbews)))
+		return FALSE;
+
+	ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (bbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
+
+	return e_source_ews_folder_get_thin_gal (ews_folder);
+}
+
+/* Whether the stored GAL data is the thin one. It differs from the setting
+   after the mode is switched, until the next refresh converts the data,
+   thus the searches use the previous mode meanwhile. */
+static gboolean
+ebb_ews_thin_gal_is_stored (EBookBackendEws *bbews)
+{
+	EBookCache *book_cache;
+	gboolean is_stored = FALSE;
+
+	if (!bbews->priv->is_gal ||
+	    !camel_ews_settings_get_oab_offline (ebb_ews_get_collection_settings (bbews)))
+		return FALSE;
+
+	book_cache = e_book_meta_backend_ref_cache (E_BOOK_META_BACKEND (bbews));
+	if (book_cache) {
+		is_stored = e_cache_get_key_int (E_CACHE (book_cache), EBB_EWS_THIN_GAL_KEY, NULL) == 1;
+		g_object_unref (book_cache);
+	}
+
+	return is_stored;
+}
+
+static void
+ebb_ews_thin_gal_close_locked (EBookBackendEws *bbews)
+{
+	ews_oab_index_free (bbews->priv->thin_gal_index);
+	bbews->priv->thin_gal_index = NULL;
+	g_clear_object (&bbews->priv->thin_gal_decoder);
+}
+
+static void
+ebb_ews_thin_gal_close (EBookBackendEws *bbews)
+{
+	g_mutex_lock (&bbews->priv->thin_gal_lock);
+	ebb_ews_thin_gal_close_locked (bbews);
+	g_mutex_unlock (&bbews->priv->thin_gal_lock);
+}
+
+/* Moves the new OAB file and its index over the current ones. The opened
+   thin GAL is closed first, with the lock held, thus no search can see
+   the new OAB file with the old index. */
+static gboolean
+ebb_ews_install_gal_file (EBookBackendEws *bbews,
+			  const gchar *temp_filename,
+			  const gchar *filename,
+			  GError **error)
+{
+	gchar *temp_index_filename, *index_filename;
+	const gchar *failed_filename = NULL;
+	gint errn = 0;
+
+	temp_index_filename = ebb_ews_dup_gal_index_filename (temp_filename);
+	index_filename = ebb_ews_dup_gal_index_filename (filename);
+
+	g_mutex_lock (&bbews->priv->thin_gal_lock);
+
+	ebb_ews_thin_gal_close_locked (bbews);
+
+	if (g_rename (temp_filename, filename) == -1) {
+		errn = errno;
+		failed_filename = temp_filename;
+	} else if (!g_file_test (temp_index_filename, G_FILE_TEST_IS_REGULAR)) {
+		/* Do not leave an index, which does not describe the file */
+		g_unlink (index_filename);
+	} else if (g_rename (temp_index_filename, index_filename) == -1) {
+		errn = errno;
+		failed_filename = temp_index_filename;
+
+		g_unlink (index_filename);
+	}
+
+	g_mutex_unlock (&bbews->priv->thin_gal_lock);
+
+	if (failed_filename) {
+		g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errn),
+			"Failed to rename '%s': %s", failed_filename, g_strerror (errn));
+	}
+
+	g_free (temp_index_filename);
+	g_free (index_filename);
+
+	return !failed_filename;
+}
+
+/* Opens the current OAB file and its index, if not opened yet */
+static gboolean
+ebb_ews_thin_gal_open_locked (EBookBackendEws *bbews,
+			      GError **error)
+{
+	EBookCache *book_cache;
+	gchar *oab_filename, *index_filename;
+	gboolean success;
+
+	if (bbews->priv->thin_gal_index)
+		return TRUE;
+
+	book_cache = e_book_meta_backend_ref_cache (E_BOOK_META_BACKEND (bbews));
+	oab_filename = book_cache ? e_cache_dup_key (E_CACHE (book_cache), "oab-filename", NULL) : NULL;
+	g_clear_object (&book_cache);
+
+	if (!oab_filename || !*oab_filename) {
+		g_free (oab_filename);
+		g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_OFFLINE_UNAVAILABLE, _("The GAL was not downloaded yet")));
+		return FALSE;
+	}
+
+	index_filename = ebb_ews_dup_gal_index_filename (oab_filename);
+
+	bbews->priv->thin_gal_index = ews_oab_index_open (index_filename, error);
+	success = bbews->priv->thin_gal_index != NULL;
+
+	if (success) {
+		bbews->priv->thin_gal_decoder = ews_oab_decoder_new (oab_filename, bbews->priv->attachments_dir, error);
+		success = bbews->priv->thin_gal_decoder &&
+			ews_oab_decoder_set_oab_prop_string (bbews->priv->thin_gal_decoder,
+				ews_oab_index_get_oab_prop_string (bbews->priv->thin_gal_index), error);
+	}
+
+	if (!success) {
+		ews_oab_index_free (bbews->priv->thin_gal_index);
+		bbews->priv->thin_gal_index = NULL;
+		g_clear_object (&bbews->priv->thin_gal_decoder);
+	}
+
+	g_free (index_filename);
+	g_free (oab_filename);
+
+	return success;
+}
+
+static EContact *
+ebb_ews_thin_gal_decode_locked (EBookBackendEws *bbews,
+				goffset offset,
+				GCancellable *cancellable)
+{
+	EContact *contact;
+	GError *local_error = NULL;
+
+	contact = ews_oab_decoder_get_contact_from_offset (bbews->priv->thin_gal_decoder, offset, NULL, cancellable, &local_error);
+
+	if (contact)
+		ebews_populate_rev (contact, NULL);
+
+	if (local_error) {
+		d (printf ("%s: Failed to decode record at %" G_GINT64_FORMAT ": %s\n", G_STRFUNC, (gint64) offset, local_error->message));
+		g_clear_error (&local_error);
+	}
+
+	return contact;
+}
+
+/* Returns GAL contacts matching the @expr; only autocompletion-like
+   queries are answered, the same as with the online GAL */
+static gboolean
+ebb_ews_thin_gal_search_sync (EBookBackendEws *bbews,
+			      const gchar *expr,
+			      GSList **out_contacts, /* EContact * */
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	EBookBackendSExp *sexp;
+	GArray *offsets;
+	gchar *auto_comp_str = NULL;
+	guint ii;
+
+	*out_contacts = NULL;
+
+	if (!expr || !*expr || !ebb_ews_build_restriction (expr, &auto_comp_str))
+		return TRUE;
+
+	sexp = e_book_backend_sexp_new (expr);
+	if (!sexp) {
+		g_free (auto_comp_str);
+		g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_INVALID_QUERY, NULL));
+		return FALSE;
+	}
+
+	g_mutex_lock (&bbews->priv->thin_gal_lock);
+
+	if (!ebb_ews_thin_gal_open_locked (bbews, error)) {
+		g_mutex_unlock (&bbews->priv->thin_gal_lock);
+		g_object_unref (sexp);
+		g_free (auto_comp_str);
+
+		return FALSE;
+	}
+
+	offsets = ews_oab_index_lookup_prefix (bbews->priv->thin_gal_index, auto_comp_str, EBB_EWS_THIN_GAL_MAX_RESULTS);
+
+	for (ii = 0; ii < offsets->len && !g_cancellable_is_cancelled (cancellable); ii++) {
+		EContact *contact;
+
+		contact = ebb_ews_thin_gal_decode_locked (bbews, g_array_index (offsets, goffset, ii), cancellable);
+		if (!contact)
+			continue;
+
+		/* The index matches word prefixes, the expression can be stricter */
+		if (e_book_backend_sexp_match_contact (sexp, contact))
+			*out_contacts = g_slist_prepend (*out_contacts, contact);
+		else
+			g_object_unref (contact);
+	}
+
+	g_mutex_unlock (&bbews->priv->thin_gal_lock);
+
+	*out_contacts = g_slist_reverse (*out_contacts);
+
+	g_array_unref (offsets);
+	g_object_unref (sexp);
+	g_free (auto_comp_str);
+
+	return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+static gboolean
+ebb_ews_thin_gal_load_contact_sync (EBookBackendEws *bbews,
+				    const gchar *uid,
+				    EContact **out_contact,
+				    GCancellable *cancellable,
+				    GError **error)
+{
+	GArray *offsets;
+	guint ii;
+
+	*out_contact = NULL;
+
+	g_mutex_lock (&bbews->priv->thin_gal_lock);
+
+	if (!ebb_ews_thin_gal_open_locked (bbews, error)) {
+		g_mutex_unlock (&bbews->priv->thin_gal_lock);
+		return FALSE;
+	}
+
+	offsets = ews_oab_index_lookup_uid (bbews->priv->thin_gal_index, uid);
+
+	for (ii = 0; ii < offsets->len && !*out_contact; ii++) {
+		EContact *contact;
+
+		contact = ebb_ews_thin_gal_decode_locked (bbews, g_array_index (offsets, goffset, ii), cancellable);
+		if (contact && g_strcmp0 (e_contact_get_const (contact, E_CONTACT_UID), uid) == 0)
+			*out_contact = g_object_ref (contact);
+
+		g_clear_object (&contact);
+	}
+
+	g_mutex_unlock (&bbews->priv->thin_gal_lock);
+
+	g_array_unref (offsets);
+
+	if (!*out_contact) {
+		g_propagate_error (error, EBC_ERROR_EX (E_BOOK_CLIENT_ERROR_CONTACT_NOT_FOUND, NULL));
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Converts one resolved GAL mailbox into the info to be stored in the cache.
+   The public distribution lists are expanded with their members. */
+static EBookMetaBackendInfo *
+ebb_ews_gal_mailbox_to_info (EBookBackendEws *bbews,
+			     EBookCache *book_cache,
+			     EwsMailbox *mb,
+			     EEwsItem *contact_item,
+			     gboolean use_primary_address,
+			     GCancellable *cancellable)
 {
-	ESExp *sexp;
-	EBookBackendEwsSExpData *sdata;
-	gboolean autocompletion = FALSE;
-	gint i;
+	EBookMetaBackendInfo *nfo;
+	EContact *contact = NULL, *old_contact = NULL;
+	gboolean is_public_dl = FALSE, mailbox_address_set = FALSE;
+	const gchar *str;
 
-	*auto_comp_str = NULL;
+	if (g_strcmp0 (mb->mailbox_type, "PublicDL") == 0) {
+		contact = e_contact_new ();
 
-	sexp = e_sexp_new ();
-	sdata = g_new0 (EBookBackendEwsSExpData, 1);
-	sdata->is_autocompletion = FALSE;
+		if (!ebb_ews_get_dl_info_gal (bbews, contact, mb, cancellable, NULL)) {
+			g_clear_object (&contact);
+		} else {
+			is_public_dl = TRUE;
+		}
+	}
 
-	for (i = 0; i < G_N_ELEMENTS (symbols); i++) {
-		e_sexp_add_function (
-			sexp, 0, (gchar *) symbols[i].name,
-			symbols[i].func,
-			sdata);
+	if (!contact && contact_item && e_ews_item_get_item_type (contact_item) == E_EWS_ITEM_TYPE_CONTACT)
+		contact = ebb_ews_item_to_contact (bbews, contact_item, use_primary_address && !is_public_dl, cancellable, NULL);
+
+	if (!contact)
+		contact = e_contact_new ();
+
+	/* We do not get an id from the server, so just using email_id as uid for now */
+	e_contact_set (contact, E_CONTACT_UID, mb->email);
+
+	/* There is no ChangeKey provided either, thus make up some revision,
+	   to have the contact always updated in the local cache. */
+	ebews_populate_rev (contact, NULL);
+
+	if (use_primary_address && !is_public_dl && mb->email &&
+	    (!mb->routing_type || g_ascii_strcasecmp (mb->routing_type, "SMTP") == 0)) {
+		e_contact_set (contact, E_CONTACT_EMAIL_1, mb->email);
+		mailbox_address_set = TRUE;
 	}
 
-	e_sexp_input_text (sexp, query, strlen (query));
-	if (e_sexp_parse (sexp) == -1) {
-		const gchar *errstr = e_sexp_get_error (sexp);
+	str = e_contact_get_const (contact, E_CONTACT_FULL_NAME);
+	if (!str || !*str)
+		e_contact_set (contact, E_CONTACT_FULL_NAME, mb->name);
+
+	str = e_contact_get_const (contact, E_CONTACT_EMAIL_1);
+	if (!str || !*str || (!is_public_dl && contact_item && !mailbox_address_set &&
+	    e_ews_item_get_item_type (contact_item) == E_EWS_ITEM_TYPE_CONTACT)) {
+		/* Cleanup first, then re-add only SMTP addresses */
+		e_contact_set (contact, E_CONTACT_EMAIL_1, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL_2, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL_3, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL_4, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL, NULL);
+
+		ebews_populate_emails_ex (bbews, contact, contact_item, TRUE, use_primary_address && !is_public_dl);
+	}
 
-		g_printerr ("%s: Failed to parse query '%s': %s\n", G_STRFUNC, query, errstr ? errstr : "Unknown error");
-	} else {
-		ESExpResult *r;
+	str = e_contact_get_const (contact, E_CONTACT_EMAIL_1);
+	if (!str || !*str) {
+		e_contact_set (contact, E_CONTACT_EMAIL_1, mb->email);
+	} else if (!is_public_dl && !mailbox_address_set && mb->email &&
+		   (!mb->routing_type || g_ascii_strcasecmp (mb->routing_type, "SMTP") == 0)) {
+		EContactField fields[3] = { E_CONTACT_EMAIL_2, E_CONTACT_EMAIL_3, E_CONTACT_EMAIL_4 };
+		gchar *emails[3];
+		gint ii, ff = 0;
+
+		emails[0] = e_contact_get (contact, E_CONTACT_EMAIL_1);
+		emails[1] = e_contact_get (contact, E_CONTACT_EMAIL_2);
+		emails[2] = e_contact_get (contact, E_CONTACT_EMAIL_3);
+
+		/* Make the mailbox email the primary email and skip duplicates */
+		e_contact_set (contact, E_CONTACT_EMAIL_1, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL_2, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL_3, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL_4, NULL);
+		e_contact_set (contact, E_CONTACT_EMAIL, NULL);
+
+		e_contact_set (contact, E_CONTACT_EMAIL_1, mb->email);
+
+		for (ii = 0; ii < 3; ii++) {
+			if (emails[ii] && g_ascii_strcasecmp (emails[ii], mb->email) != 0) {
+				e_contact_set (contact, fields[ff], emails[ii]);
+				ff++;
+			}
 
-		r = e_sexp_eval (sexp);
-		if (r) {
-			autocompletion = sdata->is_autocompletion;
-			if (autocompletion)
-				*auto_comp_str = sdata->auto_comp_str;
-			else
-				g_free (sdata->auto_comp_str);
+			g_free (emails[ii]);
 		}
+	}
 
-		e_sexp_result_free (sexp, r);
+	/* Copy photo information, if any there */
+	if (e_book_cache_get_contact (book_cache, mb->email, FALSE, &old_contact, cancellable, NULL) && old_contact) {
+		EContactPhoto *photo;
+
+		photo = e_contact_get (old_contact, E_CONTACT_PHOTO);
+		if (photo) {
+			e_contact_set (contact, E_CONTACT_PHOTO, photo);
+			e_contact_photo_free (photo);
+		} else {
+			const gchar *photo_check_date;
+
+			photo_check_date = ebb_ews_get_photo_check_date (old_contact);
+			if (photo_check_date)
+				ebb_ews_store_photo_check_date (contact, photo_check_date);
+		}
+
+		g_clear_object (&old_contact);
 	}
 
-	g_object_unref (sexp);
-	g_free (sdata);
+	ebb_ews_store_original_vcard (contact);
 
-	return autocompletion && *auto_comp_str;
+	nfo = e_book_meta_backend_info_new (e_contact_get_const (contact, E_CONTACT_UID),
+		e_contact_get_const (contact, E_CONTACT_REV), NULL, NULL);
+	nfo->object = e_vcard_to_string (E_VCARD (contact), EVC_FORMAT_VCARD_30);
+
+	g_object_unref (contact);
+
+	return nfo;
+}
+
+/* Stores the 'infos' into the cache, thus the opened views see them
+   immediately, not only after all the found mailboxes are processed */
+static gboolean
+ebb_ews_gal_store_infos_sync (EBookMetaBackend *meta_backend,
+			      GSList **infos, /* EBookMetaBackendInfo * */
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	GSList *created_objects = NULL, *modified_objects = NULL;
+	gboolean success;
+
+	if (!*infos)
+		return TRUE;
+
+	success = e_book_meta_backend_split_changes_sync (meta_backend, *infos, &created_objects,
+		&modified_objects, NULL, cancellable, error);
+	if (success)
+		success = e_book_meta_backend_process_changes_sync (meta_backend, created_objects,
+			modified_objects, NULL, cancellable, error);
+
+	g_slist_free_full (created_objects, e_book_meta_backend_info_free);
+	g_slist_free_full (modified_objects, e_book_meta_backend_info_free);
+	g_slist_free_full (*infos, e_book_meta_backend_info_free);
+	*infos = NULL;
+
+	return success;
 }
 
 static gboolean
@@ -2870,19 +4785,21 @@ ebb_ews_update_cache_for_expression (EBookBackendEws *bbews,
 
 	meta_backend = E_BOOK_META_BACKEND (bbews);
 
-	g_rec_mutex_lock (&bbews->priv->cnc_lock);
-
 	/* Search only if not searching for everything */
 	if (expr && *expr && g_ascii_strcasecmp (expr, "(contains \"x-evolution-any-field\" \"\")") != 0) {
+		EEwsConnection *cnc = NULL;
 		gchar *restriction_expr = NULL;
 		GSList *mailboxes = NULL, *contacts = NULL, *found_infos = NULL;
 		gboolean includes_last_item = TRUE;
 
 		success = ebb_ews_build_restriction (expr, &restriction_expr) &&
 			e_book_meta_backend_ensure_connected_sync (meta_backend, cancellable, error) &&
-			e_ews_connection_resolve_names_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM, restriction_expr,
+			(cnc = ebb_ews_ref_connection_sync (bbews, error)) != NULL &&
+			e_ews_connection_resolve_names_sync (cnc, EWS_PRIORITY_MEDIUM, restriction_expr,
 				EWS_SEARCH_AD, NULL, TRUE, &mailboxes, &contacts, &includes_last_item, cancellable, error);
 
+		g_clear_object (&cnc);
+
 		if (success) {
 			EBookCache *book_cache;
 			ESourceEwsFolder *ews_folder;
@@ -2893,120 +4810,28 @@ ebb_ews_update_cache_for_expression (EBookBackendEws *bbews,
 			use_primary_address = e_source_ews_folder_get_use_primary_address (ews_folder);
 			book_cache = e_book_meta_backend_ref_cache (meta_backend);
 
-			for (mlink = mailboxes, clink = contacts; mlink; mlink = g_slist_next (mlink), clink = g_slist_next (clink)) {
+			/* The plain mailboxes first, they are cheap; then one distribution
+			   list at a time, because their expansion can take long */
+			for (mlink = mailboxes, clink = contacts; mlink && success; mlink = g_slist_next (mlink), clink = g_slist_next (clink)) {
 				EwsMailbox *mb = mlink->data;
-				EEwsItem *contact_item = clink ? clink->data : NULL;
-				EBookMetaBackendInfo *nfo;
-				EContact *contact = NULL, *old_contact = NULL;
-				gboolean is_public_dl = FALSE, mailbox_address_set = FALSE;
-				const gchar *str;
-
-				if (g_strcmp0 (mb->mailbox_type, "PublicDL") == 0) {
-					contact = e_contact_new ();
-
-					if (!ebb_ews_get_dl_info_gal (bbews, contact, mb, cancellable, NULL)) {
-						g_clear_object (&contact);
-					} else {
-						is_public_dl = TRUE;
-					}
-				}
-
-				if (!contact && contact_item && e_ews_item_get_item_type (contact_item) == E_EWS_ITEM_TYPE_CONTACT)
-					contact = ebb_ews_item_to_contact (bbews, contact_item, use_primary_address && !is_public_dl, cancellable, NULL);
-
-				if (!contact)
-					contact = e_contact_new ();
 
-				/* We do not get an id from the server, so just using email_id as uid for now */
-				e_contact_set (contact, E_CONTACT_UID, mb->email);
-
-				/* There is no ChangeKey provided either, thus make up some revision,
-				   to have the contact always updated in the local cache. */
-				ebews_populate_rev (contact, NULL);
-
-				if (use_primary_address && !is_public_dl && mb->email &&
-				    (!mb->routing_type || g_ascii_strcasecmp (mb->routing_type, "SMTP") == 0)) {
-					e_contact_set (contact, E_CONTACT_EMAIL_1, mb->email);
-					mailbox_address_set = TRUE;
-				}
-
-				str = e_contact_get_const (contact, E_CONTACT_FULL_NAME);
-				if (!str || !*str)
-					e_contact_set (contact, E_CONTACT_FULL_NAME, mb->name);
-
-				str = e_contact_get_const (contact, E_CONTACT_EMAIL_1);
-				if (!str || !*str || (!is_public_dl && contact_item && !mailbox_address_set &&
-				    e_ews_item_get_item_type (contact_item) == E_EWS_ITEM_TYPE_CONTACT)) {
-					/* Cleanup first, then re-add only SMTP addresses */
-					e_contact_set (contact, E_CONTACT_EMAIL_1, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL_2, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL_3, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL_4, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL, NULL);
-
-					ebews_populate_emails_ex (bbews, contact, contact_item, TRUE, use_primary_address && !is_public_dl);
-				}
-
-				str = e_contact_get_const (contact, E_CONTACT_EMAIL_1);
-				if (!str || !*str) {
-					e_contact_set (contact, E_CONTACT_EMAIL_1, mb->email);
-				} else if (!is_public_dl && !mailbox_address_set && mb->email &&
-					   (!mb->routing_type || g_ascii_strcasecmp (mb->routing_type, "SMTP") == 0)) {
-					EContactField fields[3] = { E_CONTACT_EMAIL_2, E_CONTACT_EMAIL_3, E_CONTACT_EMAIL_4 };
-					gchar *emails[3];
-					gint ii, ff = 0;
-
-					emails[0] = e_contact_get (contact, E_CONTACT_EMAIL_1);
-					emails[1] = e_contact_get (contact, E_CONTACT_EMAIL_2);
-					emails[2] = e_contact_get (contact, E_CONTACT_EMAIL_3);
-
-					/* Make the mailbox email the primary email and skip duplicates */
-					e_contact_set (contact, E_CONTACT_EMAIL_1, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL_2, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL_3, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL_4, NULL);
-					e_contact_set (contact, E_CONTACT_EMAIL, NULL);
-
-					e_contact_set (contact, E_CONTACT_EMAIL_1, mb->email);
-
-					for (ii = 0; ii < 3; ii++) {
-						if (emails[ii] && g_ascii_strcasecmp (emails[ii], mb->email) != 0) {
-							e_contact_set (contact, fields[ff], emails[ii]);
-							ff++;
-						}
-
-						g_free (emails[ii]);
-					}
+				if (g_strcmp0 (mb->mailbox_type, "PublicDL") != 0) {
+					found_infos = g_slist_prepend (found_infos,
+						ebb_ews_gal_mailbox_to_info (bbews, book_cache, mb, clink ? clink->data : NULL, use_primary_address, cancellable));
 				}
+			}
 
-				/* Copy photo information, if any there */
-				if (e_book_cache_get_contact (book_cache, mb->email, FALSE, &old_contact, cancellable, NULL) && old_contact) {
-					EContactPhoto *photo;
+			success = ebb_ews_gal_store_infos_sync (meta_backend, &found_infos, cancellable, error);
 
-					photo = e_contact_get (old_contact, E_CONTACT_PHOTO);
-					if (photo) {
-						e_contact_set (contact, E_CONTACT_PHOTO, photo);
-						e_contact_photo_free (photo);
-					} else {
-						const gchar *photo_check_date;
+			for (mlink = mailboxes, clink = contacts; mlink && success; mlink = g_slist_next (mlink), clink = g_slist_next (clink)) {
+				EwsMailbox *mb = mlink->data;
 
-						photo_check_date = ebb_ews_get_photo_check_date (old_contact);
-						if (photo_check_date)
-							ebb_ews_store_photo_check_date (contact, photo_check_date);
-					}
+				if (g_strcmp0 (mb->mailbox_type, "PublicDL") == 0) {
+					found_infos = g_slist_prepend (found_infos,
+						ebb_ews_gal_mailbox_to_info (bbews, book_cache, mb, clink ? clink->data : NULL, use_primary_address, cancellable));
 
-					g_clear_object (&old_contact);
+					success = ebb_ews_gal_store_infos_sync (meta_backend, &found_infos, cancellable, error);
 				}
-
-				ebb_ews_store_original_vcard (contact);
-
-				nfo = e_book_meta_backend_info_new (e_contact_get_const (contact, E_CONTACT_UID),
-					e_contact_get_const (contact, E_CONTACT_REV), NULL, NULL);
-				nfo->object = e_vcard_to_string (E_VCARD (contact), EVC_FORMAT_VCARD_30);
-
-				found_infos = g_slist_prepend (found_infos, nfo);
-
-				g_object_unref (contact);
 			}
 
 			g_clear_object (&book_cache);
@@ -3015,25 +4840,10 @@ ebb_ews_update_cache_for_expression (EBookBackendEws *bbews,
 		g_slist_free_full (mailboxes, (GDestroyNotify) e_ews_mailbox_free);
 		e_util_free_nullable_object_slist (contacts);
 
-		if (success) {
-			GSList *created_objects = NULL, *modified_objects = NULL;
-
-			success = e_book_meta_backend_split_changes_sync (meta_backend, found_infos, &created_objects,
-				&modified_objects, NULL, cancellable, error);
-			if (success)
-				success = e_book_meta_backend_process_changes_sync (meta_backend, created_objects,
-					modified_objects, NULL, cancellable, error);
-
-			g_slist_free_full (created_objects, e_book_meta_backend_info_free);
-			g_slist_free_full (modified_objects, e_book_meta_backend_info_free);
-		}
-
 		g_slist_free_full (found_infos, e_book_meta_backend_info_free);
 		g_free (restriction_expr);
 	}
 
-	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
-
 	ebb_ews_convert_error_to_client_error (error);
 	ebb_ews_maybe_disconnect_sync (bbews, error, cancellable);
 
@@ -3211,9 +5021,11 @@ ebb_ews_connect_sync (EBookMetaBackend *meta_backend,
 		      GError **error)
 {
 	EBookBackendEws *bbews;
+	EEwsConnection *cnc;
 	EBookCache *book_cache;
 	CamelEwsSettings *ews_settings;
 	gchar *hosturl;
+	guint subscription_key = 0;
 	gboolean success = FALSE;
 
 	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (meta_backend), FALSE);
@@ -3221,10 +5033,10 @@ ebb_ews_connect_sync (EBookMetaBackend *meta_backend,
 
 	bbews = E_BOOK_BACKEND_EWS (meta_backend);
 
-	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+	cnc = ebb_ews_ref_connection (bbews);
 
-	if (bbews->priv->cnc) {
-		g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+	if (cnc) {
+		g_object_unref (cnc);
 
 		*out_auth_result = E_SOURCE_AUTHENTICATION_ACCEPTED;
 
@@ -3256,51 +5068,74 @@ ebb_ews_connect_sync (EBookMetaBackend *meta_backend,
 	ews_settings = ebb_ews_get_collection_settings (bbews);
 	hosturl = camel_ews_settings_dup_hosturl (ews_settings);
 
-	bbews->priv->cnc = e_ews_connection_new_for_backend (E_BACKEND (bbews), e_book_backend_get_registry (E_BOOK_BACKEND (bbews)), hosturl, ews_settings);
+	/* The connection is set up without the lock held and published
+	   only when the credentials are accepted */
+	cnc = e_ews_connection_new_for_backend (E_BACKEND (bbews), e_book_backend_get_registry (E_BOOK_BACKEND (bbews)), hosturl, ews_settings);
 
 	e_binding_bind_property (
 		bbews, "proxy-resolver",
-		bbews->priv->cnc, "proxy-resolver",
+		cnc, "proxy-resolver",
 		G_BINDING_SYNC_CREATE);
 
-	*out_auth_result = e_ews_connection_try_credentials_sync (bbews->priv->cnc, credentials, NULL,
+	*out_auth_result = e_ews_connection_try_credentials_sync (cnc, credentials, NULL,
 		out_certificate_pem, out_certificate_errors, cancellable, error);
 
 	if (*out_auth_result == E_SOURCE_AUTHENTICATION_ACCEPTED) {
 		ESource *source = e_backend_get_source (E_BACKEND (bbews));
 		ESourceEwsFolder *ews_folder;
+		EEwsConnection *old_cnc;
+		gchar *folder_id, *old_folder_id;
+		guint old_subscription_key;
 
 		ews_folder = e_source_get_extension (source, E_SOURCE_EXTENSION_EWS_FOLDER);
 
-		g_free (bbews->priv->folder_id);
-		bbews->priv->folder_id = e_source_ews_folder_dup_id (ews_folder);
+		folder_id = e_source_ews_folder_dup_id (ews_folder);
 		bbews->priv->is_gal = ebb_ews_check_is_gal (bbews);
 
-		g_signal_connect_swapped (bbews->priv->cnc, "server-notification",
+		g_signal_connect_swapped (cnc, "server-notification",
 			G_CALLBACK (ebb_ews_server_notification_cb), bbews);
 
 		if (!bbews->priv->is_gal &&
 		    camel_ews_settings_get_listen_notifications (ews_settings) &&
-		    e_ews_connection_satisfies_server_version (bbews->priv->cnc, E_EWS_EXCHANGE_2010_SP1)) {
+		    e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010_SP1)) {
 			GSList *folders = NULL;
 
-			folders = g_slist_prepend (folders, bbews->priv->folder_id);
+			folders = g_slist_prepend (folders, folder_id);
 
-			e_ews_connection_enable_notifications_sync (bbews->priv->cnc,
-				folders, &bbews->priv->subscription_key);
+			e_ews_connection_enable_notifications_sync (cnc,
+				folders, &subscription_key);
 
 			g_slist_free (folders);
 		}
 
+		g_rec_mutex_lock (&bbews->priv->cnc_lock);
+
+		/* A concurrent connect could have published its connection meanwhile */
+		old_cnc = bbews->priv->cnc;
+		old_subscription_key = bbews->priv->subscription_key;
+		old_folder_id = bbews->priv->folder_id;
+
+		bbews->priv->cnc = g_object_ref (cnc);
+		bbews->priv->subscription_key = subscription_key;
+		bbews->priv->folder_id = folder_id;
+
+		g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+
+		if (old_cnc)
+			ebb_ews_release_connection (bbews, old_cnc, old_subscription_key);
+
+		g_free (old_folder_id);
+
 		e_book_backend_set_writable (E_BOOK_BACKEND (bbews), !bbews->priv->is_gal);
 		success = TRUE;
+
+		if (bbews->priv->is_gal && e_source_ews_folder_get_fetch_gal_photos (ews_folder))
+			ebb_ews_photos_resume (bbews);
 	} else {
 		ebb_ews_convert_error_to_client_error (error);
-		g_clear_object (&bbews->priv->cnc);
 	}
 
-	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
-
+	g_object_unref (cnc);
 	g_free (hosturl);
 
 	return success;
@@ -3335,7 +5170,9 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 			  GError **error)
 {
 	EBookBackendEws *bbews;
+	EEwsConnection *cnc;
 	EBookCache *book_cache;
+	gchar *folder_id;
 	gboolean success = TRUE;
 	GError *local_error = NULL;
 
@@ -3355,7 +5192,16 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 	book_cache = e_book_meta_backend_ref_cache (meta_backend);
 	g_return_val_if_fail (E_IS_BOOK_CACHE (book_cache), FALSE);
 
-	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+	cnc = ebb_ews_ref_connection_sync (bbews, error);
+	if (!cnc) {
+		g_object_unref (book_cache);
+		return FALSE;
+	}
+
+	folder_id = ebb_ews_dup_folder_id (bbews);
+
+	if (!last_sync_tag && !is_repeat)
+		ebb_ews_dl_forget_all_cached (book_cache, cancellable);
 
 	if (bbews->priv->is_gal) {
 		CamelEwsSettings *ews_settings;
@@ -3370,12 +5216,23 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 			GSList *full_l = NULL, *deltas = NULL, *link;
 			EwsOALDetails *full = NULL;
 			gchar *password, *etag = NULL;
+			gboolean thin_gal;
 			gint sequence;
 
 			sequence = e_cache_get_key_int (E_CACHE (book_cache), "gal-sequence", NULL);
 			if (sequence == -1)
 				sequence = 0;
 
+			thin_gal = ebb_ews_thin_gal_is_enabled (bbews);
+
+			/* The mode changed, thus download the full file and rebuild the cache or the index */
+			if ((e_cache_get_key_int (E_CACHE (book_cache), EBB_EWS_THIN_GAL_KEY, NULL) == 1) != thin_gal) {
+				sequence = 0;
+				last_sync_tag = NULL;
+
+				ebb_ews_dl_forget_all_cached (book_cache, cancellable);
+			}
+
 			oab_cnc = e_ews_connection_new_for_backend (E_BACKEND (bbews), e_book_backend_get_registry (E_BOOK_BACKEND (bbews)), oab_url, ews_settings);
 
 			e_binding_bind_property (
@@ -3383,12 +5240,12 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 				oab_cnc, "proxy-resolver",
 				G_BINDING_SYNC_CREATE);
 
-			password = e_ews_connection_dup_password (bbews->priv->cnc);
+			password = e_ews_connection_dup_password (cnc);
 			e_ews_connection_set_password (oab_cnc, password);
 			e_util_safe_free_string (password);
 
 			d (printf ("Ewsgal: Fetching oal full details file\n"));
-			if (!e_ews_connection_get_oal_detail_sync (oab_cnc, bbews->priv->folder_id, NULL, last_sync_tag, &full_l, &etag, cancellable, &local_error)) {
+			if (!e_ews_connection_get_oal_detail_sync (oab_cnc, folder_id, NULL, last_sync_tag, &full_l, &etag, cancellable, &local_error)) {
 				if (g_error_matches (local_error, SOUP_HTTP_ERROR, SOUP_STATUS_NOT_MODIFIED)) {
 					g_clear_error (&local_error);
 				} else {
@@ -3428,40 +5285,67 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 			}
 
 			if (full) {
-				gchar *uncompressed_filename;
+				gchar *uncompressed_filename, *temp_filename = NULL;
+				gboolean is_delta = FALSE;
 
-				uncompressed_filename = ebb_ews_download_gal (bbews, book_cache, full, deltas, sequence, cancellable, &local_error);
+				uncompressed_filename = ebb_ews_download_gal (bbews, book_cache, full, deltas, sequence, &is_delta, cancellable, &local_error);
 				if (!uncompressed_filename) {
 					success = FALSE;
 				} else {
-					d (printf ("Ewsgal: Removing old gal\n"));
-					/* remove old_gal_file */
-					ebb_ews_remove_old_gal_file (book_cache);
+					gchar *old_filename;
 
 					d (printf ("Ewsgal: Check for changes in GAL\n"));
-					success = ebb_ews_check_gal_changes (bbews, book_cache, uncompressed_filename,
-						out_created_objects, out_modified_objects, out_removed_objects, cancellable, &local_error);
+
+					temp_filename = ebb_ews_dup_gal_temp_filename (uncompressed_filename);
+					old_filename = e_cache_dup_key (E_CACHE (book_cache), "oab-filename", NULL);
+
+					if (thin_gal) {
+						success = ebb_ews_check_gal_thin_changes (bbews, book_cache, temp_filename,
+							out_removed_objects, cancellable, &local_error);
+					} else if (is_delta) {
+						success = old_filename && ebb_ews_check_gal_delta_changes (bbews, old_filename, temp_filename,
+							out_created_objects, out_modified_objects, out_removed_objects, cancellable, &local_error);
+
+						/* Fallback to the full comparison with the cache content */
+						if (!success && !g_cancellable_is_cancelled (cancellable)) {
+							g_clear_error (&local_error);
+							is_delta = FALSE;
+						}
+					}
+
+					if (!thin_gal && !is_delta) {
+						success = ebb_ews_check_gal_changes (bbews, book_cache, temp_filename,
+							out_created_objects, out_modified_objects, out_removed_objects, cancellable, &local_error);
+					}
+
+					/* Any opened file is replaced now */
+					if (success)
+						success = ebb_ews_install_gal_file (bbews, temp_filename, uncompressed_filename, &local_error);
 
 					if (success) {
-						if (e_cache_set_key (E_CACHE (book_cache), "oab-filename", uncompressed_filename, NULL)) {
-							/* Don't let it get deleted */
-							g_free (uncompressed_filename);
-							uncompressed_filename = NULL;
+						if (e_cache_set_key (E_CACHE (book_cache), "oab-filename", uncompressed_filename, NULL) &&
+						    old_filename && g_strcmp0 (old_filename, uncompressed_filename) != 0) {
+							d (printf ("Ewsgal: Removing old gal\n"));
+							ebb_ews_unlink_gal_file (old_filename);
 						}
 
 						e_cache_set_key_int (E_CACHE (book_cache), "gal-sequence", full->seq, NULL);
+						e_cache_set_key_int (E_CACHE (book_cache), EBB_EWS_THIN_GAL_KEY, thin_gal ? 1 : 0, NULL);
 
 						d (printf ("Ewsgal: sync successfully completed\n"));
 					}
 
+					g_free (old_filename);
 					ews_oal_details_free (full);
 				}
 
-				if (uncompressed_filename) {
-					/* preserve  the oab file once we are able to decode the differential updates */
-					g_unlink (uncompressed_filename);
-					g_free (uncompressed_filename);
+				/* Only the not installed new file is removed, never the current one */
+				if (temp_filename) {
+					ebb_ews_unlink_gal_file (temp_filename);
+					g_free (temp_filename);
 				}
+
+				g_free (uncompressed_filename);
 			}
 
 			g_slist_free_full (full_l, (GDestroyNotify) ews_oal_details_free);
@@ -3484,8 +5368,12 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 		GSList *items_created = NULL, *items_modified = NULL, *items_deleted = NULL, *link;
 		gboolean includes_last_item = TRUE;
 
-		success = e_ews_connection_sync_folder_items_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-			last_sync_tag, bbews->priv->folder_id, "IdOnly", NULL, EWS_MAX_FETCH_COUNT,
+		/* The cache is complete after the previous refresh */
+		if (!is_repeat && last_sync_tag)
+			ebb_ews_collect_contact_photos (bbews, book_cache, cancellable);
+
+		success = e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM,
+			last_sync_tag, folder_id, "IdOnly", NULL, EWS_MAX_FETCH_COUNT,
 			out_new_sync_tag, &includes_last_item, &items_created, &items_modified, &items_deleted,
 			cancellable, &local_error);
 
@@ -3494,9 +5382,10 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 			g_clear_error (&local_error);
 
 			e_book_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
+			ebb_ews_dl_forget_all_cached (book_cache, cancellable);
 
-			success = e_ews_connection_sync_folder_items_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-				NULL, bbews->priv->folder_id, "IdOnly", NULL, EWS_MAX_FETCH_COUNT,
+			success = e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM,
+				NULL, folder_id, "IdOnly", NULL, EWS_MAX_FETCH_COUNT,
 				out_new_sync_tag, &includes_last_item, &items_created, &items_modified, &items_deleted,
 				cancellable, &local_error);
 		}
@@ -3526,6 +5415,9 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 
 				*out_removed_objects = g_slist_prepend (*out_removed_objects,
 					e_book_meta_backend_info_new (uid, NULL, NULL, NULL));
+
+				ebb_ews_forget_contact_photo (book_cache, uid);
+				ebb_ews_dl_forget_cached (book_cache, uid);
 			}
 
 			g_slist_free_full (contacts_created, g_object_unref);
@@ -3541,7 +5433,8 @@ ebb_ews_get_changes_sync (EBookMetaBackend *meta_backend,
 		g_slist_free_full (items_deleted, g_free);
 	}
 
-	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+	g_object_unref (cnc);
+	g_free (folder_id);
 
 	ebb_ews_convert_error_to_client_error (error);
 	ebb_ews_maybe_disconnect_sync (bbews, error, cancellable);
@@ -3561,6 +5454,8 @@ ebb_ews_load_contact_sync (EBookMetaBackend *meta_backend,
 			   GError **error)
 {
 	EBookBackendEws *bbews;
+	EEwsConnection *cnc;
+	EEwsAdditionalProps *add_props;
 	GSList *ids, *items = NULL;
 	gboolean success;
 
@@ -3570,13 +5465,23 @@ ebb_ews_load_contact_sync (EBookMetaBackend *meta_backend,
 
 	bbews = E_BOOK_BACKEND_EWS (meta_backend);
 
-	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+	if (ebb_ews_thin_gal_is_stored (bbews))
+		return ebb_ews_thin_gal_load_contact_sync (bbews, uid, out_contact, cancellable, error);
+
+	cnc = ebb_ews_ref_connection_sync (bbews, error);
+	if (!cnc)
+		return FALSE;
 
 	ids = g_slist_prepend (NULL, (gpointer) uid);
 
-	success = e_ews_connection_get_items_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM, ids, "IdOnly",
-		NULL, FALSE, NULL, E_EWS_BODY_TYPE_TEXT, &items, NULL, NULL, cancellable, error);
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup (CONTACT_ITEM_PROPS);
+
+	/* Read the whole contact at once; only distribution lists need more requests */
+	success = e_ews_connection_get_items_sync (cnc, EWS_PRIORITY_MEDIUM, ids, "Default",
+		add_props, FALSE, NULL, E_EWS_BODY_TYPE_TEXT, &items, NULL, NULL, cancellable, error);
 
+	e_ews_additional_props_free (add_props);
 	g_slist_free (ids);
 
 	if (!items)
@@ -3585,7 +5490,11 @@ ebb_ews_load_contact_sync (EBookMetaBackend *meta_backend,
 	if (success) {
 		GSList *contacts = NULL;
 
-		success = ebb_ews_fetch_items_sync (bbews, items, &contacts, cancellable, error);
+		if (e_ews_item_get_item_type (items->data) == E_EWS_ITEM_TYPE_CONTACT)
+			success = ebb_ews_items_to_contacts (bbews, items, &contacts, cancellable, error);
+		else
+			success = ebb_ews_fetch_items_sync (bbews, items, &contacts, cancellable, error);
+
 		if (success && contacts) {
 			*out_contact = g_object_ref (contacts->data);
 
@@ -3595,9 +5504,8 @@ ebb_ews_load_contact_sync (EBookMetaBackend *meta_backend,
 		g_slist_free_full (contacts, g_object_unref);
 	}
 
-	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
-
 	g_slist_free_full (items, g_object_unref);
+	g_object_unref (cnc);
 
 	ebb_ews_convert_error_to_client_error (error);
 	ebb_ews_maybe_disconnect_sync (bbews, error, cancellable);
@@ -3618,7 +5526,9 @@ ebb_ews_save_contact_sync (EBookMetaBackend *meta_backend,
 			   GError **error)
 {
 	EBookBackendEws *bbews;
+	EEwsConnection *cnc;
 	EwsFolderId *fid;
+	gchar *folder_id;
 	GSList *items = NULL;
 	gboolean is_dl = FALSE;
 	gboolean success;
@@ -3630,11 +5540,13 @@ ebb_ews_save_contact_sync (EBookMetaBackend *meta_backend,
 
 	bbews = E_BOOK_BACKEND_EWS (meta_backend);
 
-	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+	cnc = ebb_ews_ref_connection_sync (bbews, error);
+	if (!cnc)
+		return FALSE;
 
 	if (e_contact_get (contact, E_CONTACT_IS_LIST)) {
-		if (!e_ews_connection_satisfies_server_version (bbews->priv->cnc, E_EWS_EXCHANGE_2010)) {
-			g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+		if (!e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010)) {
+			g_object_unref (cnc);
 			g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_NOT_SUPPORTED,
 				_("Cannot save contact list, it’s only supported on EWS Server 2010 or later")));
 			return FALSE;
@@ -3643,7 +5555,10 @@ ebb_ews_save_contact_sync (EBookMetaBackend *meta_backend,
 		is_dl = TRUE;
 	}
 
-	fid = e_ews_folder_id_new (bbews->priv->folder_id, NULL, FALSE);
+	folder_id = ebb_ews_dup_folder_id (bbews);
+	fid = e_ews_folder_id_new (folder_id, NULL, FALSE);
+	g_free (folder_id);
+
 	if (overwrite_existing) {
 		EBookCache *book_cache;
 		EContact *old_contact = NULL;
@@ -3684,9 +5599,9 @@ ebb_ews_save_contact_sync (EBookMetaBackend *meta_backend,
 			if (conflict_resolution == E_CONFLICT_RESOLUTION_FAIL)
 				conflict_res = "NeverOverwrite";
 
-			success = e_ews_connection_update_items_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM,
+			success = e_ews_connection_update_items_sync (cnc, EWS_PRIORITY_MEDIUM,
 				conflict_res, "SendAndSaveCopy", "SendToAllAndSaveCopy",
-				bbews->priv->folder_id, is_dl ? ebb_ews_convert_dl_to_updatexml_cb : ebb_ews_convert_contact_to_updatexml_cb,
+				fid->id, is_dl ? ebb_ews_convert_dl_to_updatexml_cb : ebb_ews_convert_contact_to_updatexml_cb,
 				&cd, &items, cancellable, error);
 
 			g_free (cd.change_key);
@@ -3695,7 +5610,7 @@ ebb_ews_save_contact_sync (EBookMetaBackend *meta_backend,
 		g_clear_object (&old_contact);
 		g_clear_object (&book_cache);
 	} else {
-		success = e_ews_connection_create_items_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM, NULL, NULL,
+		success = e_ews_connection_create_items_sync (cnc, EWS_PRIORITY_MEDIUM, NULL, NULL,
 			fid, is_dl ? ebb_ews_convert_dl_to_xml_cb : ebb_ews_convert_contact_to_xml_cb, contact,
 			&items, cancellable, error);
 	}
@@ -3712,7 +5627,7 @@ ebb_ews_save_contact_sync (EBookMetaBackend *meta_backend,
 		 * We don't want to try to set/get this property if we are running in older version of the server.
 		 */
 		if (!overwrite_existing &&
-		    e_ews_connection_satisfies_server_version (bbews->priv->cnc, E_EWS_EXCHANGE_2010_SP2)) {
+		    e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010_SP2)) {
 			EContactPhoto *photo;
 
 			/*
@@ -3738,8 +5653,7 @@ ebb_ews_save_contact_sync (EBookMetaBackend *meta_backend,
 
 	g_slist_free_full (items, g_object_unref);
 	e_ews_folder_id_free (fid);
-
-	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+	g_object_unref (cnc);
 
 	ebb_ews_convert_error_to_client_error (error);
 	ebb_ews_maybe_disconnect_sync (bbews, error, cancellable);
@@ -3758,6 +5672,7 @@ ebb_ews_remove_contact_sync (EBookMetaBackend *meta_backend,
 			     GError **error)
 {
 	EBookBackendEws *bbews;
+	EEwsConnection *cnc;
 	GSList *ids;
 	gboolean success;
 
@@ -3765,15 +5680,26 @@ ebb_ews_remove_contact_sync (EBookMetaBackend *meta_backend,
 
 	bbews = E_BOOK_BACKEND_EWS (meta_backend);
 
-	g_rec_mutex_lock (&bbews->priv->cnc_lock);
+	cnc = ebb_ews_ref_connection_sync (bbews, error);
+	if (!cnc)
+		return FALSE;
 
 	ids = g_slist_prepend (NULL, (gpointer) uid);
 
-	success = e_ews_connection_delete_items_sync (bbews->priv->cnc, EWS_PRIORITY_MEDIUM, ids, EWS_HARD_DELETE, 0, FALSE, cancellable, error);
+	success = e_ews_connection_delete_items_sync (cnc, EWS_PRIORITY_MEDIUM, ids, EWS_HARD_DELETE, 0, FALSE, cancellable, error);
 
-	g_slist_free (ids);
+	if (success) {
+		EBookCache *book_cache;
 
-	g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+		book_cache = e_book_meta_backend_ref_cache (meta_backend);
+		if (book_cache) {
+			ebb_ews_dl_forget_cached (book_cache, uid);
+			g_object_unref (book_cache);
+		}
+	}
+
+	g_slist_free (ids);
+	g_object_unref (cnc);
 
 	ebb_ews_convert_error_to_client_error (error);
 	ebb_ews_maybe_disconnect_sync (bbews, error, cancellable);
@@ -3808,49 +5734,51 @@ ebb_ews_search_sync (EBookMetaBackend *meta_backend,
 
 		ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (bbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
 		if (e_source_ews_folder_get_fetch_gal_photos (ews_folder)) {
-			g_rec_mutex_lock (&bbews->priv->cnc_lock);
+			GSList *link, *uids = NULL;
+			gint count = 10;
+
+			/* Limit to first 10 without photo, no need to flood the server;
+			   these are fetched before any other pending photos */
+			for (link = *out_contacts; link && count > 0; link = g_slist_next (link)) {
+				EContact *contact = link->data;
 
-			if (bbews->priv->cnc && e_ews_connection_satisfies_server_version (bbews->priv->cnc, E_EWS_EXCHANGE_2013)) {
-				GSList *link, *modified = NULL;
-				gint count = 10;
+				if (!contact || e_vcard_get_attribute (E_VCARD (contact), EVC_PHOTO) ||
+				    !ebb_ews_can_check_user_photo (contact))
+					continue;
 
-				/* Limit to first 10 without photo, no need to flood the server
-				   and slow the response too much */
-				for (link = *out_contacts; link && count > 0 && !g_cancellable_is_cancelled (cancellable); link = g_slist_next (link)) {
-					EContact *contact = link->data;
-					EBookMetaBackendInfo *nfo;
-					GError *local_error = NULL;
+				count--;
 
-					if (!contact || e_vcard_get_attribute (E_VCARD (contact), EVC_PHOTO) ||
-					    !ebb_ews_can_check_user_photo (contact))
-						continue;
+				uids = g_slist_prepend (uids, (gpointer) e_contact_get_const (contact, E_CONTACT_UID));
+			}
 
-					count--;
+			uids = g_slist_reverse (uids);
 
-					if (!ebb_ews_fetch_gal_photo_sync (bbews, contact, cancellable, &local_error))
-						ebb_ews_store_photo_check_date (contact, NULL);
+			ebb_ews_photos_schedule (bbews, uids, TRUE);
 
-					nfo = ebb_ews_contact_to_info (contact, bbews->priv->is_gal);
-					if (nfo)
-						modified = g_slist_prepend (modified, nfo);
+			g_slist_free (uids);
+		}
+	}
 
-					/* Stop immediately when the server is busy */
-					if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_SERVERBUSY)) {
-						g_clear_error (&local_error);
-						break;
-					}
+	if (out_contacts && ebb_ews_thin_gal_is_stored (bbews)) {
+		GSList *contacts = NULL, *link;
 
-					g_clear_error (&local_error);
-				}
+		if (!ebb_ews_thin_gal_search_sync (bbews, expr, &contacts, cancellable, error))
+			return FALSE;
 
-				if (modified) {
-					e_book_meta_backend_process_changes_sync (meta_backend, NULL, modified, NULL, cancellable, NULL);
-					g_slist_free_full (modified, e_book_meta_backend_info_free);
-				}
-			}
+		if (meta_contact) {
+			for (link = contacts; link; link = g_slist_next (link)) {
+				EContact *contact = link->data, *meta;
+
+				meta = e_contact_new ();
+				e_contact_set (meta, E_CONTACT_UID, e_contact_get_const (contact, E_CONTACT_UID));
+				e_contact_set (meta, E_CONTACT_REV, e_contact_get_const (contact, E_CONTACT_REV));
 
-			g_rec_mutex_unlock (&bbews->priv->cnc_lock);
+				link->data = meta;
+				g_object_unref (contact);
+			}
 		}
+
+		*out_contacts = g_slist_concat (*out_contacts, contacts);
 	}
 
 	return TRUE;
@@ -3863,14 +5791,36 @@ ebb_ews_search_uids_sync (EBookMetaBackend *meta_backend,
 			  GCancellable *cancellable,
 			  GError **error)
 {
+	EBookBackendEws *bbews;
+
 	g_return_val_if_fail (E_IS_BOOK_BACKEND_EWS (meta_backend), FALSE);
 
+	bbews = E_BOOK_BACKEND_EWS (meta_backend);
+
 	/* Ignore errors, just try its best */
-	ebb_ews_update_cache_for_expression (E_BOOK_BACKEND_EWS (meta_backend), expr, cancellable, NULL);
+	ebb_ews_update_cache_for_expression (bbews, expr, cancellable, NULL);
 
 	/* Chain up to parent's method */
-	return E_BOOK_META_BACKEND_CLASS (e_book_backend_ews_parent_class)->search_uids_sync (meta_backend, expr,
-		out_uids, cancellable, error);
+	if (!E_BOOK_META_BACKEND_CLASS (e_book_backend_ews_parent_class)->search_uids_sync (meta_backend, expr,
+		out_uids, cancellable, error))
+		return FALSE;
+
+	if (out_uids && ebb_ews_thin_gal_is_stored (bbews)) {
+		GSList *contacts = NULL, *link;
+
+		if (!ebb_ews_thin_gal_search_sync (bbews, expr, &contacts, cancellable, error))
+			return FALSE;
+
+		for (link = contacts; link; link = g_slist_next (link)) {
+			EContact *contact = link->data;
+
+			*out_uids = g_slist_prepend (*out_uids, e_contact_get (contact, E_CONTACT_UID));
+		}
+
+		g_slist_free_full (contacts, g_object_unref);
+	}
+
+	return TRUE;
 }
 
 static gchar *
@@ -3988,10 +5938,88 @@ ebb_ews_get_destination_address (EBackend *backend,
 	return result;
 }
 
+static void
+ebb_ews_remove_photos_dir (const gchar *photos_dir)
+{
+	GDir *dir;
+
+	dir = g_dir_open (photos_dir, 0, NULL);
+
+	if (dir) {
+		const gchar *name;
+
+		while (name = g_dir_read_name (dir), name) {
+			gchar *filename;
+
+			filename = g_build_filename (photos_dir, name, NULL);
+			g_unlink (filename);
+			g_free (filename);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_rmdir (photos_dir);
+}
+
+/* The photos directories are not in the cache directory of the source,
+   thus they are removed here; the directories of the sources removed
+   while no backend was running are removed when any backend starts */
+static void
+ebb_ews_remove_stale_photos_dirs (ESourceRegistry *registry)
+{
+	GDir *dir;
+	gchar *dirname;
+
+	dirname = g_build_filename (e_get_user_cache_dir (), "ews-photos", NULL);
+	dir = g_dir_open (dirname, 0, NULL);
+
+	if (dir) {
+		const gchar *name;
+
+		while (name = g_dir_read_name (dir), name) {
+			ESource *source;
+
+			source = e_source_registry_ref_source (registry, name);
+
+			if (source) {
+				g_object_unref (source);
+			} else {
+				gchar *photos_dir;
+
+				photos_dir = g_build_filename (dirname, name, NULL);
+				ebb_ews_remove_photos_dir (photos_dir);
+				g_free (photos_dir);
+			}
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_free (dirname);
+}
+
+static void
+ebb_ews_source_removed_cb (ESourceRegistry *registry,
+			   ESource *source,
+			   gpointer user_data)
+{
+	EBookBackendEws *bbews = user_data;
+
+	g_return_if_fail (E_IS_BOOK_BACKEND_EWS (bbews));
+
+	if (g_strcmp0 (e_source_get_uid (source), e_source_get_uid (e_backend_get_source (E_BACKEND (bbews)))) != 0)
+		return;
+
+	ebb_ews_photos_stop (bbews);
+	ebb_ews_remove_photos_dir (bbews->priv->photos_dir);
+}
+
 static void
 e_book_backend_ews_constructed (GObject *object)
 {
 	EBookBackendEws *bbews = E_BOOK_BACKEND_EWS (object);
+	ESourceRegistry *registry;
 	EBookCache *book_cache;
 	gchar *cache_dirname;
 
@@ -4007,7 +6035,24 @@ e_book_backend_ews_constructed (GObject *object)
 	bbews->priv->attachments_dir = g_build_filename (cache_dirname, "attachments", NULL);
 	g_mkdir_with_parents (bbews->priv->attachments_dir, 0777);
 
+	/* Not in the cache directory, in which the EBookMetaBackend removes
+	   the photo files together with the contacts, while these are shared */
+	bbews->priv->photos_dir = g_build_filename (e_get_user_cache_dir (), "ews-photos",
+		e_source_get_uid (e_backend_get_source (E_BACKEND (bbews))), NULL);
+
 	g_free (cache_dirname);
+
+	g_signal_connect (bbews, "refresh-completed",
+		G_CALLBACK (ebb_ews_photos_refresh_completed_cb), NULL);
+
+	registry = e_book_backend_get_registry (E_BOOK_BACKEND (bbews));
+
+	if (registry) {
+		ebb_ews_remove_stale_photos_dirs (registry);
+
+		g_signal_connect_object (registry, "source-removed",
+			G_CALLBACK (ebb_ews_source_removed_cb), bbews, 0);
+	}
 }
 
 static void
@@ -4015,6 +6060,9 @@ e_book_backend_ews_dispose (GObject *object)
 {
 	EBookBackendEws *bbews = E_BOOK_BACKEND_EWS (object);
 
+	ebb_ews_photos_stop (bbews);
+	ebb_ews_thin_gal_close (bbews);
+
 	g_rec_mutex_lock (&bbews->priv->cnc_lock);
 
 	g_clear_object (&bbews->priv->cnc);
@@ -4032,6 +6080,16 @@ e_book_backend_ews_finalize (GObject *object)
 
 	g_free (bbews->priv->folder_id);
 	g_free (bbews->priv->attachments_dir);
+	g_free (bbews->priv->photos_dir);
+
+	g_clear_object (&bbews->priv->photos_cancellable);
+	g_hash_table_destroy (bbews->priv->photos_pending);
+	g_slist_free_full (bbews->priv->photos_deferred, g_free);
+	g_slist_free_full (bbews->priv->photos_results, e_book_meta_backend_info_free);
+	g_mutex_clear (&bbews->priv->photos_lock);
+	g_cond_clear (&bbews->priv->photos_cond);
+
+	g_mutex_clear (&bbews->priv->thin_gal_lock);
 
 	g_rec_mutex_clear (&bbews->priv->cnc_lock);
 
@@ -4045,6 +6103,13 @@ e_book_backend_ews_init (EBookBackendEws *bbews)
 	bbews->priv = G_TYPE_INSTANCE_GET_PRIVATE (bbews, E_TYPE_BOOK_BACKEND_EWS, EBookBackendEwsPrivate);
 
 	g_rec_mutex_init (&bbews->priv->cnc_lock);
+
+	g_mutex_init (&bbews->priv->photos_lock);
+	g_cond_init (&bbews->priv->photos_cond);
+	bbews->priv->photos_cancellable = g_cancellable_new ();
+	bbews->priv->photos_pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_mutex_init (&bbews->priv->thin_gal_lock);
 }
 
 static void
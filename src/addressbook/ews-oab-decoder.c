@@ -185,7 +185,8 @@ ews_populate_photo (EContact *contact,
 	gboolean success = TRUE;
 	GError *local_error = NULL;
 
-	if (!bytes)
+	/* No cache directory means no interest in photos */
+	if (!bytes || !priv->cache_dir)
 		return;
 
 	email = e_contact_get (contact, E_CONTACT_EMAIL_1);
@@ -324,22 +325,27 @@ ews_oab_decoder_new (const gchar *oab_filename,
 {
 	EwsOabDecoder *eod;
 	EwsOabDecoderPrivate *priv;
+	GMappedFile *mapped;
+	GBytes *bytes;
 	GError *err = NULL;
-	GFile *gf = NULL;
 
 	eod = g_object_new (EWS_TYPE_OAB_DECODER, NULL);
 	priv = GET_PRIVATE (eod);
 
-	gf = g_file_new_for_path (oab_filename);
-	priv->fis = (GInputStream *)g_file_read (gf, NULL, &err);
+	/* The file is read by many small chunks, which is way cheaper
+	   from the memory than through the file stream */
+	mapped = g_mapped_file_new (oab_filename, FALSE, &err);
 	if (err)
 		goto exit;
 
+	bytes = g_mapped_file_get_bytes (mapped);
+	priv->fis = g_memory_input_stream_new_from_bytes (bytes);
+	g_bytes_unref (bytes);
+	g_mapped_file_unref (mapped);
+
 	priv->cache_dir = g_strdup (cache_dir);
 
 exit:
-	if (gf)
-		g_object_unref (gf);
 	if (err) {
 		g_propagate_error (error, err);
 		g_object_unref (eod);
@@ -984,6 +990,61 @@ exit:
 	return ret;
 }
 
+/* Skips the size and the header record, which precede the address-book records */
+static gboolean
+ews_skip_header_record (EwsOabDecoder *eod,
+			GCancellable *cancellable,
+			GError **error)
+{
+	EwsOabDecoderPrivate *priv = GET_PRIVATE (eod);
+
+	/* eat the size */
+	ews_oab_read_uint32 (
+		priv->fis,
+		cancellable, error);
+
+	if (*error)
+		return FALSE;
+
+	ews_decode_addressbook_record (eod, priv->fis, NULL,
+				       priv->hdr_props, cancellable, error);
+
+	return !*error;
+}
+
+/* Reads next address-book record into the @precord_buf, growing it as needed */
+static gboolean
+ews_read_next_record (EwsOabDecoder *eod,
+		      guchar **precord_buf,
+		      guint32 *pbuf_len,
+		      goffset *poffset,
+		      guint32 *prec_size,
+		      GCancellable *cancellable,
+		      GError **error)
+{
+	EwsOabDecoderPrivate *priv = GET_PRIVATE (eod);
+	guint32 rec_size;
+
+	/* eat the size */
+	rec_size = ews_oab_read_uint32 (priv->fis, cancellable, error);
+	if (*error || rec_size < 4)
+		return FALSE;
+
+	rec_size -= 4;
+
+	if (rec_size > *pbuf_len) {
+		g_free (*precord_buf);
+		*precord_buf = g_malloc (rec_size);
+		*pbuf_len = rec_size;
+	}
+
+	/* fetch the offset */
+	*poffset = g_seekable_tell ((GSeekable *) priv->fis);
+	*prec_size = rec_size;
+
+	return g_input_stream_read (priv->fis, *precord_buf, rec_size, cancellable, error) == rec_size;
+}
+
 /* Decodes the hdr and address-book records and stores the address-book records inside the db */
 static gboolean
 ews_decode_and_store_oab_records (EwsOabDecoder *eod,
@@ -995,26 +1056,16 @@ ews_decode_and_store_oab_records (EwsOabDecoder *eod,
 {
 	EwsOabDecoderPrivate *priv = GET_PRIVATE (eod);
 	gboolean ret = FALSE;
-	guint32 i;
-	int buf_len = 200;
+	guint32 i, buf_len = 200;
 	guchar *record_buf = g_malloc (buf_len);
 	GChecksum *sum = g_checksum_new (G_CHECKSUM_SHA1);
 
 	if (!record_buf || !sum)
 		goto exit;
 
-	/* eat the size */
-	ews_oab_read_uint32 (
-		priv->fis,
-		cancellable, error);
-
-	ews_decode_addressbook_record (eod, priv->fis, NULL,
-				       priv->hdr_props, cancellable, error);
-
-	if (*error)
+	if (!ews_skip_header_record (eod, cancellable, error))
 		goto exit;
 
-
 	for (i = 0; i < priv->total_records; i++) {
 		EContact *contact;
 		goffset offset;
@@ -1022,26 +1073,10 @@ ews_decode_and_store_oab_records (EwsOabDecoder *eod,
 		GInputStream *memstream;
 		const gchar *sum_str;
 
-		contact = e_contact_new ();
-
-		/* eat the size */
-		rec_size = ews_oab_read_uint32 (priv->fis, cancellable, error);
-		if (rec_size < 4)
+		if (!ews_read_next_record (eod, &record_buf, &buf_len, &offset, &rec_size, cancellable, error))
 			goto exit;
 
-		rec_size -= 4;
-
-		if (rec_size > buf_len) {
-			g_free (record_buf);
-			record_buf = g_malloc(rec_size);
-			buf_len = rec_size;
-			if (!record_buf)
-				goto exit;
-		}
-		/* fetch the offset */
-		offset = g_seekable_tell ((GSeekable *) priv->fis);
-		if (g_input_stream_read (priv->fis, record_buf, rec_size, cancellable, error) != rec_size)
-			goto exit;
+		contact = e_contact_new ();
 
 		g_checksum_reset (sum);
 		g_checksum_update (sum, record_buf, rec_size);
@@ -1142,6 +1177,28 @@ ews_oab_decoder_set_oab_prop_string (EwsOabDecoder *eod,
 	return TRUE;
 }
 
+/* Reads the OAB header and the property lists from the beginning of the file */
+static gboolean
+ews_oab_decoder_read_metadata (EwsOabDecoder *eod,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	EwsOabDecoderPrivate *priv = GET_PRIVATE (eod);
+	EwsOabHdr *o_hdr;
+
+	if (!g_seekable_seek ((GSeekable *) priv->fis, 0, G_SEEK_SET, cancellable, error))
+		return FALSE;
+
+	o_hdr = ews_read_oab_header (eod, priv->fis, cancellable, error);
+	if (!o_hdr)
+		return FALSE;
+
+	priv->total_records = o_hdr->total_recs;
+	g_free (o_hdr);
+
+	return ews_decode_metadata (eod, priv->fis, cancellable, error);
+}
+
 /**
  * ews_oab_decoder_decode 
  * @eod: 
@@ -1162,34 +1219,91 @@ ews_oab_decoder_decode (EwsOabDecoder *eod,
 {
 	EwsOabDecoderPrivate *priv = GET_PRIVATE (eod);
 	GError *err = NULL;
-	EwsOabHdr *o_hdr;
-	gboolean ret = TRUE;
+	gboolean ret;
 
-	o_hdr = ews_read_oab_header (eod, priv->fis, cancellable, &err);
-	if (!o_hdr) {
-		ret = FALSE;
+	ret = ews_oab_decoder_read_metadata (eod, cancellable, &err);
+	if (!ret)
 		goto exit;
-	}
 
-	priv->total_records = o_hdr->total_recs;
 	g_print ("Total records is %d \n", priv->total_records);
 
-	ret = ews_decode_metadata (eod, priv->fis, cancellable, &err);
-	if (!ret)
-		goto exit;
-
 	ret = ews_decode_and_store_oab_records (
 		eod, filter_cb, cb, user_data, cancellable, &err);
 exit:
-	if (o_hdr)
-		g_free (o_hdr);
-
 	if (err)
 		g_propagate_error (error, err);
 
 	return ret;
 }
 
+/**
+ * ews_oab_decoder_dup_record_sums
+ * @eod: an #EwsOabDecoder
+ * @cancellable: optional #GCancellable object, or %NULL
+ * @error: return location for a #GError, or %NULL
+ *
+ * Walks all the address-book records without decoding them and computes
+ * SHA1 of each of them. That is way cheaper than ews_oab_decoder_decode()
+ * and it can be used to find which records changed between two versions
+ * of the OAB file, like after applying differential patches.
+ *
+ * Returns: (transfer full): a #GHashTable with SHA1 string as the key and
+ *    a pointer to a #goffset of the record as the value, suitable for
+ *    ews_oab_decoder_get_contact_from_offset(), or %NULL on error.
+ **/
+GHashTable *
+ews_oab_decoder_dup_record_sums (EwsOabDecoder *eod,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	EwsOabDecoderPrivate *priv = GET_PRIVATE (eod);
+	GHashTable *sums;
+	GChecksum *sum;
+	guint32 i, buf_len = 200;
+	guchar *record_buf;
+	GError *err = NULL;
+
+	if (!ews_oab_decoder_read_metadata (eod, cancellable, &err) ||
+	    !ews_skip_header_record (eod, cancellable, &err)) {
+		g_propagate_error (error, err);
+		return NULL;
+	}
+
+	sums = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	sum = g_checksum_new (G_CHECKSUM_SHA1);
+	record_buf = g_malloc (buf_len);
+
+	for (i = 0; i < priv->total_records; i++) {
+		goffset offset, *poffset;
+		guint32 rec_size;
+
+		if (!ews_read_next_record (eod, &record_buf, &buf_len, &offset, &rec_size, cancellable, &err)) {
+			if (!err)
+				g_set_error_literal (&err, EOD_ERROR, 1, "Failed to read address-book record");
+			break;
+		}
+
+		g_checksum_reset (sum);
+		g_checksum_update (sum, record_buf, rec_size);
+
+		poffset = g_new (goffset, 1);
+		*poffset = offset;
+
+		g_hash_table_insert (sums, g_strdup (g_checksum_get_string (sum)), poffset);
+	}
+
+	g_checksum_free (sum);
+	g_free (record_buf);
+
+	if (err) {
+		g_propagate_error (error, err);
+		g_hash_table_destroy (sums);
+		sums = NULL;
+	}
+
+	return sums;
+}
+
 EContact *
 ews_oab_decoder_get_contact_from_offset (EwsOabDecoder *eod,
                                          goffset offset,
@@ -1200,6 +1314,9 @@ ews_oab_decoder_get_contact_from_offset (EwsOabDecoder *eod,
 	EwsOabDecoderPrivate *priv = GET_PRIVATE (eod);
 	EContact *contact = NULL;
 
+	if (!oab_props)
+		oab_props = priv->oab_props;
+
 	if (!g_seekable_seek ((GSeekable *) priv->fis, offset, G_SEEK_SET, cancellable, error))
 		return NULL;
 
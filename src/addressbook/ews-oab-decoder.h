@@ -78,6 +78,9 @@ gboolean	ews_oab_decoder_decode		(EwsOabDecoder *eod,
 						 gpointer user_data,
 						 GCancellable *cancellable,
 						 GError **error);
+GHashTable *	ews_oab_decoder_dup_record_sums	(EwsOabDecoder *eod,
+						 GCancellable *cancellable,
+						 GError **error);
 EContact *	ews_oab_decoder_get_contact_from_offset
 						(EwsOabDecoder *eod,
 						 goffset offset,
@@ -23,6 +23,7 @@
 #include "evolution-ews-config.h"
 
 #include <glib.h>
+#include <glib/gstdio.h>
 #include "ews-oab-decompress.h"
 #include <mspack.h>
 
@@ -80,3 +81,47 @@ ews_oab_decompress_patch (const gchar *filename, const gchar *orig_filename,
 	return TRUE;
 }
 
+/* Applies all the patches, in the given order, on top of the orig_filename.
+   The libmspack works with file names only, thus the intermediate results
+   are stored in two scratch files next to the output_filename. */
+gboolean
+ews_oab_decompress_patch_chain (const gchar *orig_filename,
+				const GSList *patch_filenames,
+				const gchar *output_filename,
+				GError **error)
+{
+	const GSList *link;
+	const gchar *reference;
+	gchar *scratch[2];
+	gint ii = 0;
+	gboolean success = TRUE;
+
+	if (!patch_filenames) {
+		g_set_error_literal (error, g_quark_from_string ("lzx"), 1,
+				     "No patch files to apply");
+		return FALSE;
+	}
+
+	scratch[0] = g_strconcat (output_filename, ".0", NULL);
+	scratch[1] = g_strconcat (output_filename, ".1", NULL);
+
+	reference = orig_filename;
+
+	for (link = patch_filenames; link && success; link = g_slist_next (link)) {
+		const gchar *target;
+
+		target = g_slist_next (link) ? scratch[ii] : output_filename;
+
+		success = ews_oab_decompress_patch (link->data, reference, target, error);
+
+		reference = target;
+		ii = 1 - ii;
+	}
+
+	g_unlink (scratch[0]);
+	g_unlink (scratch[1]);
+	g_free (scratch[0]);
+	g_free (scratch[1]);
+
+	return success;
+}
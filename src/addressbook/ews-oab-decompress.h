@@ -32,5 +32,9 @@ gboolean ews_oab_decompress_patch (const gchar *filename,
 				   const gchar *orig_filename,
 				   const gchar *output_filename,
 				   GError **error);
+gboolean ews_oab_decompress_patch_chain (const gchar *orig_filename,
+					 const GSList *patch_filenames,
+					 const gchar *output_filename,
+					 GError **error);
 
 #endif
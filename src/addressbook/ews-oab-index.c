@@ -0,0 +1,554 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-ews-config.h"
+
+#include <string.h>
+
+#include <glib/gi18n-lib.h>
+
+#include "ews-oab-index.h"
+
+/* The file layout, all numbers are little endian:
+      8 bytes   magic
+      4 bytes   number of entries
+      4 bytes   length of the OAB prop string
+      4 bytes   length of the string pool
+      4 bytes   reserved
+      n bytes   the OAB prop string, padded with zeros to a multiple of 8
+     16 bytes   for each entry, sorted by the token:
+                   4 bytes token offset in the string pool
+                   4 bytes token length
+                   8 bytes record offset in the OAB file
+      n bytes   the string pool; tokens are not nul-terminated
+*/
+
+#define INDEX_MAGIC "EWSOABX1"
+#define INDEX_MAGIC_LEN 8
+#define INDEX_HEADER_LEN (INDEX_MAGIC_LEN + 16)
+#define INDEX_ENTRY_LEN 16
+
+/* Prefixes tokens holding a contact UID, thus they do not match any user search */
+#define INDEX_UID_PREFIX "\001"
+
+typedef struct _IndexEntry {
+	const gchar *token; /* interned in EwsOabIndex::tokens */
+	goffset offset;
+} IndexEntry;
+
+struct _EwsOabIndex {
+	/* Used when writing */
+	GHashTable *tokens; /* gchar * ~> NULL */
+	GArray *entries; /* IndexEntry */
+
+	/* Used when reading */
+	GMappedFile *mapped_file;
+	const guchar *entries_data;
+	guint32 n_entries;
+	const gchar *pool;
+	guint32 pool_len;
+	gchar *oab_prop_string;
+};
+
+static guint32
+index_read_uint32 (const guchar *data)
+{
+	guint32 value;
+
+	memcpy (&value, data, sizeof (value));
+
+	return GUINT32_FROM_LE (value);
+}
+
+static guint64
+index_read_uint64 (const guchar *data)
+{
+	guint64 value;
+
+	memcpy (&value, data, sizeof (value));
+
+	return GUINT64_FROM_LE (value);
+}
+
+static void
+index_append_uint32 (GString *buffer,
+		     guint32 value)
+{
+	value = GUINT32_TO_LE (value);
+
+	g_string_append_len (buffer, (const gchar *) &value, sizeof (value));
+}
+
+static void
+index_append_uint64 (GString *buffer,
+		     guint64 value)
+{
+	value = GUINT64_TO_LE (value);
+
+	g_string_append_len (buffer, (const gchar *) &value, sizeof (value));
+}
+
+gchar *
+ews_oab_index_normalize (const gchar *str)
+{
+	gchar *normalized, *folded;
+
+	if (!str || !*str || !g_utf8_validate (str, -1, NULL))
+		return NULL;
+
+	normalized = g_utf8_normalize (str, -1, G_NORMALIZE_DEFAULT);
+	if (!normalized)
+		return NULL;
+
+	folded = g_utf8_casefold (normalized, -1);
+	g_free (normalized);
+
+	g_strstrip (folded);
+
+	if (!*folded) {
+		g_free (folded);
+		folded = NULL;
+	}
+
+	return folded;
+}
+
+EwsOabIndex *
+ews_oab_index_new_for_write (void)
+{
+	EwsOabIndex *index;
+
+	index = g_new0 (EwsOabIndex, 1);
+	index->tokens = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	index->entries = g_array_new (FALSE, FALSE, sizeof (IndexEntry));
+
+	return index;
+}
+
+static void
+index_add_token_take (EwsOabIndex *index,
+		      gchar *token,
+		      goffset offset)
+{
+	IndexEntry entry;
+	gpointer interned = NULL;
+
+	if (g_hash_table_lookup_extended (index->tokens, token, &interned, NULL)) {
+		g_free (token);
+	} else {
+		interned = token;
+		g_hash_table_insert (index->tokens, token, NULL);
+	}
+
+	entry.token = interned;
+	entry.offset = offset;
+
+	g_array_append_val (index->entries, entry);
+}
+
+/* Adds the whole value and each of its words */
+static void
+index_add_value (EwsOabIndex *index,
+		 const gchar *value,
+		 goffset offset)
+{
+	gchar *normalized;
+	const gchar *ptr, *word_start = NULL;
+
+	normalized = ews_oab_index_normalize (value);
+	if (!normalized)
+		return;
+
+	for (ptr = normalized; ; ptr = g_utf8_next_char (ptr)) {
+		gunichar chr = *ptr ? g_utf8_get_char (ptr) : 0;
+
+		if (chr && g_unichar_isalnum (chr)) {
+			if (!word_start)
+				word_start = ptr;
+		} else {
+			/* Words at the start are covered by the whole value */
+			if (word_start && word_start != normalized)
+				index_add_token_take (index, g_strndup (word_start, ptr - word_start), offset);
+
+			word_start = NULL;
+		}
+
+		if (!chr)
+			break;
+	}
+
+	index_add_token_take (index, normalized, offset);
+}
+
+void
+ews_oab_index_add_contact (EwsOabIndex *index,
+			   EContact *contact,
+			   goffset offset)
+{
+	EContactField fields[] = {
+		E_CONTACT_FULL_NAME,
+		E_CONTACT_GIVEN_NAME,
+		E_CONTACT_FAMILY_NAME,
+		E_CONTACT_NICKNAME
+	};
+	GList *emails, *link;
+	const gchar *uid;
+	gint ii;
+
+	g_return_if_fail (index != NULL);
+	g_return_if_fail (index->entries != NULL);
+	g_return_if_fail (E_IS_CONTACT (contact));
+
+	for (ii = 0; ii < G_N_ELEMENTS (fields); ii++) {
+		index_add_value (index, e_contact_get_const (contact, fields[ii]), offset);
+	}
+
+	emails = e_contact_get (contact, E_CONTACT_EMAIL);
+	for (link = emails; link; link = g_list_next (link)) {
+		index_add_value (index, link->data, offset);
+	}
+	g_list_free_full (emails, g_free);
+
+	uid = e_contact_get_const (contact, E_CONTACT_UID);
+	if (uid && *uid) {
+		gchar *normalized;
+
+		normalized = ews_oab_index_normalize (uid);
+		if (normalized) {
+			index_add_token_take (index, g_strconcat (INDEX_UID_PREFIX, normalized, NULL), offset);
+			g_free (normalized);
+		}
+	}
+}
+
+static gint
+index_compare_entries (gconstpointer aa,
+		       gconstpointer bb)
+{
+	const IndexEntry *entry1 = aa, *entry2 = bb;
+	gint res;
+
+	res = strcmp (entry1->token, entry2->token);
+	if (!res) {
+		if (entry1->offset < entry2->offset)
+			res = -1;
+		else if (entry1->offset > entry2->offset)
+			res = 1;
+	}
+
+	return res;
+}
+
+gboolean
+ews_oab_index_write (EwsOabIndex *index,
+		     const gchar *filename,
+		     const gchar *oab_prop_string,
+		     GError **error)
+{
+	GString *buffer, *pool;
+	GHashTable *pool_offsets; /* const gchar *token ~> offset + 1 */
+	const IndexEntry *prev = NULL;
+	guint32 n_entries = 0, pool_len;
+	gsize props_len, n_entries_pos;
+	gboolean success;
+	guint ii;
+
+	g_return_val_if_fail (index != NULL, FALSE);
+	g_return_val_if_fail (index->entries != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (oab_prop_string != NULL, FALSE);
+
+	g_array_sort (index->entries, index_compare_entries);
+
+	props_len = strlen (oab_prop_string);
+
+	buffer = g_string_sized_new (INDEX_HEADER_LEN + props_len + 8 + (index->entries->len * INDEX_ENTRY_LEN));
+	pool = g_string_new (NULL);
+	pool_offsets = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	g_string_append_len (buffer, INDEX_MAGIC, INDEX_MAGIC_LEN);
+	n_entries_pos = buffer->len;
+	index_append_uint32 (buffer, 0);
+	index_append_uint32 (buffer, props_len);
+	index_append_uint32 (buffer, 0);
+	index_append_uint32 (buffer, 0);
+
+	g_string_append_len (buffer, oab_prop_string, props_len);
+	while (buffer->len % 8)
+		g_string_append_c (buffer, 0);
+
+	for (ii = 0; ii < index->entries->len; ii++) {
+		const IndexEntry *entry = &g_array_index (index->entries, IndexEntry, ii);
+		gsize pool_offset;
+
+		/* Tokens are interned, thus the same token has the same pointer */
+		if (prev && prev->token == entry->token && prev->offset == entry->offset)
+			continue;
+
+		pool_offset = GPOINTER_TO_SIZE (g_hash_table_lookup (pool_offsets, entry->token));
+		if (!pool_offset) {
+			pool_offset = pool->len;
+			g_string_append (pool, entry->token);
+			g_hash_table_insert (pool_offsets, (gpointer) entry->token, GSIZE_TO_POINTER (pool_offset + 1));
+		} else {
+			pool_offset--;
+		}
+
+		index_append_uint32 (buffer, pool_offset);
+		index_append_uint32 (buffer, strlen (entry->token));
+		index_append_uint64 (buffer, entry->offset);
+
+		n_entries++;
+		prev = entry;
+	}
+
+	/* Fill the counts now, when they are known */
+	n_entries = GUINT32_TO_LE (n_entries);
+	memcpy (buffer->str + n_entries_pos, &n_entries, sizeof (guint32));
+	pool_len = GUINT32_TO_LE ((guint32) pool->len);
+	memcpy (buffer->str + n_entries_pos + 8, &pool_len, sizeof (guint32));
+
+	g_string_append_len (buffer, pool->str, pool->len);
+
+	success = g_file_set_contents (filename, buffer->str, buffer->len, error);
+
+	g_hash_table_destroy (pool_offsets);
+	g_string_free (pool, TRUE);
+	g_string_free (buffer, TRUE);
+
+	return success;
+}
+
+EwsOabIndex *
+ews_oab_index_open (const gchar *filename,
+		    GError **error)
+{
+	EwsOabIndex *index;
+	GMappedFile *mapped_file;
+	const guchar *data;
+	gsize data_len, entries_pos;
+	guint32 n_entries, props_len, pool_len, ii;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	mapped_file = g_mapped_file_new (filename, FALSE, error);
+	if (!mapped_file)
+		return NULL;
+
+	data = (const guchar *) g_mapped_file_get_contents (mapped_file);
+	data_len = g_mapped_file_get_length (mapped_file);
+
+	if (data_len < INDEX_HEADER_LEN || memcmp (data, INDEX_MAGIC, INDEX_MAGIC_LEN) != 0)
+		goto corrupt;
+
+	n_entries = index_read_uint32 (data + INDEX_MAGIC_LEN);
+	props_len = index_read_uint32 (data + INDEX_MAGIC_LEN + 4);
+	pool_len = index_read_uint32 (data + INDEX_MAGIC_LEN + 8);
+
+	entries_pos = INDEX_HEADER_LEN + props_len;
+	entries_pos += (8 - (entries_pos % 8)) % 8;
+
+	if (entries_pos > data_len ||
+	    (data_len - entries_pos) / INDEX_ENTRY_LEN < n_entries ||
+	    data_len - entries_pos - ((gsize) n_entries * INDEX_ENTRY_LEN) != pool_len)
+		goto corrupt;
+
+	index = g_new0 (EwsOabIndex, 1);
+	index->mapped_file = mapped_file;
+	index->entries_data = data + entries_pos;
+	index->n_entries = n_entries;
+	index->pool = (const gchar *) (index->entries_data + ((gsize) n_entries * INDEX_ENTRY_LEN));
+	index->pool_len = pool_len;
+	index->oab_prop_string = g_strndup ((const gchar *) data + INDEX_HEADER_LEN, props_len);
+
+	/* Verify the tokens do not point out of the pool, to not need to do it on each lookup */
+	for (ii = 0; ii < n_entries; ii++) {
+		const guchar *entry = index->entries_data + ((gsize) ii * INDEX_ENTRY_LEN);
+		guint32 token_offset = index_read_uint32 (entry), token_len = index_read_uint32 (entry + 4);
+
+		if (token_offset > pool_len || token_len > pool_len - token_offset) {
+			ews_oab_index_free (index);
+			mapped_file = NULL;
+			goto corrupt;
+		}
+	}
+
+	return index;
+
+ corrupt:
+	if (mapped_file)
+		g_mapped_file_unref (mapped_file);
+
+	g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, _("The GAL index file “%s” is corrupted"), filename);
+
+	return NULL;
+}
+
+const gchar *
+ews_oab_index_get_oab_prop_string (EwsOabIndex *index)
+{
+	g_return_val_if_fail (index != NULL, NULL);
+
+	return index->oab_prop_string;
+}
+
+/* Compares token of the entry at @idx with the @str; when @prefix_only is set,
+   then the entry, which starts with the @str, is considered equal */
+static gint
+index_compare_token (EwsOabIndex *index,
+		     guint32 idx,
+		     const gchar *str,
+		     gsize str_len,
+		     gboolean prefix_only)
+{
+	const guchar *entry = index->entries_data + ((gsize) idx * INDEX_ENTRY_LEN);
+	guint32 token_len = index_read_uint32 (entry + 4);
+	gint res;
+
+	res = memcmp (index->pool + index_read_uint32 (entry), str, MIN (token_len, str_len));
+	if (!res && token_len != str_len) {
+		if (token_len < str_len)
+			res = -1;
+		else if (!prefix_only)
+			res = 1;
+	}
+
+	return res;
+}
+
+static GArray *
+index_lookup (EwsOabIndex *index,
+	      const gchar *str,
+	      gboolean prefix_only,
+	      guint max_results)
+{
+	GArray *offsets;
+	GHashTable *known;
+	gsize str_len;
+	guint32 lo, hi;
+
+	offsets = g_array_new (FALSE, FALSE, sizeof (goffset));
+
+	if (!index->n_entries)
+		return offsets;
+
+	str_len = strlen (str);
+
+	/* Find the first matching entry */
+	lo = 0;
+	hi = index->n_entries;
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+
+		if (index_compare_token (index, mid, str, str_len, prefix_only) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	known = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, NULL);
+
+	for (; lo < index->n_entries && (!max_results || offsets->len < max_results); lo++) {
+		gint64 offset;
+
+		if (index_compare_token (index, lo, str, str_len, prefix_only) != 0)
+			break;
+
+		offset = (gint64) index_read_uint64 (index->entries_data + ((gsize) lo * INDEX_ENTRY_LEN) + 8);
+
+		/* One record can be matched by more tokens */
+		if (!g_hash_table_contains (known, &offset)) {
+			goffset value = offset;
+			gint64 *key;
+
+			key = g_new (gint64, 1);
+			*key = offset;
+
+			g_hash_table_add (known, key);
+			g_array_append_val (offsets, value);
+		}
+	}
+
+	g_hash_table_destroy (known);
+
+	return offsets;
+}
+
+/* Returns offsets of records which have any name or e-mail address, or any
+   of their words, beginning with the @prefix; free with g_array_unref() */
+GArray *
+ews_oab_index_lookup_prefix (EwsOabIndex *index,
+			     const gchar *prefix,
+			     guint max_results)
+{
+	GArray *offsets;
+	gchar *normalized;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (index->mapped_file != NULL, NULL);
+	g_return_val_if_fail (prefix != NULL, NULL);
+
+	normalized = ews_oab_index_normalize (prefix);
+	if (!normalized)
+		return g_array_new (FALSE, FALSE, sizeof (goffset));
+
+	offsets = index_lookup (index, normalized, TRUE, max_results);
+
+	g_free (normalized);
+
+	return offsets;
+}
+
+/* Returns offsets of records with the contact UID @uid; free with g_array_unref() */
+GArray *
+ews_oab_index_lookup_uid (EwsOabIndex *index,
+			  const gchar *uid)
+{
+	GArray *offsets;
+	gchar *normalized, *token;
+
+	g_return_val_if_fail (index != NULL, NULL);
+	g_return_val_if_fail (index->mapped_file != NULL, NULL);
+	g_return_val_if_fail (uid != NULL, NULL);
+
+	normalized = ews_oab_index_normalize (uid);
+	if (!normalized)
+		return g_array_new (FALSE, FALSE, sizeof (goffset));
+
+	token = g_strconcat (INDEX_UID_PREFIX, normalized, NULL);
+
+	offsets = index_lookup (index, token, FALSE, 0);
+
+	g_free (normalized);
+	g_free (token);
+
+	return offsets;
+}
+
+void
+ews_oab_index_free (EwsOabIndex *index)
+{
+	if (!index)
+		return;
+
+	if (index->entries)
+		g_array_unref (index->entries);
+	if (index->tokens)
+		g_hash_table_destroy (index->tokens);
+	if (index->mapped_file)
+		g_mapped_file_unref (index->mapped_file);
+	g_free (index->oab_prop_string);
+	g_free (index);
+}
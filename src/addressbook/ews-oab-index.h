@@ -0,0 +1,51 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef EWS_OAB_INDEX_H
+#define EWS_OAB_INDEX_H
+
+#include <libebook/libebook.h>
+
+G_BEGIN_DECLS
+
+/* A sorted list of search tokens (names and e-mail addresses, casefolded),
+   each pointing to an address-book record offset in the OAB file, thus
+   the records can be decoded on demand with
+   ews_oab_decoder_get_contact_from_offset(). */
+typedef struct _EwsOabIndex EwsOabIndex;
+
+EwsOabIndex *	ews_oab_index_new_for_write	(void);
+void		ews_oab_index_add_contact	(EwsOabIndex *index,
+						 EContact *contact,
+						 goffset offset);
+gboolean	ews_oab_index_write		(EwsOabIndex *index,
+						 const gchar *filename,
+						 const gchar *oab_prop_string,
+						 GError **error);
+EwsOabIndex *	ews_oab_index_open		(const gchar *filename,
+						 GError **error);
+const gchar *	ews_oab_index_get_oab_prop_string
+						(EwsOabIndex *index);
+GArray *	ews_oab_index_lookup_prefix	(EwsOabIndex *index,
+						 const gchar *prefix,
+						 guint max_results);
+GArray *	ews_oab_index_lookup_uid	(EwsOabIndex *index,
+						 const gchar *uid);
+gchar *		ews_oab_index_normalize		(const gchar *str);
+void		ews_oab_index_free		(EwsOabIndex *index);
+
+G_END_DECLS
+
+#endif /* EWS_OAB_INDEX_H */
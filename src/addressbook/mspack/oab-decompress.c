@@ -362,37 +362,17 @@ exit:
 	return	lzx_b;
 }
 
-gboolean
-ews_oab_decompress_patch (const gchar *filename, const gchar *orig_filename,
-			  const gchar *output_filename, GError **error)
+static gboolean
+oab_decompress_patch_stream (FILE *input,
+			     FILE *orig_input,
+			     FILE *output,
+			     GError **error)
 {
 	LzxPatchHeader *lzx_h = NULL;
 	guint total_decomp_size = 0;
-	FILE *input = NULL, *output = NULL, *orig_input = NULL;
 	gboolean ret = TRUE;
 	GError *err = NULL;
 
-	input = fopen (filename, "rb");
-	if (!input) {
-		g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the input file");
-		ret = FALSE;
-		goto exit;
-	}
-
-	orig_input = fopen (orig_filename, "rb");
-	if (!orig_input) {
-		g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the reference input file");
-		ret = FALSE;
-		goto exit;
-	}
-
-	output = fopen (output_filename, "wb");
-	if (!output) {
-		g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the output file");
-		ret = FALSE;
-		goto exit;
-	}
-
 	lzx_h = read_patch_headers (input, &err);
 	if (!lzx_h) {
 		ret = FALSE;
@@ -456,6 +436,48 @@ ews_oab_decompress_patch (const gchar *filename, const gchar *orig_filename,
 		g_free (lzx_b);
 	} while (total_decomp_size < lzx_h->target_size);
 
+exit:
+	if (err) {
+		ret = FALSE;
+		g_propagate_error (error, err);
+	}
+
+	g_free (lzx_h);
+
+	return ret;
+}
+
+gboolean
+ews_oab_decompress_patch (const gchar *filename, const gchar *orig_filename,
+			  const gchar *output_filename, GError **error)
+{
+	FILE *input = NULL, *output = NULL, *orig_input = NULL;
+	gboolean ret = TRUE;
+	GError *err = NULL;
+
+	input = fopen (filename, "rb");
+	if (!input) {
+		g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the input file");
+		ret = FALSE;
+		goto exit;
+	}
+
+	orig_input = fopen (orig_filename, "rb");
+	if (!orig_input) {
+		g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the reference input file");
+		ret = FALSE;
+		goto exit;
+	}
+
+	output = fopen (output_filename, "wb");
+	if (!output) {
+		g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the output file");
+		ret = FALSE;
+		goto exit;
+	}
+
+	ret = oab_decompress_patch_stream (input, orig_input, output, &err);
+
 exit:
 	if (input)
 		fclose (input);
@@ -472,8 +494,74 @@ exit:
 		g_unlink (output_filename);
 	}
 
-	g_free (lzx_h);
-
 	return ret;
 }
 
+/* Applies all the patches, in the given order, on top of the orig_filename.
+   Intermediate results live only in anonymous temporary files, each of them
+   being the reference data for the next patch; only the last patch writes
+   into the output_filename. */
+gboolean
+ews_oab_decompress_patch_chain (const gchar *orig_filename,
+				const GSList *patch_filenames,
+				const gchar *output_filename,
+				GError **error)
+{
+	const GSList *link;
+	FILE *reference;
+	gboolean ret = TRUE;
+	GError *err = NULL;
+
+	if (!patch_filenames) {
+		g_set_error_literal (error, g_quark_from_string ("lzx"), 1, "no patch files to apply");
+		return FALSE;
+	}
+
+	reference = fopen (orig_filename, "rb");
+	if (!reference) {
+		g_set_error_literal (error, g_quark_from_string ("lzx"), 1, "unable to open the reference input file");
+		return FALSE;
+	}
+
+	for (link = patch_filenames; link && ret; link = g_slist_next (link)) {
+		FILE *input, *output;
+
+		input = fopen (link->data, "rb");
+		if (!input) {
+			g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the input file");
+			ret = FALSE;
+			break;
+		}
+
+		if (g_slist_next (link))
+			output = tmpfile ();
+		else
+			output = fopen (output_filename, "w+b");
+
+		if (!output) {
+			g_set_error_literal (&err, g_quark_from_string ("lzx"), 1, "unable to open the output file");
+			fclose (input);
+			ret = FALSE;
+			break;
+		}
+
+		ret = oab_decompress_patch_stream (input, reference, output, &err);
+
+		fclose (input);
+		fclose (reference);
+
+		/* The result is the reference data for the next patch */
+		reference = output;
+		rewind (reference);
+	}
+
+	fclose (reference);
+
+	if (err) {
+		ret = FALSE;
+		g_propagate_error (error, err);
+		g_unlink (output_filename);
+	}
+
+	return ret;
+}
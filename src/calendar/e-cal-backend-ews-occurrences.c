@@ -0,0 +1,693 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#include "evolution-ews-config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include <libecal/libecal.h>
+#include <libedata-cal/libedata-cal.h>
+
+#include "e-cal-backend-ews-occurrences.h"
+
+/*
+ * The occurrence index stores the expanded occurrences of the recurring
+ * series in two tables of the calendar cache. Each series remembers
+ * a stamp of its change key and of the properties the recurrence depends
+ * on, thus it is expanded again only when it changes, or when a query
+ * asks for an interval the index does not cover yet.
+ *
+ * Another table stores how far before and after the start of each component
+ * its alarms trigger. It is maintained on each put into the cache, thus the
+ * alarm searches know how far around their interval to look for occurrences.
+ */
+
+#define EWS_OCCURRENCES_SERIES_TABLE "ews_occurrence_series"
+#define EWS_OCCURRENCES_TABLE "ews_occurrences"
+#define EWS_OCCURRENCES_INDEX "ews_occurrences_index"
+
+/* How far around the queried interval the series is expanded,
+   to have the following view changes served from the index */
+#define EWS_OCCURRENCES_MARGIN_BEFORE ((gint64) 365 * 24 * 60 * 60)
+#define EWS_OCCURRENCES_MARGIN_AFTER ((gint64) 2 * 365 * 24 * 60 * 60)
+
+/* EWS recurs at most daily, thus this keeps the index
+   at a few thousands of rows per series at most */
+#define EWS_OCCURRENCES_MAX_SPAN ((gint64) 10 * 365 * 24 * 60 * 60)
+
+#define EWS_OCCURRENCES_INSERT_BATCH 100
+
+#define EWS_ALARM_LEADS_TABLE "ews_alarm_leads"
+#define EWS_ALARM_LEADS_INDEXED_KEY "ews-alarm-leads-indexed"
+
+typedef struct _EwsOccurrencesSeries {
+	gboolean found;
+	gchar *stamp;
+	gint64 range_start;
+	gint64 range_end;
+	gint64 max_duration;
+} EwsOccurrencesSeries;
+
+/* How far before and after the start of the 'object' its alarms trigger.
+   The absolute triggers do not relate to the occurrences at all.
+   Returns FALSE, when the 'object' has no alarm. */
+static gboolean
+ews_alarm_leads_compute (const gchar *object,
+			 gint64 *out_lead_before,
+			 gint64 *out_lead_after,
+			 gboolean *out_is_absolute)
+{
+	ECalComponent *comp;
+	GSList *alarms, *link;
+	gint64 duration = -1;
+
+	*out_lead_before = 0;
+	*out_lead_after = 0;
+	*out_is_absolute = FALSE;
+
+	if (!object || !strstr (object, "BEGIN:VALARM"))
+		return FALSE;
+
+	comp = e_cal_component_new_from_string (object);
+	if (!comp)
+		return FALSE;
+
+	alarms = e_cal_component_get_all_alarms (comp);
+
+	for (link = alarms; link; link = g_slist_next (link)) {
+		ECalComponentAlarm *alarm = link->data;
+		ECalComponentAlarmTrigger *trigger;
+		ECalComponentAlarmRepeat *repeat;
+		gint64 first, last;
+
+		trigger = e_cal_component_alarm_get_trigger (alarm);
+
+		if (!trigger || e_cal_component_alarm_trigger_get_kind (trigger) == E_CAL_COMPONENT_ALARM_TRIGGER_NONE)
+			continue;
+
+		if (e_cal_component_alarm_trigger_get_kind (trigger) == E_CAL_COMPONENT_ALARM_TRIGGER_ABSOLUTE) {
+			*out_is_absolute = TRUE;
+			continue;
+		}
+
+		first = i_cal_duration_as_int (e_cal_component_alarm_trigger_get_duration (trigger));
+
+		if (e_cal_component_alarm_trigger_get_kind (trigger) == E_CAL_COMPONENT_ALARM_TRIGGER_RELATIVE_END) {
+			if (duration < 0) {
+				ICalDuration *idur;
+
+				idur = i_cal_component_get_duration (e_cal_component_get_icalcomponent (comp));
+				duration = idur ? MAX (i_cal_duration_as_int (idur), 0) : 0;
+				g_clear_object (&idur);
+			}
+
+			first += duration;
+		}
+
+		last = first;
+
+		repeat = e_cal_component_alarm_get_repeat (alarm);
+		if (repeat && e_cal_component_alarm_repeat_get_repetitions (repeat) > 0)
+			last += (gint64) e_cal_component_alarm_repeat_get_repetitions (repeat) * e_cal_component_alarm_repeat_get_interval_seconds (repeat);
+
+		*out_lead_before = MAX (*out_lead_before, -first);
+		*out_lead_after = MAX (*out_lead_after, last);
+	}
+
+	g_slist_free_full (alarms, e_cal_component_alarm_free);
+	g_object_unref (comp);
+
+	return TRUE;
+}
+
+static gboolean
+ews_alarm_leads_store_sync (ECache *cache,
+			    const gchar *uid,
+			    const gchar *object,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	GString *stmt;
+	gint64 lead_before, lead_after;
+	gboolean is_absolute, success;
+
+	stmt = g_string_new ("");
+
+	if (ews_alarm_leads_compute (object, &lead_before, &lead_after, &is_absolute)) {
+		e_cache_sqlite_stmt_append_printf (stmt,
+			"INSERT OR REPLACE INTO " EWS_ALARM_LEADS_TABLE
+			" (uid, lead_before, lead_after, is_absolute) VALUES (%Q,", uid);
+		g_string_append_printf (stmt, "%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",%d)",
+			lead_before, lead_after, is_absolute ? 1 : 0);
+	} else {
+		e_cache_sqlite_stmt_append_printf (stmt, "DELETE FROM " EWS_ALARM_LEADS_TABLE " WHERE uid=%Q", uid);
+	}
+
+	success = e_cache_sqlite_exec (cache, stmt->str, cancellable, error);
+
+	g_string_free (stmt, TRUE);
+
+	return success;
+}
+
+static gboolean
+ews_alarm_leads_before_put_cb (ECache *cache,
+			       const gchar *uid,
+			       const gchar *revision,
+			       const gchar *object,
+			       ECacheColumnValues *other_columns,
+			       gboolean is_replace,
+			       GCancellable *cancellable,
+			       GError **error,
+			       gpointer user_data)
+{
+	/* Do not fail the put; the alarm searches rebuild the table instead */
+	if (!ews_alarm_leads_store_sync (cache, uid, object, cancellable, NULL))
+		e_cache_set_key_int (cache, EWS_ALARM_LEADS_INDEXED_KEY, 0, NULL);
+
+	return TRUE;
+}
+
+static gboolean
+ews_alarm_leads_before_remove_cb (ECache *cache,
+				  const gchar *uid,
+				  GCancellable *cancellable,
+				  GError **error,
+				  gpointer user_data)
+{
+	GString *stmt;
+
+	stmt = g_string_new ("");
+	e_cache_sqlite_stmt_append_printf (stmt, "DELETE FROM " EWS_ALARM_LEADS_TABLE " WHERE uid=%Q", uid);
+
+	/* A left row only makes the alarm searches look further */
+	e_cache_sqlite_exec (cache, stmt->str, cancellable, NULL);
+
+	g_string_free (stmt, TRUE);
+
+	return TRUE;
+}
+
+void
+e_cal_backend_ews_occurrences_init (ECalCache *cal_cache)
+{
+	ECache *cache;
+
+	g_return_if_fail (E_IS_CAL_CACHE (cal_cache));
+
+	cache = E_CACHE (cal_cache);
+
+	/* Failure is not fatal, the lookups only fall back to the recurrence expansion */
+	e_cache_sqlite_exec (cache,
+		"CREATE TABLE IF NOT EXISTS " EWS_OCCURRENCES_SERIES_TABLE
+		" (uid TEXT PRIMARY KEY, stamp TEXT, range_start INTEGER, range_end INTEGER, max_duration INTEGER)",
+		NULL, NULL);
+
+	e_cache_sqlite_exec (cache,
+		"CREATE TABLE IF NOT EXISTS " EWS_OCCURRENCES_TABLE
+		" (uid TEXT, occur_start INTEGER, occur_end INTEGER)",
+		NULL, NULL);
+
+	e_cache_sqlite_exec (cache,
+		"CREATE INDEX IF NOT EXISTS " EWS_OCCURRENCES_INDEX " ON " EWS_OCCURRENCES_TABLE
+		" (uid, occur_start)",
+		NULL, NULL);
+
+	e_cache_sqlite_exec (cache,
+		"CREATE TABLE IF NOT EXISTS " EWS_ALARM_LEADS_TABLE
+		" (uid TEXT PRIMARY KEY, lead_before INTEGER, lead_after INTEGER, is_absolute INTEGER)",
+		NULL, NULL);
+
+	g_signal_connect (cal_cache, "before-put",
+		G_CALLBACK (ews_alarm_leads_before_put_cb), NULL);
+
+	g_signal_connect (cal_cache, "before-remove",
+		G_CALLBACK (ews_alarm_leads_before_remove_cb), NULL);
+}
+
+/* Floating and all-day times depend on the default time zone of the query,
+   thus only the series with an absolute start are indexed */
+static gboolean
+ews_occurrences_has_absolute_start (ICalComponent *icomp)
+{
+	ICalProperty *prop;
+	ICalParameter *param;
+	ICalTime *dtstart;
+	gboolean res;
+
+	prop = i_cal_component_get_first_property (icomp, I_CAL_DTSTART_PROPERTY);
+	if (!prop)
+		return FALSE;
+
+	dtstart = i_cal_property_get_dtstart (prop);
+
+	if (!dtstart || i_cal_time_is_date (dtstart)) {
+		res = FALSE;
+	} else if (i_cal_time_is_utc (dtstart)) {
+		res = TRUE;
+	} else {
+		param = i_cal_property_get_first_parameter (prop, I_CAL_TZID_PARAMETER);
+		res = param != NULL;
+		g_clear_object (&param);
+	}
+
+	g_clear_object (&dtstart);
+	g_object_unref (prop);
+
+	return res;
+}
+
+/* The change key alone does not cover the changes done while offline */
+static gchar *
+ews_occurrences_dup_stamp (ICalComponent *icomp)
+{
+	const ICalPropertyKind kinds[] = {
+		I_CAL_DTSTART_PROPERTY,
+		I_CAL_DTEND_PROPERTY,
+		I_CAL_DURATION_PROPERTY,
+		I_CAL_RRULE_PROPERTY,
+		I_CAL_RDATE_PROPERTY,
+		I_CAL_EXRULE_PROPERTY,
+		I_CAL_EXDATE_PROPERTY
+	};
+	GChecksum *checksum;
+	gchar *changekey, *stamp;
+	guint ii;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+
+	for (ii = 0; ii < G_N_ELEMENTS (kinds); ii++) {
+		ICalProperty *prop;
+
+		for (prop = i_cal_component_get_first_property (icomp, kinds[ii]);
+		     prop;
+		     g_object_unref (prop), prop = i_cal_component_get_next_property (icomp, kinds[ii])) {
+			gchar *str;
+
+			str = i_cal_property_as_ical_string (prop);
+			if (str)
+				g_checksum_update (checksum, (const guchar *) str, -1);
+			g_free (str);
+		}
+	}
+
+	changekey = e_cal_util_component_dup_x_property (icomp, "X-EVOLUTION-CHANGEKEY");
+	stamp = g_strconcat (changekey ? changekey : "", ":", g_checksum_get_string (checksum), NULL);
+
+	g_checksum_free (checksum);
+	g_free (changekey);
+
+	return stamp;
+}
+
+static gboolean
+ews_occurrences_read_series_cb (ECache *cache,
+				gint ncols,
+				const gchar *column_names[],
+				const gchar *column_values[],
+				gpointer user_data)
+{
+	EwsOccurrencesSeries *series = user_data;
+
+	if (ncols == 4) {
+		series->found = TRUE;
+		series->stamp = g_strdup (column_values[0]);
+		series->range_start = column_values[1] ? g_ascii_strtoll (column_values[1], NULL, 10) : 0;
+		series->range_end = column_values[2] ? g_ascii_strtoll (column_values[2], NULL, 10) : 0;
+		series->max_duration = column_values[3] ? g_ascii_strtoll (column_values[3], NULL, 10) : 0;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+ews_occurrences_read_series (ECache *cache,
+			     const gchar *uid,
+			     EwsOccurrencesSeries *series,
+			     GCancellable *cancellable)
+{
+	GString *stmt;
+	gboolean success;
+
+	stmt = g_string_new ("SELECT stamp, range_start, range_end, max_duration FROM " EWS_OCCURRENCES_SERIES_TABLE);
+	e_cache_sqlite_stmt_append_printf (stmt, " WHERE uid=%Q", uid);
+
+	success = e_cache_sqlite_select (cache, stmt->str, ews_occurrences_read_series_cb, series, cancellable, NULL);
+
+	g_string_free (stmt, TRUE);
+
+	return success;
+}
+
+static ICalTimezone *
+ews_occurrences_resolve_tzid_cb (const gchar *tzid,
+				 gpointer user_data,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	return e_timezone_cache_get_timezone (user_data, tzid);
+}
+
+static gboolean
+ews_occurrences_gather_cb (ICalComponent *icomp,
+			   ICalTime *instance_start,
+			   ICalTime *instance_end,
+			   gpointer user_data,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	GArray *occurrences = user_data;
+	gint64 times[2];
+
+	times[0] = (gint64) i_cal_time_as_timet_with_zone (instance_start, i_cal_time_get_timezone (instance_start));
+	times[1] = (gint64) i_cal_time_as_timet_with_zone (instance_end, i_cal_time_get_timezone (instance_end));
+
+	if (times[1] < times[0])
+		times[1] = times[0];
+
+	g_array_append_vals (occurrences, times, 2);
+
+	return TRUE;
+}
+
+static gboolean
+ews_occurrences_rebuild_sync (ECache *cache,
+			      ETimezoneCache *timezone_cache,
+			      ICalComponent *icomp,
+			      const gchar *uid,
+			      const gchar *stamp,
+			      gint64 range_start,
+			      gint64 range_end,
+			      gint64 *out_max_duration,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	ICalTimezone *utc_zone;
+	ICalTime *istart, *iend;
+	GArray *occurrences;
+	GString *stmt;
+	gint64 max_duration = 0;
+	guint ii;
+	gboolean success;
+
+	utc_zone = i_cal_timezone_get_utc_timezone ();
+	istart = i_cal_time_new_from_timet_with_zone ((time_t) range_start, FALSE, utc_zone);
+	iend = i_cal_time_new_from_timet_with_zone ((time_t) range_end, FALSE, utc_zone);
+
+	occurrences = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+	success = e_cal_recur_generate_instances_sync (icomp, istart, iend,
+		ews_occurrences_gather_cb, occurrences,
+		ews_occurrences_resolve_tzid_cb, timezone_cache,
+		utc_zone, cancellable, error);
+
+	g_clear_object (&istart);
+	g_clear_object (&iend);
+
+	if (!success) {
+		g_array_unref (occurrences);
+		return FALSE;
+	}
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	stmt = g_string_new ("");
+
+	e_cache_sqlite_stmt_append_printf (stmt, "DELETE FROM " EWS_OCCURRENCES_TABLE " WHERE uid=%Q", uid);
+	success = e_cache_sqlite_exec (cache, stmt->str, cancellable, error);
+
+	for (ii = 0; success && ii + 1 < occurrences->len; ii += 2) {
+		gint64 occur_start = g_array_index (occurrences, gint64, ii);
+		gint64 occur_end = g_array_index (occurrences, gint64, ii + 1);
+
+		if (occur_end - occur_start > max_duration)
+			max_duration = occur_end - occur_start;
+
+		if ((ii / 2) % EWS_OCCURRENCES_INSERT_BATCH == 0) {
+			g_string_truncate (stmt, 0);
+			g_string_append (stmt, "INSERT INTO " EWS_OCCURRENCES_TABLE " (uid, occur_start, occur_end) VALUES ");
+		} else {
+			g_string_append_c (stmt, ',');
+		}
+
+		e_cache_sqlite_stmt_append_printf (stmt, "(%Q,", uid);
+		g_string_append_printf (stmt, "%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ")", occur_start, occur_end);
+
+		if ((ii / 2) % EWS_OCCURRENCES_INSERT_BATCH == EWS_OCCURRENCES_INSERT_BATCH - 1 || ii + 2 >= occurrences->len)
+			success = e_cache_sqlite_exec (cache, stmt->str, cancellable, error);
+	}
+
+	if (success) {
+		g_string_truncate (stmt, 0);
+		e_cache_sqlite_stmt_append_printf (stmt,
+			"INSERT OR REPLACE INTO " EWS_OCCURRENCES_SERIES_TABLE
+			" (uid, stamp, range_start, range_end, max_duration) VALUES (%Q,%Q,", uid, stamp);
+		g_string_append_printf (stmt, "%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ",%" G_GINT64_FORMAT ")",
+			range_start, range_end, max_duration);
+
+		success = e_cache_sqlite_exec (cache, stmt->str, cancellable, error);
+	}
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
+	g_string_free (stmt, TRUE);
+	g_array_unref (occurrences);
+
+	if (success && out_max_duration)
+		*out_max_duration = max_duration;
+
+	return success;
+}
+
+static gboolean
+ews_occurrences_found_cb (ECache *cache,
+			  gint ncols,
+			  const gchar *column_names[],
+			  const gchar *column_values[],
+			  gpointer user_data)
+{
+	gboolean *pfound = user_data;
+
+	*pfound = TRUE;
+
+	return TRUE;
+}
+
+/* Whether the recurring series 'comp' has any occurrence in the interval
+   <start, end), answered from the index, which is refreshed when needed.
+   Returns E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN, when the 'comp' cannot
+   be indexed; the caller should expand the recurrences on its own then. */
+ECalBackendEwsOccurrencesResult
+e_cal_backend_ews_occurrences_lookup_sync (ECalCache *cal_cache,
+					   ETimezoneCache *timezone_cache,
+					   ECalComponent *comp,
+					   time_t start,
+					   time_t end,
+					   GCancellable *cancellable)
+{
+	ECalBackendEwsOccurrencesResult result = E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN;
+	EwsOccurrencesSeries series = { 0 };
+	ICalComponent *icomp;
+	ECache *cache;
+	GString *stmt;
+	const gchar *uid;
+	gchar *stamp;
+	gboolean found = FALSE;
+	GError *local_error = NULL;
+
+	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN);
+	g_return_val_if_fail (E_IS_TIMEZONE_CACHE (timezone_cache), E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN);
+	g_return_val_if_fail (E_IS_CAL_COMPONENT (comp), E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN);
+
+	if (start <= 0 || end <= start || (gint64) end - (gint64) start > EWS_OCCURRENCES_MAX_SPAN)
+		return E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN;
+
+	uid = e_cal_component_get_uid (comp);
+	icomp = e_cal_component_get_icalcomponent (comp);
+
+	if (!uid || !*uid || !icomp ||
+	    !e_cal_component_has_recurrences (comp) ||
+	    e_cal_component_is_instance (comp) ||
+	    !ews_occurrences_has_absolute_start (icomp))
+		return E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN;
+
+	cache = E_CACHE (cal_cache);
+	stamp = ews_occurrences_dup_stamp (icomp);
+
+	if (!ews_occurrences_read_series (cache, uid, &series, cancellable))
+		goto exit;
+
+	if (!series.found || g_strcmp0 (series.stamp, stamp) != 0 ||
+	    (gint64) start < series.range_start || (gint64) end > series.range_end) {
+		gint64 range_start, range_end;
+
+		range_start = (gint64) start - EWS_OCCURRENCES_MARGIN_BEFORE;
+		range_end = (gint64) end + EWS_OCCURRENCES_MARGIN_AFTER;
+
+		if (range_start <= 0)
+			range_start = 1;
+
+		/* Extend the still valid index, unless it would grow too much */
+		if (series.found && g_strcmp0 (series.stamp, stamp) == 0 &&
+		    MAX (range_end, series.range_end) - MIN (range_start, series.range_start) <= EWS_OCCURRENCES_MAX_SPAN) {
+			range_start = MIN (range_start, series.range_start);
+			range_end = MAX (range_end, series.range_end);
+		}
+
+		if (!ews_occurrences_rebuild_sync (cache, timezone_cache, icomp, uid, stamp, range_start, range_end,
+			&series.max_duration, cancellable, &local_error)) {
+			if (!g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+				g_warning ("%s: Failed to index occurrences of '%s': %s", G_STRFUNC, uid, local_error ? local_error->message : "Unknown error");
+
+			g_clear_error (&local_error);
+			goto exit;
+		}
+	}
+
+	stmt = g_string_new ("SELECT 1 FROM " EWS_OCCURRENCES_TABLE);
+	e_cache_sqlite_stmt_append_printf (stmt, " WHERE uid=%Q", uid);
+	g_string_append_printf (stmt,
+		" AND occur_start<%" G_GINT64_FORMAT
+		" AND occur_start>=%" G_GINT64_FORMAT
+		" AND (occur_end>%" G_GINT64_FORMAT " OR occur_start>=%" G_GINT64_FORMAT ")"
+		" LIMIT 1",
+		(gint64) end,
+		(gint64) start - series.max_duration,
+		(gint64) start, (gint64) start);
+
+	if (e_cache_sqlite_select (cache, stmt->str, ews_occurrences_found_cb, &found, cancellable, NULL))
+		result = found ? E_CAL_BACKEND_EWS_OCCURRENCES_SOME : E_CAL_BACKEND_EWS_OCCURRENCES_NONE;
+
+	g_string_free (stmt, TRUE);
+
+ exit:
+	g_free (series.stamp);
+	g_free (stamp);
+
+	return result;
+}
+
+static gboolean
+ews_alarm_leads_reindex_cb (ECache *cache,
+			    const gchar *uid,
+			    const gchar *revision,
+			    const gchar *object,
+			    EOfflineState offline_state,
+			    gint ncols,
+			    const gchar *column_names[],
+			    const gchar *column_values[],
+			    gpointer user_data)
+{
+	GCancellable *cancellable = user_data;
+
+	return ews_alarm_leads_store_sync (cache, uid, object, cancellable, NULL);
+}
+
+static gboolean
+ews_alarm_leads_read_cb (ECache *cache,
+			 gint ncols,
+			 const gchar *column_names[],
+			 const gchar *column_values[],
+			 gpointer user_data)
+{
+	gint64 *values = user_data;
+	gint ii;
+
+	for (ii = 0; ii < ncols && ii < 3; ii++) {
+		values[ii] = column_values[ii] ? g_ascii_strtoll (column_values[ii], NULL, 10) : 0;
+	}
+
+	return TRUE;
+}
+
+/* Sets how far before and after the start of their occurrences the alarms
+   of the cached components trigger at most. The table is filled on the first
+   call for the caches, which were populated before it existed. Returns FALSE,
+   when it cannot tell, like when any alarm uses an absolute trigger. */
+gboolean
+e_cal_backend_ews_occurrences_get_alarm_leads_sync (ECalCache *cal_cache,
+						    gint64 *out_lead_before,
+						    gint64 *out_lead_after,
+						    GCancellable *cancellable)
+{
+	ECache *cache;
+	gint64 values[3] = { 0, 0, 0 };
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
+	g_return_val_if_fail (out_lead_before != NULL, FALSE);
+	g_return_val_if_fail (out_lead_after != NULL, FALSE);
+
+	cache = E_CACHE (cal_cache);
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	if (e_cache_get_key_int (cache, EWS_ALARM_LEADS_INDEXED_KEY, NULL) != 1) {
+		success = e_cache_sqlite_exec (cache, "DELETE FROM " EWS_ALARM_LEADS_TABLE, cancellable, NULL) &&
+			e_cache_foreach (cache, E_CACHE_INCLUDE_DELETED, E_CACHE_COLUMN_OBJECT " LIKE '%BEGIN:VALARM%'",
+				ews_alarm_leads_reindex_cb, cancellable, cancellable, NULL) &&
+			e_cache_set_key_int (cache, EWS_ALARM_LEADS_INDEXED_KEY, 1, NULL);
+	}
+
+	success = success && e_cache_sqlite_select (cache,
+		"SELECT MAX(lead_before), MAX(lead_after), MAX(is_absolute) FROM " EWS_ALARM_LEADS_TABLE,
+		ews_alarm_leads_read_cb, values, cancellable, NULL);
+
+	e_cache_unlock (cache, success ? E_CACHE_UNLOCK_COMMIT : E_CACHE_UNLOCK_ROLLBACK);
+
+	if (!success || values[2] != 0)
+		return FALSE;
+
+	*out_lead_before = values[0];
+	*out_lead_after = values[1];
+
+	return TRUE;
+}
+
+/* Forgets the series and the alarm leads of the components, which are not
+   in the cache anymore. The series are stored without RECURRENCE-ID, thus
+   their UID is the cache UID. */
+void
+e_cal_backend_ews_occurrences_prune (ECalCache *cal_cache,
+				     GCancellable *cancellable)
+{
+	ECache *cache;
+
+	g_return_if_fail (E_IS_CAL_CACHE (cal_cache));
+
+	cache = E_CACHE (cal_cache);
+
+	e_cache_lock (cache, E_CACHE_LOCK_WRITE);
+
+	e_cache_sqlite_exec (cache,
+		"DELETE FROM " EWS_OCCURRENCES_SERIES_TABLE " WHERE uid NOT IN"
+		" (SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS ")",
+		cancellable, NULL);
+
+	e_cache_sqlite_exec (cache,
+		"DELETE FROM " EWS_OCCURRENCES_TABLE " WHERE uid NOT IN"
+		" (SELECT uid FROM " EWS_OCCURRENCES_SERIES_TABLE ")",
+		cancellable, NULL);
+
+	e_cache_sqlite_exec (cache,
+		"DELETE FROM " EWS_ALARM_LEADS_TABLE " WHERE uid NOT IN"
+		" (SELECT " E_CACHE_COLUMN_UID " FROM " E_CACHE_TABLE_OBJECTS ")",
+		cancellable, NULL);
+
+	e_cache_unlock (cache, E_CACHE_UNLOCK_COMMIT);
+}
@@ -0,0 +1,53 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301
+ * USA
+ */
+
+#ifndef E_CAL_BACKEND_EWS_OCCURRENCES_H
+#define E_CAL_BACKEND_EWS_OCCURRENCES_H
+
+#include <libecal/libecal.h>
+#include <libedata-cal/libedata-cal.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+	E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN = -1,
+	E_CAL_BACKEND_EWS_OCCURRENCES_NONE = 0,
+	E_CAL_BACKEND_EWS_OCCURRENCES_SOME = 1
+} ECalBackendEwsOccurrencesResult;
+
+void		e_cal_backend_ews_occurrences_init
+						(ECalCache *cal_cache);
+ECalBackendEwsOccurrencesResult
+		e_cal_backend_ews_occurrences_lookup_sync
+						(ECalCache *cal_cache,
+						 ETimezoneCache *timezone_cache,
+						 ECalComponent *comp,
+						 time_t start,
+						 time_t end,
+						 GCancellable *cancellable);
+gboolean	e_cal_backend_ews_occurrences_get_alarm_leads_sync
+						(ECalCache *cal_cache,
+						 gint64 *out_lead_before,
+						 gint64 *out_lead_after,
+						 GCancellable *cancellable);
+void		e_cal_backend_ews_occurrences_prune
+						(ECalCache *cal_cache,
+						 GCancellable *cancellable);
+
+G_END_DECLS
+
+#endif /* E_CAL_BACKEND_EWS_OCCURRENCES_H */
@@ -32,11 +32,6 @@
 #include <glib/gstdio.h>
 #include <gio/gio.h>
 
-#include <libxml/parser.h>
-#include <libxml/tree.h>
-#include <libxml/xpath.h>
-#include <libxml/xpathInternals.h>
-
 #include <libecal/libecal.h>
 #include <libsoup/soup-misc.h>
 
@@ -48,177 +43,294 @@
 #include "e-cal-backend-ews-utils.h"
 
 /*
- * A bunch of global variables used to map the ICalTimezone to MSDN[0] format.
- * Also, some auxiliar functions to translate from one tz type to another.
+ * The tables used to map the ICalTimezone to MSDN[0] format and back.
+ * They are generated from the windowsZones.xml at build time, thus
+ * they are immutable and can be searched without any locking.
  *
  * [0]: http://msdn.microsoft.com/en-us/library/ms912391(v=winembedded.11).aspx
  */
-static GRecMutex tz_mutex;
+typedef struct _EwsTzMapping {
+	const gchar *key;
+	const gchar *value;
+} EwsTzMapping;
+
+#include "e-cal-backend-ews-windows-zones.h"
+
+static gint
+ews_tz_mapping_compare (gconstpointer key,
+			gconstpointer mapping)
+{
+	return strcmp (key, ((const EwsTzMapping *) mapping)->key);
+}
+
+static const gchar *
+ews_tz_mapping_lookup (const EwsTzMapping *table,
+		       gsize n_items,
+		       const gchar *key)
+{
+	const EwsTzMapping *found;
+
+	if (!key || !*key)
+		return NULL;
+
+	found = bsearch (key, table, n_items, sizeof (EwsTzMapping), ews_tz_mapping_compare);
 
-static GHashTable *ical_to_msdn = NULL;
-static GHashTable *msdn_to_ical = NULL;
+	return found ? found->value : NULL;
+}
+
+/*
+ * Process-wide caches shared by all the calendar backends, with a limited
+ * number of items, where the least recently used items are dropped first.
+ */
+#define EWS_TZ_RESOLVED_ZONES_MAX 64
+#define EWS_TZ_SERVER_DEFINITIONS_MAX 32
+
+typedef struct _EwsTzLru {
+	GHashTable *items; /* gchar *key ~> gpointer value */
+	GQueue keys; /* gchar *, owned by the 'items', the most recently used first */
+	guint max_items;
+} EwsTzLru;
+
+static GMutex tz_cache_lock;
 static guint tables_counter = 0;
+static EwsTzLru *resolved_zones = NULL; /* "msdn\nevo-ews-tzid" ~> ICalTimezone * */
+static EwsTzLru *server_definitions = NULL; /* msdn ~> EEwsCalendarTimeZoneDefinition * */
 
-void
-e_cal_backend_ews_populate_windows_zones (void)
+static EwsTzLru *
+ews_tz_lru_new (guint max_items,
+		GDestroyNotify value_free)
 {
-	const gchar *xpath_eval_exp;
-	gchar *filename = NULL;
-	xmlDocPtr doc;
-	xmlXPathContextPtr xpath_ctxt;
-	xmlXPathObjectPtr xpath_obj;
-	xmlNodeSetPtr nodes;
-	gint i, len;
+	EwsTzLru *lru;
 
-	g_rec_mutex_lock (&tz_mutex);
-	if (ical_to_msdn != NULL && msdn_to_ical != NULL) {
-		g_hash_table_ref (ical_to_msdn);
-		g_hash_table_ref (msdn_to_ical);
-		tables_counter++;
+	lru = g_new0 (EwsTzLru, 1);
+	lru->items = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, value_free);
+	lru->max_items = max_items;
+	g_queue_init (&lru->keys);
 
-		g_rec_mutex_unlock (&tz_mutex);
-		return;
-	}
+	return lru;
+}
 
-	if (g_strcmp0 (g_getenv ("EWS_INTERNAL_TEST"), "1") == 0)
-		filename = g_build_filename (EXCHANGE_EWS_SRCDIR, "windowsZones.xml", NULL);
-	else
-		filename = g_build_filename (EXCHANGE_EWS_DATADIR, "windowsZones.xml", NULL);
+static void
+ews_tz_lru_free (EwsTzLru *lru)
+{
+	if (lru) {
+		g_queue_clear (&lru->keys);
+		g_hash_table_destroy (lru->items);
+		g_free (lru);
+	}
+}
 
-	doc = xmlReadFile (filename, NULL, 0);
+/* The caller holds the tz_cache_lock */
+static gpointer
+ews_tz_lru_lookup (EwsTzLru *lru,
+		   const gchar *key)
+{
+	gpointer orig_key = NULL, value = NULL;
 
-	if (doc == NULL) {
-		g_warning (G_STRLOC "Could not map %s file.", filename);
-		g_free (filename);
+	if (!lru || !g_hash_table_lookup_extended (lru->items, key, &orig_key, &value))
+		return NULL;
 
-		g_rec_mutex_unlock (&tz_mutex);
-		return;
+	if (g_queue_peek_head (&lru->keys) != orig_key) {
+		g_queue_remove (&lru->keys, orig_key);
+		g_queue_push_head (&lru->keys, orig_key);
 	}
 
-	xpath_eval_exp = "/supplementalData/windowsZones/mapTimezones/mapZone";
+	return value;
+}
 
-	xpath_ctxt = xmlXPathNewContext (doc);
-	xpath_obj = xmlXPathEvalExpression (BAD_CAST xpath_eval_exp, xpath_ctxt);
+/* The caller holds the tz_cache_lock; the 'lru' assumes ownership of the 'value' */
+static void
+ews_tz_lru_insert (EwsTzLru *lru,
+		   const gchar *key,
+		   gpointer value)
+{
+	gchar *dup_key;
 
-	if (xpath_obj == NULL) {
-		g_warning (G_STRLOC "Unable to evaluate xpath expression \"%s\".", xpath_eval_exp);
-		xmlXPathFreeContext (xpath_ctxt);
-		xmlFreeDoc (doc);
-		g_free (filename);
+	if (g_hash_table_contains (lru->items, key)) {
+		gpointer orig_key = NULL;
 
-		g_rec_mutex_unlock (&tz_mutex);
-		return;
+		g_hash_table_lookup_extended (lru->items, key, &orig_key, NULL);
+		g_queue_remove (&lru->keys, orig_key);
+		g_hash_table_remove (lru->items, key);
 	}
 
-	nodes = xpath_obj->nodesetval;
-	len = nodes->nodeNr;
+	while (g_queue_get_length (&lru->keys) >= lru->max_items) {
+		gchar *oldest = g_queue_pop_tail (&lru->keys);
 
-	msdn_to_ical = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-	ical_to_msdn = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
-	tables_counter++;
+		g_hash_table_remove (lru->items, oldest);
+	}
 
-	for (i = 0; i < len; i++) {
-		xmlChar *msdn = xmlGetProp (nodes->nodeTab[i], BAD_CAST "other");
-		xmlChar *ical = xmlGetProp (nodes->nodeTab[i], BAD_CAST "type");
-		gchar **tokens;
-		gint tokens_len;
+	dup_key = g_strdup (key);
 
-		tokens = g_strsplit ((gchar *) ical, " ", 0);
-		tokens_len = g_strv_length (tokens);
-		if (tokens_len == 1) {
-			if (!g_hash_table_lookup (msdn_to_ical, msdn))
-				g_hash_table_insert (msdn_to_ical, g_strdup ((gchar *) msdn), g_strdup ((gchar *) ical));
+	g_hash_table_insert (lru->items, dup_key, value);
+	g_queue_push_head (&lru->keys, dup_key);
+}
 
-			if (!g_hash_table_lookup (ical_to_msdn, ical))
-				g_hash_table_insert (ical_to_msdn, g_strdup ((gchar *) ical), g_strdup ((gchar *) msdn));
-		} else {
-			gint j;
-			for (j = 0; j < tokens_len; j++) {
-				if (!g_hash_table_lookup (msdn_to_ical, msdn))
-					g_hash_table_insert (msdn_to_ical, g_strdup ((gchar *) msdn), g_strdup (tokens[j]));
+/* The mapping tables are compiled in, only the shared caches are created here */
+void
+e_cal_backend_ews_populate_windows_zones (void)
+{
+	g_mutex_lock (&tz_cache_lock);
 
-				if (!g_hash_table_lookup (ical_to_msdn, tokens[j]))
-					g_hash_table_insert (ical_to_msdn, g_strdup (tokens[j]), g_strdup ((gchar *) msdn));
-			}
-		}
+	tables_counter++;
 
-		g_strfreev (tokens);
-		xmlFree (ical);
-		xmlFree (msdn);
-	}
+	if (!resolved_zones)
+		resolved_zones = ews_tz_lru_new (EWS_TZ_RESOLVED_ZONES_MAX, g_object_unref);
 
-	xmlXPathFreeObject (xpath_obj);
-	xmlXPathFreeContext (xpath_ctxt);
-	xmlFreeDoc (doc);
-	g_free (filename);
+	if (!server_definitions)
+		server_definitions = ews_tz_lru_new (EWS_TZ_SERVER_DEFINITIONS_MAX, (GDestroyNotify) e_ews_calendar_time_zone_definition_free);
 
-	g_rec_mutex_unlock (&tz_mutex);
+	g_mutex_unlock (&tz_cache_lock);
 }
 
 void
 e_cal_backend_ews_unref_windows_zones (void)
 {
-	g_rec_mutex_lock (&tz_mutex);
-	if (ical_to_msdn != NULL)
-		g_hash_table_unref (ical_to_msdn);
-
-	if (msdn_to_ical != NULL)
-		g_hash_table_unref (msdn_to_ical);
+	g_mutex_lock (&tz_cache_lock);
 
 	if (tables_counter > 0) {
 		tables_counter--;
 
 		if (tables_counter == 0) {
-			ical_to_msdn = NULL;
-			msdn_to_ical = NULL;
+			g_clear_pointer (&resolved_zones, ews_tz_lru_free);
+			g_clear_pointer (&server_definitions, ews_tz_lru_free);
 		}
 	}
 
-	g_rec_mutex_unlock (&tz_mutex);
+	g_mutex_unlock (&tz_cache_lock);
 }
 
 const gchar *
 e_cal_backend_ews_tz_util_get_msdn_equivalent (const gchar *ical_tz_location)
 {
-	const gchar *msdn_tz_location = NULL;
+	return ews_tz_mapping_lookup (ews_tz_ical_to_msdn, G_N_ELEMENTS (ews_tz_ical_to_msdn), ical_tz_location);
+}
 
-	if (!ical_tz_location || !*ical_tz_location)
-		return NULL;
+const gchar *
+e_cal_backend_ews_tz_util_get_ical_equivalent (const gchar *msdn_tz_location)
+{
+	return ews_tz_mapping_lookup (ews_tz_msdn_to_ical, G_N_ELEMENTS (ews_tz_msdn_to_ical), msdn_tz_location);
+}
 
-	g_rec_mutex_lock (&tz_mutex);
-	if (ical_to_msdn == NULL) {
-		g_rec_mutex_unlock (&tz_mutex);
+/* Returns libical's builtin zone for the MSDN time zone, preferring
+   the 'evo_ews_tzid', when it maps to the same MSDN zone. The resolved
+   zones are remembered for all the backends. Returns NULL, when there is
+   no such builtin zone. */
+ICalTimezone *
+e_cal_backend_ews_tz_util_get_builtin_zone (const gchar *msdn_tzid,
+					    const gchar *evo_ews_tzid)
+{
+	ICalTimezone *zone;
+	const gchar *location;
+	gchar *key;
 
-		g_warn_if_reached ();
+	if (!msdn_tzid || !*msdn_tzid)
 		return NULL;
+
+	key = g_strconcat (msdn_tzid, "\n", evo_ews_tzid ? evo_ews_tzid : "", NULL);
+
+	g_mutex_lock (&tz_cache_lock);
+
+	zone = ews_tz_lru_lookup (resolved_zones, key);
+
+	if (!zone) {
+		location = e_cal_backend_ews_tz_util_get_ical_equivalent (msdn_tzid);
+		if (!location)
+			location = msdn_tzid;
+
+		if (evo_ews_tzid && g_strcmp0 (location, evo_ews_tzid) != 0 &&
+		    g_strcmp0 (e_cal_backend_ews_tz_util_get_msdn_equivalent (evo_ews_tzid), msdn_tzid) == 0)
+			location = evo_ews_tzid;
+
+		zone = i_cal_timezone_get_builtin_timezone (location);
+
+		if (zone && resolved_zones)
+			ews_tz_lru_insert (resolved_zones, key, g_object_ref (zone));
 	}
 
-	msdn_tz_location = g_hash_table_lookup (ical_to_msdn, ical_tz_location);
-	g_rec_mutex_unlock (&tz_mutex);
+	g_mutex_unlock (&tz_cache_lock);
+
+	g_free (key);
 
-	return msdn_tz_location;
+	return zone;
 }
 
-const gchar *
-e_cal_backend_ews_tz_util_get_ical_equivalent (const gchar *msdn_tz_location)
+/* Makes sure the server time zone definitions for the given MSDN zones are
+   in the shared cache, asking the server only for those missing */
+static gboolean
+ews_tz_ensure_server_definitions (EEwsConnection *cnc,
+				  const gchar *msdn_start,
+				  const gchar *msdn_end)
 {
-	const gchar *ical_tz_location = NULL;
+	GSList *missing = NULL, *tzds = NULL, *link;
+	gboolean success;
 
-	if (!msdn_tz_location || !*msdn_tz_location)
-		return NULL;
+	g_mutex_lock (&tz_cache_lock);
 
-	g_rec_mutex_lock (&tz_mutex);
-	if (msdn_to_ical == NULL) {
-		g_rec_mutex_unlock (&tz_mutex);
+	if (msdn_start && !ews_tz_lru_lookup (server_definitions, msdn_start))
+		missing = g_slist_prepend (missing, (gpointer) msdn_start);
 
-		g_warn_if_reached ();
-		return NULL;
+	if (msdn_end && g_strcmp0 (msdn_start, msdn_end) != 0 && !ews_tz_lru_lookup (server_definitions, msdn_end))
+		missing = g_slist_prepend (missing, (gpointer) msdn_end);
+
+	g_mutex_unlock (&tz_cache_lock);
+
+	if (!missing)
+		return TRUE;
+
+	missing = g_slist_reverse (missing);
+
+	success = e_ews_connection_get_server_time_zones_sync (cnc, EWS_PRIORITY_MEDIUM, missing, &tzds, NULL, NULL);
+
+	g_slist_free (missing);
+
+	if (!success)
+		return FALSE;
+
+	g_mutex_lock (&tz_cache_lock);
+
+	for (link = tzds; link; link = g_slist_next (link)) {
+		EEwsCalendarTimeZoneDefinition *tzd = link->data;
+
+		if (tzd && tzd->id && server_definitions) {
+			ews_tz_lru_insert (server_definitions, tzd->id, tzd);
+			link->data = NULL;
+		}
 	}
 
-	ical_tz_location = g_hash_table_lookup (msdn_to_ical, msdn_tz_location);
-	g_rec_mutex_unlock (&tz_mutex);
+	g_mutex_unlock (&tz_cache_lock);
+
+	g_slist_free_full (tzds, (GDestroyNotify) e_ews_calendar_time_zone_definition_free);
 
-	return ical_tz_location;
+	return TRUE;
+}
+
+/* Writes the cached server time zone definition as 'element_name' */
+static void
+ews_tz_write_server_definition (ESoapMessage *msg,
+				const gchar *element_name,
+				const gchar *msdn_tzid,
+				gboolean as_item_field)
+{
+	EEwsCalendarTimeZoneDefinition *tzd;
+
+	if (!msdn_tzid)
+		return;
+
+	g_mutex_lock (&tz_cache_lock);
+
+	tzd = ews_tz_lru_lookup (server_definitions, msdn_tzid);
+	if (tzd) {
+		if (as_item_field)
+			e_ews_message_start_set_item_field (msg, element_name, "calendar", "CalendarItem");
+
+		ewscal_set_timezone (msg, element_name, tzd);
+
+		if (as_item_field)
+			e_ews_message_end_set_item_field (msg);
+	}
+
+	g_mutex_unlock (&tz_cache_lock);
 }
 
 /*
@@ -1276,25 +1388,10 @@ convert_vevent_calcomp_to_xml (ESoapMessage *msg,
 	satisfies = e_ews_connection_satisfies_server_version (convert_data->connection, E_EWS_EXCHANGE_2010);
 
 	if (satisfies && msdn_location_start != NULL && msdn_location_end != NULL) {
-		GSList *msdn_locations = NULL;
-		GSList *tzds = NULL;
-
-		msdn_locations = g_slist_append (msdn_locations, (gchar *) msdn_location_start);
-		msdn_locations = g_slist_append (msdn_locations, (gchar *) msdn_location_end);
-
-		if (e_ews_connection_get_server_time_zones_sync (
-				convert_data->connection,
-				EWS_PRIORITY_MEDIUM,
-				msdn_locations,
-				&tzds,
-				NULL,
-				NULL)) {
-			ewscal_set_timezone (msg, "StartTimeZone", tzds->data);
-			ewscal_set_timezone (msg, "EndTimeZone", tzds->data);
+		if (ews_tz_ensure_server_definitions (convert_data->connection, msdn_location_start, msdn_location_end)) {
+			ews_tz_write_server_definition (msg, "StartTimeZone", msdn_location_start, FALSE);
+			ews_tz_write_server_definition (msg, "EndTimeZone", msdn_location_end, FALSE);
 		}
-
-		g_slist_free (msdn_locations);
-		g_slist_free_full (tzds, (GDestroyNotify) e_ews_calendar_time_zone_definition_free);
 	} else {
 		e_ews_message_replace_server_version (msg, E_EWS_EXCHANGE_2007_SP1);
 
@@ -1813,47 +1910,13 @@ convert_vevent_component_to_updatexml (ESoapMessage *msg,
 
 	if (dt_changed && satisfies) {
 		if (msdn_location_start != NULL || msdn_location_end != NULL) {
-			GSList *msdn_locations = NULL;
-			GSList *tzds = NULL;
-
-			if (msdn_location_start != NULL)
-				msdn_locations = g_slist_append (msdn_locations, (gchar *) msdn_location_start);
+			if (ews_tz_ensure_server_definitions (convert_data->connection, msdn_location_start, msdn_location_end)) {
+				if (tzid_start != NULL)
+					ews_tz_write_server_definition (msg, "StartTimeZone", msdn_location_start ? msdn_location_start : msdn_location_end, TRUE);
 
-			if (msdn_location_end != NULL)
-				msdn_locations = g_slist_append (msdn_locations, (gchar *) msdn_location_end);
-
-			if (e_ews_connection_get_server_time_zones_sync (
-				convert_data->connection,
-				EWS_PRIORITY_MEDIUM,
-				msdn_locations,
-				&tzds,
-				NULL,
-				NULL)) {
-				GSList *tmp;
-
-				tmp = tzds;
-				if (tzid_start != NULL) {
-					e_ews_message_start_set_item_field (msg, "StartTimeZone", "calendar", "CalendarItem");
-					ewscal_set_timezone (msg, "StartTimeZone", tmp->data);
-					e_ews_message_end_set_item_field (msg);
-
-					/*
-					 * Exchange server is smart enough to return the list of
-					 * ServerTimeZone without repeated elements
-					 */
-					if (tmp->next != NULL)
-						tmp = tmp->next;
-				}
-
-				if (tzid_end != NULL) {
-					e_ews_message_start_set_item_field (msg, "EndTimeZone", "calendar", "CalendarItem");
-					ewscal_set_timezone (msg, "EndTimeZone", tmp->data);
-					e_ews_message_end_set_item_field (msg);
-				}
+				if (tzid_end != NULL)
+					ews_tz_write_server_definition (msg, "EndTimeZone", msdn_location_end ? msdn_location_end : msdn_location_start, TRUE);
 			}
-
-			g_slist_free (msdn_locations);
-			g_slist_free_full (tzds, (GDestroyNotify) e_ews_calendar_time_zone_definition_free);
 		}
 	} else if (dt_changed) {
 		e_ews_message_replace_server_version (msg, E_EWS_EXCHANGE_2007_SP1);
@@ -2301,3 +2364,147 @@ e_cal_backend_ews_get_datetime_with_zone (ETimezoneCache *timezone_cache,
 
 	return dt;
 }
+
+static gboolean
+ews_utils_changekey_equal (ICalComponent *icomp,
+			   const gchar *changekey)
+{
+	gchar *stored;
+	gboolean res;
+
+	stored = e_cal_util_component_dup_x_property (icomp, "X-EVOLUTION-CHANGEKEY");
+	res = g_strcmp0 (stored, changekey) == 0;
+	g_free (stored);
+
+	return res;
+}
+
+static gboolean
+ews_utils_gather_changekeys_cb (ECache *cache,
+				gint ncols,
+				const gchar *column_names[],
+				const gchar *column_values[],
+				gpointer user_data)
+{
+	GHashTable *changekeys = user_data;
+	gboolean is_master;
+
+	if (ncols != 3 || !column_values[0] || !column_values[1] || !column_values[2])
+		return TRUE;
+
+	/* The detached instances share the EWS item id with their master, but their
+	   revision is not the change key of the series, thus the master's wins */
+	is_master = !strchr (column_values[0], E_CAL_BACKEND_EWS_CACHE_RID_SEPARATOR);
+
+	if (is_master || !g_hash_table_contains (changekeys, column_values[1]))
+		g_hash_table_insert (changekeys, g_strdup (column_values[1]), g_strdup (column_values[2]));
+
+	return TRUE;
+}
+
+/* Returns EWS item id ~> stored change key for the @items, read with a single
+   query from the cache columns, without parsing any component, or NULL on error */
+static GHashTable *
+ews_utils_dup_stored_changekeys (ECalCache *cal_cache,
+				 const GSList *items, /* EEwsItem * */
+				 GCancellable *cancellable)
+{
+	GHashTable *changekeys;
+	GString *stmt;
+	const GSList *link;
+	gboolean any = FALSE;
+	GError *local_error = NULL;
+
+	changekeys = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	stmt = g_string_new ("SELECT " E_CACHE_COLUMN_UID "," E_CAL_BACKEND_EWS_CACHE_COLUMN_ITEMID "," E_CACHE_COLUMN_REVISION
+		" FROM " E_CACHE_TABLE_OBJECTS " WHERE " E_CAL_BACKEND_EWS_CACHE_COLUMN_ITEMID " IN (");
+
+	for (link = items; link; link = g_slist_next (link)) {
+		const EwsId *id = e_ews_item_get_id (link->data);
+
+		if (!id || !id->id)
+			continue;
+
+		if (any)
+			g_string_append_c (stmt, ',');
+
+		e_cache_sqlite_stmt_append_printf (stmt, "%Q", id->id);
+		any = TRUE;
+	}
+
+	e_cache_sqlite_stmt_append_printf (stmt, ") AND " E_CACHE_COLUMN_STATE "!=%d", E_OFFLINE_STATE_LOCALLY_DELETED);
+
+	if (any && !e_cache_sqlite_select (E_CACHE (cal_cache), stmt->str, ews_utils_gather_changekeys_cb, changekeys, cancellable, &local_error)) {
+		g_warning ("%s: Failed to read change keys: %s", G_STRFUNC, local_error ? local_error->message : "Unknown error");
+
+		g_hash_table_destroy (changekeys);
+		changekeys = NULL;
+	}
+
+	g_string_free (stmt, TRUE);
+	g_clear_error (&local_error);
+
+	return changekeys;
+}
+
+GSList * /* the possibly modified 'in_items' */
+e_cal_backend_ews_verify_changes (ECalCache *cal_cache,
+				  ICalComponentKind kind,
+				  GSList *in_items, /* EEwsItem * */
+				  GCancellable *cancellable)
+{
+	GSList *items = NULL, *link;
+	GHashTable *changekeys;
+
+	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), in_items);
+
+	if (!in_items)
+		return NULL;
+
+	changekeys = ews_utils_dup_stored_changekeys (cal_cache, in_items, cancellable);
+
+	for (link = in_items; link; link = g_slist_next (link)) {
+		EEwsItem *item = link->data;
+		const EwsId *id = e_ews_item_get_id (item);
+		EEwsItemType type = e_ews_item_get_item_type (item);
+
+		if (!g_cancellable_is_cancelled (cancellable) && (
+		    (type == E_EWS_ITEM_TYPE_EVENT && kind == I_CAL_VEVENT_COMPONENT) ||
+		    (type == E_EWS_ITEM_TYPE_MEMO && kind == I_CAL_VJOURNAL_COMPONENT) ||
+		    (type == E_EWS_ITEM_TYPE_TASK && kind == I_CAL_VTODO_COMPONENT) )) {
+			gboolean unchanged;
+
+			if (changekeys) {
+				unchanged = id && id->id && id->change_key &&
+					g_strcmp0 (g_hash_table_lookup (changekeys, id->id), id->change_key) == 0;
+			} else {
+				ECalComponent *existing = NULL;
+
+				/* Fallback, when the cache could not be queried directly */
+				unchanged = e_cal_cache_get_component (cal_cache, id->id, NULL, &existing, cancellable, NULL) &&
+					existing && ews_utils_changekey_equal (e_cal_component_get_icalcomponent (existing), id->change_key);
+
+				g_clear_object (&existing);
+			}
+
+			if (unchanged)
+				g_object_unref (item);
+			else
+				items = g_slist_prepend (items, item);
+		} else if (type == E_EWS_ITEM_TYPE_EVENT ||
+			   type == E_EWS_ITEM_TYPE_MEMO ||
+			   type == E_EWS_ITEM_TYPE_TASK) {
+			g_object_unref (item);
+		} else {
+			items = g_slist_prepend (items, item);
+		}
+	}
+
+	if (changekeys)
+		g_hash_table_destroy (changekeys);
+
+	g_slist_free (in_items);
+
+	return items;
+}
@@ -33,6 +33,14 @@ G_BEGIN_DECLS
 #define MINUTES_IN_HOUR 60
 #define SECS_IN_MINUTE 60
 
+/* The ECalCache column holding ECalMetaBackendInfo::extra, which is the EWS item id;
+   the change key is stored as the revision, see ecb_ews_dup_component_revision() */
+#define E_CAL_BACKEND_EWS_CACHE_COLUMN_ITEMID "bdata"
+#define E_CAL_BACKEND_EWS_CACHE_ITEMID_INDEX "ews_itemid_index"
+
+/* Separates the UID and the RECURRENCE-ID in the ECalCache key of the detached instances */
+#define E_CAL_BACKEND_EWS_CACHE_RID_SEPARATOR '\n'
+
 typedef struct {
 	EEwsConnection *connection;
 	ETimezoneCache *timezone_cache;
@@ -66,6 +74,7 @@ void e_ews_clean_icomponent (ICalComponent *icomp);
 
 const gchar *e_cal_backend_ews_tz_util_get_msdn_equivalent (const gchar *ical_tz_location);
 const gchar *e_cal_backend_ews_tz_util_get_ical_equivalent (const gchar *msdn_tz_location);
+ICalTimezone *e_cal_backend_ews_tz_util_get_builtin_zone (const gchar *msdn_tzid, const gchar *evo_ews_tzid);
 void e_cal_backend_ews_populate_windows_zones (void);
 void e_cal_backend_ews_unref_windows_zones (void);
 
@@ -77,6 +86,11 @@ gboolean e_cal_backend_ews_prepare_accept_item_request (ESoapMessage *msg, gpoin
 
 guint e_cal_backend_ews_rid_to_index (ICalTimezone *timezone, const gchar *rid, ICalComponent *comp, GError **error);
 
+GSList *	e_cal_backend_ews_verify_changes		(ECalCache *cal_cache,
+								 ICalComponentKind kind,
+								 GSList *in_items, /* EEwsItem * */
+								 GCancellable *cancellable);
+
 ICalTime *	e_cal_backend_ews_get_datetime_with_zone	(ETimezoneCache *timezone_cache,
 								 ICalComponent *vcalendar,
 								 ICalComponent *comp,
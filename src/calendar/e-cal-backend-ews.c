@@ -43,6 +43,7 @@
 #include "server/e-ews-camel-common.h"
 
 #include "e-cal-backend-ews.h"
+#include "e-cal-backend-ews-occurrences.h"
 #include "e-cal-backend-ews-utils.h"
 
 #ifndef O_BINARY
@@ -73,11 +74,27 @@ struct _ECalBackendEwsPrivate {
 	gboolean is_freebusy_calendar;
 
 	gchar *attachments_dir;
+
+	GMutex freebusy_lock;
+	GHashTable *freebusy_cache; /* gchar *key ~> ECalBackendEwsFreeBusyEntry * */
+
+	GMutex batched_lock;
+	GHashTable *batched; /* gchar *uid ~> BatchedResult *, of the batched requests */
 };
 
 #define X_EWS_ORIGINAL_COMP "X-EWS-ORIGINAL-COMP"
 
 #define EWS_MAX_FETCH_COUNT 100
+#define EWS_MAX_FETCH_PARALLEL 4
+#define EWS_MAX_CREATE_COUNT 50
+
+/* EWS can support only 100 identities, which is the maximum number of identities that the Web service method can request
+   see http://msdn.microsoft.com / en - us / library / aa564001 % 28v = EXCHG.140 % 29.aspx */
+#define EWS_MAX_FREEBUSY_USERS 100
+#define EWS_MAX_FREEBUSY_PARALLEL 4
+
+/* in seconds */
+#define EWS_FREEBUSY_CACHE_TTL (5 * 60)
 
 #define GET_ITEMS_SYNC_PROPERTIES \
 	"item:Attachments" \
@@ -102,6 +119,68 @@ struct _ECalBackendEwsPrivate {
 	" calendar:StartTimeZone" \
 	" calendar:EndTimeZone"
 
+/* Used to build the component directly from the item properties,
+   instead of parsing the MimeContent; see ecb_ews_item_props_to_vcalendar() */
+#define GET_ITEMS_SYNC_PROPERTIES_TYPED \
+	"item:Attachments" \
+	" item:Body" \
+	" item:Categories" \
+	" item:DateTimeCreated" \
+	" item:HasAttachments" \
+	" item:LastModifiedTime" \
+	" item:ReminderIsSet" \
+	" item:ReminderMinutesBeforeStart" \
+	" item:Sensitivity" \
+	" item:Subject" \
+	" calendar:UID" \
+	" calendar:Start" \
+	" calendar:End" \
+	" calendar:IsAllDayEvent" \
+	" calendar:LegacyFreeBusyStatus" \
+	" calendar:Location" \
+	" calendar:Organizer" \
+	" calendar:CalendarItemType" \
+	" calendar:RecurrenceId" \
+	" calendar:Recurrence" \
+	" calendar:DeletedOccurrences" \
+	" calendar:Resources" \
+	" calendar:ModifiedOccurrences" \
+	" calendar:IsMeeting" \
+	" calendar:IsResponseRequested" \
+	" calendar:MyResponseType" \
+	" calendar:RequiredAttendees" \
+	" calendar:OptionalAttendees" \
+	" calendar:StartTimeZone" \
+	" calendar:EndTimeZone"
+
+/* Only what ecb_ews_item_to_component_sync() reads for tasks and memos,
+   instead of the much bigger "AllProperties" shape; the ItemClass is
+   needed to recognize the memos */
+#define GET_ITEMS_SYNC_PROPERTIES_TASK_MEMO \
+	"item:Attachments" \
+	" item:Body" \
+	" item:Categories" \
+	" item:DateTimeCreated" \
+	" item:HasAttachments" \
+	" item:ItemClass" \
+	" item:Sensitivity" \
+	" item:Subject"
+
+#define GET_ITEMS_SYNC_PROPERTIES_TASK \
+	GET_ITEMS_SYNC_PROPERTIES_TASK_MEMO \
+	" item:Importance" \
+	" task:CompleteDate" \
+	" task:Delegator" \
+	" task:DueDate" \
+	" task:Owner" \
+	" task:PercentComplete" \
+	" task:Recurrence" \
+	" task:StartDate" \
+	" task:Status"
+
+#define GET_ITEMS_SYNC_PROPERTIES_MEMO \
+	GET_ITEMS_SYNC_PROPERTIES_TASK_MEMO
+
 #define e_data_cal_error_if_fail(expr, _code)					\
 	G_STMT_START {								\
 		if (G_LIKELY (expr)) {						\
@@ -201,6 +280,108 @@ ecb_ews_maybe_disconnect_sync (ECalBackendEws *cbews,
 	}
 }
 
+typedef struct _ECalBackendEwsFreeBusyEntry {
+	ICalComponent *icomp; /* without the ATTENDEE property */
+	gint64 stamp; /* g_get_monotonic_time() in seconds */
+} ECalBackendEwsFreeBusyEntry;
+
+static void
+ecb_ews_freebusy_entry_free (gpointer ptr)
+{
+	ECalBackendEwsFreeBusyEntry *entry = ptr;
+
+	if (entry) {
+		g_clear_object (&entry->icomp);
+		g_free (entry);
+	}
+}
+
+static gchar *
+ecb_ews_dup_freebusy_key (const gchar *user,
+			  time_t start,
+			  time_t end)
+{
+	gchar *key, *lower;
+
+	lower = g_ascii_strdown (user, -1);
+	key = g_strdup_printf ("%s\n%" G_GINT64_FORMAT "\n%" G_GINT64_FORMAT, lower, (gint64) start, (gint64) end);
+	g_free (lower);
+
+	return key;
+}
+
+/* Returns a new copy of the cached free/busy component, or NULL */
+static ICalComponent *
+ecb_ews_freebusy_cache_lookup (ECalBackendEws *cbews,
+			       const gchar *user,
+			       time_t start,
+			       time_t end)
+{
+	ECalBackendEwsFreeBusyEntry *entry;
+	ICalComponent *icomp = NULL;
+	gchar *key;
+
+	key = ecb_ews_dup_freebusy_key (user, start, end);
+
+	g_mutex_lock (&cbews->priv->freebusy_lock);
+
+	entry = g_hash_table_lookup (cbews->priv->freebusy_cache, key);
+	if (entry) {
+		if (g_get_monotonic_time () / G_USEC_PER_SEC - entry->stamp < EWS_FREEBUSY_CACHE_TTL)
+			icomp = i_cal_component_clone (entry->icomp);
+		else
+			g_hash_table_remove (cbews->priv->freebusy_cache, key);
+	}
+
+	g_mutex_unlock (&cbews->priv->freebusy_lock);
+
+	g_free (key);
+
+	return icomp;
+}
+
+static void
+ecb_ews_freebusy_cache_store (ECalBackendEws *cbews,
+			      const gchar *user,
+			      time_t start,
+			      time_t end,
+			      ICalComponent *icomp)
+{
+	ECalBackendEwsFreeBusyEntry *entry;
+	GHashTableIter iter;
+	gpointer value;
+	gint64 now;
+
+	now = g_get_monotonic_time () / G_USEC_PER_SEC;
+
+	entry = g_new0 (ECalBackendEwsFreeBusyEntry, 1);
+	entry->icomp = i_cal_component_clone (icomp);
+	entry->stamp = now;
+
+	g_mutex_lock (&cbews->priv->freebusy_lock);
+
+	/* Drop expired entries, to not grow the cache indefinitely */
+	g_hash_table_iter_init (&iter, cbews->priv->freebusy_cache);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		ECalBackendEwsFreeBusyEntry *existing = value;
+
+		if (now - existing->stamp >= EWS_FREEBUSY_CACHE_TTL)
+			g_hash_table_iter_remove (&iter);
+	}
+
+	g_hash_table_insert (cbews->priv->freebusy_cache, ecb_ews_dup_freebusy_key (user, start, end), entry);
+
+	g_mutex_unlock (&cbews->priv->freebusy_lock);
+}
+
+static void
+ecb_ews_freebusy_cache_clear (ECalBackendEws *cbews)
+{
+	g_mutex_lock (&cbews->priv->freebusy_lock);
+	g_hash_table_remove_all (cbews->priv->freebusy_cache);
+	g_mutex_unlock (&cbews->priv->freebusy_lock);
+}
+
 static void
 ecb_ews_server_notification_cb (ECalBackendEws *cbews,
 				GSList *events,
@@ -237,33 +418,113 @@ ecb_ews_server_notification_cb (ECalBackendEws *cbews,
 		}
 	}
 
-	if (update_folder)
+	if (update_folder) {
+		/* Any change can influence the free/busy information of the user */
+		ecb_ews_freebusy_cache_clear (cbews);
+
 		e_cal_meta_backend_schedule_refresh (E_CAL_META_BACKEND (cbews));
+	}
+}
+
+/* The cnc_lock guards only the connection swap; the operations work
+   with their own reference, thus they can run in parallel, even when
+   the connection is replaced or unset meanwhile */
+static EEwsConnection *
+ecb_ews_ref_connection (ECalBackendEws *cbews)
+{
+	EEwsConnection *cnc = NULL;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), NULL);
+
+	g_rec_mutex_lock (&cbews->priv->cnc_lock);
+
+	if (cbews->priv->cnc)
+		cnc = g_object_ref (cbews->priv->cnc);
+
+	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+
+	return cnc;
+}
+
+/* Like ecb_ews_ref_connection(), only sets the 'error' when not connected */
+static EEwsConnection *
+ecb_ews_ref_connection_sync (ECalBackendEws *cbews,
+			     GError **error)
+{
+	EEwsConnection *cnc;
+
+	cnc = ecb_ews_ref_connection (cbews);
+
+	if (!cnc)
+		g_propagate_error (error, EC_ERROR (E_CLIENT_ERROR_REPOSITORY_OFFLINE));
+
+	return cnc;
+}
+
+/* The folder id is replaced on connect, thus the operations use a copy */
+static gchar *
+ecb_ews_dup_folder_id (ECalBackendEws *cbews)
+{
+	gchar *folder_id;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), NULL);
+
+	g_rec_mutex_lock (&cbews->priv->cnc_lock);
+	folder_id = g_strdup (cbews->priv->folder_id);
+	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+
+	return folder_id;
+}
+
+static EwsFolderId *
+ecb_ews_new_folder_id (ECalBackendEws *cbews)
+{
+	EwsFolderId *fid;
+	gchar *folder_id;
+
+	folder_id = ecb_ews_dup_folder_id (cbews);
+	fid = e_ews_folder_id_new (folder_id, NULL, FALSE);
+	g_free (folder_id);
+
+	return fid;
+}
+
+/* Stops listening on a connection, which had been swapped out of the priv->cnc */
+static void
+ecb_ews_release_connection (ECalBackendEws *cbews,
+			    EEwsConnection *cnc,
+			    guint subscription_key)
+{
+	g_signal_handlers_disconnect_by_func (cnc, ecb_ews_server_notification_cb, cbews);
+
+	if (subscription_key != 0)
+		e_ews_connection_disable_notifications_sync (cnc, subscription_key);
+
+	g_object_unref (cnc);
 }
 
 static void
 ecb_ews_unset_connection (ECalBackendEws *cbews)
 {
+	EEwsConnection *cnc;
+	guint subscription_key;
+
 	g_return_if_fail (E_IS_CAL_BACKEND_EWS (cbews));
 
 	g_rec_mutex_lock (&cbews->priv->cnc_lock);
 
-	if (cbews->priv->cnc) {
-		e_ews_connection_set_disconnected_flag (cbews->priv->cnc, TRUE);
-
-		g_signal_handlers_disconnect_by_func (cbews->priv->cnc, ecb_ews_server_notification_cb, cbews);
+	cnc = cbews->priv->cnc;
+	cbews->priv->cnc = NULL;
 
-		if (cbews->priv->subscription_key != 0) {
-			e_ews_connection_disable_notifications_sync (
-				cbews->priv->cnc,
-				cbews->priv->subscription_key);
-			cbews->priv->subscription_key = 0;
-		}
-	}
-
-	g_clear_object (&cbews->priv->cnc);
+	subscription_key = cbews->priv->subscription_key;
+	cbews->priv->subscription_key = 0;
 
 	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+
+	if (cnc) {
+		e_ews_connection_set_disconnected_flag (cnc, TRUE);
+		ecb_ews_release_connection (cbews, cnc, subscription_key);
+	}
 }
 
 static ICalTimezone *
@@ -273,24 +534,19 @@ ecb_ews_get_timezone (ETimezoneCache *timezone_cache,
 		      const gchar *evo_ews_tzid)
 {
 	ICalTimezone *zone = NULL;
-	const gchar *evo_ews_msdn_tzid;
-
-	zone = e_timezone_cache_get_timezone (timezone_cache, tzid);
-	if (zone == NULL)
-		zone = i_cal_timezone_get_builtin_timezone (tzid);
 
-	if (g_strcmp0 (tzid, evo_ews_tzid) == 0)
-		return zone;
+	if (evo_ews_tzid != NULL && g_strcmp0 (tzid, evo_ews_tzid) != 0 &&
+	    g_strcmp0 (msdn_tzid, e_cal_backend_ews_tz_util_get_msdn_equivalent (evo_ews_tzid)) == 0)
+		zone = e_timezone_cache_get_timezone (timezone_cache, evo_ews_tzid);
+	else
+		zone = e_timezone_cache_get_timezone (timezone_cache, tzid);
 
-	if (evo_ews_tzid != NULL) {
-		evo_ews_msdn_tzid = e_cal_backend_ews_tz_util_get_msdn_equivalent (evo_ews_tzid);
+	/* The builtin zones are resolved once and shared by all the backends */
+	if (zone == NULL && msdn_tzid != NULL)
+		zone = e_cal_backend_ews_tz_util_get_builtin_zone (msdn_tzid, evo_ews_tzid);
 
-		if (g_strcmp0 (msdn_tzid, evo_ews_msdn_tzid) == 0) {
-			zone = e_timezone_cache_get_timezone (timezone_cache, evo_ews_tzid);
-			if (zone == NULL)
-				zone = i_cal_timezone_get_builtin_timezone (evo_ews_tzid);
-		}
-	}
+	if (zone == NULL)
+		zone = i_cal_timezone_get_builtin_timezone (tzid);
 
 	return zone;
 }
@@ -322,6 +578,246 @@ ecb_ews_responsetype_to_partstat (const gchar *responsetype)
 	return param;
 }
 
+/* Used with Exchange 2010 or newer, which provides the StartTimeZone and EndTimeZone */
+static void
+ecb_ews_get_item_timezones (ETimezoneCache *timezone_cache,
+			    EEwsItem *item,
+			    ICalTimezone **out_start_zone,
+			    ICalTimezone **out_end_zone)
+{
+	const gchar *start_tzid, *end_tzid;
+	const gchar *ical_start_tzid, *ical_end_tzid;
+	const gchar *evo_ews_start_tzid, *evo_ews_end_tzid;
+
+	start_tzid = e_ews_item_get_start_tzid (item);
+	end_tzid = e_ews_item_get_end_tzid (item);
+
+	ical_start_tzid = e_cal_backend_ews_tz_util_get_ical_equivalent (start_tzid);
+	ical_end_tzid = e_cal_backend_ews_tz_util_get_ical_equivalent (end_tzid);
+
+	evo_ews_start_tzid = e_ews_item_get_iana_start_time_zone (item);
+	evo_ews_end_tzid = e_ews_item_get_iana_end_time_zone (item);
+
+	/*
+	 * We have a few timezones that don't have an equivalent MSDN timezone.
+	 * For those, we will get ical_start_tzid being NULL and then we need to use
+	 * start_tzid, which one has the libical's expected name.
+	 */
+	*out_start_zone = ecb_ews_get_timezone (
+		timezone_cache,
+		start_tzid,
+		ical_start_tzid != NULL ? ical_start_tzid : start_tzid,
+		evo_ews_start_tzid);
+	*out_end_zone = ecb_ews_get_timezone (
+		timezone_cache,
+		end_tzid,
+		ical_end_tzid != NULL ? ical_end_tzid : end_tzid,
+		evo_ews_end_tzid);
+}
+
+static ICalTime *
+ecb_ews_utc_time_to_zone (time_t tt,
+			  ICalTimezone *zone)
+{
+	ICalTime *itt;
+
+	itt = i_cal_time_new_from_timet_with_zone (tt, 0, i_cal_timezone_get_utc_timezone ());
+	if (zone)
+		i_cal_time_convert_to_zone_inplace (itt, zone);
+
+	return itt;
+}
+
+static void
+ecb_ews_add_tzid_param (ICalProperty *prop,
+			ICalTimezone *zone)
+{
+	if (zone && zone != i_cal_timezone_get_utc_timezone ()) {
+		const gchar *tzid = i_cal_timezone_get_tzid (zone);
+
+		if (tzid && *tzid)
+			i_cal_property_take_parameter (prop, i_cal_parameter_new_tzid (tzid));
+	}
+}
+
+/* Builds the VCALENDAR with a single VEVENT from the typed item properties,
+   as requested by GET_ITEMS_SYNC_PROPERTIES_TYPED. The result is in the same
+   shape as the parsed MimeContent, thus it can be finished the same way.
+   Returns NULL, when the properties are not enough to describe the event;
+   the MimeContent should be used for it instead. */
+static ICalComponent *
+ecb_ews_item_props_to_vcalendar (ECalBackendEws *cbews,
+				 EEwsItem *item)
+{
+	ETimezoneCache *timezone_cache;
+	ICalTimezone *start_zone = NULL, *end_zone = NULL;
+	ICalComponent *vcomp, *icomp;
+	ICalProperty *prop;
+	ICalTime *itt;
+	EEwsRecurrence recur;
+	const EwsMailbox *organizer;
+	const GSList *link;
+	const gchar *str;
+	time_t start, end, recurrence_id, tt;
+	gboolean is_all_day;
+
+	if (!e_ews_item_get_calendar_start (item, &start) ||
+	    !e_ews_item_get_calendar_end (item, &end))
+		return NULL;
+
+	/* A series without decoded recurrence would lose its occurrences */
+	if (g_strcmp0 (e_ews_item_get_calendar_item_type (item), "RecurringMaster") == 0 &&
+	    !e_ews_item_get_recurrence (item, &recur))
+		return NULL;
+
+	timezone_cache = E_TIMEZONE_CACHE (cbews);
+	is_all_day = e_ews_item_get_is_all_day_event (item);
+
+	ecb_ews_get_item_timezones (timezone_cache, item, &start_zone, &end_zone);
+
+	if (start_zone)
+		e_timezone_cache_add_timezone (timezone_cache, start_zone);
+	else
+		end_zone = NULL;
+
+	if (end_zone)
+		e_timezone_cache_add_timezone (timezone_cache, end_zone);
+	else
+		end_zone = start_zone;
+
+	vcomp = i_cal_component_new (I_CAL_VCALENDAR_COMPONENT);
+	icomp = i_cal_component_new (I_CAL_VEVENT_COMPONENT);
+
+	str = e_ews_item_get_subject (item);
+	i_cal_component_set_summary (icomp, str ? str : "");
+
+	str = e_ews_item_get_body (item);
+	if (str && *str)
+		i_cal_component_set_description (icomp, str);
+
+	str = e_ews_item_get_location (item);
+	if (str && *str)
+		i_cal_component_set_location (icomp, str);
+
+	str = e_ews_item_get_sensitivity (item);
+	if (str) {
+		ICalProperty_Class class = I_CAL_CLASS_NONE;
+
+		if (g_strcmp0 (str, "Normal") == 0)
+			class = I_CAL_CLASS_PUBLIC;
+		else if (g_strcmp0 (str, "Private") == 0)
+			class = I_CAL_CLASS_PRIVATE;
+		else if (g_strcmp0 (str, "Confidential") == 0 ||
+			 g_strcmp0 (str, "Personal") == 0)
+			class = I_CAL_CLASS_CONFIDENTIAL;
+
+		if (class != I_CAL_CLASS_NONE)
+			i_cal_component_take_property (icomp, i_cal_property_new_class (class));
+	}
+
+	tt = e_ews_item_get_date_created (item);
+	if (tt > (time_t) 0) {
+		itt = ecb_ews_utc_time_to_zone (tt, NULL);
+		i_cal_component_take_property (icomp, i_cal_property_new_created (itt));
+		g_object_unref (itt);
+	}
+
+	tt = e_ews_item_get_last_modified_time (item);
+	if (tt > (time_t) 0) {
+		itt = ecb_ews_utc_time_to_zone (tt, NULL);
+		i_cal_component_take_property (icomp, i_cal_property_new_lastmodified (itt));
+		i_cal_component_set_dtstamp (icomp, itt);
+		g_object_unref (itt);
+	}
+
+	/* The recurrence sets also the DTSTART, thus it goes first */
+	e_ews_cal_utils_recurrence_to_rrule (item, icomp);
+
+	for (link = e_ews_item_get_deleted_occurrences (item); link; link = g_slist_next (link)) {
+		const time_t *deleted = link->data;
+
+		itt = ecb_ews_utc_time_to_zone (*deleted, start_zone);
+		prop = i_cal_property_new_exdate (itt);
+		ecb_ews_add_tzid_param (prop, start_zone);
+		i_cal_component_take_property (icomp, prop);
+		g_object_unref (itt);
+	}
+
+	itt = ecb_ews_utc_time_to_zone (start, start_zone);
+	i_cal_component_set_dtstart (icomp, itt);
+	g_object_unref (itt);
+
+	itt = ecb_ews_utc_time_to_zone (end, end_zone);
+	i_cal_component_set_dtend (icomp, itt);
+	g_object_unref (itt);
+
+	if (e_ews_item_get_calendar_recurrence_id (item, &recurrence_id)) {
+		itt = ecb_ews_utc_time_to_zone (recurrence_id, start_zone);
+		if (is_all_day)
+			i_cal_time_set_is_date (itt, TRUE);
+		prop = i_cal_property_new_recurrenceid (itt);
+		if (!is_all_day)
+			ecb_ews_add_tzid_param (prop, start_zone);
+		i_cal_component_take_property (icomp, prop);
+		g_object_unref (itt);
+	}
+
+	/* These are finished in ecb_ews_item_to_component_sync(), the same as with the MimeContent */
+	str = e_ews_item_get_legacy_free_busy_status (item);
+	if (str && *str) {
+		gchar *busy_status = g_ascii_strup (str, -1);
+
+		e_cal_util_component_set_x_property (icomp, "X-MICROSOFT-CDO-BUSYSTATUS", busy_status);
+
+		g_free (busy_status);
+	}
+
+	e_cal_util_component_set_x_property (icomp, "X-MICROSOFT-CDO-ALLDAYEVENT", is_all_day ? "TRUE" : "FALSE");
+
+	organizer = e_ews_item_get_organizer (item);
+	if (organizer && organizer->email && *organizer->email) {
+		const gchar *email = NULL;
+		gchar *mailto;
+
+		if (g_strcmp0 (organizer->routing_type, "EX") == 0)
+			email = e_ews_item_util_strip_ex_address (organizer->email);
+
+		mailto = g_strconcat ("mailto:", email ? email : organizer->email, NULL);
+		prop = i_cal_property_new_organizer (mailto);
+		g_free (mailto);
+
+		if (organizer->name && *organizer->name)
+			i_cal_property_take_parameter (prop, i_cal_parameter_new_cn (organizer->name));
+
+		i_cal_component_take_property (icomp, prop);
+	}
+
+	if (e_ews_item_get_reminder_is_set (item) &&
+	    e_ews_item_get_reminder_minutes_before_start (item) >= 0) {
+		ECalComponentAlarm *alarm;
+		ICalComponent *alarm_icomp;
+		ICalDuration *duration;
+
+		duration = i_cal_duration_new_from_int (-60 * e_ews_item_get_reminder_minutes_before_start (item));
+
+		alarm = e_cal_component_alarm_new ();
+		e_cal_component_alarm_set_action (alarm, E_CAL_COMPONENT_ALARM_DISPLAY);
+		e_cal_component_alarm_take_trigger (alarm,
+			e_cal_component_alarm_trigger_new_relative (E_CAL_COMPONENT_ALARM_TRIGGER_RELATIVE_START, duration));
+
+		alarm_icomp = e_cal_component_alarm_get_as_component (alarm);
+		if (alarm_icomp)
+			i_cal_component_take_component (icomp, alarm_icomp);
+
+		e_cal_component_alarm_free (alarm);
+		g_object_unref (duration);
+	}
+
+	i_cal_component_take_component (vcomp, icomp);
+
+	return vcomp;
+}
+
 static ECalComponent *
 ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 				EEwsItem *item,
@@ -335,6 +831,7 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 	ICalComponent *icomp, *vcomp;
 	ICalTimezone *utc_zone = i_cal_timezone_get_utc_timezone ();
 	CamelEwsSettings *ews_settings;
+	EEwsConnection *cnc;
 
 	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), NULL);
 	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
@@ -405,10 +902,14 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 			i_cal_component_take_property (icomp, prop);
 
 			/* get delegator mail box*/
-			e_ews_connection_resolve_names_sync (
-				cbews->priv->cnc, EWS_PRIORITY_MEDIUM, task_owner,
-				EWS_SEARCH_AD, NULL, FALSE, &mailboxes, NULL,
-				&includes_last_item, cancellable, error);
+			cnc = ecb_ews_ref_connection (cbews);
+			if (cnc) {
+				e_ews_connection_resolve_names_sync (
+					cnc, EWS_PRIORITY_MEDIUM, task_owner,
+					EWS_SEARCH_AD, NULL, FALSE, &mailboxes, NULL,
+					&includes_last_item, cancellable, error);
+				g_object_unref (cnc);
+			}
 
 			for (l = mailboxes; l != NULL; l = g_slist_next (l)) {
 				EwsMailbox *mb = l->data;
@@ -557,7 +1058,17 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 		gboolean timezone_set = FALSE;
 
 		mime_content = e_ews_item_get_mime_content (item);
-		vcomp = mime_content && *mime_content ? i_cal_parser_parse_string (mime_content) : NULL;
+
+		if (!mime_content || !*mime_content) {
+			/* Fetched with GET_ITEMS_SYNC_PROPERTIES_TYPED; the timezones are already set */
+			vcomp = ecb_ews_item_props_to_vcalendar (cbews, item);
+			if (!vcomp)
+				return NULL;
+
+			timezone_set = TRUE;
+		} else {
+			vcomp = i_cal_parser_parse_string (mime_content);
+		}
 
 		if (!vcomp && mime_content && *mime_content) {
 			const gchar *begin_vcalendar, *end_vcalendar;
@@ -593,7 +1104,7 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 		}
 
 		tzid = e_ews_item_get_tzid (item);
-		if (tzid == NULL) {
+		if (tzid == NULL && !timezone_set) {
 			/*
 			 * When we are working with Exchange server 2010 or newer, we have to handle a few
 			 * things more than we do working old servers. These things are:
@@ -613,34 +1124,8 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 			 *   as is used in DTSTART.
 			 */
 			ICalTimezone *start_zone, *end_zone;
-			const gchar *start_tzid, *end_tzid;
-			const gchar *ical_start_tzid, *ical_end_tzid;
-			const gchar *evo_ews_start_tzid, *evo_ews_end_tzid;
-
-			start_tzid = e_ews_item_get_start_tzid (item);
-			end_tzid = e_ews_item_get_end_tzid (item);
-
-			ical_start_tzid = e_cal_backend_ews_tz_util_get_ical_equivalent (start_tzid);
-			ical_end_tzid = e_cal_backend_ews_tz_util_get_ical_equivalent (end_tzid);
-
-			evo_ews_start_tzid = e_ews_item_get_iana_start_time_zone (item);
-			evo_ews_end_tzid = e_ews_item_get_iana_end_time_zone (item);
 
-			/*
-			 * We have a few timezones that don't have an equivalent MSDN timezone.
-			 * For those, we will get ical_start_tzid being NULL and then we need to use
-			 * start_tzid, which one has the libical's expected name.
-			 */
-			start_zone = ecb_ews_get_timezone (
-				timezone_cache,
-				start_tzid,
-				ical_start_tzid != NULL ? ical_start_tzid : start_tzid,
-				evo_ews_start_tzid);
-			end_zone = ecb_ews_get_timezone (
-				timezone_cache,
-				end_tzid,
-				ical_end_tzid != NULL ? ical_end_tzid : end_tzid,
-				evo_ews_end_tzid);
+			ecb_ews_get_item_timezones (timezone_cache, item, &start_zone, &end_zone);
 
 			if (start_zone != NULL) {
 				icomp = i_cal_component_get_first_component (vcomp, kind);
@@ -666,7 +1151,7 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 			}
 
 			if (!timezone_set)
-				tzid = start_tzid;
+				tzid = e_ews_item_get_start_tzid (item);
 		}
 
 		if (!timezone_set && tzid) {
@@ -946,8 +1431,10 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 
 		attachment_ids = e_ews_item_get_attachments_ids (item);
 
-		if (e_ews_connection_get_attachments_sync (
-			cbews->priv->cnc,
+		cnc = ecb_ews_ref_connection (cbews);
+
+		if (cnc && e_ews_connection_get_attachments_sync (
+			cnc,
 			EWS_PRIORITY_MEDIUM,
 			uid,
 			attachment_ids,
@@ -990,6 +1477,8 @@ ecb_ews_item_to_component_sync (ECalBackendEws *cbews,
 			g_slist_free_full (attaches, g_object_unref);
 			g_slist_free_full (info_attachments, (GDestroyNotify) e_ews_attachment_info_free);
 		}
+
+		g_clear_object (&cnc);
 	}
 
 	return res_component;
@@ -1062,118 +1551,216 @@ ecb_ews_restore_original_comp (ECalComponent *from_comp)
 	return comp;
 }
 
-static gboolean
-ecb_ews_get_items_sync (ECalBackendEws *cbews,
-			const GSList *item_ids, /* gchar * */
-			const gchar *default_props,
-			const EEwsAdditionalProps *add_props,
-			GSList **out_components, /* ECalComponent * */
-			GCancellable *cancellable,
-			GError **error)
+/* The MimeContent is always used with Exchange 2007, because it doesn't
+   provide the StartTimeZone/EndTimeZone, only the time zone name */
+static EEwsAdditionalProps *
+ecb_ews_new_event_add_props (ECalBackendEws *cbews,
+			     gboolean with_mime_content)
 {
-	GSList *items = NULL, *link, *retry_ids = NULL;
-	gboolean success = TRUE;
-
-	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), FALSE);
-	g_return_val_if_fail (out_components != NULL, FALSE);
+	EEwsAdditionalProps *add_props;
+	EEwsConnection *cnc;
+	gboolean is_2010;
 
-	while (success = success && !g_cancellable_set_error_if_cancelled (cancellable, error), success) {
-		GSList *received = NULL, *new_retry_ids = NULL, *ids_link;
+	cnc = ecb_ews_ref_connection (cbews);
+	is_2010 = cnc && e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010);
+	g_clear_object (&cnc);
 
-		success = e_ews_connection_get_items_sync (
-			cbews->priv->cnc,
-			EWS_PRIORITY_MEDIUM,
-			item_ids,
-			default_props,
-			add_props,
-			FALSE,
-			NULL,
-			E_EWS_BODY_TYPE_TEXT,
-			&received,
-			NULL, NULL,
-			cancellable,
-			error);
+	add_props = e_ews_additional_props_new ();
+	if (is_2010) {
+		EEwsExtendedFieldURI *ext_uri;
 
-		for (link = received, ids_link = (GSList *) item_ids; success && link && ids_link; link = g_slist_next (link), ids_link = g_slist_next (ids_link)) {
-			EEwsItem *item = link->data;
+		add_props->field_uri = g_strdup (with_mime_content ? GET_ITEMS_SYNC_PROPERTIES_2010 : GET_ITEMS_SYNC_PROPERTIES_TYPED);
 
-			if (!item)
-				continue;
+		ext_uri = e_ews_extended_field_uri_new ();
+		ext_uri->distinguished_prop_set_id = g_strdup ("PublicStrings");
+		ext_uri->prop_name = g_strdup ("EvolutionEWSStartTimeZone");
+		ext_uri->prop_type = g_strdup ("String");
+		add_props->extended_furis = g_slist_append (add_props->extended_furis, ext_uri);
 
-			if (e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR) {
-				const GError *item_error;
+		ext_uri = e_ews_extended_field_uri_new ();
+		ext_uri->distinguished_prop_set_id = g_strdup ("PublicStrings");
+		ext_uri->prop_name = g_strdup ("EvolutionEWSEndTimeZone");
+		ext_uri->prop_type = g_strdup ("String");
+		add_props->extended_furis = g_slist_append (add_props->extended_furis, ext_uri);
+	} else {
+		add_props->field_uri = g_strdup (GET_ITEMS_SYNC_PROPERTIES_2007);
+	}
 
-				item_error = e_ews_item_get_error (item);
-				if (g_error_matches (item_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_BATCHPROCESSINGSTOPPED)) {
-					new_retry_ids = g_slist_prepend (new_retry_ids, g_strdup (ids_link->data));
-					g_object_unref (item);
-				} else {
-					items = g_slist_prepend (items, item);
-				}
-			} else {
-				items = g_slist_prepend (items, item);
-			}
-		}
+	return add_props;
+}
 
-		g_slist_free_full (retry_ids, g_free);
-		g_slist_free (received);
-		retry_ids = new_retry_ids;
+typedef struct _GetItemsChunk {
+	GSList *ids; /* gchar *, borrowed */
+	GSList *received; /* EEwsItem * */
+	GError *error;
+	gint *n_pending;
+} GetItemsChunk;
 
-		if (!retry_ids)
-			break;
+static void
+ecb_ews_get_items_chunk_free (gpointer ptr)
+{
+	GetItemsChunk *chunk = ptr;
 
-		item_ids = retry_ids;
+	if (chunk) {
+		g_slist_free (chunk->ids);
+		g_slist_free_full (chunk->received, g_object_unref);
+		g_clear_error (&chunk->error);
+		g_free (chunk);
 	}
+}
 
-	g_slist_free_full (retry_ids, g_free);
+static void
+ecb_ews_get_items_chunk_done_cb (GObject *source_object,
+				 GAsyncResult *result,
+				 gpointer user_data)
+{
+	GetItemsChunk *chunk = user_data;
 
-	items = g_slist_reverse (items);
+	e_ews_connection_get_items_finish (E_EWS_CONNECTION (source_object), result, &chunk->received, &chunk->error);
 
-	if (!success)
-		goto exit;
+	(*chunk->n_pending)--;
+}
 
-	/* fetch modified occurrences */
-	for (link = items; link; link = g_slist_next (link)) {
-		EEwsItem *item = link->data;
-		const GSList *modified_occurrences;
+/* Fetches the @item_ids in GetItem requests of at most EWS_MAX_FETCH_COUNT ids,
+   several of them running concurrently. Items the server refused to process,
+   due to the batch processing being stopped, are requested again. */
+static gboolean
+ecb_ews_get_items_batched_sync (ECalBackendEws *cbews,
+				const GSList *item_ids, /* gchar * */
+				const gchar *default_props,
+				const EEwsAdditionalProps *add_props,
+				GSList **out_items, /* EEwsItem * */
+				GCancellable *cancellable,
+				GError **error)
+{
+	EEwsConnection *cnc;
+	GSList *items = NULL, *retry_ids = NULL;
+	gboolean success = TRUE;
 
-		if (!item || e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR)
-			continue;
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc)
+		return FALSE;
 
-		modified_occurrences = e_ews_item_get_modified_occurrences (item);
-		if (modified_occurrences) {
-			EEwsAdditionalProps *modified_add_props;
+	while (item_ids && (success = !g_cancellable_set_error_if_cancelled (cancellable, error))) {
+		GMainContext *main_context;
+		GPtrArray *chunks;
+		GetItemsChunk *chunk = NULL;
+		GSList *new_retry_ids = NULL, *link;
+		guint ii, n_ids = 0;
+		gint n_pending = 0;
 
-			modified_add_props = e_ews_additional_props_new ();
-			if (e_ews_connection_satisfies_server_version (cbews->priv->cnc, E_EWS_EXCHANGE_2010)) {
-				EEwsExtendedFieldURI *ext_uri;
+		chunks = g_ptr_array_new_with_free_func (ecb_ews_get_items_chunk_free);
 
-				modified_add_props->field_uri = g_strdup (GET_ITEMS_SYNC_PROPERTIES_2010);
+		for (link = (GSList *) item_ids; link; link = g_slist_next (link)) {
+			if (!chunk || n_ids >= EWS_MAX_FETCH_COUNT) {
+				if (chunk)
+					chunk->ids = g_slist_reverse (chunk->ids);
 
-				ext_uri = e_ews_extended_field_uri_new ();
-				ext_uri->distinguished_prop_set_id = g_strdup ("PublicStrings");
-				ext_uri->prop_name = g_strdup ("EvolutionEWSStartTimeZone");
-				ext_uri->prop_type = g_strdup ("String");
-				modified_add_props->extended_furis = g_slist_append (modified_add_props->extended_furis, ext_uri);
+				chunk = g_new0 (GetItemsChunk, 1);
+				chunk->n_pending = &n_pending;
+				n_ids = 0;
 
-				ext_uri = e_ews_extended_field_uri_new ();
-				ext_uri->distinguished_prop_set_id = g_strdup ("PublicStrings");
-				ext_uri->prop_name = g_strdup ("EvolutionEWSEndTimeZone");
-				ext_uri->prop_type = g_strdup ("String");
-				modified_add_props->extended_furis = g_slist_append (modified_add_props->extended_furis, ext_uri);
-			} else {
-				modified_add_props->field_uri = g_strdup (GET_ITEMS_SYNC_PROPERTIES_2007);
+				g_ptr_array_add (chunks, chunk);
+			}
+
+			chunk->ids = g_slist_prepend (chunk->ids, link->data);
+			n_ids++;
+		}
+
+		if (chunk)
+			chunk->ids = g_slist_reverse (chunk->ids);
+
+		main_context = g_main_context_new ();
+		g_main_context_push_thread_default (main_context);
+
+		for (ii = 0; ii < chunks->len; ii++) {
+			chunk = g_ptr_array_index (chunks, ii);
+
+			while (n_pending >= EWS_MAX_FETCH_PARALLEL)
+				g_main_context_iteration (main_context, TRUE);
+
+			n_pending++;
+
+			e_ews_connection_get_items (
+				cnc,
+				EWS_PRIORITY_MEDIUM,
+				chunk->ids,
+				default_props,
+				add_props,
+				FALSE,
+				NULL,
+				E_EWS_BODY_TYPE_TEXT,
+				NULL, NULL,
+				cancellable,
+				ecb_ews_get_items_chunk_done_cb,
+				chunk);
+		}
+
+		while (n_pending > 0)
+			g_main_context_iteration (main_context, TRUE);
+
+		g_main_context_pop_thread_default (main_context);
+		g_main_context_unref (main_context);
+
+		for (ii = 0; ii < chunks->len && success; ii++) {
+			GSList *ids_link;
+
+			chunk = g_ptr_array_index (chunks, ii);
+
+			if (chunk->error) {
+				g_propagate_error (error, chunk->error);
+				chunk->error = NULL;
+				success = FALSE;
+				break;
 			}
 
-			success = ecb_ews_get_items_sync (cbews, modified_occurrences, "IdOnly", modified_add_props, out_components, cancellable, error);
+			for (link = chunk->received, ids_link = chunk->ids; link && ids_link; link = g_slist_next (link), ids_link = g_slist_next (ids_link)) {
+				EEwsItem *item = link->data;
 
-			e_ews_additional_props_free (modified_add_props);
+				if (!item)
+					continue;
 
-			if (!success)
-				goto exit;
+				if (e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR &&
+				    g_error_matches (e_ews_item_get_error (item), EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_BATCHPROCESSINGSTOPPED)) {
+					new_retry_ids = g_slist_prepend (new_retry_ids, g_strdup (ids_link->data));
+				} else {
+					items = g_slist_prepend (items, g_object_ref (item));
+				}
+			}
 		}
+
+		g_ptr_array_unref (chunks);
+
+		g_slist_free_full (retry_ids, g_free);
+		retry_ids = g_slist_reverse (new_retry_ids);
+
+		if (!success)
+			break;
+
+		item_ids = retry_ids;
 	}
 
+	g_slist_free_full (retry_ids, g_free);
+	g_object_unref (cnc);
+
+	if (success)
+		*out_items = g_slist_reverse (items);
+	else
+		g_slist_free_full (items, g_object_unref);
+
+	return success;
+}
+
+static gboolean
+ecb_ews_items_to_components_sync (ECalBackendEws *cbews,
+				  const GSList *items, /* EEwsItem * */
+				  GSList **out_mime_ids, /* gchar *, nullable */
+				  GSList **out_components, /* ECalComponent * */
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	const GSList *link;
+
 	for (link = items; link; link = g_slist_next (link)) {
 		EEwsItem *item = link->data;
 		ECalComponent *comp;
@@ -1184,12 +1771,17 @@ ecb_ews_get_items_sync (ECalBackendEws *cbews,
 
 		comp = ecb_ews_item_to_component_sync (cbews, item, cancellable, &local_error);
 		if (!comp) {
-			if (!local_error)
-				continue;
+			if (local_error) {
+				g_propagate_error (error, local_error);
+				return FALSE;
+			}
 
-			g_propagate_error (error, local_error);
-			success = FALSE;
-			break;
+			if (out_mime_ids && e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_EVENT &&
+			    !e_ews_item_get_mime_content (item) && e_ews_item_get_id (item)) {
+				*out_mime_ids = g_slist_prepend (*out_mime_ids, g_strdup (e_ews_item_get_id (item)->id));
+			}
+
+			continue;
 		}
 
 		ecb_ews_store_original_comp (comp);
@@ -1197,8 +1789,220 @@ ecb_ews_get_items_sync (ECalBackendEws *cbews,
 		*out_components = g_slist_prepend (*out_components, comp);
 	}
 
+	return TRUE;
+}
+
+static gboolean
+ecb_ews_get_items_sync (ECalBackendEws *cbews,
+			const GSList *item_ids, /* gchar * */
+			const gchar *default_props,
+			const EEwsAdditionalProps *add_props,
+			GSList **out_components, /* ECalComponent * */
+			GCancellable *cancellable,
+			GError **error)
+{
+	GSList *items = NULL, *occurrence_ids = NULL, *mime_ids = NULL, *link;
+	gboolean success;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), FALSE);
+	g_return_val_if_fail (out_components != NULL, FALSE);
+
+	success = ecb_ews_get_items_batched_sync (cbews, item_ids, default_props, add_props, &items, cancellable, error);
+
+	if (!success)
+		goto exit;
+
+	/* fetch modified occurrences of all the series at once */
+	for (link = items; link; link = g_slist_next (link)) {
+		EEwsItem *item = link->data;
+		const GSList *olink;
+
+		if (!item || e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR)
+			continue;
+
+		for (olink = e_ews_item_get_modified_occurrences (item); olink; olink = g_slist_next (olink)) {
+			occurrence_ids = g_slist_prepend (occurrence_ids, olink->data);
+		}
+	}
+
+	if (occurrence_ids) {
+		EEwsAdditionalProps *modified_add_props;
+		GSList *occurrences = NULL;
+
+		occurrence_ids = g_slist_reverse (occurrence_ids);
+		modified_add_props = ecb_ews_new_event_add_props (cbews, FALSE);
+
+		success = ecb_ews_get_items_batched_sync (cbews, occurrence_ids, "IdOnly", modified_add_props, &occurrences, cancellable, error);
+
+		e_ews_additional_props_free (modified_add_props);
+		g_slist_free (occurrence_ids);
+
+		if (!success)
+			goto exit;
+
+		/* The components are assembled together with the masters below */
+		items = g_slist_concat (occurrences, items);
+	}
+
+	success = ecb_ews_items_to_components_sync (cbews, items, &mime_ids, out_components, cancellable, error);
+
+	/* Events, which could not be described by their properties, are read from their MimeContent */
+	if (success && mime_ids) {
+		EEwsAdditionalProps *mime_add_props;
+
+		g_slist_free_full (items, g_object_unref);
+		items = NULL;
+
+		mime_ids = g_slist_reverse (mime_ids);
+		mime_add_props = ecb_ews_new_event_add_props (cbews, TRUE);
+
+		success = ecb_ews_get_items_batched_sync (cbews, mime_ids, "IdOnly", mime_add_props, &items, cancellable, error) &&
+			ecb_ews_items_to_components_sync (cbews, items, NULL, out_components, cancellable, error);
+
+		e_ews_additional_props_free (mime_add_props);
+	}
+
  exit:
 	g_slist_free_full (items, g_object_unref);
+	g_slist_free_full (mime_ids, g_free);
+
+	return success;
+}
+
+typedef struct _FetchTaskMemoData {
+	EEwsConnection *cnc;
+	GQueue queued; /* TaskMemoChunk *, to be sent */
+	GQueue received; /* TaskMemoChunk *, to be converted */
+	gint n_pending;
+} FetchTaskMemoData;
+
+typedef struct _TaskMemoChunk {
+	FetchTaskMemoData *ftmd;
+	GSList *ids; /* gchar * */
+	const EEwsAdditionalProps *add_props;
+	GSList *received; /* EEwsItem * */
+	GError *error;
+} TaskMemoChunk;
+
+static void
+ecb_ews_task_memo_chunk_free (gpointer ptr)
+{
+	TaskMemoChunk *chunk = ptr;
+
+	if (chunk) {
+		g_slist_free_full (chunk->ids, g_free);
+		g_slist_free_full (chunk->received, g_object_unref);
+		g_clear_error (&chunk->error);
+		g_free (chunk);
+	}
+}
+
+/* Takes the @ids */
+static void
+ecb_ews_task_memo_queue_ids (FetchTaskMemoData *ftmd,
+			     GSList *ids, /* gchar * */
+			     const EEwsAdditionalProps *add_props)
+{
+	while (ids) {
+		TaskMemoChunk *chunk;
+		GSList *last;
+
+		chunk = g_new0 (TaskMemoChunk, 1);
+		chunk->ftmd = ftmd;
+		chunk->ids = ids;
+		chunk->add_props = add_props;
+
+		last = g_slist_nth (ids, EWS_MAX_FETCH_COUNT - 1);
+		if (last) {
+			ids = last->next;
+			last->next = NULL;
+		} else {
+			ids = NULL;
+		}
+
+		g_queue_push_tail (&ftmd->queued, chunk);
+	}
+}
+
+static void
+ecb_ews_task_memo_chunk_done_cb (GObject *source_object,
+				 GAsyncResult *result,
+				 gpointer user_data)
+{
+	TaskMemoChunk *chunk = user_data;
+
+	e_ews_connection_get_items_finish (E_EWS_CONNECTION (source_object), result, &chunk->received, &chunk->error);
+
+	g_queue_push_tail (&chunk->ftmd->received, chunk);
+	chunk->ftmd->n_pending--;
+}
+
+static void
+ecb_ews_task_memo_send_queued (FetchTaskMemoData *ftmd,
+			       GCancellable *cancellable)
+{
+	while (ftmd->n_pending < EWS_MAX_FETCH_PARALLEL && !g_queue_is_empty (&ftmd->queued)) {
+		TaskMemoChunk *chunk = g_queue_pop_head (&ftmd->queued);
+
+		ftmd->n_pending++;
+
+		e_ews_connection_get_items (
+			ftmd->cnc,
+			EWS_PRIORITY_MEDIUM,
+			chunk->ids,
+			"IdOnly",
+			chunk->add_props,
+			FALSE,
+			NULL,
+			E_EWS_BODY_TYPE_TEXT,
+			NULL, NULL,
+			cancellable,
+			ecb_ews_task_memo_chunk_done_cb,
+			chunk);
+	}
+}
+
+/* Converts the received items of the @chunk to components; items the server
+   refused to process, due to the batch processing being stopped, are queued
+   to be requested again */
+static gboolean
+ecb_ews_task_memo_chunk_convert_sync (ECalBackendEws *cbews,
+				      TaskMemoChunk *chunk,
+				      GSList **out_components, /* ECalComponent * */
+				      GCancellable *cancellable,
+				      GError **error)
+{
+	GSList *items = NULL, *retry_ids = NULL, *link, *ids_link;
+	gboolean success;
+
+	if (chunk->error) {
+		g_propagate_error (error, chunk->error);
+		chunk->error = NULL;
+
+		return FALSE;
+	}
+
+	for (link = chunk->received, ids_link = chunk->ids; link && ids_link; link = g_slist_next (link), ids_link = g_slist_next (ids_link)) {
+		EEwsItem *item = link->data;
+
+		if (!item)
+			continue;
+
+		if (e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR &&
+		    g_error_matches (e_ews_item_get_error (item), EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_BATCHPROCESSINGSTOPPED)) {
+			retry_ids = g_slist_prepend (retry_ids, g_strdup (ids_link->data));
+		} else {
+			items = g_slist_prepend (items, item);
+		}
+	}
+
+	items = g_slist_reverse (items);
+
+	ecb_ews_task_memo_queue_ids (chunk->ftmd, g_slist_reverse (retry_ids), chunk->add_props);
+
+	success = ecb_ews_items_to_components_sync (cbews, items, NULL, out_components, cancellable, error);
+
+	g_slist_free (items);
 
 	return success;
 }
@@ -1210,7 +2014,10 @@ ecb_ews_fetch_items_sync (ECalBackendEws *cbews,
 			  GCancellable *cancellable,
 			  GError **error)
 {
-	GSList *event_ids = NULL, *task_memo_ids = NULL, *link;
+	FetchTaskMemoData ftmd = { NULL, G_QUEUE_INIT, G_QUEUE_INIT, 0 };
+	EEwsAdditionalProps *task_add_props = NULL, *memo_add_props = NULL;
+	GMainContext *main_context = NULL;
+	GSList *event_ids = NULL, *task_ids = NULL, *memo_ids = NULL, *link;
 	gboolean success = TRUE;
 
 	for (link = (GSList *) items; link; link = g_slist_next (link)) {
@@ -1220,45 +2027,88 @@ ecb_ews_fetch_items_sync (ECalBackendEws *cbews,
 
 		if (type == E_EWS_ITEM_TYPE_EVENT)
 			event_ids = g_slist_prepend (event_ids, g_strdup (id->id));
-		else if (type == E_EWS_ITEM_TYPE_TASK || type == E_EWS_ITEM_TYPE_MEMO) {
-			task_memo_ids = g_slist_prepend (task_memo_ids, g_strdup (id->id));
+		else if (type == E_EWS_ITEM_TYPE_TASK)
+			task_ids = g_slist_prepend (task_ids, g_strdup (id->id));
+		else if (type == E_EWS_ITEM_TYPE_MEMO)
+			memo_ids = g_slist_prepend (memo_ids, g_strdup (id->id));
+	}
+
+	/* Tasks and memos are requested first, then they are being downloaded
+	   while the events are fetched; each of their responses is converted
+	   as soon as it arrives, while the rest is still on the way */
+	if (task_ids || memo_ids) {
+		ftmd.cnc = ecb_ews_ref_connection_sync (cbews, error);
+
+		if (!ftmd.cnc) {
+			g_slist_free_full (event_ids, g_free);
+			g_slist_free_full (task_ids, g_free);
+			g_slist_free_full (memo_ids, g_free);
+
+			return FALSE;
+		}
+
+		if (task_ids) {
+			task_add_props = e_ews_additional_props_new ();
+			task_add_props->field_uri = g_strdup (GET_ITEMS_SYNC_PROPERTIES_TASK);
+
+			ecb_ews_task_memo_queue_ids (&ftmd, g_slist_reverse (task_ids), task_add_props);
+		}
+
+		if (memo_ids) {
+			memo_add_props = e_ews_additional_props_new ();
+			memo_add_props->field_uri = g_strdup (GET_ITEMS_SYNC_PROPERTIES_MEMO);
+
+			ecb_ews_task_memo_queue_ids (&ftmd, g_slist_reverse (memo_ids), memo_add_props);
 		}
+
+		main_context = g_main_context_new ();
+		g_main_context_push_thread_default (main_context);
+
+		ecb_ews_task_memo_send_queued (&ftmd, cancellable);
 	}
 
 	if (event_ids) {
 		EEwsAdditionalProps *add_props;
 
-		add_props = e_ews_additional_props_new ();
-		if (e_ews_connection_satisfies_server_version (cbews->priv->cnc, E_EWS_EXCHANGE_2010)) {
-			EEwsExtendedFieldURI *ext_uri;
-
-			add_props->field_uri = g_strdup (GET_ITEMS_SYNC_PROPERTIES_2010);
-
-			ext_uri = e_ews_extended_field_uri_new ();
-			ext_uri->distinguished_prop_set_id = g_strdup ("PublicStrings");
-			ext_uri->prop_name = g_strdup ("EvolutionEWSStartTimeZone");
-			ext_uri->prop_type = g_strdup ("String");
-			add_props->extended_furis = g_slist_append (add_props->extended_furis, ext_uri);
-
-			ext_uri = e_ews_extended_field_uri_new ();
-			ext_uri->distinguished_prop_set_id = g_strdup ("PublicStrings");
-			ext_uri->prop_name = g_strdup ("EvolutionEWSEndTimeZone");
-			ext_uri->prop_type = g_strdup ("String");
-			add_props->extended_furis = g_slist_append (add_props->extended_furis, ext_uri);
-		} else {
-			add_props->field_uri = g_strdup (GET_ITEMS_SYNC_PROPERTIES_2007);
-		}
+		add_props = ecb_ews_new_event_add_props (cbews, FALSE);
 
 		success = ecb_ews_get_items_sync (cbews, event_ids, "IdOnly", add_props, out_components, cancellable, error);
 
 		e_ews_additional_props_free (add_props);
 	}
 
-	if (task_memo_ids && success)
-		success = ecb_ews_get_items_sync (cbews, task_memo_ids, "AllProperties", NULL, out_components, cancellable, error);
+	if (main_context) {
+		for (;;) {
+			TaskMemoChunk *chunk;
+
+			while ((chunk = g_queue_pop_head (&ftmd.received)) != NULL) {
+				if (success)
+					success = ecb_ews_task_memo_chunk_convert_sync (cbews, chunk, out_components, cancellable, error);
+
+				ecb_ews_task_memo_chunk_free (chunk);
+			}
+
+			if (success) {
+				ecb_ews_task_memo_send_queued (&ftmd, cancellable);
+			} else {
+				g_queue_foreach (&ftmd.queued, (GFunc) ecb_ews_task_memo_chunk_free, NULL);
+				g_queue_clear (&ftmd.queued);
+			}
+
+			if (!ftmd.n_pending)
+				break;
+
+			g_main_context_iteration (main_context, TRUE);
+		}
+
+		g_main_context_pop_thread_default (main_context);
+		g_main_context_unref (main_context);
+	}
 
+	g_clear_object (&ftmd.cnc);
+	e_ews_additional_props_free (task_add_props);
+	e_ews_additional_props_free (memo_add_props);
 	g_slist_free_full (event_ids, g_free);
-	g_slist_free_full (task_memo_ids, g_free);
 
 	return success;
 }
@@ -1309,63 +2159,6 @@ ecb_ews_freebusy_ecomp_changed (ECalComponent *ecomp,
 	return changed;
 }
 
-static gboolean
-ecb_ews_changekey_equal (ICalComponent *icomp,
-			 const gchar *changekey)
-{
-	gchar *stored;
-	gboolean res;
-
-	stored = e_cal_util_component_dup_x_property (icomp, "X-EVOLUTION-CHANGEKEY");
-	res = g_strcmp0 (stored, changekey) == 0;
-	g_free (stored);
-
-	return res;
-}
-
-static GSList * /* the possibly modified 'in_items' */
-ecb_ews_verify_changes (ECalCache *cal_cache,
-			ICalComponentKind kind,
-			GSList *in_items, /* EEwsItem * */
-			GCancellable *cancellable)
-{
-	GSList *items = NULL, *link;
-
-	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), in_items);
-
-	for (link = in_items; link; link = g_slist_next (link)) {
-		EEwsItem *item = link->data;
-		const EwsId *id = e_ews_item_get_id (item);
-		EEwsItemType type = e_ews_item_get_item_type (item);
-
-		if (!g_cancellable_is_cancelled (cancellable) && (
-		    (type == E_EWS_ITEM_TYPE_EVENT && kind == I_CAL_VEVENT_COMPONENT) ||
-		    (type == E_EWS_ITEM_TYPE_MEMO && kind == I_CAL_VJOURNAL_COMPONENT) ||
-		    (type == E_EWS_ITEM_TYPE_TASK && kind == I_CAL_VTODO_COMPONENT) )) {
-			ECalComponent *existing = NULL;
-
-			if (e_cal_cache_get_component (cal_cache, id->id, NULL, &existing, cancellable, NULL) &&
-			    existing && ecb_ews_changekey_equal (e_cal_component_get_icalcomponent (existing), id->change_key)) {
-				g_object_unref (item);
-			} else {
-				items = g_slist_prepend (items, item);
-			}
-
-			g_clear_object (&existing);
-		} else if (type == E_EWS_ITEM_TYPE_EVENT ||
-			   type == E_EWS_ITEM_TYPE_MEMO ||
-			   type == E_EWS_ITEM_TYPE_TASK) {
-			g_object_unref (item);
-		} else {
-			items = g_slist_prepend (items, item);
-		}
-	}
-
-	g_slist_free (in_items);
-
-	return items;
-}
-
 static GSList * /* ECalMetaBackendInfo */
 ecb_ews_components_to_infos (ECalMetaBackend *meta_backend,
 			     const GSList *components, /* ECalComponent * */
@@ -1526,7 +2319,9 @@ ecb_ews_connect_sync (ECalMetaBackend *meta_backend,
 {
 	ECalBackendEws *cbews;
 	CamelEwsSettings *ews_settings;
+	EEwsConnection *cnc;
 	gchar *hosturl;
+	guint subscription_key = 0;
 	gboolean success = FALSE;
 
 	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
@@ -1534,10 +2329,10 @@ ecb_ews_connect_sync (ECalMetaBackend *meta_backend,
 
 	cbews = E_CAL_BACKEND_EWS (meta_backend);
 
-	g_rec_mutex_lock (&cbews->priv->cnc_lock);
+	cnc = ecb_ews_ref_connection (cbews);
 
-	if (cbews->priv->cnc) {
-		g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+	if (cnc) {
+		g_object_unref (cnc);
 
 		*out_auth_result = E_SOURCE_AUTHENTICATION_ACCEPTED;
 
@@ -1547,51 +2342,73 @@ ecb_ews_connect_sync (ECalMetaBackend *meta_backend,
 	ews_settings = ecb_ews_get_collection_settings (cbews);
 	hosturl = camel_ews_settings_dup_hosturl (ews_settings);
 
-	cbews->priv->cnc = e_ews_connection_new_for_backend (E_BACKEND (cbews), e_cal_backend_get_registry (E_CAL_BACKEND (cbews)), hosturl, ews_settings);
+	/* The connection is set up without the lock held and published
+	   only when the credentials are accepted */
+	cnc = e_ews_connection_new_for_backend (E_BACKEND (cbews), e_cal_backend_get_registry (E_CAL_BACKEND (cbews)), hosturl, ews_settings);
 
 	e_binding_bind_property (
 		cbews, "proxy-resolver",
-		cbews->priv->cnc, "proxy-resolver",
+		cnc, "proxy-resolver",
 		G_BINDING_SYNC_CREATE);
 
-	*out_auth_result = e_ews_connection_try_credentials_sync (cbews->priv->cnc, credentials, NULL,
+	*out_auth_result = e_ews_connection_try_credentials_sync (cnc, credentials, NULL,
 		out_certificate_pem, out_certificate_errors, cancellable, error);
 
 	if (*out_auth_result == E_SOURCE_AUTHENTICATION_ACCEPTED) {
 		ESource *source = e_backend_get_source (E_BACKEND (cbews));
 		ESourceEwsFolder *ews_folder;
+		EEwsConnection *old_cnc;
+		gchar *folder_id, *old_folder_id;
+		guint old_subscription_key;
+		gboolean is_freebusy_calendar;
 
 		ews_folder = e_source_get_extension (source, E_SOURCE_EXTENSION_EWS_FOLDER);
 
-		g_free (cbews->priv->folder_id);
-		cbews->priv->folder_id = e_source_ews_folder_dup_id (ews_folder);
-		cbews->priv->is_freebusy_calendar = cbews->priv->folder_id && g_str_has_prefix (cbews->priv->folder_id, "freebusy-calendar::");
+		folder_id = e_source_ews_folder_dup_id (ews_folder);
+		is_freebusy_calendar = folder_id && g_str_has_prefix (folder_id, "freebusy-calendar::");
 
-		g_signal_connect_swapped (cbews->priv->cnc, "server-notification",
+		g_signal_connect_swapped (cnc, "server-notification",
 			G_CALLBACK (ecb_ews_server_notification_cb), cbews);
 
-		if (!cbews->priv->is_freebusy_calendar &&
+		if (!is_freebusy_calendar &&
 		    camel_ews_settings_get_listen_notifications (ews_settings) &&
-		    e_ews_connection_satisfies_server_version (cbews->priv->cnc, E_EWS_EXCHANGE_2010_SP1)) {
+		    e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010_SP1)) {
 			GSList *folders = NULL;
 
-			folders = g_slist_prepend (folders, cbews->priv->folder_id);
+			folders = g_slist_prepend (folders, folder_id);
 
-			e_ews_connection_enable_notifications_sync (cbews->priv->cnc,
-				folders, &cbews->priv->subscription_key);
+			e_ews_connection_enable_notifications_sync (cnc,
+				folders, &subscription_key);
 
 			g_slist_free (folders);
 		}
 
-		e_cal_backend_set_writable (E_CAL_BACKEND (cbews), !cbews->priv->is_freebusy_calendar);
+		g_rec_mutex_lock (&cbews->priv->cnc_lock);
+
+		/* A concurrent connect could have published its connection meanwhile */
+		old_cnc = cbews->priv->cnc;
+		old_subscription_key = cbews->priv->subscription_key;
+		old_folder_id = cbews->priv->folder_id;
+
+		cbews->priv->cnc = g_object_ref (cnc);
+		cbews->priv->subscription_key = subscription_key;
+		cbews->priv->folder_id = folder_id;
+		cbews->priv->is_freebusy_calendar = is_freebusy_calendar;
+
+		g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+
+		if (old_cnc)
+			ecb_ews_release_connection (cbews, old_cnc, old_subscription_key);
+
+		g_free (old_folder_id);
+
+		e_cal_backend_set_writable (E_CAL_BACKEND (cbews), !is_freebusy_calendar);
 		success = TRUE;
 	} else {
 		ecb_ews_convert_error_to_edc_error (error);
-		g_clear_object (&cbews->priv->cnc);
 	}
 
-	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
-
+	g_object_unref (cnc);
 	g_free (hosturl);
 
 	return success;
@@ -1613,1095 +2430,2459 @@ ecb_ews_disconnect_sync (ECalMetaBackend *meta_backend,
 	return TRUE;
 }
 
+/* The time range is stored in the cache, the sync tag only marks the mode */
+#define ECB_EWS_SYNC_WINDOW_TAG "ews-sync-window"
+#define ECB_EWS_SYNC_WINDOW_START_KEY "ews-sync-window-start"
+#define ECB_EWS_SYNC_WINDOW_END_KEY "ews-sync-window-end"
+
+/* The CalendarView is read in these chunks, which are split when
+   the server cannot return all the occurrences in one response */
+#define EWS_SYNC_WINDOW_CHUNK (4 * 7 * 24 * 60 * 60)
+#define EWS_SYNC_WINDOW_MIN_CHUNK (24 * 60 * 60)
+#define EWS_MAX_CALENDAR_VIEW_ENTRIES 1000
+
+/* How far beyond the already synchronized range can be read on demand at once,
+   to not download whole calendar history for queries without a sensible time range */
+#define EWS_SYNC_WINDOW_MAX_EXTEND_WEEKS (5 * 52)
+
+/* Returns whether only events in a time window around today are synchronized;
+   the out arguments are set to the window for the current day */
 static gboolean
-ecb_ews_get_changes_sync (ECalMetaBackend *meta_backend,
-			  const gchar *last_sync_tag,
-			  gboolean is_repeat,
-			  gchar **out_new_sync_tag,
-			  gboolean *out_repeat,
-			  GSList **out_created_objects,
-			  GSList **out_modified_objects,
-			  GSList **out_removed_objects,
-			  GCancellable *cancellable,
-			  GError **error)
+ecb_ews_get_sync_window (ECalBackendEws *cbews,
+			 time_t *out_start,
+			 time_t *out_end)
 {
-	ECalBackendEws *cbews;
-	ECalCache *cal_cache;
-	gboolean success = TRUE;
-	GError *local_error = NULL;
-
-	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
-	g_return_val_if_fail (out_new_sync_tag != NULL, FALSE);
-	g_return_val_if_fail (out_repeat != NULL, FALSE);
-	g_return_val_if_fail (out_created_objects != NULL, FALSE);
-	g_return_val_if_fail (out_modified_objects != NULL, FALSE);
-	g_return_val_if_fail (out_removed_objects != NULL, FALSE);
+	ESourceEwsFolder *ews_folder;
+	time_t today;
 
-	*out_created_objects = NULL;
-	*out_modified_objects = NULL;
-	*out_removed_objects = NULL;
+	if (cbews->priv->is_freebusy_calendar ||
+	    e_cal_backend_get_kind (E_CAL_BACKEND (cbews)) != I_CAL_VEVENT_COMPONENT)
+		return FALSE;
 
-	cbews = E_CAL_BACKEND_EWS (meta_backend);
+	ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (cbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
 
-	cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
-	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
+	if (!e_source_ews_folder_get_sync_window (ews_folder))
+		return FALSE;
 
-	g_rec_mutex_lock (&cbews->priv->cnc_lock);
+	today = time_day_begin (time (NULL));
 
-	if (cbews->priv->is_freebusy_calendar) {
-		ESourceEwsFolder *ews_folder;
-		EEWSFreeBusyData fbdata;
-		GSList *free_busy = NULL, *link;
-		gboolean success;
-		time_t today;
+	if (out_start)
+		*out_start = time_add_week (today, -((gint) e_source_ews_folder_get_sync_weeks_before (ews_folder)));
 
-		ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (cbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
+	if (out_end)
+		*out_end = time_day_end (time_add_week (today, e_source_ews_folder_get_sync_weeks_after (ews_folder)));
 
-		today = time_day_begin (time (NULL));
+	return TRUE;
+}
 
-		fbdata.period_start = time_add_week (today, -e_source_ews_folder_get_freebusy_weeks_before (ews_folder));
-		fbdata.period_end = time_day_end (time_add_week (today, e_source_ews_folder_get_freebusy_weeks_after (ews_folder)));
-		fbdata.user_mails = g_slist_prepend (NULL, e_source_ews_folder_dup_foreign_mail (ews_folder));
+/* Reads the time range already present in the cache; returns FALSE,
+   when the windowed sync did not run yet */
+static gboolean
+ecb_ews_get_sync_window_coverage (ECalCache *cal_cache,
+				  time_t *out_start,
+				  time_t *out_end)
+{
+	gchar *start, *end;
+	gboolean success;
 
-		success = e_ews_connection_get_free_busy_sync (cbews->priv->cnc, G_PRIORITY_DEFAULT,
-			e_ews_cal_utils_prepare_free_busy_request, &fbdata,
-			&free_busy, cancellable, &local_error);
+	start = e_cache_dup_key (E_CACHE (cal_cache), ECB_EWS_SYNC_WINDOW_START_KEY, NULL);
+	end = e_cache_dup_key (E_CACHE (cal_cache), ECB_EWS_SYNC_WINDOW_END_KEY, NULL);
 
-		if (success) {
-			ICalTimezone *utc_zone = i_cal_timezone_get_utc_timezone ();
-			GSList *comps = NULL;
-			GHashTable *known;
-			GHashTableIter iter;
-			gpointer key;
+	success = start && *start && end && *end;
 
-			known = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	if (success) {
+		*out_start = (time_t) g_ascii_strtoll (start, NULL, 10);
+		*out_end = (time_t) g_ascii_strtoll (end, NULL, 10);
+	}
 
-			if (e_cal_cache_search_components (cal_cache, NULL, &comps, cancellable, NULL)) {
-				for (link = comps; link; link = g_slist_next (link)) {
-					ECalComponent *comp = link->data;
-					ICalComponent *icomp;
-					const gchar *uid;
+	g_free (start);
+	g_free (end);
 
-					if (!comp)
-						continue;
+	return success;
+}
 
-					icomp = e_cal_component_get_icalcomponent (comp);
-					if (!icomp)
-						continue;
+static void
+ecb_ews_set_sync_window_coverage (ECalCache *cal_cache,
+				  time_t start,
+				  time_t end)
+{
+	gchar *value;
 
-					uid = i_cal_component_get_uid (icomp);
+	if (!start && !end) {
+		e_cache_set_key (E_CACHE (cal_cache), ECB_EWS_SYNC_WINDOW_START_KEY, NULL, NULL);
+		e_cache_set_key (E_CACHE (cal_cache), ECB_EWS_SYNC_WINDOW_END_KEY, NULL, NULL);
+		return;
+	}
 
-					if (uid && *uid)
-						g_hash_table_insert (known, g_strdup (uid), g_object_ref (comp));
-				}
+	value = g_strdup_printf ("%" G_GINT64_FORMAT, (gint64) start);
+	e_cache_set_key (E_CACHE (cal_cache), ECB_EWS_SYNC_WINDOW_START_KEY, value, NULL);
+	g_free (value);
 
-				g_slist_free_full (comps, g_object_unref);
-			}
+	value = g_strdup_printf ("%" G_GINT64_FORMAT, (gint64) end);
+	e_cache_set_key (E_CACHE (cal_cache), ECB_EWS_SYNC_WINDOW_END_KEY, value, NULL);
+	g_free (value);
+}
 
-			for (link = free_busy; link; link = g_slist_next (link)) {
-				ICalComponent *fbcomp = link->data;
-				ICalProperty *fbprop;
-				ICalParameter *param;
-				ICalPeriod *fb;
-				ICalParameterFbtype fbtype;
+/* Lists the calendar items overlapping the range. The single items are stored
+   into the 'items_by_id', the occurrences and exceptions into 'occurrences_by_uid',
+   one for each series, to have their recurring master found later. The 'inout_complete'
+   is set to FALSE, when the server did not return all the items of some chunk. */
+static gboolean
+ecb_ews_list_calendar_view_sync (ECalBackendEws *cbews,
+				 time_t start,
+				 time_t end,
+				 GHashTable *items_by_id, /* gchar *id ~> EEwsItem * */
+				 GHashTable *occurrences_by_uid, /* gchar *uid ~> gchar *occurrence_id */
+				 gboolean *inout_complete,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	EEwsAdditionalProps *add_props;
+	EEwsConnection *cnc;
+	EwsFolderId *fid;
+	gboolean success;
 
-				if (!fbcomp || i_cal_component_isa (fbcomp) != I_CAL_VFREEBUSY_COMPONENT)
-					continue;
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup ("calendar:UID calendar:CalendarItemType");
 
-				for (fbprop = i_cal_component_get_first_property (fbcomp, I_CAL_FREEBUSY_PROPERTY);
-				     fbprop;
-				     g_object_unref (fbprop), fbprop = i_cal_component_get_next_property (fbcomp, I_CAL_FREEBUSY_PROPERTY)) {
-					ECalComponent *ecomp;
-					ICalComponent *vevent;
-					ICalTime *itt;
-					gchar *id, *summary, *location;
+	fid = ecb_ews_new_folder_id (cbews);
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	success = cnc != NULL;
 
-					param = i_cal_property_get_first_parameter (fbprop, I_CAL_FBTYPE_PARAMETER);
-					if (!param)
-						continue;
+	while (success && start < end) {
+		GSList *items = NULL, *link;
+		gboolean includes_last_item = TRUE;
+		time_t chunk_end;
 
-					fbtype = i_cal_parameter_get_fbtype (param);
-					g_clear_object (&param);
+		chunk_end = MIN (end, start + EWS_SYNC_WINDOW_CHUNK);
 
-					if (fbtype != I_CAL_FBTYPE_FREE &&
-					    fbtype != I_CAL_FBTYPE_BUSY &&
-					    fbtype != I_CAL_FBTYPE_BUSYUNAVAILABLE &&
-					    fbtype != I_CAL_FBTYPE_BUSYTENTATIVE)
-						continue;
+		success = e_ews_connection_find_calendar_view_sync (cnc, EWS_PRIORITY_MEDIUM,
+			fid, "IdOnly", add_props,
+			start, chunk_end, EWS_MAX_CALENDAR_VIEW_ENTRIES, &includes_last_item, &items,
+			cancellable, error);
 
-					fb = i_cal_property_get_freebusy (fbprop);
-					id = i_cal_property_get_parameter_as_string (fbprop, "X-EWS-ID");
-					summary = i_cal_property_get_parameter_as_string (fbprop, "X-SUMMARY");
-					location = i_cal_property_get_parameter_as_string (fbprop, "X-LOCATION");
+		if (!success)
+			break;
 
-					vevent = i_cal_component_new_vevent ();
+		/* Too many occurrences in the chunk, read it in smaller pieces */
+		if (!includes_last_item && chunk_end - start > EWS_SYNC_WINDOW_MIN_CHUNK) {
+			time_t middle = start + (chunk_end - start) / 2;
 
-					if (id && *id) {
-						i_cal_component_set_uid (vevent, id);
-					} else {
-						gchar *uid, *start, *end;
+			g_slist_free_full (items, g_object_unref);
 
-						itt = i_cal_period_get_start (fb);
-						start = i_cal_time_as_ical_string (itt);
-						g_clear_object (&itt);
+			success = ecb_ews_list_calendar_view_sync (cbews, start, middle, items_by_id, occurrences_by_uid, inout_complete, cancellable, error) &&
+				  ecb_ews_list_calendar_view_sync (cbews, middle, chunk_end, items_by_id, occurrences_by_uid, inout_complete, cancellable, error);
 
-						itt = i_cal_period_get_end (fb);
-						end = i_cal_time_as_ical_string (itt);
-						g_clear_object (&itt);
+			start = chunk_end;
+			continue;
+		}
 
-						uid = g_strdup_printf ("%s-%s-%d", start, end, (gint) fbtype);
+		/* Cannot split any further; the listing is usable for additions
+		   and modifications, but not for the removals */
+		if (!includes_last_item)
+			*inout_complete = FALSE;
 
-						i_cal_component_set_uid (vevent, uid);
+		for (link = items; link; link = g_slist_next (link)) {
+			EEwsItem *item = link->data;
+			const EwsId *id = e_ews_item_get_id (item);
+			const gchar *item_type;
 
-						g_free (start);
-						g_free (end);
-						g_free (uid);
-					}
+			if (!id || !id->id || e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR)
+				continue;
 
-					itt = i_cal_period_get_start (fb);
-					i_cal_time_set_timezone (itt, utc_zone);
-					i_cal_component_set_dtstart (vevent, itt);
-					g_clear_object (&itt);
+			item_type = e_ews_item_get_calendar_item_type (item);
 
-					itt = i_cal_period_get_end (fb);
-					i_cal_time_set_timezone (itt, utc_zone);
-					i_cal_component_set_dtend (vevent, itt);
-					g_clear_object (&itt);
+			if (g_strcmp0 (item_type, "Occurrence") == 0 ||
+			    g_strcmp0 (item_type, "Exception") == 0) {
+				const gchar *uid = e_ews_item_get_uid (item);
 
-					itt = i_cal_time_new_current_with_zone (utc_zone);
-					i_cal_component_take_property (vevent, i_cal_property_new_created (itt));
-					g_clear_object (&itt);
+				if (uid && !g_hash_table_contains (occurrences_by_uid, uid))
+					g_hash_table_insert (occurrences_by_uid, g_strdup (uid), g_strdup (id->id));
+			} else if (!g_hash_table_contains (items_by_id, id->id)) {
+				g_hash_table_insert (items_by_id, g_strdup (id->id), g_object_ref (item));
+			}
+		}
 
-					if (fbtype == I_CAL_FBTYPE_FREE) {
-						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Free"));
-						i_cal_component_take_property (vevent, i_cal_property_new_transp (I_CAL_TRANSP_TRANSPARENT));
-					} else if (fbtype == I_CAL_FBTYPE_BUSY) {
-						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Busy"));
-					} else if (fbtype == I_CAL_FBTYPE_BUSYUNAVAILABLE) {
-						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Out of Office"));
-					} else if (fbtype == I_CAL_FBTYPE_BUSYTENTATIVE) {
-						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Tentative"));
-					}
+		g_slist_free_full (items, g_object_unref);
 
-					if (summary && *summary)
-						i_cal_component_set_summary (vevent, summary);
+		start = chunk_end;
+	}
 
-					if (location && *location)
-						i_cal_component_set_location (vevent, location);
+	e_ews_additional_props_free (add_props);
+	e_ews_folder_id_free (fid);
+	g_clear_object (&cnc);
 
-					ecomp = g_hash_table_lookup (known, i_cal_component_get_uid (vevent));
-					if (ecomp) {
-						g_object_ref (ecomp);
+	return success;
+}
 
-						/* This dereferences the ecomp, thus the ref() call above to keep it alive */
-						g_hash_table_remove (known, i_cal_component_get_uid (vevent));
+/* Finds the recurring masters of the series listed in the 'occurrences_by_uid'
+   and adds them into the 'items_by_id' */
+static gboolean
+ecb_ews_add_recurring_masters_sync (ECalBackendEws *cbews,
+				    GHashTable *occurrences_by_uid, /* gchar *uid ~> gchar *occurrence_id */
+				    GHashTable *items_by_id, /* gchar *id ~> EEwsItem * */
+				    GCancellable *cancellable,
+				    GError **error)
+{
+	EEwsConnection *cnc;
+	GHashTableIter iter;
+	GSList *ids = NULL;
+	gpointer value;
+	guint n_ids = 0;
+	gboolean success = TRUE;
 
-						if (ecb_ews_freebusy_ecomp_changed (ecomp, vevent)) {
-							ECalMetaBackendInfo *nfo;
-							gchar *revision = e_util_generate_uid ();
+	if (!g_hash_table_size (occurrences_by_uid))
+		return TRUE;
 
-							e_cal_util_component_set_x_property (vevent, "X-EVOLUTION-CHANGEKEY", revision);
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc)
+		return FALSE;
 
-							nfo = e_cal_meta_backend_info_new (i_cal_component_get_uid (vevent), NULL, NULL, NULL);
-							nfo->revision = revision;
-							nfo->object = i_cal_component_as_ical_string (vevent);
+	g_hash_table_iter_init (&iter, occurrences_by_uid);
 
-							*out_created_objects = g_slist_prepend (*out_created_objects, nfo);
-						}
+	while (success) {
+		gboolean has_next = g_hash_table_iter_next (&iter, NULL, &value);
 
-						g_clear_object (&ecomp);
-					} else {
-						ECalMetaBackendInfo *nfo;
-						gchar *revision = e_util_generate_uid ();
+		if (has_next) {
+			ids = g_slist_prepend (ids, value);
+			n_ids++;
+		}
 
-						e_cal_util_component_set_x_property (vevent, "X-EVOLUTION-CHANGEKEY", revision);
+		if (n_ids > 0 && (!has_next || n_ids == EWS_MAX_FETCH_COUNT)) {
+			GSList *items = NULL, *link;
 
-						nfo = e_cal_meta_backend_info_new (i_cal_component_get_uid (vevent), NULL, NULL, NULL);
-						nfo->revision = revision;
-						nfo->object = i_cal_component_as_ical_string (vevent);
+			success = e_ews_connection_get_recurring_masters_sync (cnc, EWS_PRIORITY_MEDIUM,
+				ids, "IdOnly", NULL, &items, cancellable, error);
 
-						*out_modified_objects = g_slist_prepend (*out_modified_objects, nfo);
-					}
+			for (link = items; link; link = g_slist_next (link)) {
+				EEwsItem *item = link->data;
+				const EwsId *id = e_ews_item_get_id (item);
 
-					g_free (id);
-					g_free (summary);
-					g_free (location);
-					g_object_unref (vevent);
-				}
+				if (id && id->id && e_ews_item_get_item_type (item) != E_EWS_ITEM_TYPE_ERROR &&
+				    !g_hash_table_contains (items_by_id, id->id))
+					g_hash_table_insert (items_by_id, g_strdup (id->id), g_object_ref (item));
 			}
 
-			g_hash_table_iter_init (&iter, known);
-			while (g_hash_table_iter_next (&iter, &key, NULL)) {
-				const gchar *uid = key;
+			g_slist_free_full (items, g_object_unref);
+			g_slist_free (ids);
+			ids = NULL;
+			n_ids = 0;
+		}
 
-				*out_removed_objects = g_slist_prepend (*out_removed_objects,
-					e_cal_meta_backend_info_new (uid, NULL, NULL, NULL));
-			}
+		if (!has_next)
+			break;
+	}
 
-			g_hash_table_destroy (known);
-		} else if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_NOFREEBUSYACCESS)) {
-			e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
+	g_slist_free (ids);
+	g_object_unref (cnc);
 
-			e_cal_backend_notify_error (E_CAL_BACKEND (cbews), local_error->message);
-			g_clear_error (&local_error);
-		} else {
-			g_propagate_error (error, local_error);
-		}
+	return success;
+}
 
-		g_slist_free_full (free_busy, g_object_unref);
-		g_slist_free_full (fbdata.user_mails, g_free);
-	} else {
-		GSList *items_created = NULL, *items_modified = NULL, *items_deleted = NULL, *link;
-		EEwsAdditionalProps *add_props;
-		gboolean includes_last_item = TRUE;
+/* The recurring series can overlap the range without any occurrence in it,
+   thus not being listed by the CalendarView, thus ask the server whether
+   their items still exist. The 'candidates' are ItemId ~> component UID. */
+static gboolean
+ecb_ews_confirm_removed_sync (ECalBackendEws *cbews,
+			      GHashTable *candidates, /* gchar *id ~> const gchar *uid */
+			      GSList **out_removed_objects,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	EEwsConnection *cnc;
+	GHashTableIter iter;
+	GSList *ids = NULL;
+	gpointer key;
+	guint n_ids = 0;
+	gboolean success = TRUE;
 
-		add_props = e_ews_additional_props_new ();
-		add_props->field_uri = g_strdup ("item:ItemClass");
+	if (!g_hash_table_size (candidates))
+		return TRUE;
 
-		success = e_ews_connection_sync_folder_items_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-			last_sync_tag, cbews->priv->folder_id, "IdOnly", add_props, EWS_MAX_FETCH_COUNT,
-			out_new_sync_tag, &includes_last_item, &items_created, &items_modified, &items_deleted,
-			cancellable, &local_error);
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc)
+		return FALSE;
 
-		if (!success &&
-		    g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_INVALIDSYNCSTATEDATA)) {
-			g_clear_error (&local_error);
+	g_hash_table_iter_init (&iter, candidates);
 
-			e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
+	while (success) {
+		gboolean has_next = g_hash_table_iter_next (&iter, &key, NULL);
 
-			success = e_ews_connection_sync_folder_items_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-				NULL, cbews->priv->folder_id, "IdOnly", add_props, EWS_MAX_FETCH_COUNT,
-				out_new_sync_tag, &includes_last_item, &items_created, &items_modified, &items_deleted,
-				cancellable, &local_error);
+		if (has_next) {
+			ids = g_slist_prepend (ids, key);
+			n_ids++;
 		}
 
-		e_ews_additional_props_free (add_props);
+		if (n_ids > 0 && (!has_next || n_ids == EWS_MAX_FETCH_COUNT)) {
+			GSList *items = NULL, *ilink, *link;
 
-		if (success) {
-			GSList *components_created = NULL, *components_modified = NULL;
-			ICalComponentKind kind;
+			ids = g_slist_reverse (ids);
 
-			kind = e_cal_backend_get_kind (E_CAL_BACKEND (cbews));
+			success = e_ews_connection_get_items_sync (cnc, EWS_PRIORITY_MEDIUM, ids, "IdOnly",
+				NULL, FALSE, NULL, E_EWS_BODY_TYPE_TEXT, &items, NULL, NULL, cancellable, error);
 
-			/* The sync state doesn't cover changes made by save_component_sync(),
-			   thus verify the changes, instead of re-donwloading the component again */
-			items_created = ecb_ews_verify_changes (cal_cache, kind, items_created, cancellable);
-			items_modified = ecb_ews_verify_changes (cal_cache, kind, items_modified, cancellable);
+			/* Only the items the server certainly does not know are removed */
+			if (success && g_slist_length (items) == n_ids) {
+				for (link = ids, ilink = items; link && ilink; link = g_slist_next (link), ilink = g_slist_next (ilink)) {
+					EEwsItem *item = ilink->data;
 
-			if (items_created) {
-				success = ecb_ews_fetch_items_sync (cbews, items_created, &components_created, cancellable, error);
-				if (success)
-					*out_created_objects = ecb_ews_components_to_infos (meta_backend, components_created, kind);
-			}
-
-			if (items_modified) {
-				success = ecb_ews_fetch_items_sync (cbews, items_modified, &components_modified, cancellable, error);
-				if (success)
-					*out_modified_objects = ecb_ews_components_to_infos (meta_backend, components_modified, kind);
-			}
-
-			for (link = items_deleted; link; link = g_slist_next (link)) {
-				const gchar *item_id = link->data;
-				GSList *ids = NULL, *ilink;
-
-				if (!e_cal_cache_get_ids_with_extra (cal_cache, item_id, &ids, cancellable, NULL))
-					continue;
-
-				for (ilink = ids; ilink; ilink = g_slist_next (ilink)) {
-					ECalComponentId *id = ilink->data;
-
-					/* Use the master object */
-					if (id && e_cal_component_id_get_uid (id) && e_cal_component_id_get_uid (id)[0] && !e_cal_component_id_get_rid (id)) {
+					if (item && e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR &&
+					    g_error_matches (e_ews_item_get_error (item), EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_ITEMNOTFOUND)) {
 						*out_removed_objects = g_slist_prepend (*out_removed_objects,
-							e_cal_meta_backend_info_new (e_cal_component_id_get_uid (id), NULL, NULL, NULL));
-						break;
+							e_cal_meta_backend_info_new (g_hash_table_lookup (candidates, link->data), NULL, NULL, NULL));
 					}
 				}
-
-				g_slist_free_full (ids, e_cal_component_id_free);
 			}
 
-			g_slist_free_full (components_created, g_object_unref);
-			g_slist_free_full (components_modified, g_object_unref);
-
-			*out_repeat = !includes_last_item;
-		} else if (local_error) {
-			g_propagate_error (error, local_error);
+			g_slist_free_full (items, g_object_unref);
+			g_slist_free (ids);
+			ids = NULL;
+			n_ids = 0;
 		}
 
-		g_slist_free_full (items_created, g_object_unref);
-		g_slist_free_full (items_modified, g_object_unref);
-		g_slist_free_full (items_deleted, g_free);
+		if (!has_next)
+			break;
 	}
 
-	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
-
-	ecb_ews_convert_error_to_edc_error (error);
-	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
-	g_clear_object (&cal_cache);
+	g_slist_free (ids);
+	g_object_unref (cnc);
 
 	return success;
 }
 
+/* Reads all the events overlapping the range and compares them with the cache;
+   the events in the cache overlapping the range, which had not been found
+   on the server, are returned as removed. The removals are skipped, when
+   the server did not return the complete listing. */
 static gboolean
-ecb_ews_load_component_sync (ECalMetaBackend *meta_backend,
-			     const gchar *uid,
-			     const gchar *extra,
-			     ICalComponent **out_component,
-			     gchar **out_extra,
-			     GCancellable *cancellable,
-			     GError **error)
+ecb_ews_sync_window_range_sync (ECalBackendEws *cbews,
+				ECalCache *cal_cache,
+				time_t start,
+				time_t end,
+				GSList **out_created_objects,
+				GSList **out_modified_objects,
+				GSList **out_removed_objects,
+				GCancellable *cancellable,
+				GError **error)
 {
-	ECalBackendEws *cbews;
-	GSList *ids, *items = NULL, *components = NULL;
+	ECalMetaBackend *meta_backend = E_CAL_META_BACKEND (cbews);
+	GHashTable *items_by_id, *occurrences_by_uid;
+	GSList *items = NULL, *components = NULL, *link;
+	GHashTableIter iter;
+	gpointer value;
+	gboolean complete = TRUE;
 	gboolean success;
 
-	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
-	g_return_val_if_fail (uid != NULL, FALSE);
-	g_return_val_if_fail (out_component != NULL, FALSE);
-	g_return_val_if_fail (out_extra != NULL, FALSE);
+	items_by_id = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+	occurrences_by_uid = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
-	cbews = E_CAL_BACKEND_EWS (meta_backend);
+	success = ecb_ews_list_calendar_view_sync (cbews, start, end, items_by_id, occurrences_by_uid, &complete, cancellable, error) &&
+		  ecb_ews_add_recurring_masters_sync (cbews, occurrences_by_uid, items_by_id, cancellable, error);
 
-	g_rec_mutex_lock (&cbews->priv->cnc_lock);
+	if (success && complete && e_cal_cache_get_components_in_range (cal_cache, start, end, &components, cancellable, NULL)) {
+		GHashTable *removed_uids, *recurring;
 
-	ids = g_slist_prepend (NULL, (gpointer) (extra && *extra ? extra : uid));
+		removed_uids = g_hash_table_new (g_str_hash, g_str_equal);
+		recurring = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-	success = e_ews_connection_get_items_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM, ids, "IdOnly",
-		NULL, FALSE, NULL, E_EWS_BODY_TYPE_TEXT, &items, NULL, NULL, cancellable, error);
+		for (link = components; link; link = g_slist_next (link)) {
+			ECalComponent *comp = link->data;
+			const gchar *uid;
+			gchar *extra = NULL;
 
-	g_slist_free (ids);
+			uid = comp ? e_cal_component_get_uid (comp) : NULL;
 
-	if (success && items) {
-		success = ecb_ews_fetch_items_sync (cbews, items, &components, cancellable, error);
+			if (!uid || g_hash_table_contains (removed_uids, uid))
+				continue;
 
-		if (components) {
-			const EwsId *ews_id = e_ews_item_get_id (items->data);
+			/* Components without an ItemId are not saved on the server yet */
+			if (e_cal_cache_get_component_extra (cal_cache, uid, NULL, &extra, cancellable, NULL) &&
+			    extra && *extra && !g_hash_table_contains (items_by_id, extra)) {
+				g_hash_table_add (removed_uids, (gpointer) uid);
 
-			if (ews_id)
-				*out_extra = g_strdup (ews_id->id);
+				if (e_cal_component_has_recurrences (comp) || e_cal_component_is_instance (comp)) {
+					g_hash_table_insert (recurring, extra, (gpointer) uid);
+					extra = NULL;
+				} else {
+					*out_removed_objects = g_slist_prepend (*out_removed_objects,
+						e_cal_meta_backend_info_new (uid, NULL, NULL, NULL));
+				}
+			}
 
-			if (components->next) {
-				GSList *link;
+			g_free (extra);
+		}
 
-				*out_component = i_cal_component_new_vcalendar ();
+		success = ecb_ews_confirm_removed_sync (cbews, recurring, out_removed_objects, cancellable, error);
 
-				for (link = components; link; link = g_slist_next (link)) {
-					ECalComponent *comp = link->data;
+		g_hash_table_destroy (recurring);
+		g_hash_table_destroy (removed_uids);
+		g_slist_free_full (components, g_object_unref);
+		components = NULL;
+	}
 
-					if (!comp)
-						continue;
+	if (success) {
+		g_hash_table_iter_init (&iter, items_by_id);
 
-					i_cal_component_take_component (*out_component,
-						i_cal_component_clone (e_cal_component_get_icalcomponent (comp)));
-				}
-			} else {
-				*out_component = i_cal_component_clone (e_cal_component_get_icalcomponent (components->data));
-			}
-		} else {
-			success = FALSE;
+		while (g_hash_table_iter_next (&iter, NULL, &value)) {
+			items = g_slist_prepend (items, g_object_ref (value));
 		}
+
+		items = e_cal_backend_ews_verify_changes (cal_cache, I_CAL_VEVENT_COMPONENT, items, cancellable);
 	}
 
-	if (!components && e_cal_meta_backend_refresh_sync (meta_backend, cancellable, NULL)) {
-		ECalCache *cal_cache;
+	if (success && items)
+		success = ecb_ews_fetch_items_sync (cbews, items, &components, cancellable, error);
 
-		cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
-		if (cal_cache) {
-			success = e_cal_cache_get_components_by_uid (cal_cache, uid, &components, cancellable, NULL);
-			if (success) {
-				*out_component = e_cal_meta_backend_merge_instances (meta_backend, components, FALSE);
+	if (success && components) {
+		GSList *nfos;
 
-				if (!e_cal_cache_get_component_extra (cal_cache, uid, NULL, out_extra, cancellable, NULL))
-					*out_extra = NULL;
+		nfos = ecb_ews_components_to_infos (meta_backend, components, I_CAL_VEVENT_COMPONENT);
 
-				g_clear_error (error);
-			}
-			g_object_unref (cal_cache);
+		for (link = nfos; link; link = g_slist_next (link)) {
+			ECalMetaBackendInfo *nfo = link->data;
+
+			if (e_cache_contains (E_CACHE (cal_cache), nfo->uid, E_CACHE_EXCLUDE_DELETED))
+				*out_modified_objects = g_slist_prepend (*out_modified_objects, nfo);
+			else
+				*out_created_objects = g_slist_prepend (*out_created_objects, nfo);
 		}
-	}
 
-	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+		g_slist_free (nfos);
+	}
 
-	ecb_ews_convert_error_to_edc_error (error);
-	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
 	g_slist_free_full (components, g_object_unref);
 	g_slist_free_full (items, g_object_unref);
+	g_hash_table_destroy (occurrences_by_uid);
+	g_hash_table_destroy (items_by_id);
 
 	return success;
 }
 
-/* Very simple and naive component comparator, to avoid
-   unnecessary uploads and changes on the server. */
-static gboolean
-ecb_ews_components_equal (ECalComponent *comp1,
-			  ECalComponent *comp2)
+/* Returns as removed the server events in the cache, which do not overlap the window */
+static void
+ecb_ews_sync_window_prune (ECalCache *cal_cache,
+			   time_t window_start,
+			   time_t window_end,
+			   GSList **out_removed_objects,
+			   GCancellable *cancellable)
 {
-	ICalComponent *icomp1, *icomp2;
-	ICalProperty *prop1;
-	GHashTable *processed_props;
-	gboolean equal = TRUE;
-
-	if (!comp1 && !comp2)
-		return TRUE;
-	else if (!comp1 || !comp2)
-		return FALSE;
+	GHashTable *keep_uids;
+	GSList *components = NULL, *link;
 
-	icomp1 = e_cal_component_get_icalcomponent (comp1);
-	icomp2 = e_cal_component_get_icalcomponent (comp2);
-
-	if (!icomp1 || !icomp2)
-		return FALSE;
-
-	if (g_strcmp0 (i_cal_component_get_uid (icomp1), i_cal_component_get_uid (icomp2)) != 0)
-		return FALSE;
+	keep_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
-	if (i_cal_component_count_properties (icomp1, I_CAL_ANY_PROPERTY) !=
-	    i_cal_component_count_properties (icomp2, I_CAL_ANY_PROPERTY))
-		return FALSE;
-
-	processed_props = g_hash_table_new (g_direct_hash, g_direct_equal);
+	/* Also any already returned as removed */
+	for (link = *out_removed_objects; link; link = g_slist_next (link)) {
+		ECalMetaBackendInfo *nfo = link->data;
 
-	for (prop1 = i_cal_component_get_first_property (icomp1, I_CAL_ANY_PROPERTY);
-	     prop1 && equal;
-	     g_object_unref (prop1), prop1 = i_cal_component_get_next_property (icomp1, I_CAL_ANY_PROPERTY)) {
-		ICalPropertyKind kind = i_cal_property_isa (prop1);
-		ICalProperty *prop2;
+		g_hash_table_add (keep_uids, g_strdup (nfo->uid));
+	}
 
-		for (prop2 = i_cal_component_get_first_property (icomp2, kind);
-		     prop2;
-		     g_object_unref (prop2), prop2 = i_cal_component_get_next_property (icomp2, kind)) {
-			gchar *str1, *str2;
-			gboolean same;
+	if (e_cal_cache_get_components_in_range (cal_cache, window_start, window_end, &components, cancellable, NULL)) {
+		for (link = components; link; link = g_slist_next (link)) {
+			const gchar *uid = e_cal_component_get_uid (link->data);
 
-			if (g_hash_table_contains (processed_props, i_cal_object_get_native (I_CAL_OBJECT (prop2))))
-				continue;
+			if (uid)
+				g_hash_table_add (keep_uids, g_strdup (uid));
+		}
 
-			if (i_cal_property_count_parameters (prop1) != i_cal_property_count_parameters (prop2))
-				continue;
+		g_slist_free_full (components, g_object_unref);
+		components = NULL;
 
-			str1 = i_cal_property_as_ical_string (prop1);
-			str2 = i_cal_property_as_ical_string (prop2);
+		if (e_cal_cache_search_components (cal_cache, NULL, &components, cancellable, NULL)) {
+			for (link = components; link; link = g_slist_next (link)) {
+				const gchar *uid = e_cal_component_get_uid (link->data);
+				gchar *extra = NULL;
 
-			same = g_strcmp0 (str1, str2) == 0;
+				if (!uid || g_hash_table_contains (keep_uids, uid))
+					continue;
 
-			g_free (str1);
-			g_free (str2);
+				/* Components without an ItemId are not saved on the server yet */
+				if (e_cal_cache_get_component_extra (cal_cache, uid, NULL, &extra, cancellable, NULL) &&
+				    extra && *extra) {
+					*out_removed_objects = g_slist_prepend (*out_removed_objects,
+						e_cal_meta_backend_info_new (uid, NULL, NULL, NULL));
+				}
 
-			if (same) {
-				g_hash_table_insert (processed_props, i_cal_object_get_native (I_CAL_OBJECT (prop2)), NULL);
-				break;
+				g_hash_table_add (keep_uids, g_strdup (uid));
+				g_free (extra);
 			}
-		}
 
-		if (!prop2)
-			equal = FALSE;
-
-		g_clear_object (&prop2);
+			g_slist_free_full (components, g_object_unref);
+		}
 	}
 
-	g_clear_object (&prop1);
-
-	g_hash_table_destroy (processed_props);
-
-	return equal;
+	g_hash_table_destroy (keep_uids);
 }
 
-typedef struct _ChangeData {
-	ECalComponent *old_component;
-	ECalComponent *new_component;
-} ChangeData;
-
-static void
-change_data_free (gpointer ptr)
+/* Fetches events in the part of the range not covered by the windowed sync yet,
+   thus older (or later) events are downloaded only when asked for */
+static gboolean
+ecb_ews_sync_window_ensure_range_sync (ECalBackendEws *cbews,
+				       time_t start,
+				       time_t end,
+				       GCancellable *cancellable,
+				       GError **error)
 {
-	ChangeData *cd = ptr;
+	ECalMetaBackend *meta_backend = E_CAL_META_BACKEND (cbews);
+	ECalCache *cal_cache;
+	GSList *created_objects = NULL, *modified_objects = NULL, *removed_objects = NULL;
+	time_t covered_start = 0, covered_end = 0;
+	gboolean success = TRUE;
 
-	if (cd) {
-		g_clear_object (&cd->old_component);
-		g_clear_object (&cd->new_component);
-		g_free (cd);
-	}
-}
+	if (start <= 0 || end <= 0 || start >= end ||
+	    !ecb_ews_get_sync_window (cbews, NULL, NULL) ||
+	    !e_backend_get_online (E_BACKEND (cbews)))
+		return TRUE;
 
-static void
-ecb_ews_filter_out_unchanged_instances (const GSList *to_save_instances,
-					const GSList *existing_instances,
-					GSList **out_changed_instances, /* ChangeData * */
-					GSList **out_removed_instances) /* ECalComponent * */
-{
-	GSList *link = NULL;
-	GHashTable *existing_hash;
-	GHashTableIter iter;
-	gpointer value;
+	cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
+	if (!cal_cache)
+		return TRUE;
 
-	g_return_if_fail (to_save_instances != NULL);
-	g_return_if_fail (existing_instances != NULL);
-	g_return_if_fail (out_changed_instances != NULL);
-	g_return_if_fail (out_removed_instances != NULL);
+	if (!ecb_ews_get_sync_window_coverage (cal_cache, &covered_start, &covered_end) ||
+	    (start >= covered_start && end <= covered_end)) {
+		g_object_unref (cal_cache);
+		return TRUE;
+	}
 
-	*out_changed_instances = NULL;
-	*out_removed_instances = NULL;
+	start = MAX (start, time_add_week (covered_start, -EWS_SYNC_WINDOW_MAX_EXTEND_WEEKS));
+	end = MIN (end, time_add_week (covered_end, EWS_SYNC_WINDOW_MAX_EXTEND_WEEKS));
 
-	existing_hash = g_hash_table_new_full ((GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
-		e_cal_component_id_free, NULL);
+	if (!e_cal_meta_backend_ensure_connected_sync (meta_backend, cancellable, error)) {
+		g_object_unref (cal_cache);
+		return FALSE;
+	}
 
-	for (link = (GSList *) existing_instances; link; link = g_slist_next (link)) {
-		ECalComponent *comp = link->data;
-		ECalComponentId *id;
+	if (start < covered_start) {
+		success = ecb_ews_sync_window_range_sync (cbews, cal_cache, start, covered_start,
+			&created_objects, &modified_objects, &removed_objects, cancellable, error);
+	}
 
-		id = e_cal_component_get_id (comp);
-		if (id)
-			g_hash_table_insert (existing_hash, id, comp);
+	if (success && end > covered_end) {
+		success = ecb_ews_sync_window_range_sync (cbews, cal_cache, covered_end, end,
+			&created_objects, &modified_objects, &removed_objects, cancellable, error);
 	}
 
-	for (link = (GSList *) to_save_instances; link; link = g_slist_next (link)) {
-		ECalComponent *comp = link->data;
-		ECalComponentId *id;
+	if (success) {
+		success = e_cal_meta_backend_process_changes_sync (meta_backend, created_objects,
+			modified_objects, removed_objects, cancellable, error);
+	}
 
-		id = e_cal_component_get_id (comp);
-		if (id) {
-			ECalComponent *old_comp;
+	if (success)
+		ecb_ews_set_sync_window_coverage (cal_cache, MIN (start, covered_start), MAX (end, covered_end));
 
-			old_comp = g_hash_table_lookup (existing_hash, id);
+	g_slist_free_full (created_objects, e_cal_meta_backend_info_free);
+	g_slist_free_full (modified_objects, e_cal_meta_backend_info_free);
+	g_slist_free_full (removed_objects, e_cal_meta_backend_info_free);
+	g_object_unref (cal_cache);
 
-			if (!ecb_ews_components_equal (comp, old_comp)) {
-				ChangeData *cd;
+	ecb_ews_convert_error_to_edc_error (error);
+	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
 
-				cd = g_new0 (ChangeData, 1);
-				cd->old_component = old_comp ? g_object_ref (old_comp) : NULL;
-				cd->new_component = g_object_ref (comp);
+	return success;
+}
 
-				*out_changed_instances = g_slist_prepend (*out_changed_instances, cd);
-			}
+static gboolean
+ecb_ews_sync_window_ensure_sexp_sync (ECalBackendEws *cbews,
+				      ECalBackendSExp *sexp,
+				      GCancellable *cancellable,
+				      GError **error)
+{
+	time_t start = 0, end = 0;
 
-			g_hash_table_remove (existing_hash, id);
-			e_cal_component_id_free (id);
+	if (!sexp || !e_cal_backend_sexp_evaluate_occur_times (sexp, &start, &end))
+		return TRUE;
+
+	return ecb_ews_sync_window_ensure_range_sync (cbews, start, end, cancellable, error);
+}
+
+static gboolean
+ecb_ews_get_changes_sync (ECalMetaBackend *meta_backend,
+			  const gchar *last_sync_tag,
+			  gboolean is_repeat,
+			  gchar **out_new_sync_tag,
+			  gboolean *out_repeat,
+			  GSList **out_created_objects,
+			  GSList **out_modified_objects,
+			  GSList **out_removed_objects,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	ECalBackendEws *cbews;
+	ECalCache *cal_cache;
+	EEwsConnection *cnc;
+	time_t window_start = 0, window_end = 0;
+	gboolean success = TRUE;
+	GError *local_error = NULL;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
+	g_return_val_if_fail (out_new_sync_tag != NULL, FALSE);
+	g_return_val_if_fail (out_repeat != NULL, FALSE);
+	g_return_val_if_fail (out_created_objects != NULL, FALSE);
+	g_return_val_if_fail (out_modified_objects != NULL, FALSE);
+	g_return_val_if_fail (out_removed_objects != NULL, FALSE);
+
+	*out_created_objects = NULL;
+	*out_modified_objects = NULL;
+	*out_removed_objects = NULL;
+
+	cbews = E_CAL_BACKEND_EWS (meta_backend);
+
+	cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
+	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
+
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc) {
+		g_object_unref (cal_cache);
+		return FALSE;
+	}
+
+	/* Forget the indexed occurrences of the series removed by the previous sync */
+	if (!is_repeat)
+		e_cal_backend_ews_occurrences_prune (cal_cache, cancellable);
+
+	if (cbews->priv->is_freebusy_calendar) {
+		ESourceEwsFolder *ews_folder;
+		EEWSFreeBusyData fbdata;
+		GSList *free_busy = NULL, *link;
+		gboolean success;
+		time_t today;
+
+		ews_folder = e_source_get_extension (e_backend_get_source (E_BACKEND (cbews)), E_SOURCE_EXTENSION_EWS_FOLDER);
+
+		today = time_day_begin (time (NULL));
+
+		fbdata.period_start = time_add_week (today, -e_source_ews_folder_get_freebusy_weeks_before (ews_folder));
+		fbdata.period_end = time_day_end (time_add_week (today, e_source_ews_folder_get_freebusy_weeks_after (ews_folder)));
+		fbdata.user_mails = g_slist_prepend (NULL, e_source_ews_folder_dup_foreign_mail (ews_folder));
+
+		success = e_ews_connection_get_free_busy_sync (cnc, G_PRIORITY_DEFAULT,
+			e_ews_cal_utils_prepare_free_busy_request, &fbdata,
+			&free_busy, cancellable, &local_error);
+
+		if (success) {
+			ICalTimezone *utc_zone = i_cal_timezone_get_utc_timezone ();
+			GSList *comps = NULL;
+			GHashTable *known;
+			GHashTableIter iter;
+			gpointer key;
+
+			known = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
+
+			if (e_cal_cache_search_components (cal_cache, NULL, &comps, cancellable, NULL)) {
+				for (link = comps; link; link = g_slist_next (link)) {
+					ECalComponent *comp = link->data;
+					ICalComponent *icomp;
+					const gchar *uid;
+
+					if (!comp)
+						continue;
+
+					icomp = e_cal_component_get_icalcomponent (comp);
+					if (!icomp)
+						continue;
+
+					uid = i_cal_component_get_uid (icomp);
+
+					if (uid && *uid)
+						g_hash_table_insert (known, g_strdup (uid), g_object_ref (comp));
+				}
+
+				g_slist_free_full (comps, g_object_unref);
+			}
+
+			for (link = free_busy; link; link = g_slist_next (link)) {
+				ICalComponent *fbcomp = link->data;
+				ICalProperty *fbprop;
+				ICalParameter *param;
+				ICalPeriod *fb;
+				ICalParameterFbtype fbtype;
+
+				if (!fbcomp || i_cal_component_isa (fbcomp) != I_CAL_VFREEBUSY_COMPONENT)
+					continue;
+
+				for (fbprop = i_cal_component_get_first_property (fbcomp, I_CAL_FREEBUSY_PROPERTY);
+				     fbprop;
+				     g_object_unref (fbprop), fbprop = i_cal_component_get_next_property (fbcomp, I_CAL_FREEBUSY_PROPERTY)) {
+					ECalComponent *ecomp;
+					ICalComponent *vevent;
+					ICalTime *itt;
+					gchar *id, *summary, *location;
+
+					param = i_cal_property_get_first_parameter (fbprop, I_CAL_FBTYPE_PARAMETER);
+					if (!param)
+						continue;
+
+					fbtype = i_cal_parameter_get_fbtype (param);
+					g_clear_object (&param);
+
+					if (fbtype != I_CAL_FBTYPE_FREE &&
+					    fbtype != I_CAL_FBTYPE_BUSY &&
+					    fbtype != I_CAL_FBTYPE_BUSYUNAVAILABLE &&
+					    fbtype != I_CAL_FBTYPE_BUSYTENTATIVE)
+						continue;
+
+					fb = i_cal_property_get_freebusy (fbprop);
+					id = i_cal_property_get_parameter_as_string (fbprop, "X-EWS-ID");
+					summary = i_cal_property_get_parameter_as_string (fbprop, "X-SUMMARY");
+					location = i_cal_property_get_parameter_as_string (fbprop, "X-LOCATION");
+
+					vevent = i_cal_component_new_vevent ();
+
+					if (id && *id) {
+						i_cal_component_set_uid (vevent, id);
+					} else {
+						gchar *uid, *start, *end;
+
+						itt = i_cal_period_get_start (fb);
+						start = i_cal_time_as_ical_string (itt);
+						g_clear_object (&itt);
+
+						itt = i_cal_period_get_end (fb);
+						end = i_cal_time_as_ical_string (itt);
+						g_clear_object (&itt);
+
+						uid = g_strdup_printf ("%s-%s-%d", start, end, (gint) fbtype);
+
+						i_cal_component_set_uid (vevent, uid);
+
+						g_free (start);
+						g_free (end);
+						g_free (uid);
+					}
+
+					itt = i_cal_period_get_start (fb);
+					i_cal_time_set_timezone (itt, utc_zone);
+					i_cal_component_set_dtstart (vevent, itt);
+					g_clear_object (&itt);
+
+					itt = i_cal_period_get_end (fb);
+					i_cal_time_set_timezone (itt, utc_zone);
+					i_cal_component_set_dtend (vevent, itt);
+					g_clear_object (&itt);
+
+					itt = i_cal_time_new_current_with_zone (utc_zone);
+					i_cal_component_take_property (vevent, i_cal_property_new_created (itt));
+					g_clear_object (&itt);
+
+					if (fbtype == I_CAL_FBTYPE_FREE) {
+						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Free"));
+						i_cal_component_take_property (vevent, i_cal_property_new_transp (I_CAL_TRANSP_TRANSPARENT));
+					} else if (fbtype == I_CAL_FBTYPE_BUSY) {
+						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Busy"));
+					} else if (fbtype == I_CAL_FBTYPE_BUSYUNAVAILABLE) {
+						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Out of Office"));
+					} else if (fbtype == I_CAL_FBTYPE_BUSYTENTATIVE) {
+						i_cal_component_set_summary (vevent, C_("FreeBusyType", "Tentative"));
+					}
+
+					if (summary && *summary)
+						i_cal_component_set_summary (vevent, summary);
+
+					if (location && *location)
+						i_cal_component_set_location (vevent, location);
+
+					ecomp = g_hash_table_lookup (known, i_cal_component_get_uid (vevent));
+					if (ecomp) {
+						g_object_ref (ecomp);
+
+						/* This dereferences the ecomp, thus the ref() call above to keep it alive */
+						g_hash_table_remove (known, i_cal_component_get_uid (vevent));
+
+						if (ecb_ews_freebusy_ecomp_changed (ecomp, vevent)) {
+							ECalMetaBackendInfo *nfo;
+							gchar *revision = e_util_generate_uid ();
+
+							e_cal_util_component_set_x_property (vevent, "X-EVOLUTION-CHANGEKEY", revision);
+
+							nfo = e_cal_meta_backend_info_new (i_cal_component_get_uid (vevent), NULL, NULL, NULL);
+							nfo->revision = revision;
+							nfo->object = i_cal_component_as_ical_string (vevent);
+
+							*out_created_objects = g_slist_prepend (*out_created_objects, nfo);
+						}
+
+						g_clear_object (&ecomp);
+					} else {
+						ECalMetaBackendInfo *nfo;
+						gchar *revision = e_util_generate_uid ();
+
+						e_cal_util_component_set_x_property (vevent, "X-EVOLUTION-CHANGEKEY", revision);
+
+						nfo = e_cal_meta_backend_info_new (i_cal_component_get_uid (vevent), NULL, NULL, NULL);
+						nfo->revision = revision;
+						nfo->object = i_cal_component_as_ical_string (vevent);
+
+						*out_modified_objects = g_slist_prepend (*out_modified_objects, nfo);
+					}
+
+					g_free (id);
+					g_free (summary);
+					g_free (location);
+					g_object_unref (vevent);
+				}
+			}
+
+			g_hash_table_iter_init (&iter, known);
+			while (g_hash_table_iter_next (&iter, &key, NULL)) {
+				const gchar *uid = key;
+
+				*out_removed_objects = g_slist_prepend (*out_removed_objects,
+					e_cal_meta_backend_info_new (uid, NULL, NULL, NULL));
+			}
+
+			g_hash_table_destroy (known);
+		} else if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_NOFREEBUSYACCESS)) {
+			e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
+
+			e_cal_backend_notify_error (E_CAL_BACKEND (cbews), local_error->message);
+			g_clear_error (&local_error);
+		} else {
+			g_propagate_error (error, local_error);
+		}
+
+		g_slist_free_full (free_busy, g_object_unref);
+		g_slist_free_full (fbdata.user_mails, g_free);
+	} else if (ecb_ews_get_sync_window (cbews, &window_start, &window_end)) {
+		time_t covered_start, covered_end;
+
+		/* The window slides forward with the current day; the ranges before it,
+		   fetched on demand, are kept, but not refreshed on each sync */
+		if (ecb_ews_get_sync_window_coverage (cal_cache, &covered_start, &covered_end) &&
+		    g_strcmp0 (last_sync_tag, ECB_EWS_SYNC_WINDOW_TAG) == 0) {
+			covered_start = MIN (covered_start, window_start);
+			covered_end = MAX (covered_end, window_end);
+		} else {
+			covered_start = window_start;
+			covered_end = window_end;
+		}
+
+		success = ecb_ews_sync_window_range_sync (cbews, cal_cache, window_start, window_end,
+			out_created_objects, out_modified_objects, out_removed_objects, cancellable, error);
+
+		/* Switched from the full sync; the events outside the window would not be refreshed */
+		if (success && last_sync_tag && g_strcmp0 (last_sync_tag, ECB_EWS_SYNC_WINDOW_TAG) != 0)
+			ecb_ews_sync_window_prune (cal_cache, window_start, window_end, out_removed_objects, cancellable);
+
+		if (success) {
+			ecb_ews_set_sync_window_coverage (cal_cache, covered_start, covered_end);
+			*out_new_sync_tag = g_strdup (ECB_EWS_SYNC_WINDOW_TAG);
+			*out_repeat = FALSE;
+		}
+	} else {
+		GSList *items_created = NULL, *items_modified = NULL, *items_deleted = NULL, *link;
+		EEwsAdditionalProps *add_props;
+		gboolean includes_last_item = TRUE;
+		gchar *folder_id;
+
+		/* Switched from the windowed sync; the events outside the window
+		   could be stale, thus start from scratch */
+		if (g_strcmp0 (last_sync_tag, ECB_EWS_SYNC_WINDOW_TAG) == 0) {
+			e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
+			ecb_ews_set_sync_window_coverage (cal_cache, 0, 0);
+			last_sync_tag = NULL;
+		}
+
+		add_props = e_ews_additional_props_new ();
+		add_props->field_uri = g_strdup ("item:ItemClass");
+
+		folder_id = ecb_ews_dup_folder_id (cbews);
+
+		success = e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM,
+			last_sync_tag, folder_id, "IdOnly", add_props, EWS_MAX_FETCH_COUNT,
+			out_new_sync_tag, &includes_last_item, &items_created, &items_modified, &items_deleted,
+			cancellable, &local_error);
+
+		if (!success &&
+		    g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_INVALIDSYNCSTATEDATA)) {
+			g_clear_error (&local_error);
+
+			e_cal_meta_backend_empty_cache_sync (meta_backend, cancellable, NULL);
+
+			success = e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM,
+				NULL, folder_id, "IdOnly", add_props, EWS_MAX_FETCH_COUNT,
+				out_new_sync_tag, &includes_last_item, &items_created, &items_modified, &items_deleted,
+				cancellable, &local_error);
+		}
+
+		e_ews_additional_props_free (add_props);
+		g_free (folder_id);
+
+		if (success) {
+			GSList *components_created = NULL, *components_modified = NULL;
+			ICalComponentKind kind;
+
+			kind = e_cal_backend_get_kind (E_CAL_BACKEND (cbews));
+
+			/* The sync state doesn't cover changes made by save_component_sync(),
+			   thus verify the changes, instead of re-donwloading the component again */
+			items_created = e_cal_backend_ews_verify_changes (cal_cache, kind, items_created, cancellable);
+			items_modified = e_cal_backend_ews_verify_changes (cal_cache, kind, items_modified, cancellable);
+
+			if (items_created) {
+				success = ecb_ews_fetch_items_sync (cbews, items_created, &components_created, cancellable, error);
+				if (success)
+					*out_created_objects = ecb_ews_components_to_infos (meta_backend, components_created, kind);
+			}
+
+			if (items_modified) {
+				success = ecb_ews_fetch_items_sync (cbews, items_modified, &components_modified, cancellable, error);
+				if (success)
+					*out_modified_objects = ecb_ews_components_to_infos (meta_backend, components_modified, kind);
+			}
+
+			for (link = items_deleted; link; link = g_slist_next (link)) {
+				const gchar *item_id = link->data;
+				GSList *ids = NULL, *ilink;
+
+				if (!e_cal_cache_get_ids_with_extra (cal_cache, item_id, &ids, cancellable, NULL))
+					continue;
+
+				for (ilink = ids; ilink; ilink = g_slist_next (ilink)) {
+					ECalComponentId *id = ilink->data;
+
+					/* Use the master object */
+					if (id && e_cal_component_id_get_uid (id) && e_cal_component_id_get_uid (id)[0] && !e_cal_component_id_get_rid (id)) {
+						*out_removed_objects = g_slist_prepend (*out_removed_objects,
+							e_cal_meta_backend_info_new (e_cal_component_id_get_uid (id), NULL, NULL, NULL));
+						break;
+					}
+				}
+
+				g_slist_free_full (ids, e_cal_component_id_free);
+			}
+
+			g_slist_free_full (components_created, g_object_unref);
+			g_slist_free_full (components_modified, g_object_unref);
+
+			*out_repeat = !includes_last_item;
+		} else if (local_error) {
+			g_propagate_error (error, local_error);
+		}
+
+		g_slist_free_full (items_created, g_object_unref);
+		g_slist_free_full (items_modified, g_object_unref);
+		g_slist_free_full (items_deleted, g_free);
+	}
+
+	g_object_unref (cnc);
+
+	ecb_ews_convert_error_to_edc_error (error);
+	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
+	g_clear_object (&cal_cache);
+
+	return success;
+}
+
+static gboolean
+ecb_ews_load_component_sync (ECalMetaBackend *meta_backend,
+			     const gchar *uid,
+			     const gchar *extra,
+			     ICalComponent **out_component,
+			     gchar **out_extra,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	ECalBackendEws *cbews;
+	EEwsConnection *cnc;
+	GSList *ids, *items = NULL, *components = NULL;
+	gboolean success;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+	g_return_val_if_fail (out_component != NULL, FALSE);
+	g_return_val_if_fail (out_extra != NULL, FALSE);
+
+	cbews = E_CAL_BACKEND_EWS (meta_backend);
+
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc)
+		return FALSE;
+
+	ids = g_slist_prepend (NULL, (gpointer) (extra && *extra ? extra : uid));
+
+	success = e_ews_connection_get_items_sync (cnc, EWS_PRIORITY_MEDIUM, ids, "IdOnly",
+		NULL, FALSE, NULL, E_EWS_BODY_TYPE_TEXT, &items, NULL, NULL, cancellable, error);
+
+	g_slist_free (ids);
+	g_clear_object (&cnc);
+
+	if (success && items) {
+		success = ecb_ews_fetch_items_sync (cbews, items, &components, cancellable, error);
+
+		if (components) {
+			const EwsId *ews_id = e_ews_item_get_id (items->data);
+
+			if (ews_id)
+				*out_extra = g_strdup (ews_id->id);
+
+			if (components->next) {
+				GSList *link;
+
+				*out_component = i_cal_component_new_vcalendar ();
+
+				for (link = components; link; link = g_slist_next (link)) {
+					ECalComponent *comp = link->data;
+
+					if (!comp)
+						continue;
+
+					i_cal_component_take_component (*out_component,
+						i_cal_component_clone (e_cal_component_get_icalcomponent (comp)));
+				}
+			} else {
+				*out_component = i_cal_component_clone (e_cal_component_get_icalcomponent (components->data));
+			}
+		} else {
+			success = FALSE;
+		}
+	}
+
+	if (!components && e_cal_meta_backend_refresh_sync (meta_backend, cancellable, NULL)) {
+		ECalCache *cal_cache;
+
+		cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
+		if (cal_cache) {
+			success = e_cal_cache_get_components_by_uid (cal_cache, uid, &components, cancellable, NULL);
+			if (success) {
+				*out_component = e_cal_meta_backend_merge_instances (meta_backend, components, FALSE);
+
+				if (!e_cal_cache_get_component_extra (cal_cache, uid, NULL, out_extra, cancellable, NULL))
+					*out_extra = NULL;
+
+				g_clear_error (error);
+			}
+			g_object_unref (cal_cache);
+		}
+	}
+
+	ecb_ews_convert_error_to_edc_error (error);
+	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
+	g_slist_free_full (components, g_object_unref);
+	g_slist_free_full (items, g_object_unref);
+
+	return success;
+}
+
+/* Very simple and naive component comparator, to avoid
+   unnecessary uploads and changes on the server. */
+static gboolean
+ecb_ews_components_equal (ECalComponent *comp1,
+			  ECalComponent *comp2)
+{
+	ICalComponent *icomp1, *icomp2;
+	ICalProperty *prop1;
+	GHashTable *processed_props;
+	gboolean equal = TRUE;
+
+	if (!comp1 && !comp2)
+		return TRUE;
+	else if (!comp1 || !comp2)
+		return FALSE;
+
+	icomp1 = e_cal_component_get_icalcomponent (comp1);
+	icomp2 = e_cal_component_get_icalcomponent (comp2);
+
+	if (!icomp1 || !icomp2)
+		return FALSE;
+
+	if (g_strcmp0 (i_cal_component_get_uid (icomp1), i_cal_component_get_uid (icomp2)) != 0)
+		return FALSE;
+
+	if (i_cal_component_count_properties (icomp1, I_CAL_ANY_PROPERTY) !=
+	    i_cal_component_count_properties (icomp2, I_CAL_ANY_PROPERTY))
+		return FALSE;
+
+	processed_props = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	for (prop1 = i_cal_component_get_first_property (icomp1, I_CAL_ANY_PROPERTY);
+	     prop1 && equal;
+	     g_object_unref (prop1), prop1 = i_cal_component_get_next_property (icomp1, I_CAL_ANY_PROPERTY)) {
+		ICalPropertyKind kind = i_cal_property_isa (prop1);
+		ICalProperty *prop2;
+
+		for (prop2 = i_cal_component_get_first_property (icomp2, kind);
+		     prop2;
+		     g_object_unref (prop2), prop2 = i_cal_component_get_next_property (icomp2, kind)) {
+			gchar *str1, *str2;
+			gboolean same;
+
+			if (g_hash_table_contains (processed_props, i_cal_object_get_native (I_CAL_OBJECT (prop2))))
+				continue;
+
+			if (i_cal_property_count_parameters (prop1) != i_cal_property_count_parameters (prop2))
+				continue;
+
+			str1 = i_cal_property_as_ical_string (prop1);
+			str2 = i_cal_property_as_ical_string (prop2);
+
+			same = g_strcmp0 (str1, str2) == 0;
+
+			g_free (str1);
+			g_free (str2);
+
+			if (same) {
+				g_hash_table_insert (processed_props, i_cal_object_get_native (I_CAL_OBJECT (prop2)), NULL);
+				break;
+			}
+		}
+
+		if (!prop2)
+			equal = FALSE;
+
+		g_clear_object (&prop2);
+	}
+
+	g_clear_object (&prop1);
+
+	g_hash_table_destroy (processed_props);
+
+	return equal;
+}
+
+typedef struct _ChangeData {
+	ECalComponent *old_component;
+	ECalComponent *new_component;
+} ChangeData;
+
+static void
+change_data_free (gpointer ptr)
+{
+	ChangeData *cd = ptr;
+
+	if (cd) {
+		g_clear_object (&cd->old_component);
+		g_clear_object (&cd->new_component);
+		g_free (cd);
+	}
+}
+
+static void
+ecb_ews_filter_out_unchanged_instances (const GSList *to_save_instances,
+					const GSList *existing_instances,
+					GSList **out_changed_instances, /* ChangeData * */
+					GSList **out_removed_instances) /* ECalComponent * */
+{
+	GSList *link = NULL;
+	GHashTable *existing_hash;
+	GHashTableIter iter;
+	gpointer value;
+
+	g_return_if_fail (to_save_instances != NULL);
+	g_return_if_fail (existing_instances != NULL);
+	g_return_if_fail (out_changed_instances != NULL);
+	g_return_if_fail (out_removed_instances != NULL);
+
+	*out_changed_instances = NULL;
+	*out_removed_instances = NULL;
+
+	existing_hash = g_hash_table_new_full ((GHashFunc) e_cal_component_id_hash, (GEqualFunc) e_cal_component_id_equal,
+		e_cal_component_id_free, NULL);
+
+	for (link = (GSList *) existing_instances; link; link = g_slist_next (link)) {
+		ECalComponent *comp = link->data;
+		ECalComponentId *id;
+
+		id = e_cal_component_get_id (comp);
+		if (id)
+			g_hash_table_insert (existing_hash, id, comp);
+	}
+
+	for (link = (GSList *) to_save_instances; link; link = g_slist_next (link)) {
+		ECalComponent *comp = link->data;
+		ECalComponentId *id;
+
+		id = e_cal_component_get_id (comp);
+		if (id) {
+			ECalComponent *old_comp;
+
+			old_comp = g_hash_table_lookup (existing_hash, id);
+
+			if (!ecb_ews_components_equal (comp, old_comp)) {
+				ChangeData *cd;
+
+				cd = g_new0 (ChangeData, 1);
+				cd->old_component = old_comp ? g_object_ref (old_comp) : NULL;
+				cd->new_component = g_object_ref (comp);
+
+				*out_changed_instances = g_slist_prepend (*out_changed_instances, cd);
+			}
+
+			g_hash_table_remove (existing_hash, id);
+			e_cal_component_id_free (id);
+		}
+	}
+
+	g_hash_table_iter_init (&iter, existing_hash);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		*out_removed_instances = g_slist_prepend (*out_removed_instances, g_object_ref (value));
+	}
+
+	g_hash_table_destroy (existing_hash);
+}
+
+static gboolean
+ecb_ews_extract_attachments (ICalComponent *icomp,
+			     GSList **out_attachments) /* EEwsAttachmentInfo * */
+{
+	ICalProperty *prop;
+	GSList *props = NULL, *link;
+
+	g_return_val_if_fail (icomp != NULL, FALSE);
+	g_return_val_if_fail (out_attachments != NULL, FALSE);
+
+	*out_attachments = NULL;
+
+	for (prop = i_cal_component_get_first_property (icomp, I_CAL_ATTACH_PROPERTY);
+	     prop;
+	     prop = i_cal_component_get_next_property (icomp, I_CAL_ATTACH_PROPERTY)) {
+		props = g_slist_prepend (props, prop);
+	}
+
+	for (link = props; link; link = g_slist_next (link)) {
+		EEwsAttachmentInfo *info;
+		ICalAttach *attach;
+		ICalParameter *param;
+		const gchar *stored_filename;
+		gchar *attachid;
+
+		prop = link->data;
+		param = i_cal_property_get_first_parameter (prop, I_CAL_FILENAME_PARAMETER);
+		stored_filename = param ? i_cal_parameter_get_filename (param) : NULL;
+
+		attach = i_cal_property_get_attach (prop);
+		if (i_cal_attach_get_is_url (attach)) {
+			const gchar *uri;
+
+			uri = i_cal_attach_get_url (attach);
+
+			if (!uri || !*uri) {
+				g_clear_object (&param);
+				continue;
+			}
+
+			info = e_ews_attachment_info_new (E_EWS_ATTACHMENT_INFO_TYPE_URI);
+
+			e_ews_attachment_info_set_uri (info, uri);
+			if (stored_filename && *stored_filename) {
+				e_ews_attachment_info_set_prefer_filename (info, stored_filename);
+			} else {
+				gchar *uri_filename;
+
+				uri_filename = g_filename_from_uri (uri, NULL, NULL);
+				if (uri_filename && *uri_filename) {
+					gchar *basename;
+
+					basename = g_path_get_basename (uri_filename);
+					if (basename && *basename && basename[0] != '.' && basename[0] != G_DIR_SEPARATOR) {
+						const gchar *uid;
+
+						uid = i_cal_component_get_uid (icomp);
+
+						if (uid && g_str_has_prefix (basename, uid) && basename[strlen (uid)] == '-') {
+							e_ews_attachment_info_set_prefer_filename (info, basename + strlen (uid) + 1);
+						}
+					}
+
+					g_free (basename);
+				}
+
+				g_free (uri_filename);
+			}
+		} else {
+			gsize len = -1;
+			guchar *decoded = NULL;
+			const gchar *content;
+
+			content = (const gchar *) i_cal_attach_get_data (attach);
+			decoded = g_base64_decode (content, &len);
+
+			info = e_ews_attachment_info_new (E_EWS_ATTACHMENT_INFO_TYPE_INLINED);
+			e_ews_attachment_info_set_inlined_data (info, decoded, len);
+
+			if (stored_filename && *stored_filename)
+				e_ews_attachment_info_set_prefer_filename (info, stored_filename);
+
+			g_free (decoded);
+		}
+
+		attachid = i_cal_property_get_parameter_as_string (prop, "X-EWS-ATTACHMENTID");
+		e_ews_attachment_info_set_id (info, attachid);
+		g_free (attachid);
+
+		*out_attachments = g_slist_prepend (*out_attachments, info);
+
+		g_clear_object (&param);
+	}
+
+	g_slist_free_full (props, g_object_unref);
+
+	return *out_attachments != NULL;
+}
+
+static ICalTimezone *
+ecb_ews_get_timezone_from_icomponent (ECalBackendEws *cbews,
+				      ICalComponent *icomp)
+{
+	ETimezoneCache *timezone_cache;
+	ICalProperty *prop = NULL;
+	const gchar *tzid = NULL;
+
+	timezone_cache = E_TIMEZONE_CACHE (cbews);
+
+	prop = i_cal_component_get_first_property (icomp, I_CAL_DTSTART_PROPERTY);
+	if (prop != NULL) {
+		ICalParameter *param = NULL;
+
+		param = i_cal_property_get_first_parameter (prop, I_CAL_TZID_PARAMETER);
+		if (param) {
+			tzid = i_cal_parameter_get_tzid (param);
+			g_object_unref (param);
+		} else {
+			ICalTime *dtstart;
+
+			dtstart = i_cal_property_get_dtstart (prop);
+			if (i_cal_time_is_utc (dtstart))
+				tzid = "UTC";
+			g_clear_object (&dtstart);
+		}
+
+		g_object_unref (prop);
+	}
+
+	if (tzid)
+		return e_timezone_cache_get_timezone (timezone_cache, tzid);
+
+	return NULL;
+}
+
+static gboolean
+ecb_ews_remove_item_sync (ECalBackendEws *cbews,
+			  ECalCache *cal_cache,
+			  GHashTable *removed_indexes,
+			  const gchar *uid,
+			  const gchar *rid,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	ECalComponent *comp = NULL, *parent = NULL;
+	EwsId item_id = { 0 };
+	gint index = 0;
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), FALSE);
+	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+
+	if (rid && !*rid)
+		rid = NULL;
+
+	if (!e_cal_cache_get_component (cal_cache, uid, rid, &comp, cancellable, error) ||
+	    (rid && !e_cal_cache_get_component (cal_cache, uid, NULL, &parent, cancellable, error))) {
+		if (!parent && !comp) {
+			g_propagate_error (error, ECC_ERROR (E_CAL_CLIENT_ERROR_OBJECT_NOT_FOUND));
+			return FALSE;
+		}
+	}
+
+	ecb_ews_extract_item_id (comp ? comp : parent, &item_id.id, &item_id.change_key);
+
+	if (!item_id.id) {
+		g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_OTHER_ERROR, _("Cannot determine EWS ItemId")));
+		success = FALSE;
+	} else {
+		if (parent) {
+			index = e_cal_backend_ews_rid_to_index (
+				ecb_ews_get_timezone_from_icomponent (cbews,
+					e_cal_component_get_icalcomponent (parent)),
+				rid,
+				e_cal_component_get_icalcomponent (parent),
+				error);
+			if (index == 0)
+				success = comp != NULL;
+		}
+
+		if (index && removed_indexes && g_hash_table_contains (removed_indexes, GINT_TO_POINTER (index))) {
+			/* Do nothing, it's already deleted from the server */
+		} else {
+			if (removed_indexes && index)
+				g_hash_table_insert (removed_indexes, GINT_TO_POINTER (index), NULL);
+
+			EEwsConnection *cnc;
+
+			cnc = success ? ecb_ews_ref_connection_sync (cbews, error) : NULL;
+
+			success = cnc && e_ews_connection_delete_item_sync (cnc, EWS_PRIORITY_MEDIUM, &item_id, index, EWS_HARD_DELETE,
+				ecb_ews_is_organizer (cbews, comp) ? EWS_SEND_TO_ALL_AND_SAVE_COPY : EWS_SEND_TO_NONE,
+				EWS_ALL_OCCURRENCES, cancellable, error);
+
+			g_clear_object (&cnc);
+		}
+	}
+
+	g_free (item_id.id);
+	g_free (item_id.change_key);
+
+	g_clear_object (&comp);
+	g_clear_object (&parent);
+
+	return success;
+}
+
+static void
+ecb_ews_get_attach_differences (ECalComponent *oldcomp,
+				ECalComponent *newcomp,
+				GSList **out_removed_attachment_ids, /* gchar * */
+				GSList **out_added_attachments) /* EEwsAttachmentInfo * */
+{
+	GSList *old_attachments = NULL, *new_attachments = NULL, *link;
+
+	g_return_if_fail (out_removed_attachment_ids != NULL);
+	g_return_if_fail (out_added_attachments != NULL);
+
+	*out_removed_attachment_ids = NULL;
+	*out_added_attachments = NULL;
+
+	if (!ecb_ews_extract_attachments (e_cal_component_get_icalcomponent (oldcomp), &old_attachments))
+		old_attachments = NULL;
+
+	if (!ecb_ews_extract_attachments (e_cal_component_get_icalcomponent (newcomp), &new_attachments))
+		new_attachments = NULL;
+
+	for (link = old_attachments; link; link = g_slist_next (link)) {
+		EEwsAttachmentInfo *old_nfo = link->data;
+		GSList *nlink;
+
+		if (!old_nfo)
+			continue;
+
+		for (nlink = new_attachments; nlink; nlink = g_slist_next (nlink)) {
+			EEwsAttachmentInfo *new_nfo = nlink->data;
+			gboolean same = FALSE;
+
+			if (!new_nfo ||
+			    e_ews_attachment_info_get_type (old_nfo) != e_ews_attachment_info_get_type (new_nfo))
+				continue;
+
+			if (e_ews_attachment_info_get_type (old_nfo) == E_EWS_ATTACHMENT_INFO_TYPE_INLINED) {
+				const gchar *old_data, *new_data;
+				gsize old_len = -1, new_len = -1;
+
+				old_data = e_ews_attachment_info_get_inlined_data (old_nfo, &old_len);
+				new_data = e_ews_attachment_info_get_inlined_data (new_nfo, &new_len);
+
+				same = old_len == new_len && (old_len == 0 ||
+					(old_len > 0 && old_data && new_data && memcmp (old_data, new_data, old_len) == 0));
+			} else if (e_ews_attachment_info_get_type (old_nfo) == E_EWS_ATTACHMENT_INFO_TYPE_URI) {
+				same = g_strcmp0 (e_ews_attachment_info_get_uri (old_nfo), e_ews_attachment_info_get_uri (new_nfo)) == 0;
+			}
+
+			if (same) {
+				new_attachments = g_slist_remove (new_attachments, new_nfo);
+				e_ews_attachment_info_free (new_nfo);
+				break;
+			}
+		}
+
+		if (!nlink) {
+			/* Did not find in the new_attachments, thus it's removed */
+			g_warn_if_fail (e_ews_attachment_info_get_id (old_nfo) != NULL);
+			*out_removed_attachment_ids = g_slist_prepend (*out_removed_attachment_ids,
+				g_strdup (e_ews_attachment_info_get_id (old_nfo)));
+		}
+	}
+
+	*out_added_attachments = new_attachments;
+
+	g_slist_free_full (old_attachments, (GDestroyNotify) e_ews_attachment_info_free);
+}
+
+struct TzidCbData {
+	ICalComponent *comp;
+	ECalBackendEws *cbews;
+};
+
+static void
+tzid_cb (ICalParameter *param,
+	 gpointer data)
+{
+	struct TzidCbData *cbd = data;
+	const gchar *tzid;
+	ICalTimezone *zone;
+	ICalComponent *new_comp;
+
+	tzid = i_cal_parameter_get_tzid (param);
+	if (!tzid)
+		return;
+
+	zone = e_timezone_cache_get_timezone (E_TIMEZONE_CACHE (cbd->cbews), tzid);
+	if (!zone)
+		return;
+
+	new_comp = i_cal_timezone_get_component (zone);
+	if (!new_comp)
+		return;
+
+	i_cal_component_take_component (cbd->comp, i_cal_component_clone (new_comp));
+
+	g_object_unref (new_comp);
+}
+
+static void
+ecb_ews_pick_all_tzids_out (ECalBackendEws *cbews,
+			    ICalComponent *icomp)
+{
+
+	/* pick all the tzids out of the component and resolve
+	 * them using the vtimezones in the current calendar */
+	struct TzidCbData cbd;
+
+	cbd.cbews = cbews;
+	cbd.comp = icomp;
+
+	i_cal_component_foreach_tzid (icomp, tzid_cb, &cbd);
+}
+
+static gboolean
+ecb_ews_modify_item_sync (ECalBackendEws *cbews,
+			  GHashTable *removed_indexes,
+			  ICalComponent *old_icomp,
+			  ICalComponent *new_icomp,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	EEwsConnection *cnc;
+	ECalComponent *comp = NULL, *oldcomp = NULL;
+	ICalComponent *icomp;
+	gchar *itemid = NULL, *changekey = NULL;
+	GSList *added_attachments = NULL, *removed_attachment_ids = NULL;
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), FALSE);
+	g_return_val_if_fail (I_CAL_IS_COMPONENT (new_icomp), FALSE);
+
+	icomp = i_cal_component_clone (new_icomp);
+
+	ecb_ews_pick_all_tzids_out (cbews, icomp);
+
+	comp = e_cal_component_new_from_icalcomponent (icomp);
+	if (!comp) {
+		g_propagate_error (error, ECC_ERROR (E_CAL_CLIENT_ERROR_INVALID_OBJECT));
+		return FALSE;
+	}
+
+	ecb_ews_extract_item_id (comp, &itemid, &changekey);
+	if (!itemid) {
+		g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_OTHER_ERROR, _("Cannot determine EWS ItemId")));
+		g_object_unref (comp);
+		return FALSE;
+	}
+
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc) {
+		g_object_unref (comp);
+		g_free (itemid);
+		g_free (changekey);
+		return FALSE;
+	}
+
+	if (old_icomp) {
+		oldcomp = e_cal_component_new_from_icalcomponent (i_cal_component_clone (old_icomp));
+	} else {
+		oldcomp = e_cal_component_new_from_icalcomponent (i_cal_component_clone (new_icomp));
+	}
+
+	ecb_ews_pick_all_tzids_out (cbews, e_cal_component_get_icalcomponent (oldcomp));
+
+	/* In case we have updated attachments we have to run update attachments
+	 * before update items so attendees will receive mails with already updated attachments */
+
+	ecb_ews_get_attach_differences (oldcomp, comp, &removed_attachment_ids, &added_attachments);
+
+	/* preform sync delete attachemnt operation*/
+	if (removed_attachment_ids) {
+		g_free (changekey);
+		changekey = NULL;
+
+		success = e_ews_connection_delete_attachments_sync (cnc, EWS_PRIORITY_MEDIUM,
+			removed_attachment_ids, &changekey, cancellable, error);
+
+		g_slist_free_full (removed_attachment_ids, g_free);
+	}
+
+	/* in case we have a new attachments add them before update */
+	if (added_attachments && success) {
+		EwsId item_id;
+
+		item_id.id = itemid;
+		item_id.change_key = changekey;
+
+		changekey = NULL;
+
+		success = e_ews_connection_create_attachments_sync (
+			cnc, EWS_PRIORITY_MEDIUM,
+			&item_id, added_attachments,
+			FALSE, &changekey, NULL, cancellable, error);
+
+		g_free (item_id.change_key);
+	}
+
+	if (success && old_icomp &&
+	    e_cal_util_component_has_property (new_icomp, I_CAL_RRULE_PROPERTY) &&
+	    !e_cal_util_component_has_property (new_icomp, I_CAL_RECURRENCEID_PROPERTY)) {
+		ICalProperty *prop, *old_prop;
+		GSList *exceptions = NULL, *link;
+		EwsId item_id;
+
+		item_id.id = itemid;
+		item_id.change_key = changekey;
+
+		/* Excluded occurrences */
+		for (prop = i_cal_component_get_first_property (new_icomp, I_CAL_EXDATE_PROPERTY);
+		     prop;
+		     g_object_unref (prop), prop = i_cal_component_get_next_property (new_icomp, I_CAL_EXDATE_PROPERTY)) {
+			gchar *new_rid;
+
+			new_rid = i_cal_property_get_value_as_string (prop);
+
+			for (old_prop = i_cal_component_get_first_property (old_icomp, I_CAL_EXDATE_PROPERTY);
+			     old_prop;
+			     g_object_unref (old_prop), old_prop = i_cal_component_get_next_property (old_icomp, I_CAL_EXDATE_PROPERTY)) {
+				gchar *old_rid = i_cal_property_get_value_as_string (old_prop);
+				if (g_strcmp0 (new_rid, old_rid) == 0) {
+					g_object_unref (old_prop);
+					g_free (old_rid);
+					break;
+				}
+
+				g_free (old_rid);
+			}
+
+			if (!old_prop)
+				exceptions = g_slist_prepend (exceptions, g_object_ref (prop));
+
+			g_free (new_rid);
+		}
+
+		exceptions = g_slist_reverse (exceptions);
+
+		for (link = exceptions; link && success; link = g_slist_next (link)) {
+			gchar *rid;
+			guint index;
+
+			prop = link->data;
+
+			rid = i_cal_property_get_value_as_string (prop);
+			index = e_cal_backend_ews_rid_to_index (
+				ecb_ews_get_timezone_from_icomponent (cbews, new_icomp),
+				rid,
+				new_icomp,
+				error);
+			g_free (rid);
+
+			if (index == 0) {
+				success = FALSE;
+			} else if (!removed_indexes || !g_hash_table_contains (removed_indexes, GINT_TO_POINTER (index))) {
+				if (removed_indexes)
+					g_hash_table_insert (removed_indexes, GINT_TO_POINTER (index), NULL);
+
+				success = e_ews_connection_delete_item_sync (cnc, EWS_PRIORITY_MEDIUM, &item_id, index,
+					EWS_HARD_DELETE, EWS_SEND_TO_NONE, EWS_ALL_OCCURRENCES, cancellable, error);
+			}
 		}
+
+		g_slist_free_full (exceptions, g_object_unref);
 	}
 
-	g_hash_table_iter_init (&iter, existing_hash);
-	while (g_hash_table_iter_next (&iter, NULL, &value)) {
-		*out_removed_instances = g_slist_prepend (*out_removed_instances, g_object_ref (value));
+	if (success) {
+		EwsCalendarConvertData convert_data = { 0 };
+		CamelEwsSettings *ews_settings;
+		const gchar *send_meeting_invitations;
+		const gchar *send_or_save;
+		gchar *folder_id;
+
+		ews_settings = ecb_ews_get_collection_settings (cbews);
+
+		convert_data.connection = cnc;
+		convert_data.timezone_cache = E_TIMEZONE_CACHE (cbews);
+		convert_data.user_email = camel_ews_settings_dup_email (ews_settings);
+		convert_data.comp = comp;
+		convert_data.old_comp = oldcomp;
+		convert_data.item_id = itemid;
+		convert_data.change_key = changekey;
+		convert_data.default_zone = i_cal_timezone_get_utc_timezone ();
+
+		if (e_cal_component_has_attendees (comp)) {
+			send_meeting_invitations = "SendToAllAndSaveCopy";
+			send_or_save = "SendAndSaveCopy";
+		} else {
+			/*In case of appointment we have to set SendMeetingInvites to SendToNone */
+			send_meeting_invitations = "SendToNone";
+			send_or_save = "SaveOnly";
+		}
+
+		folder_id = ecb_ews_dup_folder_id (cbews);
+
+		success = e_ews_connection_update_items_sync (cnc, EWS_PRIORITY_MEDIUM,
+			"AlwaysOverwrite", send_or_save, send_meeting_invitations, folder_id,
+			e_cal_backend_ews_convert_component_to_updatexml, &convert_data,
+			NULL, cancellable, error);
+
+		g_free (convert_data.user_email);
+		g_free (folder_id);
 	}
 
-	g_hash_table_destroy (existing_hash);
+	if (success && i_cal_component_isa (new_icomp) == I_CAL_VTODO_COMPONENT &&
+	    e_cal_util_component_has_property (new_icomp, I_CAL_RRULE_PROPERTY)) {
+		ICalProperty *prop;
+
+		prop = i_cal_component_get_first_property (new_icomp, I_CAL_STATUS_PROPERTY);
+		if (prop && i_cal_property_get_status (prop) == I_CAL_STATUS_COMPLETED) {
+			/* Setting a recurring task completed will mark the existing task
+			   as completed and also add a new task, thus force refresh here,
+			   thus the user sees an up-to-date view of the server content. */
+			e_cal_meta_backend_schedule_refresh (E_CAL_META_BACKEND (cbews));
+		}
+
+		g_clear_object (&prop);
+	}
+
+	g_slist_free_full (added_attachments, (GDestroyNotify) e_ews_attachment_info_free);
+	g_clear_object (&oldcomp);
+	g_clear_object (&comp);
+	g_free (changekey);
+	g_free (itemid);
+	g_object_unref (cnc);
+
+	return success;
+}
+
+typedef struct _PrecreateData {
+	gchar *uid;
+	ICalComponent *icomp;
+	EwsCalendarConvertData convert_data;
+	EwsId *ews_id;
+	GSList *attachments; /* EEwsAttachmentInfo * */
+	GError *error;
+	gint *n_pending;
+} PrecreateData;
+
+static void
+ecb_ews_precreate_data_free (gpointer ptr)
+{
+	PrecreateData *pd = ptr;
+
+	if (pd) {
+		g_free (pd->uid);
+		g_clear_object (&pd->icomp);
+		e_ews_id_free (pd->ews_id);
+		g_slist_free_full (pd->attachments, (GDestroyNotify) e_ews_attachment_info_free);
+		g_clear_error (&pd->error);
+		g_free (pd);
+	}
+}
+
+typedef struct _BatchedResult {
+	gboolean created;
+	gchar *item_id;
+	GError *error;
+} BatchedResult;
+
+static void
+ecb_ews_batched_result_free (gpointer ptr)
+{
+	BatchedResult *br = ptr;
+
+	if (br) {
+		g_free (br->item_id);
+		g_clear_error (&br->error);
+		g_free (br);
+	}
+}
+
+/* Stores the result of a batched request for the @uid, for ecb_ews_take_batched();
+   the @error is assumed by the function */
+static void
+ecb_ews_batched_store (ECalBackendEws *cbews,
+		       GSList **inout_stored, /* gchar * */
+		       const gchar *uid,
+		       gboolean created,
+		       const gchar *item_id,
+		       GError *error)
+{
+	BatchedResult *br;
+
+	br = g_new0 (BatchedResult, 1);
+	br->created = created;
+	br->item_id = g_strdup (item_id);
+	br->error = error;
+
+	g_mutex_lock (&cbews->priv->batched_lock);
+	g_hash_table_insert (cbews->priv->batched, g_strdup (uid), br);
+	g_mutex_unlock (&cbews->priv->batched_lock);
+
+	*inout_stored = g_slist_prepend (*inout_stored, g_strdup (uid));
 }
 
 static gboolean
-ecb_ews_extract_attachments (ICalComponent *icomp,
-			     GSList **out_attachments) /* EEwsAttachmentInfo * */
+ecb_ews_precreate_convert_cb (ESoapMessage *msg,
+			      gpointer user_data,
+			      GError **error)
 {
-	ICalProperty *prop;
-	GSList *props = NULL, *link;
+	GPtrArray *chunk = user_data; /* PrecreateData * */
+	guint ii;
 
-	g_return_val_if_fail (icomp != NULL, FALSE);
-	g_return_val_if_fail (out_attachments != NULL, FALSE);
+	for (ii = 0; ii < chunk->len; ii++) {
+		PrecreateData *pd = g_ptr_array_index (chunk, ii);
 
-	*out_attachments = NULL;
+		if (!e_cal_backend_ews_convert_calcomp_to_xml (msg, &pd->convert_data, error))
+			return FALSE;
+	}
 
-	for (prop = i_cal_component_get_first_property (icomp, I_CAL_ATTACH_PROPERTY);
-	     prop;
-	     prop = i_cal_component_get_next_property (icomp, I_CAL_ATTACH_PROPERTY)) {
-		props = g_slist_prepend (props, prop);
+	return TRUE;
+}
+
+static void
+ecb_ews_precreate_attachments_done_cb (GObject *source_object,
+				       GAsyncResult *result,
+				       gpointer user_data)
+{
+	PrecreateData *pd = user_data;
+	gchar *changekey = NULL;
+	GSList *ids = NULL;
+
+	if (e_ews_connection_create_attachments_finish (E_EWS_CONNECTION (source_object), &changekey, &ids, result, &pd->error) && changekey) {
+		g_free (pd->ews_id->change_key);
+		pd->ews_id->change_key = changekey;
+	} else {
+		g_free (changekey);
+	}
+
+	g_slist_free_full (ids, g_free);
+
+	(*pd->n_pending)--;
+}
+
+/* Creates the simple @calobjs on the server with CreateItem requests of at most
+   EWS_MAX_CREATE_COUNT items and uploads their attachments concurrently.
+   The results are stored for ecb_ews_take_batched(), which is called by
+   the ecb_ews_save_component_sync(). Components, which need more than one
+   request to be saved, meetings, detached instances and series with excluded
+   occurrences, are left for the ecb_ews_save_component_sync(), the same as
+   anything what could not be created in a batch. Returns UIDs of the stored
+   results, to be passed to ecb_ews_batched_forget_sync(). */
+static GSList * /* gchar * */
+ecb_ews_precreate_components_sync (ECalBackendEws *cbews,
+				   const GSList *calobjs, /* gchar * */
+				   GCancellable *cancellable)
+{
+	ECalCache *cal_cache;
+	EEwsConnection *cnc;
+	EwsFolderId *fid;
+	GMainContext *main_context;
+	GPtrArray *todo; /* PrecreateData * */
+	GHashTable *uids;
+	ICalComponentKind kind;
+	GSList *stored = NULL;
+	const GSList *link;
+	gint n_pending = 0;
+	guint ii;
+
+	if (cbews->priv->is_freebusy_calendar ||
+	    !e_backend_get_online (E_BACKEND (cbews)) ||
+	    !e_cal_meta_backend_ensure_connected_sync (E_CAL_META_BACKEND (cbews), cancellable, NULL))
+		return NULL;
+
+	cnc = ecb_ews_ref_connection (cbews);
+	if (!cnc)
+		return NULL;
+
+	cal_cache = e_cal_meta_backend_ref_cache (E_CAL_META_BACKEND (cbews));
+	if (!cal_cache) {
+		g_object_unref (cnc);
+		return NULL;
+	}
+
+	kind = e_cal_backend_get_kind (E_CAL_BACKEND (cbews));
+	todo = g_ptr_array_new_with_free_func (ecb_ews_precreate_data_free);
+	uids = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (link = calobjs; link; link = g_slist_next (link)) {
+		ECalComponent *comp;
+		ICalComponent *icomp;
+		PrecreateData *pd;
+		const gchar *uid;
+
+		comp = link->data ? e_cal_component_new_from_string (link->data) : NULL;
+		if (!comp)
+			continue;
+
+		icomp = e_cal_component_get_icalcomponent (comp);
+		uid = e_cal_component_get_uid (comp);
+
+		if (i_cal_component_isa (icomp) != kind || !uid || !*uid ||
+		    g_hash_table_contains (uids, uid) ||
+		    e_cal_component_is_instance (comp) ||
+		    e_cal_component_has_attendees (comp) ||
+		    e_cal_util_component_has_property (icomp, I_CAL_EXDATE_PROPERTY) ||
+		    e_cache_contains (E_CACHE (cal_cache), uid, E_CACHE_INCLUDE_DELETED)) {
+			g_object_unref (comp);
+			continue;
+		}
+
+		pd = g_new0 (PrecreateData, 1);
+		pd->uid = g_strdup (uid);
+		pd->icomp = i_cal_component_clone (icomp);
+		pd->n_pending = &n_pending;
+
+		e_ews_clean_icomponent (pd->icomp);
+
+		if (!e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010))
+			ecb_ews_pick_all_tzids_out (cbews, pd->icomp);
+
+		pd->convert_data.connection = cnc;
+		pd->convert_data.timezone_cache = E_TIMEZONE_CACHE (cbews);
+		pd->convert_data.icomp = pd->icomp;
+		pd->convert_data.default_zone = i_cal_timezone_get_utc_timezone ();
+
+		g_hash_table_add (uids, pd->uid);
+		g_ptr_array_add (todo, pd);
+
+		g_object_unref (comp);
+	}
+
+	g_hash_table_destroy (uids);
+
+	/* Nothing to gain from a batch */
+	if (todo->len < 2) {
+		g_ptr_array_unref (todo);
+		g_object_unref (cal_cache);
+		g_object_unref (cnc);
+
+		return NULL;
 	}
 
-	for (link = props; link; link = g_slist_next (link)) {
-		EEwsAttachmentInfo *info;
-		ICalAttach *attach;
-		ICalParameter *param;
-		const gchar *stored_filename;
-		gchar *attachid;
+	fid = ecb_ews_new_folder_id (cbews);
 
-		prop = link->data;
-		param = i_cal_property_get_first_parameter (prop, I_CAL_FILENAME_PARAMETER);
-		stored_filename = param ? i_cal_parameter_get_filename (param) : NULL;
+	for (ii = 0; ii < todo->len && !g_cancellable_is_cancelled (cancellable); ii += EWS_MAX_CREATE_COUNT) {
+		GPtrArray *chunk;
+		GSList *items = NULL, *ilink;
+		guint jj;
 
-		attach = i_cal_property_get_attach (prop);
-		if (i_cal_attach_get_is_url (attach)) {
-			const gchar *uri;
+		chunk = g_ptr_array_sized_new (EWS_MAX_CREATE_COUNT);
 
-			uri = i_cal_attach_get_url (attach);
+		for (jj = ii; jj < todo->len && jj < ii + EWS_MAX_CREATE_COUNT; jj++) {
+			g_ptr_array_add (chunk, g_ptr_array_index (todo, jj));
+		}
 
-			if (!uri || !*uri) {
-				g_clear_object (&param);
-				continue;
-			}
+		/* When the whole request fails, or the response cannot be paired with
+		   the request, the components are left for the per-item save */
+		if (e_ews_connection_create_items_sync (cnc, EWS_PRIORITY_MEDIUM, "SaveOnly", "SendToNone",
+			fid, ecb_ews_precreate_convert_cb, chunk, &items, cancellable, NULL) &&
+		    g_slist_length (items) == chunk->len) {
+			for (ilink = items, jj = 0; ilink; ilink = g_slist_next (ilink), jj++) {
+				PrecreateData *pd = g_ptr_array_index (chunk, jj);
+				EEwsItem *item = ilink->data;
 
-			info = e_ews_attachment_info_new (E_EWS_ATTACHMENT_INFO_TYPE_URI);
+				if (!item)
+					continue;
 
-			e_ews_attachment_info_set_uri (info, uri);
-			if (stored_filename && *stored_filename) {
-				e_ews_attachment_info_set_prefer_filename (info, stored_filename);
-			} else {
-				gchar *uri_filename;
+				if (e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR) {
+					const GError *item_error = e_ews_item_get_error (item);
 
-				uri_filename = g_filename_from_uri (uri, NULL, NULL);
-				if (uri_filename && *uri_filename) {
-					gchar *basename;
+					/* Not processed by the server, try again per-item */
+					if (!g_error_matches (item_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_BATCHPROCESSINGSTOPPED))
+						pd->error = g_error_copy (item_error);
+				} else {
+					const EwsId *item_id = e_ews_item_get_id (item);
 
-					basename = g_path_get_basename (uri_filename);
-					if (basename && *basename && basename[0] != '.' && basename[0] != G_DIR_SEPARATOR) {
-						const gchar *uid;
+					if (item_id && item_id->id)
+						pd->ews_id = e_ews_id_copy (item_id);
+				}
+			}
+		}
 
-						uid = i_cal_component_get_uid (icomp);
+		g_slist_free_full (items, g_object_unref);
+		g_ptr_array_unref (chunk);
+	}
 
-						if (uid && g_str_has_prefix (basename, uid) && basename[strlen (uid)] == '-') {
-							e_ews_attachment_info_set_prefer_filename (info, basename + strlen (uid) + 1);
-						}
-					}
+	e_ews_folder_id_free (fid);
 
-					g_free (basename);
-				}
+	main_context = g_main_context_new ();
+	g_main_context_push_thread_default (main_context);
 
-				g_free (uri_filename);
-			}
-		} else {
-			gsize len = -1;
-			guchar *decoded = NULL;
-			const gchar *content;
+	for (ii = 0; ii < todo->len; ii++) {
+		PrecreateData *pd = g_ptr_array_index (todo, ii);
 
-			content = (const gchar *) i_cal_attach_get_data (attach);
-			decoded = g_base64_decode (content, &len);
+		if (!pd->ews_id || !ecb_ews_extract_attachments (pd->icomp, &pd->attachments))
+			continue;
 
-			info = e_ews_attachment_info_new (E_EWS_ATTACHMENT_INFO_TYPE_INLINED);
-			e_ews_attachment_info_set_inlined_data (info, decoded, len);
+		while (n_pending >= EWS_MAX_FETCH_PARALLEL)
+			g_main_context_iteration (main_context, TRUE);
 
-			if (stored_filename && *stored_filename)
-				e_ews_attachment_info_set_prefer_filename (info, stored_filename);
+		n_pending++;
 
-			g_free (decoded);
-		}
+		e_ews_connection_create_attachments (cnc, EWS_PRIORITY_MEDIUM,
+			pd->ews_id, pd->attachments, FALSE, cancellable,
+			ecb_ews_precreate_attachments_done_cb, pd);
+	}
 
-		attachid = i_cal_property_get_parameter_as_string (prop, "X-EWS-ATTACHMENTID");
-		e_ews_attachment_info_set_id (info, attachid);
-		g_free (attachid);
+	while (n_pending > 0)
+		g_main_context_iteration (main_context, TRUE);
 
-		*out_attachments = g_slist_prepend (*out_attachments, info);
+	g_main_context_pop_thread_default (main_context);
+	g_main_context_unref (main_context);
 
-		g_clear_object (&param);
+	for (ii = 0; ii < todo->len; ii++) {
+		PrecreateData *pd = g_ptr_array_index (todo, ii);
+
+		if (!pd->ews_id && !pd->error)
+			continue;
+
+		ecb_ews_batched_store (cbews, &stored, pd->uid, TRUE, pd->ews_id ? pd->ews_id->id : NULL, pd->error);
+		pd->error = NULL;
 	}
 
-	g_slist_free_full (props, g_object_unref);
+	g_ptr_array_unref (todo);
+	g_object_unref (cal_cache);
+	g_object_unref (cnc);
 
-	return *out_attachments != NULL;
+	return stored;
 }
 
-static ICalTimezone *
-ecb_ews_get_timezone_from_icomponent (ECalBackendEws *cbews,
-				      ICalComponent *icomp)
+/* Returns whether the @uid had been created, modified or removed by a batched request;
+   either the @out_item_id or the @out_error is set in such case. */
+static gboolean
+ecb_ews_take_batched (ECalBackendEws *cbews,
+		      const gchar *uid,
+		      gchar **out_item_id,
+		      GError **out_error)
 {
-	ETimezoneCache *timezone_cache;
-	ICalProperty *prop = NULL;
-	const gchar *tzid = NULL;
+	BatchedResult *br = NULL;
+	gpointer orig_key = NULL, value = NULL;
 
-	timezone_cache = E_TIMEZONE_CACHE (cbews);
+	if (!uid)
+		return FALSE;
 
-	prop = i_cal_component_get_first_property (icomp, I_CAL_DTSTART_PROPERTY);
-	if (prop != NULL) {
-		ICalParameter *param = NULL;
+	g_mutex_lock (&cbews->priv->batched_lock);
 
-		param = i_cal_property_get_first_parameter (prop, I_CAL_TZID_PARAMETER);
-		if (param) {
-			tzid = i_cal_parameter_get_tzid (param);
-			g_object_unref (param);
-		} else {
-			ICalTime *dtstart;
+	if (g_hash_table_lookup_extended (cbews->priv->batched, uid, &orig_key, &value)) {
+		g_hash_table_steal (cbews->priv->batched, uid);
+		g_free (orig_key);
 
-			dtstart = i_cal_property_get_dtstart (prop);
-			if (i_cal_time_is_utc (dtstart))
-				tzid = "UTC";
-			g_clear_object (&dtstart);
-		}
+		br = value;
+	}
 
-		g_object_unref (prop);
+	g_mutex_unlock (&cbews->priv->batched_lock);
+
+	if (!br)
+		return FALSE;
+
+	if (br->error) {
+		g_propagate_error (out_error, br->error);
+		br->error = NULL;
+	} else {
+		*out_item_id = br->item_id;
+		br->item_id = NULL;
 	}
 
-	if (tzid)
-		return e_timezone_cache_get_timezone (timezone_cache, tzid);
+	ecb_ews_batched_result_free (br);
 
-	return NULL;
+	return TRUE;
 }
 
-static gboolean
-ecb_ews_remove_item_sync (ECalBackendEws *cbews,
-			  ECalCache *cal_cache,
-			  GHashTable *removed_indexes,
-			  const gchar *uid,
-			  const gchar *rid,
-			  GCancellable *cancellable,
-			  GError **error)
+/* Forgets the results, which had not been taken, like when a previous component
+   failed. The items created by a batch are deleted from the server, because
+   the caller is not told about them. Modified and removed items are received
+   with the next update of the folder. */
+static void
+ecb_ews_batched_forget_sync (ECalBackendEws *cbews,
+			     const GSList *uids) /* gchar * */
 {
-	ECalComponent *comp = NULL, *parent = NULL;
-	EwsId item_id = { 0 };
-	gint index = 0;
-	gboolean success = TRUE;
+	EEwsConnection *cnc;
+	GSList *created_ids = NULL;
+	const GSList *link;
+	GError *local_error = NULL;
 
-	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), FALSE);
-	g_return_val_if_fail (E_IS_CAL_CACHE (cal_cache), FALSE);
-	g_return_val_if_fail (uid != NULL, FALSE);
+	g_mutex_lock (&cbews->priv->batched_lock);
 
-	if (rid && !*rid)
-		rid = NULL;
+	for (link = uids; link; link = g_slist_next (link)) {
+		BatchedResult *br = g_hash_table_lookup (cbews->priv->batched, link->data);
 
-	if (!e_cal_cache_get_component (cal_cache, uid, rid, &comp, cancellable, error) ||
-	    (rid && !e_cal_cache_get_component (cal_cache, uid, NULL, &parent, cancellable, error))) {
-		if (!parent && !comp) {
-			g_propagate_error (error, ECC_ERROR (E_CAL_CLIENT_ERROR_OBJECT_NOT_FOUND));
-			return FALSE;
-		}
+		if (br && br->created && br->item_id)
+			created_ids = g_slist_prepend (created_ids, g_strdup (br->item_id));
+
+		g_hash_table_remove (cbews->priv->batched, link->data);
 	}
 
-	ecb_ews_extract_item_id (comp ? comp : parent, &item_id.id, &item_id.change_key);
+	g_mutex_unlock (&cbews->priv->batched_lock);
 
-	if (!item_id.id) {
-		g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_OTHER_ERROR, _("Cannot determine EWS ItemId")));
-		success = FALSE;
-	} else {
-		if (parent) {
-			index = e_cal_backend_ews_rid_to_index (
-				ecb_ews_get_timezone_from_icomponent (cbews,
-					e_cal_component_get_icalcomponent (parent)),
-				rid,
-				e_cal_component_get_icalcomponent (parent),
-				error);
-			if (index == 0)
-				success = comp != NULL;
-		}
+	if (!created_ids)
+		return;
 
-		if (index && removed_indexes && g_hash_table_contains (removed_indexes, GINT_TO_POINTER (index))) {
-			/* Do nothing, it's already deleted from the server */
-		} else {
-			if (removed_indexes && index)
-				g_hash_table_insert (removed_indexes, GINT_TO_POINTER (index), NULL);
+	cnc = ecb_ews_ref_connection (cbews);
 
-			success = success && e_ews_connection_delete_item_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM, &item_id, index, EWS_HARD_DELETE,
-				ecb_ews_is_organizer (cbews, comp) ? EWS_SEND_TO_ALL_AND_SAVE_COPY : EWS_SEND_TO_NONE,
-				EWS_ALL_OCCURRENCES, cancellable, error);
-		}
+	/* Not cancellable, the operation can be cancelled already */
+	if (cnc && !e_ews_connection_delete_items_in_chunks_sync (cnc, EWS_PRIORITY_MEDIUM, created_ids,
+		EWS_HARD_DELETE, EWS_SEND_TO_NONE, EWS_ALL_OCCURRENCES, NULL, &local_error)) {
+		g_warning ("%s: Failed to delete %u created items: %s", G_STRFUNC, g_slist_length (created_ids),
+			local_error ? local_error->message : "Unknown error");
 	}
 
-	g_free (item_id.id);
-	g_free (item_id.change_key);
-
-	g_clear_object (&comp);
-	g_clear_object (&parent);
-
-	return success;
+	g_clear_error (&local_error);
+	g_clear_object (&cnc);
+	g_slist_free_full (created_ids, g_free);
 }
 
+typedef struct _PremodifyData {
+	gchar *uid;
+	ECalComponent *comp;
+	ECalComponent *old_comp;
+	EwsCalendarConvertData convert_data;
+} PremodifyData;
+
 static void
-ecb_ews_get_attach_differences (ECalComponent *oldcomp,
-				ECalComponent *newcomp,
-				GSList **out_removed_attachment_ids, /* gchar * */
-				GSList **out_added_attachments) /* EEwsAttachmentInfo * */
+ecb_ews_premodify_data_free (gpointer ptr)
 {
-	GSList *old_attachments = NULL, *new_attachments = NULL, *link;
-
-	g_return_if_fail (out_removed_attachment_ids != NULL);
-	g_return_if_fail (out_added_attachments != NULL);
-
-	*out_removed_attachment_ids = NULL;
-	*out_added_attachments = NULL;
+	PremodifyData *pd = ptr;
+
+	if (pd) {
+		g_free (pd->uid);
+		g_clear_object (&pd->comp);
+		g_clear_object (&pd->old_comp);
+		g_free (pd->convert_data.item_id);
+		g_free (pd->convert_data.change_key);
+		g_free (pd);
+	}
+}
 
-	if (!ecb_ews_extract_attachments (e_cal_component_get_icalcomponent (oldcomp), &old_attachments))
-		old_attachments = NULL;
+static gboolean
+ecb_ews_premodify_convert_cb (ESoapMessage *msg,
+			      gpointer user_data,
+			      GError **error)
+{
+	GPtrArray *chunk = user_data; /* PremodifyData * */
+	guint ii;
 
-	if (!ecb_ews_extract_attachments (e_cal_component_get_icalcomponent (newcomp), &new_attachments))
-		new_attachments = NULL;
+	for (ii = 0; ii < chunk->len; ii++) {
+		PremodifyData *pd = g_ptr_array_index (chunk, ii);
 
-	for (link = old_attachments; link; link = g_slist_next (link)) {
-		EEwsAttachmentInfo *old_nfo = link->data;
-		GSList *nlink;
+		if (!e_cal_backend_ews_convert_component_to_updatexml (msg, &pd->convert_data, error))
+			return FALSE;
+	}
 
-		if (!old_nfo)
-			continue;
+	return TRUE;
+}
 
-		for (nlink = new_attachments; nlink; nlink = g_slist_next (nlink)) {
-			EEwsAttachmentInfo *new_nfo = nlink->data;
-			gboolean same = FALSE;
+/* Returns the component to be changed, when it can be modified in a batch;
+   that is, when it is a single non-recurring component without attendees
+   and with the same attachments as before */
+static ECalComponent *
+ecb_ews_dup_premodify_old_comp (ECalCache *cal_cache,
+				ECalComponent *comp,
+				GCancellable *cancellable)
+{
+	ECalComponent *old_comp = NULL;
+	GSList *existing = NULL, *removed_ids = NULL, *added = NULL;
+	gchar *old_str, *new_str;
+
+	if (e_cal_component_is_instance (comp) ||
+	    e_cal_component_has_recurrences (comp) ||
+	    e_cal_component_has_attendees (comp) ||
+	    !e_cal_cache_get_components_by_uid (cal_cache, e_cal_component_get_uid (comp), &existing, cancellable, NULL) ||
+	    !existing || existing->next) {
+		g_slist_free_full (existing, g_object_unref);
+		return NULL;
+	}
 
-			if (!new_nfo ||
-			    e_ews_attachment_info_get_type (old_nfo) != e_ews_attachment_info_get_type (new_nfo))
-				continue;
+	old_comp = ecb_ews_restore_original_comp (existing->data);
+	if (!old_comp)
+		old_comp = g_object_ref (existing->data);
 
-			if (e_ews_attachment_info_get_type (old_nfo) == E_EWS_ATTACHMENT_INFO_TYPE_INLINED) {
-				const gchar *old_data, *new_data;
-				gsize old_len = -1, new_len = -1;
+	g_slist_free_full (existing, g_object_unref);
 
-				old_data = e_ews_attachment_info_get_inlined_data (old_nfo, &old_len);
-				new_data = e_ews_attachment_info_get_inlined_data (new_nfo, &new_len);
+	if (e_cal_component_has_recurrences (old_comp) ||
+	    e_cal_component_has_attendees (old_comp)) {
+		g_object_unref (old_comp);
+		return NULL;
+	}
 
-				same = old_len == new_len && (old_len == 0 ||
-					(old_len > 0 && old_data && new_data && memcmp (old_data, new_data, old_len) == 0));
-			} else if (e_ews_attachment_info_get_type (old_nfo) == E_EWS_ATTACHMENT_INFO_TYPE_URI) {
-				same = g_strcmp0 (e_ews_attachment_info_get_uri (old_nfo), e_ews_attachment_info_get_uri (new_nfo)) == 0;
-			}
+	ecb_ews_get_attach_differences (old_comp, comp, &removed_ids, &added);
 
-			if (same) {
-				new_attachments = g_slist_remove (new_attachments, new_nfo);
-				e_ews_attachment_info_free (new_nfo);
-				break;
-			}
-		}
+	old_str = i_cal_component_as_ical_string (e_cal_component_get_icalcomponent (old_comp));
+	new_str = i_cal_component_as_ical_string (e_cal_component_get_icalcomponent (comp));
 
-		if (!nlink) {
-			/* Did not find in the new_attachments, thus it's removed */
-			g_warn_if_fail (e_ews_attachment_info_get_id (old_nfo) != NULL);
-			*out_removed_attachment_ids = g_slist_prepend (*out_removed_attachment_ids,
-				g_strdup (e_ews_attachment_info_get_id (old_nfo)));
-		}
-	}
+	/* Nothing to gain for unchanged components, the per-item save skips them */
+	if (removed_ids || added || g_strcmp0 (old_str, new_str) == 0)
+		g_clear_object (&old_comp);
 
-	*out_added_attachments = new_attachments;
+	g_slist_free_full (removed_ids, g_free);
+	g_slist_free_full (added, (GDestroyNotify) e_ews_attachment_info_free);
+	g_free (old_str);
+	g_free (new_str);
 
-	g_slist_free_full (old_attachments, (GDestroyNotify) e_ews_attachment_info_free);
+	return old_comp;
 }
 
-struct TzidCbData {
-	ICalComponent *comp;
-	ECalBackendEws *cbews;
-};
-
-static void
-tzid_cb (ICalParameter *param,
-	 gpointer data)
+/* Modifies the simple @calobjs on the server with UpdateItem requests of at most
+   EWS_MAX_CREATE_COUNT item changes. The results are stored for ecb_ews_take_batched(),
+   which is called by the ecb_ews_save_component_sync(). Anything what could not
+   be modified in a batch is left for the ecb_ews_save_component_sync(). Returns
+   UIDs of the stored results, to be passed to ecb_ews_batched_forget_sync(). */
+static GSList * /* gchar * */
+ecb_ews_premodify_components_sync (ECalBackendEws *cbews,
+				   const GSList *calobjs, /* gchar * */
+				   GCancellable *cancellable)
 {
-	struct TzidCbData *cbd = data;
-	const gchar *tzid;
-	ICalTimezone *zone;
-	ICalComponent *new_comp;
+	ECalCache *cal_cache;
+	EEwsConnection *cnc;
+	CamelEwsSettings *ews_settings;
+	GPtrArray *todo; /* PremodifyData * */
+	GHashTable *uids;
+	ICalComponentKind kind;
+	GSList *stored = NULL;
+	const GSList *link;
+	gchar *user_email, *folder_id;
+	guint ii;
+
+	if (cbews->priv->is_freebusy_calendar ||
+	    !e_backend_get_online (E_BACKEND (cbews)) ||
+	    !e_cal_meta_backend_ensure_connected_sync (E_CAL_META_BACKEND (cbews), cancellable, NULL))
+		return NULL;
 
-	tzid = i_cal_parameter_get_tzid (param);
-	if (!tzid)
-		return;
+	cnc = ecb_ews_ref_connection (cbews);
+	if (!cnc)
+		return NULL;
 
-	zone = e_timezone_cache_get_timezone (E_TIMEZONE_CACHE (cbd->cbews), tzid);
-	if (!zone)
-		return;
+	cal_cache = e_cal_meta_backend_ref_cache (E_CAL_META_BACKEND (cbews));
+	if (!cal_cache) {
+		g_object_unref (cnc);
+		return NULL;
+	}
 
-	new_comp = i_cal_timezone_get_component (zone);
-	if (!new_comp)
-		return;
+	ews_settings = ecb_ews_get_collection_settings (cbews);
+	user_email = camel_ews_settings_dup_email (ews_settings);
 
-	i_cal_component_take_component (cbd->comp, i_cal_component_clone (new_comp));
+	kind = e_cal_backend_get_kind (E_CAL_BACKEND (cbews));
+	todo = g_ptr_array_new_with_free_func (ecb_ews_premodify_data_free);
+	uids = g_hash_table_new (g_str_hash, g_str_equal);
 
-	g_object_unref (new_comp);
-}
+	for (link = calobjs; link; link = g_slist_next (link)) {
+		ECalComponent *comp, *old_comp;
+		PremodifyData *pd;
+		const gchar *uid;
 
-static void
-ecb_ews_pick_all_tzids_out (ECalBackendEws *cbews,
-			    ICalComponent *icomp)
-{
+		comp = link->data ? e_cal_component_new_from_string (link->data) : NULL;
+		if (!comp)
+			continue;
 
-	/* pick all the tzids out of the component and resolve
-	 * them using the vtimezones in the current calendar */
-	struct TzidCbData cbd;
+		uid = e_cal_component_get_uid (comp);
 
-	cbd.cbews = cbews;
-	cbd.comp = icomp;
+		if (i_cal_component_isa (e_cal_component_get_icalcomponent (comp)) != kind || !uid || !*uid ||
+		    g_hash_table_contains (uids, uid)) {
+			g_object_unref (comp);
+			continue;
+		}
 
-	i_cal_component_foreach_tzid (icomp, tzid_cb, &cbd);
-}
+		old_comp = ecb_ews_dup_premodify_old_comp (cal_cache, comp, cancellable);
+		if (!old_comp) {
+			g_object_unref (comp);
+			continue;
+		}
 
-static gboolean
-ecb_ews_modify_item_sync (ECalBackendEws *cbews,
-			  GHashTable *removed_indexes,
-			  ICalComponent *old_icomp,
-			  ICalComponent *new_icomp,
-			  GCancellable *cancellable,
-			  GError **error)
-{
-	ECalComponent *comp = NULL, *oldcomp = NULL;
-	ICalComponent *icomp;
-	gchar *itemid = NULL, *changekey = NULL;
-	GSList *added_attachments = NULL, *removed_attachment_ids = NULL;
-	gboolean success = TRUE;
+		pd = g_new0 (PremodifyData, 1);
+		pd->uid = g_strdup (uid);
+		pd->comp = comp;
+		pd->old_comp = old_comp;
 
-	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (cbews), FALSE);
-	g_return_val_if_fail (I_CAL_IS_COMPONENT (new_icomp), FALSE);
+		ecb_ews_extract_item_id (pd->comp, &pd->convert_data.item_id, &pd->convert_data.change_key);
 
-	icomp = i_cal_component_clone (new_icomp);
+		if (!pd->convert_data.item_id) {
+			ecb_ews_premodify_data_free (pd);
+			continue;
+		}
 
-	ecb_ews_pick_all_tzids_out (cbews, icomp);
+		ecb_ews_pick_all_tzids_out (cbews, e_cal_component_get_icalcomponent (pd->comp));
+		ecb_ews_pick_all_tzids_out (cbews, e_cal_component_get_icalcomponent (pd->old_comp));
 
-	comp = e_cal_component_new_from_icalcomponent (icomp);
-	if (!comp) {
-		g_propagate_error (error, ECC_ERROR (E_CAL_CLIENT_ERROR_INVALID_OBJECT));
-		return FALSE;
-	}
+		pd->convert_data.connection = cnc;
+		pd->convert_data.timezone_cache = E_TIMEZONE_CACHE (cbews);
+		pd->convert_data.user_email = user_email;
+		pd->convert_data.comp = pd->comp;
+		pd->convert_data.old_comp = pd->old_comp;
+		pd->convert_data.default_zone = i_cal_timezone_get_utc_timezone ();
 
-	ecb_ews_extract_item_id (comp, &itemid, &changekey);
-	if (!itemid) {
-		g_propagate_error (error, EC_ERROR_EX (E_CLIENT_ERROR_OTHER_ERROR, _("Cannot determine EWS ItemId")));
-		g_object_unref (comp);
-		return FALSE;
+		g_hash_table_add (uids, pd->uid);
+		g_ptr_array_add (todo, pd);
 	}
 
-	if (old_icomp) {
-		oldcomp = e_cal_component_new_from_icalcomponent (i_cal_component_clone (old_icomp));
-	} else {
-		oldcomp = e_cal_component_new_from_icalcomponent (i_cal_component_clone (new_icomp));
-	}
+	g_hash_table_destroy (uids);
 
-	ecb_ews_pick_all_tzids_out (cbews, e_cal_component_get_icalcomponent (oldcomp));
+	folder_id = todo->len >= 2 ? ecb_ews_dup_folder_id (cbews) : NULL;
 
-	/* In case we have updated attachments we have to run update attachments
-	 * before update items so attendees will receive mails with already updated attachments */
+	for (ii = 0; folder_id && ii < todo->len && !g_cancellable_is_cancelled (cancellable); ii += EWS_MAX_CREATE_COUNT) {
+		GPtrArray *chunk;
+		GSList *items = NULL, *ilink;
+		guint jj;
 
-	ecb_ews_get_attach_differences (oldcomp, comp, &removed_attachment_ids, &added_attachments);
+		chunk = g_ptr_array_sized_new (EWS_MAX_CREATE_COUNT);
 
-	/* preform sync delete attachemnt operation*/
-	if (removed_attachment_ids) {
-		g_free (changekey);
-		changekey = NULL;
+		for (jj = ii; jj < todo->len && jj < ii + EWS_MAX_CREATE_COUNT; jj++) {
+			g_ptr_array_add (chunk, g_ptr_array_index (todo, jj));
+		}
 
-		success = e_ews_connection_delete_attachments_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-			removed_attachment_ids, &changekey, cancellable, error);
+		/* Anything what failed is left for the per-item save, which reports the error */
+		if (e_ews_connection_update_items_sync (cnc, EWS_PRIORITY_MEDIUM,
+			"AlwaysOverwrite", "SaveOnly", "SendToNone", folder_id,
+			ecb_ews_premodify_convert_cb, chunk, &items, cancellable, NULL) &&
+		    g_slist_length (items) == chunk->len) {
+			for (ilink = items, jj = 0; ilink; ilink = g_slist_next (ilink), jj++) {
+				PremodifyData *pd = g_ptr_array_index (chunk, jj);
+				EEwsItem *item = ilink->data;
+
+				if (item && e_ews_item_get_item_type (item) != E_EWS_ITEM_TYPE_ERROR)
+					ecb_ews_batched_store (cbews, &stored, pd->uid, FALSE, pd->convert_data.item_id, NULL);
+			}
+		}
 
-		g_slist_free_full (removed_attachment_ids, g_free);
+		g_slist_free_full (items, g_object_unref);
+		g_ptr_array_unref (chunk);
 	}
 
-	/* in case we have a new attachments add them before update */
-	if (added_attachments && success) {
-		EwsId item_id;
+	g_ptr_array_unref (todo);
+	g_object_unref (cal_cache);
+	g_object_unref (cnc);
+	g_free (user_email);
+	g_free (folder_id);
 
-		item_id.id = itemid;
-		item_id.change_key = changekey;
+	return stored;
+}
 
-		changekey = NULL;
+typedef struct _PreremoveData {
+	const gchar *uid; /* not owned */
+	gchar *item_id;
+} PreremoveData;
 
-		success = e_ews_connection_create_attachments_sync (
-			cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-			&item_id, added_attachments,
-			FALSE, &changekey, NULL, cancellable, error);
+static void
+ecb_ews_preremove_data_free (gpointer ptr)
+{
+	PreremoveData *pd = ptr;
 
-		g_free (item_id.change_key);
+	if (pd) {
+		g_free (pd->item_id);
+		g_free (pd);
 	}
+}
 
-	if (success && old_icomp &&
-	    e_cal_util_component_has_property (new_icomp, I_CAL_RRULE_PROPERTY) &&
-	    !e_cal_util_component_has_property (new_icomp, I_CAL_RECURRENCEID_PROPERTY)) {
-		ICalProperty *prop, *old_prop;
-		GSList *exceptions = NULL, *link;
-		EwsId item_id;
-
-		item_id.id = itemid;
-		item_id.change_key = changekey;
-
-		/* Excluded occurrences */
-		for (prop = i_cal_component_get_first_property (new_icomp, I_CAL_EXDATE_PROPERTY);
-		     prop;
-		     g_object_unref (prop), prop = i_cal_component_get_next_property (new_icomp, I_CAL_EXDATE_PROPERTY)) {
-			gchar *new_rid;
-
-			new_rid = i_cal_property_get_value_as_string (prop);
+/* Removes the whole components of the @ids with DeleteItem requests of at most
+   EWS_MAX_CREATE_COUNT item IDs. The results are stored for ecb_ews_take_batched(),
+   which is called by the ecb_ews_remove_component_sync(). When a request fails,
+   its components are left for the ecb_ews_remove_component_sync(). Returns UIDs
+   of the stored results, to be passed to ecb_ews_batched_forget_sync(). */
+static GSList * /* gchar * */
+ecb_ews_preremove_components_sync (ECalBackendEws *cbews,
+				   const GSList *ids, /* ECalComponentId * */
+				   ECalObjModType mod,
+				   GCancellable *cancellable)
+{
+	ECalCache *cal_cache;
+	EEwsConnection *cnc;
+	GPtrArray *todo[2]; /* PreremoveData *; without and with cancellations */
+	GHashTable *uids;
+	GSList *stored = NULL;
+	const GSList *link;
+	guint ii, jj, kk;
+
+	if (cbews->priv->is_freebusy_calendar ||
+	    !e_backend_get_online (E_BACKEND (cbews)) ||
+	    !e_cal_meta_backend_ensure_connected_sync (E_CAL_META_BACKEND (cbews), cancellable, NULL))
+		return NULL;
 
-			for (old_prop = i_cal_component_get_first_property (old_icomp, I_CAL_EXDATE_PROPERTY);
-			     old_prop;
-			     g_object_unref (old_prop), old_prop = i_cal_component_get_next_property (old_icomp, I_CAL_EXDATE_PROPERTY)) {
-				gchar *old_rid = i_cal_property_get_value_as_string (old_prop);
-				if (g_strcmp0 (new_rid, old_rid) == 0) {
-					g_object_unref (old_prop);
-					g_free (old_rid);
-					break;
-				}
+	cnc = ecb_ews_ref_connection (cbews);
+	if (!cnc)
+		return NULL;
 
-				g_free (old_rid);
-			}
+	cal_cache = e_cal_meta_backend_ref_cache (E_CAL_META_BACKEND (cbews));
+	if (!cal_cache) {
+		g_object_unref (cnc);
+		return NULL;
+	}
 
-			if (!old_prop)
-				exceptions = g_slist_prepend (exceptions, g_object_ref (prop));
+	todo[0] = g_ptr_array_new_with_free_func (ecb_ews_preremove_data_free);
+	todo[1] = g_ptr_array_new_with_free_func (ecb_ews_preremove_data_free);
+	uids = g_hash_table_new (g_str_hash, g_str_equal);
 
-			g_free (new_rid);
-		}
+	for (link = ids; link; link = g_slist_next (link)) {
+		ECalComponentId *id = link->data;
+		ECalComponent *comp;
+		PreremoveData *pd;
+		GSList *existing = NULL;
+		const gchar *uid, *rid;
+		gchar *item_id = NULL;
 
-		exceptions = g_slist_reverse (exceptions);
+		uid = id ? e_cal_component_id_get_uid (id) : NULL;
+		rid = id ? e_cal_component_id_get_rid (id) : NULL;
 
-		for (link = exceptions; link && success; link = g_slist_next (link)) {
-			gchar *rid;
-			guint index;
+		/* Only whole components */
+		if (!uid || !*uid || (rid && *rid) || g_hash_table_contains (uids, uid) ||
+		    !e_cal_cache_get_components_by_uid (cal_cache, uid, &existing, cancellable, NULL) || !existing)
+			continue;
 
-			prop = link->data;
+		comp = existing->data;
 
-			rid = i_cal_property_get_value_as_string (prop);
-			index = e_cal_backend_ews_rid_to_index (
-				ecb_ews_get_timezone_from_icomponent (cbews, new_icomp),
-				rid,
-				new_icomp,
-				error);
-			g_free (rid);
+		if (mod == E_CAL_OBJ_MOD_ALL || (!existing->next && !e_cal_component_has_recurrences (comp)))
+			ecb_ews_extract_item_id (comp, &item_id, NULL);
 
-			if (index == 0) {
-				success = FALSE;
-			} else if (!removed_indexes || !g_hash_table_contains (removed_indexes, GINT_TO_POINTER (index))) {
-				if (removed_indexes)
-					g_hash_table_insert (removed_indexes, GINT_TO_POINTER (index), NULL);
+		if (item_id) {
+			pd = g_new0 (PreremoveData, 1);
+			pd->uid = uid;
+			pd->item_id = item_id;
 
-				success = e_ews_connection_delete_item_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM, &item_id, index,
-					EWS_HARD_DELETE, EWS_SEND_TO_NONE, EWS_ALL_OCCURRENCES, cancellable, error);
-			}
+			g_ptr_array_add (todo[ecb_ews_is_organizer (cbews, comp) ? 1 : 0], pd);
+			g_hash_table_add (uids, (gpointer) uid);
 		}
 
-		g_slist_free_full (exceptions, g_object_unref);
+		g_slist_free_full (existing, g_object_unref);
 	}
 
-	if (success) {
-		EwsCalendarConvertData convert_data = { 0 };
-		CamelEwsSettings *ews_settings;
-		const gchar *send_meeting_invitations;
-		const gchar *send_or_save;
+	g_hash_table_destroy (uids);
 
-		ews_settings = ecb_ews_get_collection_settings (cbews);
+	for (kk = 0; kk < 2; kk++) {
+		/* Nothing to gain from a batch */
+		if (todo[kk]->len < 2)
+			continue;
 
-		convert_data.connection = cbews->priv->cnc;
-		convert_data.timezone_cache = E_TIMEZONE_CACHE (cbews);
-		convert_data.user_email = camel_ews_settings_dup_email (ews_settings);
-		convert_data.comp = comp;
-		convert_data.old_comp = oldcomp;
-		convert_data.item_id = itemid;
-		convert_data.change_key = changekey;
-		convert_data.default_zone = i_cal_timezone_get_utc_timezone ();
+		for (ii = 0; ii < todo[kk]->len && !g_cancellable_is_cancelled (cancellable); ii += EWS_MAX_CREATE_COUNT) {
+			GSList *item_ids = NULL;
 
-		if (e_cal_component_has_attendees (comp)) {
-			send_meeting_invitations = "SendToAllAndSaveCopy";
-			send_or_save = "SendAndSaveCopy";
-		} else {
-			/*In case of appointment we have to set SendMeetingInvites to SendToNone */
-			send_meeting_invitations = "SendToNone";
-			send_or_save = "SaveOnly";
-		}
+			for (jj = ii; jj < todo[kk]->len && jj < ii + EWS_MAX_CREATE_COUNT; jj++) {
+				PreremoveData *pd = g_ptr_array_index (todo[kk], jj);
 
-		success = e_ews_connection_update_items_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-			"AlwaysOverwrite", send_or_save, send_meeting_invitations, cbews->priv->folder_id,
-			e_cal_backend_ews_convert_component_to_updatexml, &convert_data,
-			NULL, cancellable, error);
+				item_ids = g_slist_prepend (item_ids, pd->item_id);
+			}
 
-		g_free (convert_data.user_email);
-	}
+			item_ids = g_slist_reverse (item_ids);
 
-	if (success && i_cal_component_isa (new_icomp) == I_CAL_VTODO_COMPONENT &&
-	    e_cal_util_component_has_property (new_icomp, I_CAL_RRULE_PROPERTY)) {
-		ICalProperty *prop;
+			if (e_ews_connection_delete_items_sync (cnc, EWS_PRIORITY_MEDIUM, item_ids, EWS_HARD_DELETE,
+				kk == 0 ? EWS_SEND_TO_NONE : EWS_SEND_TO_ALL_AND_SAVE_COPY,
+				EWS_ALL_OCCURRENCES, cancellable, NULL)) {
+				for (jj = ii; jj < todo[kk]->len && jj < ii + EWS_MAX_CREATE_COUNT; jj++) {
+					PreremoveData *pd = g_ptr_array_index (todo[kk], jj);
 
-		prop = i_cal_component_get_first_property (new_icomp, I_CAL_STATUS_PROPERTY);
-		if (prop && i_cal_property_get_status (prop) == I_CAL_STATUS_COMPLETED) {
-			/* Setting a recurring task completed will mark the existing task
-			   as completed and also add a new task, thus force refresh here,
-			   thus the user sees an up-to-date view of the server content. */
-			e_cal_meta_backend_schedule_refresh (E_CAL_META_BACKEND (cbews));
-		}
+					ecb_ews_batched_store (cbews, &stored, pd->uid, FALSE, pd->item_id, NULL);
+				}
+			}
 
-		g_clear_object (&prop);
+			g_slist_free (item_ids);
+		}
 	}
 
-	g_slist_free_full (added_attachments, (GDestroyNotify) e_ews_attachment_info_free);
-	g_clear_object (&oldcomp);
-	g_clear_object (&comp);
-	g_free (changekey);
-	g_free (itemid);
+	g_ptr_array_unref (todo[0]);
+	g_ptr_array_unref (todo[1]);
+	g_object_unref (cal_cache);
+	g_object_unref (cnc);
 
-	return success;
+	return stored;
 }
 
 static gboolean
@@ -2718,6 +4899,7 @@ ecb_ews_save_component_sync (ECalMetaBackend *meta_backend,
 {
 	ECalBackendEws *cbews;
 	ECalCache *cal_cache;
+	EEwsConnection *cnc;
 	ECalComponent *master = NULL;
 	EwsFolderId *fid;
 	GSList *link;
@@ -2746,12 +4928,19 @@ ecb_ews_save_component_sync (ECalMetaBackend *meta_backend,
 	cal_cache = e_cal_meta_backend_ref_cache (meta_backend);
 	g_return_val_if_fail (cal_cache != NULL, FALSE);
 
-	g_rec_mutex_lock (&cbews->priv->cnc_lock);
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc) {
+		g_object_unref (cal_cache);
+		return FALSE;
+	}
 
 	uid = e_cal_component_get_uid (master);
-	fid = e_ews_folder_id_new (cbews->priv->folder_id, NULL, FALSE);
+	fid = ecb_ews_new_folder_id (cbews);
 
-	if (overwrite_existing) {
+	if (ecb_ews_take_batched (cbews, uid, out_new_uid, error)) {
+		/* Created or modified by a batched request already */
+		success = *out_new_uid != NULL;
+	} else if (overwrite_existing) {
 		GSList *existing = NULL, *changed_instances = NULL, *removed_instances = NULL;
 
 		success = uid && e_cal_cache_get_components_by_uid (cal_cache, uid, &existing, cancellable, error) && existing;
@@ -2833,7 +5022,7 @@ ecb_ews_save_component_sync (ECalMetaBackend *meta_backend,
 
 		e_ews_clean_icomponent (icomp);
 
-		if (!e_ews_connection_satisfies_server_version (cbews->priv->cnc, E_EWS_EXCHANGE_2010))
+		if (!e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010))
 			ecb_ews_pick_all_tzids_out (cbews, icomp);
 
 		/*
@@ -2853,12 +5042,12 @@ ecb_ews_save_component_sync (ECalMetaBackend *meta_backend,
 			send_meeting_invitations = "SendToNone";
 		}
 
-		convert_data.connection = cbews->priv->cnc;
+		convert_data.connection = cnc;
 		convert_data.timezone_cache = E_TIMEZONE_CACHE (cbews);
 		convert_data.icomp = icomp;
 		convert_data.default_zone = i_cal_timezone_get_utc_timezone ();
 
-		success = e_ews_connection_create_items_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM, "SaveOnly", send_meeting_invitations,
+		success = e_ews_connection_create_items_sync (cnc, EWS_PRIORITY_MEDIUM, "SaveOnly", send_meeting_invitations,
 			fid, e_cal_backend_ews_convert_calcomp_to_xml, &convert_data,
 			&items, cancellable, error);
 
@@ -2881,7 +5070,7 @@ ecb_ews_save_component_sync (ECalMetaBackend *meta_backend,
 			items = g_slist_append (NULL, ews_id->id);
 
 			/* get calender uid from server*/
-			success = e_ews_connection_get_items_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
+			success = e_ews_connection_get_items_sync (cnc, EWS_PRIORITY_MEDIUM,
 				items, "IdOnly", add_props, FALSE, NULL, E_EWS_BODY_TYPE_TEXT,
 				&items_req, NULL, NULL, cancellable, error) && items_req != NULL;
 
@@ -2919,7 +5108,7 @@ ecb_ews_save_component_sync (ECalMetaBackend *meta_backend,
 				gchar *changekey = NULL;
 				GSList *ids = NULL;
 
-				success = e_ews_connection_create_attachments_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
+				success = e_ews_connection_create_attachments_sync (cnc, EWS_PRIORITY_MEDIUM,
 					ews_id, info_attachments, FALSE, &changekey, &ids, cancellable, error);
 
 				g_slist_free_full (info_attachments, (GDestroyNotify) e_ews_attachment_info_free);
@@ -2991,7 +5180,7 @@ ecb_ews_save_component_sync (ECalMetaBackend *meta_backend,
 		g_hash_table_destroy (removed_indexes);
 	}
 
-	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+	g_object_unref (cnc);
 
 	g_clear_object (&cal_cache);
 	e_ews_folder_id_free (fid);
@@ -3013,33 +5202,56 @@ ecb_ews_remove_component_sync (ECalMetaBackend *meta_backend,
 			       GError **error)
 {
 	ECalBackendEws *cbews;
+	EEwsConnection *cnc;
 	ECalComponent *comp;
 	EwsId item_id;
+	gchar *removed_id = NULL;
 	gboolean success;
+	GError *local_error = NULL;
 
 	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
 	g_return_val_if_fail (object != NULL, FALSE);
 
 	cbews = E_CAL_BACKEND_EWS (meta_backend);
 
+	/* Removed by the ecb_ews_remove_objects_sync() already */
+	if (ecb_ews_take_batched (cbews, uid, &removed_id, error)) {
+		success = removed_id != NULL;
+
+		g_free (removed_id);
+
+		return success;
+	}
+
 	comp = e_cal_component_new_from_string (object);
 	if (!comp) {
 		g_propagate_error (error, ECC_ERROR (E_CAL_CLIENT_ERROR_INVALID_OBJECT));
 		return FALSE;
 	}
 
-	g_rec_mutex_lock (&cbews->priv->cnc_lock);
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc) {
+		g_object_unref (comp);
+		return FALSE;
+	}
 
 	ecb_ews_extract_item_id (comp, &item_id.id, &item_id.change_key);
 
-	success = e_ews_connection_delete_item_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM, &item_id, 0, EWS_HARD_DELETE,
+	success = e_ews_connection_delete_item_sync (cnc, EWS_PRIORITY_MEDIUM, &item_id, 0, EWS_HARD_DELETE,
 		ecb_ews_is_organizer (cbews, comp) ? EWS_SEND_TO_ALL_AND_SAVE_COPY : EWS_SEND_TO_NONE,
-		EWS_ALL_OCCURRENCES, cancellable, error);
+		EWS_ALL_OCCURRENCES, cancellable, &local_error);
+
+	/* A failed batch in the ecb_ews_remove_objects_sync() can remove some of its items */
+	if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_ITEMNOTFOUND)) {
+		g_clear_error (&local_error);
+		success = TRUE;
+	} else if (local_error) {
+		g_propagate_error (error, local_error);
+	}
 
 	g_free (item_id.id);
 	g_free (item_id.change_key);
-
-	g_rec_mutex_unlock (&cbews->priv->cnc_lock);
+	g_object_unref (cnc);
 
 	ecb_ews_convert_error_to_edc_error (error);
 	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
@@ -3060,6 +5272,7 @@ ecb_ews_discard_alarm_sync (ECalBackendSync *cal_backend_sync,
 {
 	ECalBackendEws *cbews;
 	ECalCache *cal_cache;
+	EEwsConnection *cnc;
 	ECalComponent *comp = NULL;
 	EwsCalendarConvertData convert_data = { 0 };
 
@@ -3083,6 +5296,12 @@ ecb_ews_discard_alarm_sync (ECalBackendSync *cal_backend_sync,
 		return;
 	}
 
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc) {
+		g_clear_object (&comp);
+		return;
+	}
+
 	convert_data.timezone_cache = E_TIMEZONE_CACHE (cbews);
 
 	if (e_cal_component_has_recurrences (comp)) {
@@ -3107,7 +5326,7 @@ ecb_ews_discard_alarm_sync (ECalBackendSync *cal_backend_sync,
 	ecb_ews_extract_item_id (comp, &convert_data.item_id, &convert_data.change_key);
 
 	if (e_ews_connection_update_items_sync (
-		cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
+		cnc, EWS_PRIORITY_MEDIUM,
 		"AlwaysOverwrite", NULL,
 		"SendToNone", NULL,
 		e_cal_backend_ews_clear_reminder_is_set,
@@ -3130,6 +5349,7 @@ ecb_ews_discard_alarm_sync (ECalBackendSync *cal_backend_sync,
 		g_slist_free_full (modified_objects, e_cal_meta_backend_info_free);
 	}
 
+	g_object_unref (cnc);
 	g_object_unref (comp);
 	g_free (convert_data.item_id);
 	g_free (convert_data.change_key);
@@ -3148,6 +5368,7 @@ ecb_ews_send_cancellation_email_sync (ECalBackendEws *cbews,
 				      GCancellable *cancellable,
 				      GError **error)
 {
+	EEwsConnection *cnc;
 	CamelMimeMessage *message;
 	CamelContentType *mime_type;
 	CamelMultipart *multi;
@@ -3223,7 +5444,11 @@ ecb_ews_send_cancellation_email_sync (ECalBackendEws *cbews,
 	camel_medium_set_content ((CamelMedium *) message, (CamelDataWrapper *) multi);
 	g_object_unref (multi);
 
-	success = camel_ews_utils_create_mime_message (cbews->priv->cnc, "SendOnly", NULL, message, NULL, from, NULL, NULL, NULL, cancellable, error);
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+
+	success = cnc && camel_ews_utils_create_mime_message (cnc, "SendOnly", NULL, message, NULL, from, NULL, NULL, NULL, cancellable, error);
+
+	g_clear_object (&cnc);
 
 	g_object_unref (message);
 	g_object_unref (vcal);
@@ -3240,18 +5465,23 @@ ecb_ews_receive_objects_no_exchange_mail (ECalBackendEws *cbews,
 					  GError **error)
 {
 	EwsCalendarConvertData convert_data = { 0 };
+	EEwsConnection *cnc;
 	EwsFolderId *fid;
 
-	convert_data.connection = cbews->priv->cnc;
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc)
+		return;
+
+	convert_data.connection = cnc;
 	convert_data.timezone_cache = E_TIMEZONE_CACHE (cbews);
 	convert_data.icomp = subcomp;
 	convert_data.vcalendar = vcalendar;
 	convert_data.default_zone = i_cal_timezone_get_utc_timezone ();
 
-	fid = e_ews_folder_id_new (cbews->priv->folder_id, NULL, FALSE);
+	fid = ecb_ews_new_folder_id (cbews);
 
 	e_ews_connection_create_items_sync (
-		cbews->priv->cnc,
+		cnc,
 		EWS_PRIORITY_MEDIUM,
 		"SaveOnly",
 		"SendToNone",
@@ -3263,6 +5493,7 @@ ecb_ews_receive_objects_no_exchange_mail (ECalBackendEws *cbews,
 		error);
 
 	e_ews_folder_id_free (fid);
+	g_object_unref (cnc);
 }
 
 static ICalProperty *
@@ -3509,6 +5740,7 @@ ecb_ews_do_method_request_publish_reply (ECalBackendEws *cbews,
 					 GCancellable *cancellable,
 					 GError **error)
 {
+	EEwsConnection *cnc;
 	GError *local_error = NULL;
 	gchar *item_id = NULL;
 	gchar *change_key = NULL;
@@ -3523,6 +5755,10 @@ ecb_ews_do_method_request_publish_reply (ECalBackendEws *cbews,
 		return FALSE;
 	}
 
+	cnc = ecb_ews_ref_connection_sync (cbews, error);
+	if (!cnc)
+		return FALSE;
+
 	if (response_type && *response_type)
 		ecb_ews_get_item_accept_id (comp, &item_id, &change_key, &mail_id);
 	else
@@ -3541,7 +5777,7 @@ ecb_ews_do_method_request_publish_reply (ECalBackendEws *cbews,
 			convert_data.change_key = change_key;
 
 			e_ews_connection_create_items_sync (
-				cbews->priv->cnc,
+				cnc,
 				EWS_PRIORITY_MEDIUM,
 				rsvp_requested ? "SendAndSaveCopy" : "SaveOnly",
 				rsvp_requested ? NULL : "SendToNone",
@@ -3566,7 +5802,7 @@ ecb_ews_do_method_request_publish_reply (ECalBackendEws *cbews,
 			my_ids = g_slist_append (my_ids, mail_id);
 
 			if (e_ews_connection_get_items_sync (
-				cbews->priv->cnc,
+				cnc,
 				EWS_PRIORITY_MEDIUM,
 				my_ids,
 				"AllProperties",
@@ -3647,7 +5883,7 @@ ecb_ews_do_method_request_publish_reply (ECalBackendEws *cbews,
 			convert_data.vcalendar = vcalendar;
 
 			e_ews_connection_update_items_sync (
-				cbews->priv->cnc,
+				cnc,
 				EWS_PRIORITY_MEDIUM,
 				"AlwaysOverwrite",
 				NULL,
@@ -3668,6 +5904,7 @@ ecb_ews_do_method_request_publish_reply (ECalBackendEws *cbews,
 	g_free (change_key);
 	g_free (mail_id);
 	g_slist_free_full (ids, g_object_unref);
+	g_object_unref (cnc);
 
 	return !local_error;
 }
@@ -3930,11 +6167,46 @@ ecb_ews_send_objects_sync (ECalBackendSync *sync_backend,
 		subcomp = i_cal_component_get_next_component (icomp, kind);
 	}
 
-	g_clear_object (&subcomp);
-	g_object_unref (icomp);
+	g_clear_object (&subcomp);
+	g_object_unref (icomp);
+
+	ecb_ews_convert_error_to_edc_error (error);
+	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
+}
+
+typedef struct _FreeBusyChunk {
+	GSList *users; /* const gchar *, borrowed from the users list */
+	guint n_users;
+	GSList *indexes; /* GUINT_TO_POINTER (index into the users list) */
+	GSList *freebusy; /* ICalComponent * */
+	GError *error;
+	gint *n_pending;
+} FreeBusyChunk;
+
+static void
+ecb_ews_free_busy_chunk_free (gpointer ptr)
+{
+	FreeBusyChunk *chunk = ptr;
+
+	if (chunk) {
+		g_slist_free (chunk->users);
+		g_slist_free (chunk->indexes);
+		g_slist_free_full (chunk->freebusy, g_object_unref);
+		g_clear_error (&chunk->error);
+		g_free (chunk);
+	}
+}
+
+static void
+ecb_ews_free_busy_chunk_done_cb (GObject *source_object,
+				 GAsyncResult *result,
+				 gpointer user_data)
+{
+	FreeBusyChunk *chunk = user_data;
 
-	ecb_ews_convert_error_to_edc_error (error);
-	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
+	e_ews_connection_get_free_busy_finish (E_EWS_CONNECTION (source_object), result, &chunk->freebusy, &chunk->error);
+
+	(*chunk->n_pending)--;
 }
 
 static void
@@ -3948,9 +6220,15 @@ ecb_ews_get_free_busy_sync (ECalBackendSync *sync_backend,
 			    GError **error)
 {
 	ECalBackendEws *cbews;
-	EEWSFreeBusyData fbdata = { 0 };
-	GSList *freebusy = NULL;
-	gboolean success;
+	EEwsConnection *cnc = NULL;
+	ICalComponent **icomps;
+	GMainContext *main_context;
+	GPtrArray *chunks;
+	FreeBusyChunk *chunk = NULL;
+	const GSList *ulink;
+	guint ii, n_users, n_succeeded = 0;
+	gint n_pending = 0;
+	GError *local_error = NULL;
 
 	g_return_if_fail (E_IS_CAL_BACKEND_EWS (sync_backend));
 	g_return_if_fail (freebusyobjs != NULL);
@@ -3959,33 +6237,127 @@ ecb_ews_get_free_busy_sync (ECalBackendSync *sync_backend,
 
 	*freebusyobjs = NULL;
 
-	if (!e_cal_meta_backend_ensure_connected_sync (E_CAL_META_BACKEND (cbews), cancellable, error))
-		return;
+	n_users = g_slist_length ((GSList *) users);
+	icomps = g_new0 (ICalComponent *, n_users + 1);
+	chunks = g_ptr_array_new_with_free_func (ecb_ews_free_busy_chunk_free);
+
+	/* Repeated lookups of the same users and time window are served locally;
+	   the rest is split into chunks the server can cope with. */
+	for (ulink = users, ii = 0; ulink; ulink = g_slist_next (ulink), ii++) {
+		const gchar *user = ulink->data;
+
+		if (!user)
+			continue;
+
+		icomps[ii] = ecb_ews_freebusy_cache_lookup (cbews, user, start, end);
+		if (icomps[ii])
+			continue;
+
+		if (!chunk || chunk->n_users >= EWS_MAX_FREEBUSY_USERS) {
+			if (chunk) {
+				chunk->users = g_slist_reverse (chunk->users);
+				chunk->indexes = g_slist_reverse (chunk->indexes);
+			}
+
+			chunk = g_new0 (FreeBusyChunk, 1);
+			chunk->n_pending = &n_pending;
+
+			g_ptr_array_add (chunks, chunk);
+		}
+
+		chunk->users = g_slist_prepend (chunk->users, (gpointer) user);
+		chunk->indexes = g_slist_prepend (chunk->indexes, GUINT_TO_POINTER (ii));
+		chunk->n_users++;
+	}
+
+	if (chunk) {
+		chunk->users = g_slist_reverse (chunk->users);
+		chunk->indexes = g_slist_reverse (chunk->indexes);
+	}
+
+	if (chunks->len > 0 &&
+	    (!e_cal_meta_backend_ensure_connected_sync (E_CAL_META_BACKEND (cbews), cancellable, error) ||
+	    !(cnc = ecb_ews_ref_connection_sync (cbews, error)))) {
+		for (ii = 0; ii < n_users; ii++) {
+			g_clear_object (&icomps[ii]);
+		}
+
+		g_free (icomps);
+		g_ptr_array_unref (chunks);
 
-	/* EWS can support only 100 identities, which is the maximum number of identities that the Web service method can request
-	 see http://msdn.microsoft.com / en - us / library / aa564001 % 28v = EXCHG.140 % 29.aspx */
-	if (g_slist_length ((GSList *) users) > 100) {
-		g_propagate_error (error, EC_ERROR (E_CLIENT_ERROR_SEARCH_SIZE_LIMIT_EXCEEDED));
 		return;
 	}
 
-	fbdata.period_start = start;
-	fbdata.period_end = end;
-	fbdata.user_mails = (GSList *) users;
+	main_context = g_main_context_new ();
+	g_main_context_push_thread_default (main_context);
 
-	success = e_ews_connection_get_free_busy_sync (cbews->priv->cnc, EWS_PRIORITY_MEDIUM,
-		e_ews_cal_utils_prepare_free_busy_request, &fbdata,
-		&freebusy, cancellable, error);
+	for (ii = 0; ii < chunks->len; ii++) {
+		EEWSFreeBusyData fbdata = { 0 };
 
-	if (success) {
-		GSList *fblink, *ulink;
+		chunk = g_ptr_array_index (chunks, ii);
+
+		while (n_pending >= EWS_MAX_FREEBUSY_PARALLEL)
+			g_main_context_iteration (main_context, TRUE);
+
+		fbdata.period_start = start;
+		fbdata.period_end = end;
+		fbdata.user_mails = chunk->users;
+
+		n_pending++;
+
+		/* The request is constructed immediately, thus the fbdata can be on the stack */
+		e_ews_connection_get_free_busy (cnc, EWS_PRIORITY_MEDIUM,
+			e_ews_cal_utils_prepare_free_busy_request, &fbdata,
+			cancellable, ecb_ews_free_busy_chunk_done_cb, chunk);
+	}
+
+	while (n_pending > 0)
+		g_main_context_iteration (main_context, TRUE);
 
-		for (fblink = freebusy, ulink = (GSList *) users;
-		     fblink && ulink;
-		     fblink = g_slist_next (fblink), ulink = g_slist_next (ulink)) {
+	g_main_context_pop_thread_default (main_context);
+	g_main_context_unref (main_context);
+	g_clear_object (&cnc);
+
+	for (ii = 0; ii < chunks->len; ii++) {
+		GSList *fblink, *ilink, *uilink;
+
+		chunk = g_ptr_array_index (chunks, ii);
+
+		if (chunk->error)
+			continue;
+
+		n_succeeded++;
+
+		for (fblink = chunk->freebusy, uilink = chunk->users, ilink = chunk->indexes;
+		     fblink && uilink && ilink;
+		     fblink = g_slist_next (fblink), uilink = g_slist_next (uilink), ilink = g_slist_next (ilink)) {
 			ICalComponent *icomp = fblink->data;
-			gchar *mailto;
 
+			ecb_ews_freebusy_cache_store (cbews, uilink->data, start, end, icomp);
+
+			icomps[GPOINTER_TO_UINT (ilink->data)] = g_object_ref (icomp);
+		}
+	}
+
+	/* Return what could be gathered, unless the operation was cancelled or nothing succeeded */
+	for (ii = 0; ii < chunks->len; ii++) {
+		chunk = g_ptr_array_index (chunks, ii);
+
+		if (chunk->error && (!n_succeeded || g_error_matches (chunk->error, G_IO_ERROR, G_IO_ERROR_CANCELLED))) {
+			local_error = chunk->error;
+			chunk->error = NULL;
+			break;
+		}
+	}
+
+	for (ulink = users, ii = 0; ulink && ii < n_users; ulink = g_slist_next (ulink), ii++) {
+		ICalComponent *icomp = icomps[ii];
+		gchar *mailto;
+
+		if (!icomp)
+			continue;
+
+		if (!local_error) {
 			/* add attendee property */
 			mailto = g_strconcat ("mailto:", ulink->data, NULL);
 			i_cal_component_take_property (icomp, i_cal_property_new_attendee (mailto));
@@ -3994,10 +6366,16 @@ ecb_ews_get_free_busy_sync (ECalBackendSync *sync_backend,
 			*freebusyobjs = g_slist_prepend (*freebusyobjs, i_cal_component_as_ical_string (icomp));
 		}
 
-		*freebusyobjs = g_slist_reverse (*freebusyobjs);
+		g_object_unref (icomp);
 	}
 
-	g_slist_free_full (freebusy, g_object_unref);
+	*freebusyobjs = g_slist_reverse (*freebusyobjs);
+
+	g_free (icomps);
+	g_ptr_array_unref (chunks);
+
+	if (local_error)
+		g_propagate_error (error, local_error);
 
 	ecb_ews_convert_error_to_edc_error (error);
 	ecb_ews_maybe_disconnect_sync (cbews, error, cancellable);
@@ -4052,6 +6430,369 @@ ecb_ews_get_backend_property (ECalBackend *cal_backend,
 	return E_CAL_BACKEND_CLASS (e_cal_backend_ews_parent_class)->impl_get_backend_property (cal_backend, prop_name);
 }
 
+/* Whether the 'expr' is a plain (func_name (make-time "...") (make-time "...") ["zone"]) */
+static gboolean
+ecb_ews_expr_is_plain_time_call (const gchar *expr,
+				 const gchar *func_name)
+{
+	const gchar *ptr;
+	gint n_functions = 0;
+
+	while (*expr && g_ascii_isspace (*expr))
+		expr++;
+
+	if (*expr != '(' || !g_str_has_prefix (expr + 1, func_name) || expr[strlen (func_name) + 1] != ' ')
+		return FALSE;
+
+	for (ptr = expr; *ptr; ptr++) {
+		if (*ptr == '(') {
+			n_functions++;
+		} else if (*ptr == '"') {
+			for (ptr++; *ptr && *ptr != '"'; ptr++) {
+				if (*ptr == '\\' && ptr[1])
+					ptr++;
+			}
+
+			if (!*ptr)
+				return FALSE;
+		}
+	}
+
+	/* The function itself and the two make-time */
+	return n_functions == 3;
+}
+
+static gboolean
+ecb_ews_expr_is_time_range_only (const gchar *expr)
+{
+	return ecb_ews_expr_is_plain_time_call (expr, "occur-in-time-range?");
+}
+
+/* The occur times do not describe the interval of the alarms, thus read it
+   from the plain (has-alarms-in-range? (make-time "...") (make-time "...")) */
+static gboolean
+ecb_ews_expr_get_alarms_range (const gchar *expr,
+			       time_t *out_start,
+			       time_t *out_end)
+{
+	const gchar *ptr;
+	time_t times[2];
+	gint ii;
+
+	if (!ecb_ews_expr_is_plain_time_call (expr, "has-alarms-in-range?"))
+		return FALSE;
+
+	for (ii = 0, ptr = expr; ii < 2; ii++) {
+		const gchar *value;
+		gchar *str;
+
+		ptr = strstr (ptr, "(make-time \"");
+		if (!ptr)
+			return FALSE;
+
+		value = ptr + 12;
+		ptr = strchr (value, '"');
+		if (!ptr)
+			return FALSE;
+
+		str = g_strndup (value, ptr - value);
+		times[ii] = time_from_isodate (str);
+		g_free (str);
+
+		if (times[ii] <= 0)
+			return FALSE;
+	}
+
+	if (times[1] <= times[0])
+		return FALSE;
+
+	*out_start = times[0];
+	*out_end = times[1];
+
+	return TRUE;
+}
+
+/* Searches the components matching the time-bound 'expr' with help of
+   the occurrence index, thus the recurring series are not expanded on each
+   query. Returns FALSE, when the 'expr' cannot be searched this way. */
+static gboolean
+ecb_ews_search_indexed_sync (ECalBackendEws *cbews,
+			     const gchar *expr,
+			     GSList **out_components, /* ECalComponent * */
+			     GCancellable *cancellable)
+{
+	ECalBackendSExp *sexp;
+	ECalCache *cal_cache;
+	ETimezoneCache *timezone_cache;
+	GSList *components = NULL, *link;
+	time_t start = 0, end = 0;
+	gboolean time_range_only, alarms_in_range;
+
+	if (!expr)
+		return FALSE;
+
+	sexp = e_cal_backend_sexp_new (expr);
+	if (!sexp)
+		return FALSE;
+
+	alarms_in_range = strstr (expr, "has-alarms-in-range?") != NULL;
+
+	if (!(alarms_in_range && ecb_ews_expr_get_alarms_range (expr, &start, &end)) &&
+	    (!e_cal_backend_sexp_evaluate_occur_times (sexp, &start, &end) || start <= 0 || end <= start)) {
+		g_object_unref (sexp);
+		return FALSE;
+	}
+
+	cal_cache = e_cal_meta_backend_ref_cache (E_CAL_META_BACKEND (cbews));
+
+	/* The alarms trigger around the occurrences, thus look for the occurrences,
+	   whose alarms can trigger in the interval; the match_comp decides then */
+	if (cal_cache && alarms_in_range) {
+		gint64 lead_before = 0, lead_after = 0;
+
+		if (!e_cal_backend_ews_occurrences_get_alarm_leads_sync (cal_cache, &lead_before, &lead_after, cancellable)) {
+			g_object_unref (cal_cache);
+			g_object_unref (sexp);
+			return FALSE;
+		}
+
+		start = (time_t) MAX ((gint64) start - lead_after, 1);
+		end = (time_t) ((gint64) end + lead_before);
+	}
+
+	if (!cal_cache || !e_cal_cache_get_components_in_range (cal_cache, start, end, &components, cancellable, NULL)) {
+		g_clear_object (&cal_cache);
+		g_object_unref (sexp);
+		return FALSE;
+	}
+
+	timezone_cache = E_TIMEZONE_CACHE (cbews);
+	time_range_only = ecb_ews_expr_is_time_range_only (expr);
+
+	*out_components = NULL;
+
+	for (link = components; link; link = g_slist_next (link)) {
+		ECalComponent *comp = link->data;
+		ECalBackendEwsOccurrencesResult occurrences = E_CAL_BACKEND_EWS_OCCURRENCES_UNKNOWN;
+
+		if (e_cal_component_has_recurrences (comp) && !e_cal_component_is_instance (comp))
+			occurrences = e_cal_backend_ews_occurrences_lookup_sync (cal_cache, timezone_cache, comp, start, end, cancellable);
+
+		if (occurrences == E_CAL_BACKEND_EWS_OCCURRENCES_NONE)
+			continue;
+
+		if ((occurrences == E_CAL_BACKEND_EWS_OCCURRENCES_SOME && time_range_only) ||
+		    e_cal_backend_sexp_match_comp (sexp, comp, timezone_cache))
+			*out_components = g_slist_prepend (*out_components, g_object_ref (comp));
+	}
+
+	*out_components = g_slist_reverse (*out_components);
+
+	g_slist_free_full (components, g_object_unref);
+	g_object_unref (cal_cache);
+	g_object_unref (sexp);
+
+	return TRUE;
+}
+
+static gboolean
+ecb_ews_search_sync (ECalMetaBackend *meta_backend,
+		     const gchar *expr,
+		     GSList **out_icalstrings,
+		     GCancellable *cancellable,
+		     GError **error)
+{
+	GSList *components = NULL, *link;
+
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
+	g_return_val_if_fail (out_icalstrings != NULL, FALSE);
+
+	if (!ecb_ews_search_indexed_sync (E_CAL_BACKEND_EWS (meta_backend), expr, &components, cancellable)) {
+		/* Chain up to parent's method. */
+		return E_CAL_META_BACKEND_CLASS (e_cal_backend_ews_parent_class)->search_sync (meta_backend, expr, out_icalstrings, cancellable, error);
+	}
+
+	*out_icalstrings = NULL;
+
+	for (link = components; link; link = g_slist_next (link)) {
+		*out_icalstrings = g_slist_prepend (*out_icalstrings, e_cal_component_get_as_string (link->data));
+	}
+
+	*out_icalstrings = g_slist_reverse (*out_icalstrings);
+
+	g_slist_free_full (components, g_object_unref);
+
+	return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+static gboolean
+ecb_ews_search_components_sync (ECalMetaBackend *meta_backend,
+				const gchar *expr,
+				GSList **out_components,
+				GCancellable *cancellable,
+				GError **error)
+{
+	g_return_val_if_fail (E_IS_CAL_BACKEND_EWS (meta_backend), FALSE);
+	g_return_val_if_fail (out_components != NULL, FALSE);
+
+	if (!ecb_ews_search_indexed_sync (E_CAL_BACKEND_EWS (meta_backend), expr, out_components, cancellable)) {
+		/* Chain up to parent's method. */
+		return E_CAL_META_BACKEND_CLASS (e_cal_backend_ews_parent_class)->search_components_sync (meta_backend, expr, out_components, cancellable, error);
+	}
+
+	return !g_cancellable_set_error_if_cancelled (cancellable, error);
+}
+
+static void
+ecb_ews_get_object_list_sync (ECalBackendSync *sync_backend,
+			      EDataCal *cal,
+			      GCancellable *cancellable,
+			      const gchar *sexp_str,
+			      GSList **out_objects,
+			      GError **error)
+{
+	ECalBackendEws *cbews;
+
+	g_return_if_fail (E_IS_CAL_BACKEND_EWS (sync_backend));
+
+	cbews = E_CAL_BACKEND_EWS (sync_backend);
+
+	if (sexp_str && ecb_ews_get_sync_window (cbews, NULL, NULL)) {
+		ECalBackendSExp *sexp;
+
+		sexp = e_cal_backend_sexp_new (sexp_str);
+
+		/* Failure to read the older events is not fatal, return what is in the cache */
+		if (sexp)
+			ecb_ews_sync_window_ensure_sexp_sync (cbews, sexp, cancellable, NULL);
+
+		g_clear_object (&sexp);
+	}
+
+	/* Chain up to parent's method. */
+	E_CAL_BACKEND_SYNC_CLASS (e_cal_backend_ews_parent_class)->get_object_list_sync (sync_backend, cal, cancellable, sexp_str, out_objects, error);
+}
+
+static void
+ecb_ews_create_objects_sync (ECalBackendSync *sync_backend,
+			     EDataCal *cal,
+			     GCancellable *cancellable,
+			     const GSList *calobjs,
+			     guint32 opflags,
+			     GSList **out_uids,
+			     GSList **out_new_components,
+			     GError **error)
+{
+	ECalBackendEws *cbews;
+	GSList *batched = NULL;
+
+	g_return_if_fail (E_IS_CAL_BACKEND_EWS (sync_backend));
+
+	cbews = E_CAL_BACKEND_EWS (sync_backend);
+
+	/* Create the items on the server in batches first; the parent's method
+	   then only picks the results in the ecb_ews_save_component_sync() */
+	if (calobjs && calobjs->next)
+		batched = ecb_ews_precreate_components_sync (cbews, calobjs, cancellable);
+
+	/* Chain up to parent's method. */
+	E_CAL_BACKEND_SYNC_CLASS (e_cal_backend_ews_parent_class)->create_objects_sync (sync_backend, cal, cancellable, calobjs, opflags, out_uids, out_new_components, error);
+
+	ecb_ews_batched_forget_sync (cbews, batched);
+
+	g_slist_free_full (batched, g_free);
+}
+
+static void
+ecb_ews_modify_objects_sync (ECalBackendSync *sync_backend,
+			     EDataCal *cal,
+			     GCancellable *cancellable,
+			     const GSList *calobjs,
+			     ECalObjModType mod,
+			     guint32 opflags,
+			     GSList **out_old_components,
+			     GSList **out_new_components,
+			     GError **error)
+{
+	ECalBackendEws *cbews;
+	GSList *batched = NULL;
+
+	g_return_if_fail (E_IS_CAL_BACKEND_EWS (sync_backend));
+
+	cbews = E_CAL_BACKEND_EWS (sync_backend);
+
+	/* The same as with the create, only non-recurring components are batched */
+	if (calobjs && calobjs->next)
+		batched = ecb_ews_premodify_components_sync (cbews, calobjs, cancellable);
+
+	/* Chain up to parent's method. */
+	E_CAL_BACKEND_SYNC_CLASS (e_cal_backend_ews_parent_class)->modify_objects_sync (sync_backend, cal, cancellable, calobjs, mod, opflags, out_old_components, out_new_components, error);
+
+	ecb_ews_batched_forget_sync (cbews, batched);
+
+	g_slist_free_full (batched, g_free);
+}
+
+static void
+ecb_ews_remove_objects_sync (ECalBackendSync *sync_backend,
+			     EDataCal *cal,
+			     GCancellable *cancellable,
+			     const GSList *ids,
+			     ECalObjModType mod,
+			     guint32 opflags,
+			     GSList **out_old_components,
+			     GSList **out_new_components,
+			     GError **error)
+{
+	ECalBackendEws *cbews;
+	GSList *batched = NULL;
+
+	g_return_if_fail (E_IS_CAL_BACKEND_EWS (sync_backend));
+
+	cbews = E_CAL_BACKEND_EWS (sync_backend);
+
+	if (ids && ids->next)
+		batched = ecb_ews_preremove_components_sync (cbews, ids, mod, cancellable);
+
+	/* Chain up to parent's method. */
+	E_CAL_BACKEND_SYNC_CLASS (e_cal_backend_ews_parent_class)->remove_objects_sync (sync_backend, cal, cancellable, ids, mod, opflags, out_old_components, out_new_components, error);
+
+	ecb_ews_batched_forget_sync (cbews, batched);
+
+	g_slist_free_full (batched, g_free);
+}
+
+static void
+ecb_ews_start_view_thread_func (ECalBackend *cal_backend,
+				gpointer user_data,
+				GCancellable *cancellable,
+				GError **error)
+{
+	ecb_ews_sync_window_ensure_sexp_sync (E_CAL_BACKEND_EWS (cal_backend), user_data, cancellable, error);
+}
+
+static void
+ecb_ews_start_view (ECalBackend *cal_backend,
+		    EDataCalView *view)
+{
+	ECalBackendEws *cbews;
+
+	g_return_if_fail (E_IS_CAL_BACKEND_EWS (cal_backend));
+
+	cbews = E_CAL_BACKEND_EWS (cal_backend);
+
+	/* Chain up to parent's method. */
+	E_CAL_BACKEND_CLASS (e_cal_backend_ews_parent_class)->impl_start_view (cal_backend, view);
+
+	/* The view is notified about the events read from the server
+	   through the cache, once they are downloaded */
+	if (ecb_ews_get_sync_window (cbews, NULL, NULL)) {
+		e_cal_backend_schedule_custom_operation (cal_backend, NULL,
+			ecb_ews_start_view_thread_func,
+			g_object_ref (e_data_cal_view_get_sexp (view)), g_object_unref);
+	}
+}
+
 static void
 ecb_ews_get_timezone_sync (ECalBackendSync *sync_backend,
 			   EDataCal *cal,
@@ -4157,6 +6898,13 @@ ecb_ews_constructed (GObject *object)
 	cache_dirname = g_path_get_dirname (e_cache_get_filename (E_CACHE (cal_cache)));
 	g_signal_connect (cal_cache, "dup-component-revision", G_CALLBACK (ecb_ews_dup_component_revision), NULL);
 
+	/* To have the change verification in the get_changes_sync() cheap; failure is not fatal */
+	e_cache_sqlite_exec (E_CACHE (cal_cache),
+		"CREATE INDEX IF NOT EXISTS " E_CAL_BACKEND_EWS_CACHE_ITEMID_INDEX " ON " E_CACHE_TABLE_OBJECTS
+		" (" E_CAL_BACKEND_EWS_CACHE_COLUMN_ITEMID ")", NULL, NULL);
+
+	e_cal_backend_ews_occurrences_init (cal_cache);
+
 	g_clear_object (&cal_cache);
 
 	cbews->priv->attachments_dir = g_build_filename (cache_dirname, "attachments", NULL);
@@ -4188,6 +6936,10 @@ ecb_ews_finalize (GObject *object)
 	g_free (cbews->priv->folder_id);
 	g_free (cbews->priv->attachments_dir);
 
+	g_hash_table_destroy (cbews->priv->freebusy_cache);
+	g_mutex_clear (&cbews->priv->freebusy_lock);
+	g_hash_table_destroy (cbews->priv->batched);
+	g_mutex_clear (&cbews->priv->batched_lock);
 	g_rec_mutex_clear (&cbews->priv->cnc_lock);
 
 	e_cal_backend_ews_unref_windows_zones ();
@@ -4202,6 +6954,10 @@ e_cal_backend_ews_init (ECalBackendEws *cbews)
 	cbews->priv = G_TYPE_INSTANCE_GET_PRIVATE (cbews, E_TYPE_CAL_BACKEND_EWS, ECalBackendEwsPrivate);
 
 	g_rec_mutex_init (&cbews->priv->cnc_lock);
+	g_mutex_init (&cbews->priv->freebusy_lock);
+	cbews->priv->freebusy_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ecb_ews_freebusy_entry_free);
+	g_mutex_init (&cbews->priv->batched_lock);
+	cbews->priv->batched = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, ecb_ews_batched_result_free);
 
 	e_cal_backend_ews_populate_windows_zones ();
 }
@@ -4224,6 +6980,8 @@ e_cal_backend_ews_class_init (ECalBackendEwsClass *klass)
 	cal_meta_backend_class->load_component_sync = ecb_ews_load_component_sync;
 	cal_meta_backend_class->save_component_sync = ecb_ews_save_component_sync;
 	cal_meta_backend_class->remove_component_sync = ecb_ews_remove_component_sync;
+	cal_meta_backend_class->search_sync = ecb_ews_search_sync;
+	cal_meta_backend_class->search_components_sync = ecb_ews_search_components_sync;
 
 	cal_backend_sync_class = E_CAL_BACKEND_SYNC_CLASS (klass);
 	cal_backend_sync_class->discard_alarm_sync = ecb_ews_discard_alarm_sync;
@@ -4231,9 +6989,14 @@ e_cal_backend_ews_class_init (ECalBackendEwsClass *klass)
 	cal_backend_sync_class->send_objects_sync = ecb_ews_send_objects_sync;
 	cal_backend_sync_class->get_free_busy_sync = ecb_ews_get_free_busy_sync;
 	cal_backend_sync_class->get_timezone_sync = ecb_ews_get_timezone_sync;
+	cal_backend_sync_class->get_object_list_sync = ecb_ews_get_object_list_sync;
+	cal_backend_sync_class->create_objects_sync = ecb_ews_create_objects_sync;
+	cal_backend_sync_class->modify_objects_sync = ecb_ews_modify_objects_sync;
+	cal_backend_sync_class->remove_objects_sync = ecb_ews_remove_objects_sync;
 
 	cal_backend_class = E_CAL_BACKEND_CLASS (klass);
 	cal_backend_class->impl_get_backend_property = ecb_ews_get_backend_property;
+	cal_backend_class->impl_start_view = ecb_ews_start_view;
 
 	backend_class = E_BACKEND_CLASS (klass);
 	backend_class->get_destination_address = ecb_ews_get_destination_address;
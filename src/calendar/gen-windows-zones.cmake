@@ -0,0 +1,71 @@
+# gen-windows-zones.cmake
+#
+# Generates a C header with two tables, MSDN to libical and libical to MSDN
+# time zone names, from the CLDR windowsZones.xml. The tables are sorted
+# by their key, to be searched with bsearch() and strcmp().
+#
+# The first occurrence of a key in the file wins, the same as it did when
+# the file had been read in the runtime.
+#
+# Usage: cmake -DINPUT=windowsZones.xml -DOUTPUT=header.h -P gen-windows-zones.cmake
+
+if(NOT INPUT OR NOT OUTPUT)
+	message(FATAL_ERROR "Both INPUT and OUTPUT need to be defined")
+endif(NOT INPUT OR NOT OUTPUT)
+
+file(STRINGS "${INPUT}" lines REGEX "<mapZone ")
+
+set(msdn_to_ical)
+set(ical_to_msdn)
+
+foreach(line IN LISTS lines)
+	string(REGEX MATCH "other=\"([^\"]*)\"" _unused "${line}")
+	set(msdn "${CMAKE_MATCH_1}")
+	string(REGEX MATCH "type=\"([^\"]*)\"" _unused "${line}")
+	set(icals "${CMAKE_MATCH_1}")
+
+	if(msdn STREQUAL "" OR icals STREQUAL "")
+		continue()
+	endif(msdn STREQUAL "" OR icals STREQUAL "")
+
+	string(REPLACE " " ";" icals "${icals}")
+
+	foreach(ical IN LISTS icals)
+		string(MD5 msdn_hash "${msdn}")
+		string(MD5 ical_hash "${ical}")
+
+		if(NOT DEFINED seen_msdn_${msdn_hash})
+			set(seen_msdn_${msdn_hash} 1)
+			list(APPEND msdn_to_ical "${msdn}\t${ical}")
+		endif(NOT DEFINED seen_msdn_${msdn_hash})
+
+		if(NOT DEFINED seen_ical_${ical_hash})
+			set(seen_ical_${ical_hash} 1)
+			list(APPEND ical_to_msdn "${ical}\t${msdn}")
+		endif(NOT DEFINED seen_ical_${ical_hash})
+	endforeach(ical)
+endforeach(line)
+
+# The tab sorts before any printable character, thus the order matches strcmp() on the keys
+list(SORT msdn_to_ical)
+list(SORT ical_to_msdn)
+
+set(content "/* Generated from windowsZones.xml by gen-windows-zones.cmake, do not edit */\n\n")
+
+foreach(table msdn_to_ical ical_to_msdn)
+	string(APPEND content "static const EwsTzMapping ews_tz_${table}[] = {\n")
+	foreach(pair IN LISTS ${table})
+		string(REPLACE "\t" "\", \"" pair "${pair}")
+		string(APPEND content "\t{ \"${pair}\" },\n")
+	endforeach(pair)
+	string(APPEND content "};\n\n")
+endforeach(table)
+
+# Write only when changed, to not rebuild needlessly
+if(EXISTS "${OUTPUT}")
+	file(READ "${OUTPUT}" old_content)
+endif(EXISTS "${OUTPUT}")
+
+if(NOT old_content STREQUAL content)
+	file(WRITE "${OUTPUT}" "${content}")
+endif(NOT old_content STREQUAL content)
@@ -0,0 +1,249 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "evolution-ews-config.h"
+
+#include <glib/gi18n-lib.h>
+
+#include "camel-ews-attachment-wrapper.h"
+
+#define CAMEL_EWS_ATTACHMENT_WRAPPER_GET_PRIVATE(obj) \
+	(G_TYPE_INSTANCE_GET_PRIVATE \
+	((obj), CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER, CamelEwsAttachmentWrapperPrivate))
+
+struct _CamelEwsAttachmentWrapperPrivate {
+	GMutex lock;
+	EEwsConnection *cnc;
+	gchar *attachment_id;
+	gboolean fetched;
+};
+
+G_DEFINE_TYPE (
+	CamelEwsAttachmentWrapper,
+	camel_ews_attachment_wrapper,
+	CAMEL_TYPE_DATA_WRAPPER)
+
+static void
+ews_attachment_wrapper_dispose (GObject *object)
+{
+	CamelEwsAttachmentWrapperPrivate *priv;
+
+	priv = CAMEL_EWS_ATTACHMENT_WRAPPER_GET_PRIVATE (object);
+
+	g_clear_object (&priv->cnc);
+
+	/* Chain up to parent's dispose() method. */
+	G_OBJECT_CLASS (camel_ews_attachment_wrapper_parent_class)->dispose (object);
+}
+
+static void
+ews_attachment_wrapper_finalize (GObject *object)
+{
+	CamelEwsAttachmentWrapperPrivate *priv;
+
+	priv = CAMEL_EWS_ATTACHMENT_WRAPPER_GET_PRIVATE (object);
+
+	g_free (priv->attachment_id);
+	g_mutex_clear (&priv->lock);
+
+	/* Chain up to parent's finalize() method. */
+	G_OBJECT_CLASS (camel_ews_attachment_wrapper_parent_class)->finalize (object);
+}
+
+static gboolean
+ews_attachment_wrapper_is_offline (CamelDataWrapper *data_wrapper)
+{
+	return !camel_ews_attachment_wrapper_get_fetched (CAMEL_EWS_ATTACHMENT_WRAPPER (data_wrapper));
+}
+
+static gssize
+ews_attachment_wrapper_write_to_stream_sync (CamelDataWrapper *data_wrapper,
+					     CamelStream *stream,
+					     GCancellable *cancellable,
+					     GError **error)
+{
+	if (!camel_ews_attachment_wrapper_fetch_sync (CAMEL_EWS_ATTACHMENT_WRAPPER (data_wrapper), cancellable, error))
+		return -1;
+
+	/* Chain up to parent's method. */
+	return CAMEL_DATA_WRAPPER_CLASS (camel_ews_attachment_wrapper_parent_class)->
+		write_to_stream_sync (data_wrapper, stream, cancellable, error);
+}
+
+static gssize
+ews_attachment_wrapper_decode_to_stream_sync (CamelDataWrapper *data_wrapper,
+					      CamelStream *stream,
+					      GCancellable *cancellable,
+					      GError **error)
+{
+	if (!camel_ews_attachment_wrapper_fetch_sync (CAMEL_EWS_ATTACHMENT_WRAPPER (data_wrapper), cancellable, error))
+		return -1;
+
+	/* Chain up to parent's method. */
+	return CAMEL_DATA_WRAPPER_CLASS (camel_ews_attachment_wrapper_parent_class)->
+		decode_to_stream_sync (data_wrapper, stream, cancellable, error);
+}
+
+static gssize
+ews_attachment_wrapper_write_to_output_stream_sync (CamelDataWrapper *data_wrapper,
+						    GOutputStream *output_stream,
+						    GCancellable *cancellable,
+						    GError **error)
+{
+	if (!camel_ews_attachment_wrapper_fetch_sync (CAMEL_EWS_ATTACHMENT_WRAPPER (data_wrapper), cancellable, error))
+		return -1;
+
+	/* Chain up to parent's method. */
+	return CAMEL_DATA_WRAPPER_CLASS (camel_ews_attachment_wrapper_parent_class)->
+		write_to_output_stream_sync (data_wrapper, output_stream, cancellable, error);
+}
+
+static gssize
+ews_attachment_wrapper_decode_to_output_stream_sync (CamelDataWrapper *data_wrapper,
+						     GOutputStream *output_stream,
+						     GCancellable *cancellable,
+						     GError **error)
+{
+	if (!camel_ews_attachment_wrapper_fetch_sync (CAMEL_EWS_ATTACHMENT_WRAPPER (data_wrapper), cancellable, error))
+		return -1;
+
+	/* Chain up to parent's method. */
+	return CAMEL_DATA_WRAPPER_CLASS (camel_ews_attachment_wrapper_parent_class)->
+		decode_to_output_stream_sync (data_wrapper, output_stream, cancellable, error);
+}
+
+static void
+camel_ews_attachment_wrapper_class_init (CamelEwsAttachmentWrapperClass *class)
+{
+	GObjectClass *object_class;
+	CamelDataWrapperClass *data_wrapper_class;
+
+	g_type_class_add_private (class, sizeof (CamelEwsAttachmentWrapperPrivate));
+
+	object_class = G_OBJECT_CLASS (class);
+	object_class->dispose = ews_attachment_wrapper_dispose;
+	object_class->finalize = ews_attachment_wrapper_finalize;
+
+	data_wrapper_class = CAMEL_DATA_WRAPPER_CLASS (class);
+	data_wrapper_class->is_offline = ews_attachment_wrapper_is_offline;
+	data_wrapper_class->write_to_stream_sync = ews_attachment_wrapper_write_to_stream_sync;
+	data_wrapper_class->decode_to_stream_sync = ews_attachment_wrapper_decode_to_stream_sync;
+	data_wrapper_class->write_to_output_stream_sync = ews_attachment_wrapper_write_to_output_stream_sync;
+	data_wrapper_class->decode_to_output_stream_sync = ews_attachment_wrapper_decode_to_output_stream_sync;
+}
+
+static void
+camel_ews_attachment_wrapper_init (CamelEwsAttachmentWrapper *wrapper)
+{
+	wrapper->priv = CAMEL_EWS_ATTACHMENT_WRAPPER_GET_PRIVATE (wrapper);
+
+	g_mutex_init (&wrapper->priv->lock);
+}
+
+CamelDataWrapper *
+camel_ews_attachment_wrapper_new (EEwsConnection *cnc,
+				  const gchar *attachment_id)
+{
+	CamelEwsAttachmentWrapper *wrapper;
+
+	g_return_val_if_fail (E_IS_EWS_CONNECTION (cnc), NULL);
+	g_return_val_if_fail (attachment_id != NULL, NULL);
+
+	wrapper = g_object_new (CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER, NULL);
+	wrapper->priv->cnc = g_object_ref (cnc);
+	wrapper->priv->attachment_id = g_strdup (attachment_id);
+
+	return CAMEL_DATA_WRAPPER (wrapper);
+}
+
+const gchar *
+camel_ews_attachment_wrapper_get_attachment_id (CamelEwsAttachmentWrapper *wrapper)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_ATTACHMENT_WRAPPER (wrapper), NULL);
+
+	return wrapper->priv->attachment_id;
+}
+
+gboolean
+camel_ews_attachment_wrapper_get_fetched (CamelEwsAttachmentWrapper *wrapper)
+{
+	gboolean fetched;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_ATTACHMENT_WRAPPER (wrapper), FALSE);
+
+	g_mutex_lock (&wrapper->priv->lock);
+	fetched = wrapper->priv->fetched;
+	g_mutex_unlock (&wrapper->priv->lock);
+
+	return fetched;
+}
+
+/* Downloads the content, unless it had been downloaded already */
+gboolean
+camel_ews_attachment_wrapper_fetch_sync (CamelEwsAttachmentWrapper *wrapper,
+					 GCancellable *cancellable,
+					 GError **error)
+{
+	CamelEwsAttachmentWrapperPrivate *priv;
+	GSList *ids, *attachments = NULL;
+	gboolean success;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_ATTACHMENT_WRAPPER (wrapper), FALSE);
+
+	priv = wrapper->priv;
+
+	g_mutex_lock (&priv->lock);
+
+	if (priv->fetched) {
+		g_mutex_unlock (&priv->lock);
+		return TRUE;
+	}
+
+	ids = g_slist_prepend (NULL, priv->attachment_id);
+
+	success = e_ews_connection_get_attachments_sync (priv->cnc, EWS_PRIORITY_MEDIUM, NULL, ids, NULL, FALSE, &attachments,
+		NULL, NULL, cancellable, error);
+
+	g_slist_free (ids);
+
+	if (success) {
+		EEwsAttachmentInfo *ainfo = attachments ? attachments->data : NULL;
+
+		if (ainfo && e_ews_attachment_info_get_type (ainfo) == E_EWS_ATTACHMENT_INFO_TYPE_INLINED) {
+			GByteArray *byte_array;
+			const gchar *content;
+			gsize content_len = 0;
+
+			byte_array = camel_data_wrapper_get_byte_array (CAMEL_DATA_WRAPPER (wrapper));
+			content = e_ews_attachment_info_get_inlined_data (ainfo, &content_len);
+			if (content && content_len)
+				g_byte_array_append (byte_array, (const guint8 *) content, content_len);
+
+			priv->fetched = TRUE;
+		} else {
+			g_set_error (
+				error, CAMEL_ERROR, CAMEL_ERROR_GENERIC,
+				_("Failed to download attachment “%s”"), priv->attachment_id);
+			success = FALSE;
+		}
+	}
+
+	g_slist_free_full (attachments, (GDestroyNotify) e_ews_attachment_info_free);
+
+	g_mutex_unlock (&priv->lock);
+
+	return success;
+}
@@ -0,0 +1,78 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CAMEL_EWS_ATTACHMENT_WRAPPER_H
+#define CAMEL_EWS_ATTACHMENT_WRAPPER_H
+
+#include <camel/camel.h>
+
+#include "server/e-ews-connection.h"
+
+/* Standard GObject macros */
+#define CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER \
+	(camel_ews_attachment_wrapper_get_type ())
+#define CAMEL_EWS_ATTACHMENT_WRAPPER(obj) \
+	(G_TYPE_CHECK_INSTANCE_CAST \
+	((obj), CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER, CamelEwsAttachmentWrapper))
+#define CAMEL_EWS_ATTACHMENT_WRAPPER_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_CAST \
+	((cls), CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER, CamelEwsAttachmentWrapperClass))
+#define CAMEL_IS_EWS_ATTACHMENT_WRAPPER(obj) \
+	(G_TYPE_CHECK_INSTANCE_TYPE \
+	((obj), CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER))
+#define CAMEL_IS_EWS_ATTACHMENT_WRAPPER_CLASS(cls) \
+	(G_TYPE_CHECK_CLASS_TYPE \
+	((cls), CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER))
+#define CAMEL_EWS_ATTACHMENT_WRAPPER_GET_CLASS(obj) \
+	(G_TYPE_INSTANCE_GET_CLASS \
+	((obj), CAMEL_TYPE_EWS_ATTACHMENT_WRAPPER, CamelEwsAttachmentWrapperClass))
+
+G_BEGIN_DECLS
+
+typedef struct _CamelEwsAttachmentWrapper CamelEwsAttachmentWrapper;
+typedef struct _CamelEwsAttachmentWrapperClass CamelEwsAttachmentWrapperClass;
+typedef struct _CamelEwsAttachmentWrapperPrivate CamelEwsAttachmentWrapperPrivate;
+
+/* Content of an attachment, which is downloaded with a GetAttachment
+   only when it is written or decoded for the first time */
+struct _CamelEwsAttachmentWrapper {
+	/*< private >*/
+	CamelDataWrapper parent;
+	CamelEwsAttachmentWrapperPrivate *priv;
+};
+
+struct _CamelEwsAttachmentWrapperClass {
+	CamelDataWrapperClass parent_class;
+};
+
+GType		camel_ews_attachment_wrapper_get_type
+						(void) G_GNUC_CONST;
+CamelDataWrapper *
+		camel_ews_attachment_wrapper_new
+						(EEwsConnection *cnc,
+						 const gchar *attachment_id);
+const gchar *	camel_ews_attachment_wrapper_get_attachment_id
+						(CamelEwsAttachmentWrapper *wrapper);
+gboolean	camel_ews_attachment_wrapper_get_fetched
+						(CamelEwsAttachmentWrapper *wrapper);
+gboolean	camel_ews_attachment_wrapper_fetch_sync
+						(CamelEwsAttachmentWrapper *wrapper,
+						 GCancellable *cancellable,
+						 GError **error);
+
+G_END_DECLS
+
+#endif /* CAMEL_EWS_ATTACHMENT_WRAPPER_H */
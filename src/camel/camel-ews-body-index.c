@@ -0,0 +1,854 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-ews-config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gi18n-lib.h>
+#include <glib/gstdio.h>
+
+#include "camel-ews-body-index.h"
+
+/* Write the changes into the file once this many bytes are waiting */
+#define MAX_PENDING_BYTES (64 * 1024)
+
+/* Rewrite the file only when there is at least this many removed
+   messages and more removed than indexed messages */
+#define MIN_REMOVED_TO_COMPACT 1000
+
+/* The file consists of lines, in the order of the changes:
+	+uid<TAB>term term term...
+	-uid
+   where the terms are lowercase runs of alphanumeric characters. */
+
+struct _CamelEwsBodyIndex {
+	GMutex lock;
+	gchar *filename;
+
+	GHashTable *docs;	/* const gchar *uid ~> GUINT_TO_POINTER (doc id + 1) */
+	GPtrArray *doc_uids;	/* doc id ~> const gchar *uid (camel_pstring), NULL when removed */
+	GPtrArray *doc_terms;	/* doc id ~> GArray { guint32 term id }, NULL when removed */
+	GHashTable *terms;	/* gchar *term ~> GUINT_TO_POINTER (term id + 1) */
+	GPtrArray *term_texts;	/* term id ~> const gchar *term, owned by the 'terms' */
+	GPtrArray *postings;	/* term id ~> GArray { guint32 doc id } */
+	guint n_removed;
+	gboolean needs_rewrite;
+
+	GString *pending;	/* lines not written into the file yet */
+	guint stamp;
+
+	/* The last search result */
+	gchar *last_query;
+	guint last_stamp;
+	GHashTable *last_matches;
+};
+
+static void
+body_index_split_terms (const gchar *text,
+			gsize length,
+			GHashTable *terms) /* gchar *term ~> NULL */
+{
+	GString *term;
+	const gchar *ptr, *end;
+
+	term = g_string_new ("");
+	end = text + length;
+
+	for (ptr = text; ptr < end; ) {
+		gunichar uc;
+
+		uc = g_utf8_get_char_validated (ptr, end - ptr);
+
+		if (uc == (gunichar) -1 || uc == (gunichar) -2) {
+			/* Invalid bytes separate the terms */
+			ptr++;
+			uc = 0;
+		} else {
+			ptr = g_utf8_next_char (ptr);
+		}
+
+		if (uc && g_unichar_isalnum (uc)) {
+			g_string_append_unichar (term, g_unichar_tolower (uc));
+		} else if (term->len) {
+			if (!g_hash_table_contains (terms, term->str))
+				g_hash_table_add (terms, g_strdup (term->str));
+
+			g_string_truncate (term, 0);
+		}
+	}
+
+	if (term->len && !g_hash_table_contains (terms, term->str))
+		g_hash_table_add (terms, g_strdup (term->str));
+
+	g_string_free (term, TRUE);
+}
+
+/* Returns NULL, when the @word is not a single term, thus the index
+   cannot tell which messages contain it */
+static gchar *
+body_index_normalize_word (const gchar *word)
+{
+	GString *normalized;
+	const gchar *ptr;
+
+	if (!word || !*word || !g_utf8_validate (word, -1, NULL))
+		return NULL;
+
+	normalized = g_string_new ("");
+
+	for (ptr = word; *ptr; ptr = g_utf8_next_char (ptr)) {
+		gunichar uc = g_utf8_get_char (ptr);
+
+		if (!g_unichar_isalnum (uc)) {
+			g_string_free (normalized, TRUE);
+			return NULL;
+		}
+
+		g_string_append_unichar (normalized, g_unichar_tolower (uc));
+	}
+
+	return g_string_free (normalized, FALSE);
+}
+
+static void
+body_index_write_doc (GString *str,
+		      CamelEwsBodyIndex *body_index,
+		      const gchar *uid,
+		      GArray *term_ids)
+{
+	guint ii;
+
+	g_string_append_c (str, '+');
+	g_string_append (str, uid);
+	g_string_append_c (str, '\t');
+
+	for (ii = 0; ii < term_ids->len; ii++) {
+		if (ii)
+			g_string_append_c (str, ' ');
+
+		g_string_append (str, g_ptr_array_index (body_index->term_texts, g_array_index (term_ids, guint32, ii)));
+	}
+
+	g_string_append_c (str, '\n');
+}
+
+static void
+body_index_remove_locked (CamelEwsBodyIndex *body_index,
+			  const gchar *uid,
+			  gboolean log)
+{
+	gpointer value = NULL;
+	guint doc_id;
+
+	if (!g_hash_table_lookup_extended (body_index->docs, uid, NULL, &value))
+		return;
+
+	doc_id = GPOINTER_TO_UINT (value) - 1;
+
+	if (log) {
+		g_string_append_c (body_index->pending, '-');
+		g_string_append (body_index->pending, uid);
+		g_string_append_c (body_index->pending, '\n');
+	}
+
+	/* The postings are cleaned on the file rewrite */
+	g_hash_table_remove (body_index->docs, uid);
+	camel_pstring_free (g_ptr_array_index (body_index->doc_uids, doc_id));
+	body_index->doc_uids->pdata[doc_id] = NULL;
+	g_array_free (g_ptr_array_index (body_index->doc_terms, doc_id), TRUE);
+	body_index->doc_terms->pdata[doc_id] = NULL;
+
+	body_index->n_removed++;
+}
+
+static void
+body_index_add_locked (CamelEwsBodyIndex *body_index,
+		       const gchar *uid,
+		       const GPtrArray *terms, /* gchar * */
+		       gboolean log)
+{
+	GArray *term_ids;
+	guint32 doc_id;
+	guint ii;
+
+	body_index_remove_locked (body_index, uid, FALSE);
+
+	doc_id = body_index->doc_uids->len;
+	term_ids = g_array_sized_new (FALSE, FALSE, sizeof (guint32), terms->len);
+
+	for (ii = 0; ii < terms->len; ii++) {
+		const gchar *term = g_ptr_array_index (terms, ii);
+		gpointer value;
+		guint32 term_id;
+
+		value = g_hash_table_lookup (body_index->terms, term);
+
+		if (value) {
+			term_id = GPOINTER_TO_UINT (value) - 1;
+		} else {
+			gchar *key = g_strdup (term);
+
+			term_id = body_index->term_texts->len;
+
+			g_hash_table_insert (body_index->terms, key, GUINT_TO_POINTER (term_id + 1));
+			g_ptr_array_add (body_index->term_texts, key);
+			g_ptr_array_add (body_index->postings, g_array_new (FALSE, FALSE, sizeof (guint32)));
+		}
+
+		g_array_append_val (term_ids, term_id);
+		g_array_append_val ((GArray *) g_ptr_array_index (body_index->postings, term_id), doc_id);
+	}
+
+	g_ptr_array_add (body_index->doc_uids, (gpointer) camel_pstring_strdup (uid));
+	g_ptr_array_add (body_index->doc_terms, term_ids);
+	g_hash_table_insert (body_index->docs, g_ptr_array_index (body_index->doc_uids, doc_id), GUINT_TO_POINTER (doc_id + 1));
+
+	if (log)
+		body_index_write_doc (body_index->pending, body_index, uid, term_ids);
+}
+
+static void
+body_index_load (CamelEwsBodyIndex *body_index)
+{
+	GPtrArray *terms;
+	gchar *contents = NULL, *line, *end;
+	gsize length = 0;
+
+	if (!g_file_get_contents (body_index->filename, &contents, &length, NULL))
+		return;
+
+	terms = g_ptr_array_new ();
+
+	for (line = contents; (end = memchr (line, '\n', contents + length - line)) != NULL; line = end + 1) {
+		*end = '\0';
+
+		if (*line == '+') {
+			gchar *ptr;
+
+			ptr = strchr (line, '\t');
+			if (!ptr) {
+				body_index->needs_rewrite = TRUE;
+				continue;
+			}
+
+			*ptr = '\0';
+			ptr++;
+
+			g_ptr_array_set_size (terms, 0);
+
+			while (*ptr) {
+				gchar *space;
+
+				g_ptr_array_add (terms, ptr);
+
+				space = strchr (ptr, ' ');
+				if (!space)
+					break;
+
+				*space = '\0';
+				ptr = space + 1;
+			}
+
+			body_index_add_locked (body_index, line + 1, terms, FALSE);
+		} else if (*line == '-') {
+			body_index_remove_locked (body_index, line + 1, FALSE);
+		} else if (*line) {
+			body_index->needs_rewrite = TRUE;
+		}
+	}
+
+	/* An incomplete last line, the next write would continue it */
+	if (line < contents + length)
+		body_index->needs_rewrite = TRUE;
+
+	g_ptr_array_unref (terms);
+	g_free (contents);
+}
+
+static gboolean
+body_index_write_pending_locked (CamelEwsBodyIndex *body_index,
+				 GError **error)
+{
+	FILE *file;
+	gboolean success;
+
+	if (!body_index->pending->len)
+		return TRUE;
+
+	file = g_fopen (body_index->filename, "ab");
+	if (!file) {
+		gint errn = errno;
+
+		g_set_error (
+			error, G_FILE_ERROR, g_file_error_from_errno (errn),
+			_("Failed to open file “%s”: %s"),
+			body_index->filename, g_strerror (errn));
+
+		return FALSE;
+	}
+
+	success = fwrite (body_index->pending->str, 1, body_index->pending->len, file) == body_index->pending->len;
+	success = fclose (file) == 0 && success;
+
+	if (!success) {
+		gint errn = errno;
+
+		g_set_error (
+			error, G_FILE_ERROR, g_file_error_from_errno (errn),
+			_("Failed to write file “%s”: %s"),
+			body_index->filename, g_strerror (errn));
+
+		/* Do not continue a partially written line */
+		body_index->needs_rewrite = TRUE;
+
+		return FALSE;
+	}
+
+	g_string_truncate (body_index->pending, 0);
+
+	return TRUE;
+}
+
+/* Rewrites the file with only the indexed messages and drops
+   the removed messages from the memory too */
+static gboolean
+body_index_compact_locked (CamelEwsBodyIndex *body_index,
+			   GError **error)
+{
+	GString *contents;
+	GArray *new_ids;
+	guint32 doc_id, new_id;
+	guint ii;
+
+	contents = g_string_sized_new (body_index->pending->len);
+
+	for (doc_id = 0; doc_id < body_index->doc_uids->len; doc_id++) {
+		const gchar *uid = g_ptr_array_index (body_index->doc_uids, doc_id);
+
+		if (uid)
+			body_index_write_doc (contents, body_index, uid, g_ptr_array_index (body_index->doc_terms, doc_id));
+	}
+
+	if (!g_file_set_contents (body_index->filename, contents->str, contents->len, error)) {
+		g_string_free (contents, TRUE);
+		return FALSE;
+	}
+
+	g_string_free (contents, TRUE);
+	g_string_truncate (body_index->pending, 0);
+	body_index->needs_rewrite = FALSE;
+
+	if (!body_index->n_removed)
+		return TRUE;
+
+	/* Renumber the messages, to not have holes */
+	new_ids = g_array_sized_new (FALSE, FALSE, sizeof (guint32), body_index->doc_uids->len);
+
+	for (doc_id = 0, new_id = 0; doc_id < body_index->doc_uids->len; doc_id++) {
+		const gchar *uid = g_ptr_array_index (body_index->doc_uids, doc_id);
+		guint32 id = G_MAXUINT32;
+
+		if (uid) {
+			id = new_id;
+			new_id++;
+
+			body_index->doc_uids->pdata[id] = (gpointer) uid;
+			body_index->doc_terms->pdata[id] = body_index->doc_terms->pdata[doc_id];
+
+			g_hash_table_insert (body_index->docs, (gpointer) uid, GUINT_TO_POINTER (id + 1));
+		}
+
+		g_array_append_val (new_ids, id);
+	}
+
+	g_ptr_array_set_size (body_index->doc_uids, new_id);
+	g_ptr_array_set_size (body_index->doc_terms, new_id);
+
+	for (ii = 0; ii < body_index->postings->len; ii++) {
+		GArray *posting = g_ptr_array_index (body_index->postings, ii);
+		guint from, to;
+
+		for (from = 0, to = 0; from < posting->len; from++) {
+			guint32 id = g_array_index (new_ids, guint32, g_array_index (posting, guint32, from));
+
+			if (id != G_MAXUINT32) {
+				g_array_index (posting, guint32, to) = id;
+				to++;
+			}
+		}
+
+		g_array_set_size (posting, to);
+	}
+
+	g_array_free (new_ids, TRUE);
+
+	body_index->n_removed = 0;
+
+	return TRUE;
+}
+
+static void
+body_index_gather_part_text (CamelMimePart *part,
+			     GString *text,
+			     GCancellable *cancellable)
+{
+	CamelDataWrapper *content;
+	CamelContentType *content_type;
+	CamelStream *mem, *stream;
+	const gchar *disposition, *charset;
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (part));
+	if (!content)
+		return;
+
+	if (CAMEL_IS_MULTIPART (content)) {
+		CamelMultipart *multipart = CAMEL_MULTIPART (content);
+		guint ii, n_parts;
+
+		n_parts = camel_multipart_get_number (multipart);
+
+		for (ii = 0; ii < n_parts; ii++) {
+			body_index_gather_part_text (camel_multipart_get_part (multipart, ii), text, cancellable);
+		}
+
+		return;
+	}
+
+	/* Only the message body, like the server does */
+	disposition = camel_mime_part_get_disposition (part);
+	if (disposition && g_ascii_strcasecmp (disposition, "attachment") == 0)
+		return;
+
+	content_type = camel_mime_part_get_content_type (part);
+	if (!content_type || !camel_content_type_is (content_type, "text", "*"))
+		return;
+
+	mem = camel_stream_mem_new ();
+	stream = g_object_ref (mem);
+
+	charset = camel_content_type_param (content_type, "charset");
+	if (charset && g_ascii_strcasecmp (charset, "utf-8") != 0 && g_ascii_strcasecmp (charset, "us-ascii") != 0) {
+		CamelMimeFilter *filter;
+
+		filter = camel_mime_filter_charset_new (charset, "UTF-8");
+		if (filter) {
+			g_object_unref (stream);
+			stream = camel_stream_filter_new (mem);
+			camel_stream_filter_add (CAMEL_STREAM_FILTER (stream), filter);
+			g_object_unref (filter);
+		}
+	}
+
+	if (camel_data_wrapper_decode_to_stream_sync (content, stream, cancellable, NULL) != -1 &&
+	    camel_stream_flush (stream, cancellable, NULL) != -1) {
+		GByteArray *bytes;
+
+		bytes = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (mem));
+		if (bytes && bytes->len) {
+			g_string_append_len (text, (const gchar *) bytes->data, bytes->len);
+			g_string_append_c (text, '\n');
+		}
+	}
+
+	g_object_unref (stream);
+	g_object_unref (mem);
+}
+
+static gint
+body_index_compare_strings (gconstpointer ptr1,
+			    gconstpointer ptr2)
+{
+	return g_strcmp0 (*((const gchar **) ptr1), *((const gchar **) ptr2));
+}
+
+CamelEwsBodyIndex *
+camel_ews_body_index_new (const gchar *filename)
+{
+	CamelEwsBodyIndex *body_index;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	body_index = g_new0 (CamelEwsBodyIndex, 1);
+	g_mutex_init (&body_index->lock);
+	body_index->filename = g_strdup (filename);
+	body_index->docs = g_hash_table_new (g_str_hash, g_str_equal);
+	body_index->doc_uids = g_ptr_array_new ();
+	body_index->doc_terms = g_ptr_array_new ();
+	body_index->terms = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	body_index->term_texts = g_ptr_array_new ();
+	body_index->postings = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+	body_index->pending = g_string_new ("");
+
+	body_index_load (body_index);
+
+	return body_index;
+}
+
+void
+camel_ews_body_index_free (CamelEwsBodyIndex *body_index)
+{
+	guint ii;
+
+	if (!body_index)
+		return;
+
+	for (ii = 0; ii < body_index->doc_uids->len; ii++) {
+		camel_pstring_free (g_ptr_array_index (body_index->doc_uids, ii));
+
+		if (g_ptr_array_index (body_index->doc_terms, ii))
+			g_array_free (g_ptr_array_index (body_index->doc_terms, ii), TRUE);
+	}
+
+	if (body_index->last_matches)
+		g_hash_table_unref (body_index->last_matches);
+
+	g_hash_table_destroy (body_index->docs);
+	g_ptr_array_unref (body_index->doc_uids);
+	g_ptr_array_unref (body_index->doc_terms);
+	g_ptr_array_unref (body_index->term_texts);
+	g_ptr_array_unref (body_index->postings);
+	g_hash_table_destroy (body_index->terms);
+	g_string_free (body_index->pending, TRUE);
+	g_mutex_clear (&body_index->lock);
+	g_free (body_index->last_query);
+	g_free (body_index->filename);
+	g_free (body_index);
+}
+
+/* Indexes the @text as the body of the message @uid,
+   replacing what had been indexed for it before */
+static void
+body_index_add_terms (CamelEwsBodyIndex *body_index,
+		      const gchar *uid,
+		      const GPtrArray *terms) /* gchar * */
+{
+	g_mutex_lock (&body_index->lock);
+
+	body_index_add_locked (body_index, uid, terms, TRUE);
+	body_index->stamp++;
+
+	/* Errors are not fatal, the message is searched on the server then */
+	if (body_index->pending->len >= MAX_PENDING_BYTES && !body_index->needs_rewrite)
+		body_index_write_pending_locked (body_index, NULL);
+
+	g_mutex_unlock (&body_index->lock);
+}
+
+void
+camel_ews_body_index_add_text (CamelEwsBodyIndex *body_index,
+			       const gchar *uid,
+			       const gchar *text)
+{
+	GHashTable *terms_hash;
+	GPtrArray *terms;
+	GHashTableIter iter;
+	gpointer key;
+
+	g_return_if_fail (body_index != NULL);
+	g_return_if_fail (uid != NULL);
+
+	terms_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	if (text)
+		body_index_split_terms (text, strlen (text), terms_hash);
+
+	terms = g_ptr_array_sized_new (g_hash_table_size (terms_hash));
+
+	g_hash_table_iter_init (&iter, terms_hash);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		g_ptr_array_add (terms, key);
+	}
+
+	body_index_add_terms (body_index, uid, terms);
+
+	g_ptr_array_unref (terms);
+	g_hash_table_destroy (terms_hash);
+}
+
+gboolean
+camel_ews_body_index_add_message (CamelEwsBodyIndex *body_index,
+				  const gchar *uid,
+				  CamelMimeMessage *message,
+				  GCancellable *cancellable,
+				  GError **error)
+{
+	GString *text;
+
+	g_return_val_if_fail (body_index != NULL, FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+	g_return_val_if_fail (CAMEL_IS_MIME_MESSAGE (message), FALSE);
+
+	text = g_string_new ("");
+
+	body_index_gather_part_text (CAMEL_MIME_PART (message), text, cancellable);
+
+	if (g_cancellable_set_error_if_cancelled (cancellable, error)) {
+		g_string_free (text, TRUE);
+		return FALSE;
+	}
+
+	camel_ews_body_index_add_text (body_index, uid, text->str);
+
+	g_string_free (text, TRUE);
+
+	return TRUE;
+}
+
+void
+camel_ews_body_index_remove (CamelEwsBodyIndex *body_index,
+			     const gchar *uid)
+{
+	g_return_if_fail (body_index != NULL);
+	g_return_if_fail (uid != NULL);
+
+	g_mutex_lock (&body_index->lock);
+
+	if (g_hash_table_contains (body_index->docs, uid)) {
+		body_index_remove_locked (body_index, uid, TRUE);
+		body_index->stamp++;
+	}
+
+	g_mutex_unlock (&body_index->lock);
+}
+
+/* Indexes the terms of the @uid in the @body_index under the @dest_uid
+   in the @dest_body_index, without parsing the message again. Both can
+   be the same index. Returns whether the @uid had been indexed. */
+gboolean
+camel_ews_body_index_transfer (CamelEwsBodyIndex *body_index,
+			       const gchar *uid,
+			       CamelEwsBodyIndex *dest_body_index,
+			       const gchar *dest_uid)
+{
+	GPtrArray *terms = NULL;
+	gpointer value;
+
+	g_return_val_if_fail (body_index != NULL, FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+	g_return_val_if_fail (dest_body_index != NULL, FALSE);
+	g_return_val_if_fail (dest_uid != NULL, FALSE);
+
+	g_mutex_lock (&body_index->lock);
+
+	value = g_hash_table_lookup (body_index->docs, uid);
+
+	if (value) {
+		GArray *term_ids;
+		guint ii;
+
+		term_ids = g_ptr_array_index (body_index->doc_terms, GPOINTER_TO_UINT (value) - 1);
+		terms = g_ptr_array_new_full (term_ids->len, g_free);
+
+		for (ii = 0; ii < term_ids->len; ii++) {
+			guint32 term_id = g_array_index (term_ids, guint32, ii);
+
+			g_ptr_array_add (terms, g_strdup (g_ptr_array_index (body_index->term_texts, term_id)));
+		}
+	}
+
+	g_mutex_unlock (&body_index->lock);
+
+	if (!terms)
+		return FALSE;
+
+	/* The source lock is not held here, thus a transfer
+	   within the same index does not deadlock */
+	body_index_add_terms (dest_body_index, dest_uid, terms);
+
+	g_ptr_array_unref (terms);
+
+	return TRUE;
+}
+
+gboolean
+camel_ews_body_index_contains (CamelEwsBodyIndex *body_index,
+			       const gchar *uid)
+{
+	gboolean contains;
+
+	g_return_val_if_fail (body_index != NULL, FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+
+	g_mutex_lock (&body_index->lock);
+	contains = g_hash_table_contains (body_index->docs, uid);
+	g_mutex_unlock (&body_index->lock);
+
+	return contains;
+}
+
+guint
+camel_ews_body_index_get_length (CamelEwsBodyIndex *body_index)
+{
+	guint length;
+
+	g_return_val_if_fail (body_index != NULL, 0);
+
+	g_mutex_lock (&body_index->lock);
+	length = g_hash_table_size (body_index->docs);
+	g_mutex_unlock (&body_index->lock);
+
+	return length;
+}
+
+/* Changes whenever a message is added or removed */
+guint
+camel_ews_body_index_get_stamp (CamelEwsBodyIndex *body_index)
+{
+	guint stamp;
+
+	g_return_val_if_fail (body_index != NULL, 0);
+
+	g_mutex_lock (&body_index->lock);
+	stamp = body_index->stamp;
+	g_mutex_unlock (&body_index->lock);
+
+	return stamp;
+}
+
+/* Returns a set of uids of the indexed messages, whose body contains all
+   the @words, case insensitively, or NULL when any of the @words is not
+   a single term. Free the returned hash table with g_hash_table_unref(). */
+GHashTable *
+camel_ews_body_index_search (CamelEwsBodyIndex *body_index,
+			     const GPtrArray *words) /* gchar * */
+{
+	GHashTable *matches;
+	GPtrArray *normalized;
+	GString *query;
+	guint8 *counts;
+	guint32 doc_id;
+	guint ii, jj, kk;
+
+	g_return_val_if_fail (body_index != NULL, NULL);
+	g_return_val_if_fail (words != NULL, NULL);
+
+	if (!words->len || words->len > G_MAXUINT8)
+		return NULL;
+
+	normalized = g_ptr_array_new_full (words->len, g_free);
+
+	for (ii = 0; ii < words->len; ii++) {
+		gchar *word = body_index_normalize_word (g_ptr_array_index (words, ii));
+
+		if (!word) {
+			g_ptr_array_unref (normalized);
+			return NULL;
+		}
+
+		g_ptr_array_add (normalized, word);
+	}
+
+	g_ptr_array_sort (normalized, body_index_compare_strings);
+
+	query = g_string_new ("");
+
+	for (ii = 0; ii < normalized->len; ii++) {
+		g_string_append (query, g_ptr_array_index (normalized, ii));
+		g_string_append_c (query, '\n');
+	}
+
+	g_mutex_lock (&body_index->lock);
+
+	/* The per-message evaluation asks for the same thing for each message */
+	if (body_index->last_matches && body_index->last_stamp == body_index->stamp &&
+	    g_strcmp0 (body_index->last_query, query->str) == 0) {
+		matches = g_hash_table_ref (body_index->last_matches);
+
+		g_mutex_unlock (&body_index->lock);
+
+		g_string_free (query, TRUE);
+		g_ptr_array_unref (normalized);
+
+		return matches;
+	}
+
+	/* How many of the words each message contains */
+	counts = g_new0 (guint8, body_index->doc_uids->len + 1);
+
+	for (ii = 0; ii < normalized->len; ii++) {
+		const gchar *word = g_ptr_array_index (normalized, ii);
+		gboolean any_found = FALSE;
+
+		for (jj = 0; jj < body_index->term_texts->len; jj++) {
+			GArray *posting;
+
+			if (!strstr (g_ptr_array_index (body_index->term_texts, jj), word))
+				continue;
+
+			posting = g_ptr_array_index (body_index->postings, jj);
+
+			for (kk = 0; kk < posting->len; kk++) {
+				doc_id = g_array_index (posting, guint32, kk);
+
+				if (counts[doc_id] == ii) {
+					counts[doc_id] = ii + 1;
+					any_found = TRUE;
+				}
+			}
+		}
+
+		/* No message contains all the words */
+		if (!any_found)
+			break;
+	}
+
+	matches = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+	for (doc_id = 0; doc_id < body_index->doc_uids->len; doc_id++) {
+		const gchar *uid = g_ptr_array_index (body_index->doc_uids, doc_id);
+
+		if (uid && counts[doc_id] == normalized->len)
+			g_hash_table_add (matches, (gpointer) camel_pstring_strdup (uid));
+	}
+
+	if (body_index->last_matches)
+		g_hash_table_unref (body_index->last_matches);
+	g_free (body_index->last_query);
+
+	body_index->last_matches = g_hash_table_ref (matches);
+	body_index->last_query = g_string_free (query, FALSE);
+	body_index->last_stamp = body_index->stamp;
+
+	g_mutex_unlock (&body_index->lock);
+
+	g_free (counts);
+	g_ptr_array_unref (normalized);
+
+	return matches;
+}
+
+gboolean
+camel_ews_body_index_save (CamelEwsBodyIndex *body_index,
+			   GError **error)
+{
+	gboolean success;
+
+	g_return_val_if_fail (body_index != NULL, FALSE);
+
+	g_mutex_lock (&body_index->lock);
+
+	if (body_index->needs_rewrite || (body_index->n_removed >= MIN_REMOVED_TO_COMPACT &&
+	    body_index->n_removed > g_hash_table_size (body_index->docs)))
+		success = body_index_compact_locked (body_index, error);
+	else
+		success = body_index_write_pending_locked (body_index, error);
+
+	g_mutex_unlock (&body_index->lock);
+
+	return success;
+}
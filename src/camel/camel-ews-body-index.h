@@ -0,0 +1,58 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAMEL_EWS_BODY_INDEX_H
+#define CAMEL_EWS_BODY_INDEX_H
+
+#include <camel/camel.h>
+
+G_BEGIN_DECLS
+
+/* An inverted index of the words in the bodies of the locally cached
+   messages. It answers body-contains searches for the indexed messages
+   without asking the server. Changes are appended to a file, which is
+   rewritten only when many of the indexed messages had been removed. */
+typedef struct _CamelEwsBodyIndex CamelEwsBodyIndex;
+
+CamelEwsBodyIndex *
+		camel_ews_body_index_new	(const gchar *filename);
+void		camel_ews_body_index_free	(CamelEwsBodyIndex *body_index);
+void		camel_ews_body_index_add_text	(CamelEwsBodyIndex *body_index,
+						 const gchar *uid,
+						 const gchar *text);
+gboolean	camel_ews_body_index_add_message
+						(CamelEwsBodyIndex *body_index,
+						 const gchar *uid,
+						 CamelMimeMessage *message,
+						 GCancellable *cancellable,
+						 GError **error);
+void		camel_ews_body_index_remove	(CamelEwsBodyIndex *body_index,
+						 const gchar *uid);
+gboolean	camel_ews_body_index_transfer	(CamelEwsBodyIndex *body_index,
+						 const gchar *uid,
+						 CamelEwsBodyIndex *dest_body_index,
+						 const gchar *dest_uid);
+gboolean	camel_ews_body_index_contains	(CamelEwsBodyIndex *body_index,
+						 const gchar *uid);
+guint		camel_ews_body_index_get_length	(CamelEwsBodyIndex *body_index);
+guint		camel_ews_body_index_get_stamp	(CamelEwsBodyIndex *body_index);
+GHashTable *	camel_ews_body_index_search	(CamelEwsBodyIndex *body_index,
+						 const GPtrArray *words); /* gchar * */
+gboolean	camel_ews_body_index_save	(CamelEwsBodyIndex *body_index,
+						 GError **error);
+
+G_END_DECLS
+
+#endif /* CAMEL_EWS_BODY_INDEX_H */
@@ -0,0 +1,672 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-ews-config.h"
+
+#include <errno.h>
+
+#include <glib/gstdio.h>
+
+#include "server/e-ews-item-change.h"
+#include "server/e-ews-message.h"
+
+#include "camel-ews-flag-queue.h"
+#include "camel-ews-utils.h"
+
+/* The same as the EWS_MAX_FETCH_COUNT of the folder */
+#define FLAG_QUEUE_MAX_ITEMS 100
+
+/* The flags, which have a representation on the server */
+#define FLAG_QUEUE_FLAGS (CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED | CAMEL_MESSAGE_ANSWERED | CAMEL_MESSAGE_FORWARDED)
+
+typedef struct _FlagEntry {
+	gchar *item_id;
+	gchar *change_key;
+	guint32 changed;
+	guint32 flags;
+	GSList *categories; /* gchar * */
+	gchar *followup;
+	gchar *completed_on;
+	gchar *due_by;
+	gchar *changes_key; /* equal for entries with equal changes */
+	guint64 index; /* order of the first addition */
+	guint stamp; /* changes with each update */
+} FlagEntry;
+
+struct _CamelEwsFlagQueue {
+	GMutex lock;
+	GMutex flush_lock;
+	gchar *filename;
+	GHashTable *entries; /* gchar *item_id ~> FlagEntry * */
+	guint64 next_index;
+	guint next_stamp;
+};
+
+static void
+flag_entry_free (gpointer ptr)
+{
+	FlagEntry *entry = ptr;
+
+	if (entry) {
+		g_free (entry->item_id);
+		g_free (entry->change_key);
+		g_slist_free_full (entry->categories, g_free);
+		g_free (entry->followup);
+		g_free (entry->completed_on);
+		g_free (entry->due_by);
+		g_free (entry->changes_key);
+		g_free (entry);
+	}
+}
+
+static FlagEntry *
+flag_entry_copy (const FlagEntry *src)
+{
+	FlagEntry *entry;
+	GSList *link;
+
+	entry = g_new0 (FlagEntry, 1);
+	entry->item_id = g_strdup (src->item_id);
+	entry->change_key = g_strdup (src->change_key);
+	entry->changed = src->changed;
+	entry->flags = src->flags;
+	entry->followup = g_strdup (src->followup);
+	entry->completed_on = g_strdup (src->completed_on);
+	entry->due_by = g_strdup (src->due_by);
+	entry->changes_key = g_strdup (src->changes_key);
+	entry->index = src->index;
+	entry->stamp = src->stamp;
+
+	for (link = src->categories; link; link = g_slist_next (link)) {
+		entry->categories = g_slist_prepend (entry->categories, g_strdup (link->data));
+	}
+
+	entry->categories = g_slist_reverse (entry->categories);
+
+	return entry;
+}
+
+static gchar *
+flag_entry_build_changes_key (const FlagEntry *entry)
+{
+	GString *key;
+	GSList *link;
+
+	key = g_string_new ("");
+
+	g_string_append_printf (key, "%u:%u", entry->changed, entry->flags);
+
+	for (link = entry->categories; link; link = g_slist_next (link)) {
+		g_string_append_c (key, '\n');
+		g_string_append (key, link->data);
+	}
+
+	/* The '\001' cannot be part of a category name */
+	g_string_append_printf (key, "\001%s\001%s\001%s",
+		entry->followup ? entry->followup : "",
+		entry->completed_on ? entry->completed_on : "",
+		entry->due_by ? entry->due_by : "");
+
+	return g_string_free (key, FALSE);
+}
+
+static gint
+flag_entry_compare_index (gconstpointer ptr1,
+			  gconstpointer ptr2)
+{
+	const FlagEntry *entry1 = *((const FlagEntry **) ptr1);
+	const FlagEntry *entry2 = *((const FlagEntry **) ptr2);
+
+	if (entry1->index == entry2->index)
+		return 0;
+
+	return entry1->index < entry2->index ? -1 : 1;
+}
+
+/* Call with the queue->lock held; adds copies of the entries */
+static GPtrArray *
+flag_queue_dup_entries_locked (CamelEwsFlagQueue *queue)
+{
+	GPtrArray *array;
+	GHashTableIter iter;
+	gpointer value;
+
+	array = g_ptr_array_new_full (g_hash_table_size (queue->entries), flag_entry_free);
+
+	g_hash_table_iter_init (&iter, queue->entries);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		g_ptr_array_add (array, flag_entry_copy (value));
+	}
+
+	g_ptr_array_sort (array, flag_entry_compare_index);
+
+	return array;
+}
+
+/* Call with the queue->lock held */
+static void
+flag_queue_take_entry_locked (CamelEwsFlagQueue *queue,
+			      FlagEntry *entry)
+{
+	FlagEntry *existing;
+
+	existing = g_hash_table_lookup (queue->entries, entry->item_id);
+
+	/* Merge with the previous changes of the same message, which
+	   means to keep its position and replace its state */
+	if (existing)
+		entry->index = existing->index;
+	else
+		entry->index = queue->next_index++;
+
+	entry->stamp = ++queue->next_stamp;
+	entry->changes_key = flag_entry_build_changes_key (entry);
+
+	g_hash_table_insert (queue->entries, entry->item_id, entry);
+}
+
+static void
+flag_queue_load (CamelEwsFlagQueue *queue)
+{
+	GKeyFile *key_file;
+	gchar **groups;
+	guint ii;
+
+	key_file = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (key_file, queue->filename, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free (key_file);
+		return;
+	}
+
+	groups = g_key_file_get_groups (key_file, NULL);
+
+	for (ii = 0; groups && groups[ii]; ii++) {
+		FlagEntry *entry;
+		gchar **categories;
+		guint jj;
+
+		entry = g_new0 (FlagEntry, 1);
+		entry->item_id = g_strdup (groups[ii]);
+		entry->change_key = g_key_file_get_string (key_file, groups[ii], "ChangeKey", NULL);
+		entry->changed = (guint32) g_key_file_get_uint64 (key_file, groups[ii], "Changed", NULL);
+		entry->flags = (guint32) g_key_file_get_uint64 (key_file, groups[ii], "Flags", NULL);
+		entry->followup = g_key_file_get_string (key_file, groups[ii], "FollowUp", NULL);
+		entry->completed_on = g_key_file_get_string (key_file, groups[ii], "CompletedOn", NULL);
+		entry->due_by = g_key_file_get_string (key_file, groups[ii], "DueBy", NULL);
+
+		categories = g_key_file_get_string_list (key_file, groups[ii], "Categories", NULL, NULL);
+
+		for (jj = 0; categories && categories[jj]; jj++) {
+			entry->categories = g_slist_prepend (entry->categories, g_strdup (categories[jj]));
+		}
+
+		entry->categories = g_slist_reverse (entry->categories);
+
+		g_strfreev (categories);
+
+		flag_queue_take_entry_locked (queue, entry);
+	}
+
+	g_strfreev (groups);
+	g_key_file_free (key_file);
+}
+
+CamelEwsFlagQueue *
+camel_ews_flag_queue_new (const gchar *filename)
+{
+	CamelEwsFlagQueue *queue;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	queue = g_new0 (CamelEwsFlagQueue, 1);
+	g_mutex_init (&queue->lock);
+	g_mutex_init (&queue->flush_lock);
+	queue->filename = g_strdup (filename);
+	queue->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, flag_entry_free);
+
+	flag_queue_load (queue);
+
+	return queue;
+}
+
+void
+camel_ews_flag_queue_free (CamelEwsFlagQueue *queue)
+{
+	if (!queue)
+		return;
+
+	g_hash_table_destroy (queue->entries);
+	g_mutex_clear (&queue->lock);
+	g_mutex_clear (&queue->flush_lock);
+	g_free (queue->filename);
+	g_free (queue);
+}
+
+/* Replaces any previous changes of the @item_id; the @changed_flags are
+   the flags, which differ from the server, the @flags hold their values,
+   the @categories are all the categories of the message */
+void
+camel_ews_flag_queue_add (CamelEwsFlagQueue *queue,
+			  const gchar *item_id,
+			  const gchar *change_key,
+			  guint32 changed_flags,
+			  guint32 flags,
+			  const GSList *categories, /* gchar * */
+			  const gchar *followup,
+			  const gchar *completed_on,
+			  const gchar *due_by)
+{
+	FlagEntry *entry;
+	const GSList *link;
+
+	g_return_if_fail (queue != NULL);
+	g_return_if_fail (item_id != NULL);
+
+	entry = g_new0 (FlagEntry, 1);
+	entry->item_id = g_strdup (item_id);
+	entry->change_key = g_strdup (change_key);
+	entry->changed = changed_flags & FLAG_QUEUE_FLAGS;
+	entry->flags = flags & FLAG_QUEUE_FLAGS;
+	entry->followup = (followup && *followup) ? g_strdup (followup) : NULL;
+	entry->completed_on = (completed_on && *completed_on) ? g_strdup (completed_on) : NULL;
+	entry->due_by = (due_by && *due_by) ? g_strdup (due_by) : NULL;
+
+	for (link = categories; link; link = g_slist_next (link)) {
+		if (link->data && *((const gchar *) link->data))
+			entry->categories = g_slist_prepend (entry->categories, g_strdup (link->data));
+	}
+
+	entry->categories = g_slist_reverse (entry->categories);
+
+	g_mutex_lock (&queue->lock);
+	flag_queue_take_entry_locked (queue, entry);
+	g_mutex_unlock (&queue->lock);
+}
+
+guint
+camel_ews_flag_queue_get_length (CamelEwsFlagQueue *queue)
+{
+	guint length;
+
+	g_return_val_if_fail (queue != NULL, 0);
+
+	g_mutex_lock (&queue->lock);
+	length = g_hash_table_size (queue->entries);
+	g_mutex_unlock (&queue->lock);
+
+	return length;
+}
+
+gboolean
+camel_ews_flag_queue_contains (CamelEwsFlagQueue *queue,
+			       const gchar *item_id)
+{
+	gboolean contains;
+
+	g_return_val_if_fail (queue != NULL, FALSE);
+	g_return_val_if_fail (item_id != NULL, FALSE);
+
+	g_mutex_lock (&queue->lock);
+	contains = g_hash_table_contains (queue->entries, item_id);
+	g_mutex_unlock (&queue->lock);
+
+	return contains;
+}
+
+gboolean
+camel_ews_flag_queue_save (CamelEwsFlagQueue *queue,
+			   GError **error)
+{
+	GKeyFile *key_file;
+	GPtrArray *entries;
+	gboolean success;
+	guint ii;
+
+	g_return_val_if_fail (queue != NULL, FALSE);
+
+	g_mutex_lock (&queue->lock);
+	entries = flag_queue_dup_entries_locked (queue);
+	g_mutex_unlock (&queue->lock);
+
+	if (!entries->len) {
+		g_ptr_array_unref (entries);
+
+		if (g_unlink (queue->filename) == -1 && errno != ENOENT) {
+			gint errn = errno;
+
+			g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errn),
+				"%s", g_strerror (errn));
+
+			return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	key_file = g_key_file_new ();
+
+	for (ii = 0; ii < entries->len; ii++) {
+		FlagEntry *entry = g_ptr_array_index (entries, ii);
+
+		if (entry->change_key)
+			g_key_file_set_string (key_file, entry->item_id, "ChangeKey", entry->change_key);
+		g_key_file_set_uint64 (key_file, entry->item_id, "Changed", entry->changed);
+		g_key_file_set_uint64 (key_file, entry->item_id, "Flags", entry->flags);
+
+		if (entry->categories) {
+			GPtrArray *strv;
+			GSList *link;
+
+			strv = g_ptr_array_new ();
+
+			for (link = entry->categories; link; link = g_slist_next (link)) {
+				g_ptr_array_add (strv, link->data);
+			}
+
+			g_key_file_set_string_list (key_file, entry->item_id, "Categories",
+				(const gchar * const *) strv->pdata, strv->len);
+
+			g_ptr_array_unref (strv);
+		}
+
+		if (entry->followup)
+			g_key_file_set_string (key_file, entry->item_id, "FollowUp", entry->followup);
+		if (entry->completed_on)
+			g_key_file_set_string (key_file, entry->item_id, "CompletedOn", entry->completed_on);
+		if (entry->due_by)
+			g_key_file_set_string (key_file, entry->item_id, "DueBy", entry->due_by);
+	}
+
+	success = g_key_file_save_to_file (key_file, queue->filename, error);
+
+	g_key_file_free (key_file);
+	g_ptr_array_unref (entries);
+
+	return success;
+}
+
+static gboolean
+flag_queue_write_changes_cb (ESoapMessage *msg,
+			     gpointer user_data,
+			     GError **error)
+{
+	GPtrArray *chunk = user_data; /* FlagEntry * */
+	guint ii;
+
+	for (ii = 0; ii < chunk->len; ii++) {
+		FlagEntry *entry = g_ptr_array_index (chunk, ii);
+
+		e_ews_message_start_item_change (
+			msg, E_EWS_ITEMCHANGE_TYPE_ITEM,
+			entry->item_id, entry->change_key, 0);
+
+		if ((entry->changed & CAMEL_MESSAGE_FLAGGED) != 0) {
+			e_soap_message_start_element (msg, "SetItemField", NULL, NULL);
+
+			e_soap_message_start_element (msg, "FieldURI", NULL, NULL);
+			e_soap_message_add_attribute (msg, "FieldURI", "item:Importance", NULL, NULL);
+			e_soap_message_end_element (msg);
+
+			e_soap_message_start_element (msg, "Message", NULL, NULL);
+			e_ews_message_write_string_parameter (msg, "Importance", NULL,
+				(entry->flags & CAMEL_MESSAGE_FLAGGED) != 0 ? "High" : "Normal");
+			e_soap_message_end_element (msg); /* Message */
+
+			e_soap_message_end_element (msg); /* SetItemField */
+		}
+
+		if ((entry->changed & CAMEL_MESSAGE_SEEN) != 0) {
+			e_soap_message_start_element (msg, "SetItemField", NULL, NULL);
+
+			e_soap_message_start_element (msg, "FieldURI", NULL, NULL);
+			e_soap_message_add_attribute (msg, "FieldURI", "message:IsRead", NULL, NULL);
+			e_soap_message_end_element (msg);
+
+			e_soap_message_start_element (msg, "Message", NULL, NULL);
+			e_ews_message_write_string_parameter (msg, "IsRead", NULL,
+				(entry->flags & CAMEL_MESSAGE_SEEN) != 0 ? "true" : "false");
+			e_soap_message_end_element (msg); /* Message */
+
+			e_soap_message_end_element (msg); /* SetItemField */
+		}
+
+		/* There is no better place for the forwarded/answered status than the icon */
+		if ((entry->changed & (CAMEL_MESSAGE_FORWARDED | CAMEL_MESSAGE_ANSWERED)) != 0) {
+			gint icon = (entry->flags & CAMEL_MESSAGE_SEEN) != 0 ? 0x100 : 0x101;
+
+			if ((entry->flags & CAMEL_MESSAGE_ANSWERED) != 0)
+				icon = 0x105;
+			if ((entry->flags & CAMEL_MESSAGE_FORWARDED) != 0)
+				icon = 0x106;
+
+			e_ews_message_add_set_item_field_extended_tag_int (msg, NULL, "Message", 0x1080, icon);
+		}
+
+		if (entry->categories) {
+			GSList *link;
+
+			e_soap_message_start_element (msg, "SetItemField", NULL, NULL);
+
+			e_soap_message_start_element (msg, "FieldURI", NULL, NULL);
+			e_soap_message_add_attribute (msg, "FieldURI", "item:Categories", NULL, NULL);
+			e_soap_message_end_element (msg);
+
+			e_soap_message_start_element (msg, "Message", NULL, NULL);
+			e_soap_message_start_element (msg, "Categories", NULL, NULL);
+
+			for (link = entry->categories; link; link = g_slist_next (link)) {
+				e_ews_message_write_string_parameter (msg, "String", NULL, link->data);
+			}
+
+			e_soap_message_end_element (msg); /* Categories */
+			e_soap_message_end_element (msg); /* Message */
+			e_soap_message_end_element (msg); /* SetItemField */
+		} else {
+			e_ews_message_add_delete_item_field (msg, "Categories", "item");
+		}
+
+		ews_utils_write_followup_flags (msg, entry->followup, entry->completed_on, entry->due_by);
+
+		e_ews_message_end_item_change (msg);
+	}
+
+	return TRUE;
+}
+
+/* Whether the changes should be tried again later, rather than dropped */
+static gboolean
+flag_queue_is_transient_error (const GError *error)
+{
+	if (!error)
+		return FALSE;
+
+	if (error->domain != EWS_CONNECTION_ERROR)
+		return TRUE;
+
+	return error->code == EWS_CONNECTION_ERROR_NORESPONSE ||
+		error->code == EWS_CONNECTION_ERROR_SERVERBUSY ||
+		error->code == EWS_CONNECTION_ERROR_UNAVAILABLE ||
+		error->code == EWS_CONNECTION_ERROR_AUTHENTICATION_FAILED ||
+		error->code == EWS_CONNECTION_ERROR_BATCHPROCESSINGSTOPPED;
+}
+
+/* Writes the @chunk of entries with equal changes in one UpdateItem request and
+   adds the written entries into the @done. When the server refuses the request
+   as a whole, each entry is tried alone, thus a single message the server does
+   not accept does not keep the others in the queue. */
+static gboolean
+flag_queue_write_chunk_sync (EEwsConnection *cnc,
+			     GPtrArray *chunk, /* FlagEntry * */
+			     GPtrArray *done, /* FlagEntry * */
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	GSList *items = NULL, *link;
+	GError *local_error = NULL;
+	guint ii;
+
+	if (e_ews_connection_update_items_sync (
+		cnc, EWS_PRIORITY_LOW,
+		"AlwaysOverwrite", "SaveOnly",
+		NULL, NULL,
+		flag_queue_write_changes_cb, chunk,
+		&items, cancellable, &local_error)) {
+		for (link = items, ii = 0; link && ii < chunk->len; link = g_slist_next (link), ii++) {
+			EEwsItem *item = link->data;
+
+			if (!item || e_ews_item_get_item_type (item) != E_EWS_ITEM_TYPE_ERROR ||
+			    !flag_queue_is_transient_error (e_ews_item_get_error (item)))
+				g_ptr_array_add (done, g_ptr_array_index (chunk, ii));
+		}
+
+		g_slist_free_full (items, g_object_unref);
+
+		return TRUE;
+	}
+
+	g_slist_free_full (items, g_object_unref);
+
+	if (flag_queue_is_transient_error (local_error)) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	g_clear_error (&local_error);
+
+	/* A single item error is reported as the request error */
+	if (chunk->len == 1) {
+		g_ptr_array_add (done, g_ptr_array_index (chunk, 0));
+		return TRUE;
+	}
+
+	for (ii = 0; ii < chunk->len; ii++) {
+		GPtrArray *single;
+		gboolean success;
+
+		single = g_ptr_array_sized_new (1);
+		g_ptr_array_add (single, g_ptr_array_index (chunk, ii));
+
+		success = flag_queue_write_chunk_sync (cnc, single, done, cancellable, error);
+
+		g_ptr_array_unref (single);
+
+		if (!success)
+			return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Writes all pending changes to the server with as few UpdateItem requests
+   as possible, one group of messages with equal changes after another.
+   Changes the server refused for a particular message are dropped, those
+   which failed due to a connection error are kept for the next flush. */
+gboolean
+camel_ews_flag_queue_flush_sync (CamelEwsFlagQueue *queue,
+				 EEwsConnection *cnc,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+	GPtrArray *entries, *groups, *done;
+	GHashTable *groups_hash;
+	gboolean success = TRUE;
+	guint ii, jj;
+
+	g_return_val_if_fail (queue != NULL, FALSE);
+	g_return_val_if_fail (E_IS_EWS_CONNECTION (cnc), FALSE);
+
+	g_mutex_lock (&queue->flush_lock);
+
+	g_mutex_lock (&queue->lock);
+	entries = flag_queue_dup_entries_locked (queue);
+	g_mutex_unlock (&queue->lock);
+
+	if (!entries->len) {
+		g_ptr_array_unref (entries);
+		g_mutex_unlock (&queue->flush_lock);
+
+		return TRUE;
+	}
+
+	/* Ordered by the first message of each group */
+	groups = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
+	groups_hash = g_hash_table_new (g_str_hash, g_str_equal);
+
+	for (ii = 0; ii < entries->len; ii++) {
+		FlagEntry *entry = g_ptr_array_index (entries, ii);
+		GPtrArray *group;
+
+		group = g_hash_table_lookup (groups_hash, entry->changes_key);
+
+		if (!group) {
+			group = g_ptr_array_new ();
+			g_hash_table_insert (groups_hash, entry->changes_key, group);
+			g_ptr_array_add (groups, group);
+		}
+
+		g_ptr_array_add (group, entry);
+	}
+
+	g_hash_table_destroy (groups_hash);
+
+	done = g_ptr_array_new ();
+
+	for (ii = 0; ii < groups->len && success; ii++) {
+		GPtrArray *group = g_ptr_array_index (groups, ii);
+
+		for (jj = 0; jj < group->len && success; jj += FLAG_QUEUE_MAX_ITEMS) {
+			GPtrArray *chunk;
+			guint kk;
+
+			chunk = g_ptr_array_sized_new (FLAG_QUEUE_MAX_ITEMS);
+
+			for (kk = jj; kk < group->len && kk < jj + FLAG_QUEUE_MAX_ITEMS; kk++) {
+				g_ptr_array_add (chunk, g_ptr_array_index (group, kk));
+			}
+
+			success = flag_queue_write_chunk_sync (cnc, chunk, done, cancellable, error);
+
+			g_ptr_array_unref (chunk);
+		}
+	}
+
+	g_mutex_lock (&queue->lock);
+
+	for (ii = 0; ii < done->len; ii++) {
+		FlagEntry *written = g_ptr_array_index (done, ii);
+		FlagEntry *entry;
+
+		entry = g_hash_table_lookup (queue->entries, written->item_id);
+
+		/* Changed meanwhile, thus write it the next time */
+		if (entry && entry->stamp == written->stamp)
+			g_hash_table_remove (queue->entries, written->item_id);
+	}
+
+	g_mutex_unlock (&queue->lock);
+
+	if (done->len)
+		camel_ews_flag_queue_save (queue, NULL);
+
+	g_ptr_array_unref (done);
+	g_ptr_array_unref (groups);
+	g_ptr_array_unref (entries);
+
+	g_mutex_unlock (&queue->flush_lock);
+
+	return success;
+}
@@ -0,0 +1,55 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAMEL_EWS_FLAG_QUEUE_H
+#define CAMEL_EWS_FLAG_QUEUE_H
+
+#include <camel/camel.h>
+
+#include "server/e-ews-connection.h"
+
+G_BEGIN_DECLS
+
+/* Flag and category changes of messages waiting to be written to the server,
+   keyed by the item id. Repeated changes of a message are merged into its last
+   state. Messages with the same changes share UpdateItem requests. The pending
+   changes are stored in a file, thus they survive a restart. */
+typedef struct _CamelEwsFlagQueue CamelEwsFlagQueue;
+
+CamelEwsFlagQueue *
+		camel_ews_flag_queue_new	(const gchar *filename);
+void		camel_ews_flag_queue_free	(CamelEwsFlagQueue *queue);
+void		camel_ews_flag_queue_add	(CamelEwsFlagQueue *queue,
+						 const gchar *item_id,
+						 const gchar *change_key,
+						 guint32 changed_flags,
+						 guint32 flags,
+						 const GSList *categories, /* gchar * */
+						 const gchar *followup,
+						 const gchar *completed_on,
+						 const gchar *due_by);
+guint		camel_ews_flag_queue_get_length	(CamelEwsFlagQueue *queue);
+gboolean	camel_ews_flag_queue_contains	(CamelEwsFlagQueue *queue,
+						 const gchar *item_id);
+gboolean	camel_ews_flag_queue_save	(CamelEwsFlagQueue *queue,
+						 GError **error);
+gboolean	camel_ews_flag_queue_flush_sync	(CamelEwsFlagQueue *queue,
+						 EEwsConnection *cnc,
+						 GCancellable *cancellable,
+						 GError **error);
+
+G_END_DECLS
+
+#endif /* CAMEL_EWS_FLAG_QUEUE_H */
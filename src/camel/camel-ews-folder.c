@@ -44,10 +44,14 @@ which needs to be better organized via functions */
 #include "server/camel-ews-settings.h"
 #include "server/e-ews-camel-common.h"
 #include "server/e-ews-connection.h"
+#include "server/e-ews-debug.h"
 #include "server/e-ews-item-change.h"
 #include "server/e-ews-message.h"
 
+#include "camel-ews-body-index.h"
+#include "camel-ews-flag-queue.h"
 #include "camel-ews-folder.h"
+#include "camel-ews-journal.h"
 #include "camel-ews-private.h"
 #include "camel-ews-search.h"
 #include "camel-ews-store.h"
@@ -73,6 +77,22 @@ which needs to be better organized via functions */
 
 #define SUMMARY_POSTITEM_PROPS ITEM_PROPS " " SUMMARY_ITEM_FLAGS " message:From message:Sender"
 
+/* What the SyncFolderItems can return; the recipients are read separately */
+#define SYNC_SUMMARY_PROPS ITEM_PROPS " message:From message:Sender message:References message:InternetMessageId " \
+		   SUMMARY_MESSAGE_FLAGS
+#define SUMMARY_RECIPIENT_PROPS "message:ToRecipients message:CcRecipients"
+
+/* Used for threading, when the server supports them */
+#define CONVERSATION_PROPS "item:ConversationId item:ConversationIndex"
+
+/* Shown in the message list; the Preview is known since Exchange 2013.
+   Neither can be read with the SyncFolderItems. */
+#define ATTACHMENT_PROPS "item:Attachments"
+#define PREVIEW_PROPS "item:Preview"
+
+/* Changes per SyncFolderItems, when it returns also the summary properties */
+#define EWS_MAX_SYNC_COUNT 500
+
 #define CAMEL_EWS_FOLDER_GET_PRIVATE(obj) \
 	(G_TYPE_INSTANCE_GET_PRIVATE \
 	((obj), CAMEL_TYPE_EWS_FOLDER, CamelEwsFolderPrivate))
@@ -87,15 +107,64 @@ struct _CamelEwsFolderPrivate {
 	GMutex state_lock;
 	GCond fetch_cond;
 	GHashTable *fetching_uids;
+
+	/* Flag changes waiting to be written to the server */
+	CamelEwsFlagQueue *flag_queue;
+	gboolean flags_flush_scheduled;
+
+	/* Operations done while offline */
+	CamelEwsJournal *journal;
+	GHashTable *replayed_uids; /* gchar *temp_uid ~> gchar *item_id; guarded by state_lock */
+
+	/* Words of the bodies of the cached messages */
+	CamelEwsBodyIndex *body_index;
 };
 
 static gboolean ews_delete_messages (CamelFolder *folder, const GSList *deleted_items, gboolean expunge, GCancellable *cancellable, GError **error);
+static void ews_delete_messages_from_folder (CamelFolder *folder, const GSList *deleted_items);
 static gboolean ews_refresh_info_sync (CamelFolder *folder, GCancellable *cancellable, GError **error);
 
 #define d(x)
 
 G_DEFINE_TYPE (CamelEwsFolder, camel_ews_folder, CAMEL_TYPE_OFFLINE_FOLDER)
 
+/* Adds the conversation properties to the @props, when the server knows them */
+static gchar *
+ews_folder_dup_summary_props (EEwsConnection *cnc,
+			      const gchar *props)
+{
+	if (e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2010))
+		return g_strconcat (props, " " CONVERSATION_PROPS, NULL);
+
+	return g_strdup (props);
+}
+
+static guint
+ews_folder_get_preview_length (CamelEwsFolder *ews_folder)
+{
+	CamelSettings *settings;
+	guint preview_length;
+
+	settings = camel_service_ref_settings (CAMEL_SERVICE (camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder))));
+	preview_length = camel_ews_settings_get_preview_length (CAMEL_EWS_SETTINGS (settings));
+	g_object_unref (settings);
+
+	return preview_length;
+}
+
+/* Adds the attachment and the preview properties to the @props */
+static gchar *
+ews_folder_dup_preview_props (CamelEwsFolder *ews_folder,
+			      EEwsConnection *cnc,
+			      const gchar *props)
+{
+	if (ews_folder_get_preview_length (ews_folder) &&
+	    e_ews_connection_satisfies_server_version (cnc, E_EWS_EXCHANGE_2013))
+		return g_strconcat (props, " " ATTACHMENT_PROPS " " PREVIEW_PROPS, NULL);
+
+	return g_strconcat (props, " " ATTACHMENT_PROPS, NULL);
+}
+
 static GSList *
 ews_folder_get_summary_followup_mapi_flags (void)
 {
@@ -173,12 +242,25 @@ ews_folder_get_summary_message_mapi_flags (void)
 	return list;
 }
 
+static CamelEwsMessageCache *
+ews_folder_get_message_cache (CamelEwsFolder *ews_folder)
+{
+	CamelStore *store;
+
+	store = camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder));
+	if (!store)
+		return NULL;
+
+	return camel_ews_store_get_message_cache (CAMEL_EWS_STORE (store));
+}
+
 static gchar *
 ews_get_filename (CamelFolder *folder,
                   const gchar *uid,
                   GError **error)
 {
 	CamelEwsFolder *ews_folder = CAMEL_EWS_FOLDER (folder);
+	CamelEwsMessageCache *message_cache;
 	GChecksum *sha = g_checksum_new (G_CHECKSUM_SHA256);
 	gchar *filename;
 
@@ -187,6 +269,21 @@ ews_get_filename (CamelFolder *folder,
 		ews_folder->cache, "cur", g_checksum_get_string (sha));
 	g_checksum_free (sha);
 
+	/* The caller reads the file directly, not through the ews_data_cache_get() */
+	message_cache = ews_folder_get_message_cache (ews_folder);
+	if (message_cache) {
+		g_rec_mutex_lock (&ews_folder->priv->cache_lock);
+
+		if (!camel_ews_message_cache_decompress_file (message_cache, filename, NULL, error)) {
+			g_free (filename);
+			filename = NULL;
+		}
+
+		g_rec_mutex_unlock (&ews_folder->priv->cache_lock);
+
+		camel_ews_message_cache_evict (message_cache);
+	}
+
 	return filename;
 }
 
@@ -244,7 +341,8 @@ ews_data_cache_get (CamelDataCache *cdc,
 	base_stream = camel_data_cache_get (
 		cdc, path, g_checksum_get_string (sha), error);
 	if (base_stream != NULL) {
-		stream = camel_stream_new (base_stream);
+		/* Large messages are stored compressed */
+		stream = camel_ews_message_cache_wrap_stream (base_stream, NULL, error);
 		g_object_unref (base_stream);
 	}
 	g_checksum_free (sha);
@@ -269,6 +367,43 @@ ews_data_cache_get_filename (CamelDataCache *cdc,
 	return filename;
 }
 
+/* Lets the message cache account the newly written message of the @uid */
+static void
+ews_folder_cache_add_file (CamelEwsFolder *ews_folder,
+			   const gchar *uid,
+			   gboolean keep)
+{
+	CamelEwsMessageCache *message_cache;
+	gchar *filename;
+
+	message_cache = ews_folder_get_message_cache (ews_folder);
+	if (!message_cache)
+		return;
+
+	filename = ews_data_cache_get_filename (ews_folder->cache, "cur", uid, NULL);
+
+	g_rec_mutex_lock (&ews_folder->priv->cache_lock);
+	camel_ews_message_cache_add_file (message_cache, filename, uid, keep);
+	g_rec_mutex_unlock (&ews_folder->priv->cache_lock);
+
+	/* Can remove messages of other folders, thus not under the cache_lock */
+	camel_ews_message_cache_evict (message_cache);
+
+	g_free (filename);
+}
+
+/* Removes the message evicted by the message cache, together with its body index */
+static void
+ews_folder_message_cache_evict_cb (GObject *owner,
+				   const gchar *uid)
+{
+	CamelEwsFolder *ews_folder = CAMEL_EWS_FOLDER (owner);
+
+	g_rec_mutex_lock (&ews_folder->priv->cache_lock);
+	camel_ews_folder_remove_cached_message (ews_folder, uid);
+	g_rec_mutex_unlock (&ews_folder->priv->cache_lock);
+}
+
 static CamelMimeMessage *
 camel_ews_folder_get_message_from_cache (CamelEwsFolder *ews_folder,
                                          const gchar *uid,
@@ -312,6 +447,19 @@ camel_ews_folder_get_message_from_cache (CamelEwsFolder *ews_folder,
 		msg = NULL;
 	}
 
+	if (msg) {
+		CamelEwsMessageCache *message_cache;
+
+		message_cache = ews_folder_get_message_cache (ews_folder);
+		if (message_cache) {
+			gchar *filename;
+
+			filename = ews_data_cache_get_filename (ews_folder->cache, "cur", uid, NULL);
+			camel_ews_message_cache_touch_file (message_cache, filename);
+			g_free (filename);
+		}
+	}
+
 	g_rec_mutex_unlock (&priv->cache_lock);
 	g_object_unref (stream);
 
@@ -697,10 +845,63 @@ ews_message_from_properties_sync (CamelEwsFolder *ews_folder,
 	return TRUE;
 }
 
+/* Reads only the Body and the description of the Attachments of a large
+   message; the attachments are downloaded when they are read. Returns NULL
+   without setting the 'error', when the message should be downloaded whole. */
+static CamelMimeMessage *
+ews_folder_get_partial_message_sync (CamelEwsFolder *ews_folder,
+				     EEwsConnection *cnc,
+				     gint pri,
+				     GSList *ids,
+				     GCancellable *cancellable,
+				     GError **error)
+{
+	CamelFolder *folder = CAMEL_FOLDER (ews_folder);
+	CamelSettings *settings;
+	CamelMessageInfo *mi;
+	CamelMimeMessage *message = NULL;
+	EEwsAdditionalProps *add_props;
+	GSList *items = NULL;
+	guint min_size;
+
+	settings = camel_service_ref_settings (CAMEL_SERVICE (camel_folder_get_parent_store (folder)));
+	min_size = camel_ews_settings_get_partial_fetch_min_size (CAMEL_EWS_SETTINGS (settings));
+	g_object_unref (settings);
+
+	if (!min_size)
+		return NULL;
+
+	mi = camel_folder_summary_get (camel_folder_get_folder_summary (folder), ids->data);
+	if (!mi)
+		return NULL;
+
+	if (camel_message_info_get_size (mi) < ((guint64) min_size) * 1024 ||
+	    camel_ews_message_info_get_item_type (CAMEL_EWS_MESSAGE_INFO (mi)) != E_EWS_ITEM_TYPE_MESSAGE) {
+		g_object_unref (mi);
+		return NULL;
+	}
+
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup (SUMMARY_MESSAGE_PROPS " item:Body item:Attachments");
+
+	if (e_ews_connection_get_items_sync (cnc, pri, ids, "IdOnly", add_props,
+		FALSE, NULL, E_EWS_BODY_TYPE_BEST, &items, NULL, NULL, cancellable, error) &&
+	    items && e_ews_item_get_item_type (items->data) != E_EWS_ITEM_TYPE_ERROR) {
+		message = camel_ews_utils_build_partial_message (cnc, items->data, camel_message_info_get_headers (mi));
+	}
+
+	e_ews_additional_props_free (add_props);
+	g_slist_free_full (items, g_object_unref);
+	g_object_unref (mi);
+
+	return message;
+}
+
 static CamelMimeMessage *
 camel_ews_folder_get_message (CamelFolder *folder,
                               const gchar *uid,
                               gint pri,
+                              gboolean allow_partial,
                               GCancellable *cancellable,
                               GError **error)
 {
@@ -776,6 +977,19 @@ camel_ews_folder_get_message (CamelFolder *folder,
 	cnc = camel_ews_store_ref_connection (ews_store);
 	ids = g_slist_append (ids, (gchar *) uid);
 
+	/* The partial message is not saved into the cache, the next
+	   read fetches the body again */
+	if (allow_partial) {
+		message = ews_folder_get_partial_message_sync (ews_folder, cnc, pri, ids, cancellable, &local_error);
+		if (message || local_error) {
+			if (local_error) {
+				camel_ews_store_maybe_disconnect (ews_store, local_error);
+				g_propagate_error (error, local_error);
+			}
+			goto exit;
+		}
+	}
+
 	mime_dir = g_build_filename (
 		camel_data_cache_get_path (ews_folder->cache),
 		"mimecontent", NULL);
@@ -999,6 +1213,11 @@ camel_ews_folder_get_message (CamelFolder *folder,
 			}
 			g_rec_mutex_unlock (&priv->cache_lock);
 		}
+
+		/* It can compress the file, thus only after the resave above */
+		ews_folder_cache_add_file (ews_folder, uid, FALSE);
+
+		camel_ews_body_index_add_message (priv->body_index, uid, message, cancellable, NULL);
 	}
 
 exit:
@@ -1066,6 +1285,38 @@ ews_folder_maybe_update_mlist (CamelFolder *folder,
 	g_clear_object (&mi);
 }
 
+/* Older servers do not provide the preview, thus derive it from the body,
+   once the message is read */
+static void
+ews_folder_maybe_update_preview (CamelFolder *folder,
+				 const gchar *uid,
+				 CamelMimeMessage *message,
+				 GCancellable *cancellable)
+{
+	CamelMessageInfo *mi;
+	guint preview_length;
+
+	g_return_if_fail (CAMEL_IS_EWS_FOLDER (folder));
+	g_return_if_fail (uid != NULL);
+	g_return_if_fail (message != NULL);
+
+	preview_length = ews_folder_get_preview_length (CAMEL_EWS_FOLDER (folder));
+	if (!preview_length)
+		return;
+
+	mi = camel_folder_summary_get (camel_folder_get_folder_summary (folder), uid);
+	if (!mi)
+		return;
+
+	if (CAMEL_IS_EWS_MESSAGE_INFO (mi) &&
+	    !camel_ews_message_info_get_preview (CAMEL_EWS_MESSAGE_INFO (mi))) {
+		camel_ews_message_info_take_preview (CAMEL_EWS_MESSAGE_INFO (mi),
+			camel_ews_utils_dup_message_preview (message, preview_length, cancellable));
+	}
+
+	g_clear_object (&mi);
+}
+
 static guint32
 ews_folder_get_permanent_flags (CamelFolder *folder)
 {
@@ -1089,13 +1340,37 @@ ews_folder_get_message_sync (CamelFolder *folder,
 
 	g_return_val_if_fail (CAMEL_IS_EWS_FOLDER (folder), NULL);
 
-	message = camel_ews_folder_get_message (folder, uid, EWS_ITEM_HIGH, cancellable, error);
-	if (message)
+	message = camel_ews_folder_get_message (folder, uid, EWS_ITEM_HIGH, TRUE, cancellable, error);
+	if (message) {
 		ews_folder_maybe_update_mlist (folder, uid, message);
+		ews_folder_maybe_update_preview (folder, uid, message, cancellable);
+	}
 
 	return message;
 }
 
+/* Messages are synchronized for the offline use, thus always whole */
+static gboolean
+ews_folder_synchronize_message_sync (CamelFolder *folder,
+				     const gchar *message_uid,
+				     GCancellable *cancellable,
+				     GError **error)
+{
+	CamelMimeMessage *message;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_FOLDER (folder), FALSE);
+
+	message = camel_ews_folder_get_message (folder, message_uid, EWS_ITEM_HIGH, FALSE, cancellable, error);
+	if (!message)
+		return FALSE;
+
+	ews_folder_maybe_update_preview (folder, message_uid, message, cancellable);
+
+	g_object_unref (message);
+
+	return TRUE;
+}
+
 static CamelMimeMessage *
 ews_folder_get_message_cached (CamelFolder *folder,
                                const gchar *message_uid,
@@ -1221,131 +1496,6 @@ ews_folder_search_free (CamelFolder *folder,
 
 /********************* folder functions*************************/
 
-static gboolean
-msg_update_flags (ESoapMessage *msg,
-                  gpointer user_data,
-		  GError **error)
-{
-	/* the mi_list is owned by the caller */
-	const GSList *mi_list = user_data, *iter;
-	CamelMessageInfo *mi;
-	CamelEwsMessageInfo *emi;
-
-	for (iter = mi_list; iter; iter = g_slist_next (iter)) {
-		CamelFolderSummary *summary;
-		guint32 flags_changed, mi_flags;
-		GSList *user_flags;
-
-		mi = iter->data;
-		emi = CAMEL_EWS_MESSAGE_INFO (mi);
-
-		if (!mi || !emi)
-			continue;
-
-		summary = camel_message_info_ref_summary (mi);
-		if (summary)
-			camel_folder_summary_lock (summary);
-		camel_message_info_property_lock (mi);
-
-		mi_flags = camel_message_info_get_flags (mi);
-		flags_changed = camel_ews_message_info_get_server_flags (emi) ^ mi_flags;
-
-		e_ews_message_start_item_change (
-			msg, E_EWS_ITEMCHANGE_TYPE_ITEM,
-			camel_message_info_get_uid (mi), camel_ews_message_info_get_change_key (emi), 0);
-		if (flags_changed & CAMEL_MESSAGE_FLAGGED) {
-			const gchar *flag;
-
-			if ((mi_flags & CAMEL_MESSAGE_FLAGGED) != 0)
-				flag = "High";
-			else
-				flag = "Normal";
-
-			e_soap_message_start_element (msg, "SetItemField", NULL, NULL);
-
-			e_soap_message_start_element (msg, "FieldURI", NULL, NULL);
-			e_soap_message_add_attribute (msg, "FieldURI", "item:Importance", NULL, NULL);
-			e_soap_message_end_element (msg);
-
-			e_soap_message_start_element (msg, "Message", NULL, NULL);
-
-			e_ews_message_write_string_parameter (msg, "Importance", NULL, flag);
-
-			e_soap_message_end_element (msg); /* Message */
-			e_soap_message_end_element (msg); /* SetItemField */
-		}
-
-		if (flags_changed & CAMEL_MESSAGE_SEEN) {
-			e_soap_message_start_element (msg, "SetItemField", NULL, NULL);
-
-			e_soap_message_start_element (msg, "FieldURI", NULL, NULL);
-			e_soap_message_add_attribute (msg, "FieldURI", "message:IsRead", NULL, NULL);
-			e_soap_message_end_element (msg);
-
-			e_soap_message_start_element (msg, "Message", NULL, NULL);
-			e_ews_message_write_string_parameter (msg, "IsRead", NULL,
-				(mi_flags & CAMEL_MESSAGE_SEEN) ? "true" : "false");
-
-			e_soap_message_end_element (msg); /* Message */
-			e_soap_message_end_element (msg); /* SetItemField */
-		}
-		/* Ick Ick Ick. Why in hell is there a field in the database for the Icon
-		 * *anyway*? Why isn't there a better place for forwarded/answered status? */
-		if (flags_changed & (CAMEL_MESSAGE_FORWARDED | CAMEL_MESSAGE_ANSWERED)) {
-			gint icon = (mi_flags & CAMEL_MESSAGE_SEEN) ? 0x100 : 0x101;
-
-			if (mi_flags & CAMEL_MESSAGE_ANSWERED)
-				icon = 0x105;
-			if (mi_flags & CAMEL_MESSAGE_FORWARDED)
-				icon = 0x106;
-
-			e_ews_message_add_set_item_field_extended_tag_int (msg, NULL, "Message", 0x1080, icon);
-		}
-
-		/* now update the Categories */
-		user_flags = ews_utils_gather_server_user_flags (msg, mi);
-		if (user_flags) {
-			GSList *link;
-
-			e_soap_message_start_element (msg, "SetItemField", NULL, NULL);
-
-			e_soap_message_start_element (msg, "FieldURI", NULL, NULL);
-			e_soap_message_add_attribute (msg, "FieldURI", "item:Categories", NULL, NULL);
-			e_soap_message_end_element (msg);
-
-			e_soap_message_start_element (msg, "Message", NULL, NULL);
-			e_soap_message_start_element (msg, "Categories", NULL, NULL);
-
-			for (link = user_flags; link; link = g_slist_next (link)) {
-				const gchar *user_flag = link->data;
-
-				e_ews_message_write_string_parameter (msg, "String", NULL, user_flag);
-			}
-
-			e_soap_message_end_element (msg); /* Categories */
-			e_soap_message_end_element (msg); /* Message */
-			e_soap_message_end_element (msg); /* SetItemField */
-		} else {
-			e_ews_message_add_delete_item_field (msg, "Categories", "item");
-		}
-
-		g_slist_free_full (user_flags, g_free);
-
-		ews_utils_update_followup_flags (msg, mi);
-
-		e_ews_message_end_item_change (msg);
-
-		camel_message_info_set_folder_flagged (mi, FALSE);
-
-		camel_message_info_property_unlock (mi);
-		if (summary)
-			camel_folder_summary_unlock (summary);
-		g_clear_object (&summary);
-	}
-
-	return TRUE;
-}
-
 static gboolean
 ews_suppress_read_receipt (ESoapMessage *msg,
 			   gpointer user_data,
@@ -1393,24 +1543,17 @@ ews_suppress_read_receipt (ESoapMessage *msg,
 }
 
 static gboolean
-ews_sync_mi_flags (CamelFolder *folder,
-                   const GSList *mi_list,
-                   GCancellable *cancellable,
-                   GError **error)
+ews_suppress_read_receipts_sync (CamelFolder *folder,
+				 const GSList *mi_list,
+				 GCancellable *cancellable,
+				 GError **error)
 {
 	CamelEwsStore *ews_store;
 	EEwsConnection *cnc;
 	const GSList *iter;
+	GSList *ids = NULL;
 	GError *local_error = NULL;
-	gboolean res = TRUE;
-
-	ews_store = (CamelEwsStore *) camel_folder_get_parent_store (folder);
-
-	if (!camel_ews_store_connected (ews_store, cancellable, error)) {
-		return FALSE;
-	}
-
-	cnc = camel_ews_store_ref_connection (ews_store);
+	gboolean res;
 
 	for (iter = mi_list; iter; iter = g_slist_next (iter)) {
 		CamelMessageInfo *mi = iter->data;
@@ -1420,34 +1563,33 @@ ews_sync_mi_flags (CamelFolder *folder,
 	}
 
 	/* NULL means all had been checked and none has the flag set */
-	if (iter) {
-		GSList *ids = NULL;
+	if (!iter)
+		return TRUE;
 
-		res = e_ews_connection_create_items_sync (
-			cnc, EWS_PRIORITY_LOW,
-			"SaveOnly", NULL, NULL,
-			ews_suppress_read_receipt, (gpointer) mi_list,
-			&ids, cancellable, &local_error);
+	ews_store = (CamelEwsStore *) camel_folder_get_parent_store (folder);
 
-		g_slist_free_full (ids, g_object_unref);
+	/* Keep the flag set, to suppress it when back online */
+	if (!camel_offline_store_get_online (CAMEL_OFFLINE_STORE (ews_store)))
+		return TRUE;
 
-		/* ignore this error, it's not a big problem */
-		if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_READRECEIPTNOTPENDING)) {
-			g_clear_error (&local_error);
-			res = TRUE;
-		}
-	}
+	if (!camel_ews_store_connected (ews_store, cancellable, error))
+		return FALSE;
 
-	if (res) {
-		res = e_ews_connection_update_items_sync (
-			cnc, EWS_PRIORITY_LOW,
-			"AlwaysOverwrite", "SaveOnly",
-			NULL, NULL,
-			msg_update_flags, (gpointer) mi_list, NULL,
-			cancellable, &local_error);
-	}
+	cnc = camel_ews_store_ref_connection (ews_store);
+
+	res = e_ews_connection_create_items_sync (
+		cnc, EWS_PRIORITY_LOW,
+		"SaveOnly", NULL, NULL,
+		ews_suppress_read_receipt, (gpointer) mi_list,
+		&ids, cancellable, &local_error);
+
+	g_slist_free_full (ids, g_object_unref);
 
-	camel_folder_summary_save (camel_folder_get_folder_summary (folder), NULL);
+	/* ignore this error, it's not a big problem */
+	if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_READRECEIPTNOTPENDING)) {
+		g_clear_error (&local_error);
+		res = TRUE;
+	}
 
 	if (local_error) {
 		camel_ews_store_maybe_disconnect (ews_store, local_error);
@@ -1459,18 +1601,36 @@ ews_sync_mi_flags (CamelFolder *folder,
 	return res;
 }
 
+/* Writes the queued flag changes of the folder to the server */
 static gboolean
-ews_save_flags (CamelFolder *folder,
-		const GSList *mi_list,
-		GCancellable *cancellable,
-		GError **error)
+ews_folder_flush_flags_sync (CamelEwsFolder *ews_folder,
+			     GCancellable *cancellable,
+			     GError **error)
 {
-	gboolean ret;
+	CamelEwsStore *ews_store;
+	EEwsConnection *cnc;
 	GError *local_error = NULL;
+	gboolean res;
+
+	if (!camel_ews_flag_queue_get_length (ews_folder->priv->flag_queue))
+		return TRUE;
 
-	ret = ews_sync_mi_flags (folder, mi_list, cancellable, &local_error);
+	ews_store = (CamelEwsStore *) camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder));
+
+	/* Kept in the queue until the store is online again */
+	if (!camel_offline_store_get_online (CAMEL_OFFLINE_STORE (ews_store)))
+		return TRUE;
+
+	if (!camel_ews_store_connected (ews_store, cancellable, error))
+		return FALSE;
+
+	cnc = camel_ews_store_ref_connection (ews_store);
+
+	res = camel_ews_flag_queue_flush_sync (ews_folder->priv->flag_queue, cnc, cancellable, &local_error);
+
+	if (local_error) {
+		camel_ews_store_maybe_disconnect (ews_store, local_error);
 
-	if (local_error != NULL) {
 		if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_ACCESSDENIED)) {
 			/*
 			 * If cannot save flags, then it can be a public
@@ -1478,25 +1638,389 @@ ews_save_flags (CamelFolder *folder,
 			 * the flags will be saved locally, at least
 			 */
 			g_clear_error (&local_error);
-			ret = TRUE;
+			res = TRUE;
 		} else {
 			g_propagate_error (error, local_error);
 		}
 	}
 
-	return ret;
+	g_object_unref (cnc);
+
+	return res;
 }
 
-static gboolean
-ews_folder_is_of_type (CamelFolder *folder,
-                       guint32 folder_type)
+static void
+ews_folder_debug_flush_error (CamelEwsFolder *ews_folder,
+			      const GError *error)
 {
-	CamelStore *parent_store;
-	CamelEwsStore *ews_store;
-	gboolean is_of_type;
-	gchar *folder_id;
-
-	g_return_val_if_fail (folder != NULL, FALSE);
+	if (e_ews_debug_get_log_level () >= 1 && error &&
+	    !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		printf ("EWS: Failed to write flags of folder '%s': %s\n",
+			camel_folder_get_full_name (CAMEL_FOLDER (ews_folder)), error->message);
+		fflush (stdout);
+	}
+}
+
+static void
+ews_folder_flush_flags_thread (CamelSession *session,
+			       GCancellable *cancellable,
+			       gpointer user_data,
+			       GError **error)
+{
+	CamelEwsFolder *ews_folder = user_data;
+	GError *local_error = NULL;
+
+	g_mutex_lock (&ews_folder->priv->state_lock);
+	ews_folder->priv->flags_flush_scheduled = FALSE;
+	g_mutex_unlock (&ews_folder->priv->state_lock);
+
+	/* The changes are kept in the queue and written the next time,
+	   thus do not bother the user with an alert */
+	if (!ews_folder_flush_flags_sync (ews_folder, cancellable, &local_error))
+		ews_folder_debug_flush_error (ews_folder, local_error);
+
+	g_clear_error (&local_error);
+}
+
+static void
+ews_folder_schedule_flags_flush (CamelEwsFolder *ews_folder)
+{
+	CamelService *service;
+	CamelSession *session;
+
+	g_mutex_lock (&ews_folder->priv->state_lock);
+
+	if (ews_folder->priv->flags_flush_scheduled) {
+		g_mutex_unlock (&ews_folder->priv->state_lock);
+		return;
+	}
+
+	service = CAMEL_SERVICE (camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder)));
+	session = camel_service_ref_session (service);
+
+	if (session) {
+		ews_folder->priv->flags_flush_scheduled = TRUE;
+
+		camel_session_submit_job (
+			session, _("Saving message flags"),
+			ews_folder_flush_flags_thread,
+			g_object_ref (ews_folder),
+			g_object_unref);
+
+		g_object_unref (session);
+	}
+
+	g_mutex_unlock (&ews_folder->priv->state_lock);
+}
+
+static void
+ews_folder_journal_uid_changed_cb (const gchar *temp_uid,
+				   const gchar *item_id,
+				   const gchar *change_key,
+				   const GError *error,
+				   gpointer user_data)
+{
+	CamelEwsFolder *ews_folder = user_data;
+	CamelFolder *folder = CAMEL_FOLDER (ews_folder);
+	CamelFolderSummary *folder_summary;
+	CamelFolderChangeInfo *changes;
+	CamelMessageInfo *mi;
+
+	folder_summary = camel_folder_get_folder_summary (folder);
+	mi = camel_folder_summary_get (folder_summary, temp_uid);
+
+	/* The server refused the message; it stays in the folder under its
+	   temporary uid, thus it is not lost, and the user is told about it */
+	if (!item_id) {
+		CamelService *service;
+		CamelSession *session;
+
+		service = CAMEL_SERVICE (camel_folder_get_parent_store (folder));
+		session = camel_service_ref_session (service);
+
+		if (session) {
+			const gchar *subject = mi ? camel_message_info_get_subject (mi) : NULL;
+			gchar *msg;
+
+			msg = g_strdup_printf (_("Cannot store message “%s”, written while offline, in folder “%s”: %s"),
+				subject ? subject : temp_uid,
+				camel_folder_get_display_name (folder),
+				error ? error->message : _("Unknown error"));
+
+			camel_session_user_alert (session, service, CAMEL_SESSION_ALERT_WARNING, msg);
+
+			g_object_unref (session);
+			g_free (msg);
+		}
+
+		g_clear_object (&mi);
+
+		return;
+	}
+
+	/* For the callers still holding the temporary uid */
+	g_mutex_lock (&ews_folder->priv->state_lock);
+	g_hash_table_insert (ews_folder->priv->replayed_uids, g_strdup (temp_uid), g_strdup (item_id));
+	g_mutex_unlock (&ews_folder->priv->state_lock);
+
+	changes = camel_folder_change_info_new ();
+
+	/* Re-add the message under its server uid */
+	if (mi && item_id) {
+		CamelMimeMessage *message;
+
+		message = camel_ews_folder_get_message_from_cache (ews_folder, temp_uid, NULL, NULL);
+
+		if (message) {
+			CamelStream *stream;
+
+			g_rec_mutex_lock (&ews_folder->priv->cache_lock);
+
+			stream = ews_data_cache_add (ews_folder->cache, "cur", item_id, NULL);
+			if (stream) {
+				camel_data_wrapper_write_to_stream_sync (CAMEL_DATA_WRAPPER (message), stream, NULL, NULL);
+				g_object_unref (stream);
+			}
+
+			g_rec_mutex_unlock (&ews_folder->priv->cache_lock);
+
+			ews_folder_cache_add_file (ews_folder, item_id, FALSE);
+
+			camel_ews_body_index_add_message (ews_folder->priv->body_index, item_id, message, NULL, NULL);
+
+			if (camel_ews_summary_add_message (folder_summary, item_id, change_key, mi, message))
+				camel_folder_change_info_add_uid (changes, item_id);
+
+			g_object_unref (message);
+		}
+	}
+
+	g_clear_object (&mi);
+
+	camel_folder_summary_lock (folder_summary);
+	camel_folder_change_info_remove_uid (changes, temp_uid);
+	camel_folder_summary_remove_uid (folder_summary, temp_uid);
+	camel_ews_folder_remove_cached_message (ews_folder, temp_uid);
+	camel_folder_summary_unlock (folder_summary);
+
+	camel_folder_summary_touch (folder_summary);
+	camel_folder_changed (folder, changes);
+	camel_folder_change_info_free (changes);
+}
+
+static gboolean
+ews_folder_add_transferred_message (CamelEwsFolder *source,
+				    const gchar *uid,
+				    CamelEwsFolder *destination,
+				    const gchar *new_uid,
+				    const gchar *change_key,
+				    gboolean delete_original,
+				    GCancellable *cancellable);
+
+/* A message transferred while offline is in the destination folder under
+   a temporary uid, which is replaced with its server uid now, or the message
+   is removed from there, when it had not been transferred on the server */
+static void
+ews_folder_journal_transfer_cb (const gchar *folder_id,
+				const gchar *temp_uid,
+				const gchar *item_id,
+				const gchar *change_key,
+				gpointer user_data)
+{
+	CamelEwsFolder *ews_folder = user_data;
+	CamelEwsStore *ews_store;
+	CamelFolder *destination;
+	CamelFolderSummary *dst_summary;
+	CamelFolderChangeInfo *changes;
+	CamelMessageInfo *mi;
+	gchar *full_name;
+
+	ews_store = CAMEL_EWS_STORE (camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder)));
+	full_name = camel_ews_store_summary_get_folder_full_name (ews_store->summary, folder_id, NULL);
+	destination = full_name ? camel_store_get_folder_sync (CAMEL_STORE (ews_store), full_name, 0, NULL, NULL) : NULL;
+	g_free (full_name);
+
+	if (!CAMEL_IS_EWS_FOLDER (destination)) {
+		g_clear_object (&destination);
+		return;
+	}
+
+	dst_summary = camel_folder_get_folder_summary (destination);
+	mi = camel_folder_summary_get (dst_summary, temp_uid);
+
+	if (!mi) {
+		g_object_unref (destination);
+		return;
+	}
+
+	changes = camel_folder_change_info_new ();
+
+	if (item_id && ews_folder_add_transferred_message (CAMEL_EWS_FOLDER (destination), temp_uid,
+		CAMEL_EWS_FOLDER (destination), item_id, change_key, TRUE, NULL)) {
+		camel_folder_change_info_add_uid (changes, item_id);
+
+		/* Flags changed in the destination meanwhile are written by the next sync */
+		if (camel_message_info_get_folder_flagged (mi)) {
+			CamelMessageInfo *new_mi;
+
+			new_mi = camel_folder_summary_get (dst_summary, item_id);
+			if (new_mi) {
+				camel_message_info_set_folder_flagged (new_mi, TRUE);
+				g_object_unref (new_mi);
+			}
+		}
+	}
+
+	g_object_unref (mi);
+
+	camel_folder_summary_lock (dst_summary);
+	camel_folder_change_info_remove_uid (changes, temp_uid);
+	camel_folder_summary_remove_uid (dst_summary, temp_uid);
+	camel_ews_folder_remove_cached_message (CAMEL_EWS_FOLDER (destination), temp_uid);
+	camel_folder_summary_unlock (dst_summary);
+
+	camel_folder_summary_touch (dst_summary);
+	camel_folder_summary_save (dst_summary, NULL);
+	camel_folder_changed (destination, changes);
+	camel_folder_change_info_free (changes);
+
+	g_object_unref (destination);
+}
+
+/* Writes the journal operations, done while offline, to the server */
+static gboolean
+ews_folder_replay_journal_ops_sync (CamelEwsFolder *ews_folder,
+				    GCancellable *cancellable,
+				    GError **error)
+{
+	CamelEwsStore *ews_store;
+	EEwsConnection *cnc;
+	GError *local_error = NULL;
+	gboolean conflicts = FALSE;
+	gboolean res;
+
+	if (!camel_ews_journal_get_length (ews_folder->priv->journal))
+		return TRUE;
+
+	ews_store = (CamelEwsStore *) camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder));
+
+	if (!camel_offline_store_get_online (CAMEL_OFFLINE_STORE (ews_store)))
+		return TRUE;
+
+	if (!camel_ews_store_connected (ews_store, cancellable, error))
+		return FALSE;
+
+	cnc = camel_ews_store_ref_connection (ews_store);
+
+	camel_operation_push_message (cancellable, _("Saving changes done while offline"));
+
+	res = camel_ews_journal_replay_sync (ews_folder->priv->journal, cnc,
+		ews_folder_journal_uid_changed_cb, ews_folder_journal_transfer_cb, ews_folder,
+		&conflicts, cancellable, &local_error);
+
+	camel_operation_pop_message (cancellable);
+
+	/* Some of the local changes could not be done on the server,
+	   thus let the next refresh read the whole folder content again */
+	if (conflicts)
+		camel_ews_summary_set_sync_state (CAMEL_EWS_SUMMARY (camel_folder_get_folder_summary (CAMEL_FOLDER (ews_folder))), NULL);
+
+	if (local_error) {
+		camel_ews_store_maybe_disconnect (ews_store, local_error);
+		g_propagate_error (error, local_error);
+	}
+
+	g_object_unref (cnc);
+
+	return res;
+}
+
+/* Writes the changes done while offline to the server, the queued
+   flags first, then the journal operations */
+static gboolean
+ews_folder_replay_journal_sync (CamelEwsFolder *ews_folder,
+				GCancellable *cancellable,
+				GError **error)
+{
+	if (!ews_folder_flush_flags_sync (ews_folder, cancellable, error))
+		return FALSE;
+
+	return ews_folder_replay_journal_ops_sync (ews_folder, cancellable, error);
+}
+
+/* Only queues the flag changes, they are written to the server
+   by ews_folder_flush_flags_sync() */
+static gboolean
+ews_save_flags (CamelFolder *folder,
+		const GSList *mi_list,
+		GCancellable *cancellable,
+		GError **error)
+{
+	CamelEwsFolder *ews_folder;
+	CamelFolderSummary *folder_summary;
+	const GSList *iter;
+	GError *local_error = NULL;
+
+	if (!ews_suppress_read_receipts_sync (folder, mi_list, cancellable, &local_error)) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	ews_folder = CAMEL_EWS_FOLDER (folder);
+	folder_summary = camel_folder_get_folder_summary (folder);
+
+	for (iter = mi_list; iter; iter = g_slist_next (iter)) {
+		CamelMessageInfo *mi = iter->data;
+		CamelEwsMessageInfo *emi;
+		GSList *categories;
+		guint32 mi_flags;
+
+		/* Not on the server yet; the flags are written once it is */
+		if (!mi || camel_ews_journal_is_temp_uid (camel_message_info_get_uid (mi)))
+			continue;
+
+		emi = CAMEL_EWS_MESSAGE_INFO (mi);
+
+		camel_folder_summary_lock (folder_summary);
+		camel_message_info_property_lock (mi);
+
+		mi_flags = camel_message_info_get_flags (mi);
+		categories = ews_utils_gather_server_user_flags (NULL, mi);
+
+		camel_ews_flag_queue_add (ews_folder->priv->flag_queue,
+			camel_message_info_get_uid (mi),
+			camel_ews_message_info_get_change_key (emi),
+			camel_ews_message_info_get_server_flags (emi) ^ mi_flags,
+			mi_flags,
+			categories,
+			camel_message_info_get_user_tag (mi, "follow-up"),
+			camel_message_info_get_user_tag (mi, "completed-on"),
+			camel_message_info_get_user_tag (mi, "due-by"));
+
+		g_slist_free_full (categories, g_free);
+
+		camel_message_info_set_folder_flagged (mi, FALSE);
+
+		camel_message_info_property_unlock (mi);
+		camel_folder_summary_unlock (folder_summary);
+	}
+
+	camel_ews_flag_queue_save (ews_folder->priv->flag_queue, NULL);
+	camel_folder_summary_save (folder_summary, NULL);
+
+	return TRUE;
+}
+
+static gboolean
+ews_folder_is_of_type (CamelFolder *folder,
+                       guint32 folder_type)
+{
+	CamelStore *parent_store;
+	CamelEwsStore *ews_store;
+	gboolean is_of_type;
+	gchar *folder_id;
+
+	g_return_val_if_fail (folder != NULL, FALSE);
 
 	parent_store = camel_folder_get_parent_store (folder);
 	ews_store = CAMEL_EWS_STORE (parent_store);
@@ -1534,7 +2058,26 @@ ews_move_to_special_folder (CamelFolder *folder,
 	ews_folder = CAMEL_EWS_FOLDER (folder);
 	ews_store = CAMEL_EWS_STORE (parent_store);
 
-	if (!camel_ews_store_connected (ews_store, cancellable, error))
+	if (!camel_offline_store_get_online (CAMEL_OFFLINE_STORE (ews_store))) {
+		gchar *folder_id;
+
+		folder_id = camel_ews_store_summary_get_folder_id_from_folder_type (ews_store->summary, folder_type);
+
+		if (folder_id && uids) {
+			/* The special folders are not updated locally */
+			g_slist_free_full (camel_ews_journal_add_transfer (ews_folder->priv->journal, uids, folder_id, FALSE), g_free);
+			ews_delete_messages_from_folder (folder, uids);
+
+			status = camel_ews_journal_save (ews_folder->priv->journal, error);
+		}
+
+		g_free (folder_id);
+
+		return status;
+	}
+
+	if (!camel_ews_store_connected (ews_store, cancellable, error) ||
+	    !ews_folder_replay_journal_sync (ews_folder, cancellable, error))
 		return FALSE;
 
 	cnc = camel_ews_store_ref_connection (ews_store);
@@ -1577,7 +2120,7 @@ ews_move_to_special_folder (CamelFolder *folder,
 
 				camel_folder_change_info_remove_uid (changes, uid);
 				camel_folder_summary_remove_uid (camel_folder_get_folder_summary (folder), uid);
-				ews_data_cache_remove (ews_folder->cache, "cur", uid, NULL);
+				camel_ews_folder_remove_cached_message (ews_folder, uid);
 
 				camel_folder_summary_unlock (camel_folder_get_folder_summary (folder));
 			}
@@ -1621,9 +2164,13 @@ ews_synchronize_sync (CamelFolder *folder,
 
 	ews_store = (CamelEwsStore *) camel_folder_get_parent_store (folder);
 
-	if (!camel_ews_store_connected (ews_store, cancellable, error))
+	/* While offline the changes are stored in the journal */
+	if (camel_offline_store_get_online (CAMEL_OFFLINE_STORE (ews_store)) &&
+	    !camel_ews_store_connected (ews_store, cancellable, error))
 		return FALSE;
 
+	camel_ews_body_index_save (CAMEL_EWS_FOLDER (folder)->priv->body_index, NULL);
+
 	folder_summary = camel_folder_get_folder_summary (folder);
 	if (camel_folder_summary_get_deleted_count (folder_summary) > 0 ||
 	    camel_folder_summary_get_junk_count (folder_summary) > 0) {
@@ -1691,6 +2238,13 @@ ews_synchronize_sync (CamelFolder *folder,
 		success = ews_save_flags (folder, mi_list, cancellable, &local_error);
 	g_slist_free_full (mi_list, g_object_unref);
 
+	/* Write the flags before the messages are moved or deleted, otherwise
+	   only in the background, together with the later changes */
+	if (success && (deleted_uids || junk_uids || inbox_uids || expunge))
+		success = ews_folder_flush_flags_sync (CAMEL_EWS_FOLDER (folder), cancellable, &local_error);
+	else if (success)
+		ews_folder_schedule_flags_flush (CAMEL_EWS_FOLDER (folder));
+
 	if (deleted_uids && success)
 		success = ews_delete_messages (folder, deleted_uids, ews_folder_is_of_type (folder, CAMEL_FOLDER_TYPE_TRASH), cancellable, &local_error);
 	g_slist_free_full (deleted_uids, (GDestroyNotify) camel_pstring_free);
@@ -1781,6 +2335,7 @@ camel_ews_folder_new (CamelStore *store,
 	CamelFolder *folder;
 	CamelFolderSummary *folder_summary;
 	CamelEwsFolder *ews_folder;
+	CamelEwsMessageCache *message_cache;
 	CamelSettings *settings;
 	gboolean filter_inbox = FALSE;
 	gboolean filter_junk = FALSE;
@@ -1837,12 +2392,54 @@ camel_ews_folder_new (CamelStore *store,
 	camel_object_state_read (CAMEL_OBJECT (folder));
 	g_free (state_file);
 
+	state_file = g_build_filename (folder_dir, "flag-queue", NULL);
+	ews_folder->priv->flag_queue = camel_ews_flag_queue_new (state_file);
+	g_free (state_file);
+
+	state_file = g_build_filename (folder_dir, "journal", NULL);
+	ews_folder->priv->journal = camel_ews_journal_new (state_file);
+	g_free (state_file);
+
+	state_file = g_build_filename (folder_dir, "body-index", NULL);
+	ews_folder->priv->body_index = camel_ews_body_index_new (state_file);
+	g_free (state_file);
+
 	ews_folder->cache = camel_data_cache_new (folder_dir, error);
 	if (!ews_folder->cache) {
 		g_object_unref (folder);
 		return NULL;
 	}
 
+	message_cache = camel_ews_store_get_message_cache (CAMEL_EWS_STORE (store));
+	if (message_cache) {
+		GPtrArray *uids;
+		gchar *path;
+		guint ii;
+
+		path = g_build_filename (folder_dir, "cur", NULL);
+		camel_ews_message_cache_add_directory (message_cache, path, G_OBJECT (folder), ews_folder_message_cache_evict_cb);
+		g_free (path);
+
+		uids = camel_folder_summary_get_array (folder_summary);
+
+		for (ii = 0; uids && ii < uids->len; ii++) {
+			const gchar *uid = g_ptr_array_index (uids, ii);
+			gchar *filename;
+
+			filename = ews_data_cache_get_filename (ews_folder->cache, "cur", uid, NULL);
+
+			camel_ews_message_cache_set_uid (message_cache, filename, uid);
+
+			/* Messages appended while offline are not on the server yet */
+			if (camel_ews_journal_is_temp_uid (uid))
+				camel_ews_message_cache_set_keep (message_cache, filename, TRUE);
+
+			g_free (filename);
+		}
+
+		camel_folder_summary_free_array (uids);
+	}
+
 	if (camel_offline_folder_can_downsync (CAMEL_OFFLINE_FOLDER (folder))) {
 		time_t when = (time_t) 0;
 
@@ -1899,6 +2496,7 @@ static void
 sync_updated_items (CamelEwsFolder *ews_folder,
                     EEwsConnection *cnc,
 		    gboolean is_drafts_folder,
+		    gboolean with_summary_props,
                     GSList *updated_items,
 		    CamelFolderChangeInfo *change_info,
                     GCancellable *cancellable,
@@ -1946,6 +2544,14 @@ sync_updated_items (CamelEwsFolder *ews_folder,
 			continue;
 		}
 
+		/* The item carries the flags already; it's processed
+		   together with the fetched messages below */
+		if (with_summary_props) {
+			items = g_slist_prepend (items, item);
+			g_clear_object (&mi);
+			continue;
+		}
+
 		if (item_type == E_EWS_ITEM_TYPE_GENERIC_ITEM)
 			generic_item_ids = g_slist_append (generic_item_ids, g_strdup (id->id));
 		else if (item_type == E_EWS_ITEM_TYPE_MESSAGE ||
@@ -1964,12 +2570,13 @@ sync_updated_items (CamelEwsFolder *ews_folder,
 	}
 	g_slist_free (updated_items);
 
+	items = g_slist_reverse (items);
 
 	if (msg_ids) {
 		EEwsAdditionalProps *add_props;
 
 		add_props = e_ews_additional_props_new ();
-		add_props->field_uri = g_strdup (is_drafts_folder ? SUMMARY_MESSAGE_PROPS : SUMMARY_MESSAGE_FLAGS);
+		add_props->field_uri = is_drafts_folder ? ews_folder_dup_summary_props (cnc, SUMMARY_MESSAGE_PROPS) : g_strdup (SUMMARY_MESSAGE_FLAGS);
 		add_props->extended_furis = ews_folder_get_summary_message_mapi_flags ();
 
 		e_ews_connection_get_items_sync (
@@ -1993,7 +2600,7 @@ sync_updated_items (CamelEwsFolder *ews_folder,
 		EEwsAdditionalProps *add_props;
 
 		add_props = e_ews_additional_props_new ();
-		add_props->field_uri = g_strdup (is_drafts_folder ? SUMMARY_ITEM_PROPS : SUMMARY_ITEM_FLAGS);
+		add_props->field_uri = is_drafts_folder ? ews_folder_dup_summary_props (cnc, SUMMARY_ITEM_PROPS) : g_strdup (SUMMARY_ITEM_FLAGS);
 		add_props->extended_furis = ews_folder_get_summary_followup_mapi_flags ();
 
 		e_ews_connection_get_items_sync (
@@ -2023,20 +2630,53 @@ exit:
 	}
 }
 
+CamelEwsBodyIndex *
+camel_ews_folder_get_body_index (CamelEwsFolder *ews_folder)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_FOLDER (ews_folder), NULL);
+
+	return ews_folder->priv->body_index;
+}
+
+/* Whether the flags of the @uid wait to be written to the server,
+   thus the server values are not current for it */
+gboolean
+camel_ews_folder_has_queued_flags (CamelEwsFolder *ews_folder,
+				   const gchar *uid)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_FOLDER (ews_folder), FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+
+	return camel_ews_flag_queue_contains (ews_folder->priv->flag_queue, uid);
+}
+
 void
 camel_ews_folder_remove_cached_message (CamelEwsFolder *ews_folder,
 					const gchar *uid)
 {
+	CamelEwsMessageCache *message_cache;
+
 	g_return_if_fail (CAMEL_IS_EWS_FOLDER (ews_folder));
 	g_return_if_fail (uid != NULL);
 
+	message_cache = ews_folder_get_message_cache (ews_folder);
+	if (message_cache) {
+		gchar *filename;
+
+		filename = ews_data_cache_get_filename (ews_folder->cache, "cur", uid, NULL);
+		camel_ews_message_cache_remove_file (message_cache, filename);
+		g_free (filename);
+	}
+
 	ews_data_cache_remove (ews_folder->cache, "cur", uid, NULL);
+	camel_ews_body_index_remove (ews_folder->priv->body_index, uid);
 }
 
 static void
 sync_created_items (CamelEwsFolder *ews_folder,
                     EEwsConnection *cnc,
 		    gboolean is_drafts_folder,
+		    gboolean with_summary_props,
                     GSList *created_items,
 		    GHashTable *updating_summary_uids,
 		    CamelFolderChangeInfo *change_info,
@@ -2046,6 +2686,7 @@ sync_created_items (CamelEwsFolder *ews_folder,
 	CamelEwsStore *ews_store;
 	GSList *items = NULL, *l;
 	GSList *generic_item_ids = NULL, *msg_ids = NULL, *post_item_ids = NULL;
+	GSList *complete_items = NULL, *recipient_ids = NULL;
 	GError *local_error = NULL;
 
 	ews_store = CAMEL_EWS_STORE (camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder)));
@@ -2080,6 +2721,24 @@ sync_created_items (CamelEwsFolder *ews_folder,
 				g_object_unref (item);
 				continue;
 			}
+		} else if (camel_folder_summary_check_uid (camel_folder_get_folder_summary (CAMEL_FOLDER (ews_folder)), id->id)) {
+			/* Added already by a message transfer */
+			g_object_unref (item);
+			continue;
+		}
+
+		/* The item carries the summary properties already, only
+		   the recipients of the messages can be missing */
+		if (with_summary_props) {
+			if (item_type == E_EWS_ITEM_TYPE_MESSAGE ||
+			    item_type == E_EWS_ITEM_TYPE_MEETING_REQUEST ||
+			    item_type == E_EWS_ITEM_TYPE_MEETING_MESSAGE ||
+			    item_type == E_EWS_ITEM_TYPE_MEETING_RESPONSE ||
+			    item_type == E_EWS_ITEM_TYPE_MEETING_CANCELLATION)
+				recipient_ids = g_slist_prepend (recipient_ids, g_strdup (id->id));
+
+			complete_items = g_slist_prepend (complete_items, item);
+			continue;
 		}
 
 		/* created_msg_ids are items other than generic item. We fetch them
@@ -2101,12 +2760,59 @@ sync_created_items (CamelEwsFolder *ews_folder,
 	}
 	g_slist_free (created_items);
 
+	if (complete_items) {
+		CamelFolderSummary *folder_summary;
+		GSList *link, *missing_ids = NULL;
+
+		camel_ews_utils_sync_created_items (ews_folder, cnc, is_drafts_folder, g_slist_reverse (complete_items), change_info, cancellable);
+
+		/* The recipients are known for messages with transport headers */
+		folder_summary = camel_folder_get_folder_summary (CAMEL_FOLDER (ews_folder));
+
+		for (link = recipient_ids; link; link = g_slist_next (link)) {
+			CamelMessageInfo *mi;
+
+			mi = camel_folder_summary_get (folder_summary, link->data);
+			if (mi && !camel_message_info_get_to (mi) && !camel_message_info_get_cc (mi))
+				missing_ids = g_slist_prepend (missing_ids, g_strdup (link->data));
+
+			g_clear_object (&mi);
+		}
+
+		if (missing_ids) {
+			EEwsAdditionalProps *add_props;
+
+			add_props = e_ews_additional_props_new ();
+			add_props->field_uri = ews_folder_dup_preview_props (ews_folder, cnc, SUMMARY_RECIPIENT_PROPS);
+
+			e_ews_connection_get_items_sync (
+				cnc, EWS_PRIORITY_MEDIUM,
+				missing_ids, "IdOnly", add_props,
+				FALSE, NULL, E_EWS_BODY_TYPE_ANY, &items, NULL, NULL,
+				cancellable, &local_error);
+
+			e_ews_additional_props_free (add_props);
+			g_slist_free_full (missing_ids, g_free);
+		}
+
+		camel_ews_utils_sync_recipients (ews_folder, cnc, items, change_info, cancellable);
+		items = NULL;
+
+		if (local_error) {
+			camel_ews_store_maybe_disconnect (ews_store, local_error);
+			g_propagate_error (error, local_error);
+			goto exit;
+		}
+	}
 
 	if (msg_ids) {
 		EEwsAdditionalProps *add_props;
+		gchar *props;
+
+		props = ews_folder_dup_summary_props (cnc, SUMMARY_MESSAGE_PROPS);
 
 		add_props = e_ews_additional_props_new ();
-		add_props->field_uri = g_strdup (SUMMARY_MESSAGE_PROPS);
+		add_props->field_uri = ews_folder_dup_preview_props (ews_folder, cnc, props);
 		add_props->extended_furis = ews_folder_get_summary_message_mapi_flags ();
 
 		e_ews_connection_get_items_sync (
@@ -2116,6 +2822,7 @@ sync_created_items (CamelEwsFolder *ews_folder,
 			cancellable, &local_error);
 
 		e_ews_additional_props_free (add_props);
+		g_free (props);
 	}
 
 	if (local_error) {
@@ -2132,7 +2839,7 @@ sync_created_items (CamelEwsFolder *ews_folder,
 		EEwsAdditionalProps *add_props;
 
 		add_props = e_ews_additional_props_new ();
-		add_props->field_uri = g_strdup (SUMMARY_POSTITEM_PROPS);
+		add_props->field_uri = ews_folder_dup_summary_props (cnc, SUMMARY_POSTITEM_PROPS);
 		add_props->extended_furis = ews_folder_get_summary_followup_mapi_flags ();
 
 		e_ews_connection_get_items_sync (
@@ -2157,7 +2864,7 @@ sync_created_items (CamelEwsFolder *ews_folder,
 		EEwsAdditionalProps *add_props;
 
 		add_props = e_ews_additional_props_new ();
-		add_props->field_uri = g_strdup (SUMMARY_ITEM_PROPS);
+		add_props->field_uri = ews_folder_dup_summary_props (cnc, SUMMARY_ITEM_PROPS);
 		add_props->extended_furis = ews_folder_get_summary_followup_mapi_flags ();
 
 		e_ews_connection_get_items_sync (
@@ -2177,6 +2884,8 @@ sync_created_items (CamelEwsFolder *ews_folder,
 	}
 
 exit:
+	g_slist_free_full (recipient_ids, g_free);
+
 	if (msg_ids) {
 		g_slist_foreach (msg_ids, (GFunc) g_free, NULL);
 		g_slist_free (msg_ids);
@@ -2218,9 +2927,13 @@ ews_folder_forget_all_mails (CamelEwsFolder *ews_folder)
 	for (ii = 0; ii < known_uids->len; ii++) {
 		const gchar *uid = g_ptr_array_index (known_uids, ii);
 
+		/* Not on the server, thus it would not be read back */
+		if (camel_ews_journal_is_temp_uid (uid))
+			continue;
+
 		camel_folder_change_info_remove_uid (changes, uid);
 		camel_folder_summary_remove_uid (folder_summary, uid);
-		ews_data_cache_remove (ews_folder->cache, "cur", uid, NULL);
+		camel_ews_folder_remove_cached_message (ews_folder, uid);
 	}
 	camel_folder_summary_unlock (folder_summary);
 
@@ -2243,7 +2956,9 @@ ews_refresh_info_sync (CamelFolder *folder,
 	CamelFolderSummary *folder_summary;
 	CamelEwsFolder *ews_folder;
 	CamelEwsFolderPrivate *priv;
+	CamelSettings *settings;
 	GHashTable *updating_summary_uids = NULL;
+	EEwsAdditionalProps *sync_props = NULL;
 	EEwsConnection *cnc;
 	CamelEwsStore *ews_store;
 	const gchar *full_name;
@@ -2251,6 +2966,8 @@ ews_refresh_info_sync (CamelFolder *folder,
 	gchar *sync_state;
 	gboolean includes_last_item = FALSE;
 	gboolean is_drafts_folder;
+	gboolean with_summary_props;
+	guint max_entries = EWS_MAX_FETCH_COUNT;
 	gint64 last_folder_update_time;
 	GError *local_error = NULL;
 
@@ -2263,6 +2980,22 @@ ews_refresh_info_sync (CamelFolder *folder,
 	if (!camel_ews_store_connected (ews_store, cancellable, error))
 		return FALSE;
 
+	/* The pending changes would be overwritten by the server values. The flags
+	   stay queued when they cannot be written, which should not stop the refresh;
+	   the refresh does not change the flags of the queued messages then. */
+	if (!ews_folder_flush_flags_sync (ews_folder, cancellable, &local_error)) {
+		if (g_error_matches (local_error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+			g_propagate_error (error, local_error);
+			return FALSE;
+		}
+
+		ews_folder_debug_flush_error (ews_folder, local_error);
+		g_clear_error (&local_error);
+	}
+
+	if (!ews_folder_replay_journal_ops_sync (ews_folder, cancellable, error))
+		return FALSE;
+
 	g_mutex_lock (&priv->state_lock);
 
 	if (priv->refreshing) {
@@ -2288,12 +3021,28 @@ ews_refresh_info_sync (CamelFolder *folder,
 
 	is_drafts_folder = camel_ews_utils_folder_is_drafts_folder (ews_folder);
 
+	settings = camel_service_ref_settings (CAMEL_SERVICE (ews_store));
+	with_summary_props = camel_ews_settings_get_sync_summary_props (CAMEL_EWS_SETTINGS (settings));
+	g_object_unref (settings);
+
 	/* Sync folder items does not return the fields ToRecipients,
 	 * CCRecipients. With the item_type unknown, its not possible
 	 * to fetch the right properties which are valid for an item type.
 	 * Due to these reasons we just get the item ids and its type in
 	 * SyncFolderItem request and fetch the item using the
-	 * GetItem request. */
+	 * GetItem request. When enabled, the summary properties are
+	 * requested in the SyncFolderItems and only the recipients are
+	 * fetched with the GetItem. The Drafts folder reads everything,
+	 * because its messages can change. */
+	if (with_summary_props && !is_drafts_folder) {
+		sync_props = e_ews_additional_props_new ();
+		sync_props->field_uri = ews_folder_dup_summary_props (cnc, SYNC_SUMMARY_PROPS);
+		sync_props->extended_furis = ews_folder_get_summary_message_mapi_flags ();
+		max_entries = EWS_MAX_SYNC_COUNT;
+	} else {
+		with_summary_props = FALSE;
+	}
+
 	sync_state = camel_ews_summary_dup_sync_state (CAMEL_EWS_SUMMARY (folder_summary));
 
 	if (!sync_state ||
@@ -2307,7 +3056,7 @@ ews_refresh_info_sync (CamelFolder *folder,
 		gchar *new_sync_state = NULL;
 		guint32 total, unread;
 
-		e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM, sync_state, id, "IdOnly", NULL, EWS_MAX_FETCH_COUNT,
+		e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM, sync_state, id, "IdOnly", sync_props, max_entries,
 			&new_sync_state, &includes_last_item, &items_created, &items_updated, &items_deleted,
 			cancellable, &local_error);
 
@@ -2325,7 +3074,7 @@ ews_refresh_info_sync (CamelFolder *folder,
 				updating_summary_uids = NULL;
 			}
 
-			e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM, NULL, id, "IdOnly", NULL, EWS_MAX_FETCH_COUNT,
+			e_ews_connection_sync_folder_items_sync (cnc, EWS_PRIORITY_MEDIUM, NULL, id, "IdOnly", sync_props, max_entries,
 				&sync_state, &includes_last_item, &items_created, &items_updated, &items_deleted,
 				cancellable, &local_error);
 		}
@@ -2339,7 +3088,7 @@ ews_refresh_info_sync (CamelFolder *folder,
 			camel_ews_utils_sync_deleted_items (ews_folder, items_deleted, change_info);
 
 		if (items_created)
-			sync_created_items (ews_folder, cnc, is_drafts_folder, items_created, updating_summary_uids, change_info, cancellable, &local_error);
+			sync_created_items (ews_folder, cnc, is_drafts_folder, with_summary_props, items_created, updating_summary_uids, change_info, cancellable, &local_error);
 
 		if (local_error) {
 			if (items_updated) {
@@ -2351,7 +3100,7 @@ ews_refresh_info_sync (CamelFolder *folder,
 		}
 
 		if (items_updated)
-			sync_updated_items (ews_folder, cnc, is_drafts_folder, items_updated, change_info, cancellable, &local_error);
+			sync_updated_items (ews_folder, cnc, is_drafts_folder, with_summary_props, items_updated, change_info, cancellable, &local_error);
 
 		if (local_error)
 			break;
@@ -2389,8 +3138,12 @@ ews_refresh_info_sync (CamelFolder *folder,
 			while (g_hash_table_iter_next (&iter, &key, NULL)) {
 				const gchar *uid = key;
 
+				/* Appended while offline and not stored on the server */
+				if (camel_ews_journal_is_temp_uid (uid))
+					continue;
+
 				camel_folder_change_info_remove_uid (change_info, uid);
-				ews_data_cache_remove (ews_folder->cache, "cur", uid, NULL);
+				camel_ews_folder_remove_cached_message (ews_folder, uid);
 
 				removed_uids = g_list_prepend (removed_uids, (gpointer) uid);
 			}
@@ -2423,6 +3176,9 @@ ews_refresh_info_sync (CamelFolder *folder,
 	priv->refreshing = FALSE;
 	g_mutex_unlock (&priv->state_lock);
 
+	if (sync_props)
+		e_ews_additional_props_free (sync_props);
+
 	g_object_unref (cnc);
 	g_free (sync_state);
 	g_free (id);
@@ -2430,6 +3186,77 @@ ews_refresh_info_sync (CamelFolder *folder,
 	return !local_error;
 }
 
+/* Stores the message locally under a temporary uid
+   and records it in the journal */
+static gboolean
+ews_append_message_offline (CamelFolder *folder,
+			    CamelMimeMessage *message,
+			    CamelMessageInfo *info,
+			    gchar **appended_uid,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	CamelEwsFolder *ews_folder;
+	CamelEwsStore *ews_store;
+	CamelStream *stream;
+	gchar *folder_id, *temp_uid;
+
+	ews_folder = CAMEL_EWS_FOLDER (folder);
+	ews_store = (CamelEwsStore *) camel_folder_get_parent_store (folder);
+
+	folder_id = camel_ews_store_summary_get_folder_id_from_name (
+		ews_store->summary,
+		camel_folder_get_full_name (folder));
+	if (!folder_id)
+		return FALSE;
+
+	temp_uid = camel_ews_journal_add_append (ews_folder->priv->journal, folder_id, message,
+		info ? camel_message_info_get_flags (info) : 0, cancellable, error);
+
+	g_free (folder_id);
+
+	if (!temp_uid)
+		return FALSE;
+
+	if (!camel_ews_journal_save (ews_folder->priv->journal, error)) {
+		g_free (temp_uid);
+		return FALSE;
+	}
+
+	g_rec_mutex_lock (&ews_folder->priv->cache_lock);
+
+	stream = ews_data_cache_add (ews_folder->cache, "cur", temp_uid, NULL);
+	if (stream) {
+		camel_data_wrapper_write_to_stream_sync (CAMEL_DATA_WRAPPER (message), stream, cancellable, NULL);
+		g_object_unref (stream);
+	}
+
+	g_rec_mutex_unlock (&ews_folder->priv->cache_lock);
+
+	/* The only copy to read until the journal is replayed */
+	ews_folder_cache_add_file (ews_folder, temp_uid, TRUE);
+
+	camel_ews_body_index_add_message (ews_folder->priv->body_index, temp_uid, message, cancellable, NULL);
+
+	if (info && camel_ews_summary_add_message (camel_folder_get_folder_summary (folder), temp_uid, NULL, info, message)) {
+		CamelFolderChangeInfo *changes;
+
+		changes = camel_folder_change_info_new ();
+
+		camel_folder_change_info_add_uid (changes, temp_uid);
+		camel_folder_changed (folder, changes);
+
+		camel_folder_change_info_free (changes);
+	}
+
+	if (appended_uid)
+		*appended_uid = temp_uid;
+	else
+		g_free (temp_uid);
+
+	return TRUE;
+}
+
 static gboolean
 ews_append_message_sync (CamelFolder *folder,
                          CamelMimeMessage *message,
@@ -2449,7 +3276,11 @@ ews_append_message_sync (CamelFolder *folder,
 
 	ews_store = (CamelEwsStore *) camel_folder_get_parent_store (folder);
 
-	if (!camel_ews_store_connected (ews_store, cancellable, error)) {
+	if (!camel_offline_store_get_online (CAMEL_OFFLINE_STORE (ews_store)))
+		return ews_append_message_offline (folder, message, info, appended_uid, cancellable, error);
+
+	if (!camel_ews_store_connected (ews_store, cancellable, error) ||
+	    !ews_folder_replay_journal_sync (CAMEL_EWS_FOLDER (folder), cancellable, error)) {
 		return FALSE;
 	}
 
@@ -2511,6 +3342,109 @@ ews_append_message_sync (CamelFolder *folder,
 	return TRUE;
 }
 
+/* Moves or links the cached message file of the @uid to the @destination
+   cache under the @new_uid, falling back to writing the message again */
+static void
+ews_folder_transfer_cached_message (CamelEwsFolder *source,
+				    const gchar *uid,
+				    CamelEwsFolder *destination,
+				    const gchar *new_uid,
+				    gboolean delete_original,
+				    GCancellable *cancellable)
+{
+	gchar *src_filename, *dst_filename, *dirname;
+	gboolean success;
+
+	src_filename = ews_data_cache_get_filename (source->cache, "cur", uid, NULL);
+	if (!src_filename || !g_file_test (src_filename, G_FILE_TEST_IS_REGULAR)) {
+		g_free (src_filename);
+		return;
+	}
+
+	dst_filename = ews_data_cache_get_filename (destination->cache, "cur", new_uid, NULL);
+	dirname = dst_filename ? g_path_get_dirname (dst_filename) : NULL;
+
+	success = dirname && g_mkdir_with_parents (dirname, 0700) == 0;
+
+	if (success) {
+		g_unlink (dst_filename);
+
+		/* The cache writes new files, thus a copy can share the content */
+		if (delete_original)
+			success = g_rename (src_filename, dst_filename) == 0;
+		else
+			success = link (src_filename, dst_filename) == 0;
+	}
+
+	if (!success) {
+		CamelMimeMessage *message;
+
+		message = ews_folder_get_message_cached (CAMEL_FOLDER (source), uid, cancellable);
+		if (message) {
+			CamelStream *stream;
+
+			stream = ews_data_cache_add (destination->cache, "cur", new_uid, NULL);
+			if (stream) {
+				success = camel_data_wrapper_write_to_stream_sync (
+					CAMEL_DATA_WRAPPER (message), stream, cancellable, NULL) != -1;
+				g_object_unref (stream);
+
+				if (!success)
+					ews_data_cache_remove (destination->cache, "cur", new_uid, NULL);
+			}
+
+			g_object_unref (message);
+		}
+	}
+
+	if (success) {
+		CamelEwsMessageCache *message_cache;
+
+		message_cache = ews_folder_get_message_cache (source);
+		if (message_cache && delete_original)
+			camel_ews_message_cache_remove_file (message_cache, src_filename);
+
+		ews_folder_cache_add_file (destination, new_uid, FALSE);
+
+		camel_ews_body_index_transfer (source->priv->body_index, uid, destination->priv->body_index, new_uid);
+	}
+
+	g_free (src_filename);
+	g_free (dst_filename);
+	g_free (dirname);
+}
+
+/* Adds a copy of the info of the @uid from the @source summary to the @destination
+   summary under the @new_uid, together with the cached message. The destination
+   summary is not saved. */
+static gboolean
+ews_folder_add_transferred_message (CamelEwsFolder *source,
+				    const gchar *uid,
+				    CamelEwsFolder *destination,
+				    const gchar *new_uid,
+				    const gchar *change_key,
+				    gboolean delete_original,
+				    GCancellable *cancellable)
+{
+	CamelFolderSummary *dst_summary;
+	CamelMessageInfo *info;
+	gboolean added;
+
+	info = camel_folder_summary_get (camel_folder_get_folder_summary (CAMEL_FOLDER (source)), uid);
+	if (!info)
+		return FALSE;
+
+	dst_summary = camel_folder_get_folder_summary (CAMEL_FOLDER (destination));
+
+	added = camel_ews_summary_add_message_info (dst_summary, new_uid, change_key, info);
+	if (added)
+		ews_folder_transfer_cached_message (source, uid, destination, new_uid, delete_original, cancellable);
+
+	g_object_unref (info);
+
+	return added;
+}
+
 /* move messages */
 static gboolean
 ews_transfer_messages_to_sync (CamelFolder *source,
@@ -2522,31 +3456,56 @@ ews_transfer_messages_to_sync (CamelFolder *source,
                                GError **error)
 {
 	EEwsConnection *cnc;
+	CamelEwsFolder *ews_source;
 	CamelEwsStore *dst_ews_store;
+	CamelFolderSummary *dst_summary;
 	const gchar *dst_full_name;
 	gchar *dst_id;
 	GError *local_error = NULL;
 	GSList *ids = NULL, *ret_items = NULL, *mi_list = NULL;
 	gint i = 0, mi_list_len = 0;
+	gboolean is_online;
 	gboolean success = TRUE;
 
+	ews_source = CAMEL_EWS_FOLDER (source);
 	dst_full_name = camel_folder_get_full_name (destination);
+	dst_summary = camel_folder_get_folder_summary (destination);
 	dst_ews_store = (CamelEwsStore *) camel_folder_get_parent_store (destination);
+	is_online = camel_offline_store_get_online (CAMEL_OFFLINE_STORE (dst_ews_store));
 
-	if (!camel_ews_store_connected (dst_ews_store, cancellable, error))
+	if (is_online && !camel_ews_store_connected (dst_ews_store, cancellable, error))
 		return FALSE;
 
-	cnc = camel_ews_store_ref_connection (dst_ews_store);
+	/* The messages appended while offline get their server uid here */
+	if (is_online && !ews_folder_replay_journal_sync (ews_source, cancellable, error))
+		return FALSE;
+
+	cnc = is_online ? camel_ews_store_ref_connection (dst_ews_store) : NULL;
 	dst_id = camel_ews_store_summary_get_folder_id_from_name (
 		dst_ews_store->summary, dst_full_name);
 
 	for (i = 0; success && i < uids->len; i++) {
+		const gchar *uid = uids->pdata[i];
+		gchar *dup_uid = NULL;
 		guint32 flags_set;
 		CamelMessageInfo *mi;
 
-		ids = g_slist_prepend (ids, (gchar *) uids->pdata[i]);
+		/* While offline the journal renames the temporary uids itself;
+		   those not stored on the server cannot be transferred there */
+		if (is_online && camel_ews_journal_is_temp_uid (uid)) {
+			g_mutex_lock (&ews_source->priv->state_lock);
+			dup_uid = g_strdup (g_hash_table_lookup (ews_source->priv->replayed_uids, uid));
+			g_mutex_unlock (&ews_source->priv->state_lock);
 
-		mi = camel_folder_summary_get (camel_folder_get_folder_summary (source), uids->pdata[i]);
+			if (!dup_uid)
+				continue;
+		} else {
+			dup_uid = g_strdup (uid);
+		}
+
+		ids = g_slist_prepend (ids, dup_uid);
+
+		mi = camel_folder_summary_get (camel_folder_get_folder_summary (source), dup_uid);
 		if (!mi)
 			continue;
 
@@ -2575,7 +3534,52 @@ ews_transfer_messages_to_sync (CamelFolder *source,
 
 	ids = g_slist_reverse (ids);
 
-	success = success && e_ews_connection_move_items_in_chunks_sync (
+	/* The messages are shown in the destination under temporary uids,
+	   which are replaced with the server uids when the journal is replayed */
+	if (!is_online) {
+		CamelEwsJournal *journal = ews_source->priv->journal;
+
+		if (success && dst_id && ids) {
+			CamelFolderChangeInfo *changes;
+			GSList *temp_uids, *ulink, *tlink;
+
+			temp_uids = camel_ews_journal_add_transfer (journal, ids, dst_id, !delete_originals);
+			changes = camel_folder_change_info_new ();
+
+			for (ulink = ids, tlink = temp_uids; ulink && tlink; ulink = g_slist_next (ulink), tlink = g_slist_next (tlink)) {
+				if (ews_folder_add_transferred_message (ews_source, ulink->data,
+					CAMEL_EWS_FOLDER (destination), tlink->data, NULL, delete_originals, cancellable))
+					camel_folder_change_info_add_uid (changes, tlink->data);
+			}
+
+			if (camel_folder_change_info_changed (changes)) {
+				camel_folder_summary_save (dst_summary, NULL);
+				camel_folder_changed (destination, changes);
+			}
+
+			camel_folder_change_info_free (changes);
+			g_slist_free_full (temp_uids, g_free);
+
+			if (delete_originals)
+				ews_delete_messages_from_folder (source, ids);
+
+			success = camel_ews_journal_save (journal, &local_error);
+		}
+
+		if (local_error)
+			g_propagate_error (error, local_error);
+
+		g_slist_free_full (ids, g_free);
+		g_free (dst_id);
+
+		return success;
+	}
+
+	/* The flags are written before the messages change their uids */
+	if (success)
+		success = ews_folder_flush_flags_sync (ews_source, cancellable, &local_error);
+
+	success = success && ids && e_ews_connection_move_items_in_chunks_sync (
 		cnc, EWS_PRIORITY_MEDIUM,
 		dst_id, !delete_originals,
 		ids, &ret_items,
@@ -2585,15 +3589,11 @@ ews_transfer_messages_to_sync (CamelFolder *source,
 	   the user cancels the operation in the middle */
 	if (success || ret_items) {
 		CamelFolderChangeInfo *changes;
-		GSList *l, *processed_items = NULL;
+		GSList *l, *ilink, *processed_items = NULL;
 
 		changes = camel_folder_change_info_new ();
 
-		for (l = ret_items, i = 0; l != NULL; l = l->next, i++) {
-			CamelMimeMessage *message;
-			CamelStream *stream;
-			CamelMessageInfo *info;
-			CamelMessageInfo *clone;
+		for (l = ret_items, ilink = ids; l != NULL && ilink != NULL; l = l->next, ilink = ilink->next) {
 			const EwsId *id;
 
 			if (e_ews_item_get_item_type (l->data) == E_EWS_ITEM_TYPE_ERROR) {
@@ -2603,44 +3603,19 @@ ews_transfer_messages_to_sync (CamelFolder *source,
 			}
 
 			id = e_ews_item_get_id (l->data);
-			processed_items = g_slist_prepend (processed_items, uids->pdata[i]);
-
-			message = ews_folder_get_message_cached (source, uids->pdata[i], cancellable);
-			if (message == NULL)
-				continue;
-
-			stream = ews_data_cache_add (
-				CAMEL_EWS_FOLDER (destination)->cache, "cur", id->id, NULL);
-			if (stream == NULL) {
-				g_object_unref (message);
-
-				continue;
-			}
-
-			camel_data_wrapper_write_to_stream_sync (
-				CAMEL_DATA_WRAPPER (message), stream, cancellable, NULL);
+			processed_items = g_slist_prepend (processed_items, ilink->data);
 
-			info = camel_folder_summary_get (camel_folder_get_folder_summary (source), uids->pdata[i]);
-			if (info == NULL) {
-				g_object_unref (stream);
-				g_object_unref (message);
-
-				continue;
-			}
-
-			clone = camel_message_info_clone (info, NULL);
-
-			if (camel_ews_summary_add_message (camel_folder_get_folder_summary (destination), id->id, id->change_key, clone, message))
+			/* The server returned the new ids, thus the destination summary
+			   gets the known information without any fetch from the server */
+			if (id && ews_folder_add_transferred_message (ews_source, ilink->data,
+				CAMEL_EWS_FOLDER (destination), id->id, id->change_key, delete_originals, cancellable))
 				camel_folder_change_info_add_uid (changes, id->id);
-
-			g_clear_object (&clone);
-			g_clear_object (&info);
-			g_object_unref (stream);
-			g_object_unref (message);
 		}
 
-		if (camel_folder_change_info_changed (changes))
+		if (camel_folder_change_info_changed (changes)) {
+			camel_folder_summary_save (dst_summary, NULL);
 			camel_folder_changed (destination, changes);
+		}
 
 		camel_folder_change_info_free (changes);
 
@@ -2652,7 +3627,7 @@ ews_transfer_messages_to_sync (CamelFolder *source,
 
 				camel_folder_summary_remove_uid (camel_folder_get_folder_summary (source), uid);
 				camel_folder_change_info_remove_uid (changes, uid);
-				ews_data_cache_remove (CAMEL_EWS_FOLDER (source)->cache, "cur", uid, NULL);
+				camel_ews_folder_remove_cached_message (ews_source, uid);
 			}
 			if (camel_folder_change_info_changed (changes)) {
 				camel_folder_summary_touch (camel_folder_get_folder_summary (source));
@@ -2662,14 +3637,9 @@ ews_transfer_messages_to_sync (CamelFolder *source,
 			camel_folder_change_info_free (changes);
 		}
 
-		/* update destination folder only if not frozen, to not update
-		   for each single message transfer during filtering
-		 */
-		if (!camel_folder_is_frozen (destination)) {
-			camel_operation_progress (cancellable, -1);
-
-			ews_refresh_info_sync (destination, cancellable, NULL);
-		}
+		/* The destination sync state catches up with the transferred
+		   messages on its next refresh, which skips the known items */
+		camel_operation_progress (cancellable, -1);
 
 		g_slist_free (processed_items);
 	}
@@ -2681,7 +3651,7 @@ ews_transfer_messages_to_sync (CamelFolder *source,
 	}
 
 	g_object_unref (cnc);
-	g_slist_free (ids);
+	g_slist_free_full (ids, g_free);
 	g_slist_free_full (ret_items, g_object_unref);
 
 	return !local_error;
@@ -2733,7 +3703,7 @@ ews_delete_messages_from_folder (CamelFolder *folder,
 		camel_folder_summary_lock (folder_summary);
 		camel_folder_change_info_remove_uid (changes, uid);
 		camel_folder_summary_remove_uid (folder_summary, uid);
-		ews_data_cache_remove (CAMEL_EWS_FOLDER (folder)->cache, "cur", uid, NULL);
+		camel_ews_folder_remove_cached_message (CAMEL_EWS_FOLDER (folder), uid);
 		camel_folder_summary_unlock (folder_summary);
 	}
 
@@ -2754,23 +3724,55 @@ ews_delete_messages (CamelFolder *folder,
 {
 	CamelStore *parent_store;
 	CamelEwsStore *ews_store;
+	CamelEwsJournal *journal;
+	GSList *server_uids = NULL;
+	const GSList *link;
+	gboolean with_temp_uids = FALSE;
 	GError *local_error = NULL;
 
 	if (deleted_items == NULL)
 		return TRUE;
 
+	journal = CAMEL_EWS_FOLDER (folder)->priv->journal;
 	parent_store = camel_folder_get_parent_store (folder);
 	ews_store = CAMEL_EWS_STORE (parent_store);
 
-	if (!camel_ews_store_connected (ews_store, cancellable, error))
+	if (!camel_offline_store_get_online (CAMEL_OFFLINE_STORE (ews_store))) {
+		camel_ews_journal_add_delete (journal, deleted_items, expunge);
+		ews_delete_messages_from_folder (folder, deleted_items);
+
+		return camel_ews_journal_save (journal, error);
+	}
+
+	if (!camel_ews_store_connected (ews_store, cancellable, error) ||
+	    !ews_folder_replay_journal_sync (CAMEL_EWS_FOLDER (folder), cancellable, error))
 		return FALSE;
 
-	ews_delete_messages_from_server (
-		ews_store,
-		deleted_items,
-		expunge ? EWS_HARD_DELETE : EWS_MOVE_TO_DELETED_ITEMS,
-		cancellable,
-		&local_error);
+	/* Those left with a temporary uid had been refused by the server */
+	for (link = deleted_items; link; link = g_slist_next (link)) {
+		if (camel_ews_journal_is_temp_uid (link->data))
+			with_temp_uids = TRUE;
+		else
+			server_uids = g_slist_prepend (server_uids, link->data);
+	}
+
+	server_uids = g_slist_reverse (server_uids);
+
+	if (with_temp_uids) {
+		camel_ews_journal_remove_rejected (journal, deleted_items);
+		camel_ews_journal_save (journal, NULL);
+	}
+
+	if (server_uids) {
+		ews_delete_messages_from_server (
+			ews_store,
+			server_uids,
+			expunge ? EWS_HARD_DELETE : EWS_MOVE_TO_DELETED_ITEMS,
+			cancellable,
+			&local_error);
+	}
+
+	g_slist_free (server_uids);
 
 	if (local_error != NULL && local_error->code == EWS_CONNECTION_ERROR_ITEMNOTFOUND) {
 			/* If delete failed due to the item not found, ignore the error,
@@ -3009,7 +4011,12 @@ ews_folder_finalize (GObject *object)
 	g_mutex_clear (&ews_folder->priv->state_lock);
 	g_rec_mutex_clear (&ews_folder->priv->cache_lock);
 	g_hash_table_destroy (ews_folder->priv->fetching_uids);
+	g_hash_table_destroy (ews_folder->priv->replayed_uids);
 	g_cond_clear (&ews_folder->priv->fetch_cond);
+	camel_ews_flag_queue_free (ews_folder->priv->flag_queue);
+	camel_ews_journal_free (ews_folder->priv->journal);
+	camel_ews_body_index_save (ews_folder->priv->body_index, NULL);
+	camel_ews_body_index_free (ews_folder->priv->body_index);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_ews_folder_parent_class)->finalize (object);
@@ -3070,6 +4077,7 @@ camel_ews_folder_class_init (CamelEwsFolderClass *class)
 	folder_class = CAMEL_FOLDER_CLASS (class);
 	folder_class->get_permanent_flags = ews_folder_get_permanent_flags;
 	folder_class->get_message_sync = ews_folder_get_message_sync;
+	folder_class->synchronize_message_sync = ews_folder_synchronize_message_sync;
 	folder_class->get_message_cached = ews_folder_get_message_cached;
 	folder_class->search_by_expression = ews_folder_search_by_expression;
 	folder_class->count_by_expression = ews_folder_count_by_expression;
@@ -3102,6 +4110,7 @@ camel_ews_folder_init (CamelEwsFolder *ews_folder)
 
 	g_cond_init (&ews_folder->priv->fetch_cond);
 	ews_folder->priv->fetching_uids = g_hash_table_new (g_str_hash, g_str_equal);
+	ews_folder->priv->replayed_uids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 	camel_folder_set_lock_async (folder, TRUE);
 }
 
@@ -29,6 +29,7 @@
 
 #include <camel/camel.h>
 
+#include "camel-ews-body-index.h"
 #include "camel-ews-summary.h"
 
 /* Standard GObject macros */
@@ -75,6 +76,10 @@ CamelFolder * camel_ews_folder_new (CamelStore *store, const gchar *folder_dir,
 void ews_update_summary ( CamelFolder *folder, GList *item_list, GCancellable *cancellable, GError **error);
 void		camel_ews_folder_remove_cached_message	(CamelEwsFolder *ews_folder,
 							 const gchar *uid);
+CamelEwsBodyIndex *
+		camel_ews_folder_get_body_index		(CamelEwsFolder *ews_folder);
+gboolean	camel_ews_folder_has_queued_flags	(CamelEwsFolder *ews_folder,
+							 const gchar *uid);
 
 G_END_DECLS
 
@@ -0,0 +1,980 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-ews-config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+
+#include <glib/gstdio.h>
+
+#include "server/e-ews-camel-common.h"
+#include "server/e-ews-folder.h"
+
+#include "camel-ews-journal.h"
+
+#define TEMP_UID_PREFIX "ews-journal-"
+
+typedef enum {
+	JOURNAL_OPERATION_APPEND,
+	JOURNAL_OPERATION_DELETE,
+	JOURNAL_OPERATION_TRANSFER
+} JournalOperation;
+
+typedef struct _JournalEntry {
+	JournalOperation operation;
+	gchar *folder_id;	/* for append and transfer */
+	gchar *temp_uid;	/* for append */
+	guint32 flags;		/* for append */
+	GSList *uids;		/* gchar *, for delete and transfer */
+	GSList *temp_uids;	/* gchar *, for transfer, the uids in the destination, one per uids item */
+	gboolean hard_delete;	/* for delete */
+	gboolean copy;		/* for transfer */
+	gboolean rejected;	/* for append, the server refused to store it */
+} JournalEntry;
+
+struct _CamelEwsJournal {
+	GMutex lock;
+	GMutex replay_lock;
+	gchar *filename;
+	gchar *messages_dir;
+	GQueue entries; /* JournalEntry * */
+	GQueue rejected; /* JournalEntry *, appends the server refused */
+	guint temp_counter;
+};
+
+static const gchar *
+journal_operation_to_string (JournalOperation operation)
+{
+	switch (operation) {
+	case JOURNAL_OPERATION_APPEND:
+		return "append";
+	case JOURNAL_OPERATION_DELETE:
+		return "delete";
+	case JOURNAL_OPERATION_TRANSFER:
+		return "transfer";
+	}
+
+	g_warn_if_reached ();
+
+	return NULL;
+}
+
+static void
+journal_entry_free (gpointer ptr)
+{
+	JournalEntry *entry = ptr;
+
+	if (entry) {
+		g_free (entry->folder_id);
+		g_free (entry->temp_uid);
+		g_slist_free_full (entry->uids, g_free);
+		g_slist_free_full (entry->temp_uids, g_free);
+		g_free (entry);
+	}
+}
+
+static GSList *
+journal_dup_uids (const GSList *uids)
+{
+	GSList *copy = NULL;
+	const GSList *link;
+
+	for (link = uids; link; link = g_slist_next (link)) {
+		if (link->data)
+			copy = g_slist_prepend (copy, g_strdup (link->data));
+	}
+
+	return g_slist_reverse (copy);
+}
+
+static gchar *
+journal_new_temp_uid (CamelEwsJournal *journal)
+{
+	gchar *temp_uid;
+
+	g_mutex_lock (&journal->lock);
+	journal->temp_counter++;
+	temp_uid = g_strdup_printf (TEMP_UID_PREFIX "%" G_GINT64_FORMAT "-%u", g_get_real_time (), journal->temp_counter);
+	g_mutex_unlock (&journal->lock);
+
+	return temp_uid;
+}
+
+static gchar *
+journal_dup_message_filename (CamelEwsJournal *journal,
+			      const gchar *temp_uid)
+{
+	return g_build_filename (journal->messages_dir, temp_uid, NULL);
+}
+
+/* Call with the journal->lock held. Replaces the @old_uid in all entries,
+   or removes it from them when the @new_uid is NULL. */
+static void
+journal_rename_uid_locked (CamelEwsJournal *journal,
+			   const gchar *old_uid,
+			   const gchar *new_uid)
+{
+	GList *link;
+
+	for (link = journal->entries.head; link; link = g_list_next (link)) {
+		JournalEntry *entry = link->data;
+		GSList *ulink;
+
+		ulink = g_slist_find_custom (entry->uids, old_uid, (GCompareFunc) g_strcmp0);
+
+		while (ulink) {
+			if (new_uid) {
+				g_free (ulink->data);
+				ulink->data = g_strdup (new_uid);
+			} else {
+				GSList *tlink;
+
+				/* Keep the destination uids in pair with the uids */
+				tlink = g_slist_nth (entry->temp_uids, g_slist_position (entry->uids, ulink));
+				if (tlink) {
+					g_free (tlink->data);
+					entry->temp_uids = g_slist_delete_link (entry->temp_uids, tlink);
+				}
+
+				g_free (ulink->data);
+				entry->uids = g_slist_delete_link (entry->uids, ulink);
+			}
+
+			ulink = g_slist_find_custom (entry->uids, old_uid, (GCompareFunc) g_strcmp0);
+		}
+	}
+}
+
+/* Call with the journal->lock held. Whether the @uid is deleted by any entry. */
+static gboolean
+journal_has_delete_locked (CamelEwsJournal *journal,
+			   const gchar *uid)
+{
+	GList *link;
+
+	for (link = journal->entries.head; link; link = g_list_next (link)) {
+		JournalEntry *entry = link->data;
+
+		if (entry->operation == JOURNAL_OPERATION_DELETE &&
+		    g_slist_find_custom (entry->uids, uid, (GCompareFunc) g_strcmp0))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* Call with the journal->lock held. Removes the first @n_entries entries. */
+static void
+journal_drop_head_locked (CamelEwsJournal *journal,
+			  guint n_entries)
+{
+	while (n_entries > 0 && !g_queue_is_empty (&journal->entries)) {
+		journal_entry_free (g_queue_pop_head (&journal->entries));
+		n_entries--;
+	}
+}
+
+static void
+journal_load (CamelEwsJournal *journal)
+{
+	GKeyFile *key_file;
+	gchar **groups;
+	guint ii;
+
+	key_file = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (key_file, journal->filename, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free (key_file);
+		return;
+	}
+
+	journal->temp_counter = (guint) g_key_file_get_uint64 (key_file, "Journal", "TempCounter", NULL);
+
+	/* The groups are returned in the order of the file */
+	groups = g_key_file_get_groups (key_file, NULL);
+
+	for (ii = 0; groups && groups[ii]; ii++) {
+		JournalEntry *entry;
+		gchar *operation;
+		gchar **uids;
+		guint jj;
+
+		if (!g_str_has_prefix (groups[ii], "Operation-"))
+			continue;
+
+		operation = g_key_file_get_string (key_file, groups[ii], "Type", NULL);
+
+		entry = g_new0 (JournalEntry, 1);
+
+		if (g_strcmp0 (operation, "append") == 0) {
+			entry->operation = JOURNAL_OPERATION_APPEND;
+		} else if (g_strcmp0 (operation, "delete") == 0) {
+			entry->operation = JOURNAL_OPERATION_DELETE;
+		} else if (g_strcmp0 (operation, "transfer") == 0) {
+			entry->operation = JOURNAL_OPERATION_TRANSFER;
+		} else {
+			g_free (operation);
+			g_free (entry);
+			continue;
+		}
+
+		g_free (operation);
+
+		entry->folder_id = g_key_file_get_string (key_file, groups[ii], "FolderId", NULL);
+		entry->temp_uid = g_key_file_get_string (key_file, groups[ii], "TempUid", NULL);
+		entry->flags = (guint32) g_key_file_get_uint64 (key_file, groups[ii], "Flags", NULL);
+		entry->hard_delete = g_key_file_get_boolean (key_file, groups[ii], "HardDelete", NULL);
+		entry->copy = g_key_file_get_boolean (key_file, groups[ii], "Copy", NULL);
+
+		uids = g_key_file_get_string_list (key_file, groups[ii], "Uids", NULL, NULL);
+
+		for (jj = 0; uids && uids[jj]; jj++) {
+			entry->uids = g_slist_prepend (entry->uids, g_strdup (uids[jj]));
+		}
+
+		entry->uids = g_slist_reverse (entry->uids);
+
+		g_strfreev (uids);
+
+		uids = g_key_file_get_string_list (key_file, groups[ii], "TempUids", NULL, NULL);
+
+		for (jj = 0; uids && uids[jj]; jj++) {
+			entry->temp_uids = g_slist_prepend (entry->temp_uids, g_strdup (uids[jj]));
+		}
+
+		entry->temp_uids = g_slist_reverse (entry->temp_uids);
+
+		g_strfreev (uids);
+
+		/* Older journals have no destination uids; mismatched are unusable */
+		if (g_slist_length (entry->temp_uids) != g_slist_length (entry->uids)) {
+			g_slist_free_full (entry->temp_uids, g_free);
+			entry->temp_uids = NULL;
+		}
+
+		if ((entry->operation == JOURNAL_OPERATION_APPEND && (!entry->temp_uid || !entry->folder_id)) ||
+		    (entry->operation == JOURNAL_OPERATION_TRANSFER && !entry->folder_id)) {
+			journal_entry_free (entry);
+			continue;
+		}
+
+		entry->rejected = entry->operation == JOURNAL_OPERATION_APPEND &&
+			g_key_file_get_boolean (key_file, groups[ii], "Rejected", NULL);
+
+		if (entry->rejected)
+			g_queue_push_tail (&journal->rejected, entry);
+		else
+			g_queue_push_tail (&journal->entries, entry);
+	}
+
+	g_strfreev (groups);
+	g_key_file_free (key_file);
+}
+
+CamelEwsJournal *
+camel_ews_journal_new (const gchar *filename)
+{
+	CamelEwsJournal *journal;
+
+	g_return_val_if_fail (filename != NULL, NULL);
+
+	journal = g_new0 (CamelEwsJournal, 1);
+	g_mutex_init (&journal->lock);
+	g_mutex_init (&journal->replay_lock);
+	journal->filename = g_strdup (filename);
+	journal->messages_dir = g_strconcat (filename, "-messages", NULL);
+	g_queue_init (&journal->entries);
+	g_queue_init (&journal->rejected);
+
+	journal_load (journal);
+
+	return journal;
+}
+
+void
+camel_ews_journal_free (CamelEwsJournal *journal)
+{
+	if (!journal)
+		return;
+
+	g_queue_free_full (&journal->entries, journal_entry_free);
+	g_queue_free_full (&journal->rejected, journal_entry_free);
+	g_mutex_clear (&journal->lock);
+	g_mutex_clear (&journal->replay_lock);
+	g_free (journal->filename);
+	g_free (journal->messages_dir);
+	g_free (journal);
+}
+
+gboolean
+camel_ews_journal_is_temp_uid (const gchar *uid)
+{
+	return uid && g_str_has_prefix (uid, TEMP_UID_PREFIX);
+}
+
+/* Stores the @message into the journal directory and returns
+   the temporary uid it should be known under until it is stored
+   on the server. Free the returned string with g_free(). */
+gchar *
+camel_ews_journal_add_append (CamelEwsJournal *journal,
+			      const gchar *folder_id,
+			      CamelMimeMessage *message,
+			      guint32 flags,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	JournalEntry *entry;
+	CamelStream *stream;
+	gchar *temp_uid, *filename;
+
+	g_return_val_if_fail (journal != NULL, NULL);
+	g_return_val_if_fail (folder_id != NULL, NULL);
+	g_return_val_if_fail (CAMEL_IS_MIME_MESSAGE (message), NULL);
+
+	if (g_mkdir_with_parents (journal->messages_dir, 0700) == -1) {
+		gint errn = errno;
+
+		g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errn),
+			"%s", g_strerror (errn));
+
+		return NULL;
+	}
+
+	temp_uid = journal_new_temp_uid (journal);
+
+	filename = journal_dup_message_filename (journal, temp_uid);
+
+	stream = camel_stream_fs_new_with_name (filename, O_WRONLY | O_CREAT | O_TRUNC, 0600, error);
+
+	if (!stream ||
+	    camel_data_wrapper_write_to_stream_sync (CAMEL_DATA_WRAPPER (message), stream, cancellable, error) == -1 ||
+	    camel_stream_close (stream, cancellable, error) == -1) {
+		g_clear_object (&stream);
+		g_unlink (filename);
+		g_free (filename);
+		g_free (temp_uid);
+
+		return NULL;
+	}
+
+	g_object_unref (stream);
+	g_free (filename);
+
+	entry = g_new0 (JournalEntry, 1);
+	entry->operation = JOURNAL_OPERATION_APPEND;
+	entry->folder_id = g_strdup (folder_id);
+	entry->temp_uid = g_strdup (temp_uid);
+	entry->flags = flags;
+
+	g_mutex_lock (&journal->lock);
+	g_queue_push_tail (&journal->entries, entry);
+	g_mutex_unlock (&journal->lock);
+
+	return temp_uid;
+}
+
+void
+camel_ews_journal_add_delete (CamelEwsJournal *journal,
+			      const GSList *uids, /* gchar * */
+			      gboolean hard_delete)
+{
+	JournalEntry *entry;
+
+	g_return_if_fail (journal != NULL);
+
+	if (!uids)
+		return;
+
+	/* Those the server refused are not there, they are only forgotten */
+	camel_ews_journal_remove_rejected (journal, uids);
+
+	entry = g_new0 (JournalEntry, 1);
+	entry->operation = JOURNAL_OPERATION_DELETE;
+	entry->uids = journal_dup_uids (uids);
+	entry->hard_delete = hard_delete;
+
+	g_mutex_lock (&journal->lock);
+	g_queue_push_tail (&journal->entries, entry);
+	g_mutex_unlock (&journal->lock);
+}
+
+/* Forgets the appended messages the server refused to store, which
+   are in the @uids, together with their stored content */
+void
+camel_ews_journal_remove_rejected (CamelEwsJournal *journal,
+				   const GSList *uids) /* gchar * */
+{
+	GSList *removed = NULL, *link;
+	const GSList *ulink;
+
+	g_return_if_fail (journal != NULL);
+
+	g_mutex_lock (&journal->lock);
+
+	for (ulink = uids; ulink && !g_queue_is_empty (&journal->rejected); ulink = g_slist_next (ulink)) {
+		GList *elink;
+
+		if (!camel_ews_journal_is_temp_uid (ulink->data))
+			continue;
+
+		for (elink = journal->rejected.head; elink; elink = g_list_next (elink)) {
+			JournalEntry *entry = elink->data;
+
+			if (g_strcmp0 (entry->temp_uid, ulink->data) == 0) {
+				g_queue_delete_link (&journal->rejected, elink);
+				removed = g_slist_prepend (removed, entry);
+				break;
+			}
+		}
+	}
+
+	g_mutex_unlock (&journal->lock);
+
+	for (link = removed; link; link = g_slist_next (link)) {
+		JournalEntry *entry = link->data;
+		gchar *filename;
+
+		filename = journal_dup_message_filename (journal, entry->temp_uid);
+		g_unlink (filename);
+		g_free (filename);
+	}
+
+	g_slist_free_full (removed, journal_entry_free);
+}
+
+/* Returns the temporary uids the messages should be known under in
+   the destination folder, until the transfer is done on the server,
+   in the order of the @uids. Free the returned list with
+   g_slist_free_full (list, g_free). */
+GSList *
+camel_ews_journal_add_transfer (CamelEwsJournal *journal,
+				const GSList *uids, /* gchar * */
+				const gchar *folder_id,
+				gboolean copy)
+{
+	JournalEntry *entry;
+	GSList *link, *temp_uids;
+
+	g_return_val_if_fail (journal != NULL, NULL);
+	g_return_val_if_fail (folder_id != NULL, NULL);
+
+	if (!uids)
+		return NULL;
+
+	entry = g_new0 (JournalEntry, 1);
+	entry->operation = JOURNAL_OPERATION_TRANSFER;
+	entry->folder_id = g_strdup (folder_id);
+	entry->uids = journal_dup_uids (uids);
+	entry->copy = copy;
+
+	for (link = entry->uids; link; link = g_slist_next (link)) {
+		entry->temp_uids = g_slist_prepend (entry->temp_uids, journal_new_temp_uid (journal));
+	}
+
+	entry->temp_uids = g_slist_reverse (entry->temp_uids);
+	temp_uids = journal_dup_uids (entry->temp_uids);
+
+	g_mutex_lock (&journal->lock);
+	g_queue_push_tail (&journal->entries, entry);
+	g_mutex_unlock (&journal->lock);
+
+	return temp_uids;
+}
+
+guint
+camel_ews_journal_get_length (CamelEwsJournal *journal)
+{
+	guint length;
+
+	g_return_val_if_fail (journal != NULL, 0);
+
+	g_mutex_lock (&journal->lock);
+	length = g_queue_get_length (&journal->entries);
+	g_mutex_unlock (&journal->lock);
+
+	return length;
+}
+
+static void
+journal_save_entry (GKeyFile *key_file,
+		    const JournalEntry *entry,
+		    guint index)
+{
+	gchar *group;
+
+	group = g_strdup_printf ("Operation-%06u", index);
+
+	g_key_file_set_string (key_file, group, "Type", journal_operation_to_string (entry->operation));
+
+	switch (entry->operation) {
+	case JOURNAL_OPERATION_APPEND:
+		g_key_file_set_string (key_file, group, "FolderId", entry->folder_id);
+		g_key_file_set_string (key_file, group, "TempUid", entry->temp_uid);
+		g_key_file_set_uint64 (key_file, group, "Flags", entry->flags);
+		if (entry->rejected)
+			g_key_file_set_boolean (key_file, group, "Rejected", TRUE);
+		break;
+	case JOURNAL_OPERATION_DELETE:
+		g_key_file_set_boolean (key_file, group, "HardDelete", entry->hard_delete);
+		break;
+	case JOURNAL_OPERATION_TRANSFER:
+		g_key_file_set_string (key_file, group, "FolderId", entry->folder_id);
+		g_key_file_set_boolean (key_file, group, "Copy", entry->copy);
+		break;
+	}
+
+	if (entry->uids) {
+		GPtrArray *strv;
+		const GSList *ulink;
+
+		strv = g_ptr_array_new ();
+
+		for (ulink = entry->uids; ulink; ulink = g_slist_next (ulink)) {
+			g_ptr_array_add (strv, ulink->data);
+		}
+
+		g_key_file_set_string_list (key_file, group, "Uids",
+			(const gchar * const *) strv->pdata, strv->len);
+
+		g_ptr_array_unref (strv);
+	}
+
+	if (entry->temp_uids) {
+		GPtrArray *strv;
+		const GSList *ulink;
+
+		strv = g_ptr_array_new ();
+
+		for (ulink = entry->temp_uids; ulink; ulink = g_slist_next (ulink)) {
+			g_ptr_array_add (strv, ulink->data);
+		}
+
+		g_key_file_set_string_list (key_file, group, "TempUids",
+			(const gchar * const *) strv->pdata, strv->len);
+
+		g_ptr_array_unref (strv);
+	}
+
+	g_free (group);
+}
+
+gboolean
+camel_ews_journal_save (CamelEwsJournal *journal,
+			GError **error)
+{
+	GKeyFile *key_file;
+	GList *link;
+	gboolean success;
+	guint index = 0;
+
+	g_return_val_if_fail (journal != NULL, FALSE);
+
+	g_mutex_lock (&journal->lock);
+
+	if (g_queue_is_empty (&journal->entries) && g_queue_is_empty (&journal->rejected)) {
+		g_mutex_unlock (&journal->lock);
+
+		if (g_unlink (journal->filename) == -1 && errno != ENOENT) {
+			gint errn = errno;
+
+			g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errn),
+				"%s", g_strerror (errn));
+
+			return FALSE;
+		}
+
+		return TRUE;
+	}
+
+	key_file = g_key_file_new ();
+
+	g_key_file_set_uint64 (key_file, "Journal", "TempCounter", journal->temp_counter);
+
+	for (link = journal->rejected.head; link; link = g_list_next (link), index++) {
+		journal_save_entry (key_file, link->data, index);
+	}
+
+	for (link = journal->entries.head; link; link = g_list_next (link), index++) {
+		journal_save_entry (key_file, link->data, index);
+	}
+
+	g_mutex_unlock (&journal->lock);
+
+	success = g_key_file_save_to_file (key_file, journal->filename, error);
+
+	g_key_file_free (key_file);
+
+	return success;
+}
+
+/* Whether the operation should be tried again later, rather than dropped */
+static gboolean
+journal_is_transient_error (const GError *error)
+{
+	if (!error)
+		return FALSE;
+
+	if (error->domain != EWS_CONNECTION_ERROR)
+		return !g_error_matches (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) &&
+			error->domain != G_FILE_ERROR;
+
+	return error->code == EWS_CONNECTION_ERROR_NORESPONSE ||
+		error->code == EWS_CONNECTION_ERROR_SERVERBUSY ||
+		error->code == EWS_CONNECTION_ERROR_UNAVAILABLE ||
+		error->code == EWS_CONNECTION_ERROR_AUTHENTICATION_FAILED;
+}
+
+static CamelMimeMessage *
+journal_load_message (const gchar *filename,
+		      GCancellable *cancellable,
+		      GError **error)
+{
+	CamelMimeMessage *message;
+	CamelStream *stream;
+
+	stream = camel_stream_fs_new_with_name (filename, O_RDONLY, 0, error);
+	if (!stream)
+		return NULL;
+
+	message = camel_mime_message_new ();
+
+	if (!camel_data_wrapper_construct_from_stream_sync (CAMEL_DATA_WRAPPER (message), stream, cancellable, error))
+		g_clear_object (&message);
+
+	g_object_unref (stream);
+
+	return message;
+}
+
+static gboolean
+journal_replay_append_sync (CamelEwsJournal *journal,
+			    EEwsConnection *cnc,
+			    const gchar *temp_uid,
+			    const gchar *folder_id,
+			    guint32 flags,
+			    CamelEwsJournalUidFunc uid_func,
+			    gpointer user_data,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	CamelMimeMessage *message;
+	gchar *filename, *item_id = NULL, *change_key = NULL;
+	GError *local_error = NULL;
+	gboolean success = FALSE;
+	gboolean keep_file = FALSE;
+
+	filename = journal_dup_message_filename (journal, temp_uid);
+	message = journal_load_message (filename, cancellable, &local_error);
+
+	if (message) {
+		CamelMessageInfo *info;
+		EwsFolderId *fid;
+
+		info = camel_message_info_new (NULL);
+		camel_message_info_set_flags (info, ~0, flags);
+
+		fid = e_ews_folder_id_new (folder_id, NULL, FALSE);
+
+		success = camel_ews_utils_create_mime_message (
+			cnc, "SaveOnly", fid, message, info,
+			CAMEL_ADDRESS (camel_mime_message_get_from (message)), NULL,
+			&item_id, &change_key, cancellable, &local_error);
+
+		e_ews_folder_id_free (fid);
+		g_object_unref (info);
+		g_object_unref (message);
+	}
+
+	if (!success && journal_is_transient_error (local_error)) {
+		g_propagate_error (error, local_error);
+		g_free (filename);
+
+		return FALSE;
+	}
+
+	g_mutex_lock (&journal->lock);
+
+	if (success || journal_has_delete_locked (journal, temp_uid)) {
+		/* Either stored, or refused, but deleted locally meanwhile */
+		journal_drop_head_locked (journal, 1);
+		journal_rename_uid_locked (journal, temp_uid, item_id);
+	} else {
+		JournalEntry *entry;
+
+		/* The server refused it; the message is kept, until it is deleted locally */
+		entry = g_queue_pop_head (&journal->entries);
+		entry->rejected = TRUE;
+		g_queue_push_tail (&journal->rejected, entry);
+
+		keep_file = TRUE;
+	}
+
+	g_mutex_unlock (&journal->lock);
+
+	if (uid_func && (success || keep_file))
+		uid_func (temp_uid, item_id, change_key, local_error, user_data);
+
+	if (!keep_file)
+		g_unlink (filename);
+
+	g_clear_error (&local_error);
+	g_free (change_key);
+	g_free (item_id);
+	g_free (filename);
+
+	return TRUE;
+}
+
+static gboolean
+journal_replay_delete_sync (CamelEwsJournal *journal,
+			    EEwsConnection *cnc,
+			    const GSList *uids,
+			    gboolean hard_delete,
+			    guint n_entries,
+			    gboolean *out_conflicts,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	GError *local_error = NULL;
+	gboolean success = TRUE;
+
+	if (uids) {
+		success = e_ews_connection_delete_items_in_chunks_sync (
+			cnc, EWS_PRIORITY_MEDIUM, uids,
+			hard_delete ? EWS_HARD_DELETE : EWS_MOVE_TO_DELETED_ITEMS,
+			EWS_SEND_TO_NONE, EWS_NONE_OCCURRENCES,
+			cancellable, &local_error);
+	}
+
+	/* The message vanished meanwhile, which is the same as deleted */
+	if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_ITEMNOTFOUND)) {
+		g_clear_error (&local_error);
+		success = TRUE;
+	}
+
+	if (!success && journal_is_transient_error (local_error)) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	if (!success)
+		*out_conflicts = TRUE;
+
+	g_clear_error (&local_error);
+
+	g_mutex_lock (&journal->lock);
+	journal_drop_head_locked (journal, n_entries);
+	g_mutex_unlock (&journal->lock);
+
+	return TRUE;
+}
+
+static gboolean
+journal_replay_transfer_sync (CamelEwsJournal *journal,
+			      EEwsConnection *cnc,
+			      const GSList *uids,
+			      const GSList *temp_uids, /* gchar *, can hold NULL */
+			      const gchar *folder_id,
+			      gboolean copy,
+			      guint n_entries,
+			      CamelEwsJournalTransferFunc transfer_func,
+			      gpointer user_data,
+			      gboolean *out_conflicts,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	GSList *items = NULL;
+	const GSList *ulink, *tlink, *ilink;
+	GError *local_error = NULL;
+	gboolean success = TRUE;
+
+	if (uids) {
+		success = e_ews_connection_move_items_in_chunks_sync (
+			cnc, EWS_PRIORITY_MEDIUM, folder_id, copy,
+			uids, &items, cancellable, &local_error);
+	}
+
+	for (ulink = uids, tlink = temp_uids, ilink = items;
+	     ulink && ilink;
+	     ulink = g_slist_next (ulink), tlink = g_slist_next (tlink), ilink = g_slist_next (ilink)) {
+		EEwsItem *item = ilink->data;
+		const EwsId *id = NULL;
+
+		if (item && e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR) {
+			if (!g_error_matches (e_ews_item_get_error (item), EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_ITEMNOTFOUND))
+				*out_conflicts = TRUE;
+		} else if (item) {
+			id = e_ews_item_get_id (item);
+		}
+
+		if (transfer_func && tlink && tlink->data)
+			transfer_func (folder_id, tlink->data, id ? id->id : NULL, id ? id->change_key : NULL, user_data);
+	}
+
+	/* The message vanished meanwhile, thus there is nothing to move */
+	if (g_error_matches (local_error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_ITEMNOTFOUND)) {
+		g_clear_error (&local_error);
+		success = TRUE;
+	}
+
+	if (!success && journal_is_transient_error (local_error)) {
+		/* Forget those already moved, the others are tried the next time */
+		if (items) {
+			guint n_done = g_slist_length (items);
+
+			g_mutex_lock (&journal->lock);
+
+			for (ulink = uids; ulink && n_done > 0; ulink = g_slist_next (ulink), n_done--) {
+				journal_rename_uid_locked (journal, ulink->data, NULL);
+			}
+
+			g_mutex_unlock (&journal->lock);
+		}
+
+		g_slist_free_full (items, g_object_unref);
+		g_propagate_error (error, local_error);
+
+		return FALSE;
+	}
+
+	if (!success)
+		*out_conflicts = TRUE;
+
+	/* Those without any result are not transferred and are not tried again */
+	for (; tlink; tlink = g_slist_next (tlink)) {
+		if (transfer_func && tlink->data)
+			transfer_func (folder_id, tlink->data, NULL, NULL, user_data);
+	}
+
+	g_slist_free_full (items, g_object_unref);
+	g_clear_error (&local_error);
+
+	g_mutex_lock (&journal->lock);
+	journal_drop_head_locked (journal, n_entries);
+	g_mutex_unlock (&journal->lock);
+
+	return TRUE;
+}
+
+/* Sends the journal operations to the server in their order; consecutive
+   deletes, and consecutive moves into the same folder, are sent together.
+   The @out_conflicts is set to TRUE when any operation could not be done
+   as recorded, which means the local state differs from the server state.
+   Operations which failed due to a connection error are kept for the next
+   time. Appended messages the server refused are kept aside, with their
+   content, and are reported through the @uid_func. The outcome of each
+   transferred message is reported through the @transfer_func. */
+gboolean
+camel_ews_journal_replay_sync (CamelEwsJournal *journal,
+			       EEwsConnection *cnc,
+			       CamelEwsJournalUidFunc uid_func,
+			       CamelEwsJournalTransferFunc transfer_func,
+			       gpointer user_data,
+			       gboolean *out_conflicts,
+			       GCancellable *cancellable,
+			       GError **error)
+{
+	gboolean conflicts = FALSE;
+	gboolean success = TRUE;
+
+	g_return_val_if_fail (journal != NULL, FALSE);
+	g_return_val_if_fail (E_IS_EWS_CONNECTION (cnc), FALSE);
+
+	g_mutex_lock (&journal->replay_lock);
+
+	while (success) {
+		JournalEntry *entry;
+		JournalOperation operation;
+		GSList *uids = NULL, *temp_uids = NULL;
+		gchar *folder_id, *temp_uid;
+		guint32 flags;
+		gboolean flag;
+		guint n_entries = 0;
+		GList *link;
+
+		g_mutex_lock (&journal->lock);
+
+		entry = g_queue_peek_head (&journal->entries);
+		if (!entry) {
+			g_mutex_unlock (&journal->lock);
+			break;
+		}
+
+		operation = entry->operation;
+		folder_id = g_strdup (entry->folder_id);
+		temp_uid = g_strdup (entry->temp_uid);
+		flags = entry->flags;
+		flag = operation == JOURNAL_OPERATION_DELETE ? entry->hard_delete : entry->copy;
+
+		if (operation != JOURNAL_OPERATION_APPEND) {
+			for (link = journal->entries.head; link; link = g_list_next (link)) {
+				JournalEntry *next = link->data;
+				GSList *ulink, *tlink;
+
+				if (next->operation != operation ||
+				    (operation == JOURNAL_OPERATION_DELETE && next->hard_delete != flag) ||
+				    (operation == JOURNAL_OPERATION_TRANSFER && (next->copy != flag ||
+				    g_strcmp0 (next->folder_id, folder_id) != 0)))
+					break;
+
+				/* Temporary uids left are of messages, which could not be stored */
+				for (ulink = next->uids, tlink = next->temp_uids; ulink; ulink = g_slist_next (ulink), tlink = g_slist_next (tlink)) {
+					if (!camel_ews_journal_is_temp_uid (ulink->data)) {
+						uids = g_slist_prepend (uids, g_strdup (ulink->data));
+						temp_uids = g_slist_prepend (temp_uids, g_strdup (tlink ? tlink->data : NULL));
+					}
+				}
+
+				n_entries++;
+			}
+
+			uids = g_slist_reverse (uids);
+			temp_uids = g_slist_reverse (temp_uids);
+		}
+
+		g_mutex_unlock (&journal->lock);
+
+		switch (operation) {
+		case JOURNAL_OPERATION_APPEND:
+			success = journal_replay_append_sync (journal, cnc, temp_uid, folder_id, flags,
+				uid_func, user_data, cancellable, error);
+			break;
+		case JOURNAL_OPERATION_DELETE:
+			success = journal_replay_delete_sync (journal, cnc, uids, flag, n_entries,
+				&conflicts, cancellable, error);
+			break;
+		case JOURNAL_OPERATION_TRANSFER:
+			success = journal_replay_transfer_sync (journal, cnc, uids, temp_uids, folder_id, flag, n_entries,
+				transfer_func, user_data, &conflicts, cancellable, error);
+			break;
+		}
+
+		g_slist_free_full (uids, g_free);
+		g_slist_free_full (temp_uids, g_free);
+		g_free (folder_id);
+		g_free (temp_uid);
+
+		/* Store the progress after each step */
+		camel_ews_journal_save (journal, NULL);
+	}
+
+	g_mutex_unlock (&journal->replay_lock);
+
+	if (out_conflicts)
+		*out_conflicts = conflicts;
+
+	return success;
+}
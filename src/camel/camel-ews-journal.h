@@ -0,0 +1,86 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAMEL_EWS_JOURNAL_H
+#define CAMEL_EWS_JOURNAL_H
+
+#include <camel/camel.h>
+
+#include "server/e-ews-connection.h"
+
+G_BEGIN_DECLS
+
+/* Appends, deletes and moves of messages done while offline, in the order
+   they had been done. Appended and transferred messages get a temporary uid,
+   which is replaced with the server item id once the message is created on
+   (or transferred to) the server.
+   The journal is stored in a file, the appended messages in a directory
+   next to it. */
+typedef struct _CamelEwsJournal CamelEwsJournal;
+
+/* Called when an appended message had been stored on the server, or with
+   the @item_id NULL and the @error set when the server refused to store it.
+   The refused message is kept in the journal, under its temporary uid,
+   until it is removed with camel_ews_journal_remove_rejected(). */
+typedef void	(* CamelEwsJournalUidFunc)	(const gchar *temp_uid,
+						 const gchar *item_id,
+						 const gchar *change_key,
+						 const GError *error,
+						 gpointer user_data);
+
+/* Called when a transferred message had been transferred on the server,
+   with the @item_id NULL when it had not been transferred. The @temp_uid
+   is the uid the message is known under in the folder of the @folder_id. */
+typedef void	(* CamelEwsJournalTransferFunc)	(const gchar *folder_id,
+						 const gchar *temp_uid,
+						 const gchar *item_id,
+						 const gchar *change_key,
+						 gpointer user_data);
+
+CamelEwsJournal *
+		camel_ews_journal_new		(const gchar *filename);
+void		camel_ews_journal_free		(CamelEwsJournal *journal);
+gboolean	camel_ews_journal_is_temp_uid	(const gchar *uid);
+gchar *		camel_ews_journal_add_append	(CamelEwsJournal *journal,
+						 const gchar *folder_id,
+						 CamelMimeMessage *message,
+						 guint32 flags,
+						 GCancellable *cancellable,
+						 GError **error);
+void		camel_ews_journal_add_delete	(CamelEwsJournal *journal,
+						 const GSList *uids, /* gchar * */
+						 gboolean hard_delete);
+void		camel_ews_journal_remove_rejected
+						(CamelEwsJournal *journal,
+						 const GSList *uids); /* gchar * */
+GSList *	camel_ews_journal_add_transfer	(CamelEwsJournal *journal, /* gchar * */
+						 const GSList *uids, /* gchar * */
+						 const gchar *folder_id,
+						 gboolean copy);
+guint		camel_ews_journal_get_length	(CamelEwsJournal *journal);
+gboolean	camel_ews_journal_save		(CamelEwsJournal *journal,
+						 GError **error);
+gboolean	camel_ews_journal_replay_sync	(CamelEwsJournal *journal,
+						 EEwsConnection *cnc,
+						 CamelEwsJournalUidFunc uid_func,
+						 CamelEwsJournalTransferFunc transfer_func,
+						 gpointer user_data,
+						 gboolean *out_conflicts,
+						 GCancellable *cancellable,
+						 GError **error);
+
+G_END_DECLS
+
+#endif /* CAMEL_EWS_JOURNAL_H */
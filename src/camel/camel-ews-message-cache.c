@@ -0,0 +1,756 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-ews-config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <glib/gstdio.h>
+
+#include "camel-ews-message-cache.h"
+
+/* The first bytes of a gzip stream; no MIME message starts with them */
+#define GZIP_MAGIC_0 0x1f
+#define GZIP_MAGIC_1 0x8b
+
+/* Suffix of the files being (de)compressed */
+#define TEMP_SUFFIX "~"
+
+typedef struct _CacheDirectory {
+	gchar *path;
+	GWeakRef owner;		/* GObject *, notified about the evicted files */
+	CamelEwsMessageCacheEvictFunc evict_func;
+} CacheDirectory;
+
+typedef struct _CacheEntry {
+	gchar *filename;
+	gchar *uid;		/* of the message in the owner of the directory, if known */
+	CacheDirectory *directory; /* not owned, can be NULL */
+	goffset size;
+	gint64 last_read;	/* real time in microseconds */
+	gboolean keep;		/* never removed by the cache */
+	GList *link;		/* in the CamelEwsMessageCache::lru */
+} CacheEntry;
+
+struct _CamelEwsMessageCache {
+	GMutex lock;
+	GHashTable *entries;	/* const gchar *filename ~> CacheEntry *, the key is owned by the entry */
+	GQueue lru;		/* CacheEntry *, the most recently read first */
+	GHashTable *directories; /* const gchar *path ~> CacheDirectory *, the key is owned by the value */
+	guint64 size_limit;	/* 0 for no limit */
+	gsize compress_min_size; /* 0 to not compress at all */
+	guint64 size;
+};
+
+static void
+cache_entry_free (gpointer ptr)
+{
+	CacheEntry *entry = ptr;
+
+	if (entry) {
+		g_free (entry->filename);
+		g_free (entry->uid);
+		g_free (entry);
+	}
+}
+
+static void
+cache_directory_free (gpointer ptr)
+{
+	CacheDirectory *directory = ptr;
+
+	if (directory) {
+		g_weak_ref_clear (&directory->owner);
+		g_free (directory->path);
+		g_free (directory);
+	}
+}
+
+static gint
+cache_entry_compare_last_read_desc (gconstpointer ptr1,
+				    gconstpointer ptr2)
+{
+	const CacheEntry *entry1 = ptr1, *entry2 = ptr2;
+
+	if (entry1->last_read == entry2->last_read)
+		return 0;
+
+	return entry1->last_read > entry2->last_read ? -1 : 1;
+}
+
+static gboolean
+message_cache_file_is_compressed (const gchar *filename)
+{
+	FILE *file;
+	guchar magic[2];
+	gboolean is_compressed = FALSE;
+
+	file = g_fopen (filename, "rb");
+	if (file) {
+		is_compressed = fread (magic, 1, 2, file) == 2 &&
+			magic[0] == GZIP_MAGIC_0 &&
+			magic[1] == GZIP_MAGIC_1;
+
+		fclose (file);
+	}
+
+	return is_compressed;
+}
+
+/* Converts the @filename with the @converter into a temporary file, which
+   replaces the @filename. With @only_if_smaller the @filename is left
+   unchanged when the converted content is not smaller. */
+static gboolean
+message_cache_convert_file (const gchar *filename,
+			    GConverter *converter,
+			    gboolean only_if_smaller,
+			    GCancellable *cancellable,
+			    GError **error)
+{
+	GFile *file, *temp_file;
+	GFileInputStream *input_stream;
+	GFileOutputStream *output_stream;
+	GOutputStream *converter_stream;
+	GStatBuf st_orig, st_temp;
+	gchar *temp_filename;
+	gboolean success;
+
+	temp_filename = g_strconcat (filename, TEMP_SUFFIX, NULL);
+	file = g_file_new_for_path (filename);
+	temp_file = g_file_new_for_path (temp_filename);
+
+	input_stream = g_file_read (file, cancellable, error);
+	if (!input_stream) {
+		g_object_unref (temp_file);
+		g_object_unref (file);
+		g_free (temp_filename);
+
+		return FALSE;
+	}
+
+	output_stream = g_file_replace (temp_file, NULL, FALSE, G_FILE_CREATE_PRIVATE, cancellable, error);
+	if (!output_stream) {
+		g_object_unref (input_stream);
+		g_object_unref (temp_file);
+		g_object_unref (file);
+		g_free (temp_filename);
+
+		return FALSE;
+	}
+
+	converter_stream = g_converter_output_stream_new (G_OUTPUT_STREAM (output_stream), converter);
+
+	success = g_output_stream_splice (converter_stream, G_INPUT_STREAM (input_stream),
+		G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE | G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+		cancellable, error) != -1;
+
+	g_object_unref (converter_stream);
+	g_object_unref (output_stream);
+	g_object_unref (input_stream);
+
+	if (success && only_if_smaller &&
+	    g_stat (filename, &st_orig) == 0 &&
+	    g_stat (temp_filename, &st_temp) == 0 &&
+	    st_temp.st_size >= st_orig.st_size) {
+		g_unlink (temp_filename);
+	} else if (success && g_rename (temp_filename, filename) == -1) {
+		g_set_error (
+			error, G_IO_ERROR,
+			g_io_error_from_errno (errno),
+			"Failed to rename '%s' to '%s': %s",
+			temp_filename, filename, g_strerror (errno));
+		success = FALSE;
+	}
+
+	if (!success)
+		g_unlink (temp_filename);
+
+	g_object_unref (temp_file);
+	g_object_unref (file);
+	g_free (temp_filename);
+
+	return success;
+}
+
+static gboolean
+message_cache_compress_file (const gchar *filename,
+			     GCancellable *cancellable,
+			     GError **error)
+{
+	GZlibCompressor *compressor;
+	gboolean success;
+
+	compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+
+	success = message_cache_convert_file (filename, G_CONVERTER (compressor), TRUE, cancellable, error);
+
+	g_object_unref (compressor);
+
+	return success;
+}
+
+/* Call with the cache->lock held */
+static void
+message_cache_remove_entry_locked (CamelEwsMessageCache *cache,
+				   CacheEntry *entry)
+{
+	g_queue_delete_link (&cache->lru, entry->link);
+	cache->size -= entry->size;
+
+	/* Frees the entry */
+	g_hash_table_remove (cache->entries, entry->filename);
+}
+
+/* Call with the cache->lock held */
+static void
+message_cache_touch_entry_locked (CamelEwsMessageCache *cache,
+				  CacheEntry *entry)
+{
+	entry->last_read = g_get_real_time ();
+
+	g_queue_unlink (&cache->lru, entry->link);
+	g_queue_push_head_link (&cache->lru, entry->link);
+}
+
+/* Call with the cache->lock held. Stops tracking the least recently read files
+   above the size limit and returns them, to be removed without the lock held. */
+static GSList * /* CacheEntry * */
+message_cache_steal_evicted_locked (CamelEwsMessageCache *cache)
+{
+	GSList *evicted = NULL;
+	GList *link, *prev;
+
+	if (!cache->size_limit)
+		return NULL;
+
+	/* The most recently read file stays, even when it alone exceeds the limit */
+	for (link = cache->lru.tail; link && link != cache->lru.head && cache->size > cache->size_limit; link = prev) {
+		CacheEntry *entry = link->data;
+
+		prev = g_list_previous (link);
+
+		if (entry->keep)
+			continue;
+
+		g_queue_delete_link (&cache->lru, entry->link);
+		cache->size -= entry->size;
+		entry->link = NULL;
+
+		g_hash_table_steal (cache->entries, entry->filename);
+
+		evicted = g_slist_prepend (evicted, entry);
+	}
+
+	return evicted;
+}
+
+/* Call with the cache->lock held */
+static CacheDirectory *
+message_cache_lookup_directory_locked (CamelEwsMessageCache *cache,
+				       const gchar *filename)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, cache->directories);
+
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		CacheDirectory *directory = value;
+		gsize len = strlen (directory->path);
+
+		if (strncmp (filename, directory->path, len) == 0 && G_IS_DIR_SEPARATOR (filename[len]))
+			return directory;
+	}
+
+	return NULL;
+}
+
+static void
+message_cache_scan_directory (const gchar *path,
+			      CacheDirectory *directory,
+			      GSList **pentries) /* CacheEntry * */
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (!dir)
+		return;
+
+	while ((name = g_dir_read_name (dir)) != NULL) {
+		gchar *filename;
+		GStatBuf st;
+
+		/* Left behind by an interrupted compression */
+		if (g_str_has_suffix (name, TEMP_SUFFIX))
+			continue;
+
+		filename = g_build_filename (path, name, NULL);
+
+		if (g_stat (filename, &st) == 0) {
+			if (S_ISDIR (st.st_mode)) {
+				message_cache_scan_directory (filename, directory, pentries);
+			} else if (S_ISREG (st.st_mode)) {
+				CacheEntry *entry;
+
+				/* The access time is not updated on all file systems,
+				   thus the file could be read later than it tells */
+				entry = g_new0 (CacheEntry, 1);
+				entry->filename = filename;
+				entry->directory = directory;
+				entry->size = st.st_size;
+				entry->last_read = ((gint64) MAX (st.st_atime, st.st_mtime)) * G_USEC_PER_SEC;
+
+				*pentries = g_slist_prepend (*pentries, entry);
+
+				continue;
+			}
+		}
+
+		g_free (filename);
+	}
+
+	g_dir_close (dir);
+}
+
+/* The @size_limit is in bytes, 0 for no limit. Files of at least
+   @compress_min_size bytes are compressed, 0 to not compress at all. */
+CamelEwsMessageCache *
+camel_ews_message_cache_new (guint64 size_limit,
+			     gsize compress_min_size)
+{
+	CamelEwsMessageCache *cache;
+
+	cache = g_new0 (CamelEwsMessageCache, 1);
+	g_mutex_init (&cache->lock);
+	cache->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, cache_entry_free);
+	cache->directories = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, cache_directory_free);
+	g_queue_init (&cache->lru);
+	cache->size_limit = size_limit;
+	cache->compress_min_size = compress_min_size;
+
+	return cache;
+}
+
+void
+camel_ews_message_cache_free (CamelEwsMessageCache *cache)
+{
+	if (!cache)
+		return;
+
+	g_queue_clear (&cache->lru);
+	g_hash_table_destroy (cache->entries);
+	g_hash_table_destroy (cache->directories);
+	g_mutex_clear (&cache->lock);
+	g_free (cache);
+}
+
+/* Removes the least recently read files right away,
+   when the @size_limit is lower than the current size */
+void
+camel_ews_message_cache_set_size_limit (CamelEwsMessageCache *cache,
+					guint64 size_limit)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_lock (&cache->lock);
+	cache->size_limit = size_limit;
+	g_mutex_unlock (&cache->lock);
+
+	camel_ews_message_cache_evict (cache);
+}
+
+guint64
+camel_ews_message_cache_get_size_limit (CamelEwsMessageCache *cache)
+{
+	guint64 size_limit;
+
+	g_return_val_if_fail (cache != NULL, 0);
+
+	g_mutex_lock (&cache->lock);
+	size_limit = cache->size_limit;
+	g_mutex_unlock (&cache->lock);
+
+	return size_limit;
+}
+
+guint64
+camel_ews_message_cache_get_size (CamelEwsMessageCache *cache)
+{
+	guint64 size;
+
+	g_return_val_if_fail (cache != NULL, 0);
+
+	g_mutex_lock (&cache->lock);
+	size = cache->size;
+	g_mutex_unlock (&cache->lock);
+
+	return size;
+}
+
+/* Starts tracking the files already stored in the @path and its
+   subdirectories. Each directory is read only once. Nothing is removed
+   yet, thus the caller can mark the files to keep first. The evicted files
+   of messages with a known UID are removed by the @evict_func of the @owner,
+   while it exists, otherwise the files are removed by the cache itself. */
+void
+camel_ews_message_cache_add_directory (CamelEwsMessageCache *cache,
+				       const gchar *path,
+				       GObject *owner,
+				       CamelEwsMessageCacheEvictFunc evict_func)
+{
+	CacheDirectory *directory;
+	GSList *found = NULL, *link;
+	GList *sibling;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (path != NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	directory = g_hash_table_lookup (cache->directories, path);
+
+	if (directory) {
+		/* Like when the folder is opened again */
+		g_weak_ref_set (&directory->owner, owner);
+		directory->evict_func = evict_func;
+
+		g_mutex_unlock (&cache->lock);
+		return;
+	}
+
+	directory = g_new0 (CacheDirectory, 1);
+	directory->path = g_strdup (path);
+	g_weak_ref_init (&directory->owner, owner);
+	directory->evict_func = evict_func;
+
+	g_hash_table_insert (cache->directories, directory->path, directory);
+
+	g_mutex_unlock (&cache->lock);
+
+	message_cache_scan_directory (path, directory, &found);
+
+	found = g_slist_sort (found, cache_entry_compare_last_read_desc);
+
+	g_mutex_lock (&cache->lock);
+
+	/* Both are sorted, the most recently read first */
+	sibling = cache->lru.head;
+
+	for (link = found; link; link = g_slist_next (link)) {
+		CacheEntry *entry = link->data;
+
+		if (g_hash_table_contains (cache->entries, entry->filename)) {
+			cache_entry_free (entry);
+			continue;
+		}
+
+		while (sibling && ((CacheEntry *) sibling->data)->last_read > entry->last_read)
+			sibling = g_list_next (sibling);
+
+		if (sibling) {
+			g_queue_insert_before (&cache->lru, sibling, entry);
+			entry->link = g_list_previous (sibling);
+		} else {
+			g_queue_push_tail (&cache->lru, entry);
+			entry->link = cache->lru.tail;
+		}
+
+		g_hash_table_insert (cache->entries, entry->filename, entry);
+		cache->size += entry->size;
+	}
+
+	g_mutex_unlock (&cache->lock);
+
+	g_slist_free (found);
+}
+
+/* Notes a newly written file of the message @uid, as the most recently read.
+   The file is compressed when it is large enough. With @keep set the file
+   is never removed by the cache, because it cannot be downloaded again.
+   Call camel_ews_message_cache_evict() afterwards. */
+void
+camel_ews_message_cache_add_file (CamelEwsMessageCache *cache,
+				  const gchar *filename,
+				  const gchar *uid,
+				  gboolean keep)
+{
+	CacheEntry *entry;
+	GStatBuf st;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (filename != NULL);
+
+	if (g_stat (filename, &st) == -1)
+		return;
+
+	if (cache->compress_min_size && st.st_size >= cache->compress_min_size &&
+	    !message_cache_file_is_compressed (filename)) {
+		GError *local_error = NULL;
+
+		if (!message_cache_compress_file (filename, NULL, &local_error)) {
+			g_warning ("%s: Failed to compress '%s': %s", G_STRFUNC, filename,
+				local_error ? local_error->message : "Unknown error");
+		}
+
+		g_clear_error (&local_error);
+
+		if (g_stat (filename, &st) == -1)
+			return;
+	}
+
+	g_mutex_lock (&cache->lock);
+
+	entry = g_hash_table_lookup (cache->entries, filename);
+
+	if (entry) {
+		cache->size -= entry->size;
+		message_cache_touch_entry_locked (cache, entry);
+	} else {
+		entry = g_new0 (CacheEntry, 1);
+		entry->filename = g_strdup (filename);
+		entry->directory = message_cache_lookup_directory_locked (cache, filename);
+		entry->last_read = g_get_real_time ();
+
+		g_queue_push_head (&cache->lru, entry);
+		entry->link = cache->lru.head;
+
+		g_hash_table_insert (cache->entries, entry->filename, entry);
+	}
+
+	if (uid && g_strcmp0 (entry->uid, uid) != 0) {
+		g_free (entry->uid);
+		entry->uid = g_strdup (uid);
+	}
+
+	entry->size = st.st_size;
+	entry->keep = keep;
+	cache->size += entry->size;
+
+	g_mutex_unlock (&cache->lock);
+}
+
+/* Sets the UID of the message stored in the @filename, for the evict function
+   of the directory owner; the files found in the directory have no UID */
+void
+camel_ews_message_cache_set_uid (CamelEwsMessageCache *cache,
+				 const gchar *filename,
+				 const gchar *uid)
+{
+	CacheEntry *entry;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (filename != NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	entry = g_hash_table_lookup (cache->entries, filename);
+	if (entry && g_strcmp0 (entry->uid, uid) != 0) {
+		g_free (entry->uid);
+		entry->uid = g_strdup (uid);
+	}
+
+	g_mutex_unlock (&cache->lock);
+}
+
+void
+camel_ews_message_cache_set_keep (CamelEwsMessageCache *cache,
+				  const gchar *filename,
+				  gboolean keep)
+{
+	CacheEntry *entry;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (filename != NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	entry = g_hash_table_lookup (cache->entries, filename);
+	if (entry)
+		entry->keep = keep;
+
+	g_mutex_unlock (&cache->lock);
+}
+
+/* Notes the file had been read */
+void
+camel_ews_message_cache_touch_file (CamelEwsMessageCache *cache,
+				    const gchar *filename)
+{
+	CacheEntry *entry;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (filename != NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	entry = g_hash_table_lookup (cache->entries, filename);
+	if (entry)
+		message_cache_touch_entry_locked (cache, entry);
+
+	g_mutex_unlock (&cache->lock);
+}
+
+/* Stops tracking the file, which had been removed by the caller */
+void
+camel_ews_message_cache_remove_file (CamelEwsMessageCache *cache,
+				     const gchar *filename)
+{
+	CacheEntry *entry;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (filename != NULL);
+
+	g_mutex_lock (&cache->lock);
+
+	entry = g_hash_table_lookup (cache->entries, filename);
+	if (entry)
+		message_cache_remove_entry_locked (cache, entry);
+
+	g_mutex_unlock (&cache->lock);
+}
+
+/* Removes the least recently read files, until the size is below the limit.
+   The files are removed by the evict function of their directory owner, if
+   any, thus call this without holding any lock the evict function takes. */
+void
+camel_ews_message_cache_evict (CamelEwsMessageCache *cache)
+{
+	GSList *evicted, *link;
+
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_lock (&cache->lock);
+	evicted = message_cache_steal_evicted_locked (cache);
+	g_mutex_unlock (&cache->lock);
+
+	/* The least recently read first */
+	evicted = g_slist_reverse (evicted);
+
+	for (link = evicted; link; link = g_slist_next (link)) {
+		CacheEntry *entry = link->data;
+		GObject *owner = NULL;
+
+		if (entry->uid && entry->directory)
+			owner = g_weak_ref_get (&entry->directory->owner);
+
+		if (owner && entry->directory->evict_func) {
+			entry->directory->evict_func (owner, entry->uid);
+		} else if (g_unlink (entry->filename) == -1 && errno != ENOENT) {
+			g_warning ("%s: Failed to remove '%s': %s", G_STRFUNC, entry->filename, g_strerror (errno));
+		}
+
+		g_clear_object (&owner);
+	}
+
+	g_slist_free_full (evicted, cache_entry_free);
+}
+
+/* Stores the file uncompressed, for readers which do not go through
+   the camel_ews_message_cache_wrap_stream(). Call camel_ews_message_cache_evict()
+   afterwards. */
+gboolean
+camel_ews_message_cache_decompress_file (CamelEwsMessageCache *cache,
+					 const gchar *filename,
+					 GCancellable *cancellable,
+					 GError **error)
+{
+	GZlibDecompressor *decompressor;
+	CacheEntry *entry;
+	GStatBuf st;
+	gboolean success;
+
+	g_return_val_if_fail (cache != NULL, FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+
+	if (!message_cache_file_is_compressed (filename))
+		return TRUE;
+
+	decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+
+	success = message_cache_convert_file (filename, G_CONVERTER (decompressor), FALSE, cancellable, error);
+
+	g_object_unref (decompressor);
+
+	if (success && g_stat (filename, &st) == 0) {
+		g_mutex_lock (&cache->lock);
+
+		entry = g_hash_table_lookup (cache->entries, filename);
+		if (entry) {
+			cache->size -= entry->size;
+			entry->size = st.st_size;
+			cache->size += entry->size;
+		}
+
+		g_mutex_unlock (&cache->lock);
+	}
+
+	return success;
+}
+
+/* Returns a stream to read the message from the @base_stream, which
+   is decompressed while being read, when it had been stored compressed */
+CamelStream *
+camel_ews_message_cache_wrap_stream (GIOStream *base_stream,
+				     GCancellable *cancellable,
+				     GError **error)
+{
+	GInputStream *input_stream;
+	GConverter *decompressor;
+	GInputStream *converter_stream;
+	GOutputStream *output_stream;
+	GIOStream *io_stream;
+	CamelStream *stream;
+	guchar magic[2];
+	gsize n_read = 0;
+
+	g_return_val_if_fail (G_IS_IO_STREAM (base_stream), NULL);
+
+	input_stream = g_io_stream_get_input_stream (base_stream);
+
+	if (!G_IS_SEEKABLE (input_stream) ||
+	    !g_input_stream_read_all (input_stream, magic, 2, &n_read, cancellable, NULL) ||
+	    !g_seekable_seek (G_SEEKABLE (input_stream), 0, G_SEEK_SET, cancellable, NULL) ||
+	    n_read != 2 || magic[0] != GZIP_MAGIC_0 || magic[1] != GZIP_MAGIC_1)
+		return camel_stream_new (base_stream);
+
+	decompressor = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP));
+	converter_stream = g_converter_input_stream_new (input_stream, decompressor);
+
+	/* Do not close the base stream, the data cache can share it */
+	g_filter_input_stream_set_close_base_stream (G_FILTER_INPUT_STREAM (converter_stream), FALSE);
+
+	/* The decompressed content is read-only, the writes fail for lack of space */
+	output_stream = g_memory_output_stream_new (NULL, 0, NULL, NULL);
+
+	io_stream = g_simple_io_stream_new (converter_stream, output_stream);
+
+	/* The input stream belongs to it */
+	g_object_set_data_full (G_OBJECT (io_stream), "ews-base-stream",
+		g_object_ref (base_stream), g_object_unref);
+
+	stream = camel_stream_new (io_stream);
+
+	g_object_unref (io_stream);
+	g_object_unref (output_stream);
+	g_object_unref (converter_stream);
+	g_object_unref (decompressor);
+
+	return stream;
+}
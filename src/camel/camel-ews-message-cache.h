@@ -0,0 +1,83 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAMEL_EWS_MESSAGE_CACHE_H
+#define CAMEL_EWS_MESSAGE_CACHE_H
+
+#include <camel/camel.h>
+
+G_BEGIN_DECLS
+
+/* Keeps the size of the downloaded messages of an account under a limit.
+   The files of the folder caches are tracked in the order they had been
+   read and the least recently read are removed first, except of those
+   which exist only locally. Large files are stored gzip-compressed;
+   camel_ews_message_cache_wrap_stream() reads them transparently. */
+typedef struct _CamelEwsMessageCache CamelEwsMessageCache;
+
+/* Removes the evicted message of the @uid from the cache of the @owner */
+typedef void	(* CamelEwsMessageCacheEvictFunc)
+						(GObject *owner,
+						 const gchar *uid);
+
+CamelEwsMessageCache *
+		camel_ews_message_cache_new	(guint64 size_limit,
+						 gsize compress_min_size);
+void		camel_ews_message_cache_free	(CamelEwsMessageCache *cache);
+void		camel_ews_message_cache_set_size_limit
+						(CamelEwsMessageCache *cache,
+						 guint64 size_limit);
+guint64		camel_ews_message_cache_get_size_limit
+						(CamelEwsMessageCache *cache);
+guint64		camel_ews_message_cache_get_size
+						(CamelEwsMessageCache *cache);
+void		camel_ews_message_cache_add_directory
+						(CamelEwsMessageCache *cache,
+						 const gchar *path,
+						 GObject *owner,
+						 CamelEwsMessageCacheEvictFunc evict_func);
+void		camel_ews_message_cache_add_file
+						(CamelEwsMessageCache *cache,
+						 const gchar *filename,
+						 const gchar *uid,
+						 gboolean keep);
+void		camel_ews_message_cache_set_uid
+						(CamelEwsMessageCache *cache,
+						 const gchar *filename,
+						 const gchar *uid);
+void		camel_ews_message_cache_set_keep
+						(CamelEwsMessageCache *cache,
+						 const gchar *filename,
+						 gboolean keep);
+void		camel_ews_message_cache_touch_file
+						(CamelEwsMessageCache *cache,
+						 const gchar *filename);
+void		camel_ews_message_cache_remove_file
+						(CamelEwsMessageCache *cache,
+						 const gchar *filename);
+void		camel_ews_message_cache_evict	(CamelEwsMessageCache *cache);
+gboolean	camel_ews_message_cache_decompress_file
+						(CamelEwsMessageCache *cache,
+						 const gchar *filename,
+						 GCancellable *cancellable,
+						 GError **error);
+CamelStream *	camel_ews_message_cache_wrap_stream
+						(GIOStream *base_stream,
+						 GCancellable *cancellable,
+						 GError **error);
+
+G_END_DECLS
+
+#endif /* CAMEL_EWS_MESSAGE_CACHE_H */
@@ -30,6 +30,9 @@ struct _CamelEwsMessageInfoPrivate {
 	guint32 server_flags;
 	gint32 item_type;
 	gchar *change_key;
+	guint64 conversation_key;
+	guint attachment_count;
+	gchar *preview;
 };
 
 enum {
@@ -37,6 +40,9 @@ enum {
 	PROP_SERVER_FLAGS,
 	PROP_ITEM_TYPE,
 	PROP_CHANGE_KEY,
+	PROP_CONVERSATION_KEY,
+	PROP_ATTACHMENT_COUNT,
+	PROP_PREVIEW
 };
 
 G_DEFINE_TYPE (CamelEwsMessageInfo, camel_ews_message_info, CAMEL_TYPE_MESSAGE_INFO_BASE)
@@ -62,6 +68,9 @@ ews_message_info_clone (const CamelMessageInfo *mi,
 		camel_ews_message_info_set_server_flags (emi_result, camel_ews_message_info_get_server_flags (emi));
 		camel_ews_message_info_set_item_type (emi_result, camel_ews_message_info_get_item_type (emi));
 		camel_ews_message_info_take_change_key (emi_result, camel_ews_message_info_dup_change_key (emi));
+		camel_ews_message_info_set_conversation_key (emi_result, camel_ews_message_info_get_conversation_key (emi));
+		camel_ews_message_info_set_attachment_count (emi_result, camel_ews_message_info_get_attachment_count (emi));
+		camel_ews_message_info_take_preview (emi_result, camel_ews_message_info_dup_preview (emi));
 	}
 
 	return result;
@@ -93,6 +102,16 @@ ews_message_info_load (CamelMessageInfo *mi,
 			camel_ews_message_info_set_server_flags (emi, g_ascii_strtoll (values[0], NULL, 10));
 			camel_ews_message_info_set_item_type (emi, g_ascii_strtoll (values[1], NULL, 10));
 			camel_ews_message_info_set_change_key (emi, values[2]);
+
+			/* Not stored by older versions */
+			if (values[3]) {
+				camel_ews_message_info_set_conversation_key (emi, g_ascii_strtoull (values[3], NULL, 10));
+
+				if (values[4] && values[5]) {
+					camel_ews_message_info_set_attachment_count (emi, g_ascii_strtoull (values[4], NULL, 10));
+					camel_ews_message_info_take_preview (emi, *values[5] ? g_uri_unescape_string (values[5], NULL) : NULL);
+				}
+			}
 		}
 
 		g_strfreev (values);
@@ -107,6 +126,7 @@ ews_message_info_save (const CamelMessageInfo *mi,
 		       GString *bdata_str)
 {
 	CamelEwsMessageInfo *emi;
+	gchar *preview, *escaped_preview;
 
 	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (mi), FALSE);
 	g_return_val_if_fail (record != NULL, FALSE);
@@ -118,10 +138,20 @@ ews_message_info_save (const CamelMessageInfo *mi,
 
 	emi = CAMEL_EWS_MESSAGE_INFO (mi);
 
-	g_string_append_printf (bdata_str, "%u %d %s",
+	/* The preview is escaped, to not contain any spaces */
+	preview = camel_ews_message_info_dup_preview (emi);
+	escaped_preview = preview ? g_uri_escape_string (preview, NULL, TRUE) : NULL;
+
+	g_string_append_printf (bdata_str, "%u %d %s %" G_GUINT64_FORMAT " %u %s",
 		camel_ews_message_info_get_server_flags (emi),
 		camel_ews_message_info_get_item_type (emi),
-		camel_ews_message_info_get_change_key (emi));
+		camel_ews_message_info_get_change_key (emi),
+		camel_ews_message_info_get_conversation_key (emi),
+		camel_ews_message_info_get_attachment_count (emi),
+		escaped_preview ? escaped_preview : "");
+
+	g_free (escaped_preview);
+	g_free (preview);
 
 	return TRUE;
 }
@@ -146,6 +176,18 @@ ews_message_info_set_property (GObject *object,
 	case PROP_CHANGE_KEY:
 		camel_ews_message_info_set_change_key (emi, g_value_get_string (value));
 		return;
+
+	case PROP_CONVERSATION_KEY:
+		camel_ews_message_info_set_conversation_key (emi, g_value_get_uint64 (value));
+		return;
+
+	case PROP_ATTACHMENT_COUNT:
+		camel_ews_message_info_set_attachment_count (emi, g_value_get_uint (value));
+		return;
+
+	case PROP_PREVIEW:
+		camel_ews_message_info_set_preview (emi, g_value_get_string (value));
+		return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -172,6 +214,18 @@ ews_message_info_get_property (GObject *object,
 	case PROP_CHANGE_KEY:
 		g_value_take_string (value, camel_ews_message_info_dup_change_key (emi));
 		return;
+
+	case PROP_CONVERSATION_KEY:
+		g_value_set_uint64 (value, camel_ews_message_info_get_conversation_key (emi));
+		return;
+
+	case PROP_ATTACHMENT_COUNT:
+		g_value_set_uint (value, camel_ews_message_info_get_attachment_count (emi));
+		return;
+
+	case PROP_PREVIEW:
+		g_value_take_string (value, camel_ews_message_info_dup_preview (emi));
+		return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -185,6 +239,9 @@ ews_message_info_dispose (GObject *object)
 	g_free (emi->priv->change_key);
 	emi->priv->change_key = NULL;
 
+	g_free (emi->priv->preview);
+	emi->priv->preview = NULL;
+
 	/* Chain up to parent's method. */
 	G_OBJECT_CLASS (camel_ews_message_info_parent_class)->dispose (object);
 }
@@ -257,6 +314,54 @@ camel_ews_message_info_class_init (CamelEwsMessageInfoClass *class)
 			NULL,
 			NULL,
 			G_PARAM_READWRITE));
+
+	/**
+	 * CamelEwsMessageInfo:conversation-key
+	 *
+	 * Digest of the server conversation id of the message,
+	 * or 0 when the server does not know conversations.
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_CONVERSATION_KEY,
+		g_param_spec_uint64 (
+			"conversation-key",
+			"Conversation Key",
+			NULL,
+			0, G_MAXUINT64, 0,
+			G_PARAM_READWRITE));
+
+	/**
+	 * CamelEwsMessageInfo:attachment-count
+	 *
+	 * Count of the attachments of the message, as known by the server,
+	 * or %CAMEL_EWS_ATTACHMENT_COUNT_UNKNOWN, when the server told only
+	 * that the message has attachments.
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_ATTACHMENT_COUNT,
+		g_param_spec_uint (
+			"attachment-count",
+			"Attachment Count",
+			NULL,
+			0, G_MAXUINT, 0,
+			G_PARAM_READWRITE));
+
+	/**
+	 * CamelEwsMessageInfo:preview
+	 *
+	 * Beginning of the message body text, or %NULL when not known.
+	 **/
+	g_object_class_install_property (
+		object_class,
+		PROP_PREVIEW,
+		g_param_spec_string (
+			"preview",
+			"Preview",
+			NULL,
+			NULL,
+			G_PARAM_READWRITE));
 }
 
 static void
@@ -429,3 +534,168 @@ camel_ews_message_info_take_change_key (CamelEwsMessageInfo *emi,
 
 	return changed;
 }
+
+guint64
+camel_ews_message_info_get_conversation_key (const CamelEwsMessageInfo *emi)
+{
+	CamelMessageInfo *mi;
+	guint64 result;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), 0);
+
+	mi = CAMEL_MESSAGE_INFO (emi);
+
+	camel_message_info_property_lock (mi);
+	result = emi->priv->conversation_key;
+	camel_message_info_property_unlock (mi);
+
+	return result;
+}
+
+gboolean
+camel_ews_message_info_set_conversation_key (CamelEwsMessageInfo *emi,
+					     guint64 conversation_key)
+{
+	CamelMessageInfo *mi;
+	gboolean changed;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), FALSE);
+
+	mi = CAMEL_MESSAGE_INFO (emi);
+
+	camel_message_info_property_lock (mi);
+
+	changed = emi->priv->conversation_key != conversation_key;
+
+	if (changed)
+		emi->priv->conversation_key = conversation_key;
+
+	camel_message_info_property_unlock (mi);
+
+	if (changed && !camel_message_info_get_abort_notifications (mi)) {
+		g_object_notify (G_OBJECT (emi), "conversation-key");
+		camel_message_info_set_dirty (mi, TRUE);
+	}
+
+	return changed;
+}
+
+guint
+camel_ews_message_info_get_attachment_count (const CamelEwsMessageInfo *emi)
+{
+	CamelMessageInfo *mi;
+	guint result;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), 0);
+
+	mi = CAMEL_MESSAGE_INFO (emi);
+
+	camel_message_info_property_lock (mi);
+	result = emi->priv->attachment_count;
+	camel_message_info_property_unlock (mi);
+
+	return result;
+}
+
+gboolean
+camel_ews_message_info_set_attachment_count (CamelEwsMessageInfo *emi,
+					     guint attachment_count)
+{
+	CamelMessageInfo *mi;
+	gboolean changed;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), FALSE);
+
+	mi = CAMEL_MESSAGE_INFO (emi);
+
+	camel_message_info_property_lock (mi);
+
+	changed = emi->priv->attachment_count != attachment_count;
+
+	if (changed)
+		emi->priv->attachment_count = attachment_count;
+
+	camel_message_info_property_unlock (mi);
+
+	if (changed && !camel_message_info_get_abort_notifications (mi)) {
+		g_object_notify (G_OBJECT (emi), "attachment-count");
+		camel_message_info_set_dirty (mi, TRUE);
+	}
+
+	return changed;
+}
+
+const gchar *
+camel_ews_message_info_get_preview (const CamelEwsMessageInfo *emi)
+{
+	CamelMessageInfo *mi;
+	const gchar *result;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), NULL);
+
+	mi = CAMEL_MESSAGE_INFO (emi);
+
+	camel_message_info_property_lock (mi);
+	result = emi->priv->preview;
+	camel_message_info_property_unlock (mi);
+
+	return result;
+}
+
+gchar *
+camel_ews_message_info_dup_preview (const CamelEwsMessageInfo *emi)
+{
+	CamelMessageInfo *mi;
+	gchar *result;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), NULL);
+
+	mi = CAMEL_MESSAGE_INFO (emi);
+
+	camel_message_info_property_lock (mi);
+	result = g_strdup (emi->priv->preview);
+	camel_message_info_property_unlock (mi);
+
+	return result;
+}
+
+gboolean
+camel_ews_message_info_set_preview (CamelEwsMessageInfo *emi,
+				    const gchar *preview)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), FALSE);
+
+	return camel_ews_message_info_take_preview (emi, g_strdup (preview));
+}
+
+gboolean
+camel_ews_message_info_take_preview (CamelEwsMessageInfo *emi,
+				     gchar *preview)
+{
+	CamelMessageInfo *mi;
+	gboolean changed;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_MESSAGE_INFO (emi), FALSE);
+
+	mi = CAMEL_MESSAGE_INFO (emi);
+
+	camel_message_info_property_lock (mi);
+
+	changed = g_strcmp0 (emi->priv->preview, preview) != 0;
+
+	if (changed) {
+		g_free (emi->priv->preview);
+		emi->priv->preview = preview;
+	} else if (preview != emi->priv->preview) {
+		g_free (preview);
+	}
+
+	camel_message_info_property_unlock (mi);
+
+	if (changed && !camel_message_info_get_abort_notifications (mi)) {
+		g_object_notify (G_OBJECT (emi), "preview");
+		camel_message_info_set_dirty (mi, TRUE);
+	}
+
+	return changed;
+}
@@ -48,6 +48,9 @@ enum {
 	CAMEL_EWS_MESSAGE_MSGFLAG_RN_PENDING = CAMEL_MESSAGE_FOLDER_FLAGGED << 1
 };
 
+/* The message has attachments, but their count is not known */
+#define CAMEL_EWS_ATTACHMENT_COUNT_UNKNOWN G_MAXUINT
+
 typedef struct _CamelEwsMessageInfo CamelEwsMessageInfo;
 typedef struct _CamelEwsMessageInfoClass CamelEwsMessageInfoClass;
 typedef struct _CamelEwsMessageInfoPrivate CamelEwsMessageInfoPrivate;
@@ -75,6 +78,22 @@ gboolean	camel_ews_message_info_set_change_key	(CamelEwsMessageInfo *emi,
 							 const gchar *change_key);
 gboolean	camel_ews_message_info_take_change_key	(CamelEwsMessageInfo *emi,
 							 gchar *change_key);
+guint64		camel_ews_message_info_get_conversation_key
+							(const CamelEwsMessageInfo *emi);
+gboolean	camel_ews_message_info_set_conversation_key
+							(CamelEwsMessageInfo *emi,
+							 guint64 conversation_key);
+guint		camel_ews_message_info_get_attachment_count
+							(const CamelEwsMessageInfo *emi);
+gboolean	camel_ews_message_info_set_attachment_count
+							(CamelEwsMessageInfo *emi,
+							 guint attachment_count);
+const gchar *	camel_ews_message_info_get_preview	(const CamelEwsMessageInfo *emi);
+gchar *		camel_ews_message_info_dup_preview	(const CamelEwsMessageInfo *emi);
+gboolean	camel_ews_message_info_set_preview	(CamelEwsMessageInfo *emi,
+							 const gchar *preview);
+gboolean	camel_ews_message_info_take_preview	(CamelEwsMessageInfo *emi,
+							 gchar *preview);
 
 G_END_DECLS
 
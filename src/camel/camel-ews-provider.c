@@ -49,6 +49,8 @@ static CamelProviderConfEntry ews_conf_entries[] = {
 	  N_("C_heck for new messages in all folders"), "1" },
 	{ CAMEL_PROVIDER_CONF_CHECKBOX, "listen-notifications", NULL,
 	  N_("_Listen for server change notifications"), "1" },
+	{ CAMEL_PROVIDER_CONF_CHECKBOX, "sync-summary-props", NULL,
+	  N_("Read message _summaries together with folder changes"), "0" },
 	{ CAMEL_PROVIDER_CONF_SECTION_END },
 
 	{ CAMEL_PROVIDER_CONF_SECTION_START, "general", NULL, N_("Options") },
@@ -61,6 +63,15 @@ static CamelProviderConfEntry ews_conf_entries[] = {
 	{ CAMEL_PROVIDER_CONF_CHECKBOX, "stay-synchronized", NULL,
 	  N_("Synchroni_ze remote mail locally in all folders"), "0" },
 	{ CAMEL_PROVIDER_CONF_PLACEHOLDER, "ews-limit-by-age-placeholder", NULL },
+	{ CAMEL_PROVIDER_CONF_CHECKSPIN, "message-cache-limit", NULL,
+	  /* Translators: '%s' is preplaced with a widget, where
+	   * user can select the size limit of the downloaded messages. */
+	  N_("Limit the downloaded messages to %s MB"), "0:1:0:1048576" },
+	{ CAMEL_PROVIDER_CONF_CHECKSPIN, "partial-fetch-min-size", NULL,
+	  /* Translators: '%s' is preplaced with a widget, where
+	   * user can select the size of the messages, whose attachments
+	   * are downloaded only when they are opened. */
+	  N_("Download attachments only when opened for messages over %s kB"), "0:1:0:1048576" },
 	{ CAMEL_PROVIDER_CONF_SECTION_END },
 
 	{ CAMEL_PROVIDER_CONF_SECTION_START, "connection", NULL, N_("Connection") },
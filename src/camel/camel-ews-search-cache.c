@@ -0,0 +1,331 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "evolution-ews-config.h"
+
+#include <glib/gi18n-lib.h>
+
+#include "server/e-ews-query-to-restriction.h"
+
+#include "camel-ews-search-cache.h"
+
+/* How many results are kept at most */
+#define MAX_CACHED_RESULTS 32
+
+typedef struct _CachedResult {
+	GHashTable *uids; /* const gchar *camel_pstring ~> NULL */
+	gint64 created; /* monotonic time */
+	guint run;
+} CachedResult;
+
+struct _CamelEwsSearchCache {
+	GMutex lock;
+	GHashTable *results; /* gchar *key ~> CachedResult * */
+	GTimeSpan ttl;
+	guint run;
+};
+
+static void
+cached_result_free (gpointer ptr)
+{
+	CachedResult *cached = ptr;
+
+	if (cached) {
+		g_hash_table_unref (cached->uids);
+		g_free (cached);
+	}
+}
+
+static gint
+search_cache_compare_words (gconstpointer ptr1,
+			    gconstpointer ptr2)
+{
+	return g_strcmp0 (*((const gchar **) ptr1), *((const gchar **) ptr2));
+}
+
+static gchar *
+search_cache_build_key (const gchar *folder_id,
+			const gchar *change_stamp,
+			const GPtrArray *words)
+{
+	GPtrArray *sorted;
+	GString *key;
+	guint ii;
+
+	/* The order of the words does not influence the result */
+	sorted = g_ptr_array_sized_new (words->len);
+
+	for (ii = 0; ii < words->len; ii++) {
+		g_ptr_array_add (sorted, g_ptr_array_index (words, ii));
+	}
+
+	g_ptr_array_sort (sorted, search_cache_compare_words);
+
+	key = g_string_new (folder_id);
+	g_string_append_c (key, '\n');
+	g_string_append (key, change_stamp ? change_stamp : "");
+
+	for (ii = 0; ii < sorted->len; ii++) {
+		g_string_append_c (key, '\n');
+		g_string_append (key, g_ptr_array_index (sorted, ii));
+	}
+
+	g_ptr_array_unref (sorted);
+
+	return g_string_free (key, FALSE);
+}
+
+/* Call with the cache->lock held */
+static void
+search_cache_remove_oldest_locked (CamelEwsSearchCache *cache)
+{
+	GHashTableIter iter;
+	gpointer key, value;
+	gpointer oldest_key = NULL;
+	gint64 oldest_created = G_MAXINT64;
+
+	g_hash_table_iter_init (&iter, cache->results);
+
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		CachedResult *cached = value;
+
+		if (cached->created < oldest_created) {
+			oldest_created = cached->created;
+			oldest_key = key;
+		}
+	}
+
+	if (oldest_key)
+		g_hash_table_remove (cache->results, oldest_key);
+}
+
+static GHashTable *
+search_cache_find_items_sync (EEwsConnection *cnc,
+			      const gchar *folder_id,
+			      const GPtrArray *words,
+			      GPtrArray *only_ids,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	EwsFolderId *fid;
+	GHashTable *uids = NULL;
+	GSList *found_items = NULL, *link;
+	gboolean includes_last_item = FALSE;
+	GString *expression;
+	guint ii;
+
+	fid = e_ews_folder_id_new (folder_id, NULL, FALSE);
+	expression = g_string_new ("");
+
+	if (words->len >= 2)
+		g_string_append (expression, "(and ");
+
+	for (ii = 0; ii < words->len; ii++) {
+		const gchar *word = g_ptr_array_index (words, ii);
+
+		g_string_append (expression, "(body-contains \"");
+
+		for (; *word; word++) {
+			if (*word == '\"')
+				g_string_append_c (expression, '\\');
+			g_string_append_c (expression, *word);
+		}
+
+		g_string_append (expression, "\")");
+	}
+
+	/* Close the 'and' */
+	if (words->len >= 2)
+		g_string_append (expression, ")");
+
+	if (e_ews_connection_find_folder_items_sync (
+		cnc, EWS_PRIORITY_MEDIUM,
+		fid, "IdOnly", NULL, NULL, expression->str, only_ids,
+		E_EWS_FOLDER_TYPE_MAILBOX, &includes_last_item, &found_items,
+		e_ews_query_to_restriction,
+		cancellable, error)) {
+		uids = g_hash_table_new_full (g_str_hash, g_str_equal, (GDestroyNotify) camel_pstring_free, NULL);
+
+		for (link = found_items; link; link = g_slist_next (link)) {
+			EEwsItem *item = link->data;
+			const EwsId *id;
+
+			if (!item || e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR)
+				continue;
+
+			id = e_ews_item_get_id (item);
+			if (!id || !id->id)
+				continue;
+
+			g_hash_table_add (uids, (gpointer) camel_pstring_strdup (id->id));
+		}
+	}
+
+	g_slist_free_full (found_items, g_object_unref);
+	g_string_free (expression, TRUE);
+	e_ews_folder_id_free (fid);
+
+	return uids;
+}
+
+CamelEwsSearchCache *
+camel_ews_search_cache_new (GTimeSpan ttl)
+{
+	CamelEwsSearchCache *cache;
+
+	cache = g_new0 (CamelEwsSearchCache, 1);
+	g_mutex_init (&cache->lock);
+	cache->results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, cached_result_free);
+	cache->ttl = ttl;
+
+	return cache;
+}
+
+void
+camel_ews_search_cache_free (CamelEwsSearchCache *cache)
+{
+	if (!cache)
+		return;
+
+	g_hash_table_destroy (cache->results);
+	g_mutex_clear (&cache->lock);
+	g_free (cache);
+}
+
+/* Marks the end of a search run; the results read so far
+   are used from now on only within their time to live */
+void
+camel_ews_search_cache_end_run (CamelEwsSearchCache *cache)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_lock (&cache->lock);
+	cache->run++;
+	g_mutex_unlock (&cache->lock);
+}
+
+void
+camel_ews_search_cache_clear (CamelEwsSearchCache *cache)
+{
+	g_return_if_fail (cache != NULL);
+
+	g_mutex_lock (&cache->lock);
+	g_hash_table_remove_all (cache->results);
+	g_mutex_unlock (&cache->lock);
+}
+
+/* Returns a set of uids of the messages in the folder @folder_id, whose
+   body contains all the @words. When there is no usable cached result,
+   the @local_func is asked first and only the remainder is searched
+   on the server. The @cnc can be NULL, when offline. Free the returned
+   hash table with g_hash_table_unref(). */
+GHashTable *
+camel_ews_search_cache_find_uids_sync (CamelEwsSearchCache *cache,
+				       EEwsConnection *cnc,
+				       const gchar *folder_id,
+				       const gchar *change_stamp,
+				       const GPtrArray *words, /* gchar * */
+				       CamelEwsSearchCacheLocalFunc local_func,
+				       gpointer local_user_data,
+				       GCancellable *cancellable,
+				       GError **error)
+{
+	CachedResult *cached;
+	GHashTable *uids, *local_uids = NULL;
+	GPtrArray *remainder = NULL;
+	gchar *key;
+	gint64 now;
+	guint run;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	if (cnc)
+		g_return_val_if_fail (E_IS_EWS_CONNECTION (cnc), NULL);
+	g_return_val_if_fail (folder_id != NULL, NULL);
+	g_return_val_if_fail (words != NULL, NULL);
+
+	key = search_cache_build_key (folder_id, change_stamp, words);
+	now = g_get_monotonic_time ();
+
+	g_mutex_lock (&cache->lock);
+
+	cached = g_hash_table_lookup (cache->results, key);
+
+	if (cached && (cached->run == cache->run || now - cached->created < cache->ttl)) {
+		uids = g_hash_table_ref (cached->uids);
+
+		g_mutex_unlock (&cache->lock);
+		g_free (key);
+
+		return uids;
+	}
+
+	run = cache->run;
+
+	g_mutex_unlock (&cache->lock);
+
+	if (local_func)
+		local_uids = local_func (words, &remainder, local_user_data);
+
+	if (local_uids && remainder && !remainder->len) {
+		uids = g_hash_table_ref (local_uids);
+	} else if (!cnc) {
+		g_set_error (
+			error, CAMEL_SERVICE_ERROR,
+			CAMEL_SERVICE_ERROR_UNAVAILABLE,
+			_("You must be working online to complete this operation"));
+		uids = NULL;
+	} else {
+		uids = search_cache_find_items_sync (cnc, folder_id, words,
+			local_uids ? remainder : NULL, cancellable, error);
+
+		if (uids && local_uids) {
+			GHashTableIter iter;
+			gpointer uid;
+
+			g_hash_table_iter_init (&iter, local_uids);
+			while (g_hash_table_iter_next (&iter, &uid, NULL)) {
+				if (!g_hash_table_contains (uids, uid))
+					g_hash_table_add (uids, (gpointer) camel_pstring_strdup (uid));
+			}
+		}
+	}
+
+	if (local_uids)
+		g_hash_table_unref (local_uids);
+	if (remainder)
+		g_ptr_array_unref (remainder);
+
+	if (!uids) {
+		g_free (key);
+		return NULL;
+	}
+
+	cached = g_new0 (CachedResult, 1);
+	cached->uids = g_hash_table_ref (uids);
+	cached->created = now;
+	cached->run = run;
+
+	g_mutex_lock (&cache->lock);
+
+	if (!g_hash_table_contains (cache->results, key) &&
+	    g_hash_table_size (cache->results) >= MAX_CACHED_RESULTS)
+		search_cache_remove_oldest_locked (cache);
+
+	g_hash_table_insert (cache->results, key, cached);
+
+	g_mutex_unlock (&cache->lock);
+
+	return uids;
+}
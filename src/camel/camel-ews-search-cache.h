@@ -0,0 +1,57 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8 -*- */
+/*
+ * This library is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CAMEL_EWS_SEARCH_CACHE_H
+#define CAMEL_EWS_SEARCH_CACHE_H
+
+#include <camel/camel.h>
+
+#include "server/e-ews-connection.h"
+
+G_BEGIN_DECLS
+
+/* Results of server-side body searches, keyed by the folder id, the search
+   words and a folder change stamp. A result is used for the whole search
+   run it had been read in, and by later runs within the time to live. */
+typedef struct _CamelEwsSearchCache CamelEwsSearchCache;
+
+/* Searches the locally available messages for the @words. Returns the set
+   of the matching uids, or NULL when it cannot tell. The @out_remainder is
+   set to the uids to search on the server, or to NULL to search there
+   the whole folder. */
+typedef GHashTable *	(* CamelEwsSearchCacheLocalFunc)
+						(const GPtrArray *words, /* gchar * */
+						 GPtrArray **out_remainder, /* gchar * */
+						 gpointer user_data);
+
+CamelEwsSearchCache *
+		camel_ews_search_cache_new	(GTimeSpan ttl);
+void		camel_ews_search_cache_free	(CamelEwsSearchCache *cache);
+void		camel_ews_search_cache_end_run	(CamelEwsSearchCache *cache);
+void		camel_ews_search_cache_clear	(CamelEwsSearchCache *cache);
+GHashTable *	camel_ews_search_cache_find_uids_sync
+						(CamelEwsSearchCache *cache,
+						 EEwsConnection *cnc,
+						 const gchar *folder_id,
+						 const gchar *change_stamp,
+						 const GPtrArray *words, /* gchar * */
+						 CamelEwsSearchCacheLocalFunc local_func,
+						 gpointer local_user_data,
+						 GCancellable *cancellable,
+						 GError **error);
+
+G_END_DECLS
+
+#endif /* CAMEL_EWS_SEARCH_CACHE_H */
@@ -18,12 +18,18 @@
 #include <string.h>
 #include <camel/camel.h>
 #include <camel/camel-search-private.h>
-#include <e-util/e-util.h>
-
-#include "server/e-ews-query-to-restriction.h"
 
 #include "camel-ews-folder.h"
 #include "camel-ews-search.h"
+#include "camel-ews-search-cache.h"
+#include "camel-ews-summary.h"
+
+/* How long a body search result can be used by later searches */
+#define EWS_SEARCH_CACHE_TTL (30 * G_TIME_SPAN_SECOND)
+
+/* When more messages are not in the body index, the whole
+   folder is searched on the server */
+#define EWS_SEARCH_MAX_REMAINDER 500
 
 #define CAMEL_EWS_SEARCH_GET_PRIVATE(obj) \
 	(G_TYPE_INSTANCE_GET_PRIVATE \
@@ -35,6 +41,8 @@ struct _CamelEwsSearchPrivate {
 
 	GCancellable *cancellable; /* not referenced */
 	GError **error; /* not referenced */
+
+	CamelEwsSearchCache *cache;
 };
 
 enum {
@@ -103,6 +111,7 @@ ews_search_finalize (GObject *object)
 	priv = CAMEL_EWS_SEARCH_GET_PRIVATE (object);
 
 	g_weak_ref_clear (&priv->ews_store);
+	camel_ews_search_cache_free (priv->cache);
 
 	/* Chain up to parent's finalize() method. */
 	G_OBJECT_CLASS (camel_ews_search_parent_class)->finalize (object);
@@ -157,32 +166,147 @@ ews_search_result_match_none (CamelSExp *sexp,
 	return result;
 }
 
-static GPtrArray *
-ews_search_items_to_ptr_array (const GSList *items)
+static CamelSExpResult *
+ews_search_result_from_uids (CamelSExp *sexp,
+			     CamelFolderSearch *search,
+			     GHashTable *uids)
 {
-	GPtrArray *matches = NULL;
-	const GSList *link;
+	CamelSExpResult *result;
+	CamelMessageInfo *current_info;
 
-	for (link = items; link; link = g_slist_next (link)) {
-		EEwsItem *item = link->data;
-		const EwsId *id;
+	current_info = camel_folder_search_get_current_message_info (search);
 
-		if (!item || e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR)
-			continue;
+	if (current_info) {
+		result = camel_sexp_result_new (sexp, CAMEL_SEXP_RES_BOOL);
+		result->value.boolean = uids && g_hash_table_contains (uids, camel_message_info_get_uid (current_info));
+	} else {
+		result = camel_sexp_result_new (sexp, CAMEL_SEXP_RES_ARRAY_PTR);
+		result->value.ptrarray = g_ptr_array_new ();
 
-		id = e_ews_item_get_id (item);
-		if (!id || !id->id)
-			continue;
+		if (uids) {
+			GHashTableIter iter;
+			gpointer key;
+
+			g_hash_table_iter_init (&iter, uids);
+
+			while (g_hash_table_iter_next (&iter, &key, NULL)) {
+				g_ptr_array_add (result->value.ptrarray, (gpointer) camel_pstring_strdup (key));
+			}
+		}
+	}
+
+	return result;
+}
+
+/* Changes whenever the folder content changes */
+static gchar *
+ews_search_dup_change_stamp (CamelFolder *folder)
+{
+	CamelFolderSummary *folder_summary;
+	CamelEwsBodyIndex *body_index;
+	gchar *sync_state, *stamp;
+
+	folder_summary = camel_folder_get_folder_summary (folder);
+	sync_state = camel_ews_summary_dup_sync_state (CAMEL_EWS_SUMMARY (folder_summary));
+	body_index = camel_ews_folder_get_body_index (CAMEL_EWS_FOLDER (folder));
+
+	stamp = g_strdup_printf ("%u:%u:%s", camel_folder_summary_count (folder_summary),
+		camel_ews_body_index_get_stamp (body_index), sync_state ? sync_state : "");
+
+	g_free (sync_state);
+
+	return stamp;
+}
+
+/* Answers the cached messages from the body index; the rest of the folder
+   is left for the server. Always uses the whole folder, not only the searched
+   messages, to have the result reusable by other searches. */
+static GHashTable *
+ews_search_body_index_cb (const GPtrArray *words,
+			  GPtrArray **out_remainder,
+			  gpointer user_data)
+{
+	CamelFolderSearch *search = user_data;
+	CamelFolder *folder;
+	CamelFolderSummary *folder_summary;
+	CamelEwsBodyIndex *body_index;
+	GHashTable *matches;
+	GPtrArray *known_uids, *remainder;
+	guint ii;
+
+	folder = camel_folder_search_get_folder (search);
+	body_index = camel_ews_folder_get_body_index (CAMEL_EWS_FOLDER (folder));
+
+	if (!camel_ews_body_index_get_length (body_index))
+		return NULL;
+
+	matches = camel_ews_body_index_search (body_index, words);
+	if (!matches)
+		return NULL;
+
+	folder_summary = camel_folder_get_folder_summary (folder);
+	known_uids = camel_folder_summary_get_array (folder_summary);
+	remainder = g_ptr_array_new_with_free_func ((GDestroyNotify) camel_pstring_free);
 
-		if (!matches)
-			matches = g_ptr_array_new ();
+	for (ii = 0; known_uids && ii < known_uids->len && remainder; ii++) {
+		const gchar *uid = g_ptr_array_index (known_uids, ii);
 
-		g_ptr_array_add (matches, (gpointer) camel_pstring_strdup (id->id));
+		if (!camel_ews_body_index_contains (body_index, uid)) {
+			g_ptr_array_add (remainder, (gpointer) camel_pstring_strdup (uid));
+
+			if (remainder->len > EWS_SEARCH_MAX_REMAINDER)
+				g_clear_pointer (&remainder, g_ptr_array_unref);
+		}
 	}
 
+	camel_folder_summary_free_array (known_uids);
+
+	*out_remainder = remainder;
+
 	return matches;
 }
 
+/* Answers the search from the body index only, when it knows all
+   the searched messages; returns NULL otherwise */
+static CamelSExpResult *
+ews_search_process_locally (CamelSExp *sexp,
+			    CamelFolderSearch *search,
+			    const GPtrArray *words)
+{
+	CamelSExpResult *result;
+	CamelEwsBodyIndex *body_index;
+	CamelMessageInfo *current_info;
+	GHashTable *matches;
+
+	body_index = camel_ews_folder_get_body_index (CAMEL_EWS_FOLDER (camel_folder_search_get_folder (search)));
+	current_info = camel_folder_search_get_current_message_info (search);
+
+	if (current_info) {
+		if (!camel_ews_body_index_contains (body_index, camel_message_info_get_uid (current_info)))
+			return NULL;
+	} else {
+		GPtrArray *summary;
+		guint ii;
+
+		summary = camel_folder_search_get_summary (search);
+
+		for (ii = 0; summary && ii < summary->len; ii++) {
+			if (!camel_ews_body_index_contains (body_index, g_ptr_array_index (summary, ii)))
+				return NULL;
+		}
+	}
+
+	matches = camel_ews_body_index_search (body_index, words);
+	if (!matches)
+		return NULL;
+
+	result = ews_search_result_from_uids (sexp, search, matches);
+
+	g_hash_table_unref (matches);
+
+	return result;
+}
+
 static CamelSExpResult *
 ews_search_process_criteria (CamelSExp *sexp,
 			     CamelFolderSearch *search,
@@ -192,7 +316,7 @@ ews_search_process_criteria (CamelSExp *sexp,
 	CamelSExpResult *result;
 	CamelEwsSearch *ews_search = CAMEL_EWS_SEARCH (search);
 	CamelEwsFolder *ews_folder;
-	GPtrArray *uids = NULL;
+	GHashTable *uids = NULL;
 	GError *local_error = NULL;
 
 	ews_folder = CAMEL_EWS_FOLDER (camel_folder_search_get_folder (search));
@@ -224,47 +348,18 @@ ews_search_process_criteria (CamelSExp *sexp,
 		}
 
 		if (can_search) {
-			EwsFolderId *fid;
-			GSList *found_items = NULL;
-			gboolean includes_last_item = FALSE;
-			GString *expression;
-			guint ii;
-
-			fid = e_ews_folder_id_new (folder_id, NULL, FALSE);
-			expression = g_string_new ("");
+			gchar *change_stamp;
 
-			if (words->len >= 2)
-				g_string_append (expression, "(and ");
+			/* The per-message evaluation asks for the same result
+			   for each message, thus read it only once */
+			change_stamp = ews_search_dup_change_stamp (CAMEL_FOLDER (ews_folder));
 
-			for (ii = 0; ii < words->len; ii++) {
-				GString *word;
+			uids = camel_ews_search_cache_find_uids_sync (ews_search->priv->cache,
+				connection, folder_id, change_stamp, words,
+				ews_search_body_index_cb, search,
+				ews_search->priv->cancellable, &local_error);
 
-				word = e_str_replace_string (g_ptr_array_index (words, ii), "\"", "\\\"");
-
-				g_string_append (expression, "(body-contains \"");
-				g_string_append (expression, word->str);
-				g_string_append (expression, "\")");
-
-				g_string_free (word, TRUE);
-			}
-
-			/* Close the 'and' */
-			if (words->len >= 2)
-				g_string_append (expression, ")");
-
-			if (e_ews_connection_find_folder_items_sync (
-				connection, EWS_PRIORITY_MEDIUM,
-				fid, "IdOnly", NULL, NULL, expression->str, NULL,
-				E_EWS_FOLDER_TYPE_MAILBOX, &includes_last_item, &found_items,
-				e_ews_query_to_restriction,
-				ews_search->priv->cancellable, &local_error)) {
-
-				uids = ews_search_items_to_ptr_array (found_items);
-			}
-
-			g_slist_free_full (found_items, g_object_unref);
-			g_string_free (expression, TRUE);
-			e_ews_folder_id_free (fid);
+			g_free (change_stamp);
 		}
 
 		g_clear_object (&connection);
@@ -279,20 +374,10 @@ ews_search_process_criteria (CamelSExp *sexp,
 	if (local_error != NULL)
 		g_propagate_error (ews_search->priv->error, local_error);
 
-	if (!uids) {
-		/* Make like we've got an empty result */
-		uids = g_ptr_array_new ();
-	}
+	result = ews_search_result_from_uids (sexp, search, uids);
 
-	if (camel_folder_search_get_current_message_info (search)) {
-		result = camel_sexp_result_new (sexp, CAMEL_SEXP_RES_BOOL);
-		result->value.boolean = (uids && uids->len > 0);
-	} else {
-		result = camel_sexp_result_new (sexp, CAMEL_SEXP_RES_ARRAY_PTR);
-		result->value.ptrarray = g_ptr_array_ref (uids);
-	}
-
-	g_ptr_array_unref (uids);
+	if (uids)
+		g_hash_table_unref (uids);
 
 	return result;
 }
@@ -376,6 +461,15 @@ ews_search_body_contains (CamelSExp *sexp,
 
 	/* This will be NULL if we're offline. Search from cache. */
 	if (!ews_store) {
+		words = ews_search_gather_words (argv, 0, argc);
+		result = words ? ews_search_process_locally (sexp, search, words) : NULL;
+
+		if (words)
+			g_ptr_array_free (words, TRUE);
+
+		if (result)
+			return result;
+
 		/* Chain up to parent's method. */
 		return CAMEL_FOLDER_SEARCH_CLASS (camel_ews_search_parent_class)->
 			body_contains (sexp, argc, argv, search);
@@ -425,6 +519,7 @@ camel_ews_search_init (CamelEwsSearch *search)
 {
 	search->priv = CAMEL_EWS_SEARCH_GET_PRIVATE (search);
 	search->priv->local_data_search = NULL;
+	search->priv->cache = camel_ews_search_cache_new (EWS_SEARCH_CACHE_TTL);
 
 	g_weak_ref_init (&search->priv->ews_store, NULL);
 }
@@ -532,4 +627,8 @@ camel_ews_search_set_cancellable_and_error (CamelEwsSearch *search,
 
 	search->priv->cancellable = cancellable;
 	search->priv->error = error;
+
+	/* Reset after the search finished */
+	if (!cancellable && !error)
+		camel_ews_search_cache_end_run (search->priv->cache);
 }
@@ -63,6 +63,12 @@
 
 #define FINFO_REFRESH_INTERVAL 60
 
+/* The "message-cache-limit" is in megabytes */
+#define MESSAGE_CACHE_LIMIT_TO_BYTES(x) (((guint64) (x)) * 1024 * 1024)
+
+/* Downloaded messages of at least this size are stored compressed */
+#define MESSAGE_CACHE_COMPRESS_MIN_SIZE (64 * 1024)
+
 #define UPDATE_LOCK(x) (g_rec_mutex_lock(&(x)->priv->update_lock))
 #define UPDATE_UNLOCK(x) (g_rec_mutex_unlock(&(x)->priv->update_lock))
 
@@ -84,6 +90,9 @@ struct _CamelEwsStorePrivate {
 	GRecMutex update_lock;
 
 	GSList *public_folders; /* EEwsFolder * objects */
+
+	/* Downloaded messages of all the folders */
+	CamelEwsMessageCache *message_cache;
 };
 
 static gboolean	ews_store_construct	(CamelService *service, CamelSession *session,
@@ -306,6 +315,15 @@ camel_ews_store_initable_init (GInitableIface *iface)
 	iface->init = ews_store_initable_init;
 }
 
+static void
+camel_ews_store_message_cache_limit_cb (CamelEwsStore *ews_store,
+					GParamSpec *spec,
+					CamelEwsSettings *ews_settings)
+{
+	camel_ews_message_cache_set_size_limit (ews_store->priv->message_cache,
+		MESSAGE_CACHE_LIMIT_TO_BYTES (camel_ews_settings_get_message_cache_limit (ews_settings)));
+}
+
 static gboolean
 ews_store_construct (CamelService *service,
                      CamelSession *session,
@@ -313,11 +331,26 @@ ews_store_construct (CamelService *service,
                      GError **error)
 {
 	CamelEwsStore *ews_store;
+	CamelSettings *settings;
 	gchar *summary_file, *session_storage_path;
 	guint32 store_flags;
 
 	ews_store = (CamelEwsStore *) service;
 
+	settings = camel_service_ref_settings (service);
+
+	ews_store->priv->message_cache = camel_ews_message_cache_new (
+		MESSAGE_CACHE_LIMIT_TO_BYTES (camel_ews_settings_get_message_cache_limit (CAMEL_EWS_SETTINGS (settings))),
+		MESSAGE_CACHE_COMPRESS_MIN_SIZE);
+
+	g_signal_connect_swapped (
+		settings,
+		"notify::message-cache-limit",
+		G_CALLBACK (camel_ews_store_message_cache_limit_cb),
+		ews_store);
+
+	g_object_unref (settings);
+
 	store_flags = camel_store_get_flags (CAMEL_STORE (ews_store));
 
 	/* Disable virtual trash and junk folders. Exchange has real
@@ -3714,6 +3747,14 @@ camel_ews_store_unset_oof_settings_state (CamelEwsStore *ews_store)
 	g_object_unref (session);
 }
 
+CamelEwsMessageCache *
+camel_ews_store_get_message_cache (CamelEwsStore *ews_store)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_STORE (ews_store), NULL);
+
+	return ews_store->priv->message_cache;
+}
+
 static void
 ews_store_dispose (GObject *object)
 {
@@ -3725,6 +3766,7 @@ ews_store_dispose (GObject *object)
 	ews_settings = CAMEL_EWS_SETTINGS (camel_service_ref_settings (CAMEL_SERVICE (ews_store)));
 	g_signal_handlers_disconnect_by_func (ews_settings, camel_ews_store_listen_notifications_cb, ews_store);
 	g_signal_handlers_disconnect_by_func (ews_settings, camel_ews_store_check_all_cb, ews_store);
+	g_signal_handlers_disconnect_by_func (ews_settings, camel_ews_store_message_cache_limit_cb, ews_store);
 	g_object_unref (ews_settings);
 
 	if (ews_store->summary != NULL) {
@@ -3755,6 +3797,7 @@ ews_store_finalize (GObject *object)
 	ews_store = CAMEL_EWS_STORE (object);
 
 	g_free (ews_store->storage_path);
+	camel_ews_message_cache_free (ews_store->priv->message_cache);
 	g_mutex_clear (&ews_store->priv->get_finfo_lock);
 	g_mutex_clear (&ews_store->priv->connection_lock);
 	g_rec_mutex_clear (&ews_store->priv->update_lock);
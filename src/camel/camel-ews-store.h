@@ -29,6 +29,7 @@
 
 #include "server/e-ews-connection.h"
 
+#include "camel-ews-message-cache.h"
 #include "camel-ews-store-summary.h"
 
 /* Standard GObject macros */
@@ -107,6 +108,9 @@ CamelEwsStoreOooAlertState
 						(const CamelEwsStore *ews_store);
 void		camel_ews_store_unset_oof_settings_state
 						(CamelEwsStore *ews_store);
+CamelEwsMessageCache *
+		camel_ews_store_get_message_cache
+						(CamelEwsStore *ews_store);
 
 
 G_END_DECLS
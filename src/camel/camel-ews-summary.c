@@ -208,6 +208,70 @@ camel_ews_summary_add_message (CamelFolderSummary *summary,
 	return TRUE;
 }
 
+/* Adds a copy of the @info under the @uid, like for a message moved
+   from another folder. The summary is not saved. */
+gboolean
+camel_ews_summary_add_message_info (CamelFolderSummary *summary,
+				    const gchar *uid,
+				    const gchar *change_key,
+				    CamelMessageInfo *info)
+{
+	CamelMessageInfo *mi;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_SUMMARY (summary), FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+	g_return_val_if_fail (info != NULL, FALSE);
+
+	if (camel_folder_summary_check_uid (summary, uid))
+		return FALSE;
+
+	mi = camel_message_info_clone (info, summary);
+	g_return_val_if_fail (mi != NULL, FALSE);
+
+	camel_message_info_set_abort_notifications (mi, TRUE);
+
+	camel_message_info_set_uid (mi, uid);
+	camel_ews_message_info_set_change_key (CAMEL_EWS_MESSAGE_INFO (mi), change_key);
+
+	camel_message_info_set_abort_notifications (mi, FALSE);
+
+	camel_folder_summary_add (summary, mi, FALSE);
+
+	/* camel_folder_summary_add() sets the folder_flagged flag, but the server
+	   already has the state of the transferred message, thus nothing to sync */
+	camel_message_info_set_folder_flagged (mi, FALSE);
+
+	camel_folder_summary_touch (summary);
+
+	g_object_unref (mi);
+
+	return TRUE;
+}
+
+/* Whether the @uid is in the @summary with the @change_key already,
+   thus a refresh has nothing to fetch for it. */
+gboolean
+camel_ews_summary_has_item (CamelFolderSummary *summary,
+			    const gchar *uid,
+			    const gchar *change_key)
+{
+	CamelMessageInfo *mi;
+	gboolean has_item;
+
+	g_return_val_if_fail (CAMEL_IS_EWS_SUMMARY (summary), FALSE);
+	g_return_val_if_fail (uid != NULL, FALSE);
+
+	mi = camel_folder_summary_get (summary, uid);
+	if (!mi)
+		return FALSE;
+
+	has_item = g_strcmp0 (camel_ews_message_info_get_change_key (CAMEL_EWS_MESSAGE_INFO (mi)), change_key) == 0;
+
+	g_object_unref (mi);
+
+	return has_item;
+}
+
 static gboolean
 ews_update_user_flags (CamelMessageInfo *info,
                        const CamelNamedFlags *server_user_flags)
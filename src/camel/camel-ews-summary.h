@@ -78,6 +78,16 @@ gboolean
 					 const gchar *change_key,
 					 CamelMessageInfo *info,
 					 CamelMimeMessage *message);
+gboolean
+	camel_ews_summary_add_message_info
+					(CamelFolderSummary *summary,
+					 const gchar *uid,
+					 const gchar *change_key,
+					 CamelMessageInfo *info);
+gboolean
+	camel_ews_summary_has_item	(CamelFolderSummary *summary,
+					 const gchar *uid,
+					 const gchar *change_key);
 void	ews_summary_clear		(CamelFolderSummary *summary,
 					 gboolean uncache);
 gint32	camel_ews_summary_get_version	(CamelEwsSummary *ews_summary);
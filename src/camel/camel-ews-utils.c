@@ -36,6 +36,7 @@
 #include "server/e-ews-item-change.h"
 #include "server/e-ews-message.h"
 
+#include "camel-ews-attachment-wrapper.h"
 #include "camel-ews-utils.h"
 
 #define SUBFOLDER_DIR_NAME     "subfolders"
@@ -706,7 +707,8 @@ form_recipient_list (EEwsConnection *cnc,
 }
 
 static guint8 *
-get_md5_digest (const guchar *str)
+get_md5_digest (const guchar *str,
+		gssize str_len)
 {
 	guint8 *digest;
 	gsize length;
@@ -716,13 +718,92 @@ get_md5_digest (const guchar *str)
 	digest = g_malloc0 (length);
 
 	checksum = g_checksum_new (G_CHECKSUM_MD5);
-	g_checksum_update (checksum, str, -1);
+	g_checksum_update (checksum, str, str_len);
 	g_checksum_get_digest (checksum, digest, &length);
 	g_checksum_free (checksum);
 
 	return digest;
 }
 
+static guint64
+ews_utils_digest_to_id (const guchar *data,
+			gssize length)
+{
+	CamelSummaryMessageID tmp_msgid;
+	guint8 *digest;
+
+	digest = get_md5_digest (data, length);
+	memcpy (tmp_msgid.id.hash, digest, sizeof (tmp_msgid.id.hash));
+	g_free (digest);
+
+	return tmp_msgid.id.id;
+}
+
+/* The ConversationIndex is a 22 bytes long header, followed
+   by 5 bytes for each reply level */
+#define CONVERSATION_INDEX_HEADER_LEN 22
+#define CONVERSATION_INDEX_REPLY_LEN 5
+
+/* Computes threading data from the ConversationId and the ConversationIndex,
+   which are known to Exchange 2010 and later. The @out_message_id is derived
+   from the @conversation_index, the @out_references point to its parents,
+   from the closest, and end with the @out_conversation_key, thus also
+   messages without a known parent are grouped by their conversation.
+   Returns FALSE, when the @conversation_index is not usable; only
+   the @out_conversation_key is set then. */
+gboolean
+camel_ews_utils_get_conversation_threading (const gchar *conversation_id,
+					    const gchar *conversation_index,
+					    guint64 *out_conversation_key,
+					    guint64 *out_message_id,
+					    GArray **out_references) /* guint64 */
+{
+	guchar *index;
+	gsize len = 0, parent_len;
+	guint64 id;
+
+	g_return_val_if_fail (out_conversation_key != NULL, FALSE);
+	g_return_val_if_fail (out_message_id != NULL, FALSE);
+	g_return_val_if_fail (out_references != NULL, FALSE);
+
+	*out_conversation_key = 0;
+	*out_message_id = 0;
+	*out_references = NULL;
+
+	if (!conversation_id || !*conversation_id)
+		return FALSE;
+
+	*out_conversation_key = ews_utils_digest_to_id ((const guchar *) conversation_id, -1);
+
+	if (!conversation_index || !*conversation_index)
+		return FALSE;
+
+	index = g_base64_decode (conversation_index, &len);
+
+	if (!index || len < CONVERSATION_INDEX_HEADER_LEN ||
+	    (len - CONVERSATION_INDEX_HEADER_LEN) % CONVERSATION_INDEX_REPLY_LEN != 0) {
+		g_free (index);
+		return FALSE;
+	}
+
+	*out_message_id = ews_utils_digest_to_id (index, len);
+	*out_references = g_array_sized_new (FALSE, FALSE, sizeof (guint64),
+		1 + (len - CONVERSATION_INDEX_HEADER_LEN) / CONVERSATION_INDEX_REPLY_LEN);
+
+	for (parent_len = len - CONVERSATION_INDEX_REPLY_LEN;
+	     parent_len >= CONVERSATION_INDEX_HEADER_LEN;
+	     parent_len -= CONVERSATION_INDEX_REPLY_LEN) {
+		id = ews_utils_digest_to_id (index, parent_len);
+		g_array_append_val (*out_references, id);
+	}
+
+	g_array_append_val (*out_references, *out_conversation_key);
+
+	g_free (index);
+
+	return TRUE;
+}
+
 static void
 ews_set_threading_data (CamelMessageInfo *mi,
                         EEwsItem *item)
@@ -733,20 +814,43 @@ ews_set_threading_data (CamelMessageInfo *mi,
 	guint8 *digest;
 	gchar *msgid;
 	CamelSummaryMessageID tmp_msgid;
-	GArray *references;
+	GArray *references = NULL;
+	guint64 conversation_key = 0, index_message_id = 0;
+
+	/* Known to Exchange 2010 and later only */
+	if (!camel_ews_utils_get_conversation_threading (
+		e_ews_item_get_conversation_id (item),
+		e_ews_item_get_conversation_index (item),
+		&conversation_key, &index_message_id, &references))
+		index_message_id = 0;
+
+	camel_ews_message_info_set_conversation_key (CAMEL_EWS_MESSAGE_INFO (mi), conversation_key);
 
 	/* set message id */
 	message_id = e_ews_item_get_msg_id (item);
 	msgid = camel_header_msgid_decode (message_id);
-	if (msgid) {
-		digest = get_md5_digest ((const guchar *) msgid);
-		memcpy (tmp_msgid.id.hash, digest, sizeof (tmp_msgid.id.hash));
-		g_free (digest);
-		g_free (msgid);
+	if (!msgid) {
+		/* The server knows the conversation, even when the headers are missing */
+		if (index_message_id) {
+			camel_message_info_set_message_id (mi, index_message_id);
+			camel_message_info_take_references (mi, references);
+		} else if (references) {
+			g_array_unref (references);
+		}
 
-		camel_message_info_set_message_id (mi, tmp_msgid.id.id);
+		return;
 	}
 
+	if (references)
+		g_array_unref (references);
+
+	digest = get_md5_digest ((const guchar *) msgid, -1);
+	memcpy (tmp_msgid.id.hash, digest, sizeof (tmp_msgid.id.hash));
+	g_free (digest);
+	g_free (msgid);
+
+	camel_message_info_set_message_id (mi, tmp_msgid.id.id);
+
 	/* Process References: header */
 	references_str = e_ews_item_get_references (item);
 	refs = camel_header_references_decode (references_str);
@@ -757,19 +861,24 @@ ews_set_threading_data (CamelMessageInfo *mi,
 	if (irt) {
 		refs = g_slist_concat (irt, refs);
 	}
-	if (!refs)
+	if (!refs && !conversation_key)
 		return;
 
-	references = g_array_sized_new (FALSE, FALSE, sizeof (guint64), g_slist_length (refs));
+	references = g_array_sized_new (FALSE, FALSE, sizeof (guint64), g_slist_length (refs) + 1);
 
 	for (link = refs; link; link = g_slist_next (link)) {
-		digest = get_md5_digest ((const guchar *) link->data);
+		digest = get_md5_digest ((const guchar *) link->data, -1);
 		memcpy (tmp_msgid.id.hash, digest, sizeof (tmp_msgid.id.hash));
 		g_free (digest);
 
 		g_array_append_val (references, tmp_msgid.id.id);
 	}
 
+	/* The outermost reference groups also the messages
+	   of the conversation with an unknown parent */
+	if (conversation_key)
+		g_array_append_val (references, conversation_key);
+
 	g_slist_free_full (refs, g_free);
 
 	camel_message_info_take_references (mi, references);
@@ -987,6 +1096,13 @@ camel_ews_utils_sync_updated_items (CamelEwsFolder *ews_folder,
 				g_clear_object (&tmp_mi);
 				g_clear_object (&mi);
 			}
+		} else if (camel_ews_folder_has_queued_flags (ews_folder, id->id)) {
+			/* The local flags are newer than those on the server */
+			mi = camel_folder_summary_get (folder_summary, id->id);
+			if (mi) {
+				camel_ews_message_info_set_change_key (CAMEL_EWS_MESSAGE_INFO (mi), id->change_key);
+				g_clear_object (&mi);
+			}
 		} else {
 			mi = camel_folder_summary_get (folder_summary, id->id);
 			if (mi) {
@@ -1105,13 +1221,19 @@ camel_ews_utils_item_to_message_info (CamelEwsFolder *ews_folder,
 	camel_message_info_set_from (mi, tmp);
 	g_free (tmp);
 
-	tmp = form_recipient_list (cnc, e_ews_item_get_to_recipients (item), cancellable);
-	camel_message_info_set_to (mi, tmp);
-	g_free (tmp);
+	/* The recipients are not part of the SyncFolderItems response,
+	   thus keep those from the transport headers, when there are any */
+	if (e_ews_item_get_to_recipients (item) || !camel_message_info_get_to (mi)) {
+		tmp = form_recipient_list (cnc, e_ews_item_get_to_recipients (item), cancellable);
+		camel_message_info_set_to (mi, tmp);
+		g_free (tmp);
+	}
 
-	tmp = form_recipient_list (cnc, e_ews_item_get_cc_recipients (item), cancellable);
-	camel_message_info_set_cc (mi, tmp);
-	g_free (tmp);
+	if (e_ews_item_get_cc_recipients (item) || !camel_message_info_get_cc (mi)) {
+		tmp = form_recipient_list (cnc, e_ews_item_get_cc_recipients (item), cancellable);
+		camel_message_info_set_cc (mi, tmp);
+		g_free (tmp);
+	}
 
 	e_ews_item_has_attachments (item, &has_attachments);
 	if (has_attachments)
@@ -1132,6 +1254,61 @@ camel_ews_utils_item_to_message_info (CamelEwsFolder *ews_folder,
 	return mi;
 }
 
+static guint
+ews_utils_get_preview_length (CamelEwsFolder *ews_folder)
+{
+	CamelStore *parent_store;
+	CamelSettings *settings;
+	guint preview_length = 0;
+
+	parent_store = camel_folder_get_parent_store (CAMEL_FOLDER (ews_folder));
+	if (!parent_store)
+		return 0;
+
+	settings = camel_service_ref_settings (CAMEL_SERVICE (parent_store));
+	if (settings) {
+		preview_length = camel_ews_settings_get_preview_length (CAMEL_EWS_SETTINGS (settings));
+		g_object_unref (settings);
+	}
+
+	return preview_length;
+}
+
+/* Stores the attachment count and the preview text of the @item into the @mi;
+   either is left unchanged, when it was not part of the response */
+static gboolean
+ews_utils_update_preview (CamelMessageInfo *mi,
+			  EEwsItem *item,
+			  guint preview_length)
+{
+	const GSList *attachments;
+	gboolean has_attachments = FALSE;
+	gboolean changed = FALSE;
+
+	if (!CAMEL_IS_EWS_MESSAGE_INFO (mi))
+		return FALSE;
+
+	attachments = e_ews_item_get_attachments_meta (item);
+	if (attachments) {
+		changed = camel_ews_message_info_set_attachment_count (CAMEL_EWS_MESSAGE_INFO (mi),
+			g_slist_length ((GSList *) attachments));
+	} else if (e_ews_item_has_attachments (item, &has_attachments)) {
+		/* The SyncFolderItems returns only the HasAttachments; keep the count,
+		   when it is already known */
+		if (!has_attachments)
+			changed = camel_ews_message_info_set_attachment_count (CAMEL_EWS_MESSAGE_INFO (mi), 0);
+		else if (!camel_ews_message_info_get_attachment_count (CAMEL_EWS_MESSAGE_INFO (mi)))
+			changed = camel_ews_message_info_set_attachment_count (CAMEL_EWS_MESSAGE_INFO (mi), CAMEL_EWS_ATTACHMENT_COUNT_UNKNOWN);
+	}
+
+	if (preview_length && e_ews_item_get_preview (item)) {
+		changed = camel_ews_message_info_take_preview (CAMEL_EWS_MESSAGE_INFO (mi),
+			camel_ews_utils_make_preview (e_ews_item_get_preview (item), preview_length)) || changed;
+	}
+
+	return changed;
+}
+
 void
 camel_ews_utils_sync_created_items (CamelEwsFolder *ews_folder,
                                     EEwsConnection *cnc,
@@ -1143,12 +1320,14 @@ camel_ews_utils_sync_created_items (CamelEwsFolder *ews_folder,
 	CamelFolder *folder;
 	CamelFolderSummary *folder_summary;
 	GSList *l;
+	guint preview_length;
 
 	if (!items_created)
 		return;
 
 	folder = CAMEL_FOLDER (ews_folder);
 	folder_summary = camel_folder_get_folder_summary (folder);
+	preview_length = ews_utils_get_preview_length (ews_folder);
 
 	for (l = items_created; l != NULL; l = g_slist_next (l)) {
 		EEwsItem *item = (EEwsItem *) l->data;
@@ -1171,13 +1350,14 @@ camel_ews_utils_sync_created_items (CamelEwsFolder *ews_folder,
 			continue;
 		}
 
-		mi = camel_folder_summary_get (folder_summary, id->id);
 		/* If it didn't change, then skip it. */
-		if (mi && g_strcmp0 (camel_ews_message_info_get_change_key (CAMEL_EWS_MESSAGE_INFO (mi)), id->change_key) == 0) {
-			g_clear_object (&mi);
+		if (camel_ews_summary_has_item (folder_summary, id->id, id->change_key)) {
 			g_object_unref (item);
 			continue;
-		} else if (mi && is_drafts_folder) {
+		}
+
+		mi = camel_folder_summary_get (folder_summary, id->id);
+		if (mi && is_drafts_folder) {
 			/* The message in the Drafts folder changed, thus reload also locally cached message */
 			camel_ews_folder_remove_cached_message (ews_folder, id->id);
 		}
@@ -1190,6 +1370,8 @@ camel_ews_utils_sync_created_items (CamelEwsFolder *ews_folder,
 			continue;
 		}
 
+		ews_utils_update_preview (mi ? mi : tmp_mi, item, preview_length);
+
 		if (mi) {
 			ews_utils_copy_message_info (mi, tmp_mi);
 			camel_ews_message_info_set_change_key (CAMEL_EWS_MESSAGE_INFO (mi), id->change_key);
@@ -1217,6 +1399,71 @@ camel_ews_utils_sync_created_items (CamelEwsFolder *ews_folder,
 	g_slist_free (items_created);
 }
 
+/* Sets the To and Cc, and the preview, of the known messages from
+   the @items, which had been read with only these properties */
+void
+camel_ews_utils_sync_recipients (CamelEwsFolder *ews_folder,
+				 EEwsConnection *cnc,
+				 GSList *items,
+				 CamelFolderChangeInfo *change_info,
+				 GCancellable *cancellable)
+{
+	CamelFolderSummary *folder_summary;
+	GSList *l;
+	guint preview_length;
+
+	if (!items)
+		return;
+
+	folder_summary = camel_folder_get_folder_summary (CAMEL_FOLDER (ews_folder));
+	preview_length = ews_utils_get_preview_length (ews_folder);
+
+	for (l = items; l != NULL; l = g_slist_next (l)) {
+		EEwsItem *item = (EEwsItem *) l->data;
+		CamelMessageInfo *mi;
+		const EwsId *id;
+		gchar *tmp;
+
+		if (!item)
+			continue;
+
+		id = e_ews_item_get_item_type (item) == E_EWS_ITEM_TYPE_ERROR ? NULL : e_ews_item_get_id (item);
+		mi = id ? camel_folder_summary_get (folder_summary, id->id) : NULL;
+
+		if (mi) {
+			gboolean changed, was_changed;
+
+			camel_message_info_freeze_notifications (mi);
+			was_changed = camel_message_info_get_folder_flagged (mi);
+
+			tmp = form_recipient_list (cnc, e_ews_item_get_to_recipients (item), cancellable);
+			changed = camel_message_info_set_to (mi, tmp);
+			g_free (tmp);
+
+			tmp = form_recipient_list (cnc, e_ews_item_get_cc_recipients (item), cancellable);
+			changed = camel_message_info_set_cc (mi, tmp) || changed;
+			g_free (tmp);
+
+			changed = ews_utils_update_preview (mi, item, preview_length) || changed;
+
+			/* The recipients are not saved to the server */
+			if (!was_changed)
+				camel_message_info_set_folder_flagged (mi, FALSE);
+
+			camel_message_info_thaw_notifications (mi);
+
+			if (changed)
+				camel_folder_change_info_change_uid (change_info, id->id);
+
+			g_object_unref (mi);
+		}
+
+		g_object_unref (item);
+	}
+
+	g_slist_free (items);
+}
+
 gchar *
 camel_ews_utils_get_host_name (CamelSettings *settings)
 {
@@ -1247,15 +1494,26 @@ void
 ews_utils_update_followup_flags (ESoapMessage *msg,
 				 CamelMessageInfo *mi)
 {
-	const gchar *followup, *completed, *dueby;
-	time_t completed_tt = (time_t) 0 , dueby_tt = (time_t) 0;
-
 	g_return_if_fail (msg != NULL);
 	g_return_if_fail (mi != NULL);
 
-	followup = camel_message_info_get_user_tag (mi, "follow-up");
-	completed = camel_message_info_get_user_tag (mi, "completed-on");
-	dueby = camel_message_info_get_user_tag (mi, "due-by");
+	ews_utils_write_followup_flags (msg,
+		camel_message_info_get_user_tag (mi, "follow-up"),
+		camel_message_info_get_user_tag (mi, "completed-on"),
+		camel_message_info_get_user_tag (mi, "due-by"));
+}
+
+/* The same as ews_utils_update_followup_flags(), only with the values
+   of the "follow-up", "completed-on" and "due-by" user tags */
+void
+ews_utils_write_followup_flags (ESoapMessage *msg,
+				const gchar *followup,
+				const gchar *completed,
+				const gchar *dueby)
+{
+	time_t completed_tt = (time_t) 0 , dueby_tt = (time_t) 0;
+
+	g_return_if_fail (msg != NULL);
 
 	if (followup && !*followup)
 		followup = NULL;
@@ -1734,3 +1992,319 @@ camel_ews_utils_merge_category_list (CamelEwsStore *ews_store,
 		xmlXPathFreeContext (xpath_ctx);
 	xmlFreeDoc (doc);
 }
+
+static gboolean
+ews_utils_is_smime_content_type (const gchar *content_type)
+{
+	return content_type && (
+		g_ascii_strncasecmp (content_type, "application/pkcs7-mime", 22) == 0 ||
+		g_ascii_strncasecmp (content_type, "application/x-pkcs7-mime", 24) == 0 ||
+		g_ascii_strncasecmp (content_type, "multipart/signed", 16) == 0);
+}
+
+static CamelMimePart *
+ews_utils_new_placeholder_part (EEwsConnection *cnc,
+				const EEwsAttachmentMeta *meta)
+{
+	CamelDataWrapper *wrapper;
+	CamelMimePart *part;
+
+	wrapper = camel_ews_attachment_wrapper_new (cnc, meta->id);
+	camel_data_wrapper_set_mime_type (wrapper, meta->content_type ? meta->content_type : "application/octet-stream");
+
+	part = camel_mime_part_new ();
+	camel_medium_set_content (CAMEL_MEDIUM (part), wrapper);
+	camel_mime_part_set_disposition (part, meta->is_inline ? "inline" : "attachment");
+	camel_mime_part_set_encoding (part, CAMEL_TRANSFER_ENCODING_BASE64);
+
+	if (meta->name && *meta->name)
+		camel_mime_part_set_filename (part, meta->name);
+
+	if (meta->content_id && *meta->content_id)
+		camel_mime_part_set_content_id (part, meta->content_id);
+
+	g_object_unref (wrapper);
+
+	return part;
+}
+
+/* Constructs a message from the Body and the Attachments of the 'item',
+   without downloading any attachment; their content is downloaded only
+   when it is read (see CamelEwsAttachmentWrapper). The 'headers' are
+   used when known, otherwise the headers are constructed from the item
+   properties. Returns NULL, when the message cannot be represented this
+   way, like when it has item attachments or when it's S/MIME signed or
+   encrypted. */
+CamelMimeMessage *
+camel_ews_utils_build_partial_message (EEwsConnection *cnc,
+				       EEwsItem *item,
+				       const CamelNameValueArray *headers)
+{
+	CamelMimeMessage *msg;
+	CamelMimePart *part;
+	const GSList *link;
+	const gchar *body;
+	const gchar *body_type;
+
+	g_return_val_if_fail (E_IS_EWS_CONNECTION (cnc), NULL);
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	if (e_ews_item_get_item_type (item) != E_EWS_ITEM_TYPE_MESSAGE)
+		return NULL;
+
+	for (link = e_ews_item_get_attachments_meta (item); link; link = g_slist_next (link)) {
+		const EEwsAttachmentMeta *meta = link->data;
+
+		if (!meta || !meta->id || meta->is_item || ews_utils_is_smime_content_type (meta->content_type))
+			return NULL;
+	}
+
+	msg = camel_mime_message_new ();
+
+	if (headers) {
+		CamelMedium *medium = CAMEL_MEDIUM (msg);
+		guint ii, len;
+
+		len = camel_name_value_array_get_length (headers);
+
+		for (ii = 0; ii < len; ii++) {
+			const gchar *name = NULL, *value = NULL;
+
+			/* Skip any content-describing headers */
+			if (camel_name_value_array_get (headers, ii, &name, &value) &&
+			    name && g_ascii_strncasecmp (name, "Content-", 8) != 0) {
+				camel_medium_add_header (medium, name, value);
+			}
+		}
+	} else {
+		CamelMedium *medium = CAMEL_MEDIUM (msg);
+		const EwsMailbox *from;
+		gchar *tmp;
+
+		camel_mime_message_set_date (msg, e_ews_item_get_date_sent (item), 0);
+		if (e_ews_item_get_msg_id (item))
+			camel_mime_message_set_message_id (msg, e_ews_item_get_msg_id (item));
+		if (e_ews_item_get_in_replyto (item))
+			camel_medium_set_header (medium, "In-Reply-To", e_ews_item_get_in_replyto (item));
+		if (e_ews_item_get_references (item))
+			camel_medium_set_header (medium, "References", e_ews_item_get_references (item));
+
+		from = e_ews_item_get_from (item);
+		if (!from)
+			from = e_ews_item_get_sender (item);
+		tmp = form_email_string_from_mb (cnc, from, NULL);
+		if (tmp)
+			camel_medium_set_header (medium, "From", tmp);
+		g_free (tmp);
+
+		tmp = form_recipient_list (cnc, e_ews_item_get_to_recipients (item), NULL);
+		if (tmp)
+			camel_medium_set_header (medium, "To", tmp);
+		g_free (tmp);
+
+		tmp = form_recipient_list (cnc, e_ews_item_get_cc_recipients (item), NULL);
+		if (tmp)
+			camel_medium_set_header (medium, "Cc", tmp);
+		g_free (tmp);
+
+		camel_mime_message_set_subject (msg, e_ews_item_get_subject (item));
+	}
+
+	body = e_ews_item_get_body (item);
+	if (!body || !*body)
+		body = " ";
+
+	body_type = e_ews_item_get_body_is_html (item) ? "text/html; charset=utf-8" : "text/plain; charset=utf-8";
+
+	if (e_ews_item_get_attachments_meta (item)) {
+		CamelMultipart *m_mixed;
+
+		m_mixed = camel_multipart_new ();
+		camel_data_wrapper_set_mime_type (CAMEL_DATA_WRAPPER (m_mixed), "multipart/mixed");
+		camel_multipart_set_boundary (m_mixed, NULL);
+
+		part = camel_mime_part_new ();
+		camel_mime_part_set_encoding (part, CAMEL_TRANSFER_ENCODING_8BIT);
+		camel_mime_part_set_content (part, body, strlen (body), body_type);
+		camel_multipart_add_part (m_mixed, part);
+		g_object_unref (part);
+
+		for (link = e_ews_item_get_attachments_meta (item); link; link = g_slist_next (link)) {
+			part = ews_utils_new_placeholder_part (cnc, link->data);
+			camel_multipart_add_part (m_mixed, part);
+			g_object_unref (part);
+		}
+
+		camel_medium_set_content (CAMEL_MEDIUM (msg), CAMEL_DATA_WRAPPER (m_mixed));
+
+		g_object_unref (m_mixed);
+	} else {
+		camel_mime_part_set_encoding (CAMEL_MIME_PART (msg), CAMEL_TRANSFER_ENCODING_8BIT);
+		camel_mime_part_set_content (CAMEL_MIME_PART (msg), body, strlen (body), body_type);
+	}
+
+	return msg;
+}
+
+/* Collapses the white space of the @text and cuts it after @max_length
+   characters. Returns NULL, when there is nothing to show. */
+gchar *
+camel_ews_utils_make_preview (const gchar *text,
+			      guint max_length)
+{
+	GString *preview;
+	const gchar *ptr;
+	gchar *valid_text;
+	gboolean was_space = TRUE;
+	guint n_chars = 0;
+
+	if (!text || !*text || !max_length)
+		return NULL;
+
+	valid_text = e_util_utf8_make_valid (text);
+	preview = g_string_sized_new (MIN (max_length, 1024));
+
+	for (ptr = valid_text; *ptr && n_chars < max_length; ptr = g_utf8_next_char (ptr)) {
+		gunichar uc = g_utf8_get_char (ptr);
+
+		if (g_unichar_isspace (uc) || g_unichar_iscntrl (uc)) {
+			if (!was_space) {
+				g_string_append_c (preview, ' ');
+				n_chars++;
+			}
+
+			was_space = TRUE;
+		} else {
+			g_string_append_unichar (preview, uc);
+			n_chars++;
+			was_space = FALSE;
+		}
+	}
+
+	g_free (valid_text);
+
+	if (preview->len && preview->str[preview->len - 1] == ' ')
+		g_string_truncate (preview, preview->len - 1);
+
+	if (!preview->len) {
+		g_string_free (preview, TRUE);
+		return NULL;
+	}
+
+	return g_string_free (preview, FALSE);
+}
+
+static CamelMimePart *
+ews_utils_find_text_part (CamelMimePart *part)
+{
+	CamelDataWrapper *content;
+	CamelContentType *content_type;
+	const gchar *disposition;
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (part));
+	if (!content || camel_data_wrapper_is_offline (content))
+		return NULL;
+
+	if (CAMEL_IS_MULTIPART (content)) {
+		CamelMultipart *multipart = CAMEL_MULTIPART (content);
+		CamelMimePart *html_part = NULL;
+		guint ii, n_parts;
+
+		n_parts = camel_multipart_get_number (multipart);
+
+		/* Prefer the plain text from the multipart/alternative */
+		for (ii = 0; ii < n_parts; ii++) {
+			CamelMimePart *text_part;
+
+			text_part = ews_utils_find_text_part (camel_multipart_get_part (multipart, ii));
+			if (!text_part)
+				continue;
+
+			if (!camel_content_type_is (camel_mime_part_get_content_type (text_part), "text", "html"))
+				return text_part;
+
+			if (!html_part)
+				html_part = text_part;
+		}
+
+		return html_part;
+	}
+
+	disposition = camel_mime_part_get_disposition (part);
+	if (disposition && g_ascii_strcasecmp (disposition, "attachment") == 0)
+		return NULL;
+
+	content_type = camel_mime_part_get_content_type (part);
+	if (content_type && (
+	    camel_content_type_is (content_type, "text", "plain") ||
+	    camel_content_type_is (content_type, "text", "html")))
+		return part;
+
+	return NULL;
+}
+
+/* Derives the preview from the body of a downloaded message, for servers
+   which do not provide it. Returns NULL, when the message has no text. */
+gchar *
+camel_ews_utils_dup_message_preview (CamelMimeMessage *message,
+				     guint max_length,
+				     GCancellable *cancellable)
+{
+	CamelMimePart *text_part;
+	CamelContentType *content_type;
+	CamelStream *mem, *stream;
+	const gchar *charset;
+	gchar *preview = NULL;
+
+	g_return_val_if_fail (CAMEL_IS_MIME_MESSAGE (message), NULL);
+
+	if (!max_length)
+		return NULL;
+
+	text_part = ews_utils_find_text_part (CAMEL_MIME_PART (message));
+	if (!text_part)
+		return NULL;
+
+	content_type = camel_mime_part_get_content_type (text_part);
+
+	mem = camel_stream_mem_new ();
+	stream = camel_stream_filter_new (mem);
+
+	charset = camel_content_type_param (content_type, "charset");
+	if (charset && g_ascii_strcasecmp (charset, "utf-8") != 0 && g_ascii_strcasecmp (charset, "us-ascii") != 0) {
+		CamelMimeFilter *filter;
+
+		filter = camel_mime_filter_charset_new (charset, "UTF-8");
+		if (filter) {
+			camel_stream_filter_add (CAMEL_STREAM_FILTER (stream), filter);
+			g_object_unref (filter);
+		}
+	}
+
+	if (camel_content_type_is (content_type, "text", "html")) {
+		CamelMimeFilter *filter;
+
+		filter = camel_mime_filter_html_new ();
+		camel_stream_filter_add (CAMEL_STREAM_FILTER (stream), filter);
+		g_object_unref (filter);
+	}
+
+	if (camel_data_wrapper_decode_to_stream_sync (camel_medium_get_content (CAMEL_MEDIUM (text_part)), stream, cancellable, NULL) != -1 &&
+	    camel_stream_flush (stream, cancellable, NULL) != -1) {
+		GByteArray *bytes;
+
+		bytes = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (mem));
+		if (bytes && bytes->len) {
+			gchar *text;
+
+			text = g_strndup ((const gchar *) bytes->data, bytes->len);
+			preview = camel_ews_utils_make_preview (text, max_length);
+			g_free (text);
+		}
+	}
+
+	g_object_unref (stream);
+	g_object_unref (mem);
+
+	return preview;
+}
@@ -78,11 +78,21 @@ void		camel_ews_utils_sync_updated_items
 						 GSList *items_updated,
 						 CamelFolderChangeInfo *change_info,
 						 GCancellable *cancellable);
+void		camel_ews_utils_sync_recipients
+						(CamelEwsFolder *ews_folder,
+						 EEwsConnection *cnc,
+						 GSList *items,
+						 CamelFolderChangeInfo *change_info,
+						 GCancellable *cancellable);
 GSList *	ews_utils_gather_server_user_flags
 						(ESoapMessage *msg,
 						 CamelMessageInfo *mi);
 void		ews_utils_update_followup_flags (ESoapMessage *msg,
 						 CamelMessageInfo *mi);
+void		ews_utils_write_followup_flags	(ESoapMessage *msg,
+						 const gchar *followup,
+						 const gchar *completed,
+						 const gchar *dueby);
 gchar *		camel_ews_utils_get_host_name	(CamelSettings *settings);
 gboolean	camel_ews_utils_delete_folders_from_summary_recursive
 						(CamelEwsStore *ews_store,
@@ -98,6 +108,23 @@ CamelMessageInfo * /* (transfer full) */
 						 EEwsConnection *cnc,
 						 EEwsItem *item,
 						 GCancellable *cancellable);
+gboolean	camel_ews_utils_get_conversation_threading
+						(const gchar *conversation_id,
+						 const gchar *conversation_index,
+						 guint64 *out_conversation_key,
+						 guint64 *out_message_id,
+						 GArray **out_references); /* guint64 */
+CamelMimeMessage *
+		camel_ews_utils_build_partial_message
+						(EEwsConnection *cnc,
+						 EEwsItem *item,
+						 const CamelNameValueArray *headers);
+gchar *		camel_ews_utils_make_preview	(const gchar *text,
+						 guint max_length);
+gchar *		camel_ews_utils_dup_message_preview
+						(CamelMimeMessage *message,
+						 guint max_length,
+						 GCancellable *cancellable);
 gboolean	camel_ews_utils_folder_is_drafts_folder
 						(CamelEwsFolder *ews_folder);
 void		camel_ews_utils_merge_category_list
@@ -122,6 +122,19 @@ book_config_ews_maybe_insert_gal_options (ESourceConfigBackend *backend,
 			G_BINDING_DEFAULT);
 
 		e_source_config_insert_widget (e_source_config_backend_get_config (backend), scratch_source, NULL, checkbox);
+
+		checkbox = gtk_check_button_new_with_mnemonic (_("Keep only _index of the offline GAL"));
+		gtk_widget_set_tooltip_text (checkbox, _("When checked, the downloaded offline Global Address List is searched through a compact index and its contacts are not stored in the local cache, which saves disk space and memory for large directories"));
+		gtk_widget_show (checkbox);
+
+		gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (checkbox), e_source_ews_folder_get_thin_gal (ews_folder));
+
+		e_binding_bind_property (
+			checkbox, "active",
+			ews_folder, "thin-gal",
+			G_BINDING_DEFAULT);
+
+		e_source_config_insert_widget (e_source_config_backend_get_config (backend), scratch_source, NULL, checkbox);
 	}
 }
 
@@ -18,6 +18,10 @@
 
 #include "evolution-ews-config.h"
 
+#include <glib/gi18n-lib.h>
+
+#include "server/e-source-ews-folder.h"
+
 #include "e-cal-config-ews.h"
 
 G_DEFINE_DYNAMIC_TYPE (
@@ -51,6 +55,75 @@ cal_config_ews_allow_creation (ESourceConfigBackend *backend)
 	return allow_creation;
 }
 
+static void
+cal_config_ews_insert_sync_window_options (ESourceConfigBackend *backend,
+					   ESource *scratch_source)
+{
+	ESourceConfig *config;
+	ESourceEwsFolder *ews_folder;
+	GtkWidget *checkbox, *hbox, *widget;
+
+	config = e_source_config_backend_get_config (backend);
+
+	if (e_cal_source_config_get_source_type (E_CAL_SOURCE_CONFIG (config)) != E_CAL_CLIENT_SOURCE_TYPE_EVENTS ||
+	    !e_source_has_extension (scratch_source, E_SOURCE_EXTENSION_EWS_FOLDER))
+		return;
+
+	ews_folder = e_source_get_extension (scratch_source, E_SOURCE_EXTENSION_EWS_FOLDER);
+
+	checkbox = gtk_check_button_new_with_mnemonic (_("Synchronize only events _near today"));
+	gtk_widget_set_tooltip_text (checkbox, _("When checked, only events in the given time range are stored in the local cache; older events are downloaded when they are shown"));
+	gtk_widget_show (checkbox);
+
+	e_binding_bind_property (
+		ews_folder, "sync-window",
+		checkbox, "active",
+		G_BINDING_BIDIRECTIONAL |
+		G_BINDING_SYNC_CREATE);
+
+	e_source_config_insert_widget (config, scratch_source, NULL, checkbox);
+
+	hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 4);
+	gtk_widget_show (hbox);
+
+	e_binding_bind_property (
+		checkbox, "active",
+		hbox, "sensitive",
+		G_BINDING_SYNC_CREATE);
+
+	/* Translators: This is part of "Weeks before today: [ 26 ] after: [ 52 ]" */
+	widget = gtk_label_new (_("Weeks before today:"));
+	gtk_widget_show (widget);
+	gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+	widget = gtk_spin_button_new_with_range (1, 520, 1);
+	gtk_widget_show (widget);
+	gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+	e_binding_bind_property (
+		ews_folder, "sync-weeks-before",
+		widget, "value",
+		G_BINDING_BIDIRECTIONAL |
+		G_BINDING_SYNC_CREATE);
+
+	/* Translators: This is part of "Weeks before today: [ 26 ] after: [ 52 ]" */
+	widget = gtk_label_new (_("after:"));
+	gtk_widget_show (widget);
+	gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+	widget = gtk_spin_button_new_with_range (1, 520, 1);
+	gtk_widget_show (widget);
+	gtk_box_pack_start (GTK_BOX (hbox), widget, FALSE, FALSE, 0);
+
+	e_binding_bind_property (
+		ews_folder, "sync-weeks-after",
+		widget, "value",
+		G_BINDING_BIDIRECTIONAL |
+		G_BINDING_SYNC_CREATE);
+
+	e_source_config_insert_widget (config, scratch_source, NULL, hbox);
+}
+
 static void
 cal_config_ews_insert_widgets (ESourceConfigBackend *backend,
 			       ESource *scratch_source)
@@ -59,6 +132,8 @@ cal_config_ews_insert_widgets (ESourceConfigBackend *backend,
 		return;
 
 	e_source_config_add_refresh_interval (e_source_config_backend_get_config (backend), scratch_source);
+
+	cal_config_ews_insert_sync_window_options (backend, scratch_source);
 }
 
 static void
@@ -47,6 +47,10 @@ struct _CamelEwsSettingsPrivate {
 	gchar *oauth2_tenant;
 	gchar *oauth2_client_id;
 	gchar *oauth2_redirect_uri;
+	gboolean sync_summary_props;
+	guint message_cache_limit;
+	guint partial_fetch_min_size;
+	guint preview_length;
 };
 
 enum {
@@ -74,7 +78,11 @@ enum {
 	PROP_OVERRIDE_OAUTH2,
 	PROP_OAUTH2_TENANT,
 	PROP_OAUTH2_CLIENT_ID,
-	PROP_OAUTH2_REDIRECT_URI
+	PROP_OAUTH2_REDIRECT_URI,
+	PROP_SYNC_SUMMARY_PROPS,
+	PROP_MESSAGE_CACHE_LIMIT,
+	PROP_PARTIAL_FETCH_MIN_SIZE,
+	PROP_PREVIEW_LENGTH
 };
 
 G_DEFINE_TYPE_WITH_CODE (
@@ -263,6 +271,30 @@ ews_settings_set_property (GObject *object,
 				CAMEL_EWS_SETTINGS (object),
 				g_value_get_string (value));
 			return;
+
+		case PROP_SYNC_SUMMARY_PROPS:
+			camel_ews_settings_set_sync_summary_props (
+				CAMEL_EWS_SETTINGS (object),
+				g_value_get_boolean (value));
+			return;
+
+		case PROP_MESSAGE_CACHE_LIMIT:
+			camel_ews_settings_set_message_cache_limit (
+				CAMEL_EWS_SETTINGS (object),
+				g_value_get_uint (value));
+			return;
+
+		case PROP_PARTIAL_FETCH_MIN_SIZE:
+			camel_ews_settings_set_partial_fetch_min_size (
+				CAMEL_EWS_SETTINGS (object),
+				g_value_get_uint (value));
+			return;
+
+		case PROP_PREVIEW_LENGTH:
+			camel_ews_settings_set_preview_length (
+				CAMEL_EWS_SETTINGS (object),
+				g_value_get_uint (value));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -442,6 +474,34 @@ ews_settings_get_property (GObject *object,
 				camel_ews_settings_dup_oauth2_redirect_uri (
 				CAMEL_EWS_SETTINGS (object)));
 			return;
+
+		case PROP_SYNC_SUMMARY_PROPS:
+			g_value_set_boolean (
+				value,
+				camel_ews_settings_get_sync_summary_props (
+				CAMEL_EWS_SETTINGS (object)));
+			return;
+
+		case PROP_MESSAGE_CACHE_LIMIT:
+			g_value_set_uint (
+				value,
+				camel_ews_settings_get_message_cache_limit (
+				CAMEL_EWS_SETTINGS (object)));
+			return;
+
+		case PROP_PARTIAL_FETCH_MIN_SIZE:
+			g_value_set_uint (
+				value,
+				camel_ews_settings_get_partial_fetch_min_size (
+				CAMEL_EWS_SETTINGS (object)));
+			return;
+
+		case PROP_PREVIEW_LENGTH:
+			g_value_set_uint (
+				value,
+				camel_ews_settings_get_preview_length (
+				CAMEL_EWS_SETTINGS (object)));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -740,6 +800,54 @@ camel_ews_settings_class_init (CamelEwsSettingsClass *class)
 			G_PARAM_READWRITE |
 			G_PARAM_CONSTRUCT |
 			G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_SYNC_SUMMARY_PROPS,
+		g_param_spec_boolean (
+			"sync-summary-props",
+			"Sync Summary Properties",
+			"Whether to read the message summary properties together with the folder changes",
+			FALSE,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_MESSAGE_CACHE_LIMIT,
+		g_param_spec_uint (
+			"message-cache-limit",
+			"Message Cache Limit",
+			"Size limit of the locally cached messages of the account in megabytes, 0 for no limit",
+			0, G_MAXUINT, 0,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_PARTIAL_FETCH_MIN_SIZE,
+		g_param_spec_uint (
+			"partial-fetch-min-size",
+			"Partial Fetch Min Size",
+			"Messages of this size in kilobytes and larger are opened without downloading their attachments, 0 to always download whole messages",
+			0, G_MAXUINT, 0,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_PREVIEW_LENGTH,
+		g_param_spec_uint (
+			"preview-length",
+			"Preview Length",
+			"How many characters of the message text to store in the folder summary, 0 to not store any",
+			0, G_MAXUINT, 200,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -1543,3 +1651,91 @@ camel_ews_settings_set_oauth2_redirect_uri (CamelEwsSettings *settings,
 
 	g_object_notify (G_OBJECT (settings), "oauth2-redirect-uri");
 }
+
+gboolean
+camel_ews_settings_get_sync_summary_props (CamelEwsSettings *settings)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_SETTINGS (settings), FALSE);
+
+	return settings->priv->sync_summary_props;
+}
+
+void
+camel_ews_settings_set_sync_summary_props (CamelEwsSettings *settings,
+					   gboolean sync_summary_props)
+{
+	g_return_if_fail (CAMEL_IS_EWS_SETTINGS (settings));
+
+	if ((settings->priv->sync_summary_props ? 1 : 0) == (sync_summary_props ? 1 : 0))
+		return;
+
+	settings->priv->sync_summary_props = sync_summary_props;
+
+	g_object_notify (G_OBJECT (settings), "sync-summary-props");
+}
+
+guint
+camel_ews_settings_get_message_cache_limit (CamelEwsSettings *settings)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_SETTINGS (settings), 0);
+
+	return settings->priv->message_cache_limit;
+}
+
+void
+camel_ews_settings_set_message_cache_limit (CamelEwsSettings *settings,
+					    guint message_cache_limit)
+{
+	g_return_if_fail (CAMEL_IS_EWS_SETTINGS (settings));
+
+	if (settings->priv->message_cache_limit == message_cache_limit)
+		return;
+
+	settings->priv->message_cache_limit = message_cache_limit;
+
+	g_object_notify (G_OBJECT (settings), "message-cache-limit");
+}
+
+guint
+camel_ews_settings_get_partial_fetch_min_size (CamelEwsSettings *settings)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_SETTINGS (settings), 0);
+
+	return settings->priv->partial_fetch_min_size;
+}
+
+void
+camel_ews_settings_set_partial_fetch_min_size (CamelEwsSettings *settings,
+					       guint partial_fetch_min_size)
+{
+	g_return_if_fail (CAMEL_IS_EWS_SETTINGS (settings));
+
+	if (settings->priv->partial_fetch_min_size == partial_fetch_min_size)
+		return;
+
+	settings->priv->partial_fetch_min_size = partial_fetch_min_size;
+
+	g_object_notify (G_OBJECT (settings), "partial-fetch-min-size");
+}
+
+guint
+camel_ews_settings_get_preview_length (CamelEwsSettings *settings)
+{
+	g_return_val_if_fail (CAMEL_IS_EWS_SETTINGS (settings), 0);
+
+	return settings->priv->preview_length;
+}
+
+void
+camel_ews_settings_set_preview_length (CamelEwsSettings *settings,
+				       guint preview_length)
+{
+	g_return_if_fail (CAMEL_IS_EWS_SETTINGS (settings));
+
+	if (settings->priv->preview_length == preview_length)
+		return;
+
+	settings->priv->preview_length = preview_length;
+
+	g_object_notify (G_OBJECT (settings), "preview-length");
+}
@@ -167,6 +167,26 @@ gchar *		camel_ews_settings_dup_oauth2_redirect_uri
 void		camel_ews_settings_set_oauth2_redirect_uri
 						(CamelEwsSettings *settings,
 						 const gchar *redirect_uri);
+gboolean	camel_ews_settings_get_sync_summary_props
+						(CamelEwsSettings *settings);
+void		camel_ews_settings_set_sync_summary_props
+						(CamelEwsSettings *settings,
+						 gboolean sync_summary_props);
+guint		camel_ews_settings_get_message_cache_limit
+						(CamelEwsSettings *settings);
+void		camel_ews_settings_set_message_cache_limit
+						(CamelEwsSettings *settings,
+						 guint message_cache_limit);
+guint		camel_ews_settings_get_partial_fetch_min_size
+						(CamelEwsSettings *settings);
+void		camel_ews_settings_set_partial_fetch_min_size
+						(CamelEwsSettings *settings,
+						 guint partial_fetch_min_size);
+guint		camel_ews_settings_get_preview_length
+						(CamelEwsSettings *settings);
+void		camel_ews_settings_set_preview_length
+						(CamelEwsSettings *settings,
+						 guint preview_length);
 
 G_END_DECLS
 
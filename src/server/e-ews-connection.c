@@ -4705,6 +4705,177 @@ e_ews_connection_find_folder_items_sync (EEwsConnection *cnc,
 	return success;
 }
 
+/**
+ * e_ews_connection_find_calendar_view:
+ * @cnc: The EWS Connection
+ * @pri: The priority associated with the request
+ * @fid: The calendar folder id to look in
+ * @default_props: Can take one of the values: IdOnly,Default or AllProperties
+ * @add_props: Specify any additional properties to be fetched
+ * @start: the beginning of the time range
+ * @end: the end of the time range
+ * @max_entries: the maximum number of items to return, or 0 for no limit
+ * @cancellable: a GCancellable to monitor cancelled operations
+ * @callback: Responses are parsed and returned to this callback
+ * @user_data: user data passed to callback
+ *
+ * Finds calendar items overlapping the @start and @end range, using
+ * a CalendarView, thus the recurring items are expanded into their
+ * occurrences and exceptions, which are returned instead of the master.
+ **/
+void
+e_ews_connection_find_calendar_view (EEwsConnection *cnc,
+				     gint pri,
+				     EwsFolderId *fid,
+				     const gchar *default_props,
+				     const EEwsAdditionalProps *add_props,
+				     time_t start,
+				     time_t end,
+				     guint max_entries,
+				     GCancellable *cancellable,
+				     GAsyncReadyCallback callback,
+				     gpointer user_data)
+{
+	ESoapMessage *msg;
+	GSimpleAsyncResult *simple;
+	EwsAsyncData *async_data;
+	GTimeVal tv;
+	gchar *iso_time;
+
+	g_return_if_fail (cnc != NULL);
+	g_return_if_fail (fid != NULL);
+
+	msg = e_ews_message_new_with_header (
+			cnc->priv->settings,
+			cnc->priv->uri,
+			cnc->priv->impersonate_user,
+			"FindItem",
+			"Traversal",
+			"Shallow",
+			cnc->priv->version,
+			E_EWS_EXCHANGE_2007_SP1,
+			FALSE,
+			TRUE);
+	e_soap_message_start_element (msg, "ItemShape", "messages", NULL);
+	e_ews_message_write_string_parameter (msg, "BaseShape", NULL, default_props);
+
+	ews_append_additional_props_to_msg (msg, add_props);
+
+	e_soap_message_end_element (msg);
+
+	e_soap_message_start_element (msg, "CalendarView", "messages", NULL);
+
+	if (max_entries > 0) {
+		gchar *str = g_strdup_printf ("%u", max_entries);
+		e_soap_message_add_attribute (msg, "MaxEntriesReturned", str, NULL, NULL);
+		g_free (str);
+	}
+
+	tv.tv_usec = 0;
+
+	tv.tv_sec = start;
+	iso_time = g_time_val_to_iso8601 (&tv);
+	e_soap_message_add_attribute (msg, "StartDate", iso_time, NULL, NULL);
+	g_free (iso_time);
+
+	tv.tv_sec = end;
+	iso_time = g_time_val_to_iso8601 (&tv);
+	e_soap_message_add_attribute (msg, "EndDate", iso_time, NULL, NULL);
+	g_free (iso_time);
+
+	e_soap_message_end_element (msg); /* CalendarView */
+
+	e_soap_message_start_element (msg, "ParentFolderIds", "messages", NULL);
+
+	if (fid->is_distinguished_id)
+		e_ews_message_write_string_parameter_with_attribute (msg, "DistinguishedFolderId", NULL, NULL, "Id", fid->id);
+	else
+		e_ews_message_write_string_parameter_with_attribute (msg, "FolderId", NULL, NULL, "Id", fid->id);
+
+	e_soap_message_end_element (msg);
+
+	e_ews_message_write_footer (msg);
+
+	simple = g_simple_async_result_new (
+		G_OBJECT (cnc), callback, user_data,
+		e_ews_connection_find_calendar_view);
+
+	async_data = g_new0 (EwsAsyncData, 1);
+	g_simple_async_result_set_op_res_gpointer (
+		simple, async_data, (GDestroyNotify) async_data_free);
+
+	e_ews_connection_queue_request (
+		cnc, msg, find_folder_items_response_cb,
+		pri, cancellable, simple);
+
+	g_object_unref (simple);
+}
+
+gboolean
+e_ews_connection_find_calendar_view_finish (EEwsConnection *cnc,
+					    GAsyncResult *result,
+					    gboolean *includes_last_item,
+					    GSList **items,
+					    GError **error)
+{
+	GSimpleAsyncResult *simple;
+	EwsAsyncData *async_data;
+
+	g_return_val_if_fail (cnc != NULL, FALSE);
+	g_return_val_if_fail (
+		g_simple_async_result_is_valid (
+		result, G_OBJECT (cnc), e_ews_connection_find_calendar_view),
+		FALSE);
+
+	simple = G_SIMPLE_ASYNC_RESULT (result);
+	async_data = g_simple_async_result_get_op_res_gpointer (simple);
+
+	if (g_simple_async_result_propagate_error (simple, error))
+		return FALSE;
+
+	*includes_last_item = async_data->includes_last_item;
+	*items = async_data->items;
+
+	return TRUE;
+}
+
+gboolean
+e_ews_connection_find_calendar_view_sync (EEwsConnection *cnc,
+					  gint pri,
+					  EwsFolderId *fid,
+					  const gchar *default_props,
+					  const EEwsAdditionalProps *add_props,
+					  time_t start,
+					  time_t end,
+					  guint max_entries,
+					  gboolean *includes_last_item,
+					  GSList **items,
+					  GCancellable *cancellable,
+					  GError **error)
+{
+	EAsyncClosure *closure;
+	GAsyncResult *result;
+	gboolean success;
+
+	g_return_val_if_fail (cnc != NULL, FALSE);
+
+	closure = e_async_closure_new ();
+
+	e_ews_connection_find_calendar_view (
+		cnc, pri, fid, default_props,
+		add_props, start, end, max_entries,
+		cancellable, e_async_closure_callback, closure);
+
+	result = e_async_closure_wait (closure);
+
+	success = e_ews_connection_find_calendar_view_finish (
+		cnc, result, includes_last_item, items, error);
+
+	e_async_closure_free (closure);
+
+	return success;
+}
+
 void
 e_ews_connection_sync_folder_hierarchy (EEwsConnection *cnc,
                                         gint pri,
@@ -4886,20 +5057,21 @@ e_ews_connection_satisfies_server_version (EEwsConnection *cnc,
 	return cnc->priv->version >= version;
 }
 
-void
-e_ews_connection_get_items (EEwsConnection *cnc,
-                            gint pri,
-                            const GSList *ids,
-                            const gchar *default_props,
-			    const EEwsAdditionalProps *add_props,
-                            gboolean include_mime,
-                            const gchar *mime_directory,
-			    EEwsBodyType body_type,
-                            ESoapProgressFn progress_fn,
-                            gpointer progress_data,
-                            GCancellable *cancellable,
-                            GAsyncReadyCallback callback,
-                            gpointer user_data)
+static void
+ews_connection_get_items_internal (EEwsConnection *cnc,
+				   gint pri,
+				   const GSList *ids,
+				   gboolean ids_are_occurrences,
+				   const gchar *default_props,
+				   const EEwsAdditionalProps *add_props,
+				   gboolean include_mime,
+				   const gchar *mime_directory,
+				   EEwsBodyType body_type,
+				   ESoapProgressFn progress_fn,
+				   gpointer progress_data,
+				   GCancellable *cancellable,
+				   GAsyncReadyCallback callback,
+				   gpointer user_data)
 {
 	ESoapMessage *msg;
 	GSimpleAsyncResult *simple;
@@ -4953,8 +5125,12 @@ e_ews_connection_get_items (EEwsConnection *cnc,
 
 	e_soap_message_start_element (msg, "ItemIds", "messages", NULL);
 
-	for (l = ids; l != NULL; l = g_slist_next (l))
-		e_ews_message_write_string_parameter_with_attribute (msg, "ItemId", NULL, NULL, "Id", l->data);
+	for (l = ids; l != NULL; l = g_slist_next (l)) {
+		if (ids_are_occurrences)
+			e_ews_message_write_string_parameter_with_attribute (msg, "RecurringMasterItemId", NULL, NULL, "OccurrenceId", l->data);
+		else
+			e_ews_message_write_string_parameter_with_attribute (msg, "ItemId", NULL, NULL, "Id", l->data);
+	}
 
 	e_soap_message_end_element (msg);
 
@@ -4975,6 +5151,26 @@ e_ews_connection_get_items (EEwsConnection *cnc,
 	g_object_unref (simple);
 }
 
+void
+e_ews_connection_get_items (EEwsConnection *cnc,
+                            gint pri,
+                            const GSList *ids,
+                            const gchar *default_props,
+			    const EEwsAdditionalProps *add_props,
+                            gboolean include_mime,
+                            const gchar *mime_directory,
+			    EEwsBodyType body_type,
+                            ESoapProgressFn progress_fn,
+                            gpointer progress_data,
+                            GCancellable *cancellable,
+                            GAsyncReadyCallback callback,
+                            gpointer user_data)
+{
+	ews_connection_get_items_internal (cnc, pri, ids, FALSE, default_props, add_props,
+		include_mime, mime_directory, body_type, progress_fn, progress_data,
+		cancellable, callback, user_data);
+}
+
 gboolean
 e_ews_connection_get_items_finish (EEwsConnection *cnc,
                                    GAsyncResult *result,
@@ -5046,6 +5242,55 @@ e_ews_connection_get_items_sync (EEwsConnection *cnc,
 	return success;
 }
 
+/**
+ * e_ews_connection_get_recurring_masters_sync:
+ * @cnc: The EWS Connection
+ * @pri: The priority associated with the request
+ * @occurrence_ids: (element-type utf8): ItemId-s of occurrences or exceptions
+ * @default_props: Can take one of the values: IdOnly,Default or AllProperties
+ * @add_props: Specify any additional properties to be fetched
+ * @items: (out) (element-type EEwsItem): the recurring master items
+ * @cancellable: a GCancellable to monitor cancelled operations
+ * @error: return location for a GError, or %NULL
+ *
+ * Gets recurring master items of the given occurrences, in the same
+ * order as the @occurrence_ids. The same as e_ews_connection_get_items_sync(),
+ * the failed items are returned as error items.
+ **/
+gboolean
+e_ews_connection_get_recurring_masters_sync (EEwsConnection *cnc,
+					     gint pri,
+					     const GSList *occurrence_ids,
+					     const gchar *default_props,
+					     const EEwsAdditionalProps *add_props,
+					     GSList **items,
+					     GCancellable *cancellable,
+					     GError **error)
+{
+	EAsyncClosure *closure;
+	GAsyncResult *result;
+	gboolean success;
+
+	g_return_val_if_fail (cnc != NULL, FALSE);
+
+	closure = e_async_closure_new ();
+
+	ews_connection_get_items_internal (
+		cnc, pri, occurrence_ids, TRUE, default_props,
+		add_props, FALSE, NULL, E_EWS_BODY_TYPE_ANY,
+		NULL, NULL, cancellable,
+		e_async_closure_callback, closure);
+
+	result = e_async_closure_wait (closure);
+
+	success = e_ews_connection_get_items_finish (
+		cnc, result, items, error);
+
+	e_async_closure_free (closure);
+
+	return success;
+}
+
 static const gchar *
 ews_delete_type_to_str (EwsDeleteType delete_type)
 {
@@ -591,6 +591,38 @@ gboolean	e_ews_connection_find_folder_items_sync
 						 GCancellable *cancellable,
 						 GError **error);
 
+void		e_ews_connection_find_calendar_view
+						(EEwsConnection *cnc,
+						 gint pri,
+						 EwsFolderId *fid,
+						 const gchar *default_props,
+						 const EEwsAdditionalProps *add_props,
+						 time_t start,
+						 time_t end,
+						 guint max_entries,
+						 GCancellable *cancellable,
+						 GAsyncReadyCallback callback,
+						 gpointer user_data);
+gboolean	e_ews_connection_find_calendar_view_finish
+						(EEwsConnection *cnc,
+						 GAsyncResult *result,
+						 gboolean *includes_last_item,
+						 GSList **items,
+						 GError **error);
+gboolean	e_ews_connection_find_calendar_view_sync
+						(EEwsConnection *cnc,
+						 gint pri,
+						 EwsFolderId *fid,
+						 const gchar *default_props,
+						 const EEwsAdditionalProps *add_props,
+						 time_t start,
+						 time_t end,
+						 guint max_entries,
+						 gboolean *includes_last_item,
+						 GSList **items,
+						 GCancellable *cancellable,
+						 GError **error);
+
 EEwsServerVersion
 		e_ews_connection_get_server_version
 						(EEwsConnection *cnc);
@@ -635,6 +667,15 @@ gboolean	e_ews_connection_get_items_sync	(EEwsConnection *cnc,
 						 gpointer progress_data,
 						 GCancellable *cancellable,
 						 GError **error);
+gboolean	e_ews_connection_get_recurring_masters_sync
+						(EEwsConnection *cnc,
+						 gint pri,
+						 const GSList *occurrence_ids,
+						 const gchar *default_props,
+						 const EEwsAdditionalProps *add_props,
+						 GSList **items,
+						 GCancellable *cancellable,
+						 GError **error);
 
 void		e_ews_connection_delete_items	(EEwsConnection *cnc,
 						 gint pri,
@@ -83,6 +83,22 @@ struct _EEwsTaskFields {
 	gboolean has_complete_date;
 };
 
+struct _EEwsCalendarFields {
+	time_t start;
+	time_t end;
+	time_t recurrence_id;
+	gboolean has_start;
+	gboolean has_end;
+	gboolean has_recurrence_id;
+	gboolean is_all_day_event;
+	gchar *location;
+	gchar *legacy_free_busy_status;
+	gchar *calendar_item_type;
+	gchar *sensitivity;
+	EwsMailbox *organizer;
+	GSList *deleted_occurrences; /* time_t * */
+};
+
 struct _EEwsItemPrivate {
 	EwsId *attachment_id;
 	EEwsItemType item_type;
@@ -109,6 +125,8 @@ struct _EEwsItemPrivate {
 	gchar *subject;
 	gchar *mime_content;
 	gchar *body;
+	gboolean body_is_html;
+	gchar *preview;
 
 	gchar *date_header;
 	time_t date_received;
@@ -120,6 +138,8 @@ struct _EEwsItemPrivate {
 	gchar *msg_id;
 	gchar *in_replyto;
 	gchar *references;
+	gchar *conversation_id;
+	gchar *conversation_index;
 	gboolean has_attachments;
 	gboolean is_read;
 	EwsImportance importance;
@@ -129,6 +149,7 @@ struct _EEwsItemPrivate {
 	gchar *start_timezone;
 	gchar *end_timezone;
 	gchar *contact_photo_id;
+	gchar *contact_photo_stamp;
 	gchar *iana_start_time_zone;
 	gchar *iana_end_time_zone;
 
@@ -143,6 +164,7 @@ struct _EEwsItemPrivate {
 	gboolean is_response_requested;
 	GSList *modified_occurrences;
 	GSList *attachments_ids;
+	GSList *attachments_meta; /* EEwsAttachmentMeta * */
 	gchar *my_response_type;
 	GSList *attendees;
 
@@ -161,6 +183,7 @@ struct _EEwsItemPrivate {
 
 	struct _EEwsContactFields *contact_fields;
 	struct _EEwsTaskFields *task_fields;
+	struct _EEwsCalendarFields *calendar_fields;
 };
 
 static void	ews_item_free_attendee (EwsAttendee *attendee);
@@ -206,16 +229,20 @@ e_ews_item_dispose (GObject *object)
 
 	g_clear_pointer (&priv->mime_content, g_free);
 	g_clear_pointer (&priv->body, g_free);
+	g_clear_pointer (&priv->preview, g_free);
 	g_clear_pointer (&priv->subject, g_free);
 	g_clear_pointer (&priv->msg_id, g_free);
 	g_clear_pointer (&priv->uid, g_free);
 	g_clear_pointer (&priv->in_replyto, g_free);
 	g_clear_pointer (&priv->references, g_free);
+	g_clear_pointer (&priv->conversation_id, g_free);
+	g_clear_pointer (&priv->conversation_index, g_free);
 	g_clear_pointer (&priv->date_header, g_free);
 	g_clear_pointer (&priv->timezone, g_free);
 	g_clear_pointer (&priv->start_timezone, g_free);
 	g_clear_pointer (&priv->end_timezone, g_free);
 	g_clear_pointer (&priv->contact_photo_id, g_free);
+	g_clear_pointer (&priv->contact_photo_stamp, g_free);
 	g_clear_pointer (&priv->iana_start_time_zone, g_free);
 	g_clear_pointer (&priv->iana_end_time_zone, g_free);
 
@@ -234,6 +261,9 @@ e_ews_item_dispose (GObject *object)
 	g_slist_free_full (priv->attachments_ids, g_free);
 	priv->attachments_ids = NULL;
 
+	g_slist_free_full (priv->attachments_meta, (GDestroyNotify) e_ews_attachment_meta_free);
+	priv->attachments_meta = NULL;
+
 	g_clear_pointer (&priv->my_response_type, g_free);
 
 	g_slist_free_full (priv->attendees, (GDestroyNotify) ews_item_free_attendee);
@@ -266,6 +296,17 @@ e_ews_item_dispose (GObject *object)
 		g_free (priv->task_fields);
 	}
 
+	if (priv->calendar_fields) {
+		g_free (priv->calendar_fields->location);
+		g_free (priv->calendar_fields->legacy_free_busy_status);
+		g_free (priv->calendar_fields->calendar_item_type);
+		g_free (priv->calendar_fields->sensitivity);
+		e_ews_mailbox_free (priv->calendar_fields->organizer);
+		g_slist_free_full (priv->calendar_fields->deleted_occurrences, g_free);
+		g_free (priv->calendar_fields);
+		priv->calendar_fields = NULL;
+	}
+
 	g_slist_free_full (priv->categories, g_free);
 	priv->categories = NULL;
 
@@ -604,9 +645,10 @@ process_attachments_list (EEwsItemPrivate *priv,
 {
 	ESoapParameter *subparam, *subparam1;
 
-	GSList *ids = NULL;
+	GSList *ids = NULL, *metas = NULL;
 
 	for (subparam = e_soap_parameter_get_first_child (param); subparam != NULL; subparam = e_soap_parameter_get_next_child (subparam)) {
+		EEwsAttachmentMeta *meta;
 		gchar *id;
 
 		subparam1 = e_soap_parameter_get_first_child_by_name (subparam, "AttachmentId");
@@ -616,17 +658,60 @@ process_attachments_list (EEwsItemPrivate *priv,
 		if (subparam1) {
 			gchar *value = e_soap_parameter_get_string_value (subparam1);
 			if (g_strcmp0 (value, "true") == 0) {
+				ESoapParameter *size_param, *modified_param;
+
 				priv->contact_photo_id = id;
 				g_free (value);
+
+				/* Size and modification time identify the photo without downloading it */
+				size_param = e_soap_parameter_get_first_child_by_name (subparam, "Size");
+				modified_param = e_soap_parameter_get_first_child_by_name (subparam, "LastModifiedTime");
+				if (size_param && modified_param) {
+					g_free (priv->contact_photo_stamp);
+					priv->contact_photo_stamp = g_strdup_printf ("%d-%" G_GINT64_FORMAT,
+						e_soap_parameter_get_int_value (size_param),
+						(gint64) ews_item_parse_date (modified_param));
+				}
 				continue;
 			}
 			g_free (value);
 		}
 
 		ids = g_slist_append (ids, id);
+
+		meta = g_new0 (EEwsAttachmentMeta, 1);
+		meta->id = g_strdup (id);
+		meta->size = -1;
+		meta->is_item = g_strcmp0 (e_soap_parameter_get_name (subparam), "ItemAttachment") == 0;
+
+		subparam1 = e_soap_parameter_get_first_child_by_name (subparam, "Name");
+		if (subparam1)
+			meta->name = e_soap_parameter_get_string_value (subparam1);
+
+		subparam1 = e_soap_parameter_get_first_child_by_name (subparam, "ContentType");
+		if (subparam1)
+			meta->content_type = e_soap_parameter_get_string_value (subparam1);
+
+		subparam1 = e_soap_parameter_get_first_child_by_name (subparam, "ContentId");
+		if (subparam1)
+			meta->content_id = e_soap_parameter_get_string_value (subparam1);
+
+		subparam1 = e_soap_parameter_get_first_child_by_name (subparam, "Size");
+		if (subparam1)
+			meta->size = e_soap_parameter_get_int_value (subparam1);
+
+		subparam1 = e_soap_parameter_get_first_child_by_name (subparam, "IsInline");
+		if (subparam1) {
+			gchar *value = e_soap_parameter_get_string_value (subparam1);
+			meta->is_inline = g_strcmp0 (value, "true") == 0;
+			g_free (value);
+		}
+
+		metas = g_slist_prepend (metas, meta);
 	}
 
 	priv->attachments_ids = ids;
+	priv->attachments_meta = g_slist_reverse (metas);
 	return;
 }
 
@@ -1389,6 +1474,71 @@ parse_task_field (EEwsItem *item,
 	}
 }
 
+/* Returns whether the field had been recognized */
+static gboolean
+parse_calendar_field (EEwsItem *item,
+		      const gchar *name,
+		      ESoapParameter *subparam)
+{
+	EEwsItemPrivate *priv = item->priv;
+	ESoapParameter *subparam1;
+	gchar *value;
+
+	if (!g_ascii_strcasecmp (name, "Start")) {
+		priv->calendar_fields->start = ews_item_parse_date (subparam);
+		priv->calendar_fields->has_start = TRUE;
+	} else if (!g_ascii_strcasecmp (name, "End")) {
+		priv->calendar_fields->end = ews_item_parse_date (subparam);
+		priv->calendar_fields->has_end = TRUE;
+	} else if (!g_ascii_strcasecmp (name, "RecurrenceId")) {
+		priv->calendar_fields->recurrence_id = ews_item_parse_date (subparam);
+		priv->calendar_fields->has_recurrence_id = TRUE;
+	} else if (!g_ascii_strcasecmp (name, "IsAllDayEvent")) {
+		value = e_soap_parameter_get_string_value (subparam);
+		priv->calendar_fields->is_all_day_event = (!g_ascii_strcasecmp (value, "true"));
+		g_free (value);
+	} else if (!g_ascii_strcasecmp (name, "Location")) {
+		g_free (priv->calendar_fields->location);
+		priv->calendar_fields->location = e_soap_parameter_get_string_value (subparam);
+	} else if (!g_ascii_strcasecmp (name, "LegacyFreeBusyStatus")) {
+		g_free (priv->calendar_fields->legacy_free_busy_status);
+		priv->calendar_fields->legacy_free_busy_status = e_soap_parameter_get_string_value (subparam);
+	} else if (!g_ascii_strcasecmp (name, "CalendarItemType")) {
+		g_free (priv->calendar_fields->calendar_item_type);
+		priv->calendar_fields->calendar_item_type = e_soap_parameter_get_string_value (subparam);
+	} else if (!g_ascii_strcasecmp (name, "Sensitivity")) {
+		g_free (priv->calendar_fields->sensitivity);
+		priv->calendar_fields->sensitivity = e_soap_parameter_get_string_value (subparam);
+	} else if (!g_ascii_strcasecmp (name, "Organizer")) {
+		subparam1 = e_soap_parameter_get_first_child_by_name (subparam, "Mailbox");
+		e_ews_mailbox_free (priv->calendar_fields->organizer);
+		priv->calendar_fields->organizer = subparam1 ? e_ews_item_mailbox_from_soap_param (subparam1) : NULL;
+	} else if (!g_ascii_strcasecmp (name, "DeletedOccurrences")) {
+		for (subparam1 = e_soap_parameter_get_first_child (subparam);
+		     subparam1;
+		     subparam1 = e_soap_parameter_get_next_child (subparam1)) {
+			ESoapParameter *start_param;
+
+			start_param = e_soap_parameter_get_first_child_by_name (subparam1, "Start");
+			if (start_param) {
+				time_t *tt = g_new0 (time_t, 1);
+
+				*tt = ews_item_parse_date (start_param);
+
+				priv->calendar_fields->deleted_occurrences = g_slist_prepend (priv->calendar_fields->deleted_occurrences, tt);
+			}
+		}
+
+		priv->calendar_fields->deleted_occurrences = g_slist_reverse (priv->calendar_fields->deleted_occurrences);
+	} else if (!g_ascii_strcasecmp (name, "Recurrence")) {
+		parse_recurrence_field (item, subparam);
+	} else {
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
 static gboolean
 e_ews_item_set_from_soap_parameter (EEwsItem *item,
                                     ESoapParameter *param)
@@ -1435,8 +1585,10 @@ e_ews_item_set_from_soap_parameter (EEwsItem *item,
 		}
 	} else if (!g_ascii_strcasecmp (name, "PostItem") || (node = e_soap_parameter_get_first_child_by_name (param, "PostItem")))
 		priv->item_type = E_EWS_ITEM_TYPE_POST_ITEM;
-	else if (!g_ascii_strcasecmp (name, "CalendarItem") || (node = e_soap_parameter_get_first_child_by_name (param, "CalendarItem")))
+	else if (!g_ascii_strcasecmp (name, "CalendarItem") || (node = e_soap_parameter_get_first_child_by_name (param, "CalendarItem"))) {
 		priv->item_type = E_EWS_ITEM_TYPE_EVENT;
+		priv->calendar_fields = g_new0 (struct _EEwsCalendarFields, 1);
+	}
 	else if (!g_ascii_strcasecmp (name, "Contact") || (node = e_soap_parameter_get_first_child_by_name (param, "Contact"))) {
 		priv->item_type = E_EWS_ITEM_TYPE_CONTACT;
 		priv->contact_fields = g_new0 (struct _EEwsContactFields, 1);
@@ -1621,8 +1773,14 @@ e_ews_item_set_from_soap_parameter (EEwsItem *item,
 		} else if (priv->item_type == E_EWS_ITEM_TYPE_TASK || priv->item_type == E_EWS_ITEM_TYPE_MEMO) {
 			parse_task_field (item, name, subparam);
 			/* fields below are not relevant for task, so skip them */
+		} else if (priv->calendar_fields && parse_calendar_field (item, name, subparam)) {
+			/* already processed */
 		} else if (!g_ascii_strcasecmp (name, "References")) {
 			priv->references = e_soap_parameter_get_string_value (subparam);
+		} else if (!g_ascii_strcasecmp (name, "ConversationId")) {
+			priv->conversation_id = e_soap_parameter_get_property (subparam, "Id");
+		} else if (!g_ascii_strcasecmp (name, "ConversationIndex")) {
+			priv->conversation_index = e_soap_parameter_get_string_value (subparam);
 		} else if (!g_ascii_strcasecmp (name, "ExtendedProperty")) {
 			parse_extended_property (priv, subparam);
 		} else if (!g_ascii_strcasecmp (name, "ModifiedOccurrences")) {
@@ -1653,7 +1811,14 @@ e_ews_item_set_from_soap_parameter (EEwsItem *item,
 		} else if (!g_ascii_strcasecmp (name, "EndTimeZone")) {
 			priv->end_timezone = e_soap_parameter_get_property (subparam, "Id");
 		} else if (!g_ascii_strcasecmp (name, "Body")) {
+			gchar *body_type;
+
+			body_type = e_soap_parameter_get_property (subparam, "BodyType");
 			priv->body = e_soap_parameter_get_string_value (subparam);
+			priv->body_is_html = g_strcmp0 (body_type, "HTML") == 0;
+			g_free (body_type);
+		} else if (!g_ascii_strcasecmp (name, "Preview")) {
+			priv->preview = e_soap_parameter_get_string_value (subparam);
 		}
 	}
 
@@ -1830,6 +1995,23 @@ e_ews_item_get_references (EEwsItem *item)
 	return (const gchar *) item->priv->references;
 }
 
+const gchar *
+e_ews_item_get_conversation_id (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return (const gchar *) item->priv->conversation_id;
+}
+
+/* Base64 encoded, as received from the server */
+const gchar *
+e_ews_item_get_conversation_index (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return (const gchar *) item->priv->conversation_index;
+}
+
 const gchar *
 e_ews_item_get_date_header (EEwsItem *item)
 {
@@ -2086,6 +2268,27 @@ e_ews_item_get_attachments_ids (EEwsItem *item)
 	return item->priv->attachments_ids;
 }
 
+const GSList *
+e_ews_item_get_attachments_meta (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->attachments_meta;
+}
+
+void
+e_ews_attachment_meta_free (EEwsAttachmentMeta *meta)
+{
+	if (!meta)
+		return;
+
+	g_free (meta->id);
+	g_free (meta->name);
+	g_free (meta->content_type);
+	g_free (meta->content_id);
+	g_free (meta);
+}
+
 const gchar *
 e_ews_item_get_extended_tag (EEwsItem *item,
 			     guint32 prop_tag)
@@ -2760,6 +2963,10 @@ const gchar *
 e_ews_item_get_sensitivity (EEwsItem *item)
 {
 	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	if (item->priv->calendar_fields)
+		return item->priv->calendar_fields->sensitivity;
+
 	g_return_val_if_fail (item->priv->task_fields != NULL, NULL);
 
 	return item->priv->task_fields->sensitivity;
@@ -2776,6 +2983,23 @@ e_ews_item_get_body (EEwsItem *item)
 	return item->priv->task_fields ? item->priv->task_fields->body : NULL;
 }
 
+gboolean
+e_ews_item_get_body_is_html (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), FALSE);
+
+	return item->priv->body_is_html;
+}
+
+/* The beginning of the body text, as provided by Exchange 2013 and later */
+const gchar *
+e_ews_item_get_preview (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->preview;
+}
+
 const gchar *
 e_ews_item_get_owner (EEwsItem *item)
 {
@@ -2857,6 +3081,104 @@ e_ews_item_get_end_tzid (EEwsItem *item)
 	return item->priv->end_timezone;
 }
 
+/* Returns whether the calendar item has set its start; the value is in UTC */
+gboolean
+e_ews_item_get_calendar_start (EEwsItem *item,
+			       time_t *out_start)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), FALSE);
+	g_return_val_if_fail (out_start != NULL, FALSE);
+
+	if (!item->priv->calendar_fields || !item->priv->calendar_fields->has_start)
+		return FALSE;
+
+	*out_start = item->priv->calendar_fields->start;
+
+	return TRUE;
+}
+
+/* Returns whether the calendar item has set its end; the value is in UTC */
+gboolean
+e_ews_item_get_calendar_end (EEwsItem *item,
+			     time_t *out_end)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), FALSE);
+	g_return_val_if_fail (out_end != NULL, FALSE);
+
+	if (!item->priv->calendar_fields || !item->priv->calendar_fields->has_end)
+		return FALSE;
+
+	*out_end = item->priv->calendar_fields->end;
+
+	return TRUE;
+}
+
+/* Returns whether the calendar item is a detached occurrence; the value is in UTC */
+gboolean
+e_ews_item_get_calendar_recurrence_id (EEwsItem *item,
+				       time_t *out_recurrence_id)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), FALSE);
+	g_return_val_if_fail (out_recurrence_id != NULL, FALSE);
+
+	if (!item->priv->calendar_fields || !item->priv->calendar_fields->has_recurrence_id)
+		return FALSE;
+
+	*out_recurrence_id = item->priv->calendar_fields->recurrence_id;
+
+	return TRUE;
+}
+
+gboolean
+e_ews_item_get_is_all_day_event (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), FALSE);
+
+	return item->priv->calendar_fields && item->priv->calendar_fields->is_all_day_event;
+}
+
+const gchar *
+e_ews_item_get_location (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->calendar_fields ? item->priv->calendar_fields->location : NULL;
+}
+
+const gchar *
+e_ews_item_get_legacy_free_busy_status (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->calendar_fields ? item->priv->calendar_fields->legacy_free_busy_status : NULL;
+}
+
+/* One of "Single", "Occurrence", "Exception" and "RecurringMaster", or NULL */
+const gchar *
+e_ews_item_get_calendar_item_type (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->calendar_fields ? item->priv->calendar_fields->calendar_item_type : NULL;
+}
+
+const EwsMailbox *
+e_ews_item_get_organizer (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->calendar_fields ? item->priv->calendar_fields->organizer : NULL;
+}
+
+/* Start times of the deleted occurrences, in UTC */
+const GSList * /* time_t * */
+e_ews_item_get_deleted_occurrences (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->calendar_fields ? item->priv->calendar_fields->deleted_occurrences : NULL;
+}
+
 const gchar *
 e_ews_item_get_contact_photo_id (EEwsItem *item)
 {
@@ -2865,6 +3187,16 @@ e_ews_item_get_contact_photo_id (EEwsItem *item)
 	return item->priv->contact_photo_id;
 }
 
+/* Returns a string, which changes whenever the contact photo changes,
+   or NULL, when the server did not provide enough information */
+const gchar *
+e_ews_item_get_contact_photo_stamp (EEwsItem *item)
+{
+	g_return_val_if_fail (E_IS_EWS_ITEM (item), NULL);
+
+	return item->priv->contact_photo_stamp;
+}
+
 /* free returned pointer with e_ews_permission_free() */
 EEwsPermission *
 e_ews_permission_new (EEwsPermissionUserType user_type,
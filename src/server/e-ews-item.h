@@ -132,6 +132,18 @@ typedef struct {
 	gchar *id;
 } EEwsAttachmentInfo;
 
+/* What the Attachments element of an item describes about an attachment,
+   without its content */
+typedef struct {
+	gchar *id;
+	gchar *name;
+	gchar *content_type;
+	gchar *content_id;
+	gint64 size;		/* -1, when not known */
+	gboolean is_inline;
+	gboolean is_item;	/* an ItemAttachment, not a FileAttachment */
+} EEwsAttachmentMeta;
+
 typedef enum {
 	E_EWS_PERMISSION_BIT_FREE_BUSY_DETAILED	= 0x00001000,
 	E_EWS_PERMISSION_BIT_FREE_BUSY_SIMPLE	= 0x00000800,
@@ -273,6 +285,9 @@ const gchar *	e_ews_item_get_msg_id		(EEwsItem *item);
 const gchar *	e_ews_item_get_uid		(EEwsItem *item);
 const gchar *	e_ews_item_get_in_replyto	(EEwsItem *item);
 const gchar *	e_ews_item_get_references	(EEwsItem *item);
+const gchar *	e_ews_item_get_conversation_id	(EEwsItem *item);
+const gchar *	e_ews_item_get_conversation_index
+						(EEwsItem *item);
 const gchar *	e_ews_item_get_date_header	(EEwsItem *item);
 time_t		e_ews_item_get_date_received	(EEwsItem *item);
 time_t		e_ews_item_get_date_sent	(EEwsItem *item);
@@ -318,6 +333,9 @@ const GSList *	e_ews_item_get_modified_occurrences
 gchar *		e_ews_embed_attachment_id_in_uri (const gchar *olduri, const gchar *attach_id);
 GSList *	e_ews_item_get_attachments_ids
 						(EEwsItem *item);
+const GSList *	e_ews_item_get_attachments_meta
+						(EEwsItem *item);
+void		e_ews_attachment_meta_free	(EEwsAttachmentMeta *meta);
 const gchar *	e_ews_item_get_extended_tag	(EEwsItem *item,
 						 guint32 prop_tag);
 const gchar *	e_ews_item_get_extended_distinguished_tag
@@ -433,6 +451,8 @@ const gchar *	e_ews_item_get_status		(EEwsItem *item);
 const gchar *	e_ews_item_get_percent_complete (EEwsItem *item);
 const gchar *	e_ews_item_get_sensitivity	(EEwsItem *item);
 const gchar *	e_ews_item_get_body		(EEwsItem *item);
+gboolean	e_ews_item_get_body_is_html	(EEwsItem *item);
+const gchar *	e_ews_item_get_preview		(EEwsItem *item);
 const gchar *	e_ews_item_get_owner		(EEwsItem *item);
 const gchar *	e_ews_item_get_delegator	(EEwsItem *item);
 time_t		e_ews_item_get_due_date		(EEwsItem *item);
@@ -448,7 +468,26 @@ gboolean	e_ews_item_task_has_complete_date
 const gchar *	e_ews_item_get_tzid		(EEwsItem *item);
 const gchar *	e_ews_item_get_start_tzid	(EEwsItem *item);
 const gchar *	e_ews_item_get_end_tzid		(EEwsItem *item);
+gboolean	e_ews_item_get_calendar_start	(EEwsItem *item,
+						 time_t *out_start);
+gboolean	e_ews_item_get_calendar_end	(EEwsItem *item,
+						 time_t *out_end);
+gboolean	e_ews_item_get_calendar_recurrence_id
+						(EEwsItem *item,
+						 time_t *out_recurrence_id);
+gboolean	e_ews_item_get_is_all_day_event	(EEwsItem *item);
+const gchar *	e_ews_item_get_location		(EEwsItem *item);
+const gchar *	e_ews_item_get_legacy_free_busy_status
+						(EEwsItem *item);
+const gchar *	e_ews_item_get_calendar_item_type
+						(EEwsItem *item);
+const EwsMailbox *
+		e_ews_item_get_organizer	(EEwsItem *item);
+const GSList *	e_ews_item_get_deleted_occurrences
+						(EEwsItem *item); /* time_t * */
 const gchar *	e_ews_item_get_contact_photo_id	(EEwsItem *item);
+const gchar *	e_ews_item_get_contact_photo_stamp
+						(EEwsItem *item);
 const gchar *	e_ews_item_get_iana_start_time_zone
 						(EEwsItem *item);
 const gchar *	e_ews_item_get_iana_end_time_zone
@@ -35,6 +35,10 @@ struct _ESourceEwsFolderPrivate {
 	guint freebusy_weeks_after;
 	gboolean use_primary_address;
 	gboolean fetch_gal_photos;
+	gboolean thin_gal;
+	gboolean sync_window;
+	guint sync_weeks_before;
+	guint sync_weeks_after;
 };
 
 enum {
@@ -48,7 +52,11 @@ enum {
 	PROP_FREEBUSY_WEEKS_AFTER,
 	PROP_PUBLIC,
 	PROP_USE_PRIMARY_ADDRESS,
-	PROP_FETCH_GAL_PHOTOS
+	PROP_FETCH_GAL_PHOTOS,
+	PROP_THIN_GAL,
+	PROP_SYNC_WINDOW,
+	PROP_SYNC_WEEKS_BEFORE,
+	PROP_SYNC_WEEKS_AFTER
 };
 
 G_DEFINE_TYPE (
@@ -122,6 +130,30 @@ source_ews_folder_set_property (GObject *object,
 				E_SOURCE_EWS_FOLDER (object),
 				g_value_get_boolean (value));
 			return;
+
+		case PROP_THIN_GAL:
+			e_source_ews_folder_set_thin_gal (
+				E_SOURCE_EWS_FOLDER (object),
+				g_value_get_boolean (value));
+			return;
+
+		case PROP_SYNC_WINDOW:
+			e_source_ews_folder_set_sync_window (
+				E_SOURCE_EWS_FOLDER (object),
+				g_value_get_boolean (value));
+			return;
+
+		case PROP_SYNC_WEEKS_BEFORE:
+			e_source_ews_folder_set_sync_weeks_before (
+				E_SOURCE_EWS_FOLDER (object),
+				g_value_get_uint (value));
+			return;
+
+		case PROP_SYNC_WEEKS_AFTER:
+			e_source_ews_folder_set_sync_weeks_after (
+				E_SOURCE_EWS_FOLDER (object),
+				g_value_get_uint (value));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -203,6 +235,34 @@ source_ews_folder_get_property (GObject *object,
 				e_source_ews_folder_get_fetch_gal_photos (
 				E_SOURCE_EWS_FOLDER (object)));
 			return;
+
+		case PROP_THIN_GAL:
+			g_value_set_boolean (
+				value,
+				e_source_ews_folder_get_thin_gal (
+				E_SOURCE_EWS_FOLDER (object)));
+			return;
+
+		case PROP_SYNC_WINDOW:
+			g_value_set_boolean (
+				value,
+				e_source_ews_folder_get_sync_window (
+				E_SOURCE_EWS_FOLDER (object)));
+			return;
+
+		case PROP_SYNC_WEEKS_BEFORE:
+			g_value_set_uint (
+				value,
+				e_source_ews_folder_get_sync_weeks_before (
+				E_SOURCE_EWS_FOLDER (object)));
+			return;
+
+		case PROP_SYNC_WEEKS_AFTER:
+			g_value_set_uint (
+				value,
+				e_source_ews_folder_get_sync_weeks_after (
+				E_SOURCE_EWS_FOLDER (object)));
+			return;
 	}
 
 	G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
@@ -369,6 +429,58 @@ e_source_ews_folder_class_init (ESourceEwsFolderClass *class)
 			G_PARAM_CONSTRUCT |
 			G_PARAM_STATIC_STRINGS |
 			E_SOURCE_PARAM_SETTING));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_THIN_GAL,
+		g_param_spec_boolean (
+			"thin-gal",
+			"Thin GAL",
+			"Whether keep only the OAB file with a search index for the offline GAL, instead of storing all contacts",
+			FALSE,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS |
+			E_SOURCE_PARAM_SETTING));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_SYNC_WINDOW,
+		g_param_spec_boolean (
+			"sync-window",
+			"Sync Window",
+			"Whether synchronize only events in a time window around today, instead of the whole calendar",
+			FALSE,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS |
+			E_SOURCE_PARAM_SETTING));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_SYNC_WEEKS_BEFORE,
+		g_param_spec_uint (
+			"sync-weeks-before",
+			"SyncWeeksBefore",
+			"How many weeks before today to synchronize, when the sync window is used",
+			1, 520, 26,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS |
+			E_SOURCE_PARAM_SETTING));
+
+	g_object_class_install_property (
+		object_class,
+		PROP_SYNC_WEEKS_AFTER,
+		g_param_spec_uint (
+			"sync-weeks-after",
+			"SyncWeeksAfter",
+			"How many weeks after today to synchronize, when the sync window is used",
+			1, 520, 52,
+			G_PARAM_READWRITE |
+			G_PARAM_CONSTRUCT |
+			G_PARAM_STATIC_STRINGS |
+			E_SOURCE_PARAM_SETTING));
 }
 
 static void
@@ -697,3 +809,91 @@ e_source_ews_folder_set_fetch_gal_photos (ESourceEwsFolder *extension,
 
 	g_object_notify (G_OBJECT (extension), "fetch-gal-photos");
 }
+
+gboolean
+e_source_ews_folder_get_thin_gal (ESourceEwsFolder *extension)
+{
+	g_return_val_if_fail (E_IS_SOURCE_EWS_FOLDER (extension), FALSE);
+
+	return extension->priv->thin_gal;
+}
+
+void
+e_source_ews_folder_set_thin_gal (ESourceEwsFolder *extension,
+				  gboolean thin_gal)
+{
+	g_return_if_fail (E_IS_SOURCE_EWS_FOLDER (extension));
+
+	if ((extension->priv->thin_gal ? 1 : 0) == (thin_gal ? 1 : 0))
+		return;
+
+	extension->priv->thin_gal = thin_gal;
+
+	g_object_notify (G_OBJECT (extension), "thin-gal");
+}
+
+gboolean
+e_source_ews_folder_get_sync_window (ESourceEwsFolder *extension)
+{
+	g_return_val_if_fail (E_IS_SOURCE_EWS_FOLDER (extension), FALSE);
+
+	return extension->priv->sync_window;
+}
+
+void
+e_source_ews_folder_set_sync_window (ESourceEwsFolder *extension,
+				     gboolean sync_window)
+{
+	g_return_if_fail (E_IS_SOURCE_EWS_FOLDER (extension));
+
+	if ((extension->priv->sync_window ? 1 : 0) == (sync_window ? 1 : 0))
+		return;
+
+	extension->priv->sync_window = sync_window;
+
+	g_object_notify (G_OBJECT (extension), "sync-window");
+}
+
+guint
+e_source_ews_folder_get_sync_weeks_before (ESourceEwsFolder *extension)
+{
+	g_return_val_if_fail (E_IS_SOURCE_EWS_FOLDER (extension), 0);
+
+	return extension->priv->sync_weeks_before;
+}
+
+void
+e_source_ews_folder_set_sync_weeks_before (ESourceEwsFolder *extension,
+					   guint sync_weeks_before)
+{
+	g_return_if_fail (E_IS_SOURCE_EWS_FOLDER (extension));
+
+	if (extension->priv->sync_weeks_before == sync_weeks_before)
+		return;
+
+	extension->priv->sync_weeks_before = sync_weeks_before;
+
+	g_object_notify (G_OBJECT (extension), "sync-weeks-before");
+}
+
+guint
+e_source_ews_folder_get_sync_weeks_after (ESourceEwsFolder *extension)
+{
+	g_return_val_if_fail (E_IS_SOURCE_EWS_FOLDER (extension), 0);
+
+	return extension->priv->sync_weeks_after;
+}
+
+void
+e_source_ews_folder_set_sync_weeks_after (ESourceEwsFolder *extension,
+					  guint sync_weeks_after)
+{
+	g_return_if_fail (E_IS_SOURCE_EWS_FOLDER (extension));
+
+	if (extension->priv->sync_weeks_after == sync_weeks_after)
+		return;
+
+	extension->priv->sync_weeks_after = sync_weeks_after;
+
+	g_object_notify (G_OBJECT (extension), "sync-weeks-after");
+}
@@ -114,6 +114,26 @@ gboolean	e_source_ews_folder_get_fetch_gal_photos
 void		e_source_ews_folder_set_fetch_gal_photos
 						(ESourceEwsFolder *extension,
 						 gboolean fetch_gal_photos);
+gboolean	e_source_ews_folder_get_thin_gal
+						(ESourceEwsFolder *extension);
+void		e_source_ews_folder_set_thin_gal
+						(ESourceEwsFolder *extension,
+						 gboolean thin_gal);
+gboolean	e_source_ews_folder_get_sync_window
+						(ESourceEwsFolder *extension);
+void		e_source_ews_folder_set_sync_window
+						(ESourceEwsFolder *extension,
+						 gboolean sync_window);
+guint		e_source_ews_folder_get_sync_weeks_before
+						(ESourceEwsFolder *extension);
+void		e_source_ews_folder_set_sync_weeks_before
+						(ESourceEwsFolder *extension,
+						 guint sync_weeks_before);
+guint		e_source_ews_folder_get_sync_weeks_after
+						(ESourceEwsFolder *extension);
+void		e_source_ews_folder_set_sync_weeks_after
+						(ESourceEwsFolder *extension,
+						 guint sync_weeks_after);
 
 G_END_DECLS
 
@@ -0,0 +1,197 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <glib/gstdio.h>
+#include <libedata-cal/libedata-cal.h>
+
+#include "server/e-ews-item.h"
+
+#include "ews-test-common.h"
+
+#define ITEM_ID "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=C"
+#define MASTER_CHANGEKEY "DwAAABYAAADM"
+#define DETACHED_CHANGEKEY "DwAAABYAAAEN"
+
+GSList * (* verify_changes) (ECalCache *cal_cache, ICalComponentKind kind, GSList *in_items, GCancellable *cancellable);
+
+static const gchar *str_master =
+	"BEGIN:VEVENT\n"
+	"UID:series@example.com\n"
+	"DTSTAMP:20190114T172620Z\n"
+	"DTSTART:20190114T160000Z\n"
+	"DTEND:20190114T163000Z\n"
+	"RRULE:FREQ=DAILY;COUNT=5\n"
+	"SUMMARY:Daily\n"
+	"X-EVOLUTION-CHANGEKEY:" MASTER_CHANGEKEY "\n"
+	"END:VEVENT";
+
+static const gchar *str_detached =
+	"BEGIN:VEVENT\n"
+	"UID:series@example.com\n"
+	"DTSTAMP:20190114T172620Z\n"
+	"DTSTART:20190116T170000Z\n"
+	"DTEND:20190116T173000Z\n"
+	"RECURRENCE-ID:20190116T160000Z\n"
+	"SUMMARY:Daily, moved\n"
+	"X-EVOLUTION-CHANGEKEY:" DETACHED_CHANGEKEY "\n"
+	"END:VEVENT";
+
+/* The same as ecb_ews_dup_component_revision() in the e-cal-backend-ews.c */
+static gchar *
+test_dup_component_revision_cb (ECalCache *cal_cache,
+				ICalComponent *icomp,
+				gpointer user_data)
+{
+	return e_cal_util_component_dup_x_property (icomp, "X-EVOLUTION-CHANGEKEY");
+}
+
+static EEwsItem *
+test_new_calendar_item (const gchar *change_key)
+{
+	ESoapResponse *response;
+	EEwsItem *item;
+	gchar *xml;
+
+	xml = g_strdup_printf (
+		"<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+		"<s:Envelope xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\"><s:Body>"
+		"<m:SyncFolderItemsResponse xmlns:m=\"http://schemas.microsoft.com/exchange/services/2006/messages\" "
+		"xmlns:t=\"http://schemas.microsoft.com/exchange/services/2006/types\">"
+		"<t:CalendarItem><t:ItemId Id=\"%s\" ChangeKey=\"%s\"/></t:CalendarItem>"
+		"</m:SyncFolderItemsResponse></s:Body></s:Envelope>",
+		ITEM_ID, change_key);
+
+	response = e_soap_response_new_from_string (xml, -1);
+	g_assert (response != NULL);
+
+	item = e_ews_item_new_from_soap_parameter (e_soap_response_get_first_parameter (response));
+	g_assert (item != NULL);
+	g_assert_cmpint (e_ews_item_get_item_type (item), ==, E_EWS_ITEM_TYPE_EVENT);
+
+	g_object_unref (response);
+	g_free (xml);
+
+	return item;
+}
+
+static void
+test_put_component (ECalCache *cal_cache,
+		    const gchar *str_comp)
+{
+	ECalComponent *comp;
+	GError *error = NULL;
+
+	comp = e_cal_component_new_from_string (str_comp);
+	g_assert (comp != NULL);
+
+	g_assert (e_cal_cache_put_component (cal_cache, comp, ITEM_ID, 0, E_CACHE_IS_ONLINE, NULL, &error));
+	g_assert_no_error (error);
+
+	g_object_unref (comp);
+}
+
+static void
+test_series_with_detached (void)
+{
+	ECalCache *cal_cache;
+	GSList *items;
+	GError *error = NULL;
+	gchar *filename;
+
+	filename = g_build_filename (g_get_tmp_dir (), "ews-test-calendar-changekeys.db", NULL);
+	g_unlink (filename);
+
+	cal_cache = e_cal_cache_new (filename, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (cal_cache != NULL);
+
+	g_signal_connect (cal_cache, "dup-component-revision", G_CALLBACK (test_dup_component_revision_cb), NULL);
+
+	/* The detached instance shares the item id with its master and it is
+	   stored after it, thus it is read after the master too */
+	test_put_component (cal_cache, str_master);
+	test_put_component (cal_cache, str_detached);
+
+	/* Nothing changed on the server, thus nothing is left to be fetched */
+	items = g_slist_prepend (NULL, test_new_calendar_item (MASTER_CHANGEKEY));
+	items = verify_changes (cal_cache, I_CAL_VEVENT_COMPONENT, items, NULL);
+	g_assert (items == NULL);
+
+	/* The change key of the detached instance does not describe the series */
+	items = g_slist_prepend (NULL, test_new_calendar_item (DETACHED_CHANGEKEY));
+	items = verify_changes (cal_cache, I_CAL_VEVENT_COMPONENT, items, NULL);
+	g_assert_cmpuint (g_slist_length (items), ==, 1);
+	g_slist_free_full (items, g_object_unref);
+
+	/* A changed series is fetched */
+	items = g_slist_prepend (NULL, test_new_calendar_item ("DwAAABYAAAFO"));
+	items = verify_changes (cal_cache, I_CAL_VEVENT_COMPONENT, items, NULL);
+	g_assert_cmpuint (g_slist_length (items), ==, 1);
+	g_slist_free_full (items, g_object_unref);
+
+	g_object_unref (cal_cache);
+	g_unlink (filename);
+	g_free (filename);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+	GModule *module = NULL;
+	gpointer symbol = NULL;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0) {
+		g_printerr ("Failed to initialize test\n");
+		goto exit;
+	}
+
+	if (!g_module_supported ()) {
+		g_printerr ("GModule not supported\n");
+		retval = 1;
+		goto exit;
+	}
+
+	module = g_module_open (CALENDAR_MODULE_DIR "libecalbackendews.so", G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+
+	if (module == NULL) {
+		g_printerr ("Failed to load module: %s\n", g_module_error ());
+		retval = 2;
+		goto exit;
+	}
+
+	if (!g_module_symbol (module, "e_cal_backend_ews_verify_changes", &symbol)) {
+		g_printerr ("\n%s\n", g_module_error ());
+		retval = 3;
+		goto exit;
+	}
+
+	verify_changes = symbol;
+
+	g_test_add_func ("/calendar/changekeys/series_with_detached", test_series_with_detached);
+
+	retval = g_test_run ();
+
+ exit:
+	if (module != NULL)
+		g_module_close (module);
+	ews_test_cleanup ();
+
+	return retval;
+}
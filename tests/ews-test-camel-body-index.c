@@ -0,0 +1,427 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel/camel-ews-body-index.h"
+
+#include "ews-test-common.h"
+
+#define BENCHMARK_N_MESSAGES 100000
+#define BENCHMARK_N_WORDS 20000
+#define BENCHMARK_WORDS_PER_MESSAGE 60
+
+static gchar *
+build_index_filename (const gchar *name)
+{
+	gchar *filename;
+
+	filename = g_build_filename (g_get_tmp_dir (), name, NULL);
+	g_unlink (filename);
+
+	return filename;
+}
+
+static GHashTable *
+search_index (CamelEwsBodyIndex *body_index,
+	      const gchar *word1,
+	      const gchar *word2)
+{
+	GHashTable *matches;
+	GPtrArray *words;
+
+	words = g_ptr_array_new ();
+	g_ptr_array_add (words, (gpointer) word1);
+	if (word2)
+		g_ptr_array_add (words, (gpointer) word2);
+
+	matches = camel_ews_body_index_search (body_index, words);
+
+	g_ptr_array_unref (words);
+
+	return matches;
+}
+
+static void
+assert_matches (CamelEwsBodyIndex *body_index,
+		const gchar *word1,
+		const gchar *word2,
+		const gchar *expected) /* space-separated uids */
+{
+	GHashTable *matches;
+	gchar **uids;
+	guint ii;
+
+	matches = search_index (body_index, word1, word2);
+	g_assert (matches != NULL);
+
+	uids = g_strsplit (expected, " ", -1);
+
+	for (ii = 0; uids[ii] && *uids[ii]; ii++) {
+		g_assert (g_hash_table_contains (matches, uids[ii]));
+	}
+
+	g_assert_cmpuint (g_hash_table_size (matches), ==, ii);
+
+	g_strfreev (uids);
+	g_hash_table_unref (matches);
+}
+
+static CamelMimePart *
+create_part (const gchar *content,
+	     const gchar *content_type,
+	     const gchar *disposition)
+{
+	CamelMimePart *part;
+
+	part = camel_mime_part_new ();
+	camel_mime_part_set_content (part, content, strlen (content), content_type);
+
+	if (disposition)
+		camel_mime_part_set_disposition (part, disposition);
+
+	return part;
+}
+
+static CamelMimeMessage *
+create_message (void)
+{
+	CamelMimeMessage *message;
+	CamelMultipart *multipart;
+	CamelMimePart *part;
+
+	multipart = camel_multipart_new ();
+	camel_data_wrapper_set_mime_type (CAMEL_DATA_WRAPPER (multipart), "multipart/mixed");
+	camel_multipart_set_boundary (multipart, NULL);
+
+	part = create_part ("Dear customer,\nthe Invoice for March is attached.\n", "text/plain; charset=utf-8", NULL);
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	/* "žluťoučký kůň" in ISO-8859-2 */
+	part = create_part ("\xbelu\xbbou\xe8k\xfd k\xf9\xf2\n", "text/plain; charset=iso-8859-2", NULL);
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	part = create_part ("<p>Payment <b>overdue</b></p>", "text/html; charset=utf-8", NULL);
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	part = create_part ("attachedsecret\n", "text/plain", "attachment");
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	message = camel_mime_message_new ();
+	camel_mime_message_set_subject (message, "Invoice");
+	camel_medium_set_content (CAMEL_MEDIUM (message), CAMEL_DATA_WRAPPER (multipart));
+	g_object_unref (multipart);
+
+	return message;
+}
+
+static void
+test_search_words (void)
+{
+	CamelEwsBodyIndex *body_index;
+	CamelMimeMessage *message;
+	GHashTable *matches;
+	GError *error = NULL;
+	gchar *filename;
+
+	filename = build_index_filename ("ews-test-camel-body-index-search");
+	body_index = camel_ews_body_index_new (filename);
+
+	message = create_message ();
+	g_assert (camel_ews_body_index_add_message (body_index, "uid-1", message, NULL, &error));
+	g_assert_no_error (error);
+	g_object_unref (message);
+
+	camel_ews_body_index_add_text (body_index, "uid-2", "Invoices are paid in April.");
+	camel_ews_body_index_add_text (body_index, "uid-3", "Nothing to see here");
+
+	g_assert_cmpuint (camel_ews_body_index_get_length (body_index), ==, 3);
+	g_assert (camel_ews_body_index_contains (body_index, "uid-2"));
+	g_assert (!camel_ews_body_index_contains (body_index, "uid-4"));
+
+	assert_matches (body_index, "invoice", NULL, "uid-1 uid-2");
+	assert_matches (body_index, "VOIC", NULL, "uid-1 uid-2");
+	assert_matches (body_index, "invoice", "march", "uid-1");
+	assert_matches (body_index, "march", "april", "");
+	assert_matches (body_index, "overdue", NULL, "uid-1");
+	assert_matches (body_index, "\xc5\xbelu\xc5\xa5ou\xc4\x8dk\xc3\xbd", NULL, "uid-1");
+	assert_matches (body_index, "K\xc5\xae\xc5\x87", NULL, "uid-1");
+
+	/* Only the body, not the attachments */
+	assert_matches (body_index, "attachedsecret", NULL, "");
+
+	/* Not a single term, it is searched on the server */
+	matches = search_index (body_index, "e-mail", NULL);
+	g_assert (matches == NULL);
+
+	/* Replaces the previous text */
+	camel_ews_body_index_add_text (body_index, "uid-2", "Paid in May");
+	assert_matches (body_index, "invoice", NULL, "uid-1");
+	assert_matches (body_index, "paid", NULL, "uid-2");
+
+	camel_ews_body_index_remove (body_index, "uid-1");
+	assert_matches (body_index, "invoice", NULL, "");
+	g_assert_cmpuint (camel_ews_body_index_get_length (body_index), ==, 2);
+
+	camel_ews_body_index_free (body_index);
+	g_unlink (filename);
+	g_free (filename);
+}
+
+static void
+test_save_and_load (void)
+{
+	CamelEwsBodyIndex *body_index;
+	GHashTable *matches;
+	GError *error = NULL;
+	gchar *filename, *uid;
+	GStatBuf st;
+	goffset size;
+	guint ii;
+
+	filename = build_index_filename ("ews-test-camel-body-index-load");
+	body_index = camel_ews_body_index_new (filename);
+
+	camel_ews_body_index_add_text (body_index, "uid-1", "first message");
+	camel_ews_body_index_add_text (body_index, "uid-2", "second message");
+	camel_ews_body_index_add_text (body_index, "uid-1", "first message changed");
+	camel_ews_body_index_remove (body_index, "uid-2");
+
+	g_assert (camel_ews_body_index_save (body_index, &error));
+	g_assert_no_error (error);
+	camel_ews_body_index_free (body_index);
+
+	body_index = camel_ews_body_index_new (filename);
+	g_assert_cmpuint (camel_ews_body_index_get_length (body_index), ==, 1);
+	assert_matches (body_index, "changed", NULL, "uid-1");
+	assert_matches (body_index, "second", NULL, "");
+
+	/* Many removed messages make the file to be rewritten */
+	for (ii = 0; ii < 1500; ii++) {
+		uid = g_strdup_printf ("uid-%u", ii + 100);
+		camel_ews_body_index_add_text (body_index, uid, "bulk message");
+		g_free (uid);
+	}
+
+	g_assert (camel_ews_body_index_save (body_index, &error));
+	g_assert_no_error (error);
+	g_assert_cmpint (g_stat (filename, &st), ==, 0);
+
+	for (ii = 0; ii < 1400; ii++) {
+		uid = g_strdup_printf ("uid-%u", ii + 100);
+		camel_ews_body_index_remove (body_index, uid);
+		g_free (uid);
+	}
+
+	g_assert (camel_ews_body_index_save (body_index, &error));
+	g_assert_no_error (error);
+
+	assert_matches (body_index, "changed", NULL, "uid-1");
+	matches = search_index (body_index, "bulk", NULL);
+	g_assert (matches != NULL);
+	g_assert_cmpuint (g_hash_table_size (matches), ==, 100);
+	g_assert (g_hash_table_contains (matches, "uid-1500"));
+	g_assert (g_hash_table_contains (matches, "uid-1599"));
+	g_assert (!g_hash_table_contains (matches, "uid-1499"));
+	g_hash_table_unref (matches);
+
+	size = st.st_size;
+	g_assert_cmpint (g_stat (filename, &st), ==, 0);
+	g_assert_cmpint (st.st_size, <, size);
+	camel_ews_body_index_free (body_index);
+
+	body_index = camel_ews_body_index_new (filename);
+	g_assert_cmpuint (camel_ews_body_index_get_length (body_index), ==, 101);
+	camel_ews_body_index_free (body_index);
+
+	g_unlink (filename);
+	g_free (filename);
+}
+
+static void
+test_incomplete_file (void)
+{
+	CamelEwsBodyIndex *body_index;
+	GError *error = NULL;
+	gchar *filename;
+
+	filename = build_index_filename ("ews-test-camel-body-index-incomplete");
+
+	/* Interrupted while writing the second line */
+	g_file_set_contents (filename, "+uid-1\tfirst message\n+uid-2\tsecond mes", -1, &error);
+	g_assert_no_error (error);
+
+	body_index = camel_ews_body_index_new (filename);
+	g_assert_cmpuint (camel_ews_body_index_get_length (body_index), ==, 1);
+	assert_matches (body_index, "first", NULL, "uid-1");
+
+	camel_ews_body_index_add_text (body_index, "uid-3", "third message");
+	g_assert (camel_ews_body_index_save (body_index, &error));
+	g_assert_no_error (error);
+	camel_ews_body_index_free (body_index);
+
+	body_index = camel_ews_body_index_new (filename);
+	g_assert_cmpuint (camel_ews_body_index_get_length (body_index), ==, 2);
+	assert_matches (body_index, "message", NULL, "uid-1 uid-3");
+	camel_ews_body_index_free (body_index);
+
+	g_unlink (filename);
+	g_free (filename);
+}
+
+static gchar *
+benchmark_word (guint32 number)
+{
+	GString *word;
+
+	/* Like "bacoda", with a distinct word for each number */
+	word = g_string_new ("");
+
+	do {
+		g_string_append_c (word, "bcdfghjklmnprstvz"[number % 17]);
+		number /= 17;
+		g_string_append_c (word, "aeiou"[number % 5]);
+		number /= 5;
+	} while (number);
+
+	return g_string_free (word, FALSE);
+}
+
+static void
+benchmark_search (CamelEwsBodyIndex *body_index,
+		  const gchar *word1,
+		  const gchar *word2)
+{
+	GHashTable *matches;
+	gdouble elapsed;
+
+	g_test_timer_start ();
+	matches = search_index (body_index, word1, word2);
+	elapsed = g_test_timer_elapsed ();
+
+	g_assert (matches != NULL);
+
+	g_test_minimized_result (elapsed, "Searched for '%s%s%s' in %.3f s, %u matches",
+		word1, word2 ? "' and '" : "", word2 ? word2 : "", elapsed, g_hash_table_size (matches));
+
+	g_hash_table_unref (matches);
+}
+
+static void
+test_benchmark (void)
+{
+	CamelEwsBodyIndex *body_index;
+	GPtrArray *vocabulary;
+	GString *text;
+	GRand *rand;
+	GError *error = NULL;
+	gchar *filename;
+	gdouble elapsed;
+	guint ii, jj;
+
+	filename = build_index_filename ("ews-test-camel-body-index-benchmark");
+
+	vocabulary = g_ptr_array_new_with_free_func (g_free);
+	for (ii = 0; ii < BENCHMARK_N_WORDS; ii++) {
+		g_ptr_array_add (vocabulary, benchmark_word (ii));
+	}
+
+	/* The same corpus on each run */
+	rand = g_rand_new_with_seed (1);
+	text = g_string_new ("");
+
+	body_index = camel_ews_body_index_new (filename);
+
+	g_test_timer_start ();
+
+	for (ii = 0; ii < BENCHMARK_N_MESSAGES; ii++) {
+		gchar uid[32];
+
+		g_string_truncate (text, 0);
+
+		/* Some words are much more common than others */
+		for (jj = 0; jj < BENCHMARK_WORDS_PER_MESSAGE; jj++) {
+			guint32 nth = g_rand_int_range (rand, 0, BENCHMARK_N_WORDS);
+
+			nth = nth * (guint64) g_rand_int_range (rand, 1, BENCHMARK_N_WORDS) / BENCHMARK_N_WORDS;
+
+			g_string_append (text, g_ptr_array_index (vocabulary, nth));
+			g_string_append_c (text, ' ');
+		}
+
+		g_snprintf (uid, sizeof (uid), "uid-%u", ii);
+		camel_ews_body_index_add_text (body_index, uid, text->str);
+	}
+
+	g_assert (camel_ews_body_index_save (body_index, &error));
+	g_assert_no_error (error);
+
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "Indexed %u messages in %.3f s", BENCHMARK_N_MESSAGES, elapsed);
+
+	benchmark_search (body_index, g_ptr_array_index (vocabulary, 0), NULL);
+	benchmark_search (body_index, g_ptr_array_index (vocabulary, BENCHMARK_N_WORDS - 1), NULL);
+	benchmark_search (body_index, g_ptr_array_index (vocabulary, 1), g_ptr_array_index (vocabulary, 2));
+
+	camel_ews_body_index_free (body_index);
+
+	g_test_timer_start ();
+	body_index = camel_ews_body_index_new (filename);
+	elapsed = g_test_timer_elapsed ();
+
+	g_assert_cmpuint (camel_ews_body_index_get_length (body_index), ==, BENCHMARK_N_MESSAGES);
+	g_test_minimized_result (elapsed, "Loaded the index in %.3f s", elapsed);
+
+	camel_ews_body_index_free (body_index);
+
+	g_string_free (text, TRUE);
+	g_rand_free (rand);
+	g_ptr_array_unref (vocabulary);
+	g_unlink (filename);
+	g_free (filename);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	g_test_add_func ("/camel/body-index/search_words", test_search_words);
+	g_test_add_func ("/camel/body-index/save_and_load", test_save_and_load);
+	g_test_add_func ("/camel/body-index/incomplete_file", test_incomplete_file);
+
+	/* Run with -m perf */
+	if (g_test_perf ())
+		g_test_add_func ("/camel/body-index/benchmark", test_benchmark);
+
+	retval = g_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
@@ -0,0 +1,160 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "server/e-ews-item.h"
+#include "camel/camel-ews-utils.h"
+
+#include "ews-test-common.h"
+
+#define ITEM_ID_PREFIX "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA="
+#define CONVERSATION_ID "AAQkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZAAQAJ2b8L9jbUlKp+5Wb9fXIRQ="
+
+/* The root message, its reply and a reply to the reply */
+#define N_ITEMS 3
+
+/* Available since Exchange 2010 */
+#define CONVERSATION_PROPS "item:Subject item:ConversationId item:ConversationIndex"
+
+static void
+test_get_conversation_items (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	EEwsAdditionalProps *add_props;
+	GSList *ids = NULL, *items = NULL, *link;
+	GError *error = NULL;
+	guint64 message_ids[N_ITEMS];
+	guint ii;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/conversation");
+	ews_test_server_start_trace (local_server, etd, "get_conversation_items", &error);
+	g_assert_no_error (error);
+
+	ids = g_slist_append (ids, g_strdup (ITEM_ID_PREFIX "R"));
+	ids = g_slist_append (ids, g_strdup (ITEM_ID_PREFIX "A"));
+	ids = g_slist_append (ids, g_strdup (ITEM_ID_PREFIX "B"));
+
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup (CONVERSATION_PROPS);
+
+	g_assert (e_ews_connection_get_items_sync (etd->connection, EWS_PRIORITY_MEDIUM,
+		ids, "IdOnly", add_props,
+		FALSE, NULL, E_EWS_BODY_TYPE_ANY, &items, NULL, NULL,
+		NULL, &error));
+	g_assert_no_error (error);
+
+	e_ews_additional_props_free (add_props);
+
+	g_assert_cmpuint (g_slist_length (items), ==, N_ITEMS);
+
+	for (link = items, ii = 0; link; link = g_slist_next (link), ii++) {
+		EEwsItem *item = link->data;
+		GArray *references = NULL;
+		guint64 conversation_key = 0;
+
+		g_assert_cmpint (e_ews_item_get_item_type (item), ==, E_EWS_ITEM_TYPE_MESSAGE);
+		g_assert_cmpstr (e_ews_item_get_conversation_id (item), ==, CONVERSATION_ID);
+		g_assert (e_ews_item_get_conversation_index (item) != NULL);
+
+		g_assert (camel_ews_utils_get_conversation_threading (
+			e_ews_item_get_conversation_id (item),
+			e_ews_item_get_conversation_index (item),
+			&conversation_key, &message_ids[ii], &references));
+
+		g_assert (conversation_key != 0);
+		g_assert (message_ids[ii] != 0);
+		g_assert (references != NULL);
+
+		/* The direct parent first, the whole conversation last */
+		g_assert_cmpuint (references->len, ==, ii + 1);
+		g_assert (g_array_index (references, guint64, references->len - 1) == conversation_key);
+
+		if (ii > 0)
+			g_assert (g_array_index (references, guint64, 0) == message_ids[ii - 1]);
+		if (ii > 1)
+			g_assert (g_array_index (references, guint64, 1) == message_ids[ii - 2]);
+
+		g_array_unref (references);
+	}
+
+	g_assert (message_ids[0] != message_ids[1]);
+	g_assert (message_ids[1] != message_ids[2]);
+
+	g_slist_free_full (items, g_object_unref);
+	g_slist_free_full (ids, g_free);
+
+	uhm_server_end_trace (local_server);
+}
+
+static void
+test_invalid_conversation_index (void)
+{
+	GArray *references = NULL;
+	guint64 conversation_key = 0, message_id = 0;
+
+	/* Only the conversation is known, the message threads by its headers */
+	g_assert (!camel_ews_utils_get_conversation_threading (CONVERSATION_ID, NULL,
+		&conversation_key, &message_id, &references));
+	g_assert (conversation_key != 0);
+	g_assert (message_id == 0);
+	g_assert (references == NULL);
+
+	/* Too short */
+	g_assert (!camel_ews_utils_get_conversation_threading (CONVERSATION_ID, "AdNA8SoQ",
+		&conversation_key, &message_id, &references));
+	g_assert (conversation_key != 0);
+	g_assert (message_id == 0);
+	g_assert (references == NULL);
+
+	/* Not a whole number of reply blocks */
+	g_assert (!camel_ews_utils_get_conversation_threading (CONVERSATION_ID, "AdNA8SoQMDEyMzQ1Njc4OTo7PD0+PwAA",
+		&conversation_key, &message_id, &references));
+	g_assert (message_id == 0);
+	g_assert (references == NULL);
+
+	g_assert (!camel_ews_utils_get_conversation_threading (NULL, "AdNA8SoQMDEyMzQ1Njc4OTo7PD0+Pw==",
+		&conversation_key, &message_id, &references));
+	g_assert (conversation_key == 0);
+	g_assert (message_id == 0);
+	g_assert (references == NULL);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	g_test_add_func ("/camel/conversation/invalid_conversation_index", test_invalid_conversation_index);
+
+	/* The conversation properties are not known to the older servers */
+	ews_test_add_data_func ("Exchange2010_SP2", "/camel/conversation/get_conversation_items", test_get_conversation_items);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
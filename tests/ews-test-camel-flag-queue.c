@@ -0,0 +1,122 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel/camel-ews-flag-queue.h"
+
+#include "ews-test-common.h"
+
+#define ITEM_A "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=A"
+#define ITEM_B "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=B"
+#define ITEM_C "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=C"
+
+static void
+test_coalesce_flag_changes (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	CamelEwsFlagQueue *queue;
+	GPtrArray *requests;
+	GError *error = NULL;
+	gchar *filename;
+	const gchar *request;
+	gulong handler_id;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/flag-queue");
+	ews_test_server_start_trace (local_server, etd, "coalesce_flag_changes", &error);
+	g_assert_no_error (error);
+
+	filename = g_build_filename (g_get_tmp_dir (), "ews-test-camel-flag-queue", NULL);
+	g_unlink (filename);
+
+	queue = camel_ews_flag_queue_new (filename);
+
+	camel_ews_flag_queue_add (queue, ITEM_A, "CQAAAA==", CAMEL_MESSAGE_SEEN, 0, NULL, NULL, NULL, NULL);
+	camel_ews_flag_queue_add (queue, ITEM_B, "CQAAAB==", CAMEL_MESSAGE_SEEN, CAMEL_MESSAGE_SEEN, NULL, NULL, NULL, NULL);
+	camel_ews_flag_queue_add (queue, ITEM_C, "CQAAAC==", CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED,
+		CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED, NULL, NULL, NULL, NULL);
+	/* The last state wins, thus A ends in the same request as B */
+	camel_ews_flag_queue_add (queue, ITEM_A, "CQAAAA==", CAMEL_MESSAGE_SEEN, CAMEL_MESSAGE_SEEN, NULL, NULL, NULL, NULL);
+
+	g_assert_cmpuint (camel_ews_flag_queue_get_length (queue), ==, 3);
+
+	/* The pending changes survive a restart */
+	camel_ews_flag_queue_save (queue, &error);
+	g_assert_no_error (error);
+	camel_ews_flag_queue_free (queue);
+
+	queue = camel_ews_flag_queue_new (filename);
+	g_assert_cmpuint (camel_ews_flag_queue_get_length (queue), ==, 3);
+	g_assert (camel_ews_flag_queue_contains (queue, ITEM_A));
+	g_assert (camel_ews_flag_queue_contains (queue, ITEM_C));
+
+	requests = g_ptr_array_new_with_free_func (g_free);
+	handler_id = ews_test_server_capture_requests (local_server, requests);
+
+	g_assert (camel_ews_flag_queue_flush_sync (queue, etd->connection, NULL, &error));
+	g_assert_no_error (error);
+
+	g_signal_handler_disconnect (local_server, handler_id);
+
+	g_assert_cmpuint (requests->len, ==, 2);
+
+	request = g_ptr_array_index (requests, 0);
+	g_assert_cmpuint (ews_test_count_occurrences (request, "<ItemChange>"), ==, 2);
+	g_assert (strstr (request, ITEM_A) != NULL);
+	g_assert (strstr (request, ITEM_B) != NULL);
+	g_assert (strstr (request, "<IsRead>true</IsRead>") != NULL);
+	g_assert (strstr (request, "item:Importance") == NULL);
+
+	request = g_ptr_array_index (requests, 1);
+	g_assert_cmpuint (ews_test_count_occurrences (request, "<ItemChange>"), ==, 1);
+	g_assert (strstr (request, ITEM_C) != NULL);
+	g_assert (strstr (request, "<Importance>High</Importance>") != NULL);
+
+	g_assert_cmpuint (camel_ews_flag_queue_get_length (queue), ==, 0);
+	g_assert (!camel_ews_flag_queue_contains (queue, ITEM_A));
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	g_ptr_array_unref (requests);
+	camel_ews_flag_queue_free (queue);
+	g_free (filename);
+
+	uhm_server_end_trace (local_server);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	ews_test_add_data_func (NULL, "/camel/flag-queue/coalesce_flag_changes", test_coalesce_flag_changes);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
@@ -0,0 +1,294 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include "camel/camel-ews-journal.h"
+
+#include "ews-test-common.h"
+
+#define FOLDER_ID "AQMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZAAuAAADAAAAAQ=="
+#define DEST_FOLDER_ID "AQMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZAAuAAADAAAAAg=="
+#define ITEM_X "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=X"
+#define ITEM_Y "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=Y"
+#define ITEM_NEW "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=N"
+#define ITEM_MOVED "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=M"
+
+typedef struct _UidChange {
+	gchar *temp_uid;
+	gchar *item_id;
+	GError *error;
+	GHashTable *transferred; /* gchar *temp_uid ~> gchar *item_id */
+} UidChange;
+
+static void
+journal_uid_changed_cb (const gchar *temp_uid,
+			const gchar *item_id,
+			const gchar *change_key,
+			const GError *error,
+			gpointer user_data)
+{
+	UidChange *change = user_data;
+
+	g_assert (change->temp_uid == NULL);
+
+	change->temp_uid = g_strdup (temp_uid);
+	change->item_id = g_strdup (item_id);
+	change->error = error ? g_error_copy (error) : NULL;
+}
+
+static void
+journal_transfer_cb (const gchar *folder_id,
+		     const gchar *temp_uid,
+		     const gchar *item_id,
+		     const gchar *change_key,
+		     gpointer user_data)
+{
+	UidChange *change = user_data;
+
+	g_assert_cmpstr (folder_id, ==, DEST_FOLDER_ID);
+	g_assert (!g_hash_table_contains (change->transferred, temp_uid));
+
+	g_hash_table_insert (change->transferred, g_strdup (temp_uid), g_strdup (item_id));
+}
+
+static void
+test_replay_journal (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	CamelEwsJournal *journal;
+	CamelMimeMessage *message;
+	UidChange change = { NULL, NULL, NULL, NULL };
+	GPtrArray *requests;
+	GSList *uids = NULL, *dst_uids;
+	GError *error = NULL;
+	gchar *filename, *temp_uid;
+	const gchar *request;
+	gboolean conflicts = TRUE;
+	gulong handler_id;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/journal");
+	ews_test_server_start_trace (local_server, etd, "replay_journal", &error);
+	g_assert_no_error (error);
+
+	filename = g_build_filename (g_get_tmp_dir (), "ews-test-camel-journal", NULL);
+	g_unlink (filename);
+
+	journal = camel_ews_journal_new (filename);
+
+	message = camel_mime_message_new ();
+	camel_mime_message_set_subject (message, "Written while offline");
+	camel_mime_part_set_content (CAMEL_MIME_PART (message), "Hello\n", 6, "text/plain");
+
+	temp_uid = camel_ews_journal_add_append (journal, FOLDER_ID, message, CAMEL_MESSAGE_SEEN, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (camel_ews_journal_is_temp_uid (temp_uid));
+	g_object_unref (message);
+
+	uids = g_slist_prepend (NULL, (gpointer) ITEM_X);
+	camel_ews_journal_add_delete (journal, uids, FALSE);
+	g_slist_free (uids);
+
+	/* The appended message is moved too, under its server id */
+	uids = g_slist_prepend (NULL, (gpointer) ITEM_Y);
+	uids = g_slist_prepend (uids, temp_uid);
+	dst_uids = camel_ews_journal_add_transfer (journal, uids, DEST_FOLDER_ID, FALSE);
+	g_slist_free (uids);
+
+	/* The destination knows the messages under their own temporary uids */
+	g_assert_cmpuint (g_slist_length (dst_uids), ==, 2);
+	g_assert (camel_ews_journal_is_temp_uid (dst_uids->data));
+	g_assert (camel_ews_journal_is_temp_uid (dst_uids->next->data));
+	g_assert_cmpstr (dst_uids->data, !=, temp_uid);
+
+	g_assert_cmpuint (camel_ews_journal_get_length (journal), ==, 3);
+
+	/* The journal survives a restart */
+	camel_ews_journal_save (journal, &error);
+	g_assert_no_error (error);
+	camel_ews_journal_free (journal);
+
+	journal = camel_ews_journal_new (filename);
+	g_assert_cmpuint (camel_ews_journal_get_length (journal), ==, 3);
+
+	requests = g_ptr_array_new_with_free_func (g_free);
+	handler_id = ews_test_server_capture_requests (local_server, requests);
+	change.transferred = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	/* The server fails on the move */
+	g_assert (!camel_ews_journal_replay_sync (journal, etd->connection,
+		journal_uid_changed_cb, journal_transfer_cb, &change, &conflicts, NULL, &error));
+	g_assert_error (error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_NORESPONSE);
+	g_clear_error (&error);
+
+	g_assert (!conflicts);
+	g_assert_cmpstr (change.temp_uid, ==, temp_uid);
+	g_assert_cmpstr (change.item_id, ==, ITEM_NEW);
+	g_assert_no_error (change.error);
+	g_assert_cmpuint (camel_ews_journal_get_length (journal), ==, 1);
+	g_assert_cmpuint (g_hash_table_size (change.transferred), ==, 0);
+
+	/* The move is retried; the ITEM_Y vanished meanwhile */
+	g_assert (camel_ews_journal_replay_sync (journal, etd->connection,
+		journal_uid_changed_cb, journal_transfer_cb, &change, &conflicts, NULL, &error));
+	g_assert_no_error (error);
+
+	/* The moved message gets its server uid in the destination, the vanished is dropped there */
+	g_assert_cmpuint (g_hash_table_size (change.transferred), ==, 2);
+	g_assert_cmpstr (g_hash_table_lookup (change.transferred, dst_uids->data), ==, ITEM_MOVED);
+	g_assert (g_hash_table_contains (change.transferred, dst_uids->next->data));
+	g_assert_cmpstr (g_hash_table_lookup (change.transferred, dst_uids->next->data), ==, NULL);
+
+	g_signal_handler_disconnect (local_server, handler_id);
+
+	g_assert (!conflicts);
+	g_assert_cmpuint (camel_ews_journal_get_length (journal), ==, 0);
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+
+	g_assert_cmpuint (requests->len, ==, 4);
+
+	request = g_ptr_array_index (requests, 0);
+	g_assert (strstr (request, "CreateItem") != NULL);
+	g_assert (strstr (request, FOLDER_ID) != NULL);
+
+	request = g_ptr_array_index (requests, 1);
+	g_assert (strstr (request, "DeleteItem") != NULL);
+	g_assert (strstr (request, ITEM_X) != NULL);
+
+	request = g_ptr_array_index (requests, 3);
+	g_assert (strstr (request, "MoveItem") != NULL);
+	g_assert (strstr (request, DEST_FOLDER_ID) != NULL);
+	g_assert (strstr (request, ITEM_NEW) != NULL);
+	g_assert (strstr (request, ITEM_Y) != NULL);
+	g_assert (strstr (request, temp_uid) == NULL);
+
+	g_ptr_array_unref (requests);
+	g_hash_table_destroy (change.transferred);
+	g_slist_free_full (dst_uids, g_free);
+	camel_ews_journal_free (journal);
+	g_free (change.temp_uid);
+	g_free (change.item_id);
+	g_free (temp_uid);
+	g_free (filename);
+
+	uhm_server_end_trace (local_server);
+}
+
+static void
+test_reject_append (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	CamelEwsJournal *journal;
+	CamelMimeMessage *message;
+	UidChange change = { NULL, NULL, NULL, NULL };
+	GSList *uids;
+	GError *error = NULL;
+	gchar *filename, *message_filename, *temp_uid;
+	gboolean conflicts = TRUE;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/journal");
+	ews_test_server_start_trace (local_server, etd, "reject_append", &error);
+	g_assert_no_error (error);
+
+	filename = g_build_filename (g_get_tmp_dir (), "ews-test-camel-journal-reject", NULL);
+	g_unlink (filename);
+
+	journal = camel_ews_journal_new (filename);
+
+	message = camel_mime_message_new ();
+	camel_mime_message_set_subject (message, "Written while offline");
+	camel_mime_part_set_content (CAMEL_MIME_PART (message), "Hello\n", 6, "text/plain");
+
+	temp_uid = camel_ews_journal_add_append (journal, FOLDER_ID, message, CAMEL_MESSAGE_SEEN, NULL, &error);
+	g_assert_no_error (error);
+	g_object_unref (message);
+
+	camel_ews_journal_save (journal, &error);
+	g_assert_no_error (error);
+
+	message_filename = g_strconcat (filename, "-messages" G_DIR_SEPARATOR_S, temp_uid, NULL);
+	g_assert (g_file_test (message_filename, G_FILE_TEST_EXISTS));
+
+	/* The server refuses the message, which is not a reason to lose it */
+	g_assert (camel_ews_journal_replay_sync (journal, etd->connection,
+		journal_uid_changed_cb, NULL, &change, &conflicts, NULL, &error));
+	g_assert_no_error (error);
+
+	g_assert (!conflicts);
+	g_assert_cmpstr (change.temp_uid, ==, temp_uid);
+	g_assert_cmpstr (change.item_id, ==, NULL);
+	g_assert_error (change.error, EWS_CONNECTION_ERROR, EWS_CONNECTION_ERROR_MESSAGESIZEEXCEEDED);
+
+	/* It is not tried again, but it is kept, also after a restart */
+	g_assert_cmpuint (camel_ews_journal_get_length (journal), ==, 0);
+	g_assert (g_file_test (filename, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (message_filename, G_FILE_TEST_EXISTS));
+
+	camel_ews_journal_free (journal);
+
+	journal = camel_ews_journal_new (filename);
+	g_assert_cmpuint (camel_ews_journal_get_length (journal), ==, 0);
+
+	/* Until it is deleted locally */
+	uids = g_slist_prepend (NULL, temp_uid);
+	camel_ews_journal_remove_rejected (journal, uids);
+	g_slist_free (uids);
+
+	camel_ews_journal_save (journal, &error);
+	g_assert_no_error (error);
+
+	g_assert (!g_file_test (filename, G_FILE_TEST_EXISTS));
+	g_assert (!g_file_test (message_filename, G_FILE_TEST_EXISTS));
+
+	camel_ews_journal_free (journal);
+	g_clear_error (&change.error);
+	g_free (change.temp_uid);
+	g_free (change.item_id);
+	g_free (message_filename);
+	g_free (temp_uid);
+	g_free (filename);
+
+	uhm_server_end_trace (local_server);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	ews_test_add_data_func (NULL, "/camel/journal/replay_journal", test_replay_journal);
+	ews_test_add_data_func (NULL, "/camel/journal/reject_append", test_reject_append);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
@@ -0,0 +1,587 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+#include <utime.h>
+
+#include <glib/gstdio.h>
+
+#include "camel/camel-ews-message-cache.h"
+
+#include "ews-test-common.h"
+
+#define FILE_SIZE 1000
+
+#define BENCHMARK_N_MESSAGES 200
+#define BENCHMARK_ATTACHMENT_SIZE (192 * 1024)
+
+static gchar *
+create_cache_directory (const gchar *name)
+{
+	gchar *path;
+
+	path = g_build_filename (g_get_tmp_dir (), name, NULL);
+	g_assert (g_mkdir_with_parents (path, 0700) == 0);
+
+	return path;
+}
+
+static void
+remove_cache_directory (const gchar *path)
+{
+	GDir *dir;
+	const gchar *name;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir) {
+		while ((name = g_dir_read_name (dir)) != NULL) {
+			gchar *filename;
+
+			filename = g_build_filename (path, name, NULL);
+
+			if (g_file_test (filename, G_FILE_TEST_IS_DIR))
+				remove_cache_directory (filename);
+			else
+				g_unlink (filename);
+
+			g_free (filename);
+		}
+
+		g_dir_close (dir);
+	}
+
+	g_rmdir (path);
+}
+
+static gchar *
+write_cache_file (const gchar *path,
+		  const gchar *name,
+		  const gchar *content,
+		  gsize length)
+{
+	GError *error = NULL;
+	gchar *filename;
+
+	filename = g_build_filename (path, name, NULL);
+
+	g_assert (g_file_set_contents (filename, content, length, &error));
+	g_assert_no_error (error);
+
+	return filename;
+}
+
+static gchar *
+write_sized_file (const gchar *path,
+		  const gchar *name)
+{
+	gchar *content, *filename;
+
+	content = g_strnfill (FILE_SIZE, 'x');
+	filename = write_cache_file (path, name, content, FILE_SIZE);
+	g_free (content);
+
+	return filename;
+}
+
+static GByteArray *
+read_stream (CamelStream *stream)
+{
+	GByteArray *bytes;
+	gchar buffer[4096];
+	gssize n_read;
+
+	bytes = g_byte_array_new ();
+
+	while ((n_read = camel_stream_read (stream, buffer, sizeof (buffer), NULL, NULL)) > 0) {
+		g_byte_array_append (bytes, (const guint8 *) buffer, n_read);
+	}
+
+	g_assert_cmpint (n_read, ==, 0);
+
+	return bytes;
+}
+
+static CamelStream *
+open_cache_file (const gchar *filename)
+{
+	GFile *file;
+	GFileIOStream *base_stream;
+	CamelStream *stream;
+	GError *error = NULL;
+
+	file = g_file_new_for_path (filename);
+	base_stream = g_file_open_readwrite (file, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (base_stream != NULL);
+
+	stream = camel_ews_message_cache_wrap_stream (G_IO_STREAM (base_stream), NULL, &error);
+	g_assert_no_error (error);
+	g_assert (stream != NULL);
+
+	g_object_unref (base_stream);
+	g_object_unref (file);
+
+	return stream;
+}
+
+static void
+test_eviction_order (void)
+{
+	CamelEwsMessageCache *cache;
+	gchar *path, *file_a, *file_b, *file_c, *file_d, *file_e, *file_f;
+
+	path = create_cache_directory ("ews-test-camel-message-cache-eviction");
+
+	cache = camel_ews_message_cache_new (0, 0);
+
+	file_a = write_sized_file (path, "a");
+	file_b = write_sized_file (path, "b");
+	file_c = write_sized_file (path, "c");
+	file_d = write_sized_file (path, "d");
+	file_e = write_sized_file (path, "e");
+
+	camel_ews_message_cache_add_file (cache, file_a, NULL, FALSE);
+	camel_ews_message_cache_add_file (cache, file_b, NULL, FALSE);
+	camel_ews_message_cache_add_file (cache, file_c, NULL, TRUE);
+	camel_ews_message_cache_add_file (cache, file_d, NULL, FALSE);
+	camel_ews_message_cache_add_file (cache, file_e, NULL, FALSE);
+
+	/* No limit, nothing is removed */
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 5 * FILE_SIZE);
+
+	/* Read the oldest; the least recently read are 'b', 'c' and 'd' now */
+	camel_ews_message_cache_touch_file (cache, file_a);
+
+	camel_ews_message_cache_set_size_limit (cache, 3 * FILE_SIZE);
+
+	/* The 'c' exists only locally */
+	g_assert (!g_file_test (file_b, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_c, G_FILE_TEST_EXISTS));
+	g_assert (!g_file_test (file_d, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_a, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_e, G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 3 * FILE_SIZE);
+
+	file_f = write_sized_file (path, "f");
+	camel_ews_message_cache_add_file (cache, file_f, NULL, FALSE);
+
+	/* Nothing is removed before the evict */
+	g_assert (g_file_test (file_e, G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 4 * FILE_SIZE);
+
+	camel_ews_message_cache_evict (cache);
+
+	g_assert (!g_file_test (file_e, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_a, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_f, G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 3 * FILE_SIZE);
+
+	/* Once stored on the server, the 'c' can go */
+	camel_ews_message_cache_set_keep (cache, file_c, FALSE);
+	camel_ews_message_cache_set_size_limit (cache, 2 * FILE_SIZE);
+
+	g_assert (!g_file_test (file_c, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_a, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_f, G_FILE_TEST_EXISTS));
+
+	/* The most recently read file stays, even when it exceeds the limit */
+	camel_ews_message_cache_set_size_limit (cache, FILE_SIZE / 2);
+
+	g_assert (!g_file_test (file_a, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_f, G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, FILE_SIZE);
+
+	/* Removed by the caller */
+	g_unlink (file_f);
+	camel_ews_message_cache_remove_file (cache, file_f);
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 0);
+
+	camel_ews_message_cache_free (cache);
+
+	remove_cache_directory (path);
+
+	g_free (file_a);
+	g_free (file_b);
+	g_free (file_c);
+	g_free (file_d);
+	g_free (file_e);
+	g_free (file_f);
+	g_free (path);
+}
+
+static void
+test_add_directory (void)
+{
+	CamelEwsMessageCache *cache;
+	gchar *path, *subdir, *filenames[4];
+	gint64 now;
+	guint ii;
+
+	path = create_cache_directory ("ews-test-camel-message-cache-directory");
+	subdir = g_build_filename (path, "1f", NULL);
+	g_assert (g_mkdir_with_parents (subdir, 0700) == 0);
+
+	now = g_get_real_time () / G_USEC_PER_SEC;
+
+	/* The '0' read the longest time ago, the '3' the most recently */
+	for (ii = 0; ii < G_N_ELEMENTS (filenames); ii++) {
+		struct utimbuf times;
+		gchar name[8];
+
+		g_snprintf (name, sizeof (name), "%u", ii);
+		filenames[ii] = write_sized_file ((ii % 2) ? subdir : path, name);
+
+		times.actime = now - 3600 * (G_N_ELEMENTS (filenames) - ii);
+		times.modtime = times.actime;
+
+		g_assert (g_utime (filenames[ii], &times) == 0);
+	}
+
+	cache = camel_ews_message_cache_new (2 * FILE_SIZE, 0);
+
+	camel_ews_message_cache_add_directory (cache, path, NULL, NULL);
+
+	/* Nothing is removed until the files to keep are known */
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 4 * FILE_SIZE);
+
+	/* Read only once */
+	camel_ews_message_cache_add_directory (cache, path, NULL, NULL);
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 4 * FILE_SIZE);
+
+	camel_ews_message_cache_set_keep (cache, filenames[0], TRUE);
+	camel_ews_message_cache_set_size_limit (cache, 2 * FILE_SIZE);
+
+	g_assert (g_file_test (filenames[0], G_FILE_TEST_EXISTS));
+	g_assert (!g_file_test (filenames[1], G_FILE_TEST_EXISTS));
+	g_assert (!g_file_test (filenames[2], G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (filenames[3], G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 2 * FILE_SIZE);
+
+	camel_ews_message_cache_free (cache);
+
+	remove_cache_directory (path);
+
+	for (ii = 0; ii < G_N_ELEMENTS (filenames); ii++) {
+		g_free (filenames[ii]);
+	}
+
+	g_free (subdir);
+	g_free (path);
+}
+
+static void
+test_evict_func_cb (GObject *owner,
+		    const gchar *uid)
+{
+	GPtrArray *evicted = g_object_get_data (owner, "evicted");
+
+	g_ptr_array_add (evicted, g_strdup (uid));
+}
+
+static void
+test_evict_func (void)
+{
+	CamelEwsMessageCache *cache;
+	GObject *owner;
+	GPtrArray *evicted;
+	gchar *path, *file_a, *file_b, *file_c, *file_d;
+
+	path = create_cache_directory ("ews-test-camel-message-cache-evict-func");
+
+	file_a = write_sized_file (path, "a");
+	file_b = write_sized_file (path, "b");
+
+	evicted = g_ptr_array_new_with_free_func (g_free);
+	owner = g_object_new (G_TYPE_OBJECT, NULL);
+	g_object_set_data (owner, "evicted", evicted);
+
+	cache = camel_ews_message_cache_new (2 * FILE_SIZE, 0);
+
+	camel_ews_message_cache_add_directory (cache, path, owner, test_evict_func_cb);
+	camel_ews_message_cache_set_uid (cache, file_a, "uid-a");
+	camel_ews_message_cache_touch_file (cache, file_b);
+
+	/* The owner removes the files of the known messages */
+	file_c = write_sized_file (path, "c");
+	camel_ews_message_cache_add_file (cache, file_c, "uid-c", FALSE);
+	camel_ews_message_cache_evict (cache);
+
+	g_assert_cmpuint (evicted->len, ==, 1);
+	g_assert_cmpstr (g_ptr_array_index (evicted, 0), ==, "uid-a");
+	g_assert (g_file_test (file_a, G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, 2 * FILE_SIZE);
+
+	/* The cache removes the files of unknown messages itself */
+	file_d = write_sized_file (path, "d");
+	camel_ews_message_cache_add_file (cache, file_d, NULL, FALSE);
+	camel_ews_message_cache_evict (cache);
+
+	g_assert_cmpuint (evicted->len, ==, 1);
+	g_assert (!g_file_test (file_b, G_FILE_TEST_EXISTS));
+
+	/* And of the owner, which is gone */
+	g_object_unref (owner);
+
+	camel_ews_message_cache_touch_file (cache, file_d);
+	camel_ews_message_cache_set_size_limit (cache, FILE_SIZE);
+
+	g_assert (!g_file_test (file_c, G_FILE_TEST_EXISTS));
+	g_assert (g_file_test (file_d, G_FILE_TEST_EXISTS));
+	g_assert_cmpuint (evicted->len, ==, 1);
+
+	camel_ews_message_cache_free (cache);
+
+	remove_cache_directory (path);
+
+	g_ptr_array_unref (evicted);
+	g_free (file_a);
+	g_free (file_b);
+	g_free (file_c);
+	g_free (file_d);
+	g_free (path);
+}
+
+static gchar *
+build_message (gsize attachment_size,
+	       guint seed)
+{
+	GString *message;
+	GRand *rand;
+	guchar *data;
+	gchar *encoded;
+	gsize ii;
+
+	/* Random binary data, like compressed images or archives */
+	rand = g_rand_new_with_seed (seed);
+	data = g_malloc (attachment_size);
+
+	for (ii = 0; ii < attachment_size; ii++) {
+		data[ii] = g_rand_int_range (rand, 0, 256);
+	}
+
+	encoded = g_base64_encode (data, attachment_size);
+
+	message = g_string_new ("");
+	g_string_append_printf (message,
+		"From: user@example.com\r\n"
+		"To: user@example.com\r\n"
+		"Subject: Message %u\r\n"
+		"MIME-Version: 1.0\r\n"
+		"Content-Type: multipart/mixed; boundary=\"boundary\"\r\n"
+		"\r\n"
+		"--boundary\r\n"
+		"Content-Type: text/plain; charset=utf-8\r\n"
+		"\r\n"
+		"The report is attached.\r\n"
+		"--boundary\r\n"
+		"Content-Type: application/octet-stream; name=\"report.bin\"\r\n"
+		"Content-Transfer-Encoding: base64\r\n"
+		"\r\n", seed);
+
+	for (ii = 0; encoded[ii]; ii += 76) {
+		g_string_append_len (message, encoded + ii, MIN (76, strlen (encoded + ii)));
+		g_string_append (message, "\r\n");
+	}
+
+	g_string_append (message, "--boundary--\r\n");
+
+	g_free (encoded);
+	g_free (data);
+	g_rand_free (rand);
+
+	return g_string_free (message, FALSE);
+}
+
+static void
+test_compression (void)
+{
+	CamelEwsMessageCache *cache;
+	CamelStream *stream;
+	GByteArray *bytes;
+	GError *error = NULL;
+	GStatBuf st;
+	gchar *path, *message, *large_file, *small_file;
+	gsize length;
+
+	path = create_cache_directory ("ews-test-camel-message-cache-compression");
+
+	message = build_message (16 * 1024, 1);
+	length = strlen (message);
+
+	large_file = write_cache_file (path, "large", message, length);
+	small_file = write_cache_file (path, "small", message, 512);
+
+	cache = camel_ews_message_cache_new (0, 1024);
+
+	camel_ews_message_cache_add_file (cache, large_file, NULL, FALSE);
+	camel_ews_message_cache_add_file (cache, small_file, NULL, FALSE);
+
+	/* The base64 is compressed by about a quarter */
+	g_assert (g_stat (large_file, &st) == 0);
+	g_assert_cmpint (st.st_size, <, length);
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, st.st_size + 512);
+
+	g_assert (g_stat (small_file, &st) == 0);
+	g_assert_cmpint (st.st_size, ==, 512);
+
+	/* Read transparently */
+	stream = open_cache_file (large_file);
+	bytes = read_stream (stream);
+	g_assert_cmpuint (bytes->len, ==, length);
+	g_assert (memcmp (bytes->data, message, length) == 0);
+	g_byte_array_unref (bytes);
+	g_object_unref (stream);
+
+	stream = open_cache_file (small_file);
+	bytes = read_stream (stream);
+	g_assert_cmpuint (bytes->len, ==, 512);
+	g_assert (memcmp (bytes->data, message, 512) == 0);
+	g_byte_array_unref (bytes);
+	g_object_unref (stream);
+
+	/* For the readers of the file itself */
+	g_assert (camel_ews_message_cache_decompress_file (cache, large_file, NULL, &error));
+	g_assert_no_error (error);
+
+	g_assert (g_stat (large_file, &st) == 0);
+	g_assert_cmpint (st.st_size, ==, length);
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), ==, length + 512);
+
+	camel_ews_message_cache_free (cache);
+
+	remove_cache_directory (path);
+
+	g_free (large_file);
+	g_free (small_file);
+	g_free (message);
+	g_free (path);
+}
+
+static gdouble
+benchmark_read_messages (GPtrArray *filenames)
+{
+	gdouble elapsed;
+	guint ii;
+
+	g_test_timer_start ();
+
+	for (ii = 0; ii < filenames->len; ii++) {
+		CamelMimeMessage *message;
+		CamelStream *stream;
+		GError *error = NULL;
+
+		stream = open_cache_file (g_ptr_array_index (filenames, ii));
+		message = camel_mime_message_new ();
+
+		g_assert (camel_data_wrapper_construct_from_stream_sync (CAMEL_DATA_WRAPPER (message), stream, NULL, &error));
+		g_assert_no_error (error);
+
+		g_object_unref (message);
+		g_object_unref (stream);
+	}
+
+	elapsed = g_test_timer_elapsed ();
+
+	return elapsed;
+}
+
+static void
+test_benchmark (void)
+{
+	CamelEwsMessageCache *cache;
+	GPtrArray *filenames;
+	guint64 plain_size;
+	gdouble elapsed;
+	gchar *path;
+	guint ii;
+
+	path = create_cache_directory ("ews-test-camel-message-cache-benchmark");
+	filenames = g_ptr_array_new_with_free_func (g_free);
+
+	for (ii = 0; ii < BENCHMARK_N_MESSAGES; ii++) {
+		gchar *message, name[16];
+
+		g_snprintf (name, sizeof (name), "msg-%u", ii);
+
+		message = build_message (BENCHMARK_ATTACHMENT_SIZE, ii);
+		g_ptr_array_add (filenames, write_cache_file (path, name, message, strlen (message)));
+		g_free (message);
+	}
+
+	cache = camel_ews_message_cache_new (0, 0);
+
+	for (ii = 0; ii < filenames->len; ii++) {
+		camel_ews_message_cache_add_file (cache, g_ptr_array_index (filenames, ii), NULL, FALSE);
+	}
+
+	plain_size = camel_ews_message_cache_get_size (cache);
+	camel_ews_message_cache_free (cache);
+
+	elapsed = benchmark_read_messages (filenames);
+	g_test_minimized_result (elapsed, "Read %u uncompressed messages (%" G_GUINT64_FORMAT " bytes) in %.3f s",
+		filenames->len, plain_size, elapsed);
+
+	cache = camel_ews_message_cache_new (0, 1);
+
+	g_test_timer_start ();
+
+	for (ii = 0; ii < filenames->len; ii++) {
+		camel_ews_message_cache_add_file (cache, g_ptr_array_index (filenames, ii), NULL, FALSE);
+	}
+
+	elapsed = g_test_timer_elapsed ();
+	g_test_minimized_result (elapsed, "Compressed %u messages to %" G_GUINT64_FORMAT " bytes in %.3f s",
+		filenames->len, camel_ews_message_cache_get_size (cache), elapsed);
+
+	g_assert_cmpuint (camel_ews_message_cache_get_size (cache), <, plain_size);
+
+	camel_ews_message_cache_free (cache);
+
+	elapsed = benchmark_read_messages (filenames);
+	g_test_minimized_result (elapsed, "Read %u compressed messages in %.3f s", filenames->len, elapsed);
+
+	remove_cache_directory (path);
+
+	g_ptr_array_unref (filenames);
+	g_free (path);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	g_test_add_func ("/camel/message-cache/eviction_order", test_eviction_order);
+	g_test_add_func ("/camel/message-cache/add_directory", test_add_directory);
+	g_test_add_func ("/camel/message-cache/evict_func", test_evict_func);
+	g_test_add_func ("/camel/message-cache/compression", test_compression);
+
+	/* Run with -m perf */
+	if (g_test_perf ())
+		g_test_add_func ("/camel/message-cache/benchmark", test_benchmark);
+
+	retval = g_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
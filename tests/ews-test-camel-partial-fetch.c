@@ -0,0 +1,161 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "server/e-ews-item.h"
+#include "camel/camel-ews-attachment-wrapper.h"
+#include "camel/camel-ews-utils.h"
+
+#include "ews-test-common.h"
+
+#define ITEM_ID "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=P"
+#define NOTES_CONTENT "These are the notes of the meeting.\n"
+
+/* The same as in the camel-ews-folder.c */
+#define ITEM_PROPS "item:Subject item:DateTimeReceived item:DateTimeSent item:DateTimeCreated item:Size " \
+		   "item:HasAttachments item:InReplyTo"
+#define SUMMARY_MESSAGE_FLAGS "item:ResponseObjects item:Sensitivity item:Importance item:Categories message:IsRead"
+#define SUMMARY_MESSAGE_PROPS ITEM_PROPS " message:From message:Sender message:ToRecipients message:CcRecipients " \
+		   "message:BccRecipients message:IsRead message:References message:InternetMessageId " \
+		   SUMMARY_MESSAGE_FLAGS
+
+static void
+test_lazy_attachments (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	EEwsAdditionalProps *add_props;
+	CamelMimeMessage *message;
+	CamelDataWrapper *content;
+	CamelMultipart *multipart;
+	CamelMimePart *part;
+	CamelStream *stream;
+	GByteArray *bytes;
+	GSList *ids, *items = NULL;
+	GError *error = NULL;
+	GPtrArray *requests;
+	gulong handler_id;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/partial-fetch");
+	ews_test_server_start_trace (local_server, etd, "lazy_attachments", &error);
+	g_assert_no_error (error);
+
+	requests = g_ptr_array_new_with_free_func (g_free);
+	handler_id = ews_test_server_capture_requests (local_server, requests);
+
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup (SUMMARY_MESSAGE_PROPS " item:Body item:Attachments");
+
+	ids = g_slist_prepend (NULL, (gpointer) ITEM_ID);
+
+	g_assert (e_ews_connection_get_items_sync (etd->connection, EWS_PRIORITY_MEDIUM,
+		ids, "IdOnly", add_props,
+		FALSE, NULL, E_EWS_BODY_TYPE_BEST, &items, NULL, NULL,
+		NULL, &error));
+	g_assert_no_error (error);
+
+	e_ews_additional_props_free (add_props);
+	g_slist_free (ids);
+
+	g_assert_cmpuint (g_slist_length (items), ==, 1);
+	g_assert_cmpuint (g_slist_length ((GSList *) e_ews_item_get_attachments_meta (items->data)), ==, 3);
+	g_assert (e_ews_item_get_body_is_html (items->data));
+
+	message = camel_ews_utils_build_partial_message (etd->connection, items->data, NULL);
+	g_assert (message != NULL);
+	g_assert_cmpstr (camel_mime_message_get_subject (message), ==, "Quarterly report");
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (message));
+	g_assert (CAMEL_IS_MULTIPART (content));
+
+	multipart = CAMEL_MULTIPART (content);
+	g_assert_cmpuint (camel_multipart_get_number (multipart), ==, 4);
+
+	/* The body is part of the GetItem response */
+	part = camel_multipart_get_part (multipart, 0);
+	g_assert (camel_content_type_is (camel_mime_part_get_content_type (part), "text", "html"));
+
+	/* The attachments are only described */
+	part = camel_multipart_get_part (multipart, 1);
+	g_assert_cmpstr (camel_mime_part_get_filename (part), ==, "report.pdf");
+	g_assert (CAMEL_IS_EWS_ATTACHMENT_WRAPPER (camel_medium_get_content (CAMEL_MEDIUM (part))));
+	g_assert (camel_data_wrapper_is_offline (camel_medium_get_content (CAMEL_MEDIUM (part))));
+
+	part = camel_multipart_get_part (multipart, 3);
+	g_assert_cmpstr (camel_mime_part_get_filename (part), ==, "logo.png");
+	g_assert_cmpstr (camel_mime_part_get_disposition (part), ==, "inline");
+	g_assert_cmpstr (camel_mime_part_get_content_id (part), ==, "logo@example.com");
+
+	g_assert_cmpuint (ews_test_count_requests (requests, "<messages:GetAttachment"), ==, 0);
+
+	/* Reading the content of one attachment downloads only that one */
+	part = camel_multipart_get_part (multipart, 2);
+	g_assert_cmpstr (camel_mime_part_get_filename (part), ==, "notes.txt");
+
+	content = camel_medium_get_content (CAMEL_MEDIUM (part));
+
+	stream = camel_stream_mem_new ();
+	g_assert_cmpint (camel_data_wrapper_decode_to_stream_sync (content, stream, NULL, &error), ==, strlen (NOTES_CONTENT));
+	g_assert_no_error (error);
+
+	bytes = camel_stream_mem_get_byte_array (CAMEL_STREAM_MEM (stream));
+	g_assert_cmpmem (bytes->data, bytes->len, NOTES_CONTENT, strlen (NOTES_CONTENT));
+	g_object_unref (stream);
+
+	g_assert_cmpuint (ews_test_count_requests (requests, "<messages:GetAttachment"), ==, 1);
+	g_assert (!camel_data_wrapper_is_offline (content));
+
+	/* Any later read uses the downloaded content */
+	stream = camel_stream_mem_new ();
+	g_assert_cmpint (camel_data_wrapper_decode_to_stream_sync (content, stream, NULL, &error), ==, strlen (NOTES_CONTENT));
+	g_assert_no_error (error);
+	g_object_unref (stream);
+
+	g_signal_handler_disconnect (local_server, handler_id);
+
+	g_assert_cmpuint (ews_test_count_requests (requests, "<messages:GetAttachment"), ==, 1);
+	g_assert (!camel_ews_attachment_wrapper_get_fetched (CAMEL_EWS_ATTACHMENT_WRAPPER (
+		camel_medium_get_content (CAMEL_MEDIUM (camel_multipart_get_part (multipart, 1))))));
+
+	g_object_unref (message);
+	g_slist_free_full (items, g_object_unref);
+	g_ptr_array_unref (requests);
+
+	uhm_server_end_trace (local_server);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	ews_test_add_data_func (NULL, "/camel/partial-fetch/lazy_attachments", test_lazy_attachments);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
@@ -0,0 +1,338 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "server/e-ews-item.h"
+#include "camel/camel-ews-message-info.h"
+#include "camel/camel-ews-utils.h"
+
+#include "ews-test-common.h"
+
+#define ITEM_ID_PREFIX "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA="
+#define N_ITEMS 3
+#define PREVIEW_VERSION "Exchange2013"
+
+/* The same as in the camel-ews-folder.c */
+#define SUMMARY_RECIPIENT_PROPS "message:ToRecipients message:CcRecipients"
+#define ATTACHMENT_PROPS "item:Attachments"
+#define PREVIEW_PROPS "item:Preview"
+
+static CamelMessageInfo *
+test_round_trip_info (CamelMessageInfo *mi)
+{
+	CamelMessageInfo *loaded;
+	CamelMIRecord *record;
+	GString *bdata;
+	gchar *bdata_ptr;
+
+	record = g_new0 (CamelMIRecord, 1);
+	bdata = g_string_new ("");
+
+	g_assert (camel_message_info_save (mi, record, bdata));
+
+	loaded = g_object_new (CAMEL_TYPE_EWS_MESSAGE_INFO, NULL);
+	bdata_ptr = bdata->str;
+
+	g_assert (camel_message_info_load (loaded, record, &bdata_ptr));
+
+	camel_db_camel_mir_free (record);
+	g_string_free (bdata, TRUE);
+
+	return loaded;
+}
+
+static void
+test_bdata_round_trip (void)
+{
+	CamelMessageInfo *mi, *loaded;
+	CamelEwsMessageInfo *emi;
+	CamelMIRecord *record;
+	gchar *bdata_ptr;
+
+	mi = g_object_new (CAMEL_TYPE_EWS_MESSAGE_INFO, NULL);
+	camel_message_info_set_uid (mi, ITEM_ID_PREFIX "V0");
+
+	emi = CAMEL_EWS_MESSAGE_INFO (mi);
+	camel_ews_message_info_set_item_type (emi, E_EWS_ITEM_TYPE_MESSAGE);
+	camel_ews_message_info_set_change_key (emi, "CQAAABYAAADM");
+	camel_ews_message_info_set_conversation_key (emi, 12345);
+	camel_ews_message_info_set_attachment_count (emi, 2);
+	camel_ews_message_info_set_preview (emi, "Grüße, 100% sure: a+b = c");
+
+	loaded = test_round_trip_info (mi);
+	emi = CAMEL_EWS_MESSAGE_INFO (loaded);
+
+	g_assert_cmpstr (camel_ews_message_info_get_change_key (emi), ==, "CQAAABYAAADM");
+	g_assert_cmpuint (camel_ews_message_info_get_conversation_key (emi), ==, 12345);
+	g_assert_cmpuint (camel_ews_message_info_get_attachment_count (emi), ==, 2);
+	g_assert_cmpstr (camel_ews_message_info_get_preview (emi), ==, "Grüße, 100% sure: a+b = c");
+
+	g_object_unref (loaded);
+
+	/* No preview is stored as an empty value */
+	camel_ews_message_info_set_preview (CAMEL_EWS_MESSAGE_INFO (mi), NULL);
+	camel_ews_message_info_set_attachment_count (CAMEL_EWS_MESSAGE_INFO (mi), 0);
+
+	loaded = test_round_trip_info (mi);
+	emi = CAMEL_EWS_MESSAGE_INFO (loaded);
+
+	g_assert_cmpuint (camel_ews_message_info_get_conversation_key (emi), ==, 12345);
+	g_assert_cmpuint (camel_ews_message_info_get_attachment_count (emi), ==, 0);
+	g_assert (camel_ews_message_info_get_preview (emi) == NULL);
+
+	g_object_unref (loaded);
+
+	/* The server told only that there are some */
+	camel_ews_message_info_set_attachment_count (CAMEL_EWS_MESSAGE_INFO (mi), CAMEL_EWS_ATTACHMENT_COUNT_UNKNOWN);
+
+	loaded = test_round_trip_info (mi);
+	emi = CAMEL_EWS_MESSAGE_INFO (loaded);
+
+	g_assert_cmpuint (camel_ews_message_info_get_attachment_count (emi), ==, CAMEL_EWS_ATTACHMENT_COUNT_UNKNOWN);
+
+	g_object_unref (loaded);
+	g_object_unref (mi);
+
+	/* The summaries written by the older versions are still read */
+	record = g_new0 (CamelMIRecord, 1);
+	record->uid = g_strdup (ITEM_ID_PREFIX "V1");
+
+	loaded = g_object_new (CAMEL_TYPE_EWS_MESSAGE_INFO, NULL);
+	bdata_ptr = (gchar *) "0 1 CQAAABYAAADM 12345";
+
+	g_assert (camel_message_info_load (loaded, record, &bdata_ptr));
+
+	emi = CAMEL_EWS_MESSAGE_INFO (loaded);
+
+	g_assert_cmpstr (camel_ews_message_info_get_change_key (emi), ==, "CQAAABYAAADM");
+	g_assert_cmpuint (camel_ews_message_info_get_conversation_key (emi), ==, 12345);
+	g_assert_cmpuint (camel_ews_message_info_get_attachment_count (emi), ==, 0);
+	g_assert (camel_ews_message_info_get_preview (emi) == NULL);
+
+	g_object_unref (loaded);
+	camel_db_camel_mir_free (record);
+}
+
+static CamelMimePart *
+test_new_text_part (const gchar *text,
+		    const gchar *mime_type)
+{
+	CamelMimePart *part;
+
+	part = camel_mime_part_new ();
+	camel_mime_part_set_content (part, text, strlen (text), mime_type);
+
+	return part;
+}
+
+static void
+test_make_preview (void)
+{
+	CamelMimeMessage *message;
+	CamelMultipart *multipart;
+	CamelMimePart *part;
+	gchar *preview;
+
+	preview = camel_ews_utils_make_preview ("  Hello,\r\n\r\n\tthe minutes   are attached.\n", 200);
+	g_assert_cmpstr (preview, ==, "Hello, the minutes are attached.");
+	g_free (preview);
+
+	/* The length is counted in characters, not in bytes */
+	preview = camel_ews_utils_make_preview ("Grüße aus Köln", 5);
+	g_assert_cmpstr (preview, ==, "Grüße");
+	g_free (preview);
+
+	preview = camel_ews_utils_make_preview ("Hello world", 6);
+	g_assert_cmpstr (preview, ==, "Hello");
+	g_free (preview);
+
+	g_assert (camel_ews_utils_make_preview (" \r\n\t", 200) == NULL);
+	g_assert (camel_ews_utils_make_preview ("Hello", 0) == NULL);
+
+	/* The plain text is preferred in the multipart/alternative */
+	multipart = camel_multipart_new ();
+	camel_data_wrapper_set_mime_type (CAMEL_DATA_WRAPPER (multipart), "multipart/alternative");
+	camel_multipart_set_boundary (multipart, NULL);
+
+	part = test_new_text_part ("<html><body><p>The <b>HTML</b> body</p></body></html>", "text/html; charset=utf-8");
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	part = test_new_text_part ("The plain\ntext body\n", "text/plain; charset=utf-8");
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	message = camel_mime_message_new ();
+	camel_medium_set_content (CAMEL_MEDIUM (message), CAMEL_DATA_WRAPPER (multipart));
+	g_object_unref (multipart);
+
+	preview = camel_ews_utils_dup_message_preview (message, 200, NULL);
+	g_assert_cmpstr (preview, ==, "The plain text body");
+	g_free (preview);
+
+	g_object_unref (message);
+
+	/* The HTML body is converted to the text, the attachments are skipped */
+	multipart = camel_multipart_new ();
+	camel_data_wrapper_set_mime_type (CAMEL_DATA_WRAPPER (multipart), "multipart/mixed");
+	camel_multipart_set_boundary (multipart, NULL);
+
+	part = test_new_text_part ("The attached notes", "text/plain; charset=utf-8");
+	camel_mime_part_set_disposition (part, "attachment");
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	part = test_new_text_part ("<html><body><p>The <b>HTML</b> body</p></body></html>", "text/html; charset=utf-8");
+	camel_multipart_add_part (multipart, part);
+	g_object_unref (part);
+
+	message = camel_mime_message_new ();
+	camel_medium_set_content (CAMEL_MEDIUM (message), CAMEL_DATA_WRAPPER (multipart));
+	g_object_unref (multipart);
+
+	preview = camel_ews_utils_dup_message_preview (message, 200, NULL);
+	g_assert_cmpstr (preview, ==, "The HTML body");
+	g_free (preview);
+
+	g_object_unref (message);
+}
+
+static void
+test_preview_items (EwsTestData *etd,
+		    const gchar *version)
+{
+	UhmServer *local_server;
+	EEwsAdditionalProps *add_props;
+	GSList *ids = NULL, *items = NULL, *link;
+	GError *error = NULL;
+	gboolean with_preview;
+	guint ii;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, version, "camel/preview");
+	ews_test_server_start_trace (local_server, etd, "get_preview_items", &error);
+	g_assert_no_error (error);
+
+	e_ews_connection_set_server_version_from_string (etd->connection, version);
+
+	/* The preview is requested only from the servers which provide it */
+	with_preview = e_ews_connection_satisfies_server_version (etd->connection, E_EWS_EXCHANGE_2013);
+
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup (with_preview ?
+		SUMMARY_RECIPIENT_PROPS " " ATTACHMENT_PROPS " " PREVIEW_PROPS :
+		SUMMARY_RECIPIENT_PROPS " " ATTACHMENT_PROPS);
+
+	for (ii = 0; ii < N_ITEMS; ii++) {
+		ids = g_slist_prepend (ids, g_strdup_printf (ITEM_ID_PREFIX "V%u", ii));
+	}
+
+	ids = g_slist_reverse (ids);
+
+	g_assert (e_ews_connection_get_items_sync (etd->connection, EWS_PRIORITY_MEDIUM,
+		ids, "IdOnly", add_props,
+		FALSE, NULL, E_EWS_BODY_TYPE_ANY, &items, NULL, NULL,
+		NULL, &error));
+	g_assert_no_error (error);
+
+	e_ews_additional_props_free (add_props);
+
+	g_assert_cmpuint (g_slist_length (items), ==, N_ITEMS);
+
+	link = items;
+	g_assert_cmpuint (g_slist_length ((GSList *) e_ews_item_get_attachments_meta (link->data)), ==, 2);
+
+	link = g_slist_next (link);
+	g_assert (e_ews_item_get_attachments_meta (link->data) == NULL);
+
+	link = g_slist_next (link);
+	g_assert_cmpuint (g_slist_length ((GSList *) e_ews_item_get_attachments_meta (link->data)), ==, 1);
+
+	if (with_preview) {
+		gchar *preview;
+
+		preview = camel_ews_utils_make_preview (e_ews_item_get_preview (items->data), 200);
+		g_assert_cmpstr (preview, ==, "Hello, the minutes of the meeting are attached. Regards");
+		g_free (preview);
+
+		preview = camel_ews_utils_make_preview (e_ews_item_get_preview (items->data), 20);
+		g_assert_cmpstr (preview, ==, "Hello, the minutes o");
+		g_free (preview);
+
+		g_assert_cmpstr (e_ews_item_get_preview (items->next->data), ==, "Lunch today?");
+	} else {
+		for (link = items; link; link = g_slist_next (link)) {
+			g_assert (e_ews_item_get_preview (link->data) == NULL);
+		}
+	}
+
+	/* Restore the version of the test data */
+	e_ews_connection_set_server_version_from_string (etd->connection, etd->version);
+
+	g_slist_free_full (items, g_object_unref);
+	g_slist_free_full (ids, g_free);
+
+	uhm_server_end_trace (local_server);
+}
+
+static void
+test_get_preview_items (gconstpointer user_data)
+{
+	EwsTestData *etd = (gpointer) user_data;
+
+	test_preview_items (etd, etd->version);
+}
+
+/* None of the test versions provides the preview, thus use
+   the connection of any of them with a newer server trace */
+static void
+test_get_preview_items_with_preview (gconstpointer user_data)
+{
+	EwsTestData *etd = (gpointer) user_data;
+
+	test_preview_items (etd, PREVIEW_VERSION);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	GList *etds;
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	etds = ews_test_get_test_data_list ();
+
+	g_test_add_func ("/camel/preview/bdata_round_trip", test_bdata_round_trip);
+	g_test_add_func ("/camel/preview/make_preview", test_make_preview);
+
+	ews_test_add_data_func (NULL, "/camel/preview/get_preview_items", test_get_preview_items);
+
+	if (etds && !uhm_server_get_enable_online (ews_test_get_mock_server ()))
+		g_test_add_data_func ("/" PREVIEW_VERSION "/camel/preview/get_preview_items", etds->data, test_get_preview_items_with_preview);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
@@ -0,0 +1,132 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "camel/camel-ews-search-cache.h"
+
+#include "ews-test-common.h"
+
+#define FOLDER_ID "AQMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZAAuAAADAAAAAQ=="
+#define ITEM_A "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=A"
+#define ITEM_B "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA=B"
+
+static void
+find_uids (CamelEwsSearchCache *cache,
+	   EEwsConnection *cnc,
+	   const gchar *change_stamp,
+	   const GPtrArray *words)
+{
+	GHashTable *uids;
+	GError *error = NULL;
+
+	uids = camel_ews_search_cache_find_uids_sync (cache, cnc, FOLDER_ID, change_stamp, words, NULL, NULL, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (uids != NULL);
+
+	g_assert_cmpuint (g_hash_table_size (uids), ==, 2);
+	g_assert (g_hash_table_contains (uids, ITEM_A));
+	g_assert (g_hash_table_contains (uids, ITEM_B));
+
+	g_hash_table_unref (uids);
+}
+
+static void
+test_reuse_results (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	CamelEwsSearchCache *cache;
+	GPtrArray *words, *reversed;
+	GError *error = NULL;
+	GPtrArray *requests;
+	gulong handler_id;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/search-cache");
+	ews_test_server_start_trace (local_server, etd, "reuse_results", &error);
+	g_assert_no_error (error);
+
+	requests = g_ptr_array_new_with_free_func (g_free);
+	handler_id = ews_test_server_capture_requests (local_server, requests);
+
+	words = g_ptr_array_new ();
+	g_ptr_array_add (words, (gpointer) "invoice");
+	g_ptr_array_add (words, (gpointer) "march");
+
+	reversed = g_ptr_array_new ();
+	g_ptr_array_add (reversed, (gpointer) "march");
+	g_ptr_array_add (reversed, (gpointer) "invoice");
+
+	cache = camel_ews_search_cache_new (60 * G_TIME_SPAN_SECOND);
+
+	/* One search run, evaluated per message */
+	find_uids (cache, etd->connection, "10:state", words);
+	find_uids (cache, etd->connection, "10:state", words);
+	find_uids (cache, etd->connection, "10:state", reversed);
+	g_assert_cmpuint (requests->len, ==, 1);
+
+	/* The next run within the time to live */
+	camel_ews_search_cache_end_run (cache);
+	find_uids (cache, etd->connection, "10:state", words);
+	g_assert_cmpuint (requests->len, ==, 1);
+
+	/* The folder changed */
+	find_uids (cache, etd->connection, "11:state", words);
+	g_assert_cmpuint (requests->len, ==, 2);
+
+	camel_ews_search_cache_free (cache);
+
+	/* Without time to live the result lasts only for the run */
+	cache = camel_ews_search_cache_new (0);
+
+	find_uids (cache, etd->connection, "10:state", words);
+	find_uids (cache, etd->connection, "10:state", words);
+	g_assert_cmpuint (requests->len, ==, 3);
+
+	camel_ews_search_cache_end_run (cache);
+	find_uids (cache, etd->connection, "10:state", words);
+	g_assert_cmpuint (requests->len, ==, 4);
+
+	camel_ews_search_cache_free (cache);
+
+	g_signal_handler_disconnect (local_server, handler_id);
+
+	g_ptr_array_unref (requests);
+	g_ptr_array_unref (reversed);
+	g_ptr_array_unref (words);
+
+	uhm_server_end_trace (local_server);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	ews_test_add_data_func (NULL, "/camel/search-cache/reuse_results", test_reuse_results);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
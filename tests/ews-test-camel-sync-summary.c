@@ -0,0 +1,157 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "server/e-ews-item.h"
+
+#include "ews-test-common.h"
+
+#define FOLDER_ID "AQMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZAAuAAADAAAAAQ=="
+#define N_ITEMS 300
+
+/* The same as in the camel-ews-folder.c */
+#define SYNC_SUMMARY_PROPS "item:Subject item:DateTimeReceived item:DateTimeSent item:DateTimeCreated item:Size " \
+		   "item:HasAttachments item:InReplyTo message:From message:Sender message:References message:InternetMessageId " \
+		   "item:ResponseObjects item:Sensitivity item:Importance item:Categories message:IsRead"
+#define SUMMARY_RECIPIENT_PROPS "message:ToRecipients message:CcRecipients"
+#define EWS_MAX_SYNC_COUNT 500
+
+/* The page size, when only the ids are read by the SyncFolderItems
+   and each page is followed by a GetItem */
+#define EWS_MAX_FETCH_COUNT 100
+
+static void
+test_sync_with_summary_props (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	EEwsAdditionalProps *add_props;
+	GSList *items_created = NULL, *items_updated = NULL, *items_deleted = NULL;
+	GSList *ids = NULL, *items = NULL, *link;
+	GError *error = NULL;
+	gchar *sync_state = NULL;
+	gboolean includes_last_item = FALSE;
+	GPtrArray *requests;
+	guint n_read = 0;
+	gulong handler_id;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/sync-summary");
+	ews_test_server_start_trace (local_server, etd, "sync_with_summary_props", &error);
+	g_assert_no_error (error);
+
+	requests = g_ptr_array_new_with_free_func (g_free);
+	handler_id = ews_test_server_capture_requests (local_server, requests);
+
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup (SYNC_SUMMARY_PROPS);
+
+	g_assert (e_ews_connection_sync_folder_items_sync (etd->connection, EWS_PRIORITY_MEDIUM,
+		NULL, FOLDER_ID, "IdOnly", add_props, EWS_MAX_SYNC_COUNT,
+		&sync_state, &includes_last_item, &items_created, &items_updated, &items_deleted,
+		NULL, &error));
+	g_assert_no_error (error);
+
+	e_ews_additional_props_free (add_props);
+
+	g_assert (includes_last_item);
+	g_assert (sync_state != NULL);
+	g_assert (items_updated == NULL);
+	g_assert (items_deleted == NULL);
+	g_assert_cmpuint (g_slist_length (items_created), ==, N_ITEMS);
+
+	/* The summary is complete, except of the recipients */
+	for (link = items_created; link; link = g_slist_next (link)) {
+		EEwsItem *item = link->data;
+		const EwsMailbox *from;
+		gboolean is_read = FALSE;
+
+		g_assert_cmpint (e_ews_item_get_item_type (item), ==, E_EWS_ITEM_TYPE_MESSAGE);
+		g_assert (e_ews_item_get_subject (item) != NULL);
+		g_assert_cmpuint (e_ews_item_get_size (item), >, 0);
+		g_assert (e_ews_item_get_to_recipients (item) == NULL);
+
+		from = e_ews_item_get_from (item);
+		g_assert (from != NULL);
+		g_assert (from->email != NULL);
+
+		if (e_ews_item_is_read (item, &is_read) && is_read)
+			n_read++;
+
+		ids = g_slist_prepend (ids, g_strdup (e_ews_item_get_id (item)->id));
+	}
+
+	g_assert_cmpuint (n_read, ==, N_ITEMS / 2);
+
+	ids = g_slist_reverse (ids);
+
+	add_props = e_ews_additional_props_new ();
+	add_props->field_uri = g_strdup (SUMMARY_RECIPIENT_PROPS);
+
+	g_assert (e_ews_connection_get_items_sync (etd->connection, EWS_PRIORITY_MEDIUM,
+		ids, "IdOnly", add_props,
+		FALSE, NULL, E_EWS_BODY_TYPE_ANY, &items, NULL, NULL,
+		NULL, &error));
+	g_assert_no_error (error);
+
+	e_ews_additional_props_free (add_props);
+
+	g_assert_cmpuint (g_slist_length (items), ==, N_ITEMS);
+
+	for (link = items; link; link = g_slist_next (link)) {
+		const GSList *to = e_ews_item_get_to_recipients (link->data);
+
+		g_assert (to != NULL);
+		g_assert_cmpstr (((EwsMailbox *) to->data)->email, ==, "user@example.com");
+	}
+
+	g_signal_handler_disconnect (local_server, handler_id);
+
+	/* One SyncFolderItems and one GetItem, instead of a SyncFolderItems
+	   and a GetItem for each EWS_MAX_FETCH_COUNT messages */
+	g_assert_cmpuint (requests->len, ==, 2);
+	g_assert_cmpuint (requests->len * 3, <=, 2 * ((N_ITEMS + EWS_MAX_FETCH_COUNT - 1) / EWS_MAX_FETCH_COUNT));
+
+	g_slist_free_full (items, g_object_unref);
+	g_slist_free_full (items_created, g_object_unref);
+	g_ptr_array_unref (requests);
+	g_slist_free_full (ids, g_free);
+	g_free (sync_state);
+
+	uhm_server_end_trace (local_server);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	ews_test_add_data_func (NULL, "/camel/sync-summary/sync_with_summary_props", test_sync_with_summary_props);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
@@ -0,0 +1,244 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU Lesser General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <glib/gstdio.h>
+
+#include "camel/camel-ews-body-index.h"
+#include "camel/camel-ews-summary.h"
+
+#include "ews-test-common.h"
+
+#define DEST_FOLDER_ID "AQMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZAAuAAADAAAAAg=="
+#define ITEM_ID_PREFIX "AAMkAGI5NWRlODk2LWE2MjQtNDQ5Ny1iMzMyLTFjMjk3ZTg2ZjE1ZABGAAAAAAAA="
+#define N_ITEMS 1000
+
+static CamelMessageInfo *
+new_source_info (CamelFolderSummary *summary,
+		 const gchar *uid,
+		 const gchar *subject)
+{
+	CamelMessageInfo *mi;
+
+	mi = camel_message_info_new (summary);
+	camel_message_info_set_uid (mi, uid);
+	camel_message_info_set_subject (mi, subject);
+	camel_message_info_set_flags (mi, CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED, CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED);
+	camel_message_info_set_folder_flagged (mi, TRUE);
+	camel_ews_message_info_set_change_key (CAMEL_EWS_MESSAGE_INFO (mi), "CQAAABYAAADL");
+
+	return mi;
+}
+
+static void
+test_transferred_info (void)
+{
+	CamelFolderSummary *src_summary, *dst_summary;
+	CamelMessageInfo *src_mi, *dst_mi;
+
+	src_summary = g_object_new (CAMEL_TYPE_EWS_SUMMARY, NULL);
+	dst_summary = g_object_new (CAMEL_TYPE_EWS_SUMMARY, NULL);
+
+	src_mi = new_source_info (src_summary, ITEM_ID_PREFIX "S0000", "Moved message");
+	camel_folder_summary_add (src_summary, src_mi, FALSE);
+
+	g_assert (camel_ews_summary_add_message_info (dst_summary, ITEM_ID_PREFIX "D0000", "CQAAABYAAADM", src_mi));
+
+	/* The same item cannot be added twice */
+	g_assert (!camel_ews_summary_add_message_info (dst_summary, ITEM_ID_PREFIX "D0000", "CQAAABYAAADM", src_mi));
+	g_assert_cmpuint (camel_folder_summary_count (dst_summary), ==, 1);
+
+	dst_mi = camel_folder_summary_get (dst_summary, ITEM_ID_PREFIX "D0000");
+	g_assert (dst_mi != NULL);
+	g_assert (dst_mi != src_mi);
+
+	g_assert_cmpstr (camel_message_info_get_uid (dst_mi), ==, ITEM_ID_PREFIX "D0000");
+	g_assert_cmpstr (camel_ews_message_info_get_change_key (CAMEL_EWS_MESSAGE_INFO (dst_mi)), ==, "CQAAABYAAADM");
+	g_assert_cmpstr (camel_message_info_get_subject (dst_mi), ==, "Moved message");
+	g_assert_cmpuint (camel_message_info_get_flags (dst_mi) & (CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED), ==, CAMEL_MESSAGE_SEEN | CAMEL_MESSAGE_FLAGGED);
+
+	/* The server already has these flags, nothing to sync back */
+	g_assert (!camel_message_info_get_folder_flagged (dst_mi));
+
+	/* The source is left untouched */
+	g_assert_cmpstr (camel_message_info_get_uid (src_mi), ==, ITEM_ID_PREFIX "S0000");
+	g_assert_cmpstr (camel_ews_message_info_get_change_key (CAMEL_EWS_MESSAGE_INFO (src_mi)), ==, "CQAAABYAAADL");
+	g_assert (camel_message_info_get_folder_flagged (src_mi));
+
+	/* A refresh reporting the item with the same change key skips it,
+	   while a changed one is fetched again */
+	g_assert (camel_ews_summary_has_item (dst_summary, ITEM_ID_PREFIX "D0000", "CQAAABYAAADM"));
+	g_assert (!camel_ews_summary_has_item (dst_summary, ITEM_ID_PREFIX "D0000", "CQAAABYAAADN"));
+	g_assert (!camel_ews_summary_has_item (dst_summary, ITEM_ID_PREFIX "D0001", "CQAAABYAAADM"));
+
+	g_object_unref (dst_mi);
+	g_object_unref (src_mi);
+	g_object_unref (dst_summary);
+	g_object_unref (src_summary);
+}
+
+static void
+test_move_items (gconstpointer user_data)
+{
+	UhmServer *local_server;
+	EwsTestData *etd = (gpointer) user_data;
+	CamelEwsBodyIndex *src_index, *dst_index;
+	CamelFolderSummary *src_summary, *dst_summary;
+	GHashTable *matches;
+	GHashTableIter iter;
+	GPtrArray *requests, *words;
+	GSList *ids = NULL, *items = NULL, *link;
+	GError *error = NULL;
+	gchar *src_filename, *dst_filename;
+	gpointer key;
+	gulong handler_id;
+	guint ii;
+
+	local_server = ews_test_get_mock_server ();
+
+	ews_test_server_set_trace_directory (local_server, etd->version, "camel/transfer");
+	ews_test_server_start_trace (local_server, etd, "move_items", &error);
+	g_assert_no_error (error);
+
+	src_filename = g_build_filename (g_get_tmp_dir (), "ews-test-camel-transfer-src", NULL);
+	dst_filename = g_build_filename (g_get_tmp_dir (), "ews-test-camel-transfer-dst", NULL);
+	g_unlink (src_filename);
+	g_unlink (dst_filename);
+
+	src_index = camel_ews_body_index_new (src_filename);
+	dst_index = camel_ews_body_index_new (dst_filename);
+
+	src_summary = g_object_new (CAMEL_TYPE_EWS_SUMMARY, NULL);
+	dst_summary = g_object_new (CAMEL_TYPE_EWS_SUMMARY, NULL);
+
+	for (ii = 0; ii < N_ITEMS; ii++) {
+		CamelMessageInfo *mi;
+		gchar *uid, *text;
+
+		uid = g_strdup_printf (ITEM_ID_PREFIX "S%04u", ii);
+		text = g_strdup_printf ("Message %u of the %s kind", ii, (ii % 2) ? "odd" : "even");
+
+		camel_ews_body_index_add_text (src_index, uid, text);
+		ids = g_slist_prepend (ids, uid);
+
+		mi = new_source_info (src_summary, uid, text);
+		camel_folder_summary_add (src_summary, mi, FALSE);
+		g_object_unref (mi);
+
+		g_free (text);
+	}
+
+	ids = g_slist_reverse (ids);
+
+	requests = g_ptr_array_new_with_free_func (g_free);
+	handler_id = ews_test_server_capture_requests (local_server, requests);
+
+	g_assert (e_ews_connection_move_items_in_chunks_sync (etd->connection, EWS_PRIORITY_MEDIUM,
+		DEST_FOLDER_ID, FALSE, ids, &items, NULL, &error));
+	g_assert_no_error (error);
+
+	g_assert_cmpuint (g_slist_length (items), ==, N_ITEMS);
+
+	/* The moved messages are known from the response alone */
+	for (link = items, ii = 0; link; link = g_slist_next (link), ii++) {
+		CamelMessageInfo *mi;
+		const EwsId *id;
+		gchar *uid;
+
+		g_assert_cmpint (e_ews_item_get_item_type (link->data), !=, E_EWS_ITEM_TYPE_ERROR);
+
+		id = e_ews_item_get_id (link->data);
+		uid = g_strdup_printf (ITEM_ID_PREFIX "S%04u", ii);
+
+		g_assert (id != NULL);
+		g_assert_cmpstr (id->change_key, ==, "CQAAABYAAADM");
+		g_assert (camel_ews_body_index_transfer (src_index, uid, dst_index, id->id));
+
+		camel_ews_body_index_remove (src_index, uid);
+
+		mi = camel_folder_summary_get (src_summary, uid);
+		g_assert (mi != NULL);
+		g_assert (camel_ews_summary_add_message_info (dst_summary, id->id, id->change_key, mi));
+		camel_folder_summary_remove_uid (src_summary, uid);
+		g_object_unref (mi);
+
+		/* A following refresh has nothing to fetch for it */
+		g_assert (camel_ews_summary_has_item (dst_summary, id->id, id->change_key));
+
+		g_free (uid);
+	}
+
+	g_signal_handler_disconnect (local_server, handler_id);
+
+	g_assert_cmpuint (ews_test_count_requests (requests, "<messages:MoveItem "), ==, 2);
+
+	g_ptr_array_unref (requests);
+
+	g_assert_cmpuint (camel_ews_body_index_get_length (src_index), ==, 0);
+	g_assert_cmpuint (camel_ews_body_index_get_length (dst_index), ==, N_ITEMS);
+
+	g_assert_cmpuint (camel_folder_summary_count (src_summary), ==, 0);
+	g_assert_cmpuint (camel_folder_summary_count (dst_summary), ==, N_ITEMS);
+
+	words = g_ptr_array_new ();
+	g_ptr_array_add (words, (gpointer) "odd");
+
+	matches = camel_ews_body_index_search (dst_index, words);
+	g_assert (matches != NULL);
+	g_assert_cmpuint (g_hash_table_size (matches), ==, N_ITEMS / 2);
+
+	g_hash_table_iter_init (&iter, matches);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		g_assert (g_str_has_prefix (key, ITEM_ID_PREFIX "D"));
+	}
+
+	g_hash_table_unref (matches);
+	g_ptr_array_unref (words);
+
+	g_slist_free_full (items, g_object_unref);
+	g_slist_free_full (ids, g_free);
+	camel_ews_body_index_free (src_index);
+	camel_ews_body_index_free (dst_index);
+	g_object_unref (src_summary);
+	g_object_unref (dst_summary);
+	g_unlink (src_filename);
+	g_unlink (dst_filename);
+	g_free (src_filename);
+	g_free (dst_filename);
+
+	uhm_server_end_trace (local_server);
+}
+
+int
+main (int argc,
+      char **argv)
+{
+	gint retval;
+
+	retval = ews_test_init (argc, argv);
+
+	if (retval < 0)
+		goto exit;
+
+	g_test_add_func ("/camel/transfer/transferred_info", test_transferred_info);
+
+	ews_test_add_data_func (NULL, "/camel/transfer/move_items", test_move_items);
+
+	retval = ews_test_run ();
+
+ exit:
+	ews_test_cleanup ();
+	return retval;
+}
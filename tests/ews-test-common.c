@@ -357,6 +357,127 @@ ews_test_server_set_trace_directory (UhmServer *server,
 	g_object_unref (trace_directory);
 }
 
+void
+ews_test_server_notify_resolver_cb (GObject *object,
+				    GParamSpec *pspec,
+				    gpointer user_data)
+{
+	UhmServer *local_server;
+	UhmResolver *resolver;
+	EwsTestData *etd;
+
+	local_server = UHM_SERVER (object);
+	etd = user_data;
+
+	resolver = uhm_server_get_resolver (local_server);
+
+	if (resolver != NULL) {
+		const gchar *ip_address = uhm_server_get_address (local_server);
+
+		uhm_resolver_add_A (resolver, etd->hostname, ip_address);
+	}
+}
+
+static gboolean
+ews_test_server_handle_message_cb (UhmServer *local_server,
+				   SoupMessage *message,
+				   SoupClientContext *client,
+				   gpointer user_data)
+{
+	GPtrArray *requests = user_data;
+	SoupBuffer *buffer;
+
+	buffer = soup_message_body_flatten (message->request_body);
+	g_ptr_array_add (requests, g_strndup (buffer->data, buffer->length));
+	soup_buffer_free (buffer);
+
+	/* Let the trace reply */
+	return FALSE;
+}
+
+/* Adds bodies of the requests received by the @server into the @requests,
+   until the returned signal handler is disconnected */
+gulong
+ews_test_server_capture_requests (UhmServer *server,
+				  GPtrArray *requests) /* gchar * */
+{
+	return g_signal_connect (server, "handle-message", G_CALLBACK (ews_test_server_handle_message_cb), requests);
+}
+
+/* Returns how many of the captured @requests contain the @needle */
+guint
+ews_test_count_requests (const GPtrArray *requests, /* gchar * */
+			 const gchar *needle)
+{
+	guint ii, count = 0;
+
+	for (ii = 0; ii < requests->len; ii++) {
+		if (strstr (g_ptr_array_index (requests, ii), needle) != NULL)
+			count++;
+	}
+
+	return count;
+}
+
+guint
+ews_test_count_occurrences (const gchar *haystack,
+			    const gchar *needle)
+{
+	guint count = 0;
+
+	while (haystack && (haystack = strstr (haystack, needle)) != NULL) {
+		count++;
+		haystack += strlen (needle);
+	}
+
+	return count;
+}
+
+/* Adds the @func for each test server, or only for the server of the @version,
+   when not NULL; the test path is prefixed with the server version */
+void
+ews_test_add_data_func (const gchar *version,
+			const gchar *test_path,
+			GTestDataFunc func)
+{
+	GList *l;
+
+	for (l = ews_test_get_test_data_list (); l != NULL; l = l->next) {
+		EwsTestData *etd = l->data;
+		gchar *message;
+
+		if (version && g_strcmp0 (etd->version, version) != 0)
+			continue;
+
+		message = g_strdup_printf ("/%s%s", etd->version, test_path);
+		g_test_add_data_func (message, etd, func);
+		g_free (message);
+	}
+}
+
+/* Runs the added tests against the mock server */
+gint
+ews_test_run (void)
+{
+	UhmServer *server;
+	GList *l;
+	gint retval;
+
+	server = ews_test_get_mock_server ();
+
+	if (!uhm_server_get_enable_online (server))
+		for (l = ews_test_get_test_data_list (); l != NULL; l = l->next)
+			g_signal_connect (server, "notify::resolver", (GCallback) ews_test_server_notify_resolver_cb, l->data);
+
+	retval = g_test_run ();
+
+	if (!uhm_server_get_enable_online (server))
+		for (l = ews_test_get_test_data_list (); l != NULL; l = l->next)
+			g_signal_handlers_disconnect_by_func (server, ews_test_server_notify_resolver_cb, l->data);
+
+	return retval;
+}
+
 static void
 ews_test_debug_handler (const gchar *log_domain,
 			GLogLevelFlags log_level,
@@ -46,6 +46,19 @@ void			ews_test_server_start_trace			(UhmServer *server,
 void			ews_test_server_set_trace_directory		(UhmServer *server,
 									 const gchar *version,
 									 const gchar *tests);
+void			ews_test_server_notify_resolver_cb		(GObject *object,
+									 GParamSpec *pspec,
+									 gpointer user_data);
+gulong			ews_test_server_capture_requests		(UhmServer *server,
+									 GPtrArray *requests);
+guint			ews_test_count_requests				(const GPtrArray *requests,
+									 const gchar *needle);
+guint			ews_test_count_occurrences			(const gchar *haystack,
+									 const gchar *needle);
+void			ews_test_add_data_func				(const gchar *version,
+									 const gchar *test_path,
+									 GTestDataFunc func);
+gint			ews_test_run					(void);
 
 G_END_DECLS
 